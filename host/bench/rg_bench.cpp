@@ -0,0 +1,1022 @@
+// host/bench/rg_bench.cpp
+// Microbenchmarks for the host build: sample acquisition, filtering,
+// sample compression, serialization, HTTP handler latency, rolling statistics,
+// local rules, logging and MQTT publishing.
+//
+// Every result is one JSON object per line on stdout, e.g.
+//   {"bench":"handler.data","rev":"1a2b3c4","ns_per_op":812.4,"ops":262144,"bytes_per_op":87}
+// ns_per_op is the median of several timed runs. Other fields are exact counts
+// per operation (bus transfers, bytes on the wire) and do not depend on the
+// machine, so they can be compared across commits directly.
+//
+//   rg_bench [--quick] [filter]
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "communications/rg_mqtt_publisher.h"
+#include "rg_httpd_host.h"
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+#include "services/bus/rg_event_bus.h"
+#include "services/codec/rg_ts_codec.h"
+#include "services/flash_log/rg_flash_log.h"
+#include "services/log/rg_tlog.h"
+#include "services/ota/rg_ota_stream.h"
+#include "services/filter/rg_filter_chains.h"
+#include "services/rg_http_server.h"
+#include "services/rules/rg_rules.h"
+#include "services/sampler/rg_sampler.h"
+#include "services/stats/rg_stats.h"
+
+namespace {
+
+#ifndef RG_BENCH_REVISION
+#define RG_BENCH_REVISION "unknown"
+#endif
+
+bool s_quick = false;
+const char *s_filter = nullptr;
+const char *s_revision = RG_BENCH_REVISION;
+
+// Keeps the optimizer from dropping the measured work
+volatile uint32_t s_sink;
+
+struct metric_t {
+    const char *name;
+    double value;
+};
+
+// Runs fn() in batches until a batch takes long enough to time, then reports
+// the median ns per call over several batches. metrics() gets the total number
+// of calls, calibration included, for the counters it reports per operation.
+template <typename Fn>
+void run(const char *name, std::vector<metric_t> (*metrics)(uint64_t ops), Fn fn)
+{
+    if (s_filter && !strstr(name, s_filter)) {
+        return;
+    }
+    using clock = std::chrono::steady_clock;
+    const auto target = std::chrono::milliseconds(s_quick ? 2 : 50);
+    const int repeats = s_quick ? 1 : 7;
+
+    uint64_t calls = 0;
+    uint64_t batch = 1;
+    for (;;) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < batch; i++) {
+            fn();
+        }
+        calls += batch;
+        if (clock::now() - start >= target || batch >= (1ull << 30)) {
+            break;
+        }
+        batch *= 2;
+    }
+
+    std::vector<double> samples;
+    uint64_t ops = 0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < batch; i++) {
+            fn();
+        }
+        std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+        samples.push_back(elapsed.count() / (double)batch);
+        ops += batch;
+    }
+    calls += ops;
+    std::sort(samples.begin(), samples.end());
+
+    printf("{\"bench\":\"%s\",\"rev\":\"%s\",\"ns_per_op\":%.1f,\"ops\":%llu", name, s_revision,
+           samples[samples.size() / 2], (unsigned long long)ops);
+    if (metrics) {
+        for (const metric_t &m : metrics(calls)) {
+            printf(",\"%s\":%.6g", m.name, m.value);
+        }
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+// --- Sample acquisition ---------------------------------------------------
+
+rg_bme280_sim_t s_sim;
+rg_bme280_t s_bme280;
+// Second sensor at 0x77 for the group read
+rg_bme280_sim_t s_sim2;
+rg_bme280_t s_bme280_2;
+
+void sensor_init(rg_bme280_sim_t *sim, rg_bme280_t *dev)
+{
+    rg_bme280_sim_init(sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_bus_t bus = rg_bme280_sim_bus(sim);
+    if (rg_bme280_init_with_bus(dev, &bus) != ESP_OK) {
+        fprintf(stderr, "rg_bench: simulated BME280 did not initialize\n");
+        exit(1);
+    }
+    rg_bme280_sim_reset_counters(sim);
+}
+
+void sensor_setup()
+{
+    sensor_init(&s_sim, &s_bme280);
+    sensor_init(&s_sim2, &s_bme280_2);
+}
+
+// Both simulated sensors together
+std::vector<metric_t> bus_metrics(uint64_t ops)
+{
+    std::vector<metric_t> m = {
+        {"bus_transactions_per_op", (double)(s_sim.transactions + s_sim2.transactions) / ops},
+        {"bus_bytes_per_op", (double)(s_sim.bus_bytes + s_sim2.bus_bytes) / ops},
+        {"wait_us_per_op", (double)(s_sim.delay_us + s_sim2.delay_us) / ops},
+    };
+    rg_bme280_sim_reset_counters(&s_sim);
+    rg_bme280_sim_reset_counters(&s_sim2);
+    return m;
+}
+
+void bench_sensor()
+{
+    sensor_setup();
+    // bus_metrics() clears the counters after each report
+    run("sample.read_fixed", bus_metrics, [] {
+        rg_bme280_fixed_t fixed;
+        rg_bme280_read_fixed(&s_bme280, &fixed);
+        s_sink = fixed.pressure;
+    });
+    run("sample.read_values", bus_metrics, [] {
+        rg_bme280_values_t values;
+        rg_bme280_read_values(&s_bme280, &values);
+        s_sink = (uint32_t)values.pressure;
+    });
+    // Two sensors, one after the other, against both sampled as a group
+    run("sample.read_two_sequential", bus_metrics, [] {
+        rg_bme280_values_t values[2];
+        rg_bme280_read_values(&s_bme280, &values[0]);
+        rg_bme280_read_values(&s_bme280_2, &values[1]);
+        s_sink = (uint32_t)values[1].pressure;
+    });
+    run("sample.read_two_group", bus_metrics, [] {
+        static rg_bme280_t *const group[2] = {&s_bme280, &s_bme280_2};
+        rg_bme280_values_t values[2];
+        esp_err_t results[2];
+        rg_bme280_read_group(group, 2, values, results);
+        s_sink = (uint32_t)values[1].pressure;
+    });
+
+    static uint8_t data[RG_BME280_DATA_LEN];
+    memcpy(data, &s_sim.regs[RG_BME280_REG_DATA], sizeof(data));
+    run("sample.compensate", nullptr, [] {
+        rg_bme280_raw_t raw;
+        rg_bme280_fixed_t fixed;
+        rg_bme280_parse_raw(data, &raw);
+        rg_bme280_compensate(&s_bme280.calib, &raw, &fixed);
+        s_sink = fixed.humidity;
+    });
+
+    static rg_sampler_t sampler;
+    rg_sampler_config_t config;
+    rg_sampler_default_config(&config);
+    rg_sampler_init(&sampler, &config);
+    static uint32_t now_ms = 0;
+    run("sample.schedule", nullptr, [] {
+        float values[RG_SAMPLER_CHANNEL_COUNT] = {21.5f + (now_ms % 7) * 0.01f, 45.0f, 1013.2f};
+        s_sink = rg_sampler_update(&sampler, now_ms, values);
+        now_ms += rg_sampler_next_interval_ms(&sampler);
+    });
+}
+
+// --- Filtering ------------------------------------------------------------
+
+// Uniform noise of +-noise around base with a spike every 64 samples on average
+std::vector<int32_t> noisy_trace(int32_t base, int32_t noise, int32_t spike)
+{
+    std::vector<int32_t> trace(4096);
+    uint32_t rng = 1;
+    for (int32_t &x : trace) {
+        rng = rng * 1664525u + 1013904223u;
+        x = base + (int32_t)((rng >> 16) % (uint32_t)(2 * noise + 1)) - noise;
+        if ((rng & 0x3F) == 0) {
+            x += spike;
+        }
+    }
+    return trace;
+}
+
+// One Kconfig channel chain; reports its RAM and, on x86, TSC cycles per sample
+template <typename Chain>
+void bench_filter(const char *name, int32_t base, int32_t noise, int32_t spike)
+{
+    static std::vector<int32_t> trace;
+    static Chain chain;
+    static size_t next;
+    trace = noisy_trace(base, noise, spike);
+    run(name,
+        [](uint64_t) -> std::vector<metric_t> {
+            std::vector<metric_t> m = {{"ram_bytes", (double)sizeof(Chain)}};
+#if defined(__x86_64__) || defined(__i386__)
+            uint64_t start = __rdtsc();
+            for (int32_t x : trace) {
+                s_sink = chain(x);
+            }
+            m.push_back({"tsc_cycles_per_op", (double)(__rdtsc() - start) / trace.size()});
+#endif
+            return m;
+        },
+        [] { s_sink = chain(trace[next++ % trace.size()]); });
+}
+
+void bench_filters()
+{
+    bench_filter<rg_filter_temperature_t>("filter.temperature", 2200, 3, 200);
+    bench_filter<rg_filter_humidity_t>("filter.humidity", 4500, 10, 800);
+    bench_filter<rg_filter_pressure_t>("filter.pressure", 101325, 3, 200);
+}
+
+// --- Sample compression ---------------------------------------------------
+//
+// A day of a room: diurnal drift, a 20-minute HVAC cycle and BME280-sized
+// noise, through the Kconfig filter chains as on the device. The fixed trace
+// samples every 10 s; the adaptive one keeps what rg_sampler publishes.
+// Blocks are one flash log page each.
+
+constexpr size_t CODEC_BLOCK = RG_FLASH_LOG_PAGE_SIZE;
+
+struct codec_trace_t {
+    std::vector<rg_ts_sample_t> samples;
+    std::vector<std::vector<uint8_t>> blocks;
+    size_t bytes;
+};
+
+double gaussian(uint32_t &rng)
+{
+    double sum = 0;
+    for (int i = 0; i < 12; i++) {
+        rng = rng * 1664525u + 1013904223u;
+        sum += (rng >> 8) / 16777216.0;
+    }
+    return sum - 6.0;
+}
+
+codec_trace_t room_trace(bool adaptive)
+{
+    codec_trace_t trace;
+    rg_filter_temperature_guard_t tg;
+    rg_filter_humidity_guard_t hg;
+    rg_filter_pressure_guard_t pg;
+    rg_filter_temperature_smoother_t ts;
+    rg_filter_humidity_smoother_t hs;
+    rg_filter_pressure_smoother_t ps;
+    static rg_sampler_t sampler;
+    rg_sampler_config_t config;
+    rg_sampler_default_config(&config);
+    rg_sampler_init(&sampler, &config);
+    uint32_t rng = 11;
+
+    const uint32_t day_ms = 24 * 3600 * 1000;
+    for (uint32_t ms = 0; ms < day_ms;) {
+        double day = 2 * M_PI * ms / day_ms;
+        double hvac = (ms / 1000) % 1200 / 1200.0;
+        hvac = hvac < 0.5 ? hvac * 4 - 1 : 3 - hvac * 4;
+        const int32_t raw_t = tg((int32_t)lround(2150 + 150 * sin(day) + 30 * hvac + 3 * gaussian(rng)));
+        const int32_t raw_h = hg((int32_t)lround(4500 - 400 * sin(day) - 60 * hvac + 10 * gaussian(rng)));
+        const int32_t raw_p = pg((int32_t)lround(101325 + 120 * sin(day / 2) + 3 * gaussian(rng)));
+        int32_t t = ts(raw_t);
+        int32_t h = hs(raw_h);
+        int32_t p = ps(raw_p);
+
+        bool keep = true;
+        uint32_t interval = 10000;
+        if (adaptive) {
+            const float values[RG_SAMPLER_CHANNEL_COUNT] = {raw_t / 100.0f, raw_h / 100.0f, raw_p / 100.0f};
+            const float smoothed[RG_SAMPLER_CHANNEL_COUNT] = {t / 100.0f, h / 100.0f, p / 100.0f};
+            keep = rg_sampler_update_smoothed(&sampler, ms, values, smoothed) != 0;
+            interval = rg_sampler_next_interval_ms(&sampler);
+        }
+        if (keep) {
+            trace.samples.push_back({ms / 1000, {t, h, p}});
+        }
+        ms += interval;
+    }
+
+    rg_ts_encoder_t enc;
+    std::vector<uint8_t> block(CODEC_BLOCK);
+    rg_ts_encoder_init(&enc, block.data(), block.size());
+    trace.bytes = 0;
+    for (const rg_ts_sample_t &sample : trace.samples) {
+        if (!rg_ts_encoder_append(&enc, &sample)) {
+            trace.blocks.emplace_back(block.begin(), block.begin() + rg_ts_encoder_size(&enc));
+            rg_ts_encoder_init(&enc, block.data(), block.size());
+            rg_ts_encoder_append(&enc, &sample);
+        }
+    }
+    trace.blocks.emplace_back(block.begin(), block.begin() + rg_ts_encoder_size(&enc));
+    for (const auto &b : trace.blocks) {
+        trace.bytes += b.size();
+    }
+    return trace;
+}
+
+codec_trace_t s_codec_trace;
+size_t s_codec_next;
+rg_ts_encoder_t s_codec_enc;
+uint8_t s_codec_block[CODEC_BLOCK];
+rg_ts_decoder_t s_codec_dec;
+size_t s_codec_block_index;
+
+// Sizes are exact over the whole trace; cycles are TSC on x86
+std::vector<metric_t> codec_metrics(uint64_t)
+{
+    double per_sample = (double)s_codec_trace.bytes / s_codec_trace.samples.size();
+    return {
+        {"samples", (double)s_codec_trace.samples.size()},
+        {"bytes_per_sample", per_sample},
+        {"ratio_vs_float", (4 + 3 * sizeof(float)) / per_sample},
+        {"ratio_vs_flash_log", RG_FLASH_LOG_RECORD_SIZE / per_sample},
+    };
+}
+
+void codec_encode_one()
+{
+    const rg_ts_sample_t &sample = s_codec_trace.samples[s_codec_next++ % s_codec_trace.samples.size()];
+    if (!rg_ts_encoder_append(&s_codec_enc, &sample)) {
+        rg_ts_encoder_init(&s_codec_enc, s_codec_block, sizeof(s_codec_block));
+        rg_ts_encoder_append(&s_codec_enc, &sample);
+    }
+    s_sink = s_codec_enc.count;
+}
+
+void codec_decode_one()
+{
+    rg_ts_sample_t sample;
+    while (!rg_ts_decoder_next(&s_codec_dec, &sample)) {
+        const auto &block = s_codec_trace.blocks[s_codec_block_index++ % s_codec_trace.blocks.size()];
+        rg_ts_decoder_init(&s_codec_dec, block.data(), block.size());
+    }
+    s_sink = sample.values[0];
+}
+
+template <void (*Fn)()>
+std::vector<metric_t> codec_cycle_metrics(uint64_t ops)
+{
+    std::vector<metric_t> m = codec_metrics(ops);
+#if defined(__x86_64__) || defined(__i386__)
+    const int n = 4096;
+    uint64_t start = __rdtsc();
+    for (int i = 0; i < n; i++) {
+        Fn();
+    }
+    m.push_back({"tsc_cycles_per_op", (double)(__rdtsc() - start) / n});
+#endif
+    return m;
+}
+
+void bench_codec()
+{
+    for (bool adaptive : {false, true}) {
+        s_codec_trace = room_trace(adaptive);
+        s_codec_next = 0;
+        s_codec_block_index = 0;
+        rg_ts_encoder_init(&s_codec_enc, s_codec_block, sizeof(s_codec_block));
+        rg_ts_decoder_init(&s_codec_dec, s_codec_trace.blocks[0].data(), 0);
+        run(adaptive ? "codec.encode_room_adaptive" : "codec.encode_room_10s",
+            codec_cycle_metrics<codec_encode_one>, codec_encode_one);
+        run(adaptive ? "codec.decode_room_adaptive" : "codec.decode_room_10s",
+            codec_cycle_metrics<codec_decode_one>, codec_decode_one);
+    }
+}
+
+// --- Serialization --------------------------------------------------------
+
+size_t s_last_bytes;
+
+std::vector<metric_t> bytes_metrics(uint64_t)
+{
+    return {{"bytes_per_op", (double)s_last_bytes}};
+}
+
+void bench_serialization()
+{
+    shared_data_set_ip_address("192.168.100.200");
+    shared_data_publish(21.37f, 48.52f, 1013.25f, 123456789);
+
+    run("serialize.shared_data_read", nullptr, [] {
+        shared_data_t snapshot;
+        shared_data_read(&snapshot);
+        s_sink = snapshot.sequence;
+    });
+    run("serialize.data_json", bytes_metrics, [] {
+        shared_data_t snapshot;
+        shared_data_read(&snapshot);
+        char body[192];
+        rg_json_writer json(body, sizeof(body));
+        shared_data_write_json(json, snapshot);
+        s_last_bytes = json.size();
+        s_sink = (uint32_t)json.size();
+    });
+    run("serialize.data_nlohmann", bytes_metrics, [] {
+        // Reference: the body as the handler built it before rg_json_writer
+        shared_data_t snapshot;
+        shared_data_read(&snapshot);
+        nlohmann::json j;
+        j["temperature"] = snapshot.temperature;
+        j["humidity"] = snapshot.humidity;
+        j["pressure"] = snapshot.pressure;
+        j["ip_address"] = snapshot.ip_address;
+        std::string body = j.dump();
+        s_last_bytes = body.size();
+        s_sink = (uint32_t)body.size();
+    });
+
+    static rg_metrics_histogram_t histogram =
+        RG_METRICS_HISTOGRAM_INIT("rg_bench_seconds", "Benchmark only.", NULL, rg_metrics_latency_bounds_us);
+    static uint32_t value = 0;
+    run("serialize.metrics_observe", nullptr, [] { rg_metrics_observe(&histogram, value++ & 0x3FFF); });
+
+    static uint32_t t = 1000000;
+    run("serialize.history_add", nullptr, [] {
+        rg_history_add_fixed(t++, 2137, 4852, 10132);
+    });
+}
+
+// --- HTTP handlers --------------------------------------------------------
+
+int s_fd;
+rg_httpd_host_response_t s_resp;
+std::string s_etag_header;
+
+std::vector<metric_t> response_metrics(uint64_t)
+{
+    return {
+        {"status", (double)s_resp.status},
+        {"bytes_per_op", (double)s_resp.body_len},
+        {"chunks_per_op", (double)s_resp.chunks},
+    };
+}
+
+void get(const char *uri, const char *headers = nullptr)
+{
+    rg_httpd_host_get(s_fd, uri, headers, rg_http_handle_request, &s_resp);
+}
+
+void fill_history()
+{
+    rg_history_reset();
+    uint32_t start = 1000000;
+    size_t n = rg_history_capacity(RG_HISTORY_TIER_RAW) * 2;
+    for (size_t i = 0; i < n; i++) {
+        rg_history_add_fixed(start + (uint32_t)i * 10, (int16_t)(2100 + i % 50), (uint16_t)(4500 + i % 300),
+                             (uint16_t)(10130 + i % 7));
+    }
+}
+
+void bench_handlers()
+{
+    s_fd = rg_httpd_host_open();
+    shared_data_publish(21.37f, 48.52f, 1013.25f, 123456789);
+    fill_history();
+
+    run("handler.data", response_metrics, [] { get("/data"); });
+    run("handler.history_raw", response_metrics, [] { get("/history?tier=raw"); });
+    run("handler.history_minute", response_metrics, [] { get("/history?tier=minute"); });
+    run("handler.history_hour", response_metrics, [] { get("/history?tier=hour"); });
+    run("handler.dashboard", response_metrics, [] { get("/"); });
+
+    get("/");
+    char etag[32] = {0};
+    const char *p = strstr(s_resp.headers, "ETag: ");
+    if (p) {
+        sscanf(p + 6, "%31[^\r]", etag);
+    }
+    s_etag_header = std::string("If-None-Match: ") + etag + "\r\n";
+    run("handler.dashboard_304", response_metrics, [] { get("/", s_etag_header.c_str()); });
+    run("handler.not_found", response_metrics, [] { get("/missing"); });
+    run("handler.method_not_allowed", response_metrics,
+        [] { rg_httpd_host_request(s_fd, HTTP_POST, "/data", nullptr, rg_http_handle_request, &s_resp); });
+    // Route lookup alone, over a mix of hits, query strings and a miss
+    static const char *const uris[] = {"/", "/data", "/events", "/history?tier=raw&from=1000", "/metrics", "/missing"};
+    static size_t next_uri = 0;
+    run("router.find", nullptr, [] {
+        s_sink += s_router.find(uris[next_uri]) != nullptr;
+        next_uri = (next_uri + 1) % (sizeof(uris) / sizeof(uris[0]));
+    });
+    run("handler.metrics", response_metrics, [] { get("/metrics"); });
+    rg_httpd_host_close(s_fd);
+}
+
+// --- Event stream push ----------------------------------------------------
+
+int s_stream_fds[CONFIG_RG_SSE_MAX_CLIENTS];
+size_t s_stream_bytes;
+
+std::vector<metric_t> push_metrics(uint64_t ops)
+{
+    size_t bytes = 0;
+    for (int fd : s_stream_fds) {
+        bytes += rg_httpd_host_socket_bytes(fd);
+    }
+    std::vector<metric_t> m = {
+        {"clients", (double)rg_sse_client_count()},
+        {"socket_bytes_per_op", (double)(bytes - s_stream_bytes) / ops},
+    };
+    s_stream_bytes = bytes;
+    return m;
+}
+
+void bench_events()
+{
+    for (int &fd : s_stream_fds) {
+        fd = rg_httpd_host_open();
+        rg_httpd_host_get(fd, "/events", nullptr, rg_http_handle_request, &s_resp);
+        s_stream_bytes += rg_httpd_host_socket_bytes(fd);
+    }
+    // One publish from the sensor task, then the push running on the server task
+    static float t = 20.0f;
+    run("events.publish_push", push_metrics, [] {
+        t += 0.01f;
+        shared_data_publish(t, 48.52f, 1013.25f, 123456789);
+        rg_sse_notify();
+        rg_httpd_host_poll();
+    });
+    for (int fd : s_stream_fds) {
+        rg_httpd_host_close(fd);
+    }
+
+    // One sample through the bus to the device's four consumers, each reading it once
+    static rg_event_slot_t slots[16];
+    static rg_event_bus_t bus;
+    static rg_event_sub_t subs[4] = {
+        RG_EVENT_SUB_INIT("http", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE)),
+        RG_EVENT_SUB_INIT("log", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE)),
+        RG_EVENT_SUB_INIT("mqtt", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE)),
+        RG_EVENT_SUB_INIT("zigbee", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE)),
+    };
+    rg_event_bus_init(&bus, slots, 16, nullptr);
+    for (auto &sub : subs) {
+        rg_event_bus_subscribe(&bus, &sub);
+    }
+    run("events.bus_publish_poll", nullptr, [] {
+        rg_event_t event = {};
+        event.type = RG_EVENT_SAMPLE;
+        event.sample.temperature = t += 0.01f;
+        rg_event_bus_publish(&bus, &event, 0);
+        for (auto &sub : subs) {
+            rg_event_bus_poll(&bus, &sub, &event);
+        }
+        s_sink = event.sequence;
+    });
+}
+
+// --- Rolling statistics -----------------------------------------------------
+//
+// One sample per second, so every window keeps closing and expiring slots.
+// ram_bytes is the fixed size of a window whatever its length.
+
+template <uint32_t LENGTH_S>
+void bench_stats_window(const char *name)
+{
+    static rg_stats_window_t window;
+    static uint32_t now;
+    rg_stats_window_init(&window, LENGTH_S);
+    run(name,
+        [](uint64_t) -> std::vector<metric_t> {
+            return {{"ram_bytes", (double)sizeof(rg_stats_window_t)}, {"slot_s", (double)window.slot_s}};
+        },
+        [] {
+            now++;
+            rg_stats_window_add(&window, now, (int32_t)(now * 7919 % 601) - 300);
+        });
+}
+
+void bench_stats()
+{
+    bench_stats_window<300>("stats.window_add_5m");
+    bench_stats_window<3600>("stats.window_add_1h");
+    bench_stats_window<86400>("stats.window_add_24h");
+
+    // All three channels with the default windows, results published after each sample
+    rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT];
+    rg_stats_default_config(config);
+    rg_stats_configure(config);
+    static uint32_t now = 0;
+    run("stats.add",
+        [](uint64_t) -> std::vector<metric_t> {
+            rg_stats_snapshot_t snapshot;
+            rg_stats_read(&snapshot);
+            uint32_t windows = 0;
+            for (uint8_t n : snapshot.window_count) {
+                windows += n;
+            }
+            return {{"windows", (double)windows}, {"ram_bytes", (double)(windows * sizeof(rg_stats_window_t))},
+                    {"snapshot_bytes", (double)sizeof(rg_stats_snapshot_t)}};
+        },
+        [] {
+            now++;
+            rg_stats_add(now, 21.0f + (now % 97) * 0.01f, 45.0f + (now % 53) * 0.1f, 1013.0f + (now % 31) * 0.05f);
+        });
+
+    s_fd = rg_httpd_host_open();
+    run("handler.stats", response_metrics, [] { get("/stats"); });
+    rg_httpd_host_close(s_fd);
+}
+
+// --- Local rules --------------------------------------------------------------
+//
+// Cost per reading of evaluating N rules: a mix of levels and rates on all
+// three channels, with hold times and hysteresis, over a trace that keeps
+// some of them tripping and clearing.
+
+template <size_t N>
+void bench_rule_set(const char *name)
+{
+    static rg_rule_t rules[N];
+    static rg_rule_state_t states[N];
+    static rg_rules_t engine;
+    static uint32_t now_ms;
+    static uint32_t changes;
+    static const char *const templates[] = {
+        "t%u: temperature > %u.%u hyst 0.5 for 30s",
+        "h%u: humidity > %u hyst 2 for 2m -> gpio 4",
+        "r%u: temperature rate > 0.%u for 1m",
+        "p%u: pressure rate < -1.%u hyst 0.5",
+    };
+    std::string text;
+    for (size_t i = 0; i < N; i++) {
+        char rule[96];
+        snprintf(rule, sizeof(rule), templates[i % 4], (unsigned)i, (unsigned)(20 + i % 7), (unsigned)(i % 10));
+        text += rule;
+        text += ';';
+    }
+    size_t count = 0;
+    if (rg_rules_compile(text.c_str(), rules, N, &count, nullptr) != ESP_OK || count != N) {
+        fprintf(stderr, "rg_bench: %s rules did not compile\n", name);
+        exit(1);
+    }
+    rg_rules_init(&engine, rules, states, N, 60000, nullptr, nullptr);
+    now_ms = 0;
+    changes = 0;
+    run(name,
+        [](uint64_t ops) -> std::vector<metric_t> {
+            return {{"rules", (double)N},
+                    {"ram_bytes", (double)(N * (sizeof(rg_rule_t) + sizeof(rg_rule_state_t)) + sizeof(rg_rules_t))},
+                    {"changes_per_op", (double)changes / ops}};
+        },
+        [] {
+            // One reading every 2 s; temperature swings 19-27 degC over about 17 minutes
+            now_ms += 2000;
+            const uint32_t phase = now_ms / 2000 % 500;
+            const int32_t swing = (int32_t)(phase < 250 ? phase : 500 - phase);
+            const int32_t values[RG_RULES_CHANNEL_COUNT] = {1900 + swing * 3, 5000 + swing * 10,
+                                                            101325 - swing * 8};
+            changes += rg_rules_evaluate(&engine, now_ms, values);
+        });
+}
+
+void bench_rules()
+{
+    bench_rule_set<1>("rules.evaluate_1");
+    bench_rule_set<16>("rules.evaluate_16");
+    bench_rule_set<64>("rules.evaluate_64");
+}
+
+// --- Logging ------------------------------------------------------------------
+//
+// The sensor task's per-sample log line, formatted on the spot as ESP_LOGI
+// does versus stored as a tokenized record for the drain task. The byte
+// counts are what reaches the UART; at 115200 baud each byte takes 87 us of
+// line time, which ESP_LOGI spends on the calling task once the UART FIFO is
+// full. Record sizes are given for the ESP32-C6, whose pointers are 4 bytes.
+
+const char *const s_log_format = "Sensor Data: Temp=%.2f C, Pres=%.2f hPa, Hum=%.2f %%";
+uint32_t s_log_buf[4096 / sizeof(uint32_t)];
+rg_tlog_ring_t s_log_ring;
+size_t s_log_text_bytes;
+size_t s_log_record_bytes;
+uint32_t s_log_time_ms;
+float s_log_value;
+
+size_t __attribute__((format(printf, 2, 3))) log_format(char *out, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out, 160, format, args);
+    va_end(args);
+    return (size_t)n;
+}
+
+bool __attribute__((format(printf, 1, 2))) log_record(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    bool ok = rg_tlog_ring_vwrite(&s_log_ring, ESP_LOG_INFO, s_log_time_ms, "APP_MAIN", format, args);
+    va_end(args);
+    return ok;
+}
+
+// The ESP_LOGI line: "I (time) TAG: message\n"
+void log_esp_logi()
+{
+    char line[160];
+    s_log_value += 0.01f;
+    s_log_time_ms += 2000;
+    size_t n = log_format(line, "I (%lu) %s: Sensor Data: Temp=%.2f C, Pres=%.2f hPa, Hum=%.2f %%\n",
+                          (unsigned long)s_log_time_ms, "APP_MAIN", 20.0f + s_log_value, 1013.0f + s_log_value,
+                          45.0f + s_log_value);
+    s_log_text_bytes = n;
+    s_sink = (uint8_t)line[n / 2];
+}
+
+// Writer side only; the ring is reset (as a drain would) when it fills
+void log_tlog_write()
+{
+    s_log_value += 0.01f;
+    s_log_time_ms += 2000;
+    while (!log_record(s_log_format, 20.0f + s_log_value, 1013.0f + s_log_value, 45.0f + s_log_value)) {
+        rg_tlog_ring_init(&s_log_ring, (uint8_t *)s_log_buf, sizeof(s_log_buf));
+    }
+}
+
+// The drain task's share: read, parse and format one record
+void log_tlog_drain_text()
+{
+    uint32_t record[RG_TLOG_MAX_RECORD / sizeof(uint32_t)];
+    rg_tlog_record_t parsed;
+    char line[160];
+    log_tlog_write();
+    s_log_record_bytes = rg_tlog_ring_read(&s_log_ring, (uint8_t *)record, sizeof(record));
+    rg_tlog_parse((const uint8_t *)record, s_log_record_bytes, &parsed);
+    s_log_text_bytes = rg_tlog_format(&parsed, line, sizeof(line)) + 1;
+    s_sink = (uint8_t)line[s_log_text_bytes / 2];
+}
+
+template <void (*Fn)()>
+std::vector<metric_t> log_metrics(uint64_t)
+{
+    // The record on the device; tlog_write goes out as the base64 line of CONFIG_RG_TLOG_OUTPUT_BINARY,
+    // the others as text
+    const double device_record = (double)(s_log_record_bytes - 2 * (sizeof(uintptr_t) - 4));
+    const double uart_bytes = Fn == log_tlog_write ? 4 + 4 * ceil(device_record / 3) : (double)s_log_text_bytes;
+    std::vector<metric_t> m = {
+        {"uart_bytes_per_op", uart_bytes},
+        {"uart_us_per_op", uart_bytes * 10 * 1e6 / 115200},
+    };
+    if (Fn != log_esp_logi) {
+        m.push_back({"record_bytes", device_record});
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    const int n = 4096;
+    uint64_t start = __rdtsc();
+    for (int i = 0; i < n; i++) {
+        Fn();
+    }
+    m.push_back({"tsc_cycles_per_op", (double)(__rdtsc() - start) / n});
+#endif
+    return m;
+}
+
+void bench_log()
+{
+    rg_tlog_ring_init(&s_log_ring, (uint8_t *)s_log_buf, sizeof(s_log_buf));
+    // Sizes for the metrics; every call produces the same ones
+    log_tlog_drain_text();
+    log_esp_logi();
+    run("log.esp_logi_format", log_metrics<log_esp_logi>, log_esp_logi);
+    run("log.tlog_write", log_metrics<log_tlog_write>, log_tlog_write);
+    rg_tlog_ring_init(&s_log_ring, (uint8_t *)s_log_buf, sizeof(s_log_buf));
+    run("log.tlog_drain_text", log_metrics<log_tlog_drain_text>, log_tlog_drain_text);
+}
+
+// --- MQTT publishing vs. HTTP scraping -------------------------------------
+//
+// Per-sample cost of getting data to the backend, application-layer bytes
+// only. The rate is the sampler's fastest interval: a backend scraping /data
+// has to poll that often not to miss samples, while MQTT sends one batch of
+// CONFIG_RG_MQTT_BATCH_SIZE samples per publish.
+
+constexpr double SAMPLES_PER_HOUR = 3600000.0 / CONFIG_RG_SAMPLER_MIN_INTERVAL_MS;
+constexpr const char *MQTT_TOPIC = "rg2/rg2-a1b2c3/samples";
+
+rg_mqtt_sample_t s_mqtt_storage[CONFIG_RG_MQTT_QUEUE_LEN];
+rg_mqtt_publisher_t s_mqtt;
+uint32_t s_mqtt_ts = 100000;
+uint8_t s_mqtt_payload[CONFIG_RG_MQTT_PAYLOAD_MAX];
+size_t s_http_scrape_bytes;
+
+std::vector<metric_t> mqtt_metrics(uint64_t)
+{
+    double samples = s_mqtt.stats.samples;
+    return {
+        {"samples_per_message", samples / s_mqtt.stats.messages},
+        {"payload_bytes_per_sample", s_mqtt.stats.payload_bytes / samples},
+        {"wire_bytes_per_sample", s_mqtt.stats.wire_bytes / samples},
+        {"messages_per_hour", SAMPLES_PER_HOUR * s_mqtt.stats.messages / samples},
+    };
+}
+
+std::vector<metric_t> scrape_metrics(uint64_t)
+{
+    return {
+        {"samples_per_message", 1},
+        {"payload_bytes_per_sample", (double)s_resp.body_len},
+        {"wire_bytes_per_sample", (double)s_http_scrape_bytes},
+        {"messages_per_hour", SAMPLES_PER_HOUR},
+    };
+}
+
+// Queues one batch of room-like samples, encodes it and takes the PUBACK
+void mqtt_publish_batch()
+{
+    for (int i = 0; i < CONFIG_RG_MQTT_BATCH_SIZE; i++) {
+        s_mqtt_ts += 2 + s_mqtt_ts % 29;
+        rg_mqtt_sample_t sample = {
+            .timestamp = s_mqtt_ts,
+            .temperature = (int16_t)(2100 + s_mqtt_ts % 300),
+            .humidity = (uint16_t)(4000 + s_mqtt_ts % 1000),
+            .pressure = (uint16_t)(10100 + s_mqtt_ts % 100),
+        };
+        rg_mqtt_publisher_push(&s_mqtt, &sample);
+    }
+    s_sink = (uint32_t)rg_mqtt_publisher_next(&s_mqtt, s_mqtt_ts, "rg2-a1b2c3", s_mqtt_payload,
+                                              sizeof(s_mqtt_payload));
+    rg_mqtt_publisher_acked(&s_mqtt);
+}
+
+void bench_mqtt()
+{
+    rg_mqtt_publisher_init(&s_mqtt, s_mqtt_storage, CONFIG_RG_MQTT_QUEUE_LEN, CONFIG_RG_MQTT_BATCH_SIZE,
+                           CONFIG_RG_MQTT_BATCH_MAX_AGE_S, RG_MQTT_FORMAT_JSON, strlen(MQTT_TOPIC));
+    rg_mqtt_publisher_set_connected(&s_mqtt, true);
+    run("mqtt.batch_json", mqtt_metrics, mqtt_publish_batch);
+
+    rg_mqtt_publisher_init(&s_mqtt, s_mqtt_storage, CONFIG_RG_MQTT_QUEUE_LEN, CONFIG_RG_MQTT_BATCH_SIZE,
+                           CONFIG_RG_MQTT_BATCH_MAX_AGE_S, RG_MQTT_FORMAT_CBOR, strlen(MQTT_TOPIC));
+    rg_mqtt_publisher_set_connected(&s_mqtt, true);
+    run("mqtt.batch_cbor", mqtt_metrics, mqtt_publish_batch);
+
+    // One GET /data per sample: request line and Host header, then status
+    // line, headers and body of the response
+    s_fd = rg_httpd_host_open();
+    shared_data_publish(21.37f, 48.52f, 1013.25f, 123456789);
+    run("mqtt.http_scrape", scrape_metrics, [] {
+        get("/data");
+        s_http_scrape_bytes = strlen("GET /data HTTP/1.1\r\nHost: 192.168.100.200\r\n\r\n") +
+                              strlen("HTTP/1.1 200 OK\r\n") + strlen(s_resp.headers) +
+                              (size_t)snprintf(nullptr, 0, "Content-Length: %u\r\n\r\n",
+                                               (unsigned)s_resp.body_len) +
+                              s_resp.body_len;
+    });
+    rg_httpd_host_close(s_fd);
+}
+
+// --- OTA images -----------------------------------------------------------
+
+// The benchmark's own executable stands in for the app image: real machine
+// code, strings and tables, if for another instruction set
+std::vector<uint8_t> s_ota_image;
+std::vector<uint8_t> s_ota_packed;
+rg_ota_stream_t s_ota_stream;
+
+esp_err_t ota_sink(void *, const uint8_t *data, size_t len)
+{
+    s_sink += data[len - 1];
+    return ESP_OK;
+}
+
+// Greedy LZSS in the heatshrink format with one candidate per 3-byte hash;
+// host/ota_pack.py searches harder, so real images come out a little smaller
+std::vector<uint8_t> ota_pack(const std::vector<uint8_t> &in, unsigned window_bits, unsigned lookahead_bits)
+{
+    std::vector<uint8_t> out(RG_OTA_HEADER_SIZE);
+    std::vector<int64_t> last(1 << 16, -1);
+    const size_t window = (size_t)1 << window_bits, max_len = (size_t)1 << lookahead_bits;
+    uint64_t acc = 0;
+    int bits = 0;
+    auto put = [&](uint32_t value, int n) {
+        acc = (acc << n) | value;
+        bits += n;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back((uint8_t)(acc >> bits));
+        }
+    };
+    auto hash = [&](size_t i) { return (in[i] * 2654435761u ^ in[i + 1] << 8 ^ in[i + 2]) & 0xFFFF; };
+    for (size_t i = 0; i < in.size();) {
+        size_t len = 0, dist = 0;
+        if (i + 3 <= in.size()) {
+            int64_t pos = last[hash(i)];
+            if (pos >= 0 && i - pos <= window) {
+                while (len < max_len && i + len < in.size() && in[pos + len] == in[i + len]) {
+                    len++;
+                }
+                dist = i - pos;
+            }
+        }
+        size_t step = len >= 3 ? len : 1;
+        if (len >= 3) {
+            put(0, 1);
+            put((uint32_t)(dist - 1), window_bits);
+            put((uint32_t)(len - 1), lookahead_bits);
+        } else {
+            put(0x100 | in[i], 9);
+        }
+        for (size_t j = i; j < i + step && j + 3 <= in.size(); j++) {
+            last[hash(j)] = (int64_t)j;
+        }
+        i += step;
+    }
+    if (bits > 0) {
+        out.push_back((uint8_t)(acc << (8 - bits)));
+    }
+    uint32_t fields[3] = {(uint32_t)in.size(), (uint32_t)(out.size() - RG_OTA_HEADER_SIZE),
+                          rg_ota_crc32(0, in.data(), in.size())};
+    memcpy(out.data(), "RGZ1", 4);
+    out[4] = (uint8_t)window_bits;
+    out[5] = (uint8_t)lookahead_bits;
+    out[6] = out[7] = 0;
+    memcpy(out.data() + 8, fields, sizeof(fields)); // Little-endian host
+    return out;
+}
+
+std::vector<metric_t> ota_metrics(uint64_t)
+{
+    return {
+        {"image_bytes", (double)s_ota_image.size()},
+        {"download_bytes", (double)s_ota_stream.bytes_in},
+        {"ratio", (double)s_ota_stream.bytes_in / s_ota_image.size()},
+    };
+}
+
+// One whole image, fed in TCP-segment-sized pieces as the download task would
+void ota_unpack(const std::vector<uint8_t> &download)
+{
+    rg_ota_stream_init(&s_ota_stream, ota_sink, nullptr);
+    for (size_t pos = 0; pos < download.size(); pos += 1460) {
+        rg_ota_stream_feed(&s_ota_stream, download.data() + pos, std::min<size_t>(1460, download.size() - pos));
+    }
+    if (rg_ota_stream_finish(&s_ota_stream) != ESP_OK) {
+        fprintf(stderr, "rg_bench: OTA image did not unpack\n");
+        exit(1);
+    }
+}
+
+void bench_ota()
+{
+    FILE *f = fopen("/proc/self/exe", "rb");
+    if (!f) {
+        return;
+    }
+    uint8_t buf[65536];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) {
+        s_ota_image.insert(s_ota_image.end(), buf, buf + n);
+    }
+    fclose(f);
+    s_ota_image[0] = 0xE9; // Looks like an app image, so it is passed through as one
+
+    run("ota.unpack_plain", ota_metrics, [] { ota_unpack(s_ota_image); });
+    s_ota_packed = ota_pack(s_ota_image, 12, 5);
+    run("ota.unpack_w12_l5", ota_metrics, [] { ota_unpack(s_ota_packed); });
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            s_quick = true;
+        } else {
+            s_filter = argv[i];
+        }
+    }
+    const char *revision = getenv("RG_BENCH_REVISION");
+    if (revision && *revision) {
+        s_revision = revision;
+    }
+
+    bench_sensor();
+    bench_filters();
+    bench_codec();
+    bench_serialization();
+    bench_handlers();
+    bench_events();
+    bench_stats();
+    bench_rules();
+    bench_log();
+    bench_mqtt();
+    bench_ota();
+    return 0;
+}
@@ -0,0 +1,875 @@
+// host/fleet/rg_fleet.cpp
+// Fleet simulator for the host build: N virtual nodes on this machine, each
+// serving the firmware's routes on its own local port, and a load generator
+// that polls them the way dashboards and a metrics backend do.
+//
+// Every node is a process of its own, because the firmware keeps its data
+// (shared_data, history, stats, the HTTP server) in globals, as a node does.
+// A node runs the sensor task's data path on a simulated BME280 (filters,
+// stats and sampler, then the HTTP and history consumers, called in line
+// instead of through the event bus) and a socket front end that hands each request to
+// rg_http_handle_request() through the host httpd model. Like the device it
+// is one server loop with CONFIG_RG_HTTP_MAX_SOCKETS connections that keeps a
+// slot free by closing the idlest keep-alive connection. Event streams are not carried: /events answers 501, and dashboards
+// poll /data as index.html does when its stream is refused.
+//
+// Each dashboard keeps one keep-alive connection and fetches, from a random
+// phase: the page (then revalidated with its ETag), /data, /stats and
+// /history; each node also gets a /metrics scrape. Latency runs from the
+// moment a request was due to the end of its response, so a slow node is
+// charged for the requests queued behind it.
+//
+// One JSON object per line on stdout, in the same shape as rg_bench: one per
+// node (throughput, p50/p99 latency, resident memory), one per path and one
+// for the whole fleet. Exits non-zero if a node died, a request failed or none
+// completed.
+//
+//   rg_fleet [--nodes 16] [--dashboards 4] [--duration 30] [--speedup 1] [--port 0]
+//
+//   --speedup   polls and samples that many times faster than real time
+//   --port      first port of the nodes; 0 takes any free ports
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rg_httpd_host.h"
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+#include "services/history/rg_history.h"
+#include "services/pipeline/rg_pipeline.h"
+#include "services/rg_http_server.h"
+#include "services/shared_data/shared_data.h"
+#include "services/sse/rg_sse.h"
+#include "services/stats/rg_stats.h"
+
+namespace {
+
+#ifndef RG_FLEET_REVISION
+#define RG_FLEET_REVISION "unknown"
+#endif
+
+const char *s_revision = RG_FLEET_REVISION;
+int s_nodes = 16;
+int s_dashboards = 4;
+double s_duration_s = 30;
+double s_speedup = 1;
+int s_port = 0;
+
+constexpr size_t MAX_REQUEST_HEAD = 4096;
+constexpr size_t MAX_REQUEST_BODY = 16384;
+constexpr int64_t REQUEST_TIMEOUT_MS = 10000;
+
+int64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Value of header @p name in the "Name: value\r\n" lines of @p head, or ""
+std::string header_value(const std::string &head, const char *name)
+{
+    const size_t len = strlen(name);
+    for (size_t pos = 0; pos < head.size();) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos) {
+            end = head.size();
+        }
+        if (end - pos > len && head[pos + len] == ':' && strncasecmp(&head[pos], name, len) == 0) {
+            size_t start = pos + len + 1;
+            while (start < end && head[start] == ' ') {
+                start++;
+            }
+            return head.substr(start, end - start);
+        }
+        pos = end + 2;
+    }
+    return "";
+}
+
+// --- Node ---------------------------------------------------------------------
+
+const char *reason(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Internal Server Error";
+    }
+}
+
+struct connection_t {
+    int fd;
+    int session; // Socket fd of the httpd model
+    std::string in;
+    std::string out;
+    int64_t last_used_us;
+    bool closing; // Close once out is sent
+};
+
+void respond(connection_t &c, int status, const char *headers, const char *body, size_t body_len)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", status, reason(status));
+    c.out += line;
+    c.out += headers;
+    snprintf(line, sizeof(line), "Content-Length: %zu\r\n%s\r\n", body_len, c.closing ? "Connection: close\r\n" : "");
+    c.out += line;
+    c.out.append(body, body_len);
+}
+
+// Runs every complete request in c.in through the firmware's handler
+void serve_requests(connection_t &c)
+{
+    while (!c.closing) {
+        const size_t head_end = c.in.find("\r\n\r\n");
+        if (head_end == std::string::npos) {
+            if (c.in.size() > MAX_REQUEST_HEAD) {
+                c.closing = true;
+                respond(c, 400, "Content-Type: text/plain\r\n", "", 0);
+            }
+            return;
+        }
+        const size_t line_end = c.in.find("\r\n");
+        const std::string line = c.in.substr(0, line_end);
+        const std::string headers = c.in.substr(line_end + 2, head_end + 2 - (line_end + 2));
+        const size_t body_len = strtoul(header_value(headers, "Content-Length").c_str(), nullptr, 10);
+        if (body_len > MAX_REQUEST_BODY) {
+            c.closing = true;
+            respond(c, 413, "Content-Type: text/plain\r\n", "", 0);
+            return;
+        }
+        if (c.in.size() < head_end + 4 + body_len) {
+            return;
+        }
+        const std::string body = c.in.substr(head_end + 4, body_len);
+        c.in.erase(0, head_end + 4 + body_len);
+        c.closing = strcasecmp(header_value(headers, "Connection").c_str(), "close") == 0;
+
+        const size_t sp1 = line.find(' ');
+        const size_t sp2 = line.find(' ', sp1 + 1);
+        const std::string method = line.substr(0, sp1);
+        const std::string uri = sp1 == std::string::npos ? "" : line.substr(sp1 + 1, sp2 - sp1 - 1);
+        if (uri.empty() || uri.size() > HTTPD_MAX_URI_LEN) {
+            c.closing = true;
+            respond(c, 400, "Content-Type: text/plain\r\n", "", 0);
+            return;
+        }
+        if (uri.compare(0, 7, "/events") == 0) {
+            static const char msg[] = "Event streams are not simulated";
+            respond(c, 501, "Content-Type: text/plain\r\n", msg, sizeof(msg) - 1);
+            continue;
+        }
+        const int m = method == "GET" ? HTTP_GET : method == "POST" ? HTTP_POST : -1;
+        if (m < 0) {
+            respond(c, 405, "Content-Type: text/plain\r\n", "", 0);
+            continue;
+        }
+        rg_httpd_host_response_t resp;
+        esp_err_t err = rg_httpd_host_request_body(c.session, m, uri.c_str(), headers.c_str(),
+                                                   m == HTTP_POST ? body.c_str() : nullptr, rg_http_handle_request,
+                                                   &resp);
+        // A handler that fails ends the session, as on the server
+        if (err != ESP_OK) {
+            c.closing = true;
+        }
+        respond(c, resp.status, resp.headers, resp.body, resp.body_len);
+    }
+}
+
+void close_connection(std::vector<connection_t> &conns, size_t i)
+{
+    close(conns[i].fd);
+    rg_httpd_host_close(conns[i].session);
+    conns.erase(conns.begin() + (long)i);
+}
+
+// A day-like trace on the simulated part: a 20-minute HVAC cycle of about
+// 1 degC and 1 %RH, a slow pressure drift and some noise, phased per node
+double noise(uint32_t &rng)
+{
+    rng = rng * 1664525u + 1013904223u;
+    return (rng >> 8) / 16777216.0 - 0.5;
+}
+
+void set_adc(rg_bme280_sim_t *sim, int index, double sim_s, uint32_t &rng)
+{
+    const double phase = index * 0.7;
+    const double hvac = sin(2 * M_PI * sim_s / 1200 + phase);
+    sim->adc.adc_T = rg_bme280_sim_reference_raw.adc_T + (int32_t)lround(3000 * hvac + 20 * noise(rng));
+    sim->adc.adc_H = rg_bme280_sim_reference_raw.adc_H - (int32_t)lround(150 * hvac + 10 * noise(rng));
+    sim->adc.adc_P = rg_bme280_sim_reference_raw.adc_P -
+                     (int32_t)lround(200 * sin(2 * M_PI * sim_s / 7200 + phase) + 8 * noise(rng));
+}
+
+// The device's log and HTTP consumers, run inline: every reading goes to the
+// history, published samples to /data and the event streams
+void node_publish(void *ctx, const rg_event_t *event)
+{
+    const rg_event_sample_t &s = event->sample;
+    if (event->type == RG_EVENT_READING) {
+        rg_history_add(s.timestamp, s.temperature, s.humidity, s.pressure);
+    } else if (event->type == RG_EVENT_SAMPLE) {
+        shared_data_publish(s.temperature, s.humidity, s.pressure, now_us());
+        rg_sse_notify();
+    }
+}
+
+[[noreturn]] void node_main(int index, int listen_fd)
+{
+#ifdef __linux__
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+    rg_bme280_sim_t sim;
+    rg_bme280_t sensor;
+    rg_bme280_sim_init(&sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_bus_t bus = rg_bme280_sim_bus(&sim);
+    rg_stats_channel_config_t stats_config[RG_STATS_CHANNEL_COUNT];
+    if (rg_bme280_init_with_bus(&sensor, &bus) != ESP_OK || rg_stats_default_config(stats_config) != ESP_OK ||
+        rg_stats_configure(stats_config) != ESP_OK) {
+        fprintf(stderr, "rg_fleet: node %d did not start\n", index);
+        _exit(1);
+    }
+    shared_data_set_ip_address("127.0.0.1");
+
+    rg_sampler_config_t sampler_config;
+    rg_sampler_default_config(&sampler_config);
+    const rg_pipeline_port_t port = {nullptr, node_publish, nullptr};
+    rg_pipeline_init(&sampler_config, &port);
+    uint32_t rng = 7919u * (uint32_t)(index + 1);
+
+    std::vector<connection_t> conns;
+    std::vector<struct pollfd> pfds;
+    const int64_t start_us = now_us();
+    int64_t next_sample_us = start_us;
+    for (;;) {
+        int64_t now = now_us();
+        if (now >= next_sample_us) {
+            // The sensor task's loop body, on simulated time
+            const uint32_t sim_ms = (uint32_t)((now - start_us) * s_speedup / 1000);
+            set_adc(&sim, index, sim_ms / 1000.0, rng);
+            rg_bme280_values_t v;
+            if (rg_bme280_read_values(&sensor, &v) == ESP_OK) {
+                rg_pipeline_process((int64_t)sim_ms * 1000, rg_history_now(), v.temperature, v.humidity, v.pressure,
+                                    nullptr);
+            }
+            next_sample_us = now + (int64_t)(rg_pipeline_next_interval_ms() * 1000 / s_speedup);
+        }
+
+        pfds.clear();
+        pfds.push_back({listen_fd, POLLIN, 0});
+        for (const connection_t &c : conns) {
+            pfds.push_back({c.fd, (short)(c.out.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+        }
+        const int64_t wait_ms = std::max<int64_t>(0, (next_sample_us - now + 999) / 1000);
+        if (poll(pfds.data(), pfds.size(), (int)std::min<int64_t>(wait_ms, 1000)) < 0 && errno != EINTR) {
+            _exit(1);
+        }
+        now = now_us();
+
+        // Walk backwards so closing a connection keeps the indices below valid
+        for (size_t i = conns.size(); i-- > 0;) {
+            connection_t &c = conns[i];
+            const short revents = pfds[i + 1].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                char buf[4096];
+                ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                    close_connection(conns, i);
+                    continue;
+                }
+                if (n > 0) {
+                    c.in.append(buf, (size_t)n);
+                    c.last_used_us = now;
+                    serve_requests(c);
+                }
+            }
+            if (!c.out.empty()) {
+                ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    close_connection(conns, i);
+                    continue;
+                }
+                if (n > 0) {
+                    c.out.erase(0, (size_t)n);
+                }
+            }
+            if (c.closing && c.out.empty()) {
+                close_connection(conns, i);
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+                set_nonblocking(fd);
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                if (conns.size() >= CONFIG_RG_HTTP_MAX_SOCKETS) {
+                    close(fd); // Every slot is taken: refused, as the device does
+                    continue;
+                }
+                const int session = rg_httpd_host_open();
+                if (session < 0) {
+                    close(fd);
+                    continue;
+                }
+                conns.push_back({fd, session, std::string(), std::string(), now, false});
+                // The server's keep_a_socket_free(): once the last slot is taken,
+                // the connection idle the longest makes room for the next client
+                if (conns.size() >= CONFIG_RG_HTTP_MAX_SOCKETS) {
+                    size_t idlest = 0;
+                    for (size_t i = 1; i + 1 < conns.size(); i++) {
+                        if (conns[i].last_used_us < conns[idlest].last_used_us) {
+                            idlest = i;
+                        }
+                    }
+                    close_connection(conns, idlest);
+                }
+            }
+        }
+        rg_httpd_host_poll();
+    }
+}
+
+// --- Load generator -------------------------------------------------------------
+
+struct poll_def_t {
+    const char *path;
+    double period_s;
+};
+
+// What one open dashboard fetches, and how often
+const poll_def_t s_dashboard_polls[] = {
+    {"/", 300},                    // Page reloads, revalidated with the ETag after the first
+    {"/data", 5},                  // index.html's polling
+    {"/stats", 30},
+    {"/history?tier=minute", 60},  // Trend chart
+};
+// The backend's scrape of every node
+const poll_def_t s_scrape_polls[] = {
+    {"/metrics", 15},
+};
+const char *const s_paths[] = {"/", "/data", "/stats", "/history?tier=minute", "/metrics"};
+constexpr size_t PATH_COUNT = sizeof(s_paths) / sizeof(s_paths[0]);
+
+size_t path_index(const char *path)
+{
+    for (size_t i = 0; i < PATH_COUNT; i++) {
+        if (strcmp(s_paths[i], path) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+struct counters_t {
+    uint64_t bytes = 0;
+    uint64_t errors = 0;      // Requests that failed or timed out
+    uint64_t http_errors = 0; // Responses with status >= 400
+    uint64_t reconnects = 0;  // Keep-alive connections the node closed to keep a slot free
+};
+
+struct schedule_t {
+    size_t path;
+    int64_t period_us;
+    int64_t due_us;
+};
+
+enum class state_t { IDLE, CONNECTING, SENDING, RECEIVING };
+
+struct client_t {
+    int node;
+    uint16_t port;
+    std::vector<schedule_t> schedule;
+    std::string etag;
+    int fd = -1;
+    state_t state = state_t::IDLE;
+    bool reused = false; // The connection already carried a response
+    size_t current = 0;  // Index in schedule of the request in flight
+    std::string out;
+    std::string in;
+    // Latency in ms per path index
+    std::vector<float> latencies[PATH_COUNT];
+    counters_t counters;
+};
+
+void client_close(client_t &c)
+{
+    if (c.fd >= 0) {
+        close(c.fd);
+    }
+    c.fd = -1;
+    c.reused = false;
+    c.state = state_t::IDLE;
+}
+
+void client_fail(client_t &c, int64_t now)
+{
+    c.counters.errors++;
+    client_close(c);
+    schedule_t &s = c.schedule[c.current];
+    s.due_us = std::max(s.due_us + s.period_us, now);
+}
+
+void client_connect(client_t &c)
+{
+    c.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c.fd < 0) {
+        client_fail(c, now_us());
+        return;
+    }
+    set_nonblocking(c.fd);
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(c.port);
+    c.in.clear();
+    if (connect(c.fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        c.state = state_t::SENDING;
+    } else if (errno == EINPROGRESS) {
+        c.state = state_t::CONNECTING;
+    } else {
+        client_fail(c, now_us());
+    }
+}
+
+void client_start(client_t &c, size_t which)
+{
+    c.current = which;
+    const char *path = s_paths[c.schedule[which].path];
+    c.out = std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+    if (c.schedule[which].path == 0 && !c.etag.empty()) {
+        c.out += "If-None-Match: " + c.etag + "\r\n";
+    }
+    c.out += "\r\n";
+    c.in.clear();
+    if (c.fd < 0) {
+        client_connect(c);
+    } else {
+        c.state = state_t::SENDING;
+    }
+}
+
+// Parses c.in; true once the whole response is there
+bool client_response_done(client_t &c, int64_t now)
+{
+    const size_t head_end = c.in.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        return false;
+    }
+    const std::string head = c.in.substr(0, head_end + 2);
+    const size_t length = strtoul(header_value(head, "Content-Length").c_str(), nullptr, 10);
+    if (c.in.size() < head_end + 4 + length) {
+        return false;
+    }
+    const int status = atoi(head.c_str() + head.find(' ') + 1);
+    schedule_t &s = c.schedule[c.current];
+    c.latencies[s.path].push_back((float)(now - s.due_us) / 1000.0f);
+    c.counters.bytes += length;
+    if (status >= 400) {
+        c.counters.http_errors++;
+    }
+    if (s.path == 0 && status == 200) {
+        c.etag = header_value(head, "ETag");
+    }
+    // A browser keeps its interval; a late response delays only the one after it
+    s.due_us = std::max(s.due_us + s.period_us, now);
+    c.state = state_t::IDLE;
+    c.reused = true;
+    if (strcasecmp(header_value(head, "Connection").c_str(), "close") == 0) {
+        client_close(c);
+    }
+    return true;
+}
+
+void client_event(client_t &c, short revents, int64_t now)
+{
+    if (c.state == state_t::CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            client_fail(c, now);
+            return;
+        }
+        c.state = state_t::SENDING;
+    }
+    if (c.state == state_t::SENDING) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            // Closed by the node before this request went out; retry on a new connection
+            if (c.reused) {
+                c.counters.reconnects++;
+                client_close(c);
+                client_start(c, c.current);
+            } else {
+                client_fail(c, now);
+            }
+            return;
+        }
+        if (n > 0) {
+            c.out.erase(0, (size_t)n);
+        }
+        if (c.out.empty()) {
+            c.state = state_t::RECEIVING;
+        }
+        return;
+    }
+    if (c.state == state_t::RECEIVING && (revents & (POLLIN | POLLHUP | POLLERR))) {
+        char buf[16384];
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c.in.append(buf, (size_t)n);
+            client_response_done(c, now);
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // A reused connection closed before any response: the node purged it
+            if (c.reused && c.in.empty()) {
+                c.counters.reconnects++;
+                client_close(c);
+                client_start(c, c.current);
+            } else {
+                client_fail(c, now);
+            }
+        }
+    }
+}
+
+void run_clients(std::vector<client_t> *clients, int64_t deadline_us)
+{
+    std::vector<struct pollfd> pfds;
+    std::vector<client_t *> polled;
+    for (;;) {
+        int64_t now = now_us();
+        if (now >= deadline_us) {
+            break;
+        }
+        int64_t next_us = deadline_us;
+        pfds.clear();
+        polled.clear();
+        for (client_t &c : *clients) {
+            if (c.state == state_t::IDLE) {
+                size_t which = 0;
+                for (size_t i = 1; i < c.schedule.size(); i++) {
+                    if (c.schedule[i].due_us < c.schedule[which].due_us) {
+                        which = i;
+                    }
+                }
+                if (c.schedule[which].due_us > now) {
+                    next_us = std::min(next_us, c.schedule[which].due_us);
+                    continue;
+                }
+                client_start(c, which);
+                if (c.state == state_t::IDLE) {
+                    continue;
+                }
+            }
+            if (now - c.schedule[c.current].due_us > REQUEST_TIMEOUT_MS * 1000) {
+                client_fail(c, now);
+                continue;
+            }
+            pfds.push_back({c.fd, (short)(c.state == state_t::RECEIVING ? POLLIN : POLLOUT), 0});
+            polled.push_back(&c);
+        }
+        const int64_t wait_ms = (next_us - now + 999) / 1000;
+        if (poll(pfds.data(), pfds.size(), (int)std::min<int64_t>(wait_ms, 100)) <= 0) {
+            continue;
+        }
+        now = now_us();
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (pfds[i].revents) {
+                client_event(*polled[i], pfds[i].revents, now);
+            }
+        }
+    }
+    for (client_t &c : *clients) {
+        client_close(c);
+    }
+}
+
+// --- Report ---------------------------------------------------------------------
+
+struct summary_t {
+    std::vector<float> latencies;
+    counters_t counters;
+
+    void add(const client_t &c, size_t path)
+    {
+        latencies.insert(latencies.end(), c.latencies[path].begin(), c.latencies[path].end());
+    }
+
+    void add_counters(const client_t &c)
+    {
+        counters.bytes += c.counters.bytes;
+        counters.errors += c.counters.errors;
+        counters.http_errors += c.counters.http_errors;
+        counters.reconnects += c.counters.reconnects;
+    }
+};
+
+double percentile(const std::vector<float> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * p))];
+}
+
+void print_summary(summary_t &s, double elapsed_s, bool with_counters)
+{
+    std::sort(s.latencies.begin(), s.latencies.end());
+    printf(",\"requests\":%zu,\"requests_per_s\":%.1f,\"p50_ms\":%.2f,\"p99_ms\":%.2f,\"max_ms\":%.2f",
+           s.latencies.size(), s.latencies.size() / elapsed_s, percentile(s.latencies, 0.50),
+           percentile(s.latencies, 0.99), s.latencies.empty() ? 0.0 : s.latencies.back());
+    if (with_counters) {
+        printf(",\"errors\":%llu,\"http_errors\":%llu,\"reconnects\":%llu,\"bytes_per_request\":%.0f",
+               (unsigned long long)s.counters.errors, (unsigned long long)s.counters.http_errors,
+               (unsigned long long)s.counters.reconnects,
+               (double)s.counters.bytes / std::max<size_t>(1, s.latencies.size()));
+    }
+}
+
+// Resident and peak resident set of @p pid in KiB, from /proc
+void node_memory(pid_t pid, long *rss_kb, long *peak_kb)
+{
+    *rss_kb = *peak_kb = 0;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        sscanf(line, "VmRSS: %ld", rss_kb);
+        sscanf(line, "VmHWM: %ld", peak_kb);
+    }
+    fclose(f);
+}
+
+bool parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (strcmp(arg, "--nodes") == 0) {
+            s_nodes = atoi(value);
+        } else if (strcmp(arg, "--dashboards") == 0) {
+            s_dashboards = atoi(value);
+        } else if (strcmp(arg, "--duration") == 0) {
+            s_duration_s = atof(value);
+        } else if (strcmp(arg, "--speedup") == 0) {
+            s_speedup = atof(value);
+        } else if (strcmp(arg, "--port") == 0) {
+            s_port = atoi(value);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return s_nodes > 0 && s_dashboards >= 0 && s_duration_s > 0 && s_speedup > 0 && s_port >= 0 &&
+           s_port + s_nodes <= 65536;
+}
+
+int listen_on(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        close(fd);
+        return -1;
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (!parse_args(argc, argv)) {
+        fprintf(stderr, "usage: rg_fleet [--nodes N] [--dashboards N] [--duration S] [--speedup F] [--port P]\n");
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    // One socket per dashboard and scraper, plus the listeners
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // Bound before forking, so every node is reachable once its process runs
+    std::vector<int> listeners(s_nodes);
+    std::vector<uint16_t> ports(s_nodes);
+    for (int i = 0; i < s_nodes; i++) {
+        listeners[i] = listen_on(s_port ? s_port + i : 0);
+        struct sockaddr_in addr = {};
+        socklen_t len = sizeof(addr);
+        if (listeners[i] < 0 || getsockname(listeners[i], (struct sockaddr *)&addr, &len) != 0) {
+            fprintf(stderr, "rg_fleet: cannot listen on port %d: %s\n", s_port ? s_port + i : 0, strerror(errno));
+            return 1;
+        }
+        ports[i] = ntohs(addr.sin_port);
+    }
+    fflush(stdout);
+    std::vector<pid_t> pids(s_nodes);
+    for (int i = 0; i < s_nodes; i++) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            fprintf(stderr, "rg_fleet: fork failed: %s\n", strerror(errno));
+            for (int j = 0; j < i; j++) {
+                kill(pids[j], SIGKILL);
+            }
+            return 1;
+        }
+        if (pids[i] == 0) {
+            for (int j = 0; j < s_nodes; j++) {
+                if (j != i) {
+                    close(listeners[j]);
+                }
+            }
+            node_main(i, listeners[i]);
+        }
+    }
+    for (int fd : listeners) {
+        close(fd);
+    }
+
+    // Dashboards and scrapers, spread over the loader threads, each starting at a random phase
+    const unsigned thread_count =
+        std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned)(s_nodes * (s_dashboards + 1))));
+    std::vector<std::vector<client_t>> groups(thread_count);
+    uint32_t rng = 1;
+    auto random_fraction = [&rng]() {
+        rng = rng * 1664525u + 1013904223u;
+        return (rng >> 8) / 16777216.0;
+    };
+    const int64_t start_us = now_us();
+    size_t next_group = 0;
+    for (int node = 0; node < s_nodes; node++) {
+        for (int d = 0; d <= s_dashboards; d++) {
+            client_t c;
+            c.node = node;
+            c.port = ports[node];
+            const bool scraper = d == s_dashboards;
+            const poll_def_t *polls = scraper ? s_scrape_polls : s_dashboard_polls;
+            const size_t count = scraper ? sizeof(s_scrape_polls) / sizeof(s_scrape_polls[0])
+                                         : sizeof(s_dashboard_polls) / sizeof(s_dashboard_polls[0]);
+            // A dashboard loads the page first, then polls from there
+            const int64_t open_us = start_us + (int64_t)(random_fraction() * 5e6 / s_speedup);
+            for (size_t p = 0; p < count; p++) {
+                const int64_t period_us = (int64_t)(polls[p].period_s * 1e6 / s_speedup);
+                const int64_t offset_us = (scraper || p > 0) ? (int64_t)(random_fraction() * period_us) : 0;
+                c.schedule.push_back({path_index(polls[p].path), period_us, open_us + offset_us});
+            }
+            groups[next_group++ % thread_count].push_back(std::move(c));
+        }
+    }
+
+    const int64_t deadline_us = start_us + (int64_t)(s_duration_s * 1e6);
+    std::vector<std::thread> threads;
+    for (auto &group : groups) {
+        threads.emplace_back(run_clients, &group, deadline_us);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    const double elapsed_s = (now_us() - start_us) / 1e6;
+
+    std::vector<summary_t> per_node(s_nodes);
+    summary_t per_path[PATH_COUNT];
+    summary_t fleet;
+    for (const auto &group : groups) {
+        for (const client_t &c : group) {
+            for (size_t p = 0; p < PATH_COUNT; p++) {
+                per_node[c.node].add(c, p);
+                per_path[p].add(c, p);
+                fleet.add(c, p);
+            }
+            per_node[c.node].add_counters(c);
+            fleet.add_counters(c);
+        }
+    }
+
+    int dead = 0;
+    long rss_total = 0;
+    long rss_max = 0;
+    for (int i = 0; i < s_nodes; i++) {
+        long rss_kb, peak_kb;
+        node_memory(pids[i], &rss_kb, &peak_kb);
+        int status;
+        const bool alive = waitpid(pids[i], &status, WNOHANG) == 0;
+        dead += !alive;
+        rss_total += rss_kb;
+        rss_max = std::max(rss_max, rss_kb);
+        printf("{\"bench\":\"fleet.node\",\"rev\":\"%s\",\"node\":%d,\"port\":%u", s_revision, i, ports[i]);
+        print_summary(per_node[i], elapsed_s, true);
+        printf(",\"rss_kb\":%ld,\"peak_rss_kb\":%ld,\"alive\":%s}\n", rss_kb, peak_kb, alive ? "true" : "false");
+    }
+    for (size_t p = 0; p < PATH_COUNT; p++) {
+        printf("{\"bench\":\"fleet.path\",\"rev\":\"%s\",\"path\":\"%s\"", s_revision, s_paths[p]);
+        print_summary(per_path[p], elapsed_s, false);
+        printf("}\n");
+    }
+    printf("{\"bench\":\"fleet\",\"rev\":\"%s\",\"nodes\":%d,\"dashboards_per_node\":%d,\"speedup\":%g",
+           s_revision, s_nodes, s_dashboards, s_speedup);
+    print_summary(fleet, elapsed_s, true);
+    printf(",\"rss_kb_mean\":%ld,\"rss_kb_max\":%ld,\"dead_nodes\":%d}\n", rss_total / s_nodes, rss_max, dead);
+    fflush(stdout);
+
+    for (pid_t pid : pids) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    return dead == 0 && fleet.counters.errors == 0 && !fleet.latencies.empty() ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Writes an sdkconfig.h with the default of every option in main/Kconfig.
+
+Host builds have no menuconfig; this keeps their CONFIG_ values in step with
+the Kconfig defaults. Options whose default depends on a condition take the
+first unconditional default; in a choice, the default entry is set.
+NAME=VALUE arguments after the paths override single options.
+"""
+import re
+import sys
+
+
+def parse(path):
+    options = []
+    name = kind = default = None
+    in_choice = False
+    choice_default = None
+    for line in open(path, encoding="utf-8"):
+        line = line.strip()
+        m = re.match(r"(choice|endchoice)\b", line)
+        if m:
+            if name:
+                options.append((name, kind, default))
+            name = None
+            in_choice = m.group(1) == "choice"
+            choice_default = None
+            continue
+        if in_choice and name is None:
+            m = re.match(r"default\s+(\w+)$", line)
+            if m:
+                choice_default = m.group(1)
+        m = re.match(r"config\s+(\w+)$", line)
+        if m:
+            if name:
+                options.append((name, kind, default))
+            name, kind, default = m.group(1), None, None
+            if in_choice:
+                default = "y" if name == choice_default else "n"
+            continue
+        if name is None:
+            continue
+        m = re.match(r"(bool|int|hex|string)\b", line)
+        if m and kind is None:
+            kind = m.group(1)
+            continue
+        m = re.match(r"default\s+(.+?)(\s+if\s+.*)?$", line)
+        if m and default is None and not m.group(2):
+            default = m.group(1)
+    if name:
+        options.append((name, kind, default))
+    return options
+
+
+def main():
+    kconfig, out = sys.argv[1], sys.argv[2]
+    overrides = dict(arg.split("=", 1) for arg in sys.argv[3:])
+    lines = ["// Generated by host/gen_sdkconfig.py from main/Kconfig defaults. Do not edit.", "#pragma once", ""]
+    for name, kind, default in parse(kconfig):
+        default = overrides.get(name, default)
+        if kind == "bool":
+            if default == "y":
+                lines.append(f"#define CONFIG_{name} 1")
+        elif default is not None:
+            lines.append(f"#define CONFIG_{name} {default}")
+    lines.append("")
+    with open(out, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
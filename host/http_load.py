@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+# Load test for the node's HTTP server: N concurrent keep-alive clients
+# request the given paths for a while; prints one JSON line per client count,
+# in the same shape as rg_bench, with requests/s and latency percentiles.
+#
+#   python3 host/http_load.py http://192.168.1.50
+#   python3 host/http_load.py http://192.168.1.50 --paths /data,/history?tier=raw --clients 1,8,32 --duration 20
+#
+# Only the standard library is needed. Each client keeps its connection open
+# and reconnects when the server closes it; with more clients than the server
+# has sockets, its LRU purge shows up as "reconnects".
+import argparse
+import asyncio
+import json
+import sys
+import time
+from urllib.parse import urlsplit
+
+
+async def read_response(reader):
+    """Reads one response; returns (status, body bytes, keep-alive)."""
+    status_line = await reader.readline()
+    if not status_line:
+        raise ConnectionError('connection closed')
+    status = int(status_line.split()[1])
+    headers = {}
+    while True:
+        line = await reader.readline()
+        if line in (b'\r\n', b'\n', b''):
+            break
+        name, _, value = line.decode('latin-1').partition(':')
+        headers[name.strip().lower()] = value.strip()
+
+    if headers.get('transfer-encoding', '').lower() == 'chunked':
+        size = 0
+        while True:
+            chunk_len = int((await reader.readline()).split(b';')[0], 16)
+            if chunk_len == 0:
+                await reader.readline()
+                break
+            size += len(await reader.readexactly(chunk_len))
+            await reader.readline()
+    elif 'content-length' in headers:
+        size = len(await reader.readexactly(int(headers['content-length'])))
+    else:
+        size = len(await reader.read())
+        return status, size, False
+    return status, size, headers.get('connection', '').lower() != 'close'
+
+
+async def client(host, port, paths, deadline, latencies, counters):
+    reader = writer = None
+    i = 0
+    while time.monotonic() < deadline:
+        if writer is None:
+            try:
+                reader, writer = await asyncio.open_connection(host, port)
+            except OSError:
+                counters['errors'] += 1
+                await asyncio.sleep(0.05)
+                continue
+            counters['connections'] += 1
+        path = paths[i % len(paths)]
+        i += 1
+        start = time.perf_counter()
+        try:
+            writer.write(('GET %s HTTP/1.1\r\nHost: %s\r\n\r\n' % (path, host)).encode())
+            status, size, keep_alive = await read_response(reader)
+        except (OSError, ConnectionError, asyncio.IncompleteReadError, ValueError, IndexError):
+            counters['errors'] += 1
+            writer.close()
+            writer = None
+            continue
+        latencies.append(time.perf_counter() - start)
+        counters['bytes'] += size
+        if status >= 400:
+            counters['http_errors'] += 1
+        if not keep_alive:
+            writer.close()
+            writer = None
+    if writer is not None:
+        writer.close()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * p))]
+
+
+async def run(host, port, paths, clients, duration):
+    latencies = []
+    counters = {'connections': 0, 'errors': 0, 'http_errors': 0, 'bytes': 0}
+    start = time.monotonic()
+    deadline = start + duration
+    await asyncio.gather(*(client(host, port, paths, deadline, latencies, counters) for _ in range(clients)))
+    elapsed = time.monotonic() - start
+    latencies.sort()
+    return {
+        'bench': 'http_load.c%d' % clients,
+        'paths': ','.join(paths),
+        'clients': clients,
+        'requests': len(latencies),
+        'requests_per_s': round(len(latencies) / elapsed, 1),
+        'p50_ms': round(percentile(latencies, 0.50) * 1000, 2),
+        'p99_ms': round(percentile(latencies, 0.99) * 1000, 2),
+        'max_ms': round((latencies[-1] if latencies else 0) * 1000, 2),
+        'reconnects': max(0, counters['connections'] - clients),
+        'errors': counters['errors'],
+        'http_errors': counters['http_errors'],
+        'bytes_per_request': round(counters['bytes'] / max(1, len(latencies))),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Load test for the node HTTP server.')
+    parser.add_argument('url', help='node base URL, e.g. http://192.168.1.50')
+    parser.add_argument('--paths', default='/data', help='comma-separated paths, requested in turn')
+    parser.add_argument('--clients', default='1,8,32', help='comma-separated concurrent client counts')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds per client count')
+    args = parser.parse_args()
+
+    url = urlsplit(args.url)
+    if url.scheme != 'http' or not url.hostname:
+        sys.exit('http_load: expected an http:// URL')
+    paths = [p for p in args.paths.split(',') if p]
+    for clients in (int(c) for c in args.clients.split(',')):
+        result = asyncio.run(run(url.hostname, url.port or 80, paths, clients, args.duration))
+        print(json.dumps(result))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
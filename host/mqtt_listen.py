@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+# Decodes sample batches published by the nodes (JSON or CBOR, see
+# main/communications/rg_mqtt_publisher.h) and prints one line per sample,
+# with running totals per node.
+#
+# Against a local broker, without extra Python packages:
+#
+#   mosquitto -v &
+#   mosquitto_sub -t 'rg2/+/samples' -F '%t %x' | python3 host/mqtt_listen.py
+#
+# Each input line is "<topic> <payload as hex>".
+import json
+import sys
+import time
+
+
+def cbor_decode(data, pos=0):
+    """Decodes the CBOR subset the firmware writes: ints, text, arrays, maps."""
+    head = data[pos]
+    major, info = head >> 5, head & 0x1F
+    pos += 1
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        arg = int.from_bytes(data[pos:pos + size], 'big')
+        pos += size
+    else:
+        raise ValueError('unsupported CBOR head 0x%02x' % head)
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 3:
+        return data[pos:pos + arg].decode('utf-8'), pos + arg
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = cbor_decode(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(arg):
+            key, pos = cbor_decode(data, pos)
+            result[key], pos = cbor_decode(data, pos)
+        return result, pos
+    raise ValueError('unsupported CBOR major type %d' % major)
+
+
+def decode(payload):
+    if payload[:1] == b'{':
+        return json.loads(payload)
+    batch, end = cbor_decode(payload)
+    if end != len(payload):
+        raise ValueError('%d trailing bytes' % (len(payload) - end))
+    return batch
+
+
+def main():
+    totals = {}
+    for line in sys.stdin:
+        parts = line.split()
+        if len(parts) != 2:
+            continue
+        topic, payload = parts[0], bytes.fromhex(parts[1])
+        received = time.time()
+        try:
+            batch = decode(payload)
+        except (ValueError, IndexError, UnicodeDecodeError) as err:
+            print('%s: undecodable payload (%s)' % (topic, err), file=sys.stderr)
+            continue
+
+        node = batch['n']
+        ts = batch['t0']
+        for dt, t, h, p in batch['s']:
+            ts += dt
+            wall = received - (batch['now'] - ts)
+            print('%s %s %7.2f degC %6.2f %%RH %7.1f hPa' %
+                  (time.strftime('%H:%M:%S', time.localtime(wall)), node, t / 100, h / 100, p / 10))
+
+        first, messages, samples, size = totals.get(node, (received, 0, 0, 0))
+        totals[node] = (first, messages + 1, samples + len(batch['s']), size + len(payload))
+        _, messages, samples, size = totals[node]
+        hours = max(received - first, 1) / 3600
+        print('# %s: %d messages (%.0f/h), %d samples, %.1f payload bytes/sample' %
+              (node, messages, messages / hours, samples, size / samples), file=sys.stderr)
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+# Compresses an app image for POST /ota (see main/services/ota/rg_ota_stream.h):
+# a 20-byte "RGZ1" header and the image in heatshrink format, which the node
+# decompresses as it downloads, straight into the OTA slot.
+#
+#   python3 host/ota_pack.py build/rg2.bin build/rg2.rgz
+#   python3 host/ota_pack.py build/rg2.bin build/rg2.rgz --window 10 --lookahead 4 --check
+#
+# --check decodes the result again and compares it with the input. Only the
+# standard library is needed.
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b'RGZ1'
+MAX_WINDOW_BITS = 12  # RG_OTA_MAX_WINDOW_BITS on the node
+MAX_CANDIDATES = 64   # Hash chain positions tried per byte
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.bits = 0
+
+    def put(self, value, n):
+        self.acc = (self.acc << n) | value
+        self.bits += n
+        while self.bits >= 8:
+            self.bits -= 8
+            self.out.append((self.acc >> self.bits) & 0xFF)
+        self.acc &= (1 << self.bits) - 1
+
+    def finish(self):
+        if self.bits:
+            self.out.append((self.acc << (8 - self.bits)) & 0xFF)
+            self.bits = 0
+        return bytes(self.out)
+
+
+def compress(data, window_bits, lookahead_bits):
+    """Greedy LZSS in the heatshrink bit format."""
+    window = 1 << window_bits
+    max_len = 1 << lookahead_bits
+    backref_bits = 1 + window_bits + lookahead_bits
+    # Shortest copy that is cheaper than the literals it replaces (9 bits each)
+    min_len = backref_bits // 9 + 1
+    w = BitWriter()
+    chains = {}
+    n = len(data)
+    i = 0
+
+    def remember(pos):
+        if pos + 3 <= n:
+            chains.setdefault(data[pos:pos + 3], []).append(pos)
+
+    while i < n:
+        best_len, best_dist = 0, 0
+        if i + 3 <= n:
+            candidates = chains.get(data[i:i + 3], ())
+            limit = min(max_len, n - i)
+            for pos in reversed(candidates[-MAX_CANDIDATES:]):
+                dist = i - pos
+                if dist > window:
+                    break
+                length = 3
+                while length < limit and data[pos + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, dist
+                    if length == limit:
+                        break
+        if best_len >= max(min_len, 3):
+            w.put(0, 1)
+            w.put(best_dist - 1, window_bits)
+            w.put(best_len - 1, lookahead_bits)
+            for pos in range(i, i + best_len):
+                remember(pos)
+            i += best_len
+        else:
+            w.put(0x100 | data[i], 9)
+            remember(i)
+            i += 1
+    return w.finish()
+
+
+def decompress(payload, size, window_bits, lookahead_bits):
+    """Reference decoder, used by --check."""
+    out = bytearray()
+    acc = bits = pos = 0
+
+    def take(n):
+        nonlocal acc, bits, pos
+        while bits < n:
+            acc = (acc << 8) | payload[pos]
+            pos += 1
+            bits += 8
+        bits -= n
+        return (acc >> bits) & ((1 << n) - 1)
+
+    while len(out) < size:
+        if take(1):
+            out.append(take(8))
+        else:
+            dist = take(window_bits) + 1
+            count = take(lookahead_bits) + 1
+            for _ in range(count):
+                out.append(out[-dist] if dist <= len(out) else 0)
+    return bytes(out[:size])
+
+
+def pack(image, window_bits, lookahead_bits):
+    payload = compress(image, window_bits, lookahead_bits)
+    header = MAGIC + struct.pack('<BBHIII', window_bits, lookahead_bits, 0, len(image), len(payload),
+                                 zlib.crc32(image) & 0xFFFFFFFF)
+    return header + payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compress an app image for the node OTA endpoint.')
+    parser.add_argument('image', help='app image, e.g. build/rg2.bin')
+    parser.add_argument('output', help='compressed image to serve')
+    parser.add_argument('--window', type=int, default=12, help='heatshrink window bits (4..%d)' % MAX_WINDOW_BITS)
+    parser.add_argument('--lookahead', type=int, default=5, help='heatshrink lookahead bits (3..window-1)')
+    parser.add_argument('--check', action='store_true', help='decode the output again and compare')
+    args = parser.parse_args()
+
+    if not 4 <= args.window <= MAX_WINDOW_BITS or not 3 <= args.lookahead < args.window:
+        sys.exit('ota_pack: window must be 4..%d and lookahead 3..window-1' % MAX_WINDOW_BITS)
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    if not image or image[0] != 0xE9:
+        sys.exit('ota_pack: %s is not an app image (no 0xE9 magic)' % args.image)
+
+    packed = pack(image, args.window, args.lookahead)
+    if args.check:
+        payload = packed[20:]
+        if decompress(payload, len(image), args.window, args.lookahead) != image:
+            sys.exit('ota_pack: round trip failed')
+    with open(args.output, 'wb') as f:
+        f.write(packed)
+    print('%s: %d -> %d bytes (%.1f%%), window %d, lookahead %d' %
+          (args.output, len(image), len(packed), 100.0 * len(packed) / len(image), args.window, args.lookahead))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# Measures OTA updates of a node from this machine: serves each image over
+# HTTP, starts the update with POST /ota, follows GET /ota and waits for the
+# node to serve /data again after its restart. Prints one JSON line per
+# image, in the same shape as rg_bench:
+#
+#   python3 host/ota_pack.py build/rg2.bin build/rg2.rgz
+#   python3 host/ota_serve.py http://192.168.1.50 build/rg2.bin build/rg2.rgz
+#
+#   bytes_served   what the node downloaded
+#   update_ms      from POST /ota to the image being written and selected
+#   node_ms        the same, as timed by the node (download, unpack, flash, verify)
+#   online_ms      from POST /ota until /data answers again on the new image
+#
+# Only the standard library is needed. --token passes CONFIG_RG_OTA_TOKEN.
+# A node only takes images it can trust: with --cert and --key they are
+# served over https with the certificate pinned in CONFIG_RG_OTA_SERVER_CERT
+# (issued for this machine's address); plain http works for signed images.
+import argparse
+import http.server
+import json
+import os
+import socket
+import ssl
+import sys
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+
+class CountingHandler(http.server.SimpleHTTPRequestHandler):
+    served = {}
+
+    def copyfile(self, source, outputfile):
+        sent = 0
+        while True:
+            buf = source.read(16384)
+            if not buf:
+                break
+            outputfile.write(buf)
+            sent += len(buf)
+        CountingHandler.served[self.path] = CountingHandler.served.get(self.path, 0) + sent
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def local_address(node_host):
+    """The address of this machine on the node's network."""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((node_host, 80))
+        return s.getsockname()[0]
+
+
+def request(url, method='GET', timeout=2.0, headers=None):
+    req = urllib.request.Request(url, method=method, data=b'' if method == 'POST' else None, headers=headers or {})
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        return resp.status, resp.read()
+
+
+def update(node, image_url, token, timeout):
+    query = {'url': image_url}
+    headers = {'Authorization': 'Bearer ' + token} if token else {}
+    start = time.monotonic()
+    status, _ = request(node + '/ota?' + urllib.parse.urlencode(query), 'POST', headers=headers)
+    if status != 202:
+        raise RuntimeError('POST /ota answered %d' % status)
+
+    state = {}
+    while time.monotonic() - start < timeout:
+        try:
+            state = json.loads(request(node + '/ota')[1])
+        except (OSError, urllib.error.URLError, ValueError):
+            pass  # Busy flashing, or already restarting
+        if state.get('state') in ('done', 'failed'):
+            break
+        time.sleep(0.1)
+    update_ms = (time.monotonic() - start) * 1000
+    if state.get('state') != 'done':
+        raise RuntimeError('update did not complete: %s' % json.dumps(state))
+
+    while time.monotonic() - start < timeout:
+        time.sleep(0.2)
+        try:
+            if request(node + '/data', timeout=1.0)[0] == 200 and \
+                    json.loads(request(node + '/ota')[1]).get('state') == 'idle':
+                return state, update_ms, (time.monotonic() - start) * 1000
+        except (OSError, urllib.error.URLError, ValueError):
+            pass
+    raise RuntimeError('node did not come back within %d s' % timeout)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Serve OTA images to a node and time the updates.')
+    parser.add_argument('node', help='node base URL, e.g. http://192.168.1.50')
+    parser.add_argument('images', nargs='+', help='images to serve in turn: .bin and/or ota_pack.py output')
+    parser.add_argument('--port', type=int, default=8070, help='port to serve the images on')
+    parser.add_argument('--token', default='', help='CONFIG_RG_OTA_TOKEN of the node')
+    parser.add_argument('--timeout', type=float, default=180.0, help='seconds per update')
+    parser.add_argument('--cert', help='PEM certificate to serve the images over https with')
+    parser.add_argument('--key', help='PEM private key of --cert')
+    args = parser.parse_args()
+
+    node = args.node.rstrip('/')
+    host = urllib.parse.urlsplit(node).hostname
+    if not host:
+        sys.exit('ota_serve: expected an http:// node URL')
+    directory = os.path.dirname(os.path.abspath(args.images[0]))
+    if any(os.path.dirname(os.path.abspath(i)) != directory for i in args.images):
+        sys.exit('ota_serve: the images must be in one directory')
+
+    handler = lambda *a, **kw: CountingHandler(*a, directory=directory, **kw)
+    server = http.server.ThreadingHTTPServer(('', args.port), handler)
+    scheme = 'http'
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        scheme = 'https'
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    base = '%s://%s:%d/' % (scheme, local_address(host), args.port)
+
+    for image in args.images:
+        name = os.path.basename(image)
+        CountingHandler.served.clear()
+        state, update_ms, online_ms = update(node, base + name, args.token, args.timeout)
+        print(json.dumps({
+            'bench': 'ota.update_%s' % ('compressed' if state.get('compressed') else 'plain'),
+            'image': name,
+            'file_bytes': os.path.getsize(image),
+            'bytes_served': sum(CountingHandler.served.values()),
+            'image_bytes': state.get('bytes_out'),
+            'update_ms': round(update_ms),
+            'node_ms': state.get('elapsed_ms'),
+            'online_ms': round(online_ms),
+        }))
+        sys.stdout.flush()
+    server.shutdown()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,81 @@
+// host/port/alloc_audit_host.c
+// Host build: feeds rg_alloc_audit from malloc and friends, as the heap
+// hooks do on the device. Defining them here overrides the C library's for
+// the whole executable, including operator new and the C++ runtime.
+#include "services/metrics/rg_alloc_audit.h"
+
+#include <stddef.h>
+
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    if (p) {
+        rg_alloc_audit_record_alloc(size);
+    }
+    return p;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    void *p = __libc_calloc(count, size);
+    if (p) {
+        rg_alloc_audit_record_alloc(count * size);
+    }
+    return p;
+}
+
+// Counted as an allocation even when the block grows in place: the caller
+// still went to the heap
+void *realloc(void *ptr, size_t size)
+{
+    void *p = __libc_realloc(ptr, size);
+    if (p) {
+        rg_alloc_audit_record_alloc(size);
+    }
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *p = __libc_memalign(alignment, size);
+    if (p) {
+        rg_alloc_audit_record_alloc(size);
+    }
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return 22; // EINVAL
+    }
+    void *p = memalign(alignment, size);
+    if (!p) {
+        return 12; // ENOMEM
+    }
+    *out = p;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        rg_alloc_audit_record_free();
+        __libc_free(ptr);
+    }
+}
+
+#endif // __GLIBC__
@@ -0,0 +1,393 @@
+// host/port/esp_http_server_host.c
+// In-process model of esp_http_server for host builds; see rg_httpd_host.h.
+#include "esp_http_server.h"
+#include "rg_httpd_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define MAX_SESSIONS 8
+#define FIRST_FD 54 // lwIP numbers sockets from LWIP_SOCKET_OFFSET, like this
+#define MAX_WORK 16
+
+typedef struct {
+    bool open;
+    bool stalled;
+    void *sess_ctx;
+    httpd_free_ctx_fn_t free_ctx;
+    size_t socket_bytes;
+} session_t;
+
+// Per-request state, reached through httpd_req_t::aux
+typedef struct {
+    int fd;
+    const char *req_headers;
+    const char *body;    // Request body not yet received
+    size_t body_left;
+    rg_httpd_host_response_t *resp;
+    char status[32];
+    char type[64];
+    bool headers_sent;
+} request_t;
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+} work_t;
+
+static int s_server; // Its address is the server handle
+static session_t s_sessions[MAX_SESSIONS];
+static work_t s_work[MAX_WORK];
+static size_t s_work_head;
+static size_t s_work_len;
+static char *s_body;
+static size_t s_body_cap;
+
+static session_t *session_of(int fd)
+{
+    if (fd < FIRST_FD || fd >= FIRST_FD + MAX_SESSIONS || !s_sessions[fd - FIRST_FD].open) {
+        return NULL;
+    }
+    return &s_sessions[fd - FIRST_FD];
+}
+
+static request_t *request_of(httpd_req_t *r)
+{
+    return (request_t *)r->aux;
+}
+
+static void body_append(rg_httpd_host_response_t *resp, const char *data, size_t len)
+{
+    if (resp->body_len + len > s_body_cap) {
+        size_t cap = s_body_cap ? s_body_cap : 4096;
+        while (cap < resp->body_len + len) {
+            cap *= 2;
+        }
+        s_body = (char *)realloc(s_body, cap);
+        if (!s_body) {
+            abort();
+        }
+        s_body_cap = cap;
+    }
+    memcpy(s_body + resp->body_len, data, len);
+    resp->body_len += len;
+    resp->body = s_body;
+}
+
+static void headers_append(rg_httpd_host_response_t *resp, const char *field, const char *value)
+{
+    size_t used = strlen(resp->headers);
+    snprintf(resp->headers + used, sizeof(resp->headers) - used, "%s: %s\r\n", field, value);
+}
+
+// Freezes status and headers, as the first byte of a response does
+static void send_headers(request_t *rq)
+{
+    if (rq->headers_sent) {
+        return;
+    }
+    rq->headers_sent = true;
+    rq->resp->status = atoi(rq->status);
+    headers_append(rq->resp, "Content-Type", rq->type);
+}
+
+int rg_httpd_host_open(void)
+{
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (!s_sessions[i].open) {
+            memset(&s_sessions[i], 0, sizeof(s_sessions[i]));
+            s_sessions[i].open = true;
+            return FIRST_FD + i;
+        }
+    }
+    return -1;
+}
+
+void rg_httpd_host_close(int fd)
+{
+    session_t *session = session_of(fd);
+    if (!session) {
+        return;
+    }
+    session->open = false;
+    if (session->free_ctx && session->sess_ctx) {
+        session->free_ctx(session->sess_ctx);
+    } else {
+        free(session->sess_ctx);
+    }
+    session->sess_ctx = NULL;
+    session->free_ctx = NULL;
+}
+
+esp_err_t rg_httpd_host_get(int fd, const char *uri, const char *headers, rg_httpd_host_handler_t handler,
+                            rg_httpd_host_response_t *resp)
+{
+    return rg_httpd_host_request(fd, HTTP_GET, uri, headers, handler, resp);
+}
+
+esp_err_t rg_httpd_host_request(int fd, int method, const char *uri, const char *headers,
+                                rg_httpd_host_handler_t handler, rg_httpd_host_response_t *resp)
+{
+    return rg_httpd_host_request_body(fd, method, uri, headers, NULL, handler, resp);
+}
+
+esp_err_t rg_httpd_host_request_body(int fd, int method, const char *uri, const char *headers, const char *body,
+                                     rg_httpd_host_handler_t handler, rg_httpd_host_response_t *resp)
+{
+    session_t *session = session_of(fd);
+    if (!session || strlen(uri) > HTTPD_MAX_URI_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(resp, 0, sizeof(*resp));
+    resp->body = s_body;
+    request_t rq = {
+        .fd = fd,
+        .req_headers = headers ? headers : "",
+        .body = body ? body : "",
+        .body_left = body ? strlen(body) : 0,
+        .resp = resp,
+        .status = "200 OK",
+        .type = "text/html",
+        .headers_sent = false,
+    };
+    httpd_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.handle = &s_server;
+    req.method = method;
+    req.content_len = rq.body_left;
+    strcpy((char *)req.uri, uri);
+    req.aux = &rq;
+    req.sess_ctx = session->sess_ctx;
+    req.free_ctx = session->free_ctx;
+
+    esp_err_t err = handler(&req);
+
+    session->sess_ctx = req.sess_ctx;
+    session->free_ctx = req.free_ctx;
+    return err;
+}
+
+int rg_httpd_host_poll(void)
+{
+    int ran = 0;
+    while (s_work_len > 0) {
+        work_t work = s_work[s_work_head];
+        s_work_head = (s_work_head + 1) % MAX_WORK;
+        s_work_len--;
+        work.fn(work.arg);
+        ran++;
+    }
+    return ran;
+}
+
+void rg_httpd_host_set_stalled(int fd, bool stalled)
+{
+    session_t *session = session_of(fd);
+    if (session) {
+        session->stalled = stalled;
+    }
+}
+
+size_t rg_httpd_host_socket_bytes(int fd)
+{
+    session_t *session = session_of(fd);
+    return session ? session->socket_bytes : 0;
+}
+
+bool rg_httpd_host_is_open(int fd)
+{
+    return session_of(fd) != NULL;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    request_t *rq = request_of(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    send_headers(rq);
+    if (buf && buf_len > 0) {
+        body_append(rq->resp, buf, (size_t)buf_len);
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    request_t *rq = request_of(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    send_headers(rq);
+    if (buf && buf_len > 0) {
+        body_append(rq->resp, buf, (size_t)buf_len);
+        rq->resp->chunks++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    request_t *rq = request_of(r);
+    snprintf(rq->status, sizeof(rq->status), "%s", status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    request_t *rq = request_of(r);
+    snprintf(rq->type, sizeof(rq->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    headers_append(request_of(r)->resp, field, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    const char *status = error == HTTPD_400_BAD_REQUEST          ? "400 Bad Request"
+                         : error == HTTPD_403_FORBIDDEN        ? "403 Forbidden"
+                         : error == HTTPD_404_NOT_FOUND        ? "404 Not Found"
+                         : error == HTTPD_405_METHOD_NOT_ALLOWED ? "405 Method Not Allowed"
+                                                               : "500 Internal Server Error";
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_send(req, msg ? msg : status, HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL; // Like the real server, errors end the session's request
+}
+
+esp_err_t httpd_resp_send_404(httpd_req_t *r)
+{
+    return httpd_resp_send_err(r, HTTPD_404_NOT_FOUND, "This URI does not exist");
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *r)
+{
+    return httpd_resp_send_err(r, HTTPD_500_INTERNAL_SERVER_ERROR, "Server has encountered an unexpected error");
+}
+
+// Copies at most size - 1 bytes; ESP_ERR_HTTPD_RESULT_TRUNC if it had to cut
+static esp_err_t copy_value(char *out, size_t size, const char *value, size_t len)
+{
+    if (size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(out, value, n);
+    out[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *query = strchr(r->uri, '?');
+    if (!query) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    query++;
+    return copy_value(buf, buf_len, query, strlen(query));
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    size_t key_len = strlen(key);
+    const char *p = qry;
+    while (*p) {
+        const char *end = strchr(p, '&');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            return copy_value(val, val_size, p + key_len + 1, len - key_len - 1);
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    size_t field_len = strlen(field);
+    const char *line = request_of(r)->req_headers;
+    while (*line) {
+        const char *end = strstr(line, "\r\n");
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        if (len > field_len && strncasecmp(line, field, field_len) == 0 && line[field_len] == ':') {
+            const char *value = line + field_len + 1;
+            while (*value == ' ') {
+                value++;
+            }
+            return copy_value(val, val_size, value, (size_t)(line + len - value));
+        }
+        if (!end) {
+            break;
+        }
+        line = end + 2;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    request_t *rq = request_of(r);
+    size_t n = buf_len < rq->body_left ? buf_len : rq->body_left;
+    memcpy(buf, rq->body, n);
+    rq->body += n;
+    rq->body_left -= n;
+    return (int)n;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return request_of(r)->fd;
+}
+
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    (void)hd;
+    (void)buf;
+    (void)flags;
+    session_t *session = session_of(sockfd);
+    if (!session) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+    if (session->stalled) {
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    session->socket_bytes += buf_len;
+    return (int)buf_len;
+}
+
+static void close_work(void *arg)
+{
+    rg_httpd_host_close((int)(intptr_t)arg);
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    if (!session_of(sockfd)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // The real server closes from its own task too, after the current work returns
+    return httpd_queue_work(handle, close_work, (void *)(intptr_t)sockfd);
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    if (handle != &s_server || !work) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_work_len == MAX_WORK) {
+        return ESP_FAIL;
+    }
+    s_work[(s_work_head + s_work_len) % MAX_WORK] = (work_t){work, arg};
+    s_work_len++;
+    return ESP_OK;
+}
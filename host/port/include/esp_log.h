@@ -0,0 +1,38 @@
+// host/port/include/esp_log.h
+// Host build: ESP_LOGx print to stderr. Set RG_HOST_LOG=0 in the environment to
+// silence them (the benchmarks do, so log output does not skew timings).
+#pragma once
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+int rg_host_log_enabled(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define RG_HOST_LOG(level, tag, format, ...)                                         \
+    do {                                                                             \
+        if (rg_host_log_enabled()) {                                                 \
+            fprintf(stderr, level " (%s) " format "\n", tag, ##__VA_ARGS__);         \
+        }                                                                            \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) RG_HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) RG_HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) RG_HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, format, ...) do { (void)(tag); } while (0)
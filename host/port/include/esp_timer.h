@@ -0,0 +1,15 @@
+// host/port/include/esp_timer.h
+// Host build: esp_timer_get_time() is the monotonic clock in microseconds.
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
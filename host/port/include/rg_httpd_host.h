@@ -0,0 +1,83 @@
+// host/port/include/rg_httpd_host.h
+// Host build: drives handlers written against esp_http_server.h.
+//
+// The model has one server and a table of sessions identified by socket fd.
+// rg_httpd_host_get() runs a handler for one request on a session and records
+// the response; bytes a handler writes to the socket directly (event streams)
+// are counted per session. Work queued with httpd_queue_work() runs on the
+// next rg_httpd_host_poll(), as it would on the server task.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_http_server.h"
+
+typedef esp_err_t (*rg_httpd_host_handler_t)(httpd_req_t *req);
+
+typedef struct {
+    int status;          // 200 unless the handler set another status
+    char headers[512];   // "Name: value\r\n" lines, including Content-Type
+    const char *body;    // Valid until the next request on any session
+    size_t body_len;
+    size_t chunks;       // httpd_resp_send_chunk() calls with data
+} rg_httpd_host_response_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Opens a client session and returns its socket fd, or -1 if the table is full.
+ */
+int rg_httpd_host_open(void);
+
+/**
+ * @brief Closes the session as the server would when the client goes away (runs free_ctx).
+ */
+void rg_httpd_host_close(int fd);
+
+/**
+ * @brief Runs @p handler for GET @p uri on session @p fd.
+ *
+ * @param headers Request headers as "Name: value\r\n" lines, or NULL.
+ * @param resp Receives the recorded response.
+ */
+esp_err_t rg_httpd_host_get(int fd, const char *uri, const char *headers, rg_httpd_host_handler_t handler,
+                            rg_httpd_host_response_t *resp);
+
+/**
+ * @brief Runs @p handler for a request with any @p method (HTTP_GET, HTTP_POST, ...); see rg_httpd_host_get().
+ */
+esp_err_t rg_httpd_host_request(int fd, int method, const char *uri, const char *headers,
+                                rg_httpd_host_handler_t handler, rg_httpd_host_response_t *resp);
+
+/**
+ * @brief As rg_httpd_host_request(), with @p body (or NULL) for httpd_req_recv() and content_len.
+ */
+esp_err_t rg_httpd_host_request_body(int fd, int method, const char *uri, const char *headers, const char *body,
+                                     rg_httpd_host_handler_t handler, rg_httpd_host_response_t *resp);
+
+/**
+ * @brief Runs the work queued with httpd_queue_work(); returns the number of items run.
+ */
+int rg_httpd_host_poll(void);
+
+/**
+ * @brief Models a client that stopped reading: further socket sends time out.
+ */
+void rg_httpd_host_set_stalled(int fd, bool stalled);
+
+/**
+ * @brief Bytes written directly to the socket of @p fd since it was opened.
+ */
+size_t rg_httpd_host_socket_bytes(int fd);
+
+/**
+ * @brief True while the session of @p fd is open.
+ */
+bool rg_httpd_host_is_open(int fd);
+
+#ifdef __cplusplus
+}
+#endif
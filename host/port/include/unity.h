@@ -0,0 +1,96 @@
+// host/port/include/unity.h
+// Host build: the part of Unity used by tests/, with TEST_CASE registration as
+// in ESP-IDF's unity component. A failed assertion reports and ends the test
+// case; UNITY_END() returns the number of failed cases.
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*rg_unity_fn_t)(void);
+
+void rg_unity_register(const char *name, const char *tags, rg_unity_fn_t fn);
+void rg_unity_fail(const char *file, int line, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int rg_unity_failed(void);
+void UNITY_BEGIN(void);
+int UNITY_END(void);
+void unity_run_all_tests(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define RG_UNITY_CAT2(a, b) a##b
+#define RG_UNITY_CAT(a, b) RG_UNITY_CAT2(a, b)
+
+#define TEST_CASE(name, tags)                                                                    \
+    static void RG_UNITY_CAT(rg_test_, __LINE__)(void);                                          \
+    __attribute__((constructor)) static void RG_UNITY_CAT(rg_test_register_, __LINE__)(void)     \
+    {                                                                                            \
+        rg_unity_register(name, tags, RG_UNITY_CAT(rg_test_, __LINE__));                         \
+    }                                                                                            \
+    static void RG_UNITY_CAT(rg_test_, __LINE__)(void)
+
+#define RG_UNITY_FAIL(...)                                                                       \
+    do {                                                                                         \
+        rg_unity_fail(__FILE__, __LINE__, __VA_ARGS__);                                          \
+        return;                                                                                  \
+    } while (0)
+
+#define TEST_ASSERT(c)                                                                           \
+    do {                                                                                         \
+        if (!(c)) RG_UNITY_FAIL("%s", #c);                                                       \
+    } while (0)
+#define TEST_ASSERT_TRUE(c) TEST_ASSERT(c)
+#define TEST_ASSERT_FALSE(c) TEST_ASSERT(!(c))
+#define TEST_ASSERT_NULL(p) TEST_ASSERT((p) == NULL)
+#define TEST_ASSERT_NOT_NULL(p) TEST_ASSERT((p) != NULL)
+
+#define TEST_ASSERT_EQUAL(expected, actual)                                                      \
+    do {                                                                                         \
+        long long rg_e_ = (long long)(expected), rg_a_ = (long long)(actual);                    \
+        if (rg_e_ != rg_a_) RG_UNITY_FAIL("expected %lld, was %lld", rg_e_, rg_a_);              \
+    } while (0)
+#define TEST_ASSERT_EQUAL_INT(e, a) TEST_ASSERT_EQUAL(e, a)
+#define TEST_ASSERT_EQUAL_INT8(e, a) TEST_ASSERT_EQUAL((int8_t)(e), (int8_t)(a))
+#define TEST_ASSERT_EQUAL_INT16(e, a) TEST_ASSERT_EQUAL((int16_t)(e), (int16_t)(a))
+#define TEST_ASSERT_EQUAL_INT32(e, a) TEST_ASSERT_EQUAL((int32_t)(e), (int32_t)(a))
+#define TEST_ASSERT_EQUAL_INT64(e, a) TEST_ASSERT_EQUAL(e, a)
+#define TEST_ASSERT_EQUAL_UINT(e, a) TEST_ASSERT_EQUAL(e, a)
+#define TEST_ASSERT_EQUAL_UINT8(e, a) TEST_ASSERT_EQUAL((uint8_t)(e), (uint8_t)(a))
+#define TEST_ASSERT_EQUAL_UINT16(e, a) TEST_ASSERT_EQUAL((uint16_t)(e), (uint16_t)(a))
+#define TEST_ASSERT_EQUAL_UINT32(e, a) TEST_ASSERT_EQUAL((uint32_t)(e), (uint32_t)(a))
+#define TEST_ASSERT_EQUAL_size_t(e, a) TEST_ASSERT_EQUAL(e, a)
+#define TEST_ASSERT_EQUAL_HEX8(e, a) TEST_ASSERT_EQUAL_UINT8(e, a)
+#define TEST_ASSERT_NOT_EQUAL(e, a) TEST_ASSERT((e) != (a))
+
+#define RG_UNITY_COMPARE(threshold, actual, op)                                                  \
+    do {                                                                                         \
+        long long rg_t_ = (long long)(threshold), rg_a_ = (long long)(actual);                   \
+        if (!(rg_a_ op rg_t_)) RG_UNITY_FAIL("expected %lld %s %lld", rg_a_, #op, rg_t_);        \
+    } while (0)
+#define TEST_ASSERT_GREATER_THAN(threshold, actual) RG_UNITY_COMPARE(threshold, actual, >)
+#define TEST_ASSERT_GREATER_OR_EQUAL(threshold, actual) RG_UNITY_COMPARE(threshold, actual, >=)
+#define TEST_ASSERT_LESS_THAN(threshold, actual) RG_UNITY_COMPARE(threshold, actual, <)
+#define TEST_ASSERT_LESS_OR_EQUAL(threshold, actual) RG_UNITY_COMPARE(threshold, actual, <=)
+
+#define TEST_ASSERT_FLOAT_WITHIN(delta, expected, actual)                                        \
+    do {                                                                                         \
+        double rg_e_ = (double)(expected), rg_a_ = (double)(actual);                             \
+        if (!(fabs(rg_e_ - rg_a_) <= (double)(delta)))                                           \
+            RG_UNITY_FAIL("expected %g, was %g (delta %g)", rg_e_, rg_a_, (double)(delta));      \
+    } while (0)
+#define TEST_ASSERT_EQUAL_FLOAT(e, a) TEST_ASSERT_FLOAT_WITHIN(fabs((double)(e)) * 1e-5 + 1e-6, e, a)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual)                                               \
+    do {                                                                                         \
+        const char *rg_e_ = (expected), *rg_a_ = (actual);                                       \
+        if (strcmp(rg_e_, rg_a_) != 0) RG_UNITY_FAIL("expected \"%s\", was \"%s\"", rg_e_, rg_a_); \
+    } while (0)
+#define TEST_ASSERT_EQUAL_MEMORY(expected, actual, len) TEST_ASSERT(memcmp((expected), (actual), (len)) == 0)
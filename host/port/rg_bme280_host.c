@@ -0,0 +1,30 @@
+// host/port/rg_bme280_host.c
+// Host build: rg_bme280_init() binds the driver to a simulated sensor holding
+// the reference calibration, in place of the I2C binding in rg_bme280_i2c.c.
+// Each of the two BME280 addresses has its own simulated part.
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+
+#include <string.h>
+
+static rg_bme280_sim_t s_sim[2];
+
+esp_err_t rg_bme280_init(rg_bme280_t *rg_bme280, uint8_t addr)
+{
+    if (rg_bme280 == NULL || (addr != RG_BME280_I2C_ADDR_PRIM && addr != RG_BME280_I2C_ADDR_SEC)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(rg_bme280, 0, sizeof(*rg_bme280));
+    rg_bme280_sim_t *sim = &s_sim[addr == RG_BME280_I2C_ADDR_SEC];
+    rg_bme280_sim_init(sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280->i2c_addr = addr;
+    rg_bme280_bus_t bus = rg_bme280_sim_bus(sim);
+    return rg_bme280_init_with_bus(rg_bme280, &bus);
+}
+
+void rg_bme280_deinit(rg_bme280_t *rg_bme280)
+{
+    if (rg_bme280 != NULL) {
+        memset(rg_bme280, 0, sizeof(*rg_bme280));
+    }
+}
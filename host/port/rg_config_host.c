@@ -0,0 +1,105 @@
+// host/port/rg_config_host.c
+// Host build: the settings store without NVS or a flush task. Nothing is
+// stored, so every setting starts at its Kconfig default, and changes stay in
+// RAM, so the /settings routes can be exercised.
+#include "services/config/rg_config_task.h"
+
+#include <stdbool.h>
+#include <sdkconfig.h>
+
+static rg_config_t s_config;
+static char s_strings[RG_SETTINGS_SSID_MAX + RG_SETTINGS_PASSWORD_MAX + RG_SETTINGS_RULES_MAX + 3];
+static bool s_started;
+
+static esp_err_t ram_read_int(void *ctx, const char *name, int32_t *value)
+{
+    (void)ctx;
+    (void)name;
+    (void)value;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t ram_read_string(void *ctx, const char *name, char *out, size_t *len)
+{
+    (void)ctx;
+    (void)name;
+    (void)out;
+    (void)len;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t ram_write_int(void *ctx, const char *name, int32_t value)
+{
+    (void)ctx;
+    (void)name;
+    (void)value;
+    return ESP_OK;
+}
+
+static esp_err_t ram_write_string(void *ctx, const char *name, const char *value)
+{
+    (void)ctx;
+    (void)name;
+    (void)value;
+    return ESP_OK;
+}
+
+static esp_err_t ram_commit(void *ctx)
+{
+    (void)ctx;
+    return ESP_OK;
+}
+
+esp_err_t rg_config_task_start(void)
+{
+    if (s_started) {
+        return ESP_OK;
+    }
+    static const rg_config_port_t port = {
+        .read_int = ram_read_int,
+        .read_string = ram_read_string,
+        .write_int = ram_write_int,
+        .write_string = ram_write_string,
+        .commit = ram_commit,
+        .ctx = NULL,
+    };
+    esp_err_t err = rg_config_init(&s_config, rg_settings_defs, RG_SETTING_COUNT, s_strings, sizeof(s_strings),
+                                   &port, CONFIG_RG_SETTINGS_DEBOUNCE_MS, CONFIG_RG_SETTINGS_MAX_DELAY_MS);
+    s_started = err == ESP_OK;
+    return err;
+}
+
+const rg_config_t *rg_config_task_config(void)
+{
+    rg_config_task_start();
+    return &s_config;
+}
+
+esp_err_t rg_config_task_set(const char *const *names, const char *const *values, size_t count, size_t *bad)
+{
+    rg_config_task_start();
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t err = rg_config_check(&s_config, rg_config_find(&s_config, names[i]), values[i]);
+        if (err != ESP_OK) {
+            if (bad) {
+                *bad = i;
+            }
+            return err;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        rg_config_set(&s_config, rg_config_find(&s_config, names[i]), values[i], 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_config_task_subscribe(uint32_t ids, rg_config_notify_t notify, void *ctx)
+{
+    rg_config_task_start();
+    return rg_config_subscribe(&s_config, ids, notify, ctx);
+}
+
+void rg_config_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    (void)writer;
+}
@@ -0,0 +1,32 @@
+// host/port/rg_ota_host.c
+// Host build: no OTA partitions or HTTP client. An update request is accepted
+// and reported as running, so the /ota routes can be exercised. URLs are
+// checked as on a device with a pinned server certificate: https:// only.
+#include "services/ota/rg_ota_task.h"
+
+#include <string.h>
+
+static rg_ota_status_t s_status;
+
+esp_err_t rg_ota_task_start(const char *url)
+{
+    if (strncmp(url, "https://", 8) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_status.state == RG_OTA_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.state = RG_OTA_RUNNING;
+    return ESP_OK;
+}
+
+void rg_ota_task_status(rg_ota_status_t *status)
+{
+    *status = s_status;
+}
+
+esp_err_t rg_ota_task_confirm(void)
+{
+    return ESP_OK;
+}
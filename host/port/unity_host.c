@@ -0,0 +1,86 @@
+// host/port/unity_host.c
+// Host build: registry and runner behind host/port/include/unity.h. main()
+// calls app_main() like ESP-IDF's linux target; an optional argument selects
+// test cases whose name or tags contain it.
+#include "unity.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_TESTS 256
+
+typedef struct {
+    const char *name;
+    const char *tags;
+    rg_unity_fn_t fn;
+} test_t;
+
+static test_t s_tests[MAX_TESTS];
+static int s_count;
+static int s_failed_cases;
+static int s_run_cases;
+static int s_current_failed;
+static const char *s_filter;
+
+void rg_unity_register(const char *name, const char *tags, rg_unity_fn_t fn)
+{
+    if (s_count < MAX_TESTS) {
+        s_tests[s_count++] = (test_t){name, tags, fn};
+    }
+}
+
+void rg_unity_fail(const char *file, int line, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    printf("%s:%d: FAIL: ", file, line);
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+    s_current_failed = 1;
+}
+
+int rg_unity_failed(void)
+{
+    return s_failed_cases;
+}
+
+void UNITY_BEGIN(void)
+{
+    s_failed_cases = 0;
+    s_run_cases = 0;
+}
+
+int UNITY_END(void)
+{
+    printf("\n-----------------------\n%d Tests %d Failures 0 Ignored\n%s\n", s_run_cases, s_failed_cases,
+           s_failed_cases ? "FAIL" : "OK");
+    return s_failed_cases;
+}
+
+void unity_run_all_tests(void)
+{
+    for (int i = 0; i < s_count; i++) {
+        const test_t *t = &s_tests[i];
+        if (s_filter && !strstr(t->name, s_filter) && !strstr(t->tags, s_filter)) {
+            continue;
+        }
+        s_current_failed = 0;
+        printf("Running %s...\n", t->name);
+        fflush(stdout);
+        t->fn();
+        s_run_cases++;
+        s_failed_cases += s_current_failed;
+        printf("%s\n", s_current_failed ? "FAIL" : "PASS");
+    }
+}
+
+void app_main(void);
+
+int main(int argc, char **argv)
+{
+    s_filter = argc > 1 ? argv[1] : NULL;
+    app_main();
+    return s_failed_cases ? 1 : 0;
+}
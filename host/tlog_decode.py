@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+# Turns the tokenized log records of CONFIG_RG_TLOG_OUTPUT_BINARY back into
+# ESP_LOG lines (see main/services/log/rg_tlog.h). The records carry only the
+# addresses of their format string and tag, so this needs the ELF of the
+# exact build that is running:
+#
+#   idf.py monitor | python3 host/tlog_decode.py build/rg2.elf
+#   python3 host/tlog_decode.py build/rg2.elf < capture.log
+#
+# Record lines start with "\x1eTL" followed by the record in base64; every
+# other line is passed through as it is.
+import argparse
+import base64
+import re
+import struct
+import sys
+
+MARKER = b'\x1eTL'
+COMMITTED = 0x80000000
+LEVELS = 'NEWIDV'
+MAX_STRING = 48
+
+SPEC = re.compile(rb'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|ll|[hlzjtL])?([a-zA-Z%])')
+
+
+class Elf:
+    """Reads NUL-terminated strings at run-time addresses of a 32-bit little-endian ELF."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('%s is not a 32-bit little-endian ELF' % path)
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from('<IIIIII', data, shoff + i * shentsize)
+            # Allocated and with contents in the file: rodata, flash and IRAM/DRAM initialised data
+            if flags & 0x2 and sh_type != 8 and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        for base, contents in self.sections:
+            if base <= addr < base + len(contents):
+                end = contents.find(b'\0', addr - base)
+                return contents[addr - base:end if end >= 0 else len(contents)]
+        return None
+
+
+def render(elf, record):
+    header, time_ms, format_addr, tag_addr = struct.unpack_from('<IIII', record)
+    if not header & COMMITTED or header & 0xFFFF != len(record):
+        return None
+    fmt = elf.string(format_addr)
+    tag = elf.string(tag_addr)
+    if fmt is None:
+        return '%s (%u) %s: <format 0x%08x not in the ELF>' % (LEVELS[(header >> 24) & 7], time_ms,
+                                                               (tag or b'?').decode(errors='replace'), format_addr)
+    args = memoryview(record)[16:]
+    pos = 0
+
+    def take(n, code):
+        nonlocal pos
+        if pos + n > len(args):
+            raise IndexError
+        value, = struct.unpack_from(code, args, pos)
+        pos += n
+        return value
+
+    out = []
+    last = 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()].decode(errors='replace'))
+        last = m.end()
+        flags, width, precision, length, conversion = m.groups()
+        conversion = conversion.decode()
+        if conversion == '%':
+            out.append('%')
+            continue
+        try:
+            if width == b'*':
+                width = str(take(4, '<i')).encode()
+            if precision == b'*':
+                precision = str(take(4, '<i')).encode()
+            spec = '%' + (flags + (width or b'')).decode()
+            if precision is not None:
+                spec += '.' + precision.decode()
+            if conversion in 'diuoxXc':
+                wide = length in (b'll', b'j')
+                value = take(8, '<q') if wide else take(4, '<i')
+                if conversion in 'uoxX' and value < 0:
+                    value += 1 << (64 if wide else 32)
+                out.append((spec + ('d' if conversion in 'iu' else conversion)) % value)
+            elif conversion in 'fFeEgGaA':
+                out.append((spec + conversion.replace('a', 'e').replace('A', 'E')) % take(4, '<f'))
+            elif conversion == 's':
+                n = take(1, '<B')
+                if n > MAX_STRING or pos + n > len(args):
+                    raise IndexError
+                out.append((spec + 's') % bytes(args[pos:pos + n]).decode(errors='replace'))
+                pos += n
+            elif conversion == 'p':
+                out.append('0x%08x' % take(4, '<I'))
+        except IndexError:
+            out.append('<?>')
+    out.append(fmt[last:].decode(errors='replace'))
+    return '%s (%u) %s: %s' % (LEVELS[(header >> 24) & 7], time_ms, (tag or b'?').decode(errors='replace'),
+                               ''.join(out))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode tokenized log records from a node.')
+    parser.add_argument('elf', help='ELF of the firmware that wrote the records')
+    args = parser.parse_args()
+    elf = Elf(args.elf)
+
+    stdin = sys.stdin.buffer
+    for line in stdin:
+        start = line.find(MARKER)
+        if start < 0:
+            sys.stdout.write(line.decode(errors='replace'))
+        else:
+            try:
+                text = render(elf, base64.b64decode(line[start + len(MARKER):].strip(), validate=True))
+            except (ValueError, struct.error):
+                text = None
+            sys.stdout.write(line[:start].decode(errors='replace'))
+            sys.stdout.write((text if text is not None else '<corrupt record>') + '\n')
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,296 @@
+// main/communications/rg_mqtt_publisher.c
+#include "rg_mqtt_publisher.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// --- Encoded sizes -------------------------------------------------------
+
+static size_t json_int_size(int64_t v)
+{
+    size_t n = v < 0 ? 2 : 1;
+    uint64_t u = v < 0 ? (uint64_t)(-(v + 1)) + 1 : (uint64_t)v;
+    while (u >= 10) {
+        u /= 10;
+        n++;
+    }
+    return n;
+}
+
+// Initial byte plus the argument for major types 0 (unsigned) and 1 (negative)
+static size_t cbor_int_size(int64_t v)
+{
+    uint64_t u = v < 0 ? (uint64_t)(-(v + 1)) : (uint64_t)v;
+    return u < 24 ? 1 : u <= 0xFF ? 2 : u <= 0xFFFF ? 3 : u <= 0xFFFFFFFFu ? 5 : 9;
+}
+
+static const rg_mqtt_sample_t *sample_at(const rg_mqtt_publisher_t *pub, size_t i)
+{
+    return &pub->samples[(pub->head + i) % pub->capacity];
+}
+
+static int64_t sample_dt(const rg_mqtt_publisher_t *pub, size_t i)
+{
+    return i == 0 ? 0 : (int64_t)sample_at(pub, i)->timestamp - (int64_t)sample_at(pub, i - 1)->timestamp;
+}
+
+static size_t row_size(const rg_mqtt_publisher_t *pub, size_t i)
+{
+    const rg_mqtt_sample_t *s = sample_at(pub, i);
+    int64_t dt = sample_dt(pub, i);
+    if (pub->format == RG_MQTT_FORMAT_CBOR) {
+        return 1 + cbor_int_size(dt) + cbor_int_size(s->temperature) + cbor_int_size(s->humidity) +
+               cbor_int_size(s->pressure);
+    }
+    // [dt,t,h,p] and the comma before every row but the first
+    return (i > 0 ? 1 : 0) + 5 + json_int_size(dt) + json_int_size(s->temperature) + json_int_size(s->humidity) +
+           json_int_size(s->pressure);
+}
+
+// Everything but the rows
+static size_t frame_size(const rg_mqtt_publisher_t *pub, size_t count, uint32_t now, const char *node)
+{
+    size_t node_len = strlen(node);
+    uint32_t t0 = count ? sample_at(pub, 0)->timestamp : now;
+    if (pub->format == RG_MQTT_FORMAT_CBOR) {
+        // Map header, then "n", "now", "t0" and "s" keys with their values
+        return 1 + 2 + cbor_int_size((int64_t)node_len) + node_len + 4 + cbor_int_size(now) + 3 +
+               cbor_int_size(t0) + 2 + cbor_int_size((int64_t)count);
+    }
+    // {"n":"","now":,"t0":,"s":[]}
+    return 28 + node_len + json_int_size(now) + json_int_size(t0);
+}
+
+// --- Encoders ------------------------------------------------------------
+
+static uint8_t *cbor_head(uint8_t *p, uint8_t major, uint64_t arg)
+{
+    major <<= 5;
+    if (arg < 24) {
+        *p++ = major | (uint8_t)arg;
+    } else if (arg <= 0xFF) {
+        *p++ = major | 24;
+        *p++ = (uint8_t)arg;
+    } else if (arg <= 0xFFFF) {
+        *p++ = major | 25;
+        *p++ = (uint8_t)(arg >> 8);
+        *p++ = (uint8_t)arg;
+    } else if (arg <= 0xFFFFFFFFu) {
+        *p++ = major | 26;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            *p++ = (uint8_t)(arg >> shift);
+        }
+    } else {
+        *p++ = major | 27;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            *p++ = (uint8_t)(arg >> shift);
+        }
+    }
+    return p;
+}
+
+static uint8_t *cbor_int(uint8_t *p, int64_t v)
+{
+    return v < 0 ? cbor_head(p, 1, (uint64_t)(-(v + 1))) : cbor_head(p, 0, (uint64_t)v);
+}
+
+static uint8_t *cbor_text(uint8_t *p, const char *s)
+{
+    size_t len = strlen(s);
+    p = cbor_head(p, 3, len);
+    memcpy(p, s, len);
+    return p + len;
+}
+
+static size_t encode_cbor(const rg_mqtt_publisher_t *pub, size_t count, uint32_t now, const char *node,
+                          uint8_t *buf)
+{
+    uint8_t *p = cbor_head(buf, 5, 4);
+    p = cbor_text(p, "n");
+    p = cbor_text(p, node);
+    p = cbor_text(p, "now");
+    p = cbor_int(p, now);
+    p = cbor_text(p, "t0");
+    p = cbor_int(p, count ? sample_at(pub, 0)->timestamp : now);
+    p = cbor_text(p, "s");
+    p = cbor_head(p, 4, count);
+    for (size_t i = 0; i < count; i++) {
+        const rg_mqtt_sample_t *s = sample_at(pub, i);
+        p = cbor_head(p, 4, 4);
+        p = cbor_int(p, sample_dt(pub, i));
+        p = cbor_int(p, s->temperature);
+        p = cbor_int(p, s->humidity);
+        p = cbor_int(p, s->pressure);
+    }
+    return (size_t)(p - buf);
+}
+
+// @p size already covers the payload, so snprintf never truncates
+static size_t encode_json(const rg_mqtt_publisher_t *pub, size_t count, uint32_t now, const char *node,
+                          uint8_t *buf, size_t size)
+{
+    char *p = (char *)buf;
+    char *end = p + size;
+    p += snprintf(p, end - p, "{\"n\":\"%s\",\"now\":%lu,\"t0\":%lu,\"s\":[", node, (unsigned long)now,
+                  (unsigned long)(count ? sample_at(pub, 0)->timestamp : now));
+    for (size_t i = 0; i < count; i++) {
+        const rg_mqtt_sample_t *s = sample_at(pub, i);
+        p += snprintf(p, end - p, "%s[%lld,%d,%u,%u]", i ? "," : "", (long long)sample_dt(pub, i),
+                      s->temperature, s->humidity, s->pressure);
+    }
+    memcpy(p, "]}", 2);
+    return (size_t)(p + 2 - (char *)buf);
+}
+
+size_t rg_mqtt_encode(const rg_mqtt_publisher_t *pub, size_t count, uint32_t now, const char *node, uint8_t *buf,
+                      size_t size)
+{
+    if (count > pub->count) {
+        return 0;
+    }
+    size_t total = frame_size(pub, count, now, node);
+    for (size_t i = 0; i < count; i++) {
+        total += row_size(pub, i);
+    }
+    // JSON leaves room for the terminator snprintf writes
+    if (total + (pub->format == RG_MQTT_FORMAT_JSON ? 1 : 0) > size) {
+        return 0;
+    }
+    return pub->format == RG_MQTT_FORMAT_CBOR ? encode_cbor(pub, count, now, node, buf)
+                                              : encode_json(pub, count, now, node, buf, size);
+}
+
+size_t rg_mqtt_publish_wire_bytes(size_t topic_len, size_t payload_len, int qos)
+{
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+    size_t len_bytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+    return 1 + len_bytes + remaining + (qos == 1 ? 4 : 0);
+}
+
+// --- Publisher -----------------------------------------------------------
+
+void rg_mqtt_publisher_init(rg_mqtt_publisher_t *pub, rg_mqtt_sample_t *storage, size_t capacity,
+                            size_t batch_size, uint32_t max_age_s, rg_mqtt_format_t format, size_t topic_len)
+{
+    memset(pub, 0, sizeof(*pub));
+    pub->samples = storage;
+    pub->capacity = capacity;
+    pub->batch_size = batch_size ? batch_size : 1;
+    pub->max_age_s = max_age_s;
+    pub->format = format;
+    pub->topic_len = topic_len;
+}
+
+void rg_mqtt_publisher_push(rg_mqtt_publisher_t *pub, const rg_mqtt_sample_t *sample)
+{
+    if (pub->capacity == 0) {
+        return;
+    }
+    if (pub->count == pub->capacity) {
+        // A sample in flight may still be acknowledged, but it is gone from the
+        // queue either way; it is counted as dropped
+        pub->head = (pub->head + 1) % pub->capacity;
+        pub->count--;
+        pub->stats.dropped++;
+        if (pub->in_flight > 0) {
+            pub->in_flight--;
+        }
+    }
+    pub->samples[(pub->head + pub->count) % pub->capacity] = *sample;
+    pub->count++;
+}
+
+void rg_mqtt_publisher_set_connected(rg_mqtt_publisher_t *pub, bool connected)
+{
+    pub->connected = connected;
+    if (!connected && pub->in_flight > 0) {
+        pub->in_flight = 0;
+        pub->stats.resent++;
+    }
+}
+
+size_t rg_mqtt_publisher_next(rg_mqtt_publisher_t *pub, uint32_t now, const char *node, uint8_t *buf,
+                              size_t size)
+{
+    if (!pub->connected || pub->in_flight > 0 || pub->count == 0) {
+        return 0;
+    }
+    uint32_t age = now - sample_at(pub, 0)->timestamp;
+    if (pub->count < pub->batch_size && (int32_t)age < (int32_t)pub->max_age_s) {
+        return 0;
+    }
+
+    // As many samples as fit: exactly batch_size in steady state, more while draining a backlog
+    size_t rows = 0;
+    size_t count = 0;
+    while (count < pub->count) {
+        size_t row = row_size(pub, count);
+        size_t extra = pub->format == RG_MQTT_FORMAT_JSON ? 1 : 0;
+        if (frame_size(pub, count + 1, now, node) + rows + row + extra > size) {
+            break;
+        }
+        rows += row;
+        count++;
+    }
+    size_t len = count ? rg_mqtt_encode(pub, count, now, node, buf, size) : 0;
+    if (len > 0) {
+        pub->in_flight = count;
+        pub->in_flight_payload = len;
+    }
+    return len;
+}
+
+void rg_mqtt_publisher_acked(rg_mqtt_publisher_t *pub)
+{
+    if (pub->in_flight == 0) {
+        return;
+    }
+    pub->head = (pub->head + pub->in_flight) % pub->capacity;
+    pub->count -= pub->in_flight;
+    pub->stats.messages++;
+    pub->stats.samples += (uint32_t)pub->in_flight;
+    pub->stats.payload_bytes += (uint32_t)pub->in_flight_payload;
+    pub->stats.wire_bytes += (uint32_t)rg_mqtt_publish_wire_bytes(pub->topic_len, pub->in_flight_payload, 1);
+    pub->in_flight = 0;
+    pub->in_flight_payload = 0;
+}
+
+void rg_mqtt_publisher_failed(rg_mqtt_publisher_t *pub)
+{
+    pub->in_flight = 0;
+    pub->in_flight_payload = 0;
+}
+
+void rg_mqtt_publisher_write_metrics(const rg_mqtt_publisher_t *pub, rg_metrics_writer_t *writer)
+{
+    static const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        size_t offset;
+    } counters[] = {
+        {"rg_mqtt_messages_total", "counter", "Batches acknowledged by the broker.",
+         offsetof(rg_mqtt_publisher_stats_t, messages)},
+        {"rg_mqtt_samples_total", "counter", "Samples delivered in those batches.",
+         offsetof(rg_mqtt_publisher_stats_t, samples)},
+        {"rg_mqtt_payload_bytes_total", "counter", "Payload bytes delivered.",
+         offsetof(rg_mqtt_publisher_stats_t, payload_bytes)},
+        {"rg_mqtt_wire_bytes_total", "counter", "MQTT bytes for delivered batches, PUBACK included.",
+         offsetof(rg_mqtt_publisher_stats_t, wire_bytes)},
+        {"rg_mqtt_resent_total", "counter", "Batches sent again after the connection dropped mid-publish.",
+         offsetof(rg_mqtt_publisher_stats_t, resent)},
+        {"rg_mqtt_dropped_samples_total", "counter", "Samples pushed out of the full offline queue.",
+         offsetof(rg_mqtt_publisher_stats_t, dropped)},
+    };
+
+    rg_metrics_write_family(writer, "rg_mqtt_connected", "gauge", "1 while connected to the broker.");
+    rg_metrics_write_value(writer, "rg_mqtt_connected", NULL, pub->connected ? 1 : 0);
+    rg_metrics_write_family(writer, "rg_mqtt_queue_samples", "gauge", "Samples waiting to be delivered.");
+    rg_metrics_write_value(writer, "rg_mqtt_queue_samples", NULL, (uint32_t)pub->count);
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        uint32_t value;
+        memcpy(&value, (const uint8_t *)&pub->stats + counters[i].offset, sizeof(value));
+        rg_metrics_write_family(writer, counters[i].name, counters[i].type, counters[i].help);
+        rg_metrics_write_value(writer, counters[i].name, NULL, value);
+    }
+}
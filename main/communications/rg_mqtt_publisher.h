@@ -0,0 +1,142 @@
+// main/communications/rg_mqtt_publisher.h
+#ifndef RG_MQTT_PUBLISHER_H_
+#define RG_MQTT_PUBLISHER_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "services/metrics/rg_metrics.h"
+
+// Batching and offline queue for publishing samples over MQTT.
+//
+// Samples go into a bounded ring. A batch is published once batch_size
+// samples are waiting or the oldest one is max_age_s old; while the broker
+// is unreachable samples keep accumulating, the oldest being dropped when
+// the ring is full, and after reconnecting the backlog drains in batches as
+// large as the payload buffer allows.
+//
+// One batch is in flight at a time. It stays in the ring until the broker
+// acknowledges it (QoS 1), so a connection lost mid-publish resends it:
+// delivery is at least once and the backend drops duplicates by timestamp.
+//
+// Payload, JSON or CBOR with the same structure:
+//
+//   {"n":"rg2-a1b2c3","now":86412,"t0":86340,"s":[[0,2137,4852,10132],[30,2139,4850,10132],...]}
+//
+// n is the node name, now the node's clock when the payload was built, t0 the
+// timestamp of the first sample and each row [dt, t, h, p] with dt the
+// seconds since the previous sample (0 for the first). Timestamps are on the
+// rg_history time line; the backend maps them to wall time with
+// receive_time - (now - t). Units as in rg_history: 0.01 degC, 0.01 %RH,
+// 0.1 hPa.
+//
+// The engine is not thread-safe; rg_mqtt_task.h owns it on the device.
+
+typedef enum {
+    RG_MQTT_FORMAT_JSON = 0,
+    RG_MQTT_FORMAT_CBOR,
+} rg_mqtt_format_t;
+
+typedef struct {
+    uint32_t timestamp;  // rg_history time line, seconds
+    int16_t temperature; // 0.01 degC
+    uint16_t humidity;   // 0.01 %RH
+    uint16_t pressure;   // 0.1 hPa
+} rg_mqtt_sample_t;
+
+typedef struct {
+    uint32_t messages;      // Batches acknowledged by the broker
+    uint32_t samples;       // Samples in those batches
+    uint32_t payload_bytes; // Payload bytes of those batches
+    uint32_t wire_bytes;    // MQTT bytes of those batches, PUBACK included
+    uint32_t resent;        // Batches built again after the connection dropped mid-publish
+    uint32_t dropped;       // Samples pushed out of a full queue
+} rg_mqtt_publisher_stats_t;
+
+typedef struct {
+    rg_mqtt_sample_t *samples; // Caller storage for the ring
+    size_t capacity;
+    size_t head;               // Oldest sample
+    size_t count;
+    size_t batch_size;
+    uint32_t max_age_s;
+    rg_mqtt_format_t format;
+    bool connected;
+    size_t in_flight;          // Samples at the head of the ring awaiting PUBACK; 0 if none
+    size_t in_flight_payload;  // Their payload size, for the stats
+    size_t topic_len;          // For the wire byte accounting
+    rg_mqtt_publisher_stats_t stats;
+} rg_mqtt_publisher_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes @p pub over caller-provided @p storage of @p capacity samples.
+ *
+ * @param topic_len Length of the publish topic, used only for the wire byte accounting.
+ */
+void rg_mqtt_publisher_init(rg_mqtt_publisher_t *pub, rg_mqtt_sample_t *storage, size_t capacity,
+                            size_t batch_size, uint32_t max_age_s, rg_mqtt_format_t format, size_t topic_len);
+
+/**
+ * @brief Queues one sample, dropping the oldest one if the queue is full.
+ */
+void rg_mqtt_publisher_push(rg_mqtt_publisher_t *pub, const rg_mqtt_sample_t *sample);
+
+/**
+ * @brief Records a broker connection change. A batch still awaiting its PUBACK
+ * when the connection drops is built again by the next rg_mqtt_publisher_next().
+ */
+void rg_mqtt_publisher_set_connected(rg_mqtt_publisher_t *pub, bool connected);
+
+/**
+ * @brief Builds the next batch if one is due at @p now and none is in flight.
+ *
+ * Encodes as many queued samples as fit in @p buf and marks them in flight.
+ *
+ * @return Payload length, or 0 if nothing is to be sent (not connected, a batch
+ * in flight, batch not due, or @p buf too small for one sample).
+ */
+size_t rg_mqtt_publisher_next(rg_mqtt_publisher_t *pub, uint32_t now, const char *node, uint8_t *buf,
+                              size_t size);
+
+/**
+ * @brief Removes the batch in flight from the queue once the broker acknowledged it.
+ */
+void rg_mqtt_publisher_acked(rg_mqtt_publisher_t *pub);
+
+/**
+ * @brief Returns the batch in flight to the queue when its publish could not
+ * be handed to the client; the next rg_mqtt_publisher_next() builds it again.
+ */
+void rg_mqtt_publisher_failed(rg_mqtt_publisher_t *pub);
+
+/**
+ * @brief Encodes the @p count oldest queued samples as one payload.
+ *
+ * @return Payload length, or 0 if it does not fit in @p size.
+ */
+size_t rg_mqtt_encode(const rg_mqtt_publisher_t *pub, size_t count, uint32_t now, const char *node, uint8_t *buf,
+                      size_t size);
+
+/**
+ * @brief Bytes an MQTT 3.1.1 PUBLISH of @p payload_len takes on the wire,
+ * plus the PUBACK for QoS 1.
+ */
+size_t rg_mqtt_publish_wire_bytes(size_t topic_len, size_t payload_len, int qos);
+
+/**
+ * @brief Writes the publisher counters and queue depth to /metrics.
+ */
+void rg_mqtt_publisher_write_metrics(const rg_mqtt_publisher_t *pub, rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_MQTT_PUBLISHER_H_ */
@@ -0,0 +1,238 @@
+// main/communications/rg_mqtt_task.c
+#include "rg_mqtt_task.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+#include "rg_mqtt_publisher.h"
+#include "services/history/rg_history.h"
+#include "services/log/rg_tlog.h"
+#include "services/metrics/rg_metrics.h"
+#include "services/rtos/rg_static_alloc.h"
+#include <sdkconfig.h>
+
+#if CONFIG_RG_MQTT_ENABLE
+
+static const char *TAG = "RG_MQTT";
+
+// Input queue between the sensor task, the MQTT client task and the publisher
+#define INBOX_LEN 16
+// How often a partial batch is checked against the maximum age
+#define AGE_CHECK_MS 1000
+
+typedef enum {
+    MSG_SAMPLE,
+    MSG_CLIENT_EVENT, // Wake-up only: the state is in the atomics below
+} msg_type_t;
+
+typedef struct {
+    msg_type_t type;
+    rg_mqtt_sample_t sample;
+} msg_t;
+
+static rg_mqtt_publisher_t s_pub;
+static rg_mqtt_sample_t s_samples[CONFIG_RG_MQTT_QUEUE_LEN];
+static uint8_t s_payload[CONFIG_RG_MQTT_PAYLOAD_MAX];
+static esp_mqtt_client_handle_t s_client = NULL;
+static QueueHandle_t s_inbox = NULL;
+// Held by the publisher task around engine calls, and by the metrics collector
+// while it copies the engine; never across network I/O
+static SemaphoreHandle_t s_lock = NULL;
+RG_QUEUE_STORAGE(s_inbox, INBOX_LEN, sizeof(msg_t));
+RG_MUTEX_STORAGE(s_lock);
+RG_TASK_STORAGE(s_task, 3072);
+// Written by the MQTT client task, read by the publisher task. The client task
+// never waits for the publisher, which may be blocked in the client's own lock.
+static bool s_connected = false;
+static uint32_t s_link_changes = 0; // Connects and disconnects so far
+static int s_acked_id = -1;         // msg_id of the latest PUBACK
+static char s_node[16];
+static char s_topic[64];
+static uint32_t s_dropped = 0;
+
+static long clamp(long v, long lo, long hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Runs on the MQTT client task: records what the publisher needs and wakes it, never blocking
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+    case MQTT_EVENT_DISCONNECTED:
+        __atomic_store_n(&s_connected, event_id == MQTT_EVENT_CONNECTED, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s_link_changes, 1, __ATOMIC_RELEASE);
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        __atomic_store_n(&s_acked_id, event->msg_id, __ATOMIC_RELEASE);
+        break;
+    default:
+        return;
+    }
+    // A full inbox already has the publisher busy, and it reads the state above on every pass
+    const msg_t msg = {.type = MSG_CLIENT_EVENT};
+    xQueueSend(s_inbox, &msg, 0);
+}
+
+// Owns the publisher: queues samples, follows the connection and keeps one batch in flight
+static void mqtt_task(void *pvParameter)
+{
+    int in_flight_id = -1;
+    uint32_t link_changes = 0;
+    msg_t msg;
+
+    while (1) {
+        bool received = xQueueReceive(s_inbox, &msg, pdMS_TO_TICKS(AGE_CHECK_MS)) == pdTRUE;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (received && msg.type == MSG_SAMPLE) {
+            rg_mqtt_publisher_push(&s_pub, &msg.sample);
+        }
+
+        // Any connect or disconnect since the last pass gives up the batch in flight,
+        // even if the link is back up already
+        const uint32_t changes = __atomic_load_n(&s_link_changes, __ATOMIC_ACQUIRE);
+        if (changes != link_changes) {
+            link_changes = changes;
+            rg_mqtt_publisher_set_connected(&s_pub, false);
+            in_flight_id = -1;
+            if (__atomic_load_n(&s_connected, __ATOMIC_RELAXED)) {
+                ESP_LOGI(TAG, "Connected to %s, %u samples queued.", CONFIG_RG_MQTT_BROKER_URI,
+                         (unsigned)s_pub.count);
+                rg_mqtt_publisher_set_connected(&s_pub, true);
+            } else {
+                ESP_LOGW(TAG, "Disconnected from the broker, queueing samples.");
+            }
+        }
+        // A PUBACK for a batch given up on at a disconnect is stale
+        if (in_flight_id >= 0 && __atomic_load_n(&s_acked_id, __ATOMIC_ACQUIRE) == in_flight_id) {
+            rg_mqtt_publisher_acked(&s_pub);
+            in_flight_id = -1;
+        }
+
+        size_t len = rg_mqtt_publisher_next(&s_pub, rg_history_now(), s_node, s_payload, sizeof(s_payload));
+        xSemaphoreGive(s_lock);
+
+        // A QoS 1 write can block for the transport timeout; s_payload is only touched by this task
+        if (len > 0) {
+            in_flight_id = esp_mqtt_client_publish(s_client, s_topic, (const char *)s_payload, (int)len, 1, 0);
+            if (in_flight_id < 0) {
+                xSemaphoreTake(s_lock, portMAX_DELAY);
+                ESP_LOGW(TAG, "Failed to publish %u samples, will retry.", (unsigned)s_pub.in_flight);
+                rg_mqtt_publisher_failed(&s_pub);
+                xSemaphoreGive(s_lock);
+            }
+        }
+    }
+}
+
+// Runs on the httpd task: copies the engine so a slow scrape never holds the publisher up
+static void collect_mqtt(rg_metrics_writer_t *writer)
+{
+    rg_mqtt_publisher_t snapshot;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    snapshot = s_pub;
+    xSemaphoreGive(s_lock);
+    rg_mqtt_publisher_write_metrics(&snapshot, writer);
+}
+
+esp_err_t rg_mqtt_task_start(void)
+{
+    if (s_inbox) {
+        return ESP_OK;
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_node, sizeof(s_node), "rg2-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    snprintf(s_topic, sizeof(s_topic), "%s/%s/samples", CONFIG_RG_MQTT_TOPIC_PREFIX, s_node);
+
+#if CONFIG_RG_MQTT_PAYLOAD_CBOR
+    const rg_mqtt_format_t format = RG_MQTT_FORMAT_CBOR;
+#else
+    const rg_mqtt_format_t format = RG_MQTT_FORMAT_JSON;
+#endif
+    rg_mqtt_publisher_init(&s_pub, s_samples, CONFIG_RG_MQTT_QUEUE_LEN, CONFIG_RG_MQTT_BATCH_SIZE,
+                           CONFIG_RG_MQTT_BATCH_MAX_AGE_S, format, strlen(s_topic));
+
+    s_lock = RG_MUTEX_CREATE(s_lock);
+    s_inbox = RG_QUEUE_CREATE(s_inbox);
+    if (!s_lock || !s_inbox) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_mqtt_client_config_t cfg = {
+        .broker.address.uri = CONFIG_RG_MQTT_BROKER_URI,
+        .credentials.client_id = s_node,
+    };
+    s_client = esp_mqtt_client_init(&cfg);
+    if (!s_client) {
+        ESP_LOGE(TAG, "Failed to create the MQTT client.");
+        return ESP_FAIL;
+    }
+    esp_mqtt_client_register_event(s_client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+
+    // Same priority as the flash log writer: below the sensor task
+    if (RG_TASK_CREATE(s_task, mqtt_task, "mqtt_pub", NULL, 2) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = esp_mqtt_client_start(s_client);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the MQTT client: %s", esp_err_to_name(err));
+        return err;
+    }
+    rg_metrics_register_collector(collect_mqtt);
+
+    ESP_LOGI(TAG, "Publishing to %s on %s as %s, batches of %d.", s_topic, CONFIG_RG_MQTT_BROKER_URI,
+             format == RG_MQTT_FORMAT_CBOR ? "CBOR" : "JSON", CONFIG_RG_MQTT_BATCH_SIZE);
+    return ESP_OK;
+}
+
+bool rg_mqtt_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    if (!s_inbox) {
+        return false;
+    }
+
+    msg_t msg = {
+        .type = MSG_SAMPLE,
+        .sample =
+            {
+                .timestamp = timestamp,
+                .temperature = (int16_t)clamp(lroundf(temperature * 100.0f), INT16_MIN, INT16_MAX),
+                .humidity = (uint16_t)clamp(lroundf(humidity * 100.0f), 0, 10000),
+                .pressure = (uint16_t)clamp(lroundf(pressure * 10.0f), 0, UINT16_MAX),
+            },
+    };
+    if (xQueueSend(s_inbox, &msg, 0) != pdTRUE) {
+        if ((s_dropped++ % 16) == 0) {
+            RG_TLOGW(TAG, "MQTT input queue full, %lu samples dropped so far.", (unsigned long)s_dropped);
+        }
+        return false;
+    }
+    return true;
+}
+
+#else // !CONFIG_RG_MQTT_ENABLE
+
+esp_err_t rg_mqtt_task_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool rg_mqtt_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    return false;
+}
+
+#endif // CONFIG_RG_MQTT_ENABLE
@@ -0,0 +1,39 @@
+// main/communications/rg_mqtt_task.h
+#ifndef RG_MQTT_TASK_H_
+#define RG_MQTT_TASK_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts the MQTT client and the publisher task.
+ *
+ * Samples are published to "<CONFIG_RG_MQTT_TOPIC_PREFIX>/rg2-<mac>/samples"
+ * in batches (see rg_mqtt_publisher.h). The client reconnects on its own after
+ * Wi-Fi comes back; the offline queue then drains. Call after Wi-Fi is started.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if MQTT is disabled in Kconfig.
+ */
+esp_err_t rg_mqtt_task_start(void);
+
+/**
+ * @brief Queues one sample for publishing. Never blocks.
+ *
+ * @param timestamp Seconds on the rg_history time line.
+ * @return false if the publisher is not running or its input queue is full (sample dropped).
+ */
+bool rg_mqtt_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_MQTT_TASK_H_ */
@@ -8,19 +8,21 @@
 // Define the Wi-Fi manager NVS namespace
 static const char *wifi_manager_nvs_namespace = "espwifimgr";
 
-static const std::string WTEMPTAG = std::string(DEVICE_NAME) + "-" + DEVICE_VERSION + "::WiFi";
-static const char *WIFI_TAG = WTEMPTAG.c_str();
+static const char *WIFI_TAG = DEVICE_NAME "-" DEVICE_VERSION "::WiFi";
 
 void cb_connection_ok(void *pvParameter) {
     ip_event_got_ip_t *param = (ip_event_got_ip_t *)pvParameter;
 
     // Transform IP to human-readable string
-    esp_ip4addr_ntoa(&param->ip_info.ip, shared_data.ip_address, sizeof(shared_data.ip_address));
+    char ip_address[16];
+    esp_ip4addr_ntoa(&param->ip_info.ip, ip_address, sizeof(ip_address));
+    shared_data_set_ip_address(ip_address);
 
-    ESP_LOGI(WIFI_TAG, "Connected to Wi-Fi. IP Address: %s", shared_data.ip_address);
+    ESP_LOGI(WIFI_TAG, "Connected to Wi-Fi. IP Address: %s", ip_address);
     
-    // Attach RG endpoint to HTTP server
-    http_app_set_handler_hook(HTTP_GET, &my_get_handler);
+    // Attach the RG routes to the HTTP server; the router answers methods a route does not take with 405
+    http_app_set_handler_hook(HTTP_GET, &rg_http_handle_request);
+    http_app_set_handler_hook(HTTP_POST, &rg_http_handle_request);
 
 }
 
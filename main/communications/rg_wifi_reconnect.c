@@ -0,0 +1,104 @@
+// main/communications/rg_wifi_reconnect.c
+#include "rg_wifi_reconnect.h"
+
+#include <string.h>
+
+static rg_wifi_action_t attempt(rg_wifi_reconnect_t *r, bool cached)
+{
+    r->state = RG_WIFI_STATE_CONNECTING;
+    r->attempt_cached = cached && r->cache.channel != 0;
+    if (r->attempt_cached) {
+        r->stats.cached_attempts++;
+        return RG_WIFI_ACTION_CONNECT_CACHED;
+    }
+    r->stats.scan_attempts++;
+    return RG_WIFI_ACTION_CONNECT_SCAN;
+}
+
+void rg_wifi_reconnect_init(rg_wifi_reconnect_t *r, const rg_wifi_ap_t *cache, uint32_t backoff_min_ms,
+                            uint32_t backoff_max_ms)
+{
+    memset(r, 0, sizeof(*r));
+    if (cache && cache->channel != 0) {
+        r->cache = *cache;
+    }
+    r->backoff_min_ms = backoff_min_ms ? backoff_min_ms : 1;
+    r->backoff_max_ms = backoff_max_ms < r->backoff_min_ms ? r->backoff_min_ms : backoff_max_ms;
+}
+
+rg_wifi_action_t rg_wifi_reconnect_start(rg_wifi_reconnect_t *r)
+{
+    r->rounds = 0;
+    return attempt(r, true);
+}
+
+rg_wifi_action_t rg_wifi_reconnect_on_disconnected(rg_wifi_reconnect_t *r, uint32_t *wait_ms)
+{
+    switch (r->state) {
+    case RG_WIFI_STATE_CONNECTED:
+        // The link was up: most likely the same AP is back in a moment
+        r->rounds = 0;
+        return attempt(r, true);
+    case RG_WIFI_STATE_CONNECTING:
+        r->stats.failures++;
+        if (r->attempt_cached) {
+            // The AP may have moved channel or been replaced; scan now rather than wait
+            return attempt(r, false);
+        }
+        break;
+    default:
+        return RG_WIFI_ACTION_NONE; // Already waiting, or not started
+    }
+
+    uint32_t delay = r->backoff_min_ms;
+    for (uint8_t i = 0; i < r->rounds && delay < r->backoff_max_ms; i++) {
+        delay *= 2;
+    }
+    if (r->rounds < UINT8_MAX) {
+        r->rounds++;
+    }
+    *wait_ms = delay < r->backoff_max_ms ? delay : r->backoff_max_ms;
+    r->state = RG_WIFI_STATE_BACKOFF;
+    return RG_WIFI_ACTION_WAIT;
+}
+
+rg_wifi_action_t rg_wifi_reconnect_on_timer(rg_wifi_reconnect_t *r)
+{
+    if (r->state != RG_WIFI_STATE_BACKOFF) {
+        return RG_WIFI_ACTION_NONE;
+    }
+    // An AP that rebooted comes back with the same BSSID and channel
+    return attempt(r, true);
+}
+
+bool rg_wifi_reconnect_on_connected(rg_wifi_reconnect_t *r, const rg_wifi_ap_t *ap)
+{
+    r->stats.connects++;
+    if (r->state == RG_WIFI_STATE_CONNECTING && r->attempt_cached) {
+        r->stats.cached_connects++;
+    }
+    r->state = RG_WIFI_STATE_CONNECTED;
+    r->rounds = 0;
+    if (ap->channel == 0 || memcmp(ap, &r->cache, sizeof(*ap)) == 0) {
+        return false;
+    }
+    r->cache = *ap;
+    return true;
+}
+
+rg_wifi_action_t rg_wifi_reconnect_forget(rg_wifi_reconnect_t *r)
+{
+    memset(&r->cache, 0, sizeof(r->cache));
+    r->rounds = 0;
+    switch (r->state) {
+    case RG_WIFI_STATE_CONNECTED:
+    case RG_WIFI_STATE_CONNECTING:
+        // The disconnect then counts as a dropped link, not a failed attempt
+        r->state = RG_WIFI_STATE_CONNECTED;
+        return RG_WIFI_ACTION_DISCONNECT;
+    case RG_WIFI_STATE_BACKOFF:
+        return attempt(r, false);
+    default:
+        return RG_WIFI_ACTION_NONE;
+    }
+}
@@ -0,0 +1,111 @@
+// main/communications/rg_wifi_reconnect.h
+#ifndef RG_WIFI_RECONNECT_H_
+#define RG_WIFI_RECONNECT_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// When and how the station (re)connects.
+//
+// After a power blip the access point is almost always the one we were on,
+// on the same channel. Connecting to its cached BSSID with a fast scan of
+// that one channel skips the scan of all channels, which takes about as long
+// as the rest of the connect. So: try the cached AP first, fall back to a
+// full scan at once if that fails, and back off exponentially between
+// rounds while the network stays down. A link that drops after being up
+// starts over with the cache straight away.
+//
+// Pure logic: rg_wifi_sta.c feeds it Wi-Fi events and carries out the
+// actions it returns; the cache is persisted in NVS by the caller.
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel; // 0: no cached AP
+} rg_wifi_ap_t;
+
+typedef enum {
+    RG_WIFI_ACTION_NONE,
+    RG_WIFI_ACTION_CONNECT_CACHED, // Connect to cache.bssid, scanning only cache.channel
+    RG_WIFI_ACTION_CONNECT_SCAN,   // Scan all channels and connect to the strongest AP
+    RG_WIFI_ACTION_WAIT,           // Call rg_wifi_reconnect_on_timer() after the returned delay
+    RG_WIFI_ACTION_DISCONNECT,     // Drop the link; its disconnect starts a fresh attempt
+} rg_wifi_action_t;
+
+typedef enum {
+    RG_WIFI_STATE_IDLE,
+    RG_WIFI_STATE_CONNECTING,
+    RG_WIFI_STATE_CONNECTED,
+    RG_WIFI_STATE_BACKOFF,
+} rg_wifi_state_t;
+
+typedef struct {
+    uint32_t cached_attempts;
+    uint32_t scan_attempts;
+    uint32_t connects;
+    uint32_t cached_connects; // Connects that skipped the full scan
+    uint32_t failures;        // Attempts that ended without a connection
+} rg_wifi_reconnect_stats_t;
+
+typedef struct {
+    rg_wifi_state_t state;
+    rg_wifi_ap_t cache;
+    bool attempt_cached; // The attempt in progress uses the cache
+    uint8_t rounds;      // Failed rounds (cached and scan) since the last connect
+    uint32_t backoff_min_ms;
+    uint32_t backoff_max_ms;
+    rg_wifi_reconnect_stats_t stats;
+} rg_wifi_reconnect_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @param cache The AP persisted from the last connection, or NULL.
+ */
+void rg_wifi_reconnect_init(rg_wifi_reconnect_t *r, const rg_wifi_ap_t *cache, uint32_t backoff_min_ms,
+                            uint32_t backoff_max_ms);
+
+/**
+ * @brief First connect after the station started.
+ */
+rg_wifi_action_t rg_wifi_reconnect_start(rg_wifi_reconnect_t *r);
+
+/**
+ * @brief The station disconnected or an attempt failed.
+ *
+ * @param wait_ms Set for RG_WIFI_ACTION_WAIT.
+ */
+rg_wifi_action_t rg_wifi_reconnect_on_disconnected(rg_wifi_reconnect_t *r, uint32_t *wait_ms);
+
+/**
+ * @brief The backoff delay of a RG_WIFI_ACTION_WAIT has passed.
+ */
+rg_wifi_action_t rg_wifi_reconnect_on_timer(rg_wifi_reconnect_t *r);
+
+/**
+ * @brief The station associated with @p ap.
+ *
+ * @return true if the cache changed and should be persisted.
+ */
+bool rg_wifi_reconnect_on_connected(rg_wifi_reconnect_t *r, const rg_wifi_ap_t *ap);
+
+/**
+ * @brief The network or its credentials changed: the cached AP is no use any more.
+ *
+ * Clears the cache, which the caller persists, and the backoff. A link that
+ * is up or being set up is dropped so the next attempt scans for the new
+ * network at once; a pending backoff is cut short.
+ *
+ * @return RG_WIFI_ACTION_DISCONNECT, RG_WIFI_ACTION_CONNECT_SCAN while
+ *         backing off (cancel the timer), or RG_WIFI_ACTION_NONE before start.
+ */
+rg_wifi_action_t rg_wifi_reconnect_forget(rg_wifi_reconnect_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_WIFI_RECONNECT_H_ */
@@ -0,0 +1,335 @@
+// main/communications/rg_wifi_sta.c
+#include "rg_wifi_sta.h"
+
+#include <string.h>
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "rg_wifi_reconnect.h"
+#include "services/boot/rg_boot.h"
+#include "services/config/rg_config_task.h"
+#include "services/shared_data/shared_data.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_WIFI";
+
+#define NVS_NAMESPACE "rg_wifi"
+#define NVS_KEY_AP "ap"
+#define NVS_KEY_GOOD "good"
+
+// Backoff expiry, settings changes and the end of a credentials trial, posted
+// to the event loop so every engine call runs on its task
+ESP_EVENT_DEFINE_BASE(RG_WIFI_EVENT);
+enum {
+    RG_WIFI_EVENT_RETRY,
+    RG_WIFI_EVENT_CREDENTIALS,
+    RG_WIFI_EVENT_TRIAL_EXPIRED,
+};
+
+typedef struct {
+    char ssid[RG_SETTINGS_SSID_MAX + 1];
+    char password[RG_SETTINGS_PASSWORD_MAX + 1];
+} credentials_t;
+
+static rg_wifi_reconnect_t s_reconnect;
+static esp_timer_handle_t s_retry_timer = NULL;
+// Credentials that last got an IP address, kept in NVS. New ones run on
+// trial: if they have not got an address when s_trial_timer fires, the
+// settings go back to these.
+static credentials_t s_good;
+static esp_timer_handle_t s_trial_timer = NULL;
+static bool s_reverting = false; // The next settings change is our own fallback
+
+static void current_credentials(credentials_t *out)
+{
+    const rg_config_t *config = rg_config_task_config();
+    memset(out, 0, sizeof(*out));
+    rg_config_get_string(config, RG_SETTING_WIFI_SSID, out->ssid, sizeof(out->ssid));
+    rg_config_get_string(config, RG_SETTING_WIFI_PASSWORD, out->password, sizeof(out->password));
+}
+
+static bool same_credentials(const credentials_t *a, const credentials_t *b)
+{
+    return strcmp(a->ssid, b->ssid) == 0 && strcmp(a->password, b->password) == 0;
+}
+
+static void load_cached_ap(rg_wifi_ap_t *ap)
+{
+    memset(ap, 0, sizeof(*ap));
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(*ap);
+    if (nvs_get_blob(handle, NVS_KEY_AP, ap, &len) != ESP_OK || len != sizeof(*ap)) {
+        memset(ap, 0, sizeof(*ap));
+    }
+    nvs_close(handle);
+}
+
+static esp_err_t save_blob(const char *key, const void *value, size_t len)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, key, value, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    return err;
+}
+
+// Only called when the AP changed, so a stable network never writes flash
+static void save_cached_ap(const rg_wifi_ap_t *ap)
+{
+    esp_err_t err = save_blob(NVS_KEY_AP, ap, sizeof(*ap));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to cache the access point: %s", esp_err_to_name(err));
+    }
+}
+
+static void load_good_credentials(credentials_t *good)
+{
+    memset(good, 0, sizeof(*good));
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(*good);
+    if (nvs_get_blob(handle, NVS_KEY_GOOD, good, &len) != ESP_OK || len != sizeof(*good)) {
+        memset(good, 0, sizeof(*good));
+    }
+    nvs_close(handle);
+}
+
+// On every IP address; writes flash only when the credentials are new
+static void credentials_proven(void)
+{
+    esp_timer_stop(s_trial_timer);
+    credentials_t current;
+    current_credentials(&current);
+    if (same_credentials(&current, &s_good)) {
+        return;
+    }
+    s_good = current;
+    esp_err_t err = save_blob(NVS_KEY_GOOD, &s_good, sizeof(s_good));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to keep the working credentials: %s", esp_err_to_name(err));
+    }
+}
+
+static void start_trial(void)
+{
+    if (s_good.ssid[0] == '\0') {
+        return; // Nothing known to work to go back to
+    }
+    esp_timer_stop(s_trial_timer);
+    esp_timer_start_once(s_trial_timer, (uint64_t)CONFIG_RG_WIFI_FALLBACK_S * 1000000);
+}
+
+// The new credentials did not get an address in time: the settings go back
+// to the ones that worked, which reconnects through credentials_changed()
+static void fall_back(void)
+{
+    credentials_t current;
+    current_credentials(&current);
+    if (same_credentials(&current, &s_good)) {
+        return;
+    }
+    ESP_LOGW(TAG, "No connection to %s within %d s, going back to %s.", current.ssid, CONFIG_RG_WIFI_FALLBACK_S,
+             s_good.ssid);
+    static const char *const names[] = {"wifi_ssid", "wifi_password"};
+    const char *const values[] = {s_good.ssid, s_good.password};
+    s_reverting = true;
+    esp_err_t err = rg_config_task_set(names, values, 2, NULL);
+    if (err != ESP_OK) {
+        s_reverting = false;
+        ESP_LOGE(TAG, "Failed to restore the Wi-Fi settings: %s", esp_err_to_name(err));
+    }
+}
+
+static void apply(rg_wifi_action_t action, uint32_t wait_ms)
+{
+    // The driver takes a 32-byte SSID and a 64-byte key without terminators
+    const rg_config_t *config = rg_config_task_config();
+    char ssid[RG_SETTINGS_SSID_MAX + 1];
+    char password[RG_SETTINGS_PASSWORD_MAX + 1];
+    const size_t ssid_len = rg_config_get_string(config, RG_SETTING_WIFI_SSID, ssid, sizeof(ssid));
+    const size_t password_len = rg_config_get_string(config, RG_SETTING_WIFI_PASSWORD, password, sizeof(password));
+    wifi_config_t cfg = {};
+    memcpy(cfg.sta.ssid, ssid, ssid_len);
+    memcpy(cfg.sta.password, password, password_len);
+    cfg.sta.threshold.authmode = password_len ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+
+    switch (action) {
+    case RG_WIFI_ACTION_CONNECT_CACHED:
+        cfg.sta.bssid_set = true;
+        memcpy(cfg.sta.bssid, s_reconnect.cache.bssid, sizeof(cfg.sta.bssid));
+        cfg.sta.channel = s_reconnect.cache.channel;
+        cfg.sta.scan_method = WIFI_FAST_SCAN;
+        break;
+    case RG_WIFI_ACTION_CONNECT_SCAN:
+        cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        cfg.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+        break;
+    case RG_WIFI_ACTION_WAIT:
+        ESP_LOGW(TAG, "Wi-Fi down, retrying in %lu ms.", (unsigned long)wait_ms);
+        esp_timer_start_once(s_retry_timer, (uint64_t)wait_ms * 1000);
+        return;
+    case RG_WIFI_ACTION_DISCONNECT:
+        esp_wifi_disconnect();
+        return;
+    default:
+        return;
+    }
+
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    if (err == ESP_OK) {
+        err = esp_wifi_connect();
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to connect: %s", esp_err_to_name(err));
+    }
+}
+
+static void retry_timer_cb(void *arg)
+{
+    (void)arg;
+    esp_event_post(RG_WIFI_EVENT, RG_WIFI_EVENT_RETRY, NULL, 0, 0);
+}
+
+static void trial_timer_cb(void *arg)
+{
+    (void)arg;
+    esp_event_post(RG_WIFI_EVENT, RG_WIFI_EVENT_TRIAL_EXPIRED, NULL, 0, 0);
+}
+
+// Runs in the task that changed the settings; the event loop does the rest
+static void credentials_changed(void *ctx, int id)
+{
+    (void)ctx;
+    (void)id;
+    esp_event_post(RG_WIFI_EVENT, RG_WIFI_EVENT_CREDENTIALS, NULL, 0, 0);
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg;
+    uint32_t wait_ms = 0;
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        apply(rg_wifi_reconnect_start(&s_reconnect), 0);
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        const wifi_event_sta_connected_t *event = (const wifi_event_sta_connected_t *)data;
+        rg_wifi_ap_t ap;
+        memcpy(ap.bssid, event->bssid, sizeof(ap.bssid));
+        ap.channel = event->channel;
+        bool cached = s_reconnect.attempt_cached;
+        if (rg_wifi_reconnect_on_connected(&s_reconnect, &ap)) {
+            save_cached_ap(&ap);
+        }
+        ESP_LOGI(TAG, "Associated with %02x:%02x:%02x:%02x:%02x:%02x on channel %u%s.", ap.bssid[0], ap.bssid[1],
+                 ap.bssid[2], ap.bssid[3], ap.bssid[4], ap.bssid[5], ap.channel, cached ? " (cached)" : "");
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *event = (const wifi_event_sta_disconnected_t *)data;
+        ESP_LOGW(TAG, "Disconnected, reason %u.", event->reason);
+        apply(rg_wifi_reconnect_on_disconnected(&s_reconnect, &wait_ms), wait_ms);
+    } else if (base == RG_WIFI_EVENT && id == RG_WIFI_EVENT_RETRY) {
+        apply(rg_wifi_reconnect_on_timer(&s_reconnect), 0);
+    } else if (base == RG_WIFI_EVENT && id == RG_WIFI_EVENT_CREDENTIALS) {
+        char ssid[RG_SETTINGS_SSID_MAX + 1];
+        rg_config_get_string(rg_config_task_config(), RG_SETTING_WIFI_SSID, ssid, sizeof(ssid));
+        ESP_LOGI(TAG, "Wi-Fi settings changed, connecting to %s.", ssid);
+        if (s_reverting) {
+            s_reverting = false;
+            esp_timer_stop(s_trial_timer);
+        } else {
+            start_trial();
+        }
+        esp_timer_stop(s_retry_timer);
+        rg_wifi_action_t action = rg_wifi_reconnect_forget(&s_reconnect);
+        save_cached_ap(&s_reconnect.cache);
+        apply(action, 0);
+    } else if (base == RG_WIFI_EVENT && id == RG_WIFI_EVENT_TRIAL_EXPIRED) {
+        fall_back();
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *event = (const ip_event_got_ip_t *)data;
+        char ip_address[16];
+        esp_ip4addr_ntoa(&event->ip_info.ip, ip_address, sizeof(ip_address));
+        shared_data_set_ip_address(ip_address);
+        rg_boot_mark(RG_BOOT_MARK_GOT_IP, esp_timer_get_time());
+        credentials_proven();
+        ESP_LOGI(TAG, "Got IP address %s.", ip_address);
+    }
+}
+
+esp_err_t rg_wifi_sta_start(void)
+{
+    rg_wifi_ap_t cached;
+    load_cached_ap(&cached);
+    rg_wifi_reconnect_init(&s_reconnect, &cached, CONFIG_RG_WIFI_BACKOFF_MIN_MS, CONFIG_RG_WIFI_BACKOFF_MAX_MS);
+    load_good_credentials(&s_good);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry",
+    };
+    const esp_timer_create_args_t trial_args = {
+        .callback = trial_timer_cb,
+        .name = "wifi_trial",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_retry_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_create(&trial_args, &s_trial_timer);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    esp_netif_create_default_wifi_sta();
+    wifi_init_config_t init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    err = esp_wifi_init(&init_cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // The configuration is rebuilt for every attempt; keep the driver from writing it to flash each time
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+
+    err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, event_handler, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, event_handler, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(RG_WIFI_EVENT, ESP_EVENT_ANY_ID, event_handler, NULL);
+    }
+    if (err == ESP_OK) {
+        err = rg_config_task_subscribe(RG_SETTINGS_WIFI, credentials_changed, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_start(); // Connecting starts from WIFI_EVENT_STA_START
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Settings changed before a restart have not proven themselves yet either
+    credentials_t current;
+    current_credentials(&current);
+    if (!same_credentials(&current, &s_good)) {
+        start_trial();
+    }
+    if (cached.channel) {
+        ESP_LOGI(TAG, "Connecting to %s, cached AP on channel %u.", current.ssid, cached.channel);
+    } else {
+        ESP_LOGI(TAG, "Connecting to %s, no cached AP: scanning all channels.", current.ssid);
+    }
+    return ESP_OK;
+}
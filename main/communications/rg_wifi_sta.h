@@ -0,0 +1,34 @@
+// main/communications/rg_wifi_sta.h
+#ifndef RG_WIFI_STA_H_
+#define RG_WIFI_STA_H_
+
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts the station and keeps it connected to the wifi_ssid setting.
+ *
+ * Reconnects follow rg_wifi_reconnect.h: the AP of the last connection,
+ * kept in NVS, is tried first with a single-channel scan, then all channels,
+ * with exponential backoff while the network is down. Returns without
+ * waiting for the connection; the IP address is published to shared_data
+ * and recorded as the got_ip boot milestone. A change to the network name or
+ * password at /settings forgets the cached AP and reconnects at once. The
+ * new credentials are on trial: if they get no IP address within
+ * CONFIG_RG_WIFI_FALLBACK_S, even across a restart, the settings go back to
+ * the last ones that did.
+ *
+ * Needs NVS, the settings (rg_config_task.h), esp_netif and the default event loop.
+ */
+esp_err_t rg_wifi_sta_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_WIFI_STA_H_ */
@@ -0,0 +1,121 @@
+// main/communications/rg_zb_reporting.c
+#include "rg_zb_reporting.h"
+
+#include <string.h>
+
+void rg_zb_report_init(rg_zb_report_t *engine, uint32_t batch_window_ms)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->batch_window_ms = batch_window_ms;
+}
+
+int rg_zb_report_add(rg_zb_report_t *engine, const rg_zb_report_config_t *config)
+{
+    if (engine->count == RG_ZB_REPORT_MAX_ATTRS) {
+        return -1;
+    }
+    rg_zb_report_attr_t *attr = &engine->attrs[engine->count];
+    memset(attr, 0, sizeof(*attr));
+    attr->config = *config;
+    return (int)engine->count++;
+}
+
+void rg_zb_report_set(rg_zb_report_t *engine, int index, int32_t value)
+{
+    if (index < 0 || (size_t)index >= engine->count) {
+        return;
+    }
+    engine->attrs[index].value = value;
+    engine->attrs[index].valid = true;
+}
+
+// Sets *due_at to the time the attribute must be reported; false if it has nothing to report
+static bool attr_due_at(const rg_zb_report_attr_t *attr, uint32_t *due_at)
+{
+    if (!attr->valid) {
+        return false;
+    }
+    if (!attr->reported_once) {
+        *due_at = 0; // First value goes out right away
+        return true;
+    }
+
+    bool found = false;
+    int64_t diff = (int64_t)attr->value - attr->reported;
+    int64_t change = attr->config.reportable_change > 0 ? attr->config.reportable_change : 1;
+    if (diff >= change || -diff >= change) {
+        *due_at = attr->last_report_ms + attr->config.min_interval_ms;
+        found = true;
+    }
+    if (attr->config.max_interval_ms) {
+        uint32_t periodic = attr->last_report_ms + attr->config.max_interval_ms;
+        if (!found || (int32_t)(periodic - *due_at) < 0) {
+            *due_at = periodic;
+        }
+        found = true;
+    }
+    return found;
+}
+
+// Signed distance from now to due_at; the clock may wrap
+static int32_t until(uint32_t due_at, uint32_t now_ms)
+{
+    return (int32_t)(due_at - now_ms);
+}
+
+uint32_t rg_zb_report_due(const rg_zb_report_t *engine, uint32_t now_ms)
+{
+    uint32_t due = 0;
+    uint32_t soon = 0;
+    for (size_t i = 0; i < engine->count; i++) {
+        const rg_zb_report_attr_t *attr = &engine->attrs[i];
+        uint32_t due_at;
+        if (!attr_due_at(attr, &due_at)) {
+            continue;
+        }
+        if (!attr->reported_once || until(due_at, now_ms) <= 0) {
+            due |= 1u << i;
+        } else if (until(due_at, now_ms) <= (int32_t)engine->batch_window_ms &&
+                   now_ms - attr->last_report_ms >= attr->config.min_interval_ms) {
+            // Early by less than the window, and never inside the minimum interval
+            soon |= 1u << i;
+        }
+    }
+    // Only piggyback on a wakeup that sends something anyway
+    return due ? due | soon : 0;
+}
+
+void rg_zb_report_sent(rg_zb_report_t *engine, uint32_t mask, uint32_t now_ms)
+{
+    if (!mask) {
+        return;
+    }
+    for (size_t i = 0; i < engine->count; i++) {
+        if (mask & (1u << i)) {
+            rg_zb_report_attr_t *attr = &engine->attrs[i];
+            attr->reported = attr->value;
+            attr->last_report_ms = now_ms;
+            attr->reported_once = true;
+            engine->stats.reports++;
+        }
+    }
+    engine->stats.batches++;
+}
+
+uint32_t rg_zb_report_next_ms(const rg_zb_report_t *engine, uint32_t now_ms)
+{
+    uint32_t next = UINT32_MAX;
+    for (size_t i = 0; i < engine->count; i++) {
+        const rg_zb_report_attr_t *attr = &engine->attrs[i];
+        uint32_t due_at;
+        if (!attr_due_at(attr, &due_at)) {
+            continue;
+        }
+        int32_t wait = attr->reported_once ? until(due_at, now_ms) : 0;
+        uint32_t ms = wait > 0 ? (uint32_t)wait : 0;
+        if (ms < next) {
+            next = ms;
+        }
+    }
+    return next;
+}
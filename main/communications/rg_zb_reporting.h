@@ -0,0 +1,93 @@
+// main/communications/rg_zb_reporting.h
+#ifndef RG_ZB_REPORTING_H_
+#define RG_ZB_REPORTING_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reporting decisions for ZCL attributes, following the Configure Reporting
+// semantics of the ZCL spec (section 2.5.7):
+//
+//  - a changed value is reported once it differs from the last reported value
+//    by at least the reportable change, but never sooner than the minimum
+//    interval after the previous report;
+//  - an unchanged value is reported again when the maximum interval expires.
+//
+// When one attribute becomes due, every other attribute that would become due
+// within the batch window is sent with it, so one wakeup and one stack lock
+// cover all reports of a sample.
+//
+// Pure logic with the clock passed in; rg_zigbee.cpp drives it under the
+// Zigbee lock and the host tests drive it directly.
+
+#define RG_ZB_REPORT_MAX_ATTRS 8
+
+typedef struct {
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;  // 0 disables periodic reports
+    int32_t reportable_change; // In attribute units; 0 reports any change
+} rg_zb_report_config_t;
+
+typedef struct {
+    rg_zb_report_config_t config;
+    int32_t value;           // Latest value set by the application
+    int32_t reported;        // Value carried by the last report
+    uint32_t last_report_ms;
+    bool valid;              // A value has been set
+    bool reported_once;
+} rg_zb_report_attr_t;
+
+typedef struct {
+    uint32_t reports;  // Attribute reports sent
+    uint32_t batches;  // rg_zb_report_sent() calls with a non-empty mask
+} rg_zb_report_stats_t;
+
+typedef struct {
+    rg_zb_report_attr_t attrs[RG_ZB_REPORT_MAX_ATTRS];
+    size_t count;
+    uint32_t batch_window_ms;
+    rg_zb_report_stats_t stats;
+} rg_zb_report_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void rg_zb_report_init(rg_zb_report_t *engine, uint32_t batch_window_ms);
+
+/**
+ * @brief Registers an attribute.
+ *
+ * @return Index used with the other calls and as bit position in masks, or -1 if full.
+ */
+int rg_zb_report_add(rg_zb_report_t *engine, const rg_zb_report_config_t *config);
+
+/**
+ * @brief Stores the current value of attribute @p index.
+ */
+void rg_zb_report_set(rg_zb_report_t *engine, int index, int32_t value);
+
+/**
+ * @brief Attributes to report at @p now_ms, as a bit mask of indices (0 if nothing is due).
+ */
+uint32_t rg_zb_report_due(const rg_zb_report_t *engine, uint32_t now_ms);
+
+/**
+ * @brief Records that the attributes in @p mask were reported with their current values.
+ */
+void rg_zb_report_sent(rg_zb_report_t *engine, uint32_t mask, uint32_t now_ms);
+
+/**
+ * @brief Milliseconds until the next attribute becomes due, 0 if one is due now,
+ * UINT32_MAX if nothing is pending.
+ */
+uint32_t rg_zb_report_next_ms(const rg_zb_report_t *engine, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_ZB_REPORTING_H_ */
@@ -2,57 +2,128 @@
 #include "esp_log.h"
 #include "esp_zigbee_core.h"
 #include "zcl/esp_zigbee_zcl_common.h"
+#include "esp_timer.h"
 #include "constants.h"
+#include "rg_zb_reporting.h"
+#include "services/bus/rg_event_bus_task.h"
+#include "services/rtos/rg_static_alloc.h"
+
+#include <math.h>
 
 // Cluster IDs and attribute IDs are defined in esp_zigbee_zcl_common.h
 
-static const std::string ZTEMPTAG = std::string(DEVICE_NAME) + "-" + DEVICE_VERSION + "::Zigbee";
-static const char *RG_ZB_TAG = ZTEMPTAG.c_str();
+static const char *RG_ZB_TAG = DEVICE_NAME "-" DEVICE_VERSION "::Zigbee";
 
-// Zigbee attribute storage (global variables)
-int16_t zb_temperature_value = 0; // 0.01 degC
-uint16_t zb_humidity_value = 0;   // 0.01 %RH
+// Initial attribute values; the stack keeps its own copies, updated from the bus
+static int16_t zb_temperature_value = 0; // 0.01 degC
+static uint16_t zb_humidity_value = 0;   // 0.01 %RH
+static int16_t zb_pressure_value = 0;    // hPa (ZCL: 0.1 kPa)
 
-// Helper function to create temperature measurement cluster attribute list
-static esp_zb_attribute_list_t *create_temperature_cluster(void)
-{
-    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT);
-    esp_zb_cluster_add_attr(cluster,
-                           ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
-                           ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
-                           ESP_ZB_ZCL_ATTR_TYPE_U16,
-                           ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
-                           &zb_temperature_value);
-    return cluster;
-}
+// Attributes handed to the reporting engine, in the order they are registered
+typedef struct {
+    uint16_t cluster_id;
+    uint16_t attr_id;
+} zb_reported_attr_t;
+
+static const zb_reported_attr_t s_reported_attrs[] = {
+    {ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID},
+    {ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID},
+    {ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID},
+};
+enum { ZB_ATTR_TEMPERATURE = 0, ZB_ATTR_HUMIDITY, ZB_ATTR_PRESSURE, ZB_ATTR_COUNT };
+
+static rg_zb_report_t s_reporting;
+
+// Attribute reads only ever need the newest sample
+static void zigbee_sample(const rg_event_t *event, void *ctx);
+static rg_event_consumer_t s_consumer =
+    RG_EVENT_CONSUMER_INIT("zigbee", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE), zigbee_sample, NULL);
+RG_TASK_STORAGE(s_consumer_task, CONFIG_RG_EVENT_BUS_TASK_STACK);
 
-// Helper function to create humidity measurement cluster attribute list
-static esp_zb_attribute_list_t *create_humidity_cluster(void)
+// Read-only, reportable measured value attribute for a measurement cluster
+static esp_zb_attribute_list_t *create_measurement_cluster(uint16_t cluster_id, uint16_t attr_id, uint8_t attr_type, void *value)
 {
-    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT);
+    esp_zb_attribute_list_t *cluster = esp_zb_zcl_attr_list_create(cluster_id);
     esp_zb_cluster_add_attr(cluster,
-                           ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,
-                           ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID,
-                           ESP_ZB_ZCL_ATTR_TYPE_U16,
-                           ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY,
-                           &zb_humidity_value);
+                           cluster_id,
+                           attr_id,
+                           attr_type,
+                           ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING,
+                           value);
     return cluster;
 }
 
-// Create Zigbee cluster list with temperature and humidity clusters
+// Create Zigbee cluster list with temperature, humidity and pressure clusters
 static esp_zb_cluster_list_t *create_zigbee_cluster_list(void)
 {
     esp_zb_cluster_list_t *cluster_list = esp_zb_zcl_cluster_list_create();
 
-    esp_zb_attribute_list_t *temp_cluster = create_temperature_cluster();
+    // Temperature is signed in ZCL (int16, 0.01 degC)
+    esp_zb_attribute_list_t *temp_cluster = create_measurement_cluster(
+        ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, ESP_ZB_ZCL_ATTR_TYPE_S16, &zb_temperature_value);
     esp_zb_cluster_list_add_custom_cluster(cluster_list, temp_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
 
-    esp_zb_attribute_list_t *humidity_cluster = create_humidity_cluster();
+    esp_zb_attribute_list_t *humidity_cluster = create_measurement_cluster(
+        ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID, ESP_ZB_ZCL_ATTR_TYPE_U16, &zb_humidity_value);
     esp_zb_cluster_list_add_custom_cluster(cluster_list, humidity_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
 
+    esp_zb_attribute_list_t *pressure_cluster = create_measurement_cluster(
+        ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID, ESP_ZB_ZCL_ATTR_TYPE_S16, &zb_pressure_value);
+    esp_zb_cluster_list_add_custom_cluster(cluster_list, pressure_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+
     return cluster_list;
 }
 
+static void reporting_init(void)
+{
+    rg_zb_report_init(&s_reporting, CONFIG_RG_ZB_REPORT_BATCH_WINDOW_MS);
+
+    rg_zb_report_config_t config = {};
+    config.min_interval_ms = CONFIG_RG_ZB_REPORT_MIN_INTERVAL_S * 1000u;
+    config.max_interval_ms = CONFIG_RG_ZB_REPORT_MAX_INTERVAL_S * 1000u;
+
+    config.reportable_change = CONFIG_RG_ZB_REPORT_CHANGE_TEMPERATURE;
+    rg_zb_report_add(&s_reporting, &config);
+    config.reportable_change = CONFIG_RG_ZB_REPORT_CHANGE_HUMIDITY;
+    rg_zb_report_add(&s_reporting, &config);
+    config.reportable_change = CONFIG_RG_ZB_REPORT_CHANGE_PRESSURE;
+    rg_zb_report_add(&s_reporting, &config);
+}
+
+static uint32_t zb_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Sends every report that is due and re-arms the alarm for the next one.
+// Runs in the Zigbee task (alarm) or with the Zigbee lock held.
+static void zigbee_flush_reports(uint8_t param)
+{
+    (void)param;
+    uint32_t now = zb_now_ms();
+    uint32_t due = rg_zb_report_due(&s_reporting, now);
+
+    for (int i = 0; i < ZB_ATTR_COUNT; i++) {
+        if (!(due & (1u << i))) {
+            continue;
+        }
+        esp_zb_zcl_report_attr_cmd_t cmd = {};
+        cmd.zcl_basic_cmd.src_endpoint = HA_SENSOR_ENDPOINT;
+        cmd.address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT; // Bound devices
+        cmd.clusterID = s_reported_attrs[i].cluster_id;
+        cmd.attributeID = s_reported_attrs[i].attr_id;
+        cmd.direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI;
+        esp_zb_zcl_report_attr_cmd_req(&cmd);
+    }
+    rg_zb_report_sent(&s_reporting, due, now);
+
+    esp_zb_scheduler_alarm_cancel(zigbee_flush_reports, 0);
+    uint32_t next = rg_zb_report_next_ms(&s_reporting, now);
+    if (next != UINT32_MAX) {
+        esp_zb_scheduler_alarm(zigbee_flush_reports, 0, next);
+    }
+}
+
 void zigbee_init(void)
 {
     esp_zb_cfg_t zb_nwk_cfg = {
@@ -74,6 +145,7 @@ void zigbee_init(void)
     }
 
     esp_zb_cluster_list_t *cluster_list = create_zigbee_cluster_list();
+    reporting_init();
 
     esp_zb_endpoint_config_t endpoint_config = {
         .endpoint = HA_SENSOR_ENDPOINT,
@@ -88,23 +160,44 @@ void zigbee_init(void)
 
     ESP_ERROR_CHECK(esp_zb_start(true));
 
+    if (rg_event_bus_task_subscribe(&s_consumer) != ESP_OK ||
+        RG_TASK_CREATE(s_consumer_task, rg_event_bus_task_consume, "ev_zigbee", &s_consumer, 3) != pdPASS) {
+        ESP_LOGE(RG_ZB_TAG, "Failed to subscribe to sensor samples");
+    }
+
     ESP_LOGI(RG_ZB_TAG, "Zigbee router initialized successfully");
 }
 
-void zigbee_update_sensor_values(float temperature, float humidity)
+// Update Zigbee attributes from sensor readings (degC, %RH, hPa) and send
+// any attribute reports that became due. Takes the Zigbee lock.
+static void zigbee_update_sensor_values(float temperature, float humidity, float pressure)
+{
+    // Convert to Zigbee format: 0.01 degC, 0.01 %RH, 0.1 kPa
+    int16_t temperature_zb = (int16_t)lroundf(temperature * 100);
+    uint16_t humidity_zb = (uint16_t)lroundf(humidity * 100);
+    int16_t pressure_zb = (int16_t)lroundf(pressure);
+
+    if (!esp_zb_lock_acquire(portMAX_DELAY)) {
+        return;
+    }
+    // Attribute reads always see the latest sample; reports go out only when due
+    esp_zb_zcl_set_attr_value(HA_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                              ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, &temperature_zb, false);
+    esp_zb_zcl_set_attr_value(HA_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                              ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID, &humidity_zb, false);
+    esp_zb_zcl_set_attr_value(HA_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                              ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID, &pressure_zb, false);
+
+    rg_zb_report_set(&s_reporting, ZB_ATTR_TEMPERATURE, temperature_zb);
+    rg_zb_report_set(&s_reporting, ZB_ATTR_HUMIDITY, humidity_zb);
+    rg_zb_report_set(&s_reporting, ZB_ATTR_PRESSURE, pressure_zb);
+    zigbee_flush_reports(0);
+    esp_zb_lock_release();
+}
+
+static void zigbee_sample(const rg_event_t *event, void *ctx)
 {
-    // Convert to Zigbee format: 0.01 units
-    zb_temperature_value = (int16_t)(temperature * 100);
-    zb_humidity_value = (uint16_t)(humidity * 100);
-
-    // Optionally, trigger attribute reporting here if your app supports it
-    // esp_zb_zcl_set_attr_value(HA_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
-    //                           ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
-    //                           &zb_temperature_value);
-    //
-    // esp_zb_zcl_set_attr_value(HA_SENSOR_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_REL_HUMIDITY_MEASUREMENT,
-    //                           ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, ESP_ZB_ZCL_ATTR_REL_HUMIDITY_MEASUREMENT_VALUE_ID,
-    //                           &zb_humidity_value);
+    zigbee_update_sensor_values(event->sample.temperature, event->sample.humidity, event->sample.pressure);
 }
 
 void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
@@ -1,4 +1,3 @@
-#include <string>
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
@@ -1,21 +1,36 @@
 #include <esp_event.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <esp_netif.h>
 #include <esp_system.h>
-#include <esp_wifi.h>
 #include <nvs_flash.h>
 #include <sdkconfig.h> // Include sdkconfig to access configuration options
-// Keep old header include for i2c_bus definitions if rg_bme280.h doesn't pull it in sufficiently
-#include "i2c_bus.h"
-#include "driver/gpio.h" // Required for gpio_num_t
 #include "freertos/FreeRTOS.h" // Required for FreeRTOS types and task creation
 #include "freertos/task.h"     // Required for xTaskCreate and vTaskDelay
-#include <string.h> // Required for strncpy
 
 
 // Include for BME280 sensor module
 // Ensure this path is correct relative to your main component's directory
 #include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_i2c_bus_task.h"
+#include "services/shared_data/shared_data.h"
+#include "services/history/rg_history.h"
+#include "services/flash_log/rg_flash_log_task.h"
+#include "services/log/rg_tlog_task.h"
+#include "services/sse/rg_sse.h"
+#include "services/pipeline/rg_pipeline.h"
+#include "services/stats/rg_stats.h"
+#include "services/rules/rg_rules_task.h"
+#include "services/config/rg_config_task.h"
+#include "services/metrics/rg_metrics_system.h"
+#include "services/rtos/rg_static_alloc.h"
+#include "communications/rg_mqtt_task.h"
+#include "communications/rg_wifi_sta.h"
+#include "services/boot/rg_boot.h"
+#include "services/bus/rg_event_bus_task.h"
+#include "services/boot/rg_boot_task.h"
+#include "services/ota/rg_ota_task.h"
+#include "services/rg_http_server.h"
 
 // --- Removed Matter Includes and Namespaces ---
 // All includes and namespaces related to esp_matter have been removed.
@@ -23,72 +38,288 @@
 static const char *TAG = "APP_MAIN"; // Using a simple static tag
 
 
-// Simple delay function using FreeRTOS vTaskDelay
-static void delay_ms(uint32_t ms) {
-    vTaskDelay(pdMS_TO_TICKS(ms));
+// BME280 sensors on the shared I2C bus: the primary one and, if configured, a second at 0x77
+#define MAX_SENSORS 2
+static rg_bme280_t s_bme280_instances[MAX_SENSORS];
+static rg_bme280_t *s_sensors[MAX_SENSORS];
+static size_t s_sensor_count = 0;
+
+RG_TASK_STORAGE(s_bme280_task, configMINIMAL_STACK_SIZE + 4096);
+static TaskHandle_t s_bme280_handle = NULL;
+static bool s_sampling_changed = false;
+
+// Runs in the task that changed the settings; wakes the sensor task to apply them
+static void sampling_changed(void *ctx, int id) {
+    __atomic_store_n(&s_sampling_changed, true, __ATOMIC_RELEASE);
+    TaskHandle_t task = __atomic_load_n(&s_bme280_handle, __ATOMIC_ACQUIRE);
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+// The pipeline reaches the rules and the consumers through their tasks
+static void pipeline_rules(void *ctx, int64_t now_us, float temperature, float humidity, float pressure) {
+    rg_rules_task_evaluate(now_us, temperature, humidity, pressure);
 }
 
-// Declare an instance of the BME280 sensor structure
-static rg_bme280_t s_bme280_instance;
+static void pipeline_publish(void *ctx, const rg_event_t *event) {
+    rg_event_bus_task_publish(event);
+}
 
 // BME280 Sensor Task (Reads data and uses the instance)
 static void bme280_task(void *pvParameter) {
     ESP_LOGI(TAG, "BME280 sensor task started.");
+    __atomic_store_n(&s_bme280_handle, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
 
     rg_bme280_values_t sensor_values; // Structure to hold readings
+    rg_bme280_values_t readings[MAX_SENSORS];
+    esp_err_t results[MAX_SENSORS];
+
+    // Sample faster while the room is changing and only publish meaningful changes
+    rg_sampler_config_t sampler_config;
+    rg_settings_sampler_config(rg_config_task_config(), &sampler_config);
+    const rg_pipeline_port_t port = {pipeline_rules, pipeline_publish, NULL};
+    rg_pipeline_init(&sampler_config, &port);
 
     while (1) {
-        // Read sensor data using the initialized instance
-        if (rg_bme280_read_values(&s_bme280_instance, &sensor_values) == ESP_OK) {
-            ESP_LOGI(TAG, "Sensor Data: Temp=%.2f C, Pres=%.2f hPa, Hum=%.2f %%", sensor_values.temperature, sensor_values.pressure, sensor_values.humidity);
+        // All sensors convert in parallel, so a second one barely lengthens the read
+        if (rg_bme280_read_group(s_sensors, s_sensor_count, readings, results) == ESP_OK) {
+            // Publish the mean of the sensors that answered
+            sensor_values = {};
+            int answered = 0;
+            for (size_t i = 0; i < s_sensor_count; i++) {
+                if (results[i] == ESP_OK) {
+                    sensor_values.temperature += readings[i].temperature;
+                    sensor_values.humidity += readings[i].humidity;
+                    sensor_values.pressure += readings[i].pressure;
+                    answered++;
+                }
+            }
+            sensor_values.temperature /= answered;
+            sensor_values.humidity /= answered;
+            sensor_values.pressure /= answered;
+
+            // Filters, rules, stats and sampler; consumers each run in their own task
+            int64_t now_us = esp_timer_get_time();
+            rg_event_sample_t sample;
+            if (rg_pipeline_process(now_us, rg_history_now(), sensor_values.temperature, sensor_values.humidity,
+                                    sensor_values.pressure, &sample)) {
+                RG_TLOGI(TAG, "Sensor Data: Temp=%.2f C, Pres=%.2f hPa, Hum=%.2f %%", sample.temperature, sample.pressure, sample.humidity);
+                rg_boot_mark(RG_BOOT_MARK_FIRST_SAMPLE, now_us);
+            }
             // --- Removed code that would update Matter attributes with sensor data ---
         } else {
             ESP_LOGE(TAG, "Failed to read BME280 sensor data.");
         }
 
-        // Delay before next reading
-        delay_ms(10000); // Read every 10 seconds (adjust as needed)
+        // Delay before next reading, as chosen by the sampler; changed settings cut it short
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(rg_pipeline_next_interval_ms()));
+        if (__atomic_exchange_n(&s_sampling_changed, false, __ATOMIC_ACQ_REL)) {
+            rg_settings_sampler_config(rg_config_task_config(), &sampler_config);
+            rg_pipeline_reconfigure(&sampler_config);
+            const rg_sampler_config_t *applied = &rg_pipeline_sampler()->config;
+            ESP_LOGI(TAG, "Sampling every %lu-%lu ms from now on.", (unsigned long)applied->min_interval_ms,
+                     (unsigned long)applied->max_interval_ms);
+        }
     }
 }
 
-// Basic Wi-Fi initialization (Temporarily using string literals for SSID/Password)
-static esp_err_t wifi_init() {
-    // NVS flash initialization - required for Wi-Fi and other components
+// --- Sample consumers, fed by the event bus ---
+
+// Only the newest sample matters to the HTTP handlers and open dashboards
+static void http_sample(const rg_event_t *event, void *ctx) {
+    const rg_event_sample_t *s = &event->sample;
+    // This task is the single writer of shared_data
+    shared_data_publish(s->temperature, s->humidity, s->pressure, event->time_us);
+    rg_sse_notify(); // Push the new sample to open dashboards
+}
+
+// Keep every reading in the on-device history served by /history and persist it
+static void log_reading(const rg_event_t *event, void *ctx) {
+    const rg_event_sample_t *s = &event->sample;
+    // This task is the single writer of the history once the boot replay is done
+    rg_history_add(s->timestamp, s->temperature, s->humidity, s->pressure);
+    rg_flash_log_task_submit(s->timestamp, s->temperature, s->humidity, s->pressure);
+}
+
+static rg_event_consumer_t s_http_consumer =
+    RG_EVENT_CONSUMER_INIT("http", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE), http_sample, NULL);
+static rg_event_consumer_t s_log_consumer =
+    RG_EVENT_CONSUMER_INIT("log", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_READING), log_reading, NULL);
+RG_TASK_STORAGE(s_http_consumer_task, CONFIG_RG_EVENT_BUS_TASK_STACK);
+RG_TASK_STORAGE(s_log_consumer_task, CONFIG_RG_EVENT_BUS_TASK_STACK);
+
+#if CONFIG_RG_MQTT_ENABLE
+// Push every sample to the broker; queued while offline (never blocks)
+static void mqtt_sample(const rg_event_t *event, void *ctx) {
+    const rg_event_sample_t *s = &event->sample;
+    rg_mqtt_task_submit(s->timestamp, s->temperature, s->humidity, s->pressure);
+}
+
+static rg_event_consumer_t s_mqtt_consumer =
+    RG_EVENT_CONSUMER_INIT("mqtt", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE), mqtt_sample, NULL);
+RG_TASK_STORAGE(s_mqtt_consumer_task, CONFIG_RG_EVENT_BUS_TASK_STACK);
+#endif
+
+#if CONFIG_RG_FLASH_LOG_ENABLE
+// Replays persisted readings into the in-RAM history and the rolling statistics at boot;
+// the log holds every reading, so the replayed statistics weigh them as the live ones do
+static void replay_sample(const rg_flash_log_record_t *record, void *ctx) {
+    uint32_t *last_ts = (uint32_t *)ctx;
+    rg_history_add_fixed(record->timestamp, record->temperature, record->humidity, record->pressure);
+    rg_stats_add_fixed(record->timestamp, record->temperature, record->humidity, record->pressure * 10);
+    *last_ts = record->timestamp;
+}
+#endif
+
+// --- Boot stages, run by rg_boot_run() as soon as their dependencies are done ---
+
+static esp_err_t boot_nvs(void *arg) {
+    // NVS flash initialization - required for Wi-Fi and the cached access point
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
-    ESP_ERROR_CHECK(ret);
-    ESP_LOGI(TAG, "NVS flash initialized.");
+    return ret;
+}
+
+static esp_err_t boot_netif(void *arg) {
+    esp_err_t ret = esp_netif_init();
+    if (ret == ESP_OK) {
+        ret = esp_event_loop_create_default();
+    }
+    return ret;
+}
+
+// The bus and its consumers, subscribed before the first sample is published.
+// Consumers run below the sensor task's priority, so publishing never yields to them.
+static esp_err_t boot_bus(void *arg) {
+    esp_err_t ret = rg_event_bus_task_init();
+    if (ret == ESP_OK) {
+        ret = rg_event_bus_task_subscribe(&s_http_consumer);
+    }
+    if (ret == ESP_OK) {
+        ret = rg_event_bus_task_subscribe(&s_log_consumer);
+    }
+#if CONFIG_RG_MQTT_ENABLE
+    if (ret == ESP_OK) {
+        ret = rg_event_bus_task_subscribe(&s_mqtt_consumer);
+    }
+#endif
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (RG_TASK_CREATE(s_http_consumer_task, rg_event_bus_task_consume, "ev_http", &s_http_consumer, 4) != pdPASS ||
+        RG_TASK_CREATE(s_log_consumer_task, rg_event_bus_task_consume, "ev_log", &s_log_consumer, 3) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_RG_MQTT_ENABLE
+    if (RG_TASK_CREATE(s_mqtt_consumer_task, rg_event_bus_task_consume, "ev_mqtt", &s_mqtt_consumer, 3) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    return ESP_OK;
+}
+
+// Windows from CONFIG_RG_STATS_*_WINDOWS; before anything is added to them
+static esp_err_t boot_stats(void *arg) {
+    rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT];
+    esp_err_t ret = rg_stats_default_config(config);
+    if (ret == ESP_OK) {
+        ret = rg_stats_configure(config);
+    }
+    return ret;
+}
 
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+// CONFIG_RG_RULES compiled and their GPIOs driven to the cleared level before the first reading
+static esp_err_t boot_rules(void *arg) {
+    return rg_rules_task_start();
+}
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+// Runtime settings from NVS over the Kconfig defaults, before anything reads them
+static esp_err_t boot_config(void *arg) {
+    return rg_config_task_start();
+}
 
-    // Initialize the wifi_config struct with zeros first to avoid missing initializer warnings
-    wifi_config_t wifi_config = {}; // Zero-initialize the entire struct
+// Hot-path logs wait in the RAM ring until this task drains them
+static esp_err_t boot_tlog(void *arg) {
+    return rg_tlog_task_start();
+}
 
-    // Now set the specific members you need using strncpy for safety
-    strncpy((char *)wifi_config.sta.ssid, "BrajOfy_IoT", sizeof(wifi_config.sta.ssid)); // Use strncpy for safety
-    wifi_config.sta.ssid[sizeof(wifi_config.sta.ssid) - 1] = '\0'; // Ensure null termination
+// Heap, task and Wi-Fi metrics for /metrics (needs the default event loop)
+static esp_err_t boot_metrics(void *arg) {
+    return rg_metrics_system_start();
+}
 
-    strncpy((char *)wifi_config.sta.password, "9851904515@abc", sizeof(wifi_config.sta.password)); // Use strncpy for safety
-    wifi_config.sta.password[sizeof(wifi_config.sta.password) - 1] = '\0'; // Ensure null termination
+// Returns once the station is started; the connection completes in the background
+static esp_err_t boot_wifi(void *arg) {
+    return rg_wifi_sta_start();
+}
+
+// An image fresh from an update stays only if it reaches the first sample and an IP address
+static esp_err_t boot_ota_confirm(void *arg) {
+    return rg_ota_task_confirm();
+}
 
+static esp_err_t boot_http(void *arg) {
+    return rg_http_server_start();
+}
+
+#if CONFIG_RG_FLASH_LOG_ENABLE
+// Restore the history from flash and continue its time line after the last persisted sample
+static esp_err_t boot_flash_log(void *arg) {
+    uint32_t last_ts = 0;
+    esp_err_t ret = rg_flash_log_task_start(replay_sample, &last_ts);
+    if (ret == ESP_OK && last_ts > 0) {
+        rg_history_set_time_offset(last_ts + 1);
+    }
+    return ret;
+}
+#endif
 
-    // Explicitly set authmode after struct definition to avoid initializer error
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+#if CONFIG_RG_MQTT_ENABLE
+// Batches samples to the broker; reconnects by itself whenever Wi-Fi comes back
+static esp_err_t boot_mqtt(void *arg) {
+    return rg_mqtt_task_start();
+}
+#endif
 
+// One I2C bus shared by all sensors, owned by its own task
+static esp_err_t boot_i2c(void *arg) {
+    return rg_i2c_bus_task_start();
+}
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+static esp_err_t boot_sensors(void *arg) {
+    static const uint8_t sensor_addrs[] = {
+        RG_BME280_I2C_ADDR_PRIM,
+#if CONFIG_RG_BME280_SECOND_SENSOR
+        RG_BME280_I2C_ADDR_SEC,
+#endif
+    };
+    for (size_t i = 0; i < sizeof(sensor_addrs); i++) {
+        if (rg_bme280_init(&s_bme280_instances[i], sensor_addrs[i]) == ESP_OK) {
+            s_sensors[s_sensor_count++] = &s_bme280_instances[i];
+        }
+    }
+    if (s_sensor_count == 0) {
+        ESP_LOGE(TAG, "Failed to initialize BME280 sensor module. Cannot start BME280 task.");
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "%u BME280 sensor(s) initialized successfully.", (unsigned)s_sensor_count);
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "Wi-Fi initialization complete.");
+// The task reads its first sample straight away (forced mode, no settling delay)
+static esp_err_t boot_sampling(void *arg) {
+    esp_err_t ret = rg_config_task_subscribe(RG_SETTINGS_SAMPLING, sampling_changed, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (RG_TASK_CREATE(s_bme280_task, bme280_task, "bme280_task", NULL, 5) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the BME280 task.");
+        return ESP_ERR_NO_MEM;
+    }
     return ESP_OK;
 }
 
@@ -96,29 +327,43 @@ static esp_err_t wifi_init() {
 extern "C" void app_main() {
     ESP_LOGI(TAG, "Starting RoomGuardian V2 (without Matter)");
 
-    // NVS flash initialization is now handled within wifi_init for simplicity in this template.
-    // It only needs to be called once.
-
-    // Initialize Wi-Fi (assuming it's needed for other functionality or general connectivity)
-    wifi_init();
-
     // --- Removed All Matter Initialization Code ---
     // Removed Zigbee and wifi_manager calls as they are custom components not addressed here.
-    // Removed shared_data initialization calls as well.
 
-
-    // Initialize the BME280 sensor module instance BEFORE starting the task
-    if (rg_bme280_init(&s_bme280_instance) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize BME280 sensor module. Cannot start BME280 task.");
-        // Don't start the BME280 task if initialization fails
-    } else {
-        ESP_LOGI(TAG, "BME280 sensor module initialized successfully.");
-        // Create the BME280 sensor task to run independently
-        // Ensure stack size is sufficient. Adjusted based on common needs.
-        xTaskCreate(bme280_task, "bme280_task", configMINIMAL_STACK_SIZE + 4096, NULL, 5, NULL); // Increased stack for BME task
+    // Everything that only waits on hardware or the network overlaps; only real dependencies are ordered
+    static rg_boot_t boot;
+    rg_boot_init(&boot);
+    rg_boot_add(&boot, "tlog", boot_tlog, NULL, 0);
+    const int nvs = rg_boot_add(&boot, "nvs", boot_nvs, NULL, 0);
+    const int config = rg_boot_add(&boot, "config", boot_config, NULL, RG_BOOT_DEP(nvs));
+    const int netif = rg_boot_add(&boot, "netif", boot_netif, NULL, 0);
+    const int metrics = rg_boot_add(&boot, "metrics", boot_metrics, NULL, RG_BOOT_DEP(netif));
+    // After the metrics so their Wi-Fi counters see the first connect
+    rg_boot_add(&boot, "wifi", boot_wifi, NULL, RG_BOOT_DEP(config) | RG_BOOT_DEP(netif) | RG_BOOT_DEP(metrics));
+    // /settings serves the loaded settings
+    rg_boot_add(&boot, "http", boot_http, NULL, RG_BOOT_DEP(netif) | RG_BOOT_DEP(config));
+    rg_boot_add(&boot, "ota_confirm", boot_ota_confirm, NULL, 0);
+#if CONFIG_RG_MQTT_ENABLE
+    rg_boot_add(&boot, "mqtt", boot_mqtt, NULL, RG_BOOT_DEP(netif));
+#endif
+    const int i2c = rg_boot_add(&boot, "i2c", boot_i2c, NULL, 0);
+    const int sensors = rg_boot_add(&boot, "sensors", boot_sensors, NULL, RG_BOOT_DEP(i2c));
+    const int bus = rg_boot_add(&boot, "bus", boot_bus, NULL, 0);
+    const int stats = rg_boot_add(&boot, "stats", boot_stats, NULL, 0);
+    // Rule events go out on the bus
+    const int rules = rg_boot_add(&boot, "rules", boot_rules, NULL, RG_BOOT_DEP(bus) | RG_BOOT_DEP(config));
+    uint32_t sampling_deps =
+        RG_BOOT_DEP(sensors) | RG_BOOT_DEP(bus) | RG_BOOT_DEP(stats) | RG_BOOT_DEP(rules) | RG_BOOT_DEP(config);
+#if CONFIG_RG_FLASH_LOG_ENABLE
+    // Samples must not reach the history before its time line is restored
+    sampling_deps |= RG_BOOT_DEP(rg_boot_add(&boot, "flash_log", boot_flash_log, NULL, RG_BOOT_DEP(stats)));
+#endif
+    rg_boot_add(&boot, "sampling", boot_sampling, NULL, sampling_deps);
+
+    if (rg_boot_run(&boot) != ESP_OK) {
+        ESP_LOGE(TAG, "Some subsystems failed to start; running with the rest.");
     }
 
-
     ESP_LOGI(TAG, "Application setup complete. Running tasks.");
 
     // app_main can return when FreeRTOS tasks take over execution.
@@ -1,140 +1,256 @@
 // main/sensor_modules/rg_bme280.c
-#include "rg_bme280.h" // Include our custom header first
+#include "rg_bme280.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h" // Required for FreeRTOS types
-#include "freertos/task.h"     // Required for vTaskDelay or similar
+#include "esp_timer.h"
+#include "services/metrics/rg_metrics.h"
 
-// Include necessary ESP-IDF headers for older I2C bus and GPIO
-#include "i2c_bus.h" // Include the header for the older I2C API
-#include "driver/gpio.h"
-
-// Include header from the espressif/bme280 managed component's interface
-#include "bme280.h"
+#include <sdkconfig.h>
 
 static const char *TAG = "RG_BME280";
 
-// Define I2C_MASTER_FREQ_HZ if not already defined elsewhere (e.g., constants.h)
-#ifndef I2C_MASTER_FREQ_HZ
-#define I2C_MASTER_FREQ_HZ 100000
-#endif
+// Status polls after the nominal conversion time before giving up
+#define RG_BME280_STATUS_POLLS 10
+#define RG_BME280_STATUS_POLL_US 500
+
+static rg_metrics_histogram_t s_read_latency = RG_METRICS_HISTOGRAM_INIT(
+    "rg_i2c_transaction_duration_seconds", "Batches of sensor I2C transfers while sampling.", "op=\"read\"",
+    rg_metrics_latency_bounds_us);
+static rg_metrics_histogram_t s_write_latency = RG_METRICS_HISTOGRAM_INIT(
+    "rg_i2c_transaction_duration_seconds", "Batches of sensor I2C transfers while sampling.", "op=\"write\"",
+    rg_metrics_latency_bounds_us);
+static rg_metrics_histogram_t s_sample_latency = RG_METRICS_HISTOGRAM_INIT(
+    "rg_sensor_read_duration_seconds", "One sampling round of all sensors including the conversion wait.", NULL,
+    rg_metrics_latency_bounds_us);
+static rg_metrics_counter_t s_read_errors =
+    RG_METRICS_COUNTER_INIT("rg_sensor_read_errors_total", "Failed sensor reads.", NULL);
+
+// Sampling transfers: one batch where every sensor's bus shares a batch
+// function, one by one otherwise. Timed for the latency histograms.
+static void run_accesses(rg_bme280_access_t *accesses, size_t count, rg_metrics_histogram_t *latency)
+{
+    if (count == 0) {
+        return;
+    }
+    int64_t start = esp_timer_get_time();
+    void (*batch)(rg_bme280_access_t *, size_t) = accesses[0].bus->batch;
+    for (size_t i = 1; i < count && batch; i++) {
+        if (accesses[i].bus->batch != batch) {
+            batch = NULL;
+        }
+    }
+    if (batch) {
+        batch(accesses, count);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            rg_bme280_access_t *a = &accesses[i];
+            a->result = a->data ? a->bus->read(a->bus->ctx, a->reg, a->data, a->len)
+                                : a->bus->write(a->bus->ctx, a->reg, a->value);
+        }
+    }
+    rg_metrics_observe(latency, (uint32_t)(esp_timer_get_time() - start));
+}
 
-// Initialize the BME280 sensor module using the component's API
-esp_err_t rg_bme280_init(rg_bme280_t *rg_bme280)
+esp_err_t rg_bme280_init_with_bus(rg_bme280_t *rg_bme280, const rg_bme280_bus_t *bus)
 {
-    if (!rg_bme280) {
-        ESP_LOGE(TAG, "rg_bme280 context pointer is NULL.");
+    if (!rg_bme280 || !bus || !bus->read || !bus->write || !bus->delay_us) {
         return ESP_ERR_INVALID_ARG;
     }
+    rg_bme280->bus = *bus;
+
+    rg_metrics_register_histogram(&s_read_latency);
+    rg_metrics_register_histogram(&s_write_latency);
+    rg_metrics_register_histogram(&s_sample_latency);
+    rg_metrics_register_counter(&s_read_errors);
 
-    // Initialize handles to NULL
-    rg_bme280->i2c_bus_handle = NULL;
-    rg_bme280->bme280_handle = NULL;
-
-    esp_err_t ret;
-
-    // Get I2C configuration from Kconfig (defined in your sdkconfig.defaults)
-    // Ensure these are correctly configured in idf.py menuconfig
-    i2c_port_t i2c_port = I2C_NUM_0; // Assuming I2C_NUM_0, verify in menuconfig if needed
-    gpio_num_t sda_pin = (gpio_num_t)CONFIG_BME280_I2C_SDA_GPIO; // From sdkconfig.defaults
-    gpio_num_t scl_pin = (gpio_num_t)CONFIG_BME280_I2C_SCL_GPIO; // From sdkconfig.defaults
-    uint8_t bme280_addr = RG_BME280_I2C_ADDR_PRIM; // Use the address defined in our header
-
-
-    // 1. Configure I2C master parameters using the older i2c_bus API
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = sda_pin,
-        .scl_io_num = scl_pin,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master = { // Corrected syntax for initializing the nested 'master' struct
-            .clk_speed = I2C_MASTER_FREQ_HZ, // Use the defined frequency
-        },
-        .clk_flags = 0,
-    };
-
-    // 2. Create the I2C bus using the older i2c_bus API
-    rg_bme280->i2c_bus_handle = i2c_bus_create(i2c_port, &conf);
-    if (rg_bme280->i2c_bus_handle == NULL) {
-        ESP_LOGE(TAG, "Failed to create I2C bus.");
-        return ESP_FAIL;
-    }
-    ESP_LOGI(TAG, "I2C bus created on port %d, SDA:%d, SCL:%d", i2c_port, sda_pin, scl_pin);
-
-    // 3. Create the BME280 sensor handle using the component's API
-    rg_bme280->bme280_handle = bme280_create(rg_bme280->i2c_bus_handle, bme280_addr);
-    if (rg_bme280->bme280_handle == NULL) {
-        ESP_LOGE(TAG, "Failed to create BME280 sensor handle.");
-        // Cleanup I2C bus on failure
-        i2c_bus_delete(&rg_bme280->i2c_bus_handle);
-        rg_bme280->i2c_bus_handle = NULL;
-        return ESP_FAIL;
-    }
-    ESP_LOGI(TAG, "BME280 sensor handle created.");
-
-
-    // 4. Initialize the BME280 sensor with default settings using the component's API
-    // Note: bme280_default_init often puts the sensor into a specific mode (e.g., Normal)
-    ret = bme280_default_init(rg_bme280->bme280_handle);
+    uint8_t chip_id = 0;
+    esp_err_t ret = bus->read(bus->ctx, RG_BME280_REG_CHIP_ID, &chip_id, 1);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize BME280 with default settings: %s", esp_err_to_name(ret));
-        // Cleanup BME280 handle and I2C bus on failure
-        bme280_delete(&rg_bme280->bme280_handle);
-        rg_bme280->bme280_handle = NULL;
-        i2c_bus_delete(&rg_bme280->i2c_bus_handle);
-        rg_bme280->i2c_bus_handle = NULL;
-        return ESP_FAIL;
+        return ret;
+    }
+    if (chip_id != RG_BME280_CHIP_ID) {
+        ESP_LOGE(TAG, "Unexpected chip ID 0x%02x (expected 0x%02x).", chip_id, RG_BME280_CHIP_ID);
+        return ESP_ERR_NOT_FOUND;
     }
 
-    ESP_LOGI(TAG, "BME280 initialization successful.");
+    // Soft reset, then wait for the NVM calibration copy to finish (2 ms start-up)
+    ret = bus->write(bus->ctx, RG_BME280_REG_RESET, RG_BME280_RESET_VALUE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    bus->delay_us(bus->ctx, 2000);
+    for (int i = 0; i < RG_BME280_STATUS_POLLS; i++) {
+        uint8_t status = 0;
+        ret = bus->read(bus->ctx, RG_BME280_REG_STATUS, &status, 1);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (!(status & RG_BME280_STATUS_IM_UPDATE)) {
+            break;
+        }
+        bus->delay_us(bus->ctx, RG_BME280_STATUS_POLL_US);
+    }
+
+    uint8_t calib_tp[RG_BME280_CALIB_TP_LEN];
+    uint8_t calib_h[RG_BME280_CALIB_H_LEN];
+    ret = bus->read(bus->ctx, RG_BME280_REG_CALIB_TP, calib_tp, sizeof(calib_tp));
+    if (ret == ESP_OK) {
+        ret = bus->read(bus->ctx, RG_BME280_REG_CALIB_H, calib_h, sizeof(calib_h));
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    rg_bme280_parse_calib(calib_tp, calib_h, &rg_bme280->calib);
 
-    // *** Add a delay here to allow the first measurement cycle to complete ***
-    // The default settings likely put it in Normal mode with a 1000ms standby.
-    // Wait slightly longer than the expected measurement period (standby time).
-    vTaskDelay(pdMS_TO_TICKS(1100)); // Wait 1.1 seconds
+    rg_bme280->osrs_t = CONFIG_RG_BME280_OVERSAMPLING_T;
+    rg_bme280->osrs_p = CONFIG_RG_BME280_OVERSAMPLING_P;
+    rg_bme280->osrs_h = CONFIG_RG_BME280_OVERSAMPLING_H;
+    rg_bme280->measure_time_us = rg_bme280_measure_time_us(rg_bme280->osrs_t, rg_bme280->osrs_p, rg_bme280->osrs_h);
 
-    return ESP_OK;
+    // ctrl_hum only takes effect after the following ctrl_meas write. Filter off.
+    ret = bus->write(bus->ctx, RG_BME280_REG_CTRL_HUM, rg_bme280->osrs_h);
+    if (ret == ESP_OK) {
+        ret = bus->write(bus->ctx, RG_BME280_REG_CONFIG, 0x00);
+    }
+    if (ret == ESP_OK) {
+        ret = bus->write(bus->ctx, RG_BME280_REG_CTRL_MEAS,
+                         (uint8_t)((rg_bme280->osrs_t << 5) | (rg_bme280->osrs_p << 2) | RG_BME280_MODE_SLEEP));
+    }
+    return ret;
 }
 
-// Read compensated temperature, pressure, and humidity from the BME280 sensor
-esp_err_t rg_bme280_read_values(rg_bme280_t *rg_bme280, rg_bme280_values_t *values)
+// Runs one forced conversion on every sensor and fetches the results: the
+// triggers as one batch, then after the conversion time the status and data
+// burst of each sensor still measuring as another, until all are done.
+static void sample_group(rg_bme280_t *const *sensors, size_t count, rg_bme280_fixed_t *out, esp_err_t *results)
 {
-    if (!rg_bme280 || !values || !rg_bme280->bme280_handle) {
-        ESP_LOGE(TAG, "Invalid arguments or BME280 handle not initialized.");
-        return ESP_ERR_INVALID_ARG;
+    rg_bme280_access_t accesses[2 * RG_BME280_GROUP_MAX];
+    size_t owner[2 * RG_BME280_GROUP_MAX];
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        rg_bme280_t *sensor = sensors[i];
+        results[i] = ESP_ERR_INVALID_ARG;
+        if (sensor && sensor->bus.read) {
+            accesses[n] = (rg_bme280_access_t){
+                .bus = &sensor->bus,
+                .reg = RG_BME280_REG_CTRL_MEAS,
+                .value = (uint8_t)((sensor->osrs_t << 5) | (sensor->osrs_p << 2) | RG_BME280_MODE_FORCED),
+            };
+            owner[n++] = i;
+        }
     }
+    run_accesses(accesses, n, &s_write_latency);
 
-    esp_err_t ret_temp = ESP_FAIL, ret_press = ESP_FAIL, ret_hum = ESP_FAIL;
+    // All conversions run in parallel; the wait is that of the slowest sensor
+    rg_bme280_t *waiter = NULL;
+    bool measuring[RG_BME280_GROUP_MAX] = {false};
+    for (size_t k = 0; k < n; k++) {
+        rg_bme280_t *sensor = sensors[owner[k]];
+        results[owner[k]] = accesses[k].result;
+        measuring[owner[k]] = accesses[k].result == ESP_OK;
+        if (measuring[owner[k]] && (!waiter || sensor->measure_time_us > waiter->measure_time_us)) {
+            waiter = sensor;
+        }
+    }
+    if (!waiter) {
+        return;
+    }
+    waiter->bus.delay_us(waiter->bus.ctx, waiter->measure_time_us);
 
-    // Use the component's individual read functions
-    ret_temp = bme280_read_temperature(rg_bme280->bme280_handle, &values->temperature);
-    ret_hum = bme280_read_humidity(rg_bme280->bme280_handle, &values->humidity);
-    ret_press = bme280_read_pressure(rg_bme280->bme280_handle, &values->pressure);
+    // The datasheet time is a maximum, so this normally passes on the first poll.
+    // The status goes first: a burst after a clear status holds the new conversion.
+    uint8_t status[RG_BME280_GROUP_MAX];
+    uint8_t data[RG_BME280_GROUP_MAX][RG_BME280_DATA_LEN];
+    for (int poll = 0; poll < RG_BME280_STATUS_POLLS; poll++) {
+        n = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (measuring[i]) {
+                accesses[n] = (rg_bme280_access_t){
+                    .bus = &sensors[i]->bus, .reg = RG_BME280_REG_STATUS, .data = &status[i], .len = 1};
+                owner[n++] = i;
+                // Pressure, temperature and humidity in one burst so they belong to the same conversion
+                accesses[n] = (rg_bme280_access_t){
+                    .bus = &sensors[i]->bus, .reg = RG_BME280_REG_DATA, .data = data[i], .len = RG_BME280_DATA_LEN};
+                owner[n++] = i;
+            }
+        }
+        if (n == 0) {
+            return;
+        }
+        if (poll > 0) {
+            waiter->bus.delay_us(waiter->bus.ctx, RG_BME280_STATUS_POLL_US);
+        }
+        run_accesses(accesses, n, &s_read_latency);
+
+        for (size_t k = 0; k < n; k += 2) {
+            const size_t i = owner[k];
+            esp_err_t err = accesses[k].result != ESP_OK ? accesses[k].result : accesses[k + 1].result;
+            if (err != ESP_OK) {
+                results[i] = err;
+                measuring[i] = false;
+            } else if (!(status[i] & RG_BME280_STATUS_MEASURING)) {
+                rg_bme280_raw_t raw;
+                rg_bme280_parse_raw(data[i], &raw);
+                rg_bme280_compensate(&sensors[i]->calib, &raw, &out[i]);
+                results[i] = ESP_OK;
+                measuring[i] = false;
+            }
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (measuring[i]) {
+            results[i] = ESP_ERR_TIMEOUT;
+        }
+    }
+}
 
-    if (ret_temp != ESP_OK || ret_hum != ESP_OK || ret_press != ESP_OK) {
-         ESP_LOGE(TAG, "Failed to read BME280 sensor data.");
-         // You could log which specific read failed here if needed
-         return ESP_FAIL; // Return failure if any read failed
+esp_err_t rg_bme280_read_fixed(rg_bme280_t *rg_bme280, rg_bme280_fixed_t *out)
+{
+    if (!rg_bme280 || !out || !rg_bme280->bus.read) {
+        ESP_LOGE(TAG, "Invalid arguments or BME280 not initialized.");
+        return ESP_ERR_INVALID_ARG;
     }
 
+    esp_err_t result;
+    sample_group(&rg_bme280, 1, out, &result);
+    return result;
+}
 
-    // If all reads were successful
-    return ESP_OK;
+// Read compensated temperature, pressure, and humidity from the BME280 sensor
+esp_err_t rg_bme280_read_values(rg_bme280_t *rg_bme280, rg_bme280_values_t *values)
+{
+    esp_err_t result;
+    return rg_bme280_read_group(&rg_bme280, 1, values, &result);
 }
 
-// Deinitializes the BME280 sensor module, freeing allocated resources.
-void rg_bme280_deinit(rg_bme280_t *rg_bme280)
+esp_err_t rg_bme280_read_group(rg_bme280_t *const *sensors, size_t count, rg_bme280_values_t *values,
+                               esp_err_t *results)
 {
-    if (rg_bme280) {
-        if (rg_bme280->bme280_handle) {
-             bme280_delete(&rg_bme280->bme280_handle);
-             rg_bme280->bme280_handle = NULL;
-        }
-        // The older API i2c_bus_delete also takes a pointer to the handle.
-        if (rg_bme280->i2c_bus_handle) {
-             i2c_bus_delete(&rg_bme280->i2c_bus_handle);
-             rg_bme280->i2c_bus_handle = NULL;
+    if (!sensors || count == 0 || count > RG_BME280_GROUP_MAX || !values || !results) {
+        ESP_LOGE(TAG, "Invalid arguments or BME280 handle not initialized.");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start = esp_timer_get_time();
+    rg_bme280_fixed_t fixed[RG_BME280_GROUP_MAX];
+    sample_group(sensors, count, fixed, results);
+
+    esp_err_t first_err = ESP_OK;
+    size_t read = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (results[i] != ESP_OK) {
+            rg_metrics_add(&s_read_errors, 1);
+            ESP_LOGE(TAG, "Failed to read BME280 sensor data: %s", esp_err_to_name(results[i]));
+            if (first_err == ESP_OK) {
+                first_err = results[i];
+            }
+            continue;
         }
-        ESP_LOGI(TAG, "BME280 module deinitialized.");
+        // Single conversion to the float units consumers expect
+        values[i].temperature = fixed[i].temperature / 100.0f;
+        values[i].pressure = fixed[i].pressure / (256.0f * 100.0f);
+        values[i].humidity = fixed[i].humidity / 1024.0f;
+        read++;
     }
-}
\ No newline at end of file
+    rg_metrics_observe(&s_sample_latency, (uint32_t)(esp_timer_get_time() - start));
+    return read > 0 ? ESP_OK : first_err;
+}
@@ -4,23 +4,52 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "esp_err.h"
-// Include the BME280 component's header - it includes i2c_bus.h
-#include "bme280.h"
-// Include GPIO driver header for gpio_num_t if needed by init function
-#include "driver/gpio.h"
-// Include i2c_bus.h explicitly for i2c_bus_handle_t definition
-#include "i2c_bus.h"
 
+#include "rg_bme280_compensation.h"
 
 // Include Kconfig header to access sensor configuration options
 #include <sdkconfig.h>
 
 
-// Structure to hold the I2C bus handle and the BME280 component's handle
+// Register-level access to one BME280. On the device rg_bme280_init() wires this
+// to the shared I2C bus (rg_bme280_i2c.c, rg_i2c_bus_task.h); host builds and
+// tests plug in the simulated register model from rg_bme280_sim.h instead.
+typedef struct rg_bme280_bus rg_bme280_bus_t;
+
+// One register access of a batch: a burst read into data, or a write of value if data is NULL
+typedef struct {
+    const rg_bme280_bus_t *bus;
+    uint8_t reg;
+    uint8_t value;
+    uint8_t *data;
+    size_t len;
+    esp_err_t result;
+} rg_bme280_access_t;
+
+struct rg_bme280_bus {
+    esp_err_t (*read)(void *ctx, uint8_t reg, uint8_t *data, size_t len); // Burst read starting at reg
+    esp_err_t (*write)(void *ctx, uint8_t reg, uint8_t value);
+    void (*delay_us)(void *ctx, uint32_t us);
+    // Optional: issues all accesses at once, of sensors sharing this function,
+    // and returns when each has its result. Without it they run one by one.
+    void (*batch)(rg_bme280_access_t *accesses, size_t count);
+    void *ctx;
+};
+
+// Structure to hold the bus registration, register access and cached calibration
 typedef struct {
-    i2c_bus_handle_t i2c_bus_handle; // Store the I2C bus handle
-    bme280_handle_t bme280_handle; // Use the component's opaque sensor handle
+    uint8_t i2c_addr;                      // 7-bit address on the shared I2C bus, 0 when not on it
+    uint8_t i2c_device;                    // Handle from rg_i2c_bus_task_add_device()
+    rg_bme280_bus_t bus;
+    rg_bme280_calib_t calib;               // Read once at init
+    uint8_t osrs_t;                        // Oversampling register settings (1 = x1 ... 5 = x16)
+    uint8_t osrs_p;
+    uint8_t osrs_h;
+    uint32_t measure_time_us;              // Worst-case forced conversion time for those settings
 } rg_bme280_t;
 
 // Structure to hold BME280 sensor readings in desired units
@@ -37,31 +66,69 @@ extern "C" {
 #endif
 
 /**
- * @brief Initializes the BME280 sensor module using the espressif/bme280 component's API.
+ * @brief Initializes the BME280 sensor module at @p addr.
  *
- * Sets up the I2C bus using the older i2c_bus API and initializes the BME280 sensor.
- * Uses Kconfig for I2C pin configuration.
+ * Attaches the sensor to the shared I2C bus, which rg_i2c_bus_task_start()
+ * must have created, and initializes it through rg_bme280_init_with_bus().
+ * Uses Kconfig for oversampling. Host builds bind it to a simulated sensor
+ * instead.
  *
  * @param rg_bme280 Pointer to an allocated rg_bme280_t structure to hold the instance data.
+ * @param addr RG_BME280_I2C_ADDR_PRIM or RG_BME280_I2C_ADDR_SEC.
  * @return ESP_OK on success, error code otherwise.
  */
-esp_err_t rg_bme280_init(rg_bme280_t *rg_bme280);
+esp_err_t rg_bme280_init(rg_bme280_t *rg_bme280, uint8_t addr);
+
+/**
+ * @brief Initializes a BME280 reachable through @p bus.
+ *
+ * Checks the chip ID, soft-resets the part, caches the calibration and leaves it
+ * in sleep mode with the Kconfig oversampling. Samples are then taken in forced mode.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the chip ID does not match.
+ */
+esp_err_t rg_bme280_init_with_bus(rg_bme280_t *rg_bme280, const rg_bme280_bus_t *bus);
+
+/**
+ * @brief Takes one forced-mode sample and returns it in the datasheet's integer formats.
+ *
+ * One register write starts the conversion; after it completes, all three
+ * channels are fetched with a single 8-byte burst from 0xF7 and compensated
+ * in fixed point.
+ */
+esp_err_t rg_bme280_read_fixed(rg_bme280_t *rg_bme280, rg_bme280_fixed_t *out);
 
 /**
  * @brief Reads compensated temperature, pressure, and humidity from the BME280 sensor.
  *
- * Uses the espressif/bme280 component's API to read individual sensor values.
+ * Same as rg_bme280_read_fixed(), converted to float units at the end.
  *
- * @param rg_bme280 Pointer to the initialized rg_bme280_t structure containing the sensor handle.
+ * @param rg_bme280 Pointer to the initialized rg_bme280_t structure.
  * @param values Pointer to an rg_bme280_values_t structure to store the readings.
  * @return ESP_OK on success, error code otherwise.
  */
 esp_err_t rg_bme280_read_values(rg_bme280_t *rg_bme280, rg_bme280_values_t *values);
 
+/**
+ * @brief Samples several sensors with one shared conversion wait.
+ *
+ * Starts a forced conversion on every sensor, waits once for the longest of
+ * them and then fetches each result, so a second sensor adds two short
+ * transfers per sample instead of another conversion. Where the bus has a
+ * batch function, the triggers go out as one batch and the status polls and
+ * data bursts as another.
+ *
+ * @param count At most RG_BME280_GROUP_MAX.
+ * @param results Outcome per sensor; @p values holds a reading where it is ESP_OK.
+ * @return ESP_OK if at least one sensor was read, the first error otherwise.
+ */
+esp_err_t rg_bme280_read_group(rg_bme280_t *const *sensors, size_t count, rg_bme280_values_t *values,
+                               esp_err_t *results);
+
 /**
  * @brief Deinitializes the BME280 sensor module, freeing allocated resources.
  *
- * Deletes the BME280 sensor handle and the I2C bus handle.
+ * Detaches the sensor from the shared I2C bus.
  *
  * @param rg_bme280 Pointer to the rg_bme280_t structure to deinitialize.
  */
@@ -72,9 +139,15 @@ void rg_bme280_deinit(rg_bme280_t *rg_bme280);
 #endif
 
 
-// Define BME280 I2C addresses (these are from the bme280 component's common defines)
-#define RG_BME280_I2C_ADDR_PRIM BME280_I2C_ADDRESS_DEFAULT // Use component's default
+// Define BME280 I2C addresses (SDO low / SDO high)
+#define RG_BME280_I2C_ADDR_PRIM 0x76 // Same as the bme280 component's BME280_I2C_ADDRESS_DEFAULT
 #define RG_BME280_I2C_ADDR_SEC  0x77 // Secondary address if needed
 
+// Sensors sampled by one rg_bme280_read_group() call: a bus has room for one per address
+#define RG_BME280_GROUP_MAX 2
+
+// Fastest SCL in the part's fast mode; its high-speed mode needs a master code the ESP32-C6 does not send
+#define RG_BME280_MAX_SCL_HZ 400000
+
 
-#endif /* RG_BME280_H_ */
\ No newline at end of file
+#endif /* RG_BME280_H_ */
@@ -0,0 +1,109 @@
+// main/sensor_modules/rg_bme280_compensation.c
+#include "rg_bme280_compensation.h"
+
+static uint16_t u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void rg_bme280_parse_calib(const uint8_t tp[RG_BME280_CALIB_TP_LEN], const uint8_t h[RG_BME280_CALIB_H_LEN],
+                           rg_bme280_calib_t *calib)
+{
+    calib->dig_T1 = u16_le(&tp[0]);
+    calib->dig_T2 = (int16_t)u16_le(&tp[2]);
+    calib->dig_T3 = (int16_t)u16_le(&tp[4]);
+    calib->dig_P1 = u16_le(&tp[6]);
+    calib->dig_P2 = (int16_t)u16_le(&tp[8]);
+    calib->dig_P3 = (int16_t)u16_le(&tp[10]);
+    calib->dig_P4 = (int16_t)u16_le(&tp[12]);
+    calib->dig_P5 = (int16_t)u16_le(&tp[14]);
+    calib->dig_P6 = (int16_t)u16_le(&tp[16]);
+    calib->dig_P7 = (int16_t)u16_le(&tp[18]);
+    calib->dig_P8 = (int16_t)u16_le(&tp[20]);
+    calib->dig_P9 = (int16_t)u16_le(&tp[22]);
+    // tp[24] (0xA0) is unused
+    calib->dig_H1 = tp[25];
+
+    calib->dig_H2 = (int16_t)u16_le(&h[0]);
+    calib->dig_H3 = h[2];
+    // dig_H4/H5 are 12-bit signed values sharing the nibbles of 0xE5
+    calib->dig_H4 = (int16_t)(((int16_t)(int8_t)h[3] * 16) | (h[4] & 0x0F));
+    calib->dig_H5 = (int16_t)(((int16_t)(int8_t)h[5] * 16) | (h[4] >> 4));
+    calib->dig_H6 = (int8_t)h[6];
+}
+
+void rg_bme280_parse_raw(const uint8_t data[RG_BME280_DATA_LEN], rg_bme280_raw_t *raw)
+{
+    raw->adc_P = ((int32_t)data[0] << 12) | ((int32_t)data[1] << 4) | (data[2] >> 4);
+    raw->adc_T = ((int32_t)data[3] << 12) | ((int32_t)data[4] << 4) | (data[5] >> 4);
+    raw->adc_H = ((int32_t)data[6] << 8) | data[7];
+}
+
+// Returns temperature in 0.01 degC and t_fine for the other channels
+static int32_t compensate_temperature(const rg_bme280_calib_t *c, int32_t adc_T, int32_t *t_fine)
+{
+    int32_t var1 = ((((adc_T >> 3) - ((int32_t)c->dig_T1 << 1))) * ((int32_t)c->dig_T2)) >> 11;
+    int32_t var2 = (((((adc_T >> 4) - ((int32_t)c->dig_T1)) * ((adc_T >> 4) - ((int32_t)c->dig_T1))) >> 12) *
+                    ((int32_t)c->dig_T3)) >> 14;
+    *t_fine = var1 + var2;
+    return (*t_fine * 5 + 128) >> 8;
+}
+
+// Returns pressure in Pa as Q24.8
+static uint32_t compensate_pressure(const rg_bme280_calib_t *c, int32_t adc_P, int32_t t_fine)
+{
+    int64_t var1 = ((int64_t)t_fine) - 128000;
+    int64_t var2 = var1 * var1 * (int64_t)c->dig_P6;
+    var2 = var2 + ((var1 * (int64_t)c->dig_P5) * 131072);
+    var2 = var2 + (((int64_t)c->dig_P4) * 34359738368LL);
+    var1 = ((var1 * var1 * (int64_t)c->dig_P3) >> 8) + ((var1 * (int64_t)c->dig_P2) * 4096);
+    var1 = ((((int64_t)1) << 47) + var1) * ((int64_t)c->dig_P1) >> 33;
+    if (var1 == 0) {
+        return 0; // Avoid division by zero on an unprogrammed part
+    }
+    int64_t p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)c->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)c->dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)c->dig_P7) << 4);
+    return (uint32_t)p;
+}
+
+// Returns humidity in %RH as Q22.10
+static uint32_t compensate_humidity(const rg_bme280_calib_t *c, int32_t adc_H, int32_t t_fine)
+{
+    int32_t v = t_fine - ((int32_t)76800);
+    v = (((((adc_H << 14) - (((int32_t)c->dig_H4) * 1048576) - (((int32_t)c->dig_H5) * v)) + ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)c->dig_H6)) >> 10) * (((v * ((int32_t)c->dig_H3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)c->dig_H2) + 8192) >> 14));
+    v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)c->dig_H1)) >> 4));
+    v = (v < 0 ? 0 : v);
+    v = (v > 419430400 ? 419430400 : v);
+    return (uint32_t)(v >> 12);
+}
+
+void rg_bme280_compensate(const rg_bme280_calib_t *calib, const rg_bme280_raw_t *raw, rg_bme280_fixed_t *out)
+{
+    int32_t t_fine;
+    out->temperature = compensate_temperature(calib, raw->adc_T, &t_fine);
+    out->pressure = compensate_pressure(calib, raw->adc_P, t_fine);
+    out->humidity = compensate_humidity(calib, raw->adc_H, t_fine);
+}
+
+uint32_t rg_bme280_measure_time_us(uint8_t osrs_t, uint8_t osrs_p, uint8_t osrs_h)
+{
+    // Oversampling register value -> number of conversions
+    static const uint8_t samples[] = {0, 1, 2, 4, 8, 16};
+    uint32_t t = samples[osrs_t > 5 ? 5 : osrs_t];
+    uint32_t p = samples[osrs_p > 5 ? 5 : osrs_p];
+    uint32_t h = samples[osrs_h > 5 ? 5 : osrs_h];
+
+    uint32_t us = 1250 + 2300 * t;
+    if (p) {
+        us += 2300 * p + 575;
+    }
+    if (h) {
+        us += 2300 * h + 575;
+    }
+    return us;
+}
@@ -0,0 +1,100 @@
+// main/sensor_modules/rg_bme280_compensation.h
+#ifndef RG_BME280_COMPENSATION_H_
+#define RG_BME280_COMPENSATION_H_
+
+#pragma once
+
+#include <stdint.h>
+
+// BME280 register map used by the burst readout path (datasheet section 5.3)
+#define RG_BME280_REG_CALIB_TP   0x88 // dig_T1 .. dig_H1, 26 bytes
+#define RG_BME280_REG_CHIP_ID    0xD0
+#define RG_BME280_REG_RESET      0xE0
+#define RG_BME280_REG_CALIB_H    0xE1 // dig_H2 .. dig_H6, 7 bytes
+#define RG_BME280_REG_CTRL_HUM   0xF2
+#define RG_BME280_REG_STATUS     0xF3
+#define RG_BME280_REG_CTRL_MEAS  0xF4
+#define RG_BME280_REG_CONFIG     0xF5
+#define RG_BME280_REG_DATA       0xF7 // press_msb .. hum_lsb, 8 bytes
+
+#define RG_BME280_CALIB_TP_LEN   26
+#define RG_BME280_CALIB_H_LEN    7
+#define RG_BME280_DATA_LEN       8
+
+#define RG_BME280_CHIP_ID        0x60
+#define RG_BME280_RESET_VALUE    0xB6
+#define RG_BME280_STATUS_MEASURING 0x08
+#define RG_BME280_STATUS_IM_UPDATE 0x01
+#define RG_BME280_MODE_SLEEP     0x00
+#define RG_BME280_MODE_FORCED    0x01
+
+// Trimming parameters, read once at init
+typedef struct {
+    uint16_t dig_T1;
+    int16_t dig_T2;
+    int16_t dig_T3;
+    uint16_t dig_P1;
+    int16_t dig_P2;
+    int16_t dig_P3;
+    int16_t dig_P4;
+    int16_t dig_P5;
+    int16_t dig_P6;
+    int16_t dig_P7;
+    int16_t dig_P8;
+    int16_t dig_P9;
+    uint8_t dig_H1;
+    int16_t dig_H2;
+    uint8_t dig_H3;
+    int16_t dig_H4;
+    int16_t dig_H5;
+    int8_t dig_H6;
+} rg_bme280_calib_t;
+
+// Uncompensated ADC values from one burst read
+typedef struct {
+    int32_t adc_T; // 20 bit
+    int32_t adc_P; // 20 bit
+    int32_t adc_H; // 16 bit
+} rg_bme280_raw_t;
+
+// Compensated sample in the datasheet's integer formats
+typedef struct {
+    int32_t temperature;  // 0.01 degC
+    uint32_t pressure;    // Pa in Q24.8 (divide by 256 for Pa)
+    uint32_t humidity;    // %RH in Q22.10 (divide by 1024 for %RH)
+} rg_bme280_fixed_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decodes the trimming parameters from the 0x88 and 0xE1 register blocks.
+ */
+void rg_bme280_parse_calib(const uint8_t tp[RG_BME280_CALIB_TP_LEN], const uint8_t h[RG_BME280_CALIB_H_LEN],
+                           rg_bme280_calib_t *calib);
+
+/**
+ * @brief Splits the 0xF7..0xFE burst into the three ADC values.
+ */
+void rg_bme280_parse_raw(const uint8_t data[RG_BME280_DATA_LEN], rg_bme280_raw_t *raw);
+
+/**
+ * @brief Runs the Bosch integer compensation (datasheet section 4.2.3) on one sample.
+ *
+ * Temperature is computed once and its t_fine reused for pressure and humidity.
+ * No floating point is used.
+ */
+void rg_bme280_compensate(const rg_bme280_calib_t *calib, const rg_bme280_raw_t *raw, rg_bme280_fixed_t *out);
+
+/**
+ * @brief Maximum measurement time in microseconds for the given oversampling
+ * register settings (1 = x1 ... 5 = x16, 0 = skipped), datasheet section 9.1.
+ */
+uint32_t rg_bme280_measure_time_us(uint8_t osrs_t, uint8_t osrs_p, uint8_t osrs_h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_BME280_COMPENSATION_H_ */
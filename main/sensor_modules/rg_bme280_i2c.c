@@ -0,0 +1,152 @@
+// main/sensor_modules/rg_bme280_i2c.c
+// rg_bme280_init()/rg_bme280_deinit() for sensors on the board's shared I2C bus.
+#include "rg_bme280.h" // Include our custom header first
+#include "rg_i2c_bus_task.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"       // Required for esp_rom_delay_us
+#include "freertos/FreeRTOS.h" // Required for FreeRTOS types
+#include "freertos/semphr.h"
+#include "freertos/task.h"     // Required for vTaskDelay or similar
+
+#include <stdint.h>
+#include <string.h>
+
+static const char *TAG = "RG_BME280";
+
+// --- rg_bme280_bus_t on top of the shared bus; ctx is the device handle ---
+
+static esp_err_t i2c_read_regs(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    return rg_i2c_bus_task_transfer((uint8_t)(uintptr_t)ctx, &reg, 1, data, len);
+}
+
+static esp_err_t i2c_write_reg(void *ctx, uint8_t reg, uint8_t value)
+{
+    const uint8_t frame[2] = {reg, value};
+    return rg_i2c_bus_task_transfer((uint8_t)(uintptr_t)ctx, frame, sizeof(frame), NULL, 0);
+}
+
+typedef struct {
+    rg_i2c_txn_t txn;
+    rg_bme280_access_t *access;
+    SemaphoreHandle_t done;
+} batch_txn_t;
+
+static void batch_txn_done(rg_i2c_txn_t *txn, esp_err_t err)
+{
+    batch_txn_t *b = (batch_txn_t *)txn->ctx;
+    b->access->result = err;
+    xSemaphoreGive(b->done);
+}
+
+// Hands all accesses to the bus task as one chain, so they run back to back
+// in a single batch, and waits once for the lot
+static void i2c_batch(rg_bme280_access_t *accesses, size_t count)
+{
+    batch_txn_t txns[2 * RG_BME280_GROUP_MAX];
+    if (count == 0 || count > sizeof(txns) / sizeof(txns[0])) {
+        for (size_t i = 0; i < count; i++) {
+            accesses[i].result = ESP_ERR_INVALID_SIZE;
+        }
+        return;
+    }
+    // The bus task always completes a transfer (the driver times out), so waiting forever is safe
+    StaticSemaphore_t storage;
+    SemaphoreHandle_t done = xSemaphoreCreateCountingStatic(count, 0, &storage);
+    for (size_t i = 0; i < count; i++) {
+        rg_bme280_access_t *a = &accesses[i];
+        txns[i] = (batch_txn_t){
+            .txn = {
+                .device = (uint8_t)(uintptr_t)a->bus->ctx,
+                .write_len = a->data ? 1 : 2,
+                .write = {a->reg, a->value},
+                .read = a->data,
+                .read_len = a->data ? a->len : 0,
+                .done = batch_txn_done,
+                .ctx = &txns[i],
+                .next = i + 1 < count ? &txns[i + 1].txn : NULL,
+            },
+            .access = a,
+            .done = done,
+        };
+    }
+    esp_err_t err = rg_i2c_bus_task_submit(&txns[0].txn);
+    for (size_t i = 0; i < count; i++) {
+        if (err == ESP_OK) {
+            xSemaphoreTake(done, portMAX_DELAY);
+        } else {
+            accesses[i].result = err;
+        }
+    }
+    vSemaphoreDelete(done);
+}
+
+// Waits up to this long are busy-waited (status polls); longer ones sleep
+#define RTOS_DELAY_SPIN_MAX_US 1000
+
+// Never returns early. vTaskDelay(n) ends anywhere in the n-th tick period from
+// now, so it sleeps one tick more than the wait rounded up; a conversion
+// shorter than a tick sleeps too instead of spinning the CPU for milliseconds.
+static void rtos_delay_us(void *ctx, uint32_t us)
+{
+    (void)ctx;
+    const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+    if (us > RTOS_DELAY_SPIN_MAX_US) {
+        vTaskDelay((us + tick_us - 1) / tick_us + 1);
+    } else {
+        esp_rom_delay_us(us);
+    }
+}
+
+// Initialize the BME280 sensor module on the shared I2C bus
+esp_err_t rg_bme280_init(rg_bme280_t *rg_bme280, uint8_t addr)
+{
+    if (!rg_bme280 || (addr != RG_BME280_I2C_ADDR_PRIM && addr != RG_BME280_I2C_ADDR_SEC)) {
+        ESP_LOGE(TAG, "rg_bme280 context pointer is NULL or address is not a BME280 one.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(rg_bme280, 0, sizeof(*rg_bme280));
+
+    // 1. Attach to the bus; the clock follows the slowest device on it
+    const char *name = addr == RG_BME280_I2C_ADDR_PRIM ? "bme280@0x76" : "bme280@0x77";
+    esp_err_t ret = rg_i2c_bus_task_add_device(name, addr, RG_BME280_MAX_SCL_HZ, &rg_bme280->i2c_device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to attach BME280 at 0x%02x: %s", addr, esp_err_to_name(ret));
+        return ret;
+    }
+    rg_bme280->i2c_addr = addr;
+
+    rg_bme280_bus_t bus = {
+        .read = i2c_read_regs,
+        .write = i2c_write_reg,
+        .delay_us = rtos_delay_us,
+        .batch = i2c_batch,
+        .ctx = (void *)(uintptr_t)rg_bme280->i2c_device,
+    };
+
+    // 2. Reset, cache calibration and configure forced-mode sampling
+    ret = rg_bme280_init_with_bus(rg_bme280, &bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize BME280 at 0x%02x: %s", addr, esp_err_to_name(ret));
+        rg_bme280_deinit(rg_bme280);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "BME280 at 0x%02x initialization successful.", addr);
+
+    // No settling delay needed: every read triggers its own forced conversion
+    return ESP_OK;
+}
+
+// Deinitializes the BME280 sensor module, freeing allocated resources.
+void rg_bme280_deinit(rg_bme280_t *rg_bme280)
+{
+    if (rg_bme280) {
+        rg_bme280->bus.read = NULL;
+        if (rg_bme280->i2c_addr) {
+            rg_i2c_bus_task_remove_device(rg_bme280->i2c_device);
+            rg_bme280->i2c_addr = 0;
+        }
+        ESP_LOGI(TAG, "BME280 module deinitialized.");
+    }
+}
@@ -0,0 +1,137 @@
+// main/sensor_modules/rg_bme280_sim.c
+#include "rg_bme280_sim.h"
+
+#include <string.h>
+
+const rg_bme280_calib_t rg_bme280_sim_reference_calib = {
+    .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+    .dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855, .dig_P5 = 140,
+    .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+    .dig_H1 = 75, .dig_H2 = 362, .dig_H3 = 0, .dig_H4 = 324, .dig_H5 = 50, .dig_H6 = 30,
+};
+
+const rg_bme280_raw_t rg_bme280_sim_reference_raw = {.adc_T = 519888, .adc_P = 415148, .adc_H = 30000};
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void rg_bme280_sim_init(rg_bme280_sim_t *sim, const rg_bme280_calib_t *c, const rg_bme280_raw_t *adc)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->regs[RG_BME280_REG_CHIP_ID] = RG_BME280_CHIP_ID;
+    sim->adc = *adc;
+    sim->busy_polls = 1;
+
+    uint8_t *tp = &sim->regs[RG_BME280_REG_CALIB_TP];
+    put_le16(&tp[0], c->dig_T1);
+    put_le16(&tp[2], (uint16_t)c->dig_T2);
+    put_le16(&tp[4], (uint16_t)c->dig_T3);
+    put_le16(&tp[6], c->dig_P1);
+    put_le16(&tp[8], (uint16_t)c->dig_P2);
+    put_le16(&tp[10], (uint16_t)c->dig_P3);
+    put_le16(&tp[12], (uint16_t)c->dig_P4);
+    put_le16(&tp[14], (uint16_t)c->dig_P5);
+    put_le16(&tp[16], (uint16_t)c->dig_P6);
+    put_le16(&tp[18], (uint16_t)c->dig_P7);
+    put_le16(&tp[20], (uint16_t)c->dig_P8);
+    put_le16(&tp[22], (uint16_t)c->dig_P9);
+    tp[25] = c->dig_H1;
+
+    // dig_H4/H5 are 12-bit values sharing the nibbles of 0xE5
+    uint8_t *h = &sim->regs[RG_BME280_REG_CALIB_H];
+    put_le16(&h[0], (uint16_t)c->dig_H2);
+    h[2] = c->dig_H3;
+    h[3] = (uint8_t)(c->dig_H4 >> 4);
+    h[4] = (uint8_t)((c->dig_H4 & 0x0F) | ((c->dig_H5 & 0x0F) << 4));
+    h[5] = (uint8_t)(c->dig_H5 >> 4);
+    h[6] = (uint8_t)c->dig_H6;
+}
+
+void rg_bme280_sim_latch(rg_bme280_sim_t *sim)
+{
+    uint8_t *d = &sim->regs[RG_BME280_REG_DATA];
+    d[0] = (uint8_t)(sim->adc.adc_P >> 12);
+    d[1] = (uint8_t)(sim->adc.adc_P >> 4);
+    d[2] = (uint8_t)((sim->adc.adc_P & 0x0F) << 4);
+    d[3] = (uint8_t)(sim->adc.adc_T >> 12);
+    d[4] = (uint8_t)(sim->adc.adc_T >> 4);
+    d[5] = (uint8_t)((sim->adc.adc_T & 0x0F) << 4);
+    d[6] = (uint8_t)(sim->adc.adc_H >> 8);
+    d[7] = (uint8_t)sim->adc.adc_H;
+}
+
+static esp_err_t sim_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    rg_bme280_sim_t *sim = (rg_bme280_sim_t *)ctx;
+    if ((size_t)reg + len > sizeof(sim->regs)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    sim->transactions++;
+    sim->bus_bytes += 3 + len; // addr+W, reg, addr+R, data
+    if (reg == RG_BME280_REG_STATUS && sim->busy_left > 0 && --sim->busy_left == 0) {
+        rg_bme280_sim_latch(sim);
+        sim->regs[RG_BME280_REG_STATUS] &= (uint8_t)~RG_BME280_STATUS_MEASURING;
+        sim->regs[RG_BME280_REG_CTRL_MEAS] &= (uint8_t)~0x03; // Back to sleep
+    }
+    memcpy(data, &sim->regs[reg], len);
+    return ESP_OK;
+}
+
+static esp_err_t sim_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    rg_bme280_sim_t *sim = (rg_bme280_sim_t *)ctx;
+    sim->transactions++;
+    sim->bus_bytes += 3; // addr+W, reg, value
+    if (reg == RG_BME280_REG_RESET) {
+        if (value == RG_BME280_RESET_VALUE) {
+            sim->regs[RG_BME280_REG_CTRL_HUM] = 0;
+            sim->regs[RG_BME280_REG_CTRL_MEAS] = 0;
+            sim->regs[RG_BME280_REG_CONFIG] = 0;
+        }
+        return ESP_OK;
+    }
+    sim->regs[reg] = value;
+    if (reg == RG_BME280_REG_CTRL_MEAS && (value & 0x03) != RG_BME280_MODE_SLEEP) {
+        sim->regs[RG_BME280_REG_STATUS] |= RG_BME280_STATUS_MEASURING;
+        sim->busy_left = sim->busy_polls;
+    }
+    return ESP_OK;
+}
+
+static void sim_delay_us(void *ctx, uint32_t us)
+{
+    ((rg_bme280_sim_t *)ctx)->delay_us += us;
+}
+
+rg_bme280_bus_t rg_bme280_sim_bus(rg_bme280_sim_t *sim)
+{
+    rg_bme280_bus_t bus = {
+        .read = sim_read,
+        .write = sim_write,
+        .delay_us = sim_delay_us,
+        .ctx = sim,
+    };
+    return bus;
+}
+
+esp_err_t rg_bme280_sim_transfer(rg_bme280_sim_t *sim, const uint8_t *write, size_t write_len, uint8_t *read,
+                                 size_t read_len)
+{
+    if (write_len == 1 && read_len > 0) {
+        return sim_read(sim, write[0], read, read_len);
+    }
+    if (write_len == 2 && read_len == 0) {
+        return sim_write(sim, write[0], write[1]);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+void rg_bme280_sim_reset_counters(rg_bme280_sim_t *sim)
+{
+    sim->transactions = 0;
+    sim->bus_bytes = 0;
+    sim->delay_us = 0;
+}
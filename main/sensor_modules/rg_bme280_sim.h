@@ -0,0 +1,74 @@
+// main/sensor_modules/rg_bme280_sim.h
+#ifndef RG_BME280_SIM_H_
+#define RG_BME280_SIM_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include "rg_bme280.h"
+
+// Register-level model of a BME280 behind rg_bme280_bus_t.
+//
+// It answers the chip ID, holds the calibration blocks in the datasheet
+// layout and runs forced conversions: a ctrl_meas write with a non-sleep mode
+// sets the "measuring" status bit, and after `busy_polls` status reads the
+// configured ADC values appear in 0xF7..0xFE and the part returns to sleep.
+// Delays are not slept but added up, so runs are fast and deterministic.
+//
+// Used by the unit tests, the host build and the benchmarks. Every transfer is
+// counted with its size on the wire (address, register and data bytes).
+
+typedef struct {
+    uint8_t regs[256];
+    rg_bme280_raw_t adc;   // Latched into the data registers by the next conversion
+    int busy_polls;        // Status reads reporting "measuring" after a trigger
+    int busy_left;
+    uint32_t transactions;
+    uint32_t bus_bytes;
+    uint64_t delay_us;     // Sum of all requested delays
+} rg_bme280_sim_t;
+
+// Calibration and ADC readings with known compensated results:
+// 25.08 degC, 100653.25 Pa (Q24.8 25767233), 51.08 %RH (Q22.10 52306).
+extern const rg_bme280_calib_t rg_bme280_sim_reference_calib;
+extern const rg_bme280_raw_t rg_bme280_sim_reference_raw;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Powers up the model with @p calib in its NVM and @p adc as the next reading.
+ */
+void rg_bme280_sim_init(rg_bme280_sim_t *sim, const rg_bme280_calib_t *calib, const rg_bme280_raw_t *adc);
+
+/**
+ * @brief Copies the current ADC values into the data registers, as a finished conversion does.
+ */
+void rg_bme280_sim_latch(rg_bme280_sim_t *sim);
+
+/**
+ * @brief Bus callbacks that talk to @p sim.
+ */
+rg_bme280_bus_t rg_bme280_sim_bus(rg_bme280_sim_t *sim);
+
+/**
+ * @brief Runs one raw I2C transfer against @p sim: a register address, then
+ * either one data byte to write or a burst read after a repeated start.
+ *
+ * Lets the model sit behind rg_i2c_bus_driver_t as one device of a shared bus.
+ */
+esp_err_t rg_bme280_sim_transfer(rg_bme280_sim_t *sim, const uint8_t *write, size_t write_len, uint8_t *read,
+                                 size_t read_len);
+
+/**
+ * @brief Clears the transaction, byte and delay counters.
+ */
+void rg_bme280_sim_reset_counters(rg_bme280_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_BME280_SIM_H_ */
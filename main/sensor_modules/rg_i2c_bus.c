@@ -0,0 +1,214 @@
+// main/sensor_modules/rg_i2c_bus.c
+#include "rg_i2c_bus.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "RG_I2C_BUS";
+
+static bool slot_used(const rg_i2c_device_t *dev)
+{
+    return dev->name != NULL;
+}
+
+// Address byte per direction plus the data
+static uint32_t wire_bytes(size_t write_len, size_t read_len)
+{
+    return (uint32_t)((write_len ? 1 + write_len : 0) + (read_len ? 1 + read_len : 0));
+}
+
+// Re-attaches every device at scl_hz; the driver fixes the clock per device handle
+static esp_err_t reclock(rg_i2c_bus_t *bus, uint32_t scl_hz)
+{
+    esp_err_t first_err = ESP_OK;
+    for (int i = 0; i < RG_I2C_BUS_MAX_DEVICES; i++) {
+        rg_i2c_device_t *dev = &bus->devices[i];
+        if (!slot_used(dev)) {
+            continue;
+        }
+        bus->driver.detach(bus->driver.ctx, dev->handle);
+        dev->handle = NULL;
+        esp_err_t err = bus->driver.attach(bus->driver.ctx, dev->addr, scl_hz, &dev->handle);
+        if (err != ESP_OK && first_err == ESP_OK) {
+            ESP_LOGE(TAG, "Failed to re-attach %s at %lu Hz: %s", dev->name, (unsigned long)scl_hz,
+                     esp_err_to_name(err));
+            first_err = err;
+        }
+    }
+    bus->scl_hz = scl_hz;
+    return first_err;
+}
+
+void rg_i2c_bus_init(rg_i2c_bus_t *bus, const rg_i2c_bus_driver_t *driver, uint32_t max_scl_hz)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->driver = *driver;
+    bus->max_scl_hz = max_scl_hz;
+}
+
+esp_err_t rg_i2c_bus_add_device(rg_i2c_bus_t *bus, const char *name, uint8_t addr, uint32_t max_scl_hz,
+                                uint8_t *device)
+{
+    if (!bus || !name || !device || addr > 0x7F || max_scl_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int free_slot = -1;
+    for (int i = 0; i < RG_I2C_BUS_MAX_DEVICES; i++) {
+        if (!slot_used(&bus->devices[i])) {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+        } else if (bus->devices[i].addr == addr) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    if (free_slot < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t scl_hz = max_scl_hz < bus->max_scl_hz ? max_scl_hz : bus->max_scl_hz;
+    if (bus->scl_hz != 0 && bus->scl_hz < scl_hz) {
+        scl_hz = bus->scl_hz;
+    }
+    if (bus->scl_hz != 0 && scl_hz < bus->scl_hz) {
+        ESP_LOGI(TAG, "%s lowers the bus clock from %lu to %lu Hz.", name, (unsigned long)bus->scl_hz,
+                 (unsigned long)scl_hz);
+        esp_err_t err = reclock(bus, scl_hz);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    rg_i2c_device_t *dev = &bus->devices[free_slot];
+    memset(dev, 0, sizeof(*dev));
+    esp_err_t err = bus->driver.attach(bus->driver.ctx, addr, scl_hz, &dev->handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    dev->name = name;
+    dev->addr = addr;
+    dev->max_scl_hz = max_scl_hz;
+    bus->scl_hz = scl_hz;
+    *device = (uint8_t)free_slot;
+    return ESP_OK;
+}
+
+void rg_i2c_bus_remove_device(rg_i2c_bus_t *bus, uint8_t device)
+{
+    if (!bus || device >= RG_I2C_BUS_MAX_DEVICES || !slot_used(&bus->devices[device])) {
+        return;
+    }
+    bus->driver.detach(bus->driver.ctx, bus->devices[device].handle);
+    memset(&bus->devices[device], 0, sizeof(bus->devices[device]));
+
+    uint32_t scl_hz = 0;
+    for (int i = 0; i < RG_I2C_BUS_MAX_DEVICES; i++) {
+        const rg_i2c_device_t *dev = &bus->devices[i];
+        if (slot_used(dev) && (scl_hz == 0 || dev->max_scl_hz < scl_hz)) {
+            scl_hz = dev->max_scl_hz;
+        }
+    }
+    if (scl_hz > bus->max_scl_hz) {
+        scl_hz = bus->max_scl_hz;
+    }
+    if (scl_hz > bus->scl_hz) {
+        reclock(bus, scl_hz);
+    } else if (scl_hz == 0) {
+        bus->scl_hz = 0;
+    }
+}
+
+void rg_i2c_bus_run(rg_i2c_bus_t *bus, rg_i2c_txn_t *const *txns, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    bus->batches++;
+    if (count > bus->max_batch) {
+        bus->max_batch = (uint32_t)count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        rg_i2c_txn_t *txn = txns[i];
+        esp_err_t err = ESP_ERR_INVALID_ARG;
+        rg_i2c_device_t *dev = txn->device < RG_I2C_BUS_MAX_DEVICES ? &bus->devices[txn->device] : NULL;
+        if (dev && slot_used(dev)) {
+            if (i > 0) {
+                bus->contended++;
+            }
+            int64_t start_us = esp_timer_get_time();
+            err = bus->driver.transfer(bus->driver.ctx, dev->handle, txn->write, txn->write_len, txn->read,
+                                       txn->read_len);
+            int64_t end_us = esp_timer_get_time();
+
+            dev->stats.transactions++;
+            dev->stats.bytes += wire_bytes(txn->write_len, txn->read_len);
+            dev->stats.busy_us += (uint64_t)(end_us - start_us);
+            if (txn->submitted_us != 0 && start_us > txn->submitted_us) {
+                dev->stats.wait_us += (uint64_t)(start_us - txn->submitted_us);
+            }
+            if (err != ESP_OK) {
+                dev->stats.errors++;
+            }
+        }
+        // Last access to txn: the submitter may reuse or free it from here on
+        if (txn->done) {
+            txn->done(txn, err);
+        }
+    }
+}
+
+// One line per attached device, labelled device="<name>"
+static void write_per_device(const rg_i2c_bus_t *bus, rg_metrics_writer_t *writer, const char *name,
+                             const char *type, const char *help, size_t offset, bool seconds)
+{
+    char labels[48];
+    rg_metrics_write_family(writer, name, type, help);
+    for (int i = 0; i < RG_I2C_BUS_MAX_DEVICES; i++) {
+        const rg_i2c_device_t *dev = &bus->devices[i];
+        if (!slot_used(dev)) {
+            continue;
+        }
+        int n = snprintf(labels, sizeof(labels), "device=\"");
+        n += rg_metrics_escape_label(labels + n, sizeof(labels) - n - 1, dev->name);
+        snprintf(labels + n, sizeof(labels) - n, "\"");
+
+        const uint8_t *field = (const uint8_t *)&dev->stats + offset;
+        if (seconds) {
+            uint64_t us;
+            memcpy(&us, field, sizeof(us));
+            rg_metrics_write_seconds(writer, name, labels, us);
+        } else {
+            uint32_t value;
+            memcpy(&value, field, sizeof(value));
+            rg_metrics_write_value(writer, name, labels, value);
+        }
+    }
+}
+
+void rg_i2c_bus_write_metrics(const rg_i2c_bus_t *bus, rg_metrics_writer_t *writer)
+{
+    rg_metrics_write_family(writer, "rg_i2c_bus_clock_hz", "gauge", "SCL frequency shared by all devices.");
+    rg_metrics_write_value(writer, "rg_i2c_bus_clock_hz", NULL, bus->scl_hz);
+    rg_metrics_write_family(writer, "rg_i2c_bus_batches_total", "counter", "Wake-ups of the bus task.");
+    rg_metrics_write_value(writer, "rg_i2c_bus_batches_total", NULL, bus->batches);
+    rg_metrics_write_family(writer, "rg_i2c_bus_contended_total", "counter",
+                            "Transfers that waited for the bus behind another one.");
+    rg_metrics_write_value(writer, "rg_i2c_bus_contended_total", NULL, bus->contended);
+
+    write_per_device(bus, writer, "rg_i2c_device_transactions_total", "counter", "Transfers per device.",
+                     offsetof(rg_i2c_device_stats_t, transactions), false);
+    write_per_device(bus, writer, "rg_i2c_device_errors_total", "counter", "Failed transfers per device.",
+                     offsetof(rg_i2c_device_stats_t, errors), false);
+    write_per_device(bus, writer, "rg_i2c_device_bytes_total", "counter",
+                     "Bytes on the wire per device, address bytes included.",
+                     offsetof(rg_i2c_device_stats_t, bytes), false);
+    write_per_device(bus, writer, "rg_i2c_device_busy_seconds_total", "counter",
+                     "Time the bus was held for each device.", offsetof(rg_i2c_device_stats_t, busy_us), true);
+    write_per_device(bus, writer, "rg_i2c_device_wait_seconds_total", "counter",
+                     "Time each device's transfers waited in the bus queue.",
+                     offsetof(rg_i2c_device_stats_t, wait_us), true);
+}
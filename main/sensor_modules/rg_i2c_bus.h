@@ -0,0 +1,130 @@
+// main/sensor_modules/rg_i2c_bus.h
+#ifndef RG_I2C_BUS_H_
+#define RG_I2C_BUS_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "services/metrics/rg_metrics.h"
+
+// Shared I2C bus: one owner for the controller and every device on it.
+//
+// Devices register with their address and the fastest SCL they support. The
+// bus runs at the slowest of those, capped by the board limit, because a
+// device that cannot follow the clock may misread traffic meant for others;
+// registering a slower device re-clocks the ones already attached.
+//
+// Transfers are rg_i2c_txn_t descriptors: an optional write (register
+// address, data) followed by an optional read after a repeated start. The
+// engine runs them in batches, in submission order, and calls each one's
+// completion callback. It is not thread-safe; rg_i2c_bus_task.h wraps it in
+// a queue and a bus task on the device, tests drive it directly.
+//
+// Per device, the engine accounts the time the bus was held for it and the
+// time its transfers waited behind others, so contention is visible in
+// /metrics.
+
+#define RG_I2C_BUS_MAX_DEVICES 8
+#define RG_I2C_TXN_MAX_WRITE 4
+
+typedef struct rg_i2c_txn rg_i2c_txn_t;
+
+// Called from the bus task once @p txn has finished; the engine no longer
+// touches @p txn afterwards, so it may live on the submitter's stack.
+typedef void (*rg_i2c_txn_done_t)(rg_i2c_txn_t *txn, esp_err_t err);
+
+struct rg_i2c_txn {
+    uint8_t device;                      // Handle from rg_i2c_bus_add_device()
+    uint8_t write_len;
+    uint8_t write[RG_I2C_TXN_MAX_WRITE]; // Register address, then data for register writes
+    uint8_t *read;                       // Read after a repeated start; NULL for write-only
+    size_t read_len;
+    rg_i2c_txn_done_t done;              // May be NULL
+    void *ctx;                           // For the callback
+    int64_t submitted_us;                // esp_timer time of submission; 0 skips wait accounting
+    rg_i2c_txn_t *next;                  // Submitted along with this one and run in the same batch
+};
+
+// The controller behind the engine: i2c_master on the device, simulated
+// sensors in the tests
+typedef struct {
+    esp_err_t (*attach)(void *ctx, uint8_t addr, uint32_t scl_hz, void **handle);
+    void (*detach)(void *ctx, void *handle);
+    esp_err_t (*transfer)(void *ctx, void *handle, const uint8_t *write, size_t write_len, uint8_t *read,
+                          size_t read_len);
+    void *ctx;
+} rg_i2c_bus_driver_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t bytes;   // On the wire: address bytes plus data in both directions
+    uint64_t busy_us; // Time the bus was held for this device
+    uint64_t wait_us; // Time its transfers spent queued
+} rg_i2c_device_stats_t;
+
+typedef struct {
+    const char *name; // Label in /metrics, e.g. "bme280@0x76"; NULL marks a free slot
+    uint8_t addr;
+    uint32_t max_scl_hz;
+    void *handle;     // From the driver's attach()
+    rg_i2c_device_stats_t stats;
+} rg_i2c_device_t;
+
+typedef struct {
+    rg_i2c_bus_driver_t driver;
+    uint32_t max_scl_hz; // Board limit: pull-ups and wiring
+    uint32_t scl_hz;     // Current clock; 0 while no device is attached
+    rg_i2c_device_t devices[RG_I2C_BUS_MAX_DEVICES];
+    uint32_t batches;
+    uint32_t contended;  // Transfers that found the bus held for an earlier one
+    uint32_t max_batch;
+} rg_i2c_bus_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up an empty bus on @p driver, clocked at most at @p max_scl_hz.
+ */
+void rg_i2c_bus_init(rg_i2c_bus_t *bus, const rg_i2c_bus_driver_t *driver, uint32_t max_scl_hz);
+
+/**
+ * @brief Attaches a device at the 7-bit @p addr and returns its handle in @p device.
+ *
+ * If @p max_scl_hz is below the current clock, every attached device is
+ * re-attached at the lower clock first. @p name must outlive the registration.
+ *
+ * @return ESP_ERR_INVALID_STATE if @p addr is taken, ESP_ERR_NO_MEM if the table is full,
+ *         or the driver's error.
+ */
+esp_err_t rg_i2c_bus_add_device(rg_i2c_bus_t *bus, const char *name, uint8_t addr, uint32_t max_scl_hz,
+                                uint8_t *device);
+
+/**
+ * @brief Detaches @p device; the clock goes back up if it was the slowest.
+ */
+void rg_i2c_bus_remove_device(rg_i2c_bus_t *bus, uint8_t device);
+
+/**
+ * @brief Runs @p count transfers back to back in order and completes each one.
+ *
+ * Transfers naming a free slot complete with ESP_ERR_INVALID_ARG.
+ */
+void rg_i2c_bus_run(rg_i2c_bus_t *bus, rg_i2c_txn_t *const *txns, size_t count);
+
+/**
+ * @brief Writes the clock, contention and per-device counters as Prometheus text.
+ */
+void rg_i2c_bus_write_metrics(const rg_i2c_bus_t *bus, rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_I2C_BUS_H_ */
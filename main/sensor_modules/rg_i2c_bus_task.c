@@ -0,0 +1,241 @@
+// main/sensor_modules/rg_i2c_bus_task.c
+#include "rg_i2c_bus_task.h"
+
+#include <string.h>
+
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "services/metrics/rg_metrics.h"
+#include "services/rtos/rg_static_alloc.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_I2C_BUS";
+
+// Per transfer; a BME280 burst at 100 kHz takes about 1 ms
+#define XFER_TIMEOUT_MS 50
+// Transfers taken from the queue per wake-up of the bus task
+#define BATCH_MAX 8
+
+static rg_i2c_bus_t s_bus;
+static i2c_master_bus_handle_t s_master = NULL;
+static QueueHandle_t s_queue = NULL;
+// Held by the bus task while it runs a batch, and around device changes and metric reads
+static SemaphoreHandle_t s_lock = NULL;
+RG_QUEUE_STORAGE(s_queue, CONFIG_RG_I2C_BUS_QUEUE_LEN, sizeof(rg_i2c_txn_t *));
+RG_MUTEX_STORAGE(s_lock);
+RG_TASK_STORAGE(s_task, 3072);
+
+// --- rg_i2c_bus_driver_t on top of i2c_master ---
+
+static esp_err_t master_attach(void *ctx, uint8_t addr, uint32_t scl_hz, void **handle)
+{
+    i2c_device_config_t cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = scl_hz,
+    };
+    return i2c_master_bus_add_device((i2c_master_bus_handle_t)ctx, &cfg, (i2c_master_dev_handle_t *)handle);
+}
+
+static void master_detach(void *ctx, void *handle)
+{
+    (void)ctx;
+    if (handle) {
+        i2c_master_bus_rm_device((i2c_master_dev_handle_t)handle);
+    }
+}
+
+static esp_err_t master_transfer(void *ctx, void *handle, const uint8_t *write, size_t write_len, uint8_t *read,
+                                 size_t read_len)
+{
+    (void)ctx;
+    i2c_master_dev_handle_t dev = (i2c_master_dev_handle_t)handle;
+    if (read_len == 0) {
+        return i2c_master_transmit(dev, write, write_len, XFER_TIMEOUT_MS);
+    }
+    if (write_len == 0) {
+        return i2c_master_receive(dev, read, read_len, XFER_TIMEOUT_MS);
+    }
+    return i2c_master_transmit_receive(dev, write, write_len, read, read_len, XFER_TIMEOUT_MS);
+}
+
+static void run_batch(rg_i2c_txn_t *const *batch, size_t count)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    rg_i2c_bus_run(&s_bus, batch, count);
+    xSemaphoreGive(s_lock);
+}
+
+// Owns the controller: everything queued while a batch ran goes out in the next one
+static void i2c_bus_task(void *pvParameter)
+{
+    rg_i2c_txn_t *batch[BATCH_MAX];
+    rg_i2c_txn_t *txn;
+    while (1) {
+        if (xQueueReceive(s_queue, &txn, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        size_t count = 0;
+        do {
+            // A chain from one submit stays together unless it overflows the batch
+            for (; txn; txn = txn->next) {
+                if (count == BATCH_MAX) {
+                    run_batch(batch, count);
+                    count = 0;
+                }
+                batch[count++] = txn;
+            }
+        } while (count < BATCH_MAX && xQueueReceive(s_queue, &txn, 0) == pdTRUE);
+        run_batch(batch, count);
+    }
+}
+
+static void collect_i2c_bus(rg_metrics_writer_t *writer)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    rg_i2c_bus_write_metrics(&s_bus, writer);
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t rg_i2c_bus_task_start(void)
+{
+    if (s_queue) {
+        return ESP_OK;
+    }
+
+    i2c_master_bus_config_t cfg = {
+        .i2c_port = I2C_NUM_0,
+        .sda_io_num = (gpio_num_t)CONFIG_BME280_I2C_SDA_GPIO,
+        .scl_io_num = (gpio_num_t)CONFIG_BME280_I2C_SCL_GPIO,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t err = i2c_new_master_bus(&cfg, &s_master);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    rg_i2c_bus_driver_t driver = {
+        .attach = master_attach,
+        .detach = master_detach,
+        .transfer = master_transfer,
+        .ctx = s_master,
+    };
+    rg_i2c_bus_init(&s_bus, &driver, CONFIG_RG_I2C_BUS_MAX_SCL_HZ);
+
+    s_lock = RG_MUTEX_CREATE(s_lock);
+    s_queue = RG_QUEUE_CREATE(s_queue);
+    // Above the sensor task, so a queued transfer never waits for it
+    if (!s_lock || !s_queue || RG_TASK_CREATE(s_task, i2c_bus_task, "i2c_bus", NULL, 6) != pdPASS) {
+        if (s_queue) {
+            vQueueDelete(s_queue);
+            s_queue = NULL;
+        }
+        if (s_lock) {
+            vSemaphoreDelete(s_lock);
+            s_lock = NULL;
+        }
+        i2c_del_master_bus(s_master);
+        s_master = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    rg_metrics_register_collector(collect_i2c_bus);
+
+    ESP_LOGI(TAG, "I2C bus on SDA:%d SCL:%d, up to %d Hz.", CONFIG_BME280_I2C_SDA_GPIO,
+             CONFIG_BME280_I2C_SCL_GPIO, CONFIG_RG_I2C_BUS_MAX_SCL_HZ);
+    return ESP_OK;
+}
+
+esp_err_t rg_i2c_bus_task_add_device(const char *name, uint8_t addr, uint32_t max_scl_hz, uint8_t *device)
+{
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = rg_i2c_bus_add_device(&s_bus, name, addr, max_scl_hz, device);
+    xSemaphoreGive(s_lock);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "%s attached at 0x%02x, bus clock %lu Hz.", name, addr, (unsigned long)s_bus.scl_hz);
+    }
+    return err;
+}
+
+void rg_i2c_bus_task_remove_device(uint8_t device)
+{
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    rg_i2c_bus_remove_device(&s_bus, device);
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t rg_i2c_bus_task_submit(rg_i2c_txn_t *txn)
+{
+    if (!s_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!txn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const int64_t now_us = esp_timer_get_time();
+    for (rg_i2c_txn_t *t = txn; t; t = t->next) {
+        if (t->write_len > RG_I2C_TXN_MAX_WRITE) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        t->submitted_us = now_us;
+    }
+    return xQueueSend(s_queue, &txn, portMAX_DELAY) == pdTRUE ? ESP_OK : ESP_FAIL;
+}
+
+typedef struct {
+    SemaphoreHandle_t done;
+    esp_err_t err;
+} sync_wait_t;
+
+static void sync_done(rg_i2c_txn_t *txn, esp_err_t err)
+{
+    sync_wait_t *wait = (sync_wait_t *)txn->ctx;
+    wait->err = err;
+    xSemaphoreGive(wait->done);
+}
+
+esp_err_t rg_i2c_bus_task_transfer(uint8_t device, const uint8_t *write, size_t write_len, uint8_t *read,
+                                   size_t read_len)
+{
+    if (write_len > RG_I2C_TXN_MAX_WRITE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // The bus task always completes a transfer (the driver times out), so waiting forever is safe
+    StaticSemaphore_t storage;
+    sync_wait_t wait = {
+        .done = xSemaphoreCreateBinaryStatic(&storage),
+        .err = ESP_FAIL,
+    };
+    rg_i2c_txn_t txn = {
+        .device = device,
+        .write_len = (uint8_t)write_len,
+        .read = read,
+        .read_len = read_len,
+        .done = sync_done,
+        .ctx = &wait,
+    };
+    if (write_len) {
+        memcpy(txn.write, write, write_len);
+    }
+
+    esp_err_t err = rg_i2c_bus_task_submit(&txn);
+    if (err == ESP_OK) {
+        xSemaphoreTake(wait.done, portMAX_DELAY);
+        err = wait.err;
+    }
+    vSemaphoreDelete(wait.done);
+    return err;
+}
@@ -0,0 +1,55 @@
+// main/sensor_modules/rg_i2c_bus_task.h
+#ifndef RG_I2C_BUS_TASK_H_
+#define RG_I2C_BUS_TASK_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "rg_i2c_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates the board's I2C bus on the i2c_master driver and starts the bus task.
+ *
+ * The bus task is the only code touching the controller: it drains the
+ * transfer queue in batches and runs completion callbacks. Pins and the
+ * clock limit come from Kconfig. Also adds the bus counters to /metrics.
+ */
+esp_err_t rg_i2c_bus_task_start(void);
+
+/**
+ * @brief Attaches a device to the shared bus; see rg_i2c_bus_add_device().
+ */
+esp_err_t rg_i2c_bus_task_add_device(const char *name, uint8_t addr, uint32_t max_scl_hz, uint8_t *device);
+
+/**
+ * @brief Detaches a device from the shared bus.
+ */
+void rg_i2c_bus_task_remove_device(uint8_t device);
+
+/**
+ * @brief Queues @p txn and returns; its callback runs on the bus task when done.
+ *
+ * Transfers linked through @p txn->next go with it and run back to back in
+ * the same batch. Each must stay valid until its callback has run. Blocks
+ * only while the queue is full.
+ */
+esp_err_t rg_i2c_bus_task_submit(rg_i2c_txn_t *txn);
+
+/**
+ * @brief Queues one transfer and waits for it. Not for use in completion callbacks.
+ */
+esp_err_t rg_i2c_bus_task_transfer(uint8_t device, const uint8_t *write, size_t write_len, uint8_t *read,
+                                   size_t read_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_I2C_BUS_TASK_H_ */
@@ -0,0 +1,127 @@
+// main/services/boot/rg_boot.c
+#include "rg_boot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "RG_BOOT";
+
+static int64_t s_marks[RG_BOOT_MARK_COUNT];
+
+static const char *const s_mark_names[RG_BOOT_MARK_COUNT] = {
+    "first_sample",
+    "got_ip",
+    "first_served",
+};
+
+void rg_boot_init(rg_boot_t *boot)
+{
+    memset(boot, 0, sizeof(*boot));
+}
+
+int rg_boot_add(rg_boot_t *boot, const char *name, rg_boot_fn_t fn, void *arg, uint32_t deps)
+{
+    if (boot->count == RG_BOOT_MAX_STAGES || (deps >> boot->count) != 0) {
+        return -1;
+    }
+    rg_boot_stage_t *stage = &boot->stages[boot->count];
+    stage->name = name;
+    stage->fn = fn;
+    stage->arg = arg;
+    stage->deps = deps;
+    stage->status = RG_BOOT_PENDING;
+    return boot->count++;
+}
+
+int rg_boot_take_ready(rg_boot_t *boot, int64_t now_us)
+{
+    // Stages only depend on earlier ones, so one pass in order settles skips in cascade
+    for (int i = 0; i < boot->count; i++) {
+        rg_boot_stage_t *stage = &boot->stages[i];
+        if (stage->status != RG_BOOT_PENDING) {
+            continue;
+        }
+        bool ready = true;
+        bool blocked = false;
+        for (int d = 0; d < i; d++) {
+            if (!(stage->deps & RG_BOOT_DEP(d))) {
+                continue;
+            }
+            rg_boot_status_t dep = boot->stages[d].status;
+            blocked |= dep == RG_BOOT_FAILED || dep == RG_BOOT_SKIPPED;
+            ready &= dep == RG_BOOT_DONE;
+        }
+        if (blocked) {
+            stage->status = RG_BOOT_SKIPPED;
+            stage->start_us = stage->end_us = now_us;
+            boot->finished++;
+            ESP_LOGW(TAG, "Skipping %s: a stage it needs failed.", stage->name);
+        } else if (ready) {
+            stage->status = RG_BOOT_RUNNING;
+            stage->start_us = now_us;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void rg_boot_finish(rg_boot_t *boot, int id, esp_err_t err, int64_t now_us)
+{
+    rg_boot_stage_t *stage = &boot->stages[id];
+    stage->status = err == ESP_OK ? RG_BOOT_DONE : RG_BOOT_FAILED;
+    stage->err = err;
+    stage->end_us = now_us;
+    boot->finished++;
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "%s done in %lld ms (at %lld ms).", stage->name, (long long)(now_us - stage->start_us) / 1000,
+                 (long long)now_us / 1000);
+    } else {
+        ESP_LOGE(TAG, "%s failed after %lld ms: %s", stage->name, (long long)(now_us - stage->start_us) / 1000,
+                 esp_err_to_name(err));
+    }
+}
+
+bool rg_boot_done(const rg_boot_t *boot)
+{
+    return boot->finished == boot->count;
+}
+
+bool rg_boot_mark(rg_boot_mark_t mark, int64_t now_us)
+{
+    int64_t expected = 0;
+    if (now_us <= 0) {
+        now_us = 1; // 0 means "not reached"
+    }
+    if (!__atomic_compare_exchange_n(&s_marks[mark], &expected, now_us, false, __ATOMIC_RELAXED,
+                                     __ATOMIC_RELAXED)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Milestone %s at %lld ms.", s_mark_names[mark], (long long)now_us / 1000);
+    return true;
+}
+
+int64_t rg_boot_mark_us(rg_boot_mark_t mark)
+{
+    return __atomic_load_n(&s_marks[mark], __ATOMIC_RELAXED);
+}
+
+const char *rg_boot_mark_name(rg_boot_mark_t mark)
+{
+    return s_mark_names[mark];
+}
+
+void rg_boot_write_metrics(rg_metrics_writer_t *writer)
+{
+    rg_metrics_write_family(writer, "rg_boot_milestone_seconds", "gauge",
+                            "Time from application start to each boot milestone reached.");
+    for (int i = 0; i < RG_BOOT_MARK_COUNT; i++) {
+        int64_t us = rg_boot_mark_us((rg_boot_mark_t)i);
+        if (us > 0) {
+            char labels[40];
+            snprintf(labels, sizeof(labels), "milestone=\"%s\"", s_mark_names[i]);
+            rg_metrics_write_seconds(writer, "rg_boot_milestone_seconds", labels, (uint64_t)us);
+        }
+    }
+}
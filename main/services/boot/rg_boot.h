@@ -0,0 +1,121 @@
+// main/services/boot/rg_boot.h
+#ifndef RG_BOOT_H_
+#define RG_BOOT_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "services/metrics/rg_metrics.h"
+
+// Boot as a dependency graph instead of a fixed sequence.
+//
+// Each stage names the stages it needs; rg_boot_task.c runs every stage as
+// soon as its dependencies are done, on a few worker tasks, so slow steps
+// that mostly wait (Wi-Fi start, the flash log replay, sensor reset) overlap
+// instead of adding up. A failed stage skips the stages that depend on it
+// and nothing else. Stages can only depend on stages added before them, so
+// the graph cannot have a cycle.
+//
+// This file is the portable bookkeeping, with the clock passed in. It also
+// keeps the boot milestones (first sample, IP address, first /data served)
+// that the log and /metrics report as time since boot.
+
+#define RG_BOOT_MAX_STAGES 16
+#define RG_BOOT_DEP(id) (1u << (id))
+
+typedef esp_err_t (*rg_boot_fn_t)(void *arg);
+
+typedef enum {
+    RG_BOOT_PENDING,
+    RG_BOOT_RUNNING,
+    RG_BOOT_DONE,
+    RG_BOOT_FAILED,
+    RG_BOOT_SKIPPED, // A dependency failed or was skipped
+} rg_boot_status_t;
+
+typedef struct {
+    const char *name;
+    rg_boot_fn_t fn;
+    void *arg;
+    uint32_t deps; // RG_BOOT_DEP() bits
+    rg_boot_status_t status;
+    esp_err_t err;
+    int64_t start_us;
+    int64_t end_us;
+} rg_boot_stage_t;
+
+typedef struct {
+    rg_boot_stage_t stages[RG_BOOT_MAX_STAGES];
+    uint8_t count;
+    uint8_t finished; // Stages done, failed or skipped
+} rg_boot_t;
+
+typedef enum {
+    RG_BOOT_MARK_FIRST_SAMPLE, // First sensor reading published
+    RG_BOOT_MARK_GOT_IP,       // Station obtained an IP address
+    RG_BOOT_MARK_FIRST_SERVED, // First reading served by GET /data
+    RG_BOOT_MARK_COUNT,
+} rg_boot_mark_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void rg_boot_init(rg_boot_t *boot);
+
+/**
+ * @brief Adds a stage that runs @p fn(@p arg) once the stages in @p deps are done.
+ *
+ * @return The stage id for RG_BOOT_DEP(), or -1 if the table is full or @p deps
+ * names a stage not added yet.
+ */
+int rg_boot_add(rg_boot_t *boot, const char *name, rg_boot_fn_t fn, void *arg, uint32_t deps);
+
+/**
+ * @brief Claims a stage whose dependencies are done and marks it running.
+ *
+ * Stages behind a failed dependency are marked skipped on the way.
+ *
+ * @return The stage id, or -1 if none is ready now.
+ */
+int rg_boot_take_ready(rg_boot_t *boot, int64_t now_us);
+
+/**
+ * @brief Records the result of a stage claimed with rg_boot_take_ready().
+ */
+void rg_boot_finish(rg_boot_t *boot, int id, esp_err_t err, int64_t now_us);
+
+/**
+ * @brief True once every stage has finished, failed or been skipped.
+ */
+bool rg_boot_done(const rg_boot_t *boot);
+
+/**
+ * @brief Records a milestone the first time it is reached and logs it.
+ *
+ * Safe from any task. @p now_us is esp_timer time, i.e. since the application started.
+ *
+ * @return true the first time.
+ */
+bool rg_boot_mark(rg_boot_mark_t mark, int64_t now_us);
+
+/**
+ * @brief When a milestone was reached, or 0 if it was not yet.
+ */
+int64_t rg_boot_mark_us(rg_boot_mark_t mark);
+
+const char *rg_boot_mark_name(rg_boot_mark_t mark);
+
+/**
+ * @brief Writes the milestones reached so far to /metrics (for a collector).
+ */
+void rg_boot_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_BOOT_H_ */
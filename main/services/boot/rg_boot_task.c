@@ -0,0 +1,85 @@
+// main/services/boot/rg_boot_task.c
+#include "rg_boot_task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_BOOT";
+
+static rg_boot_t *s_boot;
+// Held around the bookkeeping, never while a stage runs
+static SemaphoreHandle_t s_lock;
+// Given once per worker whenever a stage finishes, so idle workers look again
+static SemaphoreHandle_t s_progress;
+
+static void wake_workers(void)
+{
+    for (int i = 0; i < CONFIG_RG_BOOT_WORKERS; i++) {
+        xSemaphoreGive(s_progress);
+    }
+}
+
+static void work(void)
+{
+    while (1) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int id = rg_boot_take_ready(s_boot, esp_timer_get_time());
+        bool done = rg_boot_done(s_boot);
+        xSemaphoreGive(s_lock);
+
+        if (done) {
+            wake_workers(); // Skips may have just ended the boot; let the others see it
+            return;
+        }
+        if (id < 0) {
+            xSemaphoreTake(s_progress, portMAX_DELAY);
+            continue;
+        }
+
+        rg_boot_stage_t *stage = &s_boot->stages[id];
+        esp_err_t err = stage->fn(stage->arg);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        rg_boot_finish(s_boot, id, err, esp_timer_get_time());
+        xSemaphoreGive(s_lock);
+        wake_workers();
+    }
+}
+
+static void helper_task(void *arg)
+{
+    (void)arg;
+    work();
+    vTaskDelete(NULL);
+}
+
+esp_err_t rg_boot_run(rg_boot_t *boot)
+{
+    s_boot = boot;
+    s_lock = xSemaphoreCreateMutex();
+    s_progress = xSemaphoreCreateCounting(CONFIG_RG_BOOT_WORKERS, 0);
+    if (!s_lock || !s_progress) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Transient, so not statically allocated: the stacks go back to the heap after boot
+    for (int i = 1; i < CONFIG_RG_BOOT_WORKERS; i++) {
+        if (xTaskCreate(helper_task, "boot", CONFIG_RG_BOOT_WORKER_STACK, NULL, uxTaskPriorityGet(NULL), NULL) !=
+            pdPASS) {
+            ESP_LOGW(TAG, "Boot helper %d not started; fewer stages run in parallel.", i);
+        }
+    }
+    work();
+
+    int failed = 0;
+    for (int i = 0; i < boot->count; i++) {
+        failed += boot->stages[i].status != RG_BOOT_DONE;
+    }
+    ESP_LOGI(TAG, "Boot stages finished at %lld ms, %d of %d failed or skipped.",
+             (long long)esp_timer_get_time() / 1000, failed, boot->count);
+    return failed ? ESP_FAIL : ESP_OK;
+}
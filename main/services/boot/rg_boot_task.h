@@ -0,0 +1,30 @@
+// main/services/boot/rg_boot_task.h
+#ifndef RG_BOOT_TASK_H_
+#define RG_BOOT_TASK_H_
+
+#pragma once
+
+#include "esp_err.h"
+#include "rg_boot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Runs every stage of @p boot, each as soon as its dependencies are done.
+ *
+ * The calling task is one worker; CONFIG_RG_BOOT_WORKERS - 1 helper tasks at
+ * its priority are the others. Helpers are created for the boot only and
+ * return their stacks to the heap when it ends. Returns when every stage has
+ * finished, failed or been skipped.
+ *
+ * @return ESP_OK if every stage succeeded, ESP_FAIL if any failed or was skipped.
+ */
+esp_err_t rg_boot_run(rg_boot_t *boot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_BOOT_TASK_H_ */
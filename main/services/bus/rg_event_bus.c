@@ -0,0 +1,235 @@
+// main/services/bus/rg_event_bus.c
+#include "rg_event_bus.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#define EVENT_WORDS (sizeof(rg_event_t) / sizeof(uint32_t))
+
+_Static_assert(sizeof(rg_event_t) % sizeof(uint32_t) == 0, "events are copied as whole words");
+
+static const char *const s_policy_names[] = {"drop_oldest", "coalesce", "block"};
+
+esp_err_t rg_event_bus_init(rg_event_bus_t *bus, rg_event_slot_t *slots, uint32_t capacity,
+                            const rg_event_bus_port_t *port)
+{
+    if (!slots || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(bus, 0, sizeof(*bus));
+    memset(slots, 0, capacity * sizeof(*slots));
+    bus->slots = slots;
+    bus->capacity = capacity;
+    if (port) {
+        bus->port = *port;
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_event_bus_subscribe(rg_event_bus_t *bus, rg_event_sub_t *sub)
+{
+    uint32_t count = __atomic_load_n(&bus->sub_count, __ATOMIC_RELAXED);
+    if (count == RG_EVENT_BUS_MAX_SUBSCRIBERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&sub->stats, 0, sizeof(sub->stats));
+    __atomic_store_n(&sub->cursor, __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    bus->subs[count] = sub;
+    // The producer only looks at entries below sub_count
+    __atomic_store_n(&bus->sub_count, count + 1, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+static void count(uint32_t *counter, uint32_t n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+// Waits until @p sub is less than a full ring behind position @p n
+static esp_err_t wait_for(rg_event_bus_t *bus, rg_event_sub_t *sub, uint32_t n, int64_t *deadline_us,
+                          uint32_t timeout_ms)
+{
+    bool waited = false;
+    while (n - __atomic_load_n(&sub->cursor, __ATOMIC_ACQUIRE) >= bus->capacity) {
+        int64_t now = esp_timer_get_time();
+        if (*deadline_us == 0) {
+            *deadline_us = now + (int64_t)timeout_ms * 1000;
+        }
+        if (!waited) {
+            count(&sub->stats.blocked, 1);
+            waited = true;
+        }
+        int64_t remaining_ms = (*deadline_us - now + 999) / 1000;
+        if (remaining_ms <= 0 || !bus->port.wait_space ||
+            !bus->port.wait_space(bus->port.ctx, (uint32_t)remaining_ms)) {
+            count(&sub->stats.timeouts, 1);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_event_bus_publish(rg_event_bus_t *bus, const rg_event_t *event, uint32_t timeout_ms)
+{
+    const uint32_t n = bus->head; // Only the producer writes it
+    const uint32_t subs = __atomic_load_n(&bus->sub_count, __ATOMIC_ACQUIRE);
+    esp_err_t ret = ESP_OK;
+    int64_t deadline_us = 0;
+    for (uint32_t i = 0; i < subs; i++) {
+        if (bus->subs[i]->policy == RG_EVENT_BUS_BLOCK && wait_for(bus, bus->subs[i], n, &deadline_us, timeout_ms) != ESP_OK) {
+            ret = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    rg_event_t copy = *event;
+    copy.sequence = n;
+    uint32_t words[EVENT_WORDS];
+    memcpy(words, &copy, sizeof(words));
+
+    // Odd while the slot is rewritten, so a reader of the previous event there notices
+    rg_event_slot_t *slot = &bus->slots[n & (bus->capacity - 1)];
+    __atomic_store_n(&slot->seq, n * 2 + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < EVENT_WORDS; i++) {
+        __atomic_store_n(&slot->words[i], words[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&slot->seq, n * 2 + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&bus->head, n + 1, __ATOMIC_RELEASE);
+
+    const uint32_t mask = RG_EVENT_MASK(event->type);
+    for (uint32_t i = 0; i < subs; i++) {
+        rg_event_sub_t *sub = bus->subs[i];
+        if ((sub->types & mask) && sub->notify) {
+            sub->notify(sub->notify_ctx);
+        }
+    }
+    return ret;
+}
+
+// Copies the event at position @p n; false if the slot no longer (or not yet) holds it
+static bool read_slot(const rg_event_bus_t *bus, uint32_t n, rg_event_t *out)
+{
+    const rg_event_slot_t *slot = &bus->slots[n & (bus->capacity - 1)];
+    const uint32_t expect = n * 2 + 2;
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != expect) {
+        return false;
+    }
+    uint32_t words[EVENT_WORDS];
+    for (size_t i = 0; i < EVENT_WORDS; i++) {
+        words[i] = __atomic_load_n(&slot->words[i], __ATOMIC_RELAXED);
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != expect) {
+        return false;
+    }
+    memcpy(out, words, sizeof(*out));
+    return true;
+}
+
+static void advance(rg_event_bus_t *bus, rg_event_sub_t *sub, uint32_t cursor)
+{
+    __atomic_store_n(&sub->cursor, cursor, __ATOMIC_RELEASE);
+    if (sub->policy == RG_EVENT_BUS_BLOCK && bus->port.space_available) {
+        bus->port.space_available(bus->port.ctx);
+    }
+}
+
+// Newest wanted event; everything before it is skipped
+static bool poll_newest(rg_event_bus_t *bus, rg_event_sub_t *sub, rg_event_t *out)
+{
+    const uint32_t head = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE);
+    const uint32_t cursor = sub->cursor;
+    const uint32_t oldest = head - cursor > bus->capacity ? head - bus->capacity : cursor;
+    bool found = false;
+    for (uint32_t n = head; n != oldest && !found;) {
+        n--;
+        found = read_slot(bus, n, out) && (sub->types & RG_EVENT_MASK(out->type));
+    }
+    if (found) {
+        count(&sub->stats.skipped, out->sequence - cursor);
+        count(&sub->stats.delivered, 1);
+    }
+    if (head != cursor) {
+        advance(bus, sub, head);
+    }
+    return found;
+}
+
+static bool poll_next(rg_event_bus_t *bus, rg_event_sub_t *sub, rg_event_t *out)
+{
+    uint32_t cursor = sub->cursor;
+    for (;;) {
+        const uint32_t head = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE);
+        if (cursor == head) {
+            return false;
+        }
+        if (head - cursor > bus->capacity) {
+            count(&sub->stats.dropped, head - cursor - bus->capacity);
+            cursor = head - bus->capacity;
+        }
+        // A failed copy means the producer is rewriting this very slot: the
+        // event is lost either way, and waiting for the producer could spin
+        // forever if it runs at a lower priority than this task
+        bool ok = read_slot(bus, cursor, out);
+        cursor++;
+        advance(bus, sub, cursor);
+        if (!ok) {
+            count(&sub->stats.dropped, 1);
+        } else if (sub->types & RG_EVENT_MASK(out->type)) {
+            count(&sub->stats.delivered, 1);
+            return true;
+        }
+    }
+}
+
+bool rg_event_bus_poll(rg_event_bus_t *bus, rg_event_sub_t *sub, rg_event_t *out)
+{
+    return sub->policy == RG_EVENT_BUS_COALESCE ? poll_newest(bus, sub, out) : poll_next(bus, sub, out);
+}
+
+uint32_t rg_event_bus_lag(const rg_event_bus_t *bus, const rg_event_sub_t *sub)
+{
+    uint32_t lag = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&sub->cursor, __ATOMIC_ACQUIRE);
+    // A reader never needs more than one ring; older positions are gone
+    return lag > bus->capacity ? bus->capacity : lag;
+}
+
+void rg_event_bus_sub_stats(const rg_event_sub_t *sub, rg_event_sub_stats_t *out)
+{
+    out->delivered = __atomic_load_n(&sub->stats.delivered, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&sub->stats.dropped, __ATOMIC_RELAXED);
+    out->skipped = __atomic_load_n(&sub->stats.skipped, __ATOMIC_RELAXED);
+    out->blocked = __atomic_load_n(&sub->stats.blocked, __ATOMIC_RELAXED);
+    out->timeouts = __atomic_load_n(&sub->stats.timeouts, __ATOMIC_RELAXED);
+}
+
+void rg_event_bus_write_metrics(const rg_event_bus_t *bus, rg_metrics_writer_t *writer)
+{
+    rg_metrics_write_family(writer, "rg_event_bus_published_total", "counter", "Events published on the bus.");
+    rg_metrics_write_value(writer, "rg_event_bus_published_total", NULL, __atomic_load_n(&bus->head, __ATOMIC_RELAXED));
+
+    const uint32_t subs = __atomic_load_n(&bus->sub_count, __ATOMIC_ACQUIRE);
+    static const char *const outcomes[] = {"delivered", "dropped", "skipped", "blocked", "timeout"};
+    rg_metrics_write_family(writer, "rg_event_bus_events_total", "counter",
+                            "Events per subscriber by outcome; blocked and timeout count publishes.");
+    for (uint32_t i = 0; i < subs; i++) {
+        rg_event_sub_stats_t stats;
+        rg_event_bus_sub_stats(bus->subs[i], &stats);
+        const uint32_t values[] = {stats.delivered, stats.dropped, stats.skipped, stats.blocked, stats.timeouts};
+        for (size_t k = 0; k < sizeof(values) / sizeof(values[0]); k++) {
+            char labels[80];
+            snprintf(labels, sizeof(labels), "subscriber=\"%s\",policy=\"%s\",outcome=\"%s\"", bus->subs[i]->name,
+                     s_policy_names[bus->subs[i]->policy], outcomes[k]);
+            rg_metrics_write_value(writer, "rg_event_bus_events_total", labels, values[k]);
+        }
+    }
+
+    rg_metrics_write_family(writer, "rg_event_bus_lag", "gauge", "Events published but not yet read, per subscriber.");
+    for (uint32_t i = 0; i < subs; i++) {
+        char labels[40];
+        snprintf(labels, sizeof(labels), "subscriber=\"%s\"", bus->subs[i]->name);
+        rg_metrics_write_value(writer, "rg_event_bus_lag", labels, rg_event_bus_lag(bus, bus->subs[i]));
+    }
+}
@@ -0,0 +1,189 @@
+// main/services/bus/rg_event_bus.h
+#ifndef RG_EVENT_BUS_H_
+#define RG_EVENT_BUS_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "services/metrics/rg_metrics.h"
+
+// Bounded publish/subscribe bus between one producer (the sensor task) and
+// its consumers (HTTP, logging, MQTT, Zigbee).
+//
+// Events go into one ring of fixed-size slots; every subscriber reads it
+// through its own cursor, so publishing is one slot write however many
+// subscribers there are. Slots carry a sequence number and are copied like
+// shared_data's seqlock, so neither side takes a lock and a reader can tell
+// when the slot it is copying was overwritten. Each subscriber picks what
+// happens when it falls a full ring behind:
+//
+//  - RG_EVENT_BUS_DROP_OLDEST: the producer keeps going; the subscriber loses
+//    the oldest events it had not read and counts them as dropped.
+//  - RG_EVENT_BUS_COALESCE: the subscriber only ever wants the newest event;
+//    everything older is skipped, however far behind it is.
+//  - RG_EVENT_BUS_BLOCK: the producer waits for the subscriber to make room,
+//    up to the timeout passed to rg_event_bus_publish(); after that the event
+//    is published anyway and the subscriber loses its oldest one.
+//
+// After a publish, the bus calls the notify hook of every subscriber that
+// wants the event type, so consumers sleep until there is something to read.
+//
+// One producer task publishes; each subscriber is polled by one task. This
+// file is the portable engine; rg_event_bus_task.c runs the device bus and
+// the subscriber tasks on FreeRTOS.
+
+#define RG_EVENT_BUS_MAX_SUBSCRIBERS 8
+#define RG_EVENT_MASK(type) (1u << (type))
+
+typedef enum {
+    RG_EVENT_SAMPLE, // A filtered sample accepted by the sampler
+    RG_EVENT_RULE,   // A local rule tripped or cleared
+    RG_EVENT_READING, // Every filtered reading, published by the sampler or not; same payload as a sample
+    RG_EVENT_TYPE_COUNT,
+} rg_event_type_t;
+
+typedef struct {
+    float temperature;  // degC
+    float humidity;     // %RH
+    float pressure;     // hPa
+    uint32_t timestamp; // Seconds on the rg_history time line
+} rg_event_sample_t;
+
+typedef struct {
+    uint16_t index;     // Into the compiled rules, see rg_rules_task_rule()
+    uint8_t active;     // 1 tripped, 0 cleared
+    uint8_t generation; // Of the rules the index refers to
+    int32_t value;   // Hundredths of the channel unit (per minute for a rate) that changed it
+} rg_event_rule_t;
+
+typedef struct {
+    uint16_t type;     // rg_event_type_t
+    uint16_t reserved;
+    uint32_t sequence; // Position on the bus, set by rg_event_bus_publish()
+    int64_t time_us;   // esp_timer_get_time() when produced
+    union {
+        rg_event_sample_t sample;
+        rg_event_rule_t rule;
+    };
+} rg_event_t;
+
+typedef enum {
+    RG_EVENT_BUS_DROP_OLDEST,
+    RG_EVENT_BUS_COALESCE,
+    RG_EVENT_BUS_BLOCK,
+} rg_event_bus_policy_t;
+
+typedef void (*rg_event_bus_notify_t)(void *ctx);
+
+typedef struct {
+    uint32_t delivered; // Events returned by rg_event_bus_poll()
+    uint32_t dropped;   // Events overwritten before they were read
+    uint32_t skipped;   // Events passed over for a newer one (RG_EVENT_BUS_COALESCE)
+    uint32_t blocked;   // Publishes that waited for this subscriber (RG_EVENT_BUS_BLOCK)
+    uint32_t timeouts;  // Of those, publishes that gave up waiting
+} rg_event_sub_stats_t;
+
+typedef struct {
+    const char *name;
+    rg_event_bus_policy_t policy;
+    uint32_t types;               // RG_EVENT_MASK() bits of the types delivered
+    rg_event_bus_notify_t notify; // Called from the producer after a wanted event, or NULL
+    void *notify_ctx;
+    uint32_t cursor;              // Next position to read, written by the subscriber only
+    rg_event_sub_stats_t stats;
+} rg_event_sub_t;
+
+#define RG_EVENT_SUB_INIT(name_, policy_, types_)                                                 \
+    {                                                                                             \
+        .name = (name_), .policy = (policy_), .types = (types_),                                  \
+    }
+
+// How the producer waits for RG_EVENT_BUS_BLOCK subscribers
+typedef struct {
+    // Waits until space_available() is called or timeout_ms passes; false on timeout
+    bool (*wait_space)(void *ctx, uint32_t timeout_ms);
+    // Called by a blocking subscriber each time it frees a slot
+    void (*space_available)(void *ctx);
+    void *ctx;
+} rg_event_bus_port_t;
+
+typedef struct {
+    uint32_t seq;                                    // 2 * position + 2 once written, odd while writing
+    uint32_t words[sizeof(rg_event_t) / sizeof(uint32_t)];
+} rg_event_slot_t;
+
+typedef struct {
+    rg_event_slot_t *slots;
+    uint32_t capacity; // Power of two
+    uint32_t head;     // Events published so far
+    rg_event_sub_t *subs[RG_EVENT_BUS_MAX_SUBSCRIBERS];
+    uint32_t sub_count;
+    rg_event_bus_port_t port;
+} rg_event_bus_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up @p bus on @p slots.
+ *
+ * @param capacity Number of slots, a power of two of at least 2.
+ * @param port Wait hooks for RG_EVENT_BUS_BLOCK subscribers; NULL if there are none.
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for a bad capacity.
+ */
+esp_err_t rg_event_bus_init(rg_event_bus_t *bus, rg_event_slot_t *slots, uint32_t capacity,
+                            const rg_event_bus_port_t *port);
+
+/**
+ * @brief Adds @p sub; it receives the events published from now on.
+ *
+ * Safe while the producer publishes, but not concurrently with another
+ * rg_event_bus_subscribe() on the same bus. Set the notify hook first.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if RG_EVENT_BUS_MAX_SUBSCRIBERS are subscribed.
+ */
+esp_err_t rg_event_bus_subscribe(rg_event_bus_t *bus, rg_event_sub_t *sub);
+
+/**
+ * @brief Publishes @p event to every subscriber (single producer).
+ *
+ * Never waits unless a RG_EVENT_BUS_BLOCK subscriber is a full ring behind;
+ * then waits at most @p timeout_ms in total.
+ *
+ * @return ESP_OK, or ESP_ERR_TIMEOUT if the event was published after a blocking subscriber timed out.
+ */
+esp_err_t rg_event_bus_publish(rg_event_bus_t *bus, const rg_event_t *event, uint32_t timeout_ms);
+
+/**
+ * @brief Takes the next event for @p sub into @p out, according to its policy.
+ *
+ * Lock-free; only the task that consumes @p sub may call it.
+ *
+ * @return false if there is nothing new for @p sub.
+ */
+bool rg_event_bus_poll(rg_event_bus_t *bus, rg_event_sub_t *sub, rg_event_t *out);
+
+/**
+ * @brief Events published that @p sub has not read yet (of any type).
+ */
+uint32_t rg_event_bus_lag(const rg_event_bus_t *bus, const rg_event_sub_t *sub);
+
+/**
+ * @brief Copies the counters of @p sub; safe from any task.
+ */
+void rg_event_bus_sub_stats(const rg_event_sub_t *sub, rg_event_sub_stats_t *out);
+
+/**
+ * @brief Writes events published and per-subscriber counters and lag in Prometheus text.
+ */
+void rg_event_bus_write_metrics(const rg_event_bus_t *bus, rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_EVENT_BUS_H_ */
@@ -0,0 +1,111 @@
+// main/services/bus/rg_event_bus_task.c
+#include "rg_event_bus_task.h"
+
+#include "esp_log.h"
+#include "freertos/semphr.h"
+#include "services/log/rg_tlog.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_BUS";
+
+_Static_assert((CONFIG_RG_EVENT_BUS_CAPACITY & (CONFIG_RG_EVENT_BUS_CAPACITY - 1)) == 0,
+               "CONFIG_RG_EVENT_BUS_CAPACITY must be a power of two");
+
+static rg_event_bus_t s_bus;
+static rg_event_slot_t s_slots[CONFIG_RG_EVENT_BUS_CAPACITY];
+// Given when a blocking consumer frees a slot; taken by the waiting sensor task
+static StaticSemaphore_t s_space_storage;
+static SemaphoreHandle_t s_space = NULL;
+static portMUX_TYPE s_subscribe_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_timeouts = 0;
+
+static bool wait_space(void *ctx, uint32_t timeout_ms)
+{
+    (void)ctx;
+    TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+    return xSemaphoreTake(s_space, ticks ? ticks : 1) == pdTRUE;
+}
+
+static void space_available(void *ctx)
+{
+    (void)ctx;
+    xSemaphoreGive(s_space);
+}
+
+// Runs on the sensor task after a publish
+static void wake(void *ctx)
+{
+    rg_event_consumer_t *consumer = (rg_event_consumer_t *)ctx;
+    TaskHandle_t task = __atomic_load_n(&consumer->task, __ATOMIC_ACQUIRE);
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+esp_err_t rg_event_bus_task_init(void)
+{
+    if (s_space) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const rg_event_bus_port_t port = {
+        .wait_space = wait_space,
+        .space_available = space_available,
+    };
+    esp_err_t ret = rg_event_bus_init(&s_bus, s_slots, CONFIG_RG_EVENT_BUS_CAPACITY, &port);
+    if (ret == ESP_OK) {
+        s_space = xSemaphoreCreateBinaryStatic(&s_space_storage);
+    }
+    return ret;
+}
+
+esp_err_t rg_event_bus_task_subscribe(rg_event_consumer_t *consumer)
+{
+    if (!s_space) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    consumer->sub.notify = wake;
+    consumer->sub.notify_ctx = consumer;
+    taskENTER_CRITICAL(&s_subscribe_lock);
+    esp_err_t ret = rg_event_bus_subscribe(&s_bus, &consumer->sub);
+    taskEXIT_CRITICAL(&s_subscribe_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No room on the bus for consumer %s.", consumer->sub.name);
+    }
+    return ret;
+}
+
+void rg_event_bus_task_consume(void *arg)
+{
+    rg_event_consumer_t *consumer = (rg_event_consumer_t *)arg;
+    // From here on the bus wakes this task; events published before are read right away
+    __atomic_store_n(&consumer->task, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "Consumer %s started.", consumer->sub.name);
+
+    rg_event_t event;
+    while (1) {
+        while (rg_event_bus_poll(&s_bus, &consumer->sub, &event)) {
+            consumer->handler(&event, consumer->ctx);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+esp_err_t rg_event_bus_task_publish(const rg_event_t *event)
+{
+    if (!s_space) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = rg_event_bus_publish(&s_bus, event, CONFIG_RG_EVENT_BUS_BLOCK_TIMEOUT_MS);
+    if (ret == ESP_ERR_TIMEOUT && (s_timeouts++ % 16) == 0) {
+        RG_TLOGW(TAG, "A blocking consumer is a full bus behind, %lu samples published over it so far.",
+                 (unsigned long)s_timeouts);
+    }
+    return ret;
+}
+
+void rg_event_bus_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    if (s_space) {
+        rg_event_bus_write_metrics(&s_bus, writer);
+    }
+}
@@ -0,0 +1,84 @@
+// main/services/bus/rg_event_bus_task.h
+#ifndef RG_EVENT_BUS_TASK_H_
+#define RG_EVENT_BUS_TASK_H_
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rg_event_bus.h"
+#include "services/metrics/rg_metrics.h"
+
+// The device's sample bus: the sensor task publishes, and every consumer
+// runs its handler in a task of its own that sleeps until the bus notifies
+// it. A consumer is declared once and started from a boot stage:
+//
+//   static rg_event_consumer_t s_log = RG_EVENT_CONSUMER_INIT(
+//       "log", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE), log_sample, NULL);
+//   RG_TASK_STORAGE(s_log_task, CONFIG_RG_EVENT_BUS_TASK_STACK);
+//   ...
+//   rg_event_bus_task_subscribe(&s_log);
+//   RG_TASK_CREATE(s_log_task, rg_event_bus_task_consume, "ev_log", &s_log, 3);
+//
+// Subscribing before the task exists means nothing published in between is
+// missed; the task reads it as soon as it starts.
+
+typedef void (*rg_event_handler_t)(const rg_event_t *event, void *ctx);
+
+typedef struct {
+    rg_event_sub_t sub;
+    rg_event_handler_t handler;
+    void *ctx;
+    TaskHandle_t task; // Set by rg_event_bus_task_consume()
+} rg_event_consumer_t;
+
+#define RG_EVENT_CONSUMER_INIT(name_, policy_, types_, handler_, ctx_)                            \
+    {                                                                                             \
+        .sub = RG_EVENT_SUB_INIT(name_, policy_, types_), .handler = (handler_), .ctx = (ctx_),  \
+    }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the bus with CONFIG_RG_EVENT_BUS_CAPACITY slots. Call once, before anything else here.
+ */
+esp_err_t rg_event_bus_task_init(void);
+
+/**
+ * @brief Subscribes @p consumer; safe from any task.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before rg_event_bus_task_init(), or ESP_ERR_NO_MEM if the bus is full.
+ */
+esp_err_t rg_event_bus_task_subscribe(rg_event_consumer_t *consumer);
+
+/**
+ * @brief Task function that runs the handler of the rg_event_consumer_t passed as its argument.
+ *
+ * Calls the handler for each event the consumer's policy lets through, in
+ * order, and sleeps while there is none. Never returns.
+ */
+void rg_event_bus_task_consume(void *consumer);
+
+/**
+ * @brief Publishes @p event (sensor task only).
+ *
+ * Waits up to CONFIG_RG_EVENT_BUS_BLOCK_TIMEOUT_MS if a consumer with
+ * RG_EVENT_BUS_BLOCK is a full bus behind; never otherwise.
+ *
+ * @return ESP_OK, ESP_ERR_TIMEOUT if published over a blocking consumer, ESP_ERR_INVALID_STATE before init.
+ */
+esp_err_t rg_event_bus_task_publish(const rg_event_t *event);
+
+/**
+ * @brief Writes the bus counters for /metrics (see rg_event_bus_write_metrics()).
+ */
+void rg_event_bus_task_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_EVENT_BUS_TASK_H_ */
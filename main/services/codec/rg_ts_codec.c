@@ -0,0 +1,237 @@
+// main/services/codec/rg_ts_codec.c
+#include "rg_ts_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+// One prefix code: `prefix_len` bits of `prefix`, then `bits` of payload
+// holding a value in [lo, hi]. The last entry of a table takes anything.
+typedef struct {
+    uint8_t prefix;
+    uint8_t prefix_len;
+    uint8_t bits;
+    int32_t lo;
+    int32_t hi;
+} bucket_t;
+
+#define BUCKETS 5
+
+static const bucket_t s_interval_buckets[BUCKETS] = {
+    {0x0, 1, 0, 0, 0},
+    {0x2, 2, 7, -64, 63},
+    {0x6, 3, 9, -256, 255},
+    {0xE, 4, 12, -2048, 2047},
+    {0xF, 4, 32, INT32_MIN, INT32_MAX},
+};
+
+static const bucket_t s_value_buckets[BUCKETS] = {
+    {0x0, 1, 0, 0, 0},
+    {0x2, 2, 4, -8, 7},
+    {0x6, 3, 8, -128, 127},
+    {0xE, 4, 16, -32768, 32767},
+    {0xF, 4, 32, INT32_MIN, INT32_MAX},
+};
+
+static const bucket_t *pick(const bucket_t *table, int32_t v)
+{
+    int i = 0;
+    while (i < BUCKETS - 1 && (v < table[i].lo || v > table[i].hi)) {
+        i++;
+    }
+    return &table[i];
+}
+
+// Differences wrap modulo 2^32, so every one fits the 32-bit escape and the
+// decoder's unsigned additions undo it exactly
+static int32_t wrap_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+// --- Bit stream, most significant bit first ----------------------------
+
+static void put_bits(uint8_t *buf, size_t *pos, uint32_t value, uint8_t n)
+{
+    while (n > 0) {
+        uint8_t room = 8 - (*pos & 7);
+        uint8_t take = n < room ? n : room;
+        uint8_t chunk = (uint8_t)((value >> (n - take)) & ((1u << take) - 1));
+        buf[*pos >> 3] |= (uint8_t)(chunk << (room - take));
+        *pos += take;
+        n -= take;
+    }
+}
+
+// Bits past the end of the block read as zero; callers check bit_pos afterwards
+static uint32_t get_bits(const uint8_t *buf, size_t size, size_t *pos, uint8_t n)
+{
+    uint32_t value = 0;
+    while (n > 0) {
+        uint8_t room = 8 - (*pos & 7);
+        uint8_t take = n < room ? n : room;
+        size_t byte = *pos >> 3;
+        uint8_t chunk = byte < size ? (uint8_t)((buf[byte] >> (room - take)) & ((1u << take) - 1)) : 0;
+        value = (value << take) | chunk;
+        *pos += take;
+        n -= take;
+    }
+    return value;
+}
+
+static void put_coded(uint8_t *buf, size_t *pos, const bucket_t *table, int32_t v)
+{
+    const bucket_t *b = pick(table, v);
+    put_bits(buf, pos, b->prefix, b->prefix_len);
+    if (b->bits) {
+        put_bits(buf, pos, (uint32_t)v, b->bits);
+    }
+}
+
+static int32_t get_coded(const uint8_t *buf, size_t size, size_t *pos, const bucket_t *table)
+{
+    // Count leading ones: the prefix is 0, 10, 110, 1110 or 1111
+    int i = 0;
+    while (i < BUCKETS - 1 && get_bits(buf, size, pos, 1)) {
+        i++;
+    }
+    uint8_t bits = table[i].bits;
+    if (bits == 0) {
+        return 0;
+    }
+    uint32_t raw = get_bits(buf, size, pos, bits);
+    if (bits < 32 && (raw & (1u << (bits - 1)))) {
+        raw |= ~0u << bits; // Sign-extend
+    }
+    return (int32_t)raw;
+}
+
+// --- Encoder -----------------------------------------------------------
+
+bool rg_ts_encoder_init(rg_ts_encoder_t *enc, uint8_t *buf, size_t size)
+{
+    memset(enc, 0, sizeof(*enc));
+    if (size < RG_TS_BLOCK_HEADER) {
+        return false;
+    }
+    memset(buf, 0, size);
+    enc->buf = buf;
+    enc->size = size;
+    enc->bit_pos = RG_TS_BLOCK_HEADER * 8;
+    return true;
+}
+
+bool rg_ts_encoder_append(rg_ts_encoder_t *enc, const rg_ts_sample_t *sample)
+{
+    if (!enc->buf || enc->count == UINT16_MAX) {
+        return false;
+    }
+
+    int32_t dod = 0;
+    int32_t deltas[RG_TS_CHANNELS];
+    size_t bits = 0;
+    if (enc->count == 0) {
+        bits = 32 + RG_TS_CHANNELS * 32;
+    } else {
+        uint32_t interval = sample->timestamp - enc->last_timestamp;
+        dod = wrap_diff(interval, enc->last_interval);
+        const bucket_t *b = pick(s_interval_buckets, dod);
+        bits += b->prefix_len + b->bits;
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            deltas[c] = wrap_diff((uint32_t)sample->values[c], (uint32_t)enc->last_values[c]);
+            b = pick(s_value_buckets, deltas[c]);
+            bits += b->prefix_len + b->bits;
+        }
+    }
+    if (enc->bit_pos + bits > enc->size * 8) {
+        return false;
+    }
+
+    if (enc->count == 0) {
+        put_bits(enc->buf, &enc->bit_pos, sample->timestamp, 32);
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            put_bits(enc->buf, &enc->bit_pos, (uint32_t)sample->values[c], 32);
+        }
+    } else {
+        put_coded(enc->buf, &enc->bit_pos, s_interval_buckets, dod);
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            put_coded(enc->buf, &enc->bit_pos, s_value_buckets, deltas[c]);
+        }
+        enc->last_interval = sample->timestamp - enc->last_timestamp;
+    }
+    enc->last_timestamp = sample->timestamp;
+    memcpy(enc->last_values, sample->values, sizeof(enc->last_values));
+    enc->count++;
+    enc->buf[0] = (uint8_t)enc->count;
+    enc->buf[1] = (uint8_t)(enc->count >> 8);
+    return true;
+}
+
+size_t rg_ts_encoder_size(const rg_ts_encoder_t *enc)
+{
+    return (enc->bit_pos + 7) / 8;
+}
+
+// --- Decoder -----------------------------------------------------------
+
+bool rg_ts_decoder_init(rg_ts_decoder_t *dec, const uint8_t *buf, size_t len)
+{
+    memset(dec, 0, sizeof(*dec));
+    if (len < RG_TS_BLOCK_HEADER) {
+        return false;
+    }
+    dec->buf = buf;
+    dec->size = len;
+    dec->bit_pos = RG_TS_BLOCK_HEADER * 8;
+    dec->count = (uint16_t)(buf[0] | (buf[1] << 8));
+    return true;
+}
+
+bool rg_ts_decoder_next(rg_ts_decoder_t *dec, rg_ts_sample_t *sample)
+{
+    if (dec->decoded >= dec->count) {
+        return false;
+    }
+    const uint8_t *buf = dec->buf;
+    size_t size = dec->size;
+    size_t pos = dec->bit_pos;
+    uint32_t interval = dec->last_interval;
+    if (dec->decoded == 0) {
+        sample->timestamp = get_bits(buf, size, &pos, 32);
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            sample->values[c] = (int32_t)get_bits(buf, size, &pos, 32);
+        }
+    } else {
+        interval += (uint32_t)get_coded(buf, size, &pos, s_interval_buckets);
+        sample->timestamp = dec->last_timestamp + interval;
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            int32_t delta = get_coded(buf, size, &pos, s_value_buckets);
+            sample->values[c] = (int32_t)((uint32_t)dec->last_values[c] + (uint32_t)delta);
+        }
+    }
+    if (pos > size * 8) {
+        return false; // Truncated block
+    }
+    dec->bit_pos = pos;
+    dec->last_interval = interval;
+    dec->last_timestamp = sample->timestamp;
+    memcpy(dec->last_values, sample->values, sizeof(dec->last_values));
+    dec->decoded++;
+    return true;
+}
+
+// --- rg_bme280_values_t ------------------------------------------------
+
+void rg_ts_sample_from_values(rg_ts_sample_t *sample, uint32_t timestamp, const rg_bme280_values_t *values)
+{
+    sample->timestamp = timestamp;
+    sample->values[0] = (int32_t)lroundf(values->temperature * 100.0f);
+    sample->values[1] = (int32_t)lroundf(values->humidity * 100.0f);
+    sample->values[2] = (int32_t)lroundf(values->pressure * 100.0f);
+}
+
+void rg_ts_sample_to_values(const rg_ts_sample_t *sample, rg_bme280_values_t *values)
+{
+    values->temperature = sample->values[0] / 100.0f;
+    values->humidity = sample->values[1] / 100.0f;
+    values->pressure = sample->values[2] / 100.0f;
+}
@@ -0,0 +1,124 @@
+// main/services/codec/rg_ts_codec.h
+#ifndef RG_TS_CODEC_H_
+#define RG_TS_CODEC_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensor_modules/rg_bme280.h"
+
+// Compressed blocks of sensor samples, Gorilla style.
+//
+// A sample is a timestamp in seconds and RG_TS_CHANNELS integer values in
+// fixed point. Room readings barely move between samples, so the codec
+// stores differences with variable-length prefix codes, most significant bit
+// first:
+//
+//   timestamp   delta of delta     0              same interval as before
+//                                  10   + 7 bits  -64..63
+//                                  110  + 9 bits  -256..255
+//                                  1110 + 12 bits -2048..2047
+//                                  1111 + 32 bits anything else
+//   each value  delta              0              unchanged
+//                                  10   + 4 bits  -8..7
+//                                  110  + 8 bits  -128..127
+//                                  1110 + 16 bits -32768..32767
+//                                  1111 + 32 bits anything else
+//
+// The first sample of a block is stored in full (32 bits per field). A
+// steady sample stream with unchanged values costs 4 bits per sample; sensor
+// noise of a few LSB about 20. Gorilla XORs float bits; the values here are
+// already integers, so plain deltas are both smaller and exact.
+//
+// A block is self-describing: the first two bytes are the sample count
+// (little endian), followed by the bit stream padded to a whole byte.
+// Encoding and decoding stream through a caller-provided buffer and never
+// allocate. Values round-trip exactly, including across int32 wrap-around.
+
+#define RG_TS_CHANNELS 3
+#define RG_TS_BLOCK_HEADER 2
+// Worst case for one sample after the first, for sizing buffers
+#define RG_TS_MAX_SAMPLE_BITS (36 + RG_TS_CHANNELS * 36)
+
+typedef struct {
+    uint32_t timestamp;
+    int32_t values[RG_TS_CHANNELS];
+} rg_ts_sample_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t bit_pos;   // Next bit to write, counted from the start of buf
+    uint16_t count;
+    uint32_t last_timestamp;
+    uint32_t last_interval;
+    int32_t last_values[RG_TS_CHANNELS];
+} rg_ts_encoder_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t size;
+    size_t bit_pos;
+    uint16_t count;   // Samples in the block
+    uint16_t decoded;
+    uint32_t last_timestamp;
+    uint32_t last_interval;
+    int32_t last_values[RG_TS_CHANNELS];
+} rg_ts_decoder_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts an empty block in @p buf (cleared here).
+ *
+ * @return false if @p size cannot hold even the block header.
+ */
+bool rg_ts_encoder_init(rg_ts_encoder_t *enc, uint8_t *buf, size_t size);
+
+/**
+ * @brief Appends one sample.
+ *
+ * @return false if the sample does not fit (block full); the block is left
+ * as it was, so the caller can seal it and start a new one.
+ */
+bool rg_ts_encoder_append(rg_ts_encoder_t *enc, const rg_ts_sample_t *sample);
+
+/**
+ * @brief Bytes of the block so far, header included; valid at any time.
+ */
+size_t rg_ts_encoder_size(const rg_ts_encoder_t *enc);
+
+/**
+ * @brief Starts decoding the block of @p len bytes at @p buf.
+ *
+ * @return false if @p buf is shorter than the block header.
+ */
+bool rg_ts_decoder_init(rg_ts_decoder_t *dec, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decodes the next sample.
+ *
+ * @return false at the end of the block or if it is truncated.
+ */
+bool rg_ts_decoder_next(rg_ts_decoder_t *dec, rg_ts_sample_t *sample);
+
+/**
+ * @brief Quantizes a reading: 0.01 degC, 0.01 %RH and Pa, in that channel order.
+ */
+void rg_ts_sample_from_values(rg_ts_sample_t *sample, uint32_t timestamp, const rg_bme280_values_t *values);
+
+/**
+ * @brief Converts a decoded sample back to a reading.
+ */
+void rg_ts_sample_to_values(const rg_ts_sample_t *sample, rg_bme280_values_t *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_TS_CODEC_H_ */
@@ -0,0 +1,356 @@
+// main/services/config/rg_config.c
+#include "rg_config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const int32_t s_scale[] = {1, 10, 100, 1000, 10000};
+
+static bool before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static char *string_of(const rg_config_t *config, int id)
+{
+    return config->strings + config->values[id];
+}
+
+static bool valid_id(const rg_config_t *config, int id)
+{
+    return id >= 0 && (size_t)id < config->count;
+}
+
+// Decimal with at most @p decimals fraction digits, scaled to an integer
+static bool parse_fixed(const char *text, uint8_t decimals, int32_t *out)
+{
+    const char *p = text;
+    const bool negative = *p == '-';
+    if (negative) {
+        p++;
+    }
+    int64_t value = 0;
+    int digits = 0;
+    int fraction = -1; // Digits after the point, once there is one
+    for (; *p; p++) {
+        if (*p == '.' && fraction < 0) {
+            fraction = 0;
+            continue;
+        }
+        if (*p < '0' || *p > '9' || (fraction >= 0 && fraction == decimals)) {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+        digits++;
+        if (fraction >= 0) {
+            fraction++;
+        }
+        if (value > INT32_MAX) {
+            return false;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    for (int i = fraction < 0 ? 0 : fraction; i < decimals; i++) {
+        value *= 10;
+        if (value > INT32_MAX) {
+            return false;
+        }
+    }
+    *out = (int32_t)(negative ? -value : value);
+    return true;
+}
+
+static esp_err_t check_string(const rg_config_def_t *def, const char *value)
+{
+    if (strlen(value) > (size_t)def->max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return def->validate ? def->validate(value) : ESP_OK;
+}
+
+// Readers copy under the sequence count; see rg_config_get_string()
+static void store_string(rg_config_t *config, int id, const char *value)
+{
+    char *dst = string_of(config, id);
+    const size_t len = strlen(value);
+    __atomic_store_n(&config->sequence, config->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i <= len; i++) {
+        __atomic_store_n(&dst[i], value[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&config->sequence, config->sequence + 1, __ATOMIC_RELEASE);
+}
+
+static void changed(rg_config_t *config, int id, uint32_t now_ms)
+{
+    if (!config->dirty) {
+        config->first_change_ms = now_ms;
+    }
+    config->dirty |= RG_CONFIG_BIT(id);
+    config->last_change_ms = now_ms;
+    config->stats.changes++;
+    for (size_t i = 0; i < config->sub_count; i++) {
+        if (config->subs[i].ids & RG_CONFIG_BIT(id)) {
+            config->subs[i].notify(config->subs[i].ctx, id);
+        }
+    }
+}
+
+size_t rg_config_strings_size(const rg_config_def_t *defs, size_t count)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (defs[i].type == RG_CONFIG_STRING) {
+            size += (size_t)defs[i].max + 1;
+        }
+    }
+    return size;
+}
+
+esp_err_t rg_config_init(rg_config_t *config, const rg_config_def_t *defs, size_t count, char *strings,
+                         size_t strings_size, const rg_config_port_t *port, uint32_t debounce_ms,
+                         uint32_t max_delay_ms)
+{
+    if (count > RG_CONFIG_MAX_SETTINGS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strings_size < rg_config_strings_size(defs, count)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(config, 0, sizeof(*config));
+    config->defs = defs;
+    config->count = count;
+    config->port = *port;
+    config->strings = strings;
+    config->debounce_ms = debounce_ms;
+    config->max_delay_ms = max_delay_ms < debounce_ms ? debounce_ms : max_delay_ms;
+
+    int32_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        const rg_config_def_t *def = &defs[i];
+        if (strlen(def->name) > RG_CONFIG_NAME_MAX || def->decimals >= sizeof(s_scale) / sizeof(s_scale[0])) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (def->type == RG_CONFIG_INT) {
+            if (def->def_int < def->min || def->def_int > def->max) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            config->values[i] = def->def_int;
+        } else {
+            if (strlen(def->def_string) > (size_t)def->max) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            config->values[i] = offset;
+            strcpy(strings + offset, def->def_string);
+            offset += def->max + 1;
+        }
+    }
+    return ESP_OK;
+}
+
+void rg_config_load(rg_config_t *config)
+{
+    for (size_t i = 0; i < config->count; i++) {
+        const rg_config_def_t *def = &config->defs[i];
+        if (def->type == RG_CONFIG_INT) {
+            int32_t value;
+            if (config->port.read_int(config->port.ctx, def->name, &value) != ESP_OK) {
+                continue;
+            }
+            if (value < def->min || value > def->max) {
+                config->stats.load_errors++;
+                continue;
+            }
+            __atomic_store_n(&config->values[i], value, __ATOMIC_RELAXED);
+        } else {
+            char value[256];
+            char *buf = (size_t)def->max < sizeof(value) ? value : NULL;
+            size_t len = (size_t)def->max + 1;
+            // Longer strings are read in place; nobody reads them yet at load time
+            if (!buf) {
+                buf = string_of(config, (int)i);
+            }
+            esp_err_t err = config->port.read_string(config->port.ctx, def->name, buf, &len);
+            if (err == ESP_ERR_NOT_FOUND) {
+                continue;
+            }
+            if (err != ESP_OK || check_string(def, buf) != ESP_OK) {
+                config->stats.load_errors++;
+                store_string(config, (int)i, def->def_string);
+                continue;
+            }
+            if (buf == value) {
+                store_string(config, (int)i, value);
+            }
+        }
+    }
+}
+
+int rg_config_find(const rg_config_t *config, const char *name)
+{
+    for (size_t i = 0; i < config->count; i++) {
+        if (strcmp(config->defs[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int32_t rg_config_get_int(const rg_config_t *config, int id)
+{
+    return __atomic_load_n(&config->values[id], __ATOMIC_RELAXED);
+}
+
+size_t rg_config_get_string(const rg_config_t *config, int id, char *out, size_t size)
+{
+    const char *src = string_of(config, id);
+    const size_t max = (size_t)config->defs[id].max;
+    uint32_t before_seq;
+    size_t len;
+    do {
+        before_seq = __atomic_load_n(&config->sequence, __ATOMIC_ACQUIRE);
+        for (len = 0; len < max; len++) {
+            const char c = __atomic_load_n(&src[len], __ATOMIC_RELAXED);
+            if (c == '\0') {
+                break;
+            }
+            if (len + 1 < size) {
+                out[len] = c;
+            }
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((before_seq & 1) || __atomic_load_n(&config->sequence, __ATOMIC_RELAXED) != before_seq);
+    if (size > 0) {
+        out[len < size ? len : size - 1] = '\0';
+    }
+    return len;
+}
+
+esp_err_t rg_config_check(const rg_config_t *config, int id, const char *text)
+{
+    if (!valid_id(config, id)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const rg_config_def_t *def = &config->defs[id];
+    if (def->type == RG_CONFIG_STRING) {
+        return check_string(def, text);
+    }
+    int32_t value;
+    if (!parse_fixed(text, def->decimals, &value) || value < def->min || value > def->max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_config_set(rg_config_t *config, int id, const char *text, uint32_t now_ms)
+{
+    esp_err_t err = rg_config_check(config, id, text);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (config->defs[id].type == RG_CONFIG_INT) {
+        int32_t value;
+        parse_fixed(text, config->defs[id].decimals, &value);
+        return rg_config_set_int(config, id, value, now_ms);
+    }
+    if (strcmp(string_of(config, id), text) != 0) {
+        store_string(config, id, text);
+        changed(config, id, now_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_config_set_int(rg_config_t *config, int id, int32_t value, uint32_t now_ms)
+{
+    if (!valid_id(config, id) || config->defs[id].type != RG_CONFIG_INT) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const rg_config_def_t *def = &config->defs[id];
+    if (value < def->min || value > def->max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->values[id] != value) {
+        __atomic_store_n(&config->values[id], value, __ATOMIC_RELAXED);
+        changed(config, id, now_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_config_subscribe(rg_config_t *config, uint32_t ids, rg_config_notify_t notify, void *ctx)
+{
+    if (config->sub_count == RG_CONFIG_MAX_SUBSCRIBERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    rg_config_sub_t *sub = &config->subs[config->sub_count++];
+    sub->ids = ids;
+    sub->notify = notify;
+    sub->ctx = ctx;
+    return ESP_OK;
+}
+
+uint32_t rg_config_flush_due_ms(const rg_config_t *config, uint32_t now_ms)
+{
+    if (!config->dirty) {
+        return UINT32_MAX;
+    }
+    uint32_t due = config->last_change_ms + config->debounce_ms;
+    const uint32_t latest = config->first_change_ms + config->max_delay_ms;
+    if (before(latest, due)) {
+        due = latest;
+    }
+    return before(now_ms, due) ? due - now_ms : 0;
+}
+
+esp_err_t rg_config_flush(rg_config_t *config, uint32_t now_ms)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t written = 0;
+    for (size_t i = 0; i < config->count; i++) {
+        if (!(config->dirty & RG_CONFIG_BIT(i))) {
+            continue;
+        }
+        const rg_config_def_t *def = &config->defs[i];
+        esp_err_t err = def->type == RG_CONFIG_INT
+                            ? config->port.write_int(config->port.ctx, def->name, config->values[i])
+                            : config->port.write_string(config->port.ctx, def->name, string_of(config, (int)i));
+        if (err == ESP_OK) {
+            written |= RG_CONFIG_BIT(i);
+            config->stats.writes++;
+        } else {
+            config->stats.errors++;
+            ret = ret == ESP_OK ? err : ret;
+        }
+    }
+    if (written) {
+        esp_err_t err = config->port.commit(config->port.ctx);
+        if (err == ESP_OK) {
+            config->dirty &= ~written;
+            config->stats.flushes++;
+        } else {
+            config->stats.errors++;
+            ret = ret == ESP_OK ? err : ret;
+        }
+    }
+    if (config->dirty) {
+        config->first_change_ms = config->last_change_ms = now_ms;
+    }
+    return ret;
+}
+
+size_t rg_config_format(const rg_config_t *config, int id, char *out, size_t size)
+{
+    const rg_config_def_t *def = &config->defs[id];
+    if (def->type == RG_CONFIG_STRING) {
+        return rg_config_get_string(config, id, out, size);
+    }
+    const int32_t value = rg_config_get_int(config, id);
+    if (def->decimals == 0) {
+        return (size_t)snprintf(out, size, "%ld", (long)value);
+    }
+    const int32_t scale = s_scale[def->decimals];
+    const uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return (size_t)snprintf(out, size, "%s%lu.%0*lu", value < 0 ? "-" : "", (unsigned long)(magnitude / scale),
+                            def->decimals, (unsigned long)(magnitude % scale));
+}
@@ -0,0 +1,221 @@
+// main/services/config/rg_config.h
+#ifndef RG_CONFIG_H_
+#define RG_CONFIG_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Typed runtime settings, cached in RAM and persisted in one batch.
+//
+// The settings are a table of rg_config_def_t, each an integer (optionally
+// fixed point) or a string with its range and default. Their values live in
+// RAM: an integer is one aligned word and a string sits under a sequence
+// count, so any task reads them without a lock or a flash access, as often
+// as it likes.
+//
+// Changing a value updates RAM and notifies the subscribers to that setting
+// at once, but only marks it dirty for flash. rg_config_flush() writes every
+// dirty setting through the port and commits once; the caller runs it when
+// rg_config_flush_due_ms() says so: debounce_ms after the last change, or
+// max_delay_ms after the first one of a burst that keeps going. A burst of
+// updates, however long, costs each setting at most one write and the whole
+// burst one commit.
+//
+// Pure logic with the clock passed in and storage behind rg_config_port_t.
+// Changes and flushes must come from one task at a time (the device layer
+// holds a mutex); reads are safe from anywhere.
+
+#define RG_CONFIG_MAX_SETTINGS 32
+#define RG_CONFIG_MAX_SUBSCRIBERS 8
+#define RG_CONFIG_NAME_MAX 15 // NVS key length
+
+// Never read back through rg_config_write_json() (passwords)
+#define RG_CONFIG_SECRET 0x01
+
+#define RG_CONFIG_BIT(id) (1u << (id))
+
+typedef enum {
+    RG_CONFIG_INT,    // int32_t, value * 10^decimals
+    RG_CONFIG_STRING,
+} rg_config_type_t;
+
+// Extra check on a new string value, e.g. that rules compile
+typedef esp_err_t (*rg_config_validate_t)(const char *value);
+
+typedef struct {
+    const char *name; // Also the NVS key
+    rg_config_type_t type;
+    uint8_t decimals; // INT: fixed-point decimals of the value
+    uint8_t flags;    // RG_CONFIG_SECRET
+    int32_t min;      // INT: smallest value
+    int32_t max;      // INT: largest value; STRING: longest length
+    int32_t def_int;
+    const char *def_string;
+    rg_config_validate_t validate; // STRING, or NULL
+} rg_config_def_t;
+
+#define RG_CONFIG_INT_DEF(name_, decimals_, min_, max_, default_)                                            \
+    {                                                                                                      \
+        .name = (name_), .type = RG_CONFIG_INT, .decimals = (decimals_), .flags = 0, .min = (min_),        \
+        .max = (max_), .def_int = (default_), .def_string = NULL, .validate = NULL,                        \
+    }
+
+#define RG_CONFIG_STRING_DEF(name_, max_len_, default_, flags_, validate_)                                   \
+    {                                                                                                      \
+        .name = (name_), .type = RG_CONFIG_STRING, .decimals = 0, .flags = (flags_), .min = 0,             \
+        .max = (max_len_), .def_int = 0, .def_string = (default_), .validate = (validate_),                \
+    }
+
+// Where the settings persist: NVS on the device, a map in the tests
+typedef struct {
+    // ESP_ERR_NOT_FOUND (or any error) leaves the default in place
+    esp_err_t (*read_int)(void *ctx, const char *name, int32_t *value);
+    // *len is the buffer size in and the length with the terminator out, like nvs_get_str()
+    esp_err_t (*read_string)(void *ctx, const char *name, char *out, size_t *len);
+    esp_err_t (*write_int)(void *ctx, const char *name, int32_t value);
+    esp_err_t (*write_string)(void *ctx, const char *name, const char *value);
+    esp_err_t (*commit)(void *ctx);
+    void *ctx;
+} rg_config_port_t;
+
+// Called in the task that made the change, after the new value is visible
+typedef void (*rg_config_notify_t)(void *ctx, int id);
+
+typedef struct {
+    uint32_t ids; // RG_CONFIG_BIT() of the settings to hear about
+    rg_config_notify_t notify;
+    void *ctx;
+} rg_config_sub_t;
+
+typedef struct {
+    uint32_t changes;      // Values that changed
+    uint32_t flushes;      // Commits
+    uint32_t writes;       // Settings written
+    uint32_t errors;       // Failed writes or commits (the settings stay dirty)
+    uint32_t load_errors;  // Stored values out of range or rejected at load
+} rg_config_stats_t;
+
+typedef struct {
+    const rg_config_def_t *defs;
+    size_t count;
+    rg_config_port_t port;
+    uint32_t debounce_ms;
+    uint32_t max_delay_ms;
+    int32_t values[RG_CONFIG_MAX_SETTINGS];    // INT: the value; STRING: offset in strings
+    char *strings;
+    uint32_t sequence;                         // Odd while a string changes
+    uint32_t dirty;                            // RG_CONFIG_BIT() of settings not yet persisted
+    uint32_t first_change_ms;                  // Of the dirty ones
+    uint32_t last_change_ms;
+    rg_config_sub_t subs[RG_CONFIG_MAX_SUBSCRIBERS];
+    size_t sub_count;
+    rg_config_stats_t stats;
+} rg_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bytes of string storage the settings in @p defs need.
+ */
+size_t rg_config_strings_size(const rg_config_def_t *defs, size_t count);
+
+/**
+ * @brief Sets every setting to its default; nothing is read or written yet.
+ *
+ * @param strings At least rg_config_strings_size() bytes.
+ * @return ESP_ERR_INVALID_ARG for more than RG_CONFIG_MAX_SETTINGS settings, a
+ *         name longer than RG_CONFIG_NAME_MAX or a default out of its range,
+ *         ESP_ERR_INVALID_SIZE if @p strings_size is too small.
+ */
+esp_err_t rg_config_init(rg_config_t *config, const rg_config_def_t *defs, size_t count, char *strings,
+                         size_t strings_size, const rg_config_port_t *port, uint32_t debounce_ms,
+                         uint32_t max_delay_ms);
+
+/**
+ * @brief Replaces the defaults with the values stored through the port.
+ *
+ * A stored value that is out of range or fails its validator keeps the
+ * default and is counted in stats.load_errors. Subscribers are not notified.
+ */
+void rg_config_load(rg_config_t *config);
+
+/**
+ * @brief Index of the setting called @p name, or -1.
+ */
+int rg_config_find(const rg_config_t *config, const char *name);
+
+/**
+ * @brief Current value of integer setting @p id (times 10^decimals). Lock-free.
+ */
+int32_t rg_config_get_int(const rg_config_t *config, int id);
+
+/**
+ * @brief Copies string setting @p id into @p out, truncating to @p size. Lock-free.
+ *
+ * @return Length of the whole value.
+ */
+size_t rg_config_get_string(const rg_config_t *config, int id, char *out, size_t size);
+
+/**
+ * @brief Checks @p text as a value for setting @p id without changing anything.
+ *
+ * Integers are decimal numbers with at most the setting's decimals, e.g.
+ * "0.25" for a setting with two.
+ *
+ * @return ESP_ERR_INVALID_ARG if it does not parse, is out of range or fails
+ *         the validator; ESP_ERR_NOT_FOUND for an unknown @p id.
+ */
+esp_err_t rg_config_check(const rg_config_t *config, int id, const char *text);
+
+/**
+ * @brief Sets setting @p id from @p text (see rg_config_check()) at @p now_ms.
+ *
+ * A value equal to the current one changes nothing. Otherwise RAM is
+ * updated, the subscribers notified and the setting marked dirty.
+ */
+esp_err_t rg_config_set(rg_config_t *config, int id, const char *text, uint32_t now_ms);
+
+/**
+ * @brief Sets integer setting @p id; as rg_config_set().
+ */
+esp_err_t rg_config_set_int(rg_config_t *config, int id, int32_t value, uint32_t now_ms);
+
+/**
+ * @brief Calls @p notify for changes to the settings in @p ids from now on.
+ *
+ * @return ESP_ERR_NO_MEM beyond RG_CONFIG_MAX_SUBSCRIBERS.
+ */
+esp_err_t rg_config_subscribe(rg_config_t *config, uint32_t ids, rg_config_notify_t notify, void *ctx);
+
+/**
+ * @brief Milliseconds until the dirty settings should be flushed: 0 if now, UINT32_MAX if none is dirty.
+ */
+uint32_t rg_config_flush_due_ms(const rg_config_t *config, uint32_t now_ms);
+
+/**
+ * @brief Writes every dirty setting and commits once.
+ *
+ * @return ESP_OK, or the first error; settings that failed stay dirty and
+ *         are due again debounce_ms after @p now_ms.
+ */
+esp_err_t rg_config_flush(rg_config_t *config, uint32_t now_ms);
+
+/**
+ * @brief Formats setting @p id as rg_config_set() would parse it.
+ *
+ * @return Length of the text; it is truncated to @p size.
+ */
+size_t rg_config_format(const rg_config_t *config, int id, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_CONFIG_H_ */
@@ -0,0 +1,46 @@
+// main/services/config/rg_config_json.h
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+#include "rg_config.h"
+#include "services/json/rg_json_writer.h"
+
+// Every setting as one JSON object, keys sorted as everywhere else:
+// integers as numbers in their units ("deadband_t": 0.2), strings as
+// strings, secrets as null so they never leave the device.
+static inline void rg_config_write_json(rg_json_writer &json, const rg_config_t &config)
+{
+    static const double scale[] = {1, 10, 100, 1000, 10000};
+    int order[RG_CONFIG_MAX_SETTINGS];
+    for (size_t i = 0; i < config.count; i++) {
+        size_t j = i;
+        for (; j > 0 && strcmp(config.defs[order[j - 1]].name, config.defs[i].name) > 0; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = (int)i;
+    }
+
+    json.begin_object();
+    for (size_t i = 0; i < config.count; i++) {
+        const int id = order[i];
+        const rg_config_def_t &def = config.defs[id];
+        json.key(def.name);
+        if (def.flags & RG_CONFIG_SECRET) {
+            json.value(NAN);
+        } else if (def.type == RG_CONFIG_INT) {
+            const int32_t value = rg_config_get_int(&config, id);
+            if (def.decimals == 0) {
+                json.value(value);
+            } else {
+                json.value(value / scale[def.decimals]);
+            }
+        } else {
+            char value[256]; // Longer strings are cut here
+            rg_config_get_string(&config, id, value, sizeof(value));
+            json.value(value);
+        }
+    }
+    json.end_object();
+}
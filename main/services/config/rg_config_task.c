@@ -0,0 +1,187 @@
+// main/services/config/rg_config_task.c
+#include "rg_config_task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "services/rtos/rg_static_alloc.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_CONFIG";
+
+#define NVS_NAMESPACE "rg_config"
+
+static rg_config_t s_config;
+static char s_strings[RG_SETTINGS_SSID_MAX + RG_SETTINGS_PASSWORD_MAX + RG_SETTINGS_RULES_MAX + 3];
+static nvs_handle_t s_nvs;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+RG_MUTEX_STORAGE(s_lock);
+RG_TASK_STORAGE(s_flush_task, 3072);
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// --- NVS port ---------------------------------------------------------------
+
+static esp_err_t nvs_read_int(void *ctx, const char *name, int32_t *value)
+{
+    return nvs_get_i32(s_nvs, name, value);
+}
+
+static esp_err_t nvs_read_string(void *ctx, const char *name, char *out, size_t *len)
+{
+    return nvs_get_str(s_nvs, name, out, len);
+}
+
+static esp_err_t nvs_write_int(void *ctx, const char *name, int32_t value)
+{
+    return nvs_set_i32(s_nvs, name, value);
+}
+
+static esp_err_t nvs_write_string(void *ctx, const char *name, const char *value)
+{
+    return nvs_set_str(s_nvs, name, value);
+}
+
+static esp_err_t nvs_commit_all(void *ctx)
+{
+    return nvs_commit(s_nvs);
+}
+
+// --- Flushing ---------------------------------------------------------------
+
+static void flush_task(void *arg)
+{
+    (void)arg;
+    // Changes made before this runs are seen by the first pass
+    __atomic_store_n(&s_task, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+    while (1) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        uint32_t due = rg_config_flush_due_ms(&s_config, now_ms());
+        if (due == 0) {
+            const uint32_t dirty = s_config.dirty;
+            esp_err_t err = rg_config_flush(&s_config, now_ms());
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to save settings, retrying: %s", esp_err_to_name(err));
+            } else {
+                ESP_LOGI(TAG, "Saved %d setting(s).", __builtin_popcount(dirty));
+            }
+            due = rg_config_flush_due_ms(&s_config, now_ms());
+        }
+        xSemaphoreGive(s_lock);
+        // A change wakes the task to recompute the deadline
+        ulTaskNotifyTake(pdTRUE, due == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(due) + 1);
+    }
+}
+
+esp_err_t rg_config_task_start(void)
+{
+    if (s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    static const rg_config_port_t port = {
+        .read_int = nvs_read_int,
+        .read_string = nvs_read_string,
+        .write_int = nvs_write_int,
+        .write_string = nvs_write_string,
+        .commit = nvs_commit_all,
+        .ctx = NULL,
+    };
+    esp_err_t err = rg_config_init(&s_config, rg_settings_defs, RG_SETTING_COUNT, s_strings, sizeof(s_strings),
+                                   &port, CONFIG_RG_SETTINGS_DEBOUNCE_MS, CONFIG_RG_SETTINGS_MAX_DELAY_MS);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Without NVS the node still runs on the defaults; changes then last until reboot and count as errors
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &s_nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS, using the defaults: %s", esp_err_to_name(err));
+    } else {
+        rg_config_load(&s_config);
+        if (s_config.stats.load_errors) {
+            ESP_LOGW(TAG, "%lu stored setting(s) invalid, using their defaults.",
+                     (unsigned long)s_config.stats.load_errors);
+        }
+    }
+
+    s_lock = RG_MUTEX_CREATE(s_lock);
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (RG_TASK_CREATE(s_flush_task, flush_task, "config", NULL, 1) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+const rg_config_t *rg_config_task_config(void)
+{
+    return &s_config;
+}
+
+esp_err_t rg_config_task_set(const char *const *names, const char *const *values, size_t count, size_t *bad)
+{
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // Everything is checked before anything changes
+    for (size_t i = 0; i < count && err == ESP_OK; i++) {
+        err = rg_config_check(&s_config, rg_config_find(&s_config, names[i]), values[i]);
+        if (err != ESP_OK && bad) {
+            *bad = i;
+        }
+    }
+    const uint32_t now = now_ms();
+    for (size_t i = 0; i < count && err == ESP_OK; i++) {
+        rg_config_set(&s_config, rg_config_find(&s_config, names[i]), values[i], now);
+    }
+    const bool dirty = s_config.dirty != 0;
+    xSemaphoreGive(s_lock);
+
+    TaskHandle_t task = __atomic_load_n(&s_task, __ATOMIC_ACQUIRE);
+    if (err == ESP_OK && dirty && task) {
+        xTaskNotifyGive(task);
+    }
+    return err;
+}
+
+esp_err_t rg_config_task_subscribe(uint32_t ids, rg_config_notify_t notify, void *ctx)
+{
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = rg_config_subscribe(&s_config, ids, notify, ctx);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+void rg_config_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const rg_config_stats_t stats = s_config.stats;
+    const uint32_t dirty = s_config.dirty;
+    xSemaphoreGive(s_lock);
+
+    rg_metrics_write_family(writer, "rg_config_changes_total", "counter", "Settings changed at run time.");
+    rg_metrics_write_value(writer, "rg_config_changes_total", NULL, stats.changes);
+    rg_metrics_write_family(writer, "rg_config_commits_total", "counter", "NVS commits of changed settings.");
+    rg_metrics_write_value(writer, "rg_config_commits_total", NULL, stats.flushes);
+    rg_metrics_write_family(writer, "rg_config_writes_total", "counter", "Settings written to NVS.");
+    rg_metrics_write_value(writer, "rg_config_writes_total", NULL, stats.writes);
+    rg_metrics_write_family(writer, "rg_config_errors_total", "counter", "Failed NVS writes and commits.");
+    rg_metrics_write_value(writer, "rg_config_errors_total", NULL, stats.errors);
+    rg_metrics_write_family(writer, "rg_config_unsaved", "gauge", "Changed settings not yet in NVS.");
+    rg_metrics_write_value(writer, "rg_config_unsaved", NULL, __builtin_popcount(dirty));
+}
@@ -0,0 +1,61 @@
+// main/services/config/rg_config_task.h
+#ifndef RG_CONFIG_TASK_H_
+#define RG_CONFIG_TASK_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "rg_config.h"
+#include "rg_settings.h"
+#include "services/metrics/rg_metrics.h"
+
+// The device's settings store (rg_settings.h) over NVS namespace
+// "rg_config". Reads go straight to the RAM copy from any task. Changes take
+// a mutex, notify the subscribers in the changing task and wake a priority 1
+// task that commits them to NVS once they have been quiet for
+// CONFIG_RG_SETTINGS_DEBOUNCE_MS (at most CONFIG_RG_SETTINGS_MAX_DELAY_MS
+// after the first one).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Loads the stored settings over the Kconfig defaults and starts the flush task. Needs NVS.
+ */
+esp_err_t rg_config_task_start(void);
+
+/**
+ * @brief The store, for lock-free reads; valid after rg_config_task_start().
+ */
+const rg_config_t *rg_config_task_config(void);
+
+/**
+ * @brief Applies @p count name/value pairs, all or none.
+ *
+ * @param bad Set to the index of the pair that was rejected; may be NULL.
+ * @return ESP_OK, ESP_ERR_NOT_FOUND for an unknown name, ESP_ERR_INVALID_ARG
+ *         for a value rg_config_check() rejects, ESP_ERR_INVALID_STATE before start.
+ */
+esp_err_t rg_config_task_set(const char *const *names, const char *const *values, size_t count, size_t *bad);
+
+/**
+ * @brief Calls @p notify, in the task that made the change, whenever a setting in @p ids changes.
+ *
+ * Keep @p notify short: wake a task or set a flag.
+ */
+esp_err_t rg_config_task_subscribe(uint32_t ids, rg_config_notify_t notify, void *ctx);
+
+/**
+ * @brief Writes the change, commit and error counters for /metrics.
+ */
+void rg_config_task_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_CONFIG_TASK_H_ */
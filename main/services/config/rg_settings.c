@@ -0,0 +1,47 @@
+// main/services/config/rg_settings.c
+#include "rg_settings.h"
+
+#include "services/rules/rg_rules.h"
+#include <sdkconfig.h>
+
+_Static_assert(sizeof(CONFIG_RG_WIFI_SSID) <= RG_SETTINGS_SSID_MAX + 1, "CONFIG_RG_WIFI_SSID is too long");
+_Static_assert(sizeof(CONFIG_RG_WIFI_PASSWORD) <= RG_SETTINGS_PASSWORD_MAX + 1,
+               "CONFIG_RG_WIFI_PASSWORD is too long");
+_Static_assert(sizeof(CONFIG_RG_RULES) <= RG_SETTINGS_RULES_MAX + 1, "CONFIG_RG_RULES is too long for the settings");
+
+// Only the rule text; whether a rule's GPIO can drive an output is checked when the rules are loaded
+static esp_err_t validate_rules(const char *text)
+{
+    // Config changes are serialized, so one scratch table does
+    static rg_rule_t scratch[CONFIG_RG_RULES_MAX];
+    size_t count;
+    return rg_rules_compile(text, scratch, CONFIG_RG_RULES_MAX, &count, NULL) == ESP_OK ? ESP_OK
+                                                                                       : ESP_ERR_INVALID_ARG;
+}
+
+const rg_config_def_t rg_settings_defs[RG_SETTING_COUNT] = {
+    [RG_SETTING_SAMPLE_MIN_MS] = RG_CONFIG_INT_DEF("sample_min_ms", 0, 500, 60000, CONFIG_RG_SAMPLER_MIN_INTERVAL_MS),
+    [RG_SETTING_SAMPLE_MAX_MS] =
+        RG_CONFIG_INT_DEF("sample_max_ms", 0, 1000, 600000, CONFIG_RG_SAMPLER_MAX_INTERVAL_MS),
+    [RG_SETTING_HEARTBEAT_S] = RG_CONFIG_INT_DEF("heartbeat_s", 0, 0, 86400, CONFIG_RG_SAMPLER_HEARTBEAT_S),
+    [RG_SETTING_DEADBAND_T] = RG_CONFIG_INT_DEF("deadband_t", 2, 1, 1000, CONFIG_RG_SAMPLER_DEADBAND_TEMPERATURE),
+    [RG_SETTING_DEADBAND_H] = RG_CONFIG_INT_DEF("deadband_h", 2, 1, 2000, CONFIG_RG_SAMPLER_DEADBAND_HUMIDITY),
+    [RG_SETTING_DEADBAND_P] = RG_CONFIG_INT_DEF("deadband_p", 1, 1, 100, CONFIG_RG_SAMPLER_DEADBAND_PRESSURE),
+    [RG_SETTING_WIFI_SSID] = RG_CONFIG_STRING_DEF("wifi_ssid", RG_SETTINGS_SSID_MAX, CONFIG_RG_WIFI_SSID, 0, NULL),
+    [RG_SETTING_WIFI_PASSWORD] = RG_CONFIG_STRING_DEF("wifi_password", RG_SETTINGS_PASSWORD_MAX,
+                                                      CONFIG_RG_WIFI_PASSWORD, RG_CONFIG_SECRET, NULL),
+    [RG_SETTING_RULES] = RG_CONFIG_STRING_DEF("rules", RG_SETTINGS_RULES_MAX, CONFIG_RG_RULES, 0, validate_rules),
+};
+
+void rg_settings_sampler_config(const rg_config_t *config, rg_sampler_config_t *out)
+{
+    out->deadband[RG_SAMPLER_TEMPERATURE] = rg_config_get_int(config, RG_SETTING_DEADBAND_T) / 100.0f;
+    out->deadband[RG_SAMPLER_HUMIDITY] = rg_config_get_int(config, RG_SETTING_DEADBAND_H) / 100.0f;
+    out->deadband[RG_SAMPLER_PRESSURE] = rg_config_get_int(config, RG_SETTING_DEADBAND_P) / 10.0f;
+    out->min_interval_ms = (uint32_t)rg_config_get_int(config, RG_SETTING_SAMPLE_MIN_MS);
+    out->max_interval_ms = (uint32_t)rg_config_get_int(config, RG_SETTING_SAMPLE_MAX_MS);
+    if (out->max_interval_ms < out->min_interval_ms) {
+        out->max_interval_ms = out->min_interval_ms;
+    }
+    out->heartbeat_ms = (uint32_t)rg_config_get_int(config, RG_SETTING_HEARTBEAT_S) * 1000u;
+}
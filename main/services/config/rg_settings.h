@@ -0,0 +1,65 @@
+// main/services/config/rg_settings.h
+#ifndef RG_SETTINGS_H_
+#define RG_SETTINGS_H_
+
+#pragma once
+
+#include "rg_config.h"
+#include "services/sampler/rg_sampler.h"
+
+// The node's runtime settings, served and changed at /settings. Defaults
+// come from Kconfig; values set at run time persist in NVS and win over
+// them. Names are the NVS keys and the /settings fields.
+//
+//   sample_min_ms  Fastest sampling interval (ms)
+//   sample_max_ms  Slowest sampling interval (ms)
+//   heartbeat_s    Publish at least every (s), 0 = never
+//   deadband_t     Temperature deadband (degC, 0.01 steps)
+//   deadband_h     Humidity deadband (%RH, 0.01 steps)
+//   deadband_p     Pressure deadband (hPa, 0.1 steps)
+//   wifi_ssid      Network name
+//   wifi_password  Passphrase, empty for an open network (never read back)
+//   rules          Local rules, as CONFIG_RG_RULES
+
+typedef enum {
+    RG_SETTING_SAMPLE_MIN_MS,
+    RG_SETTING_SAMPLE_MAX_MS,
+    RG_SETTING_HEARTBEAT_S,
+    RG_SETTING_DEADBAND_T,
+    RG_SETTING_DEADBAND_H,
+    RG_SETTING_DEADBAND_P,
+    RG_SETTING_WIFI_SSID,
+    RG_SETTING_WIFI_PASSWORD,
+    RG_SETTING_RULES,
+    RG_SETTING_COUNT,
+} rg_setting_t;
+
+#define RG_SETTINGS_SAMPLING                                                                                 \
+    (RG_CONFIG_BIT(RG_SETTING_SAMPLE_MIN_MS) | RG_CONFIG_BIT(RG_SETTING_SAMPLE_MAX_MS) |                     \
+     RG_CONFIG_BIT(RG_SETTING_HEARTBEAT_S) | RG_CONFIG_BIT(RG_SETTING_DEADBAND_T) |                          \
+     RG_CONFIG_BIT(RG_SETTING_DEADBAND_H) | RG_CONFIG_BIT(RG_SETTING_DEADBAND_P))
+#define RG_SETTINGS_WIFI (RG_CONFIG_BIT(RG_SETTING_WIFI_SSID) | RG_CONFIG_BIT(RG_SETTING_WIFI_PASSWORD))
+
+#define RG_SETTINGS_SSID_MAX 32
+#define RG_SETTINGS_PASSWORD_MAX 64
+#define RG_SETTINGS_RULES_MAX 255
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Indexed by rg_setting_t
+extern const rg_config_def_t rg_settings_defs[RG_SETTING_COUNT];
+
+/**
+ * @brief The sampler configuration the sampling settings describe.
+ *
+ * A slowest interval below the fastest is raised to it.
+ */
+void rg_settings_sampler_config(const rg_config_t *config, rg_sampler_config_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_SETTINGS_H_ */
@@ -0,0 +1,177 @@
+// main/services/filter/rg_filter.h
+#ifndef RG_FILTER_H_
+#define RG_FILTER_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tuple>
+#include <type_traits>
+
+// Fixed-point filter chains for sensor channels.
+//
+// A chain is a list of stage types fixed at compile time:
+//
+//   rg_filter::chain<rg_filter::outlier<100>, rg_filter::median<3>, rg_filter::ema<2>> f;
+//   int32_t smoothed = f(raw);
+//
+// Stages are plain structs with an inline operator(); the chain calls them in
+// order through a fold expression, so there is no virtual dispatch and the
+// whole chain inlines into the caller. Samples are int32_t in the channel's
+// fixed-point unit (0.01 degC, 0.01 %RH, Pa); stages that smooth keep 8
+// extra fraction bits internally so small steps are not lost to rounding.
+// Disabled stages are rg_filter::pass, which costs neither time nor RAM.
+//
+// Stages assume a steady sample stream: windows and gains count samples, not
+// seconds.
+
+namespace rg_filter {
+
+// Fraction bits kept by the smoothing stages
+constexpr int FRAC_BITS = 8;
+
+constexpr int32_t round_frac(int64_t q)
+{
+    return (int32_t)((q + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+}
+
+// Disabled stage
+struct pass {
+    int32_t operator()(int32_t x) { return x; }
+    void reset() {}
+};
+
+// Holds the last accepted value while a sample jumps more than MaxStep from it.
+// A jump that persists for Confirm samples in a row is a real step and is let
+// through, so the stage never locks out a genuine change.
+template <int32_t MaxStep, uint8_t Confirm = 3>
+struct outlier {
+    static_assert(MaxStep > 0, "MaxStep must be positive");
+    static_assert(Confirm > 0, "Confirm must be at least one sample");
+    int32_t last = 0;
+    uint8_t rejected = 0;
+    bool primed = false;
+
+    int32_t operator()(int32_t x)
+    {
+        int32_t step = x > last ? x - last : last - x;
+        if (primed && step > MaxStep && ++rejected < Confirm) {
+            return last;
+        }
+        last = x;
+        rejected = 0;
+        primed = true;
+        return x;
+    }
+    void reset() { *this = outlier(); }
+};
+
+// Median of the last N samples (fewer until the window has filled)
+template <uint8_t N>
+struct median {
+    static_assert(N % 2 == 1 && N <= 15, "N must be odd and at most 15");
+    int32_t window[N];
+    uint8_t count = 0;
+    uint8_t next = 0;
+
+    int32_t operator()(int32_t x)
+    {
+        window[next] = x;
+        next = next + 1 == N ? 0 : next + 1;
+        if (count < N) {
+            count++;
+        }
+        // Insertion sort of a copy; N is tiny
+        int32_t sorted[N];
+        for (uint8_t i = 0; i < count; i++) {
+            int32_t v = window[i];
+            uint8_t j = i;
+            for (; j > 0 && sorted[j - 1] > v; j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = v;
+        }
+        return sorted[count / 2];
+    }
+    void reset() { count = next = 0; }
+};
+
+// First-order IIR: y += (x - y) / 2^Shift
+template <int Shift>
+struct ema {
+    static_assert(Shift >= 1 && Shift <= FRAC_BITS, "Shift must be 1..FRAC_BITS");
+    int32_t y = 0; // Q(FRAC_BITS)
+    bool primed = false;
+
+    int32_t operator()(int32_t x)
+    {
+        int32_t xq = x * (1 << FRAC_BITS);
+        if (!primed) {
+            y = xq;
+            primed = true;
+        } else {
+            y += (xq - y) >> Shift;
+        }
+        return round_frac(y);
+    }
+    void reset() { primed = false; }
+};
+
+// Scalar Kalman filter for a slowly drifting value: process noise variance Q
+// per sample, measurement noise variance R, both in squared channel units.
+// The gain settles where the two balance, so it smooths harder than an EMA
+// on a quiet channel and follows faster when Q says the value moves.
+template <int32_t Q, int32_t R>
+struct kalman {
+    static_assert(Q >= 0 && R > 0, "Q must be >= 0 and R > 0");
+    int32_t x = 0; // Estimate, Q(FRAC_BITS)
+    int64_t p = 0; // Estimate variance, Q(FRAC_BITS)
+    bool primed = false;
+
+    int32_t operator()(int32_t z)
+    {
+        int32_t zq = z * (1 << FRAC_BITS);
+        if (!primed) {
+            x = zq;
+            p = (int64_t)R << FRAC_BITS;
+            primed = true;
+            return z;
+        }
+        p += (int64_t)Q << FRAC_BITS;
+        // Gain in Q16
+        int64_t k = (p << 16) / (p + ((int64_t)R << FRAC_BITS));
+        x += (int32_t)(((int64_t)(zq - x) * k) >> 16);
+        p = (p * ((1 << 16) - k)) >> 16;
+        return round_frac(x);
+    }
+    void reset() { primed = false; }
+};
+
+// Runs Stages in order on every sample
+template <typename... Stages>
+class chain {
+public:
+    int32_t operator()(int32_t x)
+    {
+        std::apply([&x](auto &...stage) { ((x = stage(x)), ...); }, stages_);
+        return x;
+    }
+
+    void reset()
+    {
+        std::apply([](auto &...stage) { (stage.reset(), ...); }, stages_);
+    }
+
+private:
+    std::tuple<Stages...> stages_;
+};
+
+// Stage if Enabled, pass otherwise
+template <bool Enabled, typename Stage>
+using optional = std::conditional_t<Enabled, Stage, pass>;
+
+} // namespace rg_filter
+
+#endif /* RG_FILTER_H_ */
@@ -0,0 +1,107 @@
+// main/services/filter/rg_filter_chains.h
+#ifndef RG_FILTER_CHAINS_H_
+#define RG_FILTER_CHAINS_H_
+
+#pragma once
+
+#include "rg_filter.h"
+
+#include <sdkconfig.h>
+
+// Per-channel chains from Kconfig: outlier rejection, then a median, then
+// EMA or Kalman smoothing. Options of a disabled smoother are not defined by
+// Kconfig, hence the fallbacks.
+//
+// Each chain is also available as its two halves. The guard only rejects
+// outliers, so a real step comes through within the confirm count; the
+// smoother (median and EMA or Kalman) spreads it over several samples.
+// Change detection and alarms run on the guard's output and only published
+// values go through the smoother.
+
+#ifndef CONFIG_RG_FILTER_T_EMA_SHIFT
+#define CONFIG_RG_FILTER_T_EMA_SHIFT 1
+#endif
+#ifndef CONFIG_RG_FILTER_T_KALMAN_Q
+#define CONFIG_RG_FILTER_T_KALMAN_Q 0
+#define CONFIG_RG_FILTER_T_KALMAN_R 1
+#endif
+#ifndef CONFIG_RG_FILTER_H_EMA_SHIFT
+#define CONFIG_RG_FILTER_H_EMA_SHIFT 1
+#endif
+#ifndef CONFIG_RG_FILTER_H_KALMAN_Q
+#define CONFIG_RG_FILTER_H_KALMAN_Q 0
+#define CONFIG_RG_FILTER_H_KALMAN_R 1
+#endif
+#ifndef CONFIG_RG_FILTER_P_EMA_SHIFT
+#define CONFIG_RG_FILTER_P_EMA_SHIFT 1
+#endif
+#ifndef CONFIG_RG_FILTER_P_KALMAN_Q
+#define CONFIG_RG_FILTER_P_KALMAN_Q 0
+#define CONFIG_RG_FILTER_P_KALMAN_R 1
+#endif
+
+#if CONFIG_RG_FILTER_T_SMOOTHING_EMA
+#define RG_FILTER_T_SMOOTHING 1
+#elif CONFIG_RG_FILTER_T_SMOOTHING_KALMAN
+#define RG_FILTER_T_SMOOTHING 2
+#else
+#define RG_FILTER_T_SMOOTHING 0
+#endif
+#if CONFIG_RG_FILTER_H_SMOOTHING_EMA
+#define RG_FILTER_H_SMOOTHING 1
+#elif CONFIG_RG_FILTER_H_SMOOTHING_KALMAN
+#define RG_FILTER_H_SMOOTHING 2
+#else
+#define RG_FILTER_H_SMOOTHING 0
+#endif
+#if CONFIG_RG_FILTER_P_SMOOTHING_EMA
+#define RG_FILTER_P_SMOOTHING 1
+#elif CONFIG_RG_FILTER_P_SMOOTHING_KALMAN
+#define RG_FILTER_P_SMOOTHING 2
+#else
+#define RG_FILTER_P_SMOOTHING 0
+#endif
+
+namespace rg_filter {
+
+template <int32_t OutlierStep>
+using channel_guard = optional<(OutlierStep > 0), outlier<(OutlierStep > 0 ? OutlierStep : 1)>>;
+
+// Smoothing: 0 none, 1 EMA, 2 Kalman
+template <uint8_t Median, int Smoothing, int EmaShift, int32_t KalmanQ, int32_t KalmanR>
+using channel_smoother =
+    chain<optional<(Median > 1), median<(Median > 1 ? Median : 1)>>, optional<Smoothing == 1, ema<EmaShift>>,
+          optional<Smoothing == 2, kalman<KalmanQ, KalmanR>>>;
+
+template <int32_t OutlierStep, uint8_t Median, int Smoothing, int EmaShift, int32_t KalmanQ, int32_t KalmanR>
+using channel_chain =
+    chain<channel_guard<OutlierStep>, channel_smoother<Median, Smoothing, EmaShift, KalmanQ, KalmanR>>;
+
+} // namespace rg_filter
+
+// 0.01 degC
+typedef rg_filter::channel_guard<CONFIG_RG_FILTER_T_OUTLIER_STEP> rg_filter_temperature_guard_t;
+typedef rg_filter::channel_smoother<CONFIG_RG_FILTER_T_MEDIAN, RG_FILTER_T_SMOOTHING, CONFIG_RG_FILTER_T_EMA_SHIFT,
+                                    CONFIG_RG_FILTER_T_KALMAN_Q, CONFIG_RG_FILTER_T_KALMAN_R>
+    rg_filter_temperature_smoother_t;
+typedef rg_filter::channel_chain<CONFIG_RG_FILTER_T_OUTLIER_STEP, CONFIG_RG_FILTER_T_MEDIAN, RG_FILTER_T_SMOOTHING,
+                                 CONFIG_RG_FILTER_T_EMA_SHIFT, CONFIG_RG_FILTER_T_KALMAN_Q, CONFIG_RG_FILTER_T_KALMAN_R>
+    rg_filter_temperature_t;
+// 0.01 %RH
+typedef rg_filter::channel_guard<CONFIG_RG_FILTER_H_OUTLIER_STEP> rg_filter_humidity_guard_t;
+typedef rg_filter::channel_smoother<CONFIG_RG_FILTER_H_MEDIAN, RG_FILTER_H_SMOOTHING, CONFIG_RG_FILTER_H_EMA_SHIFT,
+                                    CONFIG_RG_FILTER_H_KALMAN_Q, CONFIG_RG_FILTER_H_KALMAN_R>
+    rg_filter_humidity_smoother_t;
+typedef rg_filter::channel_chain<CONFIG_RG_FILTER_H_OUTLIER_STEP, CONFIG_RG_FILTER_H_MEDIAN, RG_FILTER_H_SMOOTHING,
+                                 CONFIG_RG_FILTER_H_EMA_SHIFT, CONFIG_RG_FILTER_H_KALMAN_Q, CONFIG_RG_FILTER_H_KALMAN_R>
+    rg_filter_humidity_t;
+// Pa
+typedef rg_filter::channel_guard<CONFIG_RG_FILTER_P_OUTLIER_STEP> rg_filter_pressure_guard_t;
+typedef rg_filter::channel_smoother<CONFIG_RG_FILTER_P_MEDIAN, RG_FILTER_P_SMOOTHING, CONFIG_RG_FILTER_P_EMA_SHIFT,
+                                    CONFIG_RG_FILTER_P_KALMAN_Q, CONFIG_RG_FILTER_P_KALMAN_R>
+    rg_filter_pressure_smoother_t;
+typedef rg_filter::channel_chain<CONFIG_RG_FILTER_P_OUTLIER_STEP, CONFIG_RG_FILTER_P_MEDIAN, RG_FILTER_P_SMOOTHING,
+                                 CONFIG_RG_FILTER_P_EMA_SHIFT, CONFIG_RG_FILTER_P_KALMAN_Q, CONFIG_RG_FILTER_P_KALMAN_R>
+    rg_filter_pressure_t;
+
+#endif /* RG_FILTER_CHAINS_H_ */
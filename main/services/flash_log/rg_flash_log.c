@@ -0,0 +1,260 @@
+// main/services/flash_log/rg_flash_log.c
+#include "rg_flash_log.h"
+
+#include <string.h>
+
+#define RG_FLASH_LOG_MAGIC 0x314C4752u // "RGL1"
+#define RECORDS_PER_PAGE (RG_FLASH_LOG_PAGE_SIZE / RG_FLASH_LOG_RECORD_SIZE)
+
+// CRC-16/CCITT-FALSE, bitwise; records are 10 bytes so a table is not worth the RAM
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+// Little-endian on flash: timestamp(4) temperature(2) humidity(2) pressure(2) crc16(2)
+static void record_encode(const rg_flash_log_record_t *record, uint8_t *out)
+{
+    put_u32(out, record->timestamp);
+    put_u16(out + 4, (uint16_t)record->temperature);
+    put_u16(out + 6, record->humidity);
+    put_u16(out + 8, record->pressure);
+    put_u16(out + 10, crc16(out, 10));
+}
+
+static bool record_is_erased(const uint8_t *raw)
+{
+    for (int i = 0; i < RG_FLASH_LOG_RECORD_SIZE; i++) {
+        if (raw[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool record_decode(const uint8_t *raw, rg_flash_log_record_t *record)
+{
+    if (get_u16(raw + 10) != crc16(raw, 10)) {
+        return false;
+    }
+    record->timestamp = get_u32(raw);
+    record->temperature = (int16_t)get_u16(raw + 4);
+    record->humidity = get_u16(raw + 6);
+    record->pressure = get_u16(raw + 8);
+    return true;
+}
+
+static size_t sector_offset(const rg_flash_log_t *log, uint32_t sector)
+{
+    return (size_t)sector * log->io.sector_size;
+}
+
+static size_t record_offset(const rg_flash_log_t *log, uint32_t sector, uint32_t index)
+{
+    return sector_offset(log, sector) + RG_FLASH_LOG_HEADER_SIZE + (size_t)index * RG_FLASH_LOG_RECORD_SIZE;
+}
+
+// Returns true and the sequence number if the sector carries a valid header
+static bool read_header(rg_flash_log_t *log, uint32_t sector, uint32_t *seq)
+{
+    uint8_t header[RG_FLASH_LOG_HEADER_SIZE];
+    if (log->io.read(log->io.ctx, sector_offset(log, sector), header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    uint32_t s = get_u32(header + 4);
+    if (get_u32(header) != RG_FLASH_LOG_MAGIC || get_u32(header + 8) != ~s) {
+        return false;
+    }
+    *seq = s;
+    return true;
+}
+
+// Erases `sector` and stamps it with `seq`; it becomes the new head
+static esp_err_t start_sector(rg_flash_log_t *log, uint32_t sector, uint32_t seq)
+{
+    esp_err_t err = log->io.erase_sector(log->io.ctx, sector_offset(log, sector));
+    if (err != ESP_OK) {
+        return err;
+    }
+    log->stats.sector_erases++;
+
+    uint8_t header[RG_FLASH_LOG_HEADER_SIZE];
+    memset(header, 0xFF, sizeof(header));
+    put_u32(header, RG_FLASH_LOG_MAGIC);
+    put_u32(header + 4, seq);
+    put_u32(header + 8, ~seq);
+    err = log->io.write(log->io.ctx, sector_offset(log, sector), header, sizeof(header));
+    if (err != ESP_OK) {
+        return err;
+    }
+    log->stats.program_ops++;
+    log->stats.bytes_programmed += sizeof(header);
+
+    log->head_sector = sector;
+    log->head_seq = seq;
+    log->head_records = 0;
+    return ESP_OK;
+}
+
+// Replays one sector; returns the number of record slots in use
+static uint32_t replay_sector(rg_flash_log_t *log, uint32_t sector, rg_flash_log_replay_cb_t cb, void *ctx)
+{
+    uint32_t index = 0;
+    while (index < log->records_per_sector) {
+        uint32_t chunk = log->records_per_sector - index;
+        if (chunk > RECORDS_PER_PAGE) {
+            chunk = RECORDS_PER_PAGE;
+        }
+        // The page buffer is idle during mount; reuse it as the read buffer
+        if (log->io.read(log->io.ctx, record_offset(log, sector, index), log->page,
+                         chunk * RG_FLASH_LOG_RECORD_SIZE) != ESP_OK) {
+            return index;
+        }
+        for (uint32_t i = 0; i < chunk; i++) {
+            const uint8_t *raw = log->page + i * RG_FLASH_LOG_RECORD_SIZE;
+            if (record_is_erased(raw)) {
+                return index + i; // Appends are sequential: the rest of the sector is empty
+            }
+            rg_flash_log_record_t record;
+            if (record_decode(raw, &record)) {
+                log->stats.records_replayed++;
+                if (cb) {
+                    cb(&record, ctx);
+                }
+            } else {
+                log->stats.records_corrupt++; // Torn write; the slot stays consumed
+            }
+        }
+        index += chunk;
+    }
+    return index;
+}
+
+esp_err_t rg_flash_log_mount(rg_flash_log_t *log, const rg_flash_log_io_t *io, rg_flash_log_replay_cb_t cb, void *ctx)
+{
+    if (!log || !io || !io->read || !io->write || !io->erase_sector || io->sector_size == 0 ||
+        io->sector_size < RG_FLASH_LOG_HEADER_SIZE + RG_FLASH_LOG_RECORD_SIZE || io->size % io->sector_size != 0 ||
+        io->size / io->sector_size < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(log, 0, sizeof(*log));
+    log->io = *io;
+    log->sector_count = io->size / io->sector_size;
+    log->records_per_sector = (io->sector_size - RG_FLASH_LOG_HEADER_SIZE) / RG_FLASH_LOG_RECORD_SIZE;
+
+    // The head is the sector with the highest sequence number
+    bool found = false;
+    for (uint32_t s = 0; s < log->sector_count; s++) {
+        uint32_t seq;
+        if (read_header(log, s, &seq) && (!found || seq > log->head_seq)) {
+            found = true;
+            log->head_sector = s;
+            log->head_seq = seq;
+        }
+    }
+    if (!found) {
+        return start_sector(log, 0, 1);
+    }
+
+    // Sectors are reused in circular order, so walking forward from the one after
+    // the head visits them oldest first. Skip stale sectors from an older format.
+    for (uint32_t k = 1; k <= log->sector_count; k++) {
+        uint32_t s = (log->head_sector + k) % log->sector_count;
+        uint32_t seq;
+        if (!read_header(log, s, &seq) || seq > log->head_seq || log->head_seq - seq >= log->sector_count) {
+            continue;
+        }
+        uint32_t used = replay_sector(log, s, cb, ctx);
+        if (s == log->head_sector) {
+            log->head_records = used;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_flash_log_flush(rg_flash_log_t *log)
+{
+    if (!log) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    uint32_t done = 0;
+    while (done < log->pending) {
+        if (log->head_records == log->records_per_sector) {
+            err = start_sector(log, (log->head_sector + 1) % log->sector_count, log->head_seq + 1);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+        uint32_t n = log->pending - done;
+        if (n > log->records_per_sector - log->head_records) {
+            n = log->records_per_sector - log->head_records;
+        }
+        err = log->io.write(log->io.ctx, record_offset(log, log->head_sector, log->head_records),
+                            log->page + done * RG_FLASH_LOG_RECORD_SIZE, n * RG_FLASH_LOG_RECORD_SIZE);
+        if (err != ESP_OK) {
+            break;
+        }
+        log->stats.program_ops++;
+        log->stats.bytes_programmed += n * RG_FLASH_LOG_RECORD_SIZE;
+        log->stats.records_written += n;
+        log->head_records += n;
+        done += n;
+    }
+
+    // On error the unwritten records are dropped rather than retried forever
+    log->pending = 0;
+    return err;
+}
+
+esp_err_t rg_flash_log_append(rg_flash_log_t *log, const rg_flash_log_record_t *record)
+{
+    if (!log || !record) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    record_encode(record, log->page + log->pending * RG_FLASH_LOG_RECORD_SIZE);
+    log->pending++;
+    log->stats.records_appended++;
+    if (log->pending == RECORDS_PER_PAGE) {
+        return rg_flash_log_flush(log);
+    }
+    return ESP_OK;
+}
+
+uint32_t rg_flash_log_capacity(const rg_flash_log_t *log)
+{
+    // One sector is always sacrificed when the head wraps onto the oldest data
+    return log ? (log->sector_count - 1) * log->records_per_sector : 0;
+}
@@ -0,0 +1,108 @@
+// main/services/flash_log/rg_flash_log.h
+#ifndef RG_FLASH_LOG_H_
+#define RG_FLASH_LOG_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Append-only circular sample log on a raw flash region.
+//
+// The region is split into erase sectors. Each sector starts with a small
+// header carrying a monotonically increasing sequence number, followed by
+// fixed-size CRC-protected records. Records are buffered in RAM and
+// programmed a flash page at a time (or on an explicit flush); when the
+// region is full the oldest sector is erased and reused.
+//
+// This file is the storage engine only. It touches flash solely through
+// rg_flash_log_io_t, so it runs the same on the partition backend and on a
+// host flash emulator. It is not thread safe: one task owns a log instance.
+
+#define RG_FLASH_LOG_RECORD_SIZE 12
+#define RG_FLASH_LOG_HEADER_SIZE 16
+#define RG_FLASH_LOG_PAGE_SIZE 256
+
+// One persisted sample, in the same fixed point units as rg_history.
+typedef struct {
+    uint32_t timestamp;  // Seconds on the history time line
+    int16_t temperature; // 0.01 degC
+    uint16_t humidity;   // 0.01 %RH
+    uint16_t pressure;   // 0.1 hPa
+} rg_flash_log_record_t;
+
+// Raw flash access for the log. Offsets are relative to the start of the region.
+typedef struct {
+    esp_err_t (*read)(void *ctx, size_t offset, void *dst, size_t len);
+    esp_err_t (*write)(void *ctx, size_t offset, const void *src, size_t len);
+    esp_err_t (*erase_sector)(void *ctx, size_t offset);
+    void *ctx;
+    size_t size;        // Region size, a multiple of sector_size
+    size_t sector_size; // Erase granularity, usually 4096
+} rg_flash_log_io_t;
+
+typedef struct {
+    uint32_t records_appended;  // Accepted by rg_flash_log_append()
+    uint32_t records_written;   // Programmed to flash
+    uint32_t program_ops;       // io.write calls
+    uint32_t bytes_programmed;  // Headers + records
+    uint32_t sector_erases;
+    uint32_t records_replayed;  // Valid records found by rg_flash_log_mount()
+    uint32_t records_corrupt;   // Records skipped during replay because of a bad CRC
+} rg_flash_log_stats_t;
+
+typedef struct {
+    rg_flash_log_io_t io;
+    uint32_t sector_count;
+    uint32_t records_per_sector;
+    uint32_t head_sector;   // Sector currently being appended to
+    uint32_t head_seq;      // Its sequence number
+    uint32_t head_records;  // Records already programmed into it
+    uint32_t pending;       // Records buffered in `page`
+    uint8_t page[RG_FLASH_LOG_PAGE_SIZE];
+    rg_flash_log_stats_t stats;
+} rg_flash_log_t;
+
+/**
+ * @brief Called for every valid record found at mount time, oldest first.
+ */
+typedef void (*rg_flash_log_replay_cb_t)(const rg_flash_log_record_t *record, void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Scans the region, replays all valid records through @p cb and positions
+ * the log for appending after the newest one.
+ *
+ * An empty or unformatted region is formatted (first sector erased) on the fly.
+ *
+ * @param cb May be NULL to skip replay.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on a bad geometry, or an io error.
+ */
+esp_err_t rg_flash_log_mount(rg_flash_log_t *log, const rg_flash_log_io_t *io, rg_flash_log_replay_cb_t cb, void *ctx);
+
+/**
+ * @brief Buffers one record; programs a whole page once the buffer is full.
+ */
+esp_err_t rg_flash_log_append(rg_flash_log_t *log, const rg_flash_log_record_t *record);
+
+/**
+ * @brief Programs any buffered records, even if they do not fill a page.
+ */
+esp_err_t rg_flash_log_flush(rg_flash_log_t *log);
+
+/**
+ * @brief Maximum number of records the region holds before the oldest sector is reused.
+ */
+uint32_t rg_flash_log_capacity(const rg_flash_log_t *log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_FLASH_LOG_H_ */
@@ -0,0 +1,154 @@
+// main/services/flash_log/rg_flash_log_task.c
+#include "rg_flash_log_task.h"
+
+#include <math.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "services/log/rg_tlog.h"
+#include "services/rtos/rg_static_alloc.h"
+#include <sdkconfig.h>
+
+#if CONFIG_RG_FLASH_LOG_ENABLE
+
+static const char *TAG = "RG_FLASH_LOG";
+
+static rg_flash_log_t s_log;
+static QueueHandle_t s_queue = NULL;
+RG_QUEUE_STORAGE(s_queue, CONFIG_RG_FLASH_LOG_QUEUE_LEN, sizeof(rg_flash_log_record_t));
+RG_TASK_STORAGE(s_task, 3072);
+static uint32_t s_dropped = 0;
+
+static esp_err_t partition_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, dst, len);
+}
+
+static esp_err_t partition_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, src, len);
+}
+
+static esp_err_t partition_erase_sector(void *ctx, size_t offset)
+{
+    const esp_partition_t *part = (const esp_partition_t *)ctx;
+    return esp_partition_erase_range(part, offset, part->erase_size);
+}
+
+static long clamp(long v, long lo, long hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Owns the log: appends queued samples and flushes a partial page once its oldest
+// record is a flush interval old, so at most that much data is lost on power failure.
+static void flash_log_task(void *pvParameter)
+{
+    const TickType_t flush_ticks = pdMS_TO_TICKS(CONFIG_RG_FLASH_LOG_FLUSH_INTERVAL_S * 1000);
+    TickType_t first_pending = 0; // When the oldest record in the page arrived
+    rg_flash_log_record_t record;
+
+    while (1) {
+        // Steady arrivals must not postpone the flush, so wait only until the deadline
+        TickType_t wait = portMAX_DELAY;
+        if (s_log.pending > 0) {
+            TickType_t age = xTaskGetTickCount() - first_pending;
+            wait = age < flush_ticks ? flush_ticks - age : 0;
+        }
+        if (xQueueReceive(s_queue, &record, wait) == pdTRUE) {
+            if (s_log.pending == 0) {
+                first_pending = xTaskGetTickCount();
+            }
+            esp_err_t err = rg_flash_log_append(&s_log, &record);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write sample log page: %s", esp_err_to_name(err));
+            }
+        }
+        if (s_log.pending > 0 && xTaskGetTickCount() - first_pending >= flush_ticks) {
+            esp_err_t err = rg_flash_log_flush(&s_log);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to flush sample log: %s", esp_err_to_name(err));
+            }
+        }
+    }
+}
+
+esp_err_t rg_flash_log_task_start(rg_flash_log_replay_cb_t cb, void *ctx)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           CONFIG_RG_FLASH_LOG_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGE(TAG, "Partition '%s' not found.", CONFIG_RG_FLASH_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    rg_flash_log_io_t io = {
+        .read = partition_read,
+        .write = partition_write,
+        .erase_sector = partition_erase_sector,
+        .ctx = (void *)part,
+        .size = part->size,
+        .sector_size = part->erase_size,
+    };
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = rg_flash_log_mount(&s_log, &io, cb, ctx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mount sample log: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Replayed %lu samples (%lu corrupt) in %lld ms, capacity %lu.",
+             (unsigned long)s_log.stats.records_replayed, (unsigned long)s_log.stats.records_corrupt,
+             (esp_timer_get_time() - start_us) / 1000, (unsigned long)rg_flash_log_capacity(&s_log));
+
+    s_queue = RG_QUEUE_CREATE(s_queue);
+    if (!s_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Lower priority than the sensor task: flash stalls must never delay sampling
+    if (RG_TASK_CREATE(s_task, flash_log_task, "flash_log", NULL, 2) != pdPASS) {
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool rg_flash_log_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    if (!s_queue) {
+        return false;
+    }
+
+    rg_flash_log_record_t record = {
+        .timestamp = timestamp,
+        .temperature = (int16_t)clamp(lroundf(temperature * 100.0f), INT16_MIN, INT16_MAX),
+        .humidity = (uint16_t)clamp(lroundf(humidity * 100.0f), 0, 10000),
+        .pressure = (uint16_t)clamp(lroundf(pressure * 10.0f), 0, UINT16_MAX),
+    };
+    if (xQueueSend(s_queue, &record, 0) != pdTRUE) {
+        if ((s_dropped++ % 16) == 0) {
+            RG_TLOGW(TAG, "Sample log queue full, %lu samples dropped so far.", (unsigned long)s_dropped);
+        }
+        return false;
+    }
+    return true;
+}
+
+#else // !CONFIG_RG_FLASH_LOG_ENABLE
+
+esp_err_t rg_flash_log_task_start(rg_flash_log_replay_cb_t cb, void *ctx)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool rg_flash_log_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    return false;
+}
+
+#endif // CONFIG_RG_FLASH_LOG_ENABLE
@@ -0,0 +1,38 @@
+// main/services/flash_log/rg_flash_log_task.h
+#ifndef RG_FLASH_LOG_TASK_H_
+#define RG_FLASH_LOG_TASK_H_
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "rg_flash_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mounts the sample log partition, replays it through @p cb and starts
+ * the background writer task.
+ *
+ * Replay happens synchronously in the caller so that consumers are fully
+ * populated before the sensor task starts producing new samples.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing.
+ */
+esp_err_t rg_flash_log_task_start(rg_flash_log_replay_cb_t cb, void *ctx);
+
+/**
+ * @brief Queues one sample for persistence. Never blocks.
+ *
+ * @return false if the writer is not running or its queue is full (sample dropped).
+ */
+bool rg_flash_log_task_submit(uint32_t timestamp, float temperature, float humidity, float pressure);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_FLASH_LOG_TASK_H_ */
@@ -0,0 +1,345 @@
+#include "rg_history.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <type_traits>
+
+#include "esp_timer.h"
+#include <sdkconfig.h>
+
+namespace {
+
+constexpr uint32_t kMinutePeriod = 60;
+constexpr uint32_t kHourPeriod = 3600;
+
+// Compact storage formats; rg_history_record_t is only the reader-facing view.
+struct raw_t {
+    uint32_t timestamp;
+    int16_t temperature;
+    uint16_t humidity;
+    uint16_t pressure;
+    uint16_t reserved;
+};
+
+struct rollup_t {
+    uint32_t timestamp;
+    uint16_t count;
+    int16_t temperature[3];
+    uint16_t humidity[3];
+    uint16_t pressure[3];
+};
+
+constexpr size_t kBudgetBytes = (size_t)CONFIG_RG_HISTORY_RAM_BUDGET_KB * 1024;
+constexpr size_t kRawBytes = kBudgetBytes * CONFIG_RG_HISTORY_RAW_PERCENT / 100;
+constexpr size_t kMinuteBytes = kBudgetBytes * CONFIG_RG_HISTORY_MINUTE_PERCENT / 100;
+static_assert(kRawBytes + kMinuteBytes < kBudgetBytes, "raw + minute shares must leave room for the hour tier");
+constexpr size_t kHourBytes = kBudgetBytes - kRawBytes - kMinuteBytes;
+
+// Ring of fixed-size records with one writer and lock-free readers.
+//
+// `begin_` announces the record about to be written, `head_` publishes it.
+// A reader copies a slot and then checks that the writer has not started to
+// reuse it; payload words are relaxed atomics so the copy is not a data race.
+template <typename T, size_t N>
+class RecordRing {
+    static_assert(std::is_trivially_copyable<T>::value, "record must be trivially copyable");
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "record must be a whole number of words");
+    static_assert(N > 0, "history tier has no room; raise CONFIG_RG_HISTORY_RAM_BUDGET_KB");
+    static constexpr size_t kWords = sizeof(T) / sizeof(uint32_t);
+
+public:
+    using record_type = T;
+    static constexpr size_t capacity = N;
+
+    void push(const T &record)
+    {
+        uint32_t words[kWords];
+        memcpy(words, &record, sizeof(T));
+
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        begin_.store(head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::atomic<uint32_t> *slot = slots_[head % N];
+        for (size_t i = 0; i < kWords; i++) {
+            slot[i].store(words[i], std::memory_order_relaxed);
+        }
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // Number of records ever pushed; valid indices are [max(0, head - N), head).
+    uint32_t head() const { return head_.load(std::memory_order_acquire); }
+
+    // Copies record `index`. Returns false if it has been (or is being) overwritten.
+    bool read(uint32_t index, T *out) const
+    {
+        uint32_t words[kWords];
+        const std::atomic<uint32_t> *slot = slots_[index % N];
+        for (size_t i = 0; i < kWords; i++) {
+            words[i] = slot[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Slot index % N is rewritten once record index + N is announced
+        if (begin_.load(std::memory_order_relaxed) > index + N) {
+            return false;
+        }
+        memcpy(out, words, sizeof(T));
+        return true;
+    }
+
+    void reset()
+    {
+        begin_.store(0, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_release);
+    }
+
+private:
+    std::atomic<uint32_t> begin_{0};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> slots_[N][kWords] = {};
+};
+
+// Writer-private state of the rollup currently being accumulated.
+struct accumulator_t {
+    uint32_t bucket;
+    uint16_t count;
+    int16_t temperature_min, temperature_max;
+    uint16_t humidity_min, humidity_max;
+    uint16_t pressure_min, pressure_max;
+    int64_t temperature_sum;
+    int64_t humidity_sum;
+    int64_t pressure_sum;
+};
+
+RecordRing<raw_t, kRawBytes / sizeof(raw_t)> s_raw;
+RecordRing<rollup_t, kMinuteBytes / sizeof(rollup_t)> s_minute;
+RecordRing<rollup_t, kHourBytes / sizeof(rollup_t)> s_hour;
+static_assert(sizeof(s_raw) + sizeof(s_minute) + sizeof(s_hour) <= kBudgetBytes + 3 * 2 * sizeof(uint32_t),
+              "history tiers exceed CONFIG_RG_HISTORY_RAM_BUDGET_KB");
+
+// Rollups in progress; only the writer touches them
+accumulator_t s_minute_acc;
+accumulator_t s_hour_acc;
+std::atomic<uint32_t> s_time_offset{0};
+
+template <typename T>
+T quantize(float value, float scale, long lo, long hi)
+{
+    long q = lroundf(value * scale);
+    if (q < lo) {
+        q = lo;
+    } else if (q > hi) {
+        q = hi;
+    }
+    return (T)q;
+}
+
+// Integer mean rounded half away from zero
+int64_t mean_of(int64_t sum, uint16_t count)
+{
+    return sum >= 0 ? (sum + count / 2) / count : (sum - count / 2) / count;
+}
+
+rollup_t accumulator_rollup(const accumulator_t &acc)
+{
+    rollup_t r = {};
+    r.timestamp = acc.bucket;
+    r.count = acc.count;
+    r.temperature[RG_HISTORY_MIN] = acc.temperature_min;
+    r.temperature[RG_HISTORY_MAX] = acc.temperature_max;
+    r.temperature[RG_HISTORY_MEAN] = (int16_t)mean_of(acc.temperature_sum, acc.count);
+    r.humidity[RG_HISTORY_MIN] = acc.humidity_min;
+    r.humidity[RG_HISTORY_MAX] = acc.humidity_max;
+    r.humidity[RG_HISTORY_MEAN] = (uint16_t)mean_of(acc.humidity_sum, acc.count);
+    r.pressure[RG_HISTORY_MIN] = acc.pressure_min;
+    r.pressure[RG_HISTORY_MAX] = acc.pressure_max;
+    r.pressure[RG_HISTORY_MEAN] = (uint16_t)mean_of(acc.pressure_sum, acc.count);
+    return r;
+}
+
+// Folds a raw sample into the rollup of its period, pushing the previous
+// rollup to `ring` once a sample of a later period arrives.
+template <typename Ring>
+void accumulate(accumulator_t *acc, uint32_t period, const raw_t &s, Ring *ring)
+{
+    const uint32_t bucket = s.timestamp - s.timestamp % period;
+    if (acc->count > 0 && bucket != acc->bucket) {
+        ring->push(accumulator_rollup(*acc));
+        acc->count = 0;
+    }
+    if (acc->count == 0) {
+        acc->bucket = bucket;
+        acc->temperature_min = acc->temperature_max = s.temperature;
+        acc->humidity_min = acc->humidity_max = s.humidity;
+        acc->pressure_min = acc->pressure_max = s.pressure;
+        acc->temperature_sum = acc->humidity_sum = acc->pressure_sum = 0;
+    }
+    if (acc->count == UINT16_MAX) {
+        return; // Saturated; the extra samples of this period only add noise
+    }
+    acc->count++;
+    if (s.temperature < acc->temperature_min) acc->temperature_min = s.temperature;
+    if (s.temperature > acc->temperature_max) acc->temperature_max = s.temperature;
+    if (s.humidity < acc->humidity_min) acc->humidity_min = s.humidity;
+    if (s.humidity > acc->humidity_max) acc->humidity_max = s.humidity;
+    if (s.pressure < acc->pressure_min) acc->pressure_min = s.pressure;
+    if (s.pressure > acc->pressure_max) acc->pressure_max = s.pressure;
+    acc->temperature_sum += s.temperature;
+    acc->humidity_sum += s.humidity;
+    acc->pressure_sum += s.pressure;
+}
+
+void to_record(const raw_t &s, rg_history_record_t *out)
+{
+    out->timestamp = s.timestamp;
+    out->count = 1;
+    for (int i = 0; i < 3; i++) {
+        out->temperature[i] = s.temperature;
+        out->humidity[i] = s.humidity;
+        out->pressure[i] = s.pressure;
+    }
+}
+
+void to_record(const rollup_t &r, rg_history_record_t *out)
+{
+    out->timestamp = r.timestamp;
+    out->count = r.count;
+    memcpy(out->temperature, r.temperature, sizeof(out->temperature));
+    memcpy(out->humidity, r.humidity, sizeof(out->humidity));
+    memcpy(out->pressure, r.pressure, sizeof(out->pressure));
+}
+
+template <typename Ring>
+size_t query_ring(const Ring &ring, uint32_t from, uint32_t to, rg_history_visit_cb_t cb, void *ctx)
+{
+    size_t visited = 0;
+    uint32_t head = ring.head();
+    uint32_t index = head > Ring::capacity ? head - Ring::capacity : 0;
+
+    while (index < head) {
+        typename Ring::record_type stored;
+        if (!ring.read(index, &stored)) {
+            // Lapped by the writer: jump to the oldest record that is still alive
+            const uint32_t now = ring.head();
+            index = now > Ring::capacity ? now - Ring::capacity + 1 : 0;
+            head = now;
+            continue;
+        }
+        index++;
+        if (stored.timestamp < from) {
+            continue;
+        }
+        if (stored.timestamp > to) {
+            break;
+        }
+        rg_history_record_t record;
+        to_record(stored, &record);
+        visited++;
+        if (!cb(&record, ctx)) {
+            break;
+        }
+    }
+    return visited;
+}
+
+} // namespace
+
+void rg_history_add(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    rg_history_add_fixed(timestamp, quantize<int16_t>(temperature, 100.0f, INT16_MIN, INT16_MAX),
+                         quantize<uint16_t>(humidity, 100.0f, 0, 10000),
+                         quantize<uint16_t>(pressure, 10.0f, 0, UINT16_MAX));
+}
+
+void rg_history_add_fixed(uint32_t timestamp, int16_t temperature, uint16_t humidity, uint16_t pressure)
+{
+    raw_t s = {};
+    s.timestamp = timestamp;
+    s.temperature = temperature;
+    s.humidity = humidity;
+    s.pressure = pressure;
+
+    s_raw.push(s);
+    accumulate(&s_minute_acc, kMinutePeriod, s, &s_minute);
+    accumulate(&s_hour_acc, kHourPeriod, s, &s_hour);
+}
+
+size_t rg_history_query(rg_history_tier_t tier, uint32_t from, uint32_t to, rg_history_visit_cb_t cb, void *ctx)
+{
+    if (!cb || from > to) {
+        return 0;
+    }
+    switch (tier) {
+    case RG_HISTORY_TIER_RAW:
+        return query_ring(s_raw, from, to, cb, ctx);
+    case RG_HISTORY_TIER_MINUTE:
+        return query_ring(s_minute, from, to, cb, ctx);
+    case RG_HISTORY_TIER_HOUR:
+        return query_ring(s_hour, from, to, cb, ctx);
+    default:
+        return 0;
+    }
+}
+
+size_t rg_history_capacity(rg_history_tier_t tier)
+{
+    switch (tier) {
+    case RG_HISTORY_TIER_RAW:
+        return s_raw.capacity;
+    case RG_HISTORY_TIER_MINUTE:
+        return s_minute.capacity;
+    case RG_HISTORY_TIER_HOUR:
+        return s_hour.capacity;
+    default:
+        return 0;
+    }
+}
+
+uint32_t rg_history_period(rg_history_tier_t tier)
+{
+    switch (tier) {
+    case RG_HISTORY_TIER_MINUTE:
+        return kMinutePeriod;
+    case RG_HISTORY_TIER_HOUR:
+        return kHourPeriod;
+    default:
+        return 0;
+    }
+}
+
+uint32_t rg_history_now(void)
+{
+    return s_time_offset.load(std::memory_order_relaxed) + (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+void rg_history_set_time_offset(uint32_t offset)
+{
+    s_time_offset.store(offset, std::memory_order_relaxed);
+}
+
+static const char *const s_tier_names[RG_HISTORY_TIER_COUNT] = {"raw", "minute", "hour"};
+
+bool rg_history_tier_from_name(const char *name, rg_history_tier_t *tier)
+{
+    for (int i = 0; name && i < RG_HISTORY_TIER_COUNT; i++) {
+        if (strcmp(name, s_tier_names[i]) == 0) {
+            *tier = (rg_history_tier_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *rg_history_tier_name(rg_history_tier_t tier)
+{
+    return (unsigned)tier < RG_HISTORY_TIER_COUNT ? s_tier_names[tier] : "unknown";
+}
+
+void rg_history_reset(void)
+{
+    s_raw.reset();
+    s_minute.reset();
+    s_hour.reset();
+    memset(&s_minute_acc, 0, sizeof(s_minute_acc));
+    memset(&s_hour_acc, 0, sizeof(s_hour_acc));
+}
@@ -0,0 +1,123 @@
+// main/services/history/rg_history.h
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-footprint, tiered time-series store for sensor samples.
+//
+// Raw samples are kept as-is; the 1-minute and 1-hour tiers keep min, max and
+// mean per channel. All storage is static and sized from
+// CONFIG_RG_HISTORY_RAM_BUDGET_KB. There is a single writer: the boot replay
+// of the flash log, then the event bus "log" consumer task (ev_log), which
+// only starts receiving readings once the replay is done. Any number of
+// readers can query concurrently without blocking it.
+//
+// Values are stored in fixed point: temperature in 0.01 degC, humidity in
+// 0.01 %RH and pressure in 0.1 hPa. Timestamps are in seconds.
+
+typedef enum {
+    RG_HISTORY_TIER_RAW = 0,
+    RG_HISTORY_TIER_MINUTE,
+    RG_HISTORY_TIER_HOUR,
+    RG_HISTORY_TIER_COUNT,
+} rg_history_tier_t;
+
+// Index into the min/max/mean arrays of rg_history_record_t
+enum {
+    RG_HISTORY_MIN = 0,
+    RG_HISTORY_MAX,
+    RG_HISTORY_MEAN,
+};
+
+// Uniform view of one stored record. For the raw tier count is 1 and
+// min == max == mean.
+typedef struct {
+    uint32_t timestamp;      // Sample time, or start of the rollup period
+    uint16_t count;          // Number of raw samples folded into this record
+    int16_t temperature[3];  // 0.01 degC
+    uint16_t humidity[3];    // 0.01 %RH
+    uint16_t pressure[3];    // 0.1 hPa
+} rg_history_record_t;
+
+/**
+ * @brief Called for every record matched by rg_history_query(), oldest first.
+ *
+ * @return false to stop the iteration early.
+ */
+typedef bool (*rg_history_visit_cb_t)(const rg_history_record_t *record, void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Appends one sample to the raw tier and folds it into the rollup tiers.
+ *
+ * Must only be called from the writer (see above). Never blocks.
+ *
+ * @param timestamp Sample time in seconds. Must not go backwards.
+ */
+void rg_history_add(uint32_t timestamp, float temperature, float humidity, float pressure);
+
+/**
+ * @brief Same as rg_history_add() for values already in the history's fixed point units.
+ *
+ * Used to replay persisted samples at boot.
+ */
+void rg_history_add_fixed(uint32_t timestamp, int16_t temperature, uint16_t humidity, uint16_t pressure);
+
+/**
+ * @brief Current time on the history time line in seconds.
+ *
+ * This is the uptime plus the offset set with rg_history_set_time_offset(), so
+ * timestamps keep increasing across reboots once persisted samples are replayed.
+ */
+uint32_t rg_history_now(void);
+
+/**
+ * @brief Sets the offset added to the uptime by rg_history_now().
+ */
+void rg_history_set_time_offset(uint32_t offset);
+
+/**
+ * @brief Visits the stored records of @p tier with from <= timestamp <= to.
+ *
+ * Records that the writer overwrites while the query is running are skipped,
+ * never returned torn.
+ *
+ * @return Number of records passed to @p cb.
+ */
+size_t rg_history_query(rg_history_tier_t tier, uint32_t from, uint32_t to, rg_history_visit_cb_t cb, void *ctx);
+
+/**
+ * @brief Maximum number of records the tier can hold.
+ */
+size_t rg_history_capacity(rg_history_tier_t tier);
+
+/**
+ * @brief Period covered by one record of the tier in seconds (0 for the raw tier).
+ */
+uint32_t rg_history_period(rg_history_tier_t tier);
+
+/**
+ * @brief Parses "raw", "minute" or "hour".
+ *
+ * @return true if @p name is a known tier.
+ */
+bool rg_history_tier_from_name(const char *name, rg_history_tier_t *tier);
+
+/**
+ * @brief Name of the tier as accepted by rg_history_tier_from_name().
+ */
+const char *rg_history_tier_name(rg_history_tier_t tier);
+
+/**
+ * @brief Drops all stored records and rollups in progress. Not thread safe; for init and tests.
+ */
+void rg_history_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,151 @@
+// main/services/http/rg_http_query.c
+#include "rg_http_query.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Decodes s[0, len) onto itself and terminates it; false on a bad escape
+static bool decode(char *s, size_t len)
+{
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '+') {
+            s[out++] = ' ';
+        } else if (s[i] == '%') {
+            if (i + 2 >= len) {
+                return false;
+            }
+            int hi = hex_digit(s[i + 1]);
+            int lo = hex_digit(s[i + 2]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            s[out++] = (char)(hi << 4 | lo);
+            i += 2;
+        } else {
+            s[out++] = s[i];
+        }
+    }
+    s[out] = '\0';
+    return true;
+}
+
+esp_err_t rg_http_query_parse(rg_http_query_t *query, const char *uri)
+{
+    query->count = 0;
+    query->buf[0] = '\0';
+    const char *q = strchr(uri, '?');
+    if (!q || q[1] == '\0') {
+        return ESP_OK;
+    }
+    size_t len = strlen(++q);
+    if (len >= sizeof(query->buf)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(query->buf, q, len + 1);
+
+    char *p = query->buf;
+    while (*p) {
+        char *end = strchr(p, '&');
+        size_t pair_len = end ? (size_t)(end - p) : strlen(p);
+        if (pair_len > 0) {
+            if (query->count == RG_HTTP_QUERY_MAX_PARAMS) {
+                query->count = 0;
+                return ESP_ERR_INVALID_SIZE;
+            }
+            char *eq = memchr(p, '=', pair_len);
+            size_t key_len = eq ? (size_t)(eq - p) : pair_len;
+            char *value = eq ? eq + 1 : p + pair_len;
+            size_t value_len = eq ? pair_len - key_len - 1 : 0;
+            // Both decode in place and only shrink, so the terminators cannot overrun the next pair
+            if (!decode(p, key_len) || !decode(value, value_len)) {
+                query->count = 0;
+                return ESP_ERR_INVALID_ARG;
+            }
+            query->keys[query->count] = p;
+            query->values[query->count] = eq ? value : "";
+            query->count++;
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_http_form_parse(char *body, rg_http_form_field_t field, void *ctx)
+{
+    char *p = body;
+    while (*p) {
+        char *end = strchr(p, '&');
+        size_t pair_len = end ? (size_t)(end - p) : strlen(p);
+        if (end) {
+            *end = '\0';
+        }
+        if (pair_len > 0) {
+            char *eq = memchr(p, '=', pair_len);
+            size_t key_len = eq ? (size_t)(eq - p) : pair_len;
+            char *value = eq ? eq + 1 : p + pair_len;
+            if (!decode(p, key_len) || !decode(value, eq ? pair_len - key_len - 1 : 0)) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            esp_err_t err = field(ctx, p, value);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    return ESP_OK;
+}
+
+const char *rg_http_query_get(const rg_http_query_t *query, const char *key)
+{
+    for (uint8_t i = 0; i < query->count; i++) {
+        if (strcmp(query->keys[i], key) == 0) {
+            return query->values[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t rg_http_query_get_u32(const rg_http_query_t *query, const char *key, uint32_t *out)
+{
+    const char *value = rg_http_query_get(query, key);
+    if (!value) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (*value == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint64_t n = 0;
+    for (const char *p = value; *p; p++) {
+        if (*p < '0' || *p > '9') {
+            return ESP_ERR_INVALID_ARG;
+        }
+        n = n * 10 + (uint64_t)(*p - '0');
+        if (n > UINT32_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    *out = (uint32_t)n;
+    return ESP_OK;
+}
@@ -0,0 +1,73 @@
+// main/services/http/rg_http_query.h
+#ifndef RG_HTTP_QUERY_H_
+#define RG_HTTP_QUERY_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// The query string of a request, split once into decoded key/value pairs.
+//
+// The router parses it before calling a route's handler, so handlers look
+// parameters up by name instead of rescanning the URI for each one. Keys
+// and values are percent-decoded ('+' is a space) in place in a fixed
+// buffer; nothing is allocated.
+
+#define RG_HTTP_QUERY_MAX_LEN 128
+#define RG_HTTP_QUERY_MAX_PARAMS 8
+
+typedef struct {
+    char buf[RG_HTTP_QUERY_MAX_LEN];
+    uint8_t count;
+    const char *keys[RG_HTTP_QUERY_MAX_PARAMS];
+    const char *values[RG_HTTP_QUERY_MAX_PARAMS]; // "" for a key without '='
+} rg_http_query_t;
+
+// Called for each key/value pair of a form body; an error stops the parse and is returned
+typedef esp_err_t (*rg_http_form_field_t)(void *ctx, const char *key, const char *value);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parses the query string of @p uri (the part after '?'; none is an empty query).
+ *
+ * @return ESP_ERR_INVALID_SIZE if the query is longer than RG_HTTP_QUERY_MAX_LEN - 1
+ * or has more than RG_HTTP_QUERY_MAX_PARAMS parameters, ESP_ERR_INVALID_ARG for a
+ * malformed percent escape. @p query is empty after an error.
+ */
+esp_err_t rg_http_query_parse(rg_http_query_t *query, const char *uri);
+
+/**
+ * @brief Value of the first parameter named @p key, or NULL if there is none.
+ */
+const char *rg_http_query_get(const rg_http_query_t *query, const char *key);
+
+/**
+ * @brief Reads parameter @p key as a decimal uint32_t.
+ *
+ * @return ESP_ERR_NOT_FOUND if it is absent (@p out untouched), ESP_ERR_INVALID_ARG if
+ * it is not a number in range.
+ */
+esp_err_t rg_http_query_get_u32(const rg_http_query_t *query, const char *key, uint32_t *out);
+
+/**
+ * @brief Splits an application/x-www-form-urlencoded @p body, decoding it in place.
+ *
+ * Pairs are passed to @p field in order, as rg_http_query_parse() splits a
+ * query string but without its size limits.
+ *
+ * @return ESP_ERR_INVALID_ARG for a malformed percent escape (pairs before it
+ * were already passed), or the first error @p field returned.
+ */
+esp_err_t rg_http_form_parse(char *body, rg_http_form_field_t field, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_HTTP_QUERY_H_ */
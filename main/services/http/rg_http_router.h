@@ -0,0 +1,160 @@
+// main/services/http/rg_http_router.h
+#ifndef RG_HTTP_ROUTER_H_
+#define RG_HTTP_ROUTER_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_http_server.h"
+#include "rg_http_query.h"
+#include "services/metrics/rg_metrics.h"
+
+// Route table resolved at compile time.
+//
+// Routes are a constexpr array of exact paths. The router picks, at compile
+// time, a seed for which the FNV-1a hashes of all paths land in distinct
+// slots of a table twice the size of the route count, so a lookup is one
+// hash of the request path plus one string compare, whatever the number of
+// routes. A duplicate path makes the seed search fail, which the route file
+// turns into a compile error with static_assert(router.ok()).
+//
+//   static constexpr rg_http_route_t s_routes[] = {
+//       {"/data", RG_HTTP_GET, send_data, &s_data_latency},
+//   };
+//   static constexpr rg_http_router<1> s_router(s_routes);
+//   static_assert(s_router.ok(), "route paths must be distinct");
+//
+// Each route names the methods it accepts; the dispatcher answers others
+// with 405 and an Allow header, and hands the handler the parsed query.
+
+// Bit for an http_parser method (HTTP_GET, HTTP_POST, ...) in rg_http_route_t::methods
+#define RG_HTTP_METHOD(method) (1u << (method))
+#define RG_HTTP_GET RG_HTTP_METHOD(HTTP_GET)
+#define RG_HTTP_POST RG_HTTP_METHOD(HTTP_POST)
+
+typedef esp_err_t (*rg_http_handler_t)(httpd_req_t *req, const rg_http_query_t *query);
+
+typedef struct {
+    const char *path;                // Exact path, without the query string
+    uint32_t methods;                // RG_HTTP_GET, RG_HTTP_POST, ...
+    rg_http_handler_t handler;
+    rg_metrics_histogram_t *latency; // Handler time, or NULL
+} rg_http_route_t;
+
+namespace rg_http {
+
+constexpr size_t path_length(const char *s)
+{
+    size_t n = 0;
+    while (s[n] != '\0') {
+        n++;
+    }
+    return n;
+}
+
+constexpr uint32_t path_hash(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Length of the path part of a URI: up to the query string
+inline size_t uri_path_length(const char *uri)
+{
+    const char *q = strchr(uri, '?');
+    return q ? (size_t)(q - uri) : strlen(uri);
+}
+
+// "GET, POST" for the Allow header of a 405
+inline void allow_header(uint32_t methods, char *out, size_t size)
+{
+    static const struct {
+        int method;
+        const char *name;
+    } names[] = {
+        {HTTP_GET, "GET"}, {HTTP_HEAD, "HEAD"}, {HTTP_POST, "POST"}, {HTTP_PUT, "PUT"}, {HTTP_DELETE, "DELETE"},
+    };
+    size_t len = 0;
+    out[0] = '\0';
+    for (const auto &n : names) {
+        if ((methods & RG_HTTP_METHOD(n.method)) && len < size) {
+            len += snprintf(out + len, size - len, "%s%s", len ? ", " : "", n.name);
+        }
+    }
+}
+
+} // namespace rg_http
+
+template <size_t N> class rg_http_router {
+public:
+    static_assert(N > 0 && N < 128, "route count out of range");
+
+    // Slots as a power of two: at least twice the routes
+    static constexpr unsigned SLOT_BITS =
+        N <= 2 ? 2 : N <= 4 ? 3 : N <= 8 ? 4 : N <= 16 ? 5 : N <= 32 ? 6 : N <= 64 ? 7 : 8;
+    static constexpr size_t SLOTS = (size_t)1 << SLOT_BITS;
+    static constexpr uint8_t EMPTY = 0xFF;
+
+    constexpr explicit rg_http_router(const rg_http_route_t (&routes)[N]) : routes_(routes), seed_(0), slots_()
+    {
+        for (uint32_t seed = 1; seed <= MAX_SEED && seed_ == 0; seed++) {
+            if (place(seed)) {
+                seed_ = seed;
+            }
+        }
+    }
+
+    // False if no seed separates the paths (a path is listed twice)
+    constexpr bool ok() const { return seed_ != 0; }
+
+    // The route for the path part of @p uri, or NULL
+    const rg_http_route_t *find(const char *uri) const { return find(uri, rg_http::uri_path_length(uri)); }
+
+    const rg_http_route_t *find(const char *path, size_t len) const
+    {
+        uint8_t index = slots_[slot_of(rg_http::path_hash(path, len, seed_))];
+        if (index == EMPTY) {
+            return nullptr;
+        }
+        const rg_http_route_t *route = &routes_[index];
+        return strncmp(route->path, path, len) == 0 && route->path[len] == '\0' ? route : nullptr;
+    }
+
+    constexpr size_t size() const { return N; }
+    constexpr const rg_http_route_t &operator[](size_t i) const { return routes_[i]; }
+
+private:
+    static constexpr uint32_t MAX_SEED = 4096;
+
+    // The top bits: FNV-1a's low bits only depend on the low bits of the input
+    static constexpr size_t slot_of(uint32_t hash) { return hash >> (32 - SLOT_BITS); }
+
+    constexpr bool place(uint32_t seed)
+    {
+        for (size_t i = 0; i < SLOTS; i++) {
+            slots_[i] = EMPTY;
+        }
+        for (size_t i = 0; i < N; i++) {
+            const char *path = routes_[i].path;
+            size_t slot = slot_of(rg_http::path_hash(path, rg_http::path_length(path), seed));
+            if (slots_[slot] != EMPTY) {
+                return false;
+            }
+            slots_[slot] = (uint8_t)i;
+        }
+        return true;
+    }
+
+    const rg_http_route_t *routes_;
+    uint32_t seed_;
+    uint8_t slots_[SLOTS];
+};
+
+#endif /* RG_HTTP_ROUTER_H_ */
@@ -0,0 +1,193 @@
+// main/services/json/rg_json_writer.h
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_err.h"
+// Only for nlohmann::detail::to_chars, the (allocation-free) float formatter
+// nlohmann::json::dump() uses, so numbers come out byte-identical.
+#include <nlohmann/json.hpp>
+
+// Allocation-free JSON writer over a caller-provided buffer.
+//
+// Without a sink the whole document must fit the buffer (check ok()). With a
+// sink, e.g. httpd_resp_send_chunk, the buffer is handed to the sink whenever
+// it fills up, so documents of any size stream through a fixed buffer.
+//
+// Output matches nlohmann::json::dump() with default arguments for the same
+// sequence of values: doubles use nlohmann's shortest round-trip formatting
+// (non-finite as null) and strings get the same escaping. Keys are written
+// in call order, so callers emit them sorted to mirror nlohmann's std::map.
+class rg_json_writer {
+public:
+    typedef esp_err_t (*sink_t)(void *ctx, const char *data, size_t len);
+
+    rg_json_writer(char *buf, size_t size, sink_t sink = nullptr, void *ctx = nullptr)
+        : buf_(buf), size_(size), sink_(sink), ctx_(ctx)
+    {
+    }
+
+    void begin_object() { open('{'); }
+    void end_object() { close('}'); }
+    void begin_array() { open('['); }
+    void end_array() { close(']'); }
+
+    void key(const char *name)
+    {
+        separator();
+        string(name);
+        put(':');
+        after_key_ = true;
+    }
+
+    void value(const char *s)
+    {
+        separator();
+        string(s ? s : "");
+    }
+
+    void value(double v)
+    {
+        separator();
+        if (!isfinite(v)) {
+            write("null", 4);
+            return;
+        }
+        char number[64];
+        char *end = nlohmann::detail::to_chars(number, number + sizeof(number), v);
+        write(number, (size_t)(end - number));
+    }
+
+    void value(int64_t v)
+    {
+        separator();
+        char number[24];
+        int n = snprintf(number, sizeof(number), "%lld", (long long)v);
+        write(number, (size_t)n);
+    }
+
+    void value(int32_t v) { value((int64_t)v); }
+    void value(uint32_t v) { value((int64_t)v); }
+
+    void value(bool v)
+    {
+        separator();
+        if (v) {
+            write("true", 4);
+        } else {
+            write("false", 5);
+        }
+    }
+
+    // Hands buffered output to the sink. Without a sink this is a no-op.
+    bool flush()
+    {
+        if (sink_ && len_ > 0 && err_ == ESP_OK) {
+            err_ = sink_(ctx_, buf_, len_);
+            len_ = 0;
+        }
+        return err_ == ESP_OK;
+    }
+
+    bool ok() const { return err_ == ESP_OK; }
+    esp_err_t error() const { return err_; }
+    const char *data() const { return buf_; }
+    size_t size() const { return len_; }
+
+private:
+    void open(char c)
+    {
+        separator();
+        put(c);
+        if (depth_ < 32) {
+            has_items_ &= ~(1u << depth_);
+        }
+        depth_++;
+    }
+
+    void close(char c)
+    {
+        if (depth_ > 0) {
+            depth_--;
+        }
+        put(c);
+    }
+
+    // Comma between siblings; nothing right after a key
+    void separator()
+    {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ == 0 || depth_ > 32) {
+            return;
+        }
+        const uint32_t bit = 1u << (depth_ - 1);
+        if (has_items_ & bit) {
+            put(',');
+        }
+        has_items_ |= bit;
+    }
+
+    void string(const char *s)
+    {
+        put('"');
+        for (; *s; s++) {
+            const unsigned char c = (unsigned char)*s;
+            switch (c) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    char esc[7];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    write(esc, 6);
+                } else {
+                    put((char)c); // UTF-8 passes through like nlohmann's ensure_ascii=false
+                }
+                break;
+            }
+        }
+        put('"');
+    }
+
+    void put(char c) { write(&c, 1); }
+
+    void write(const char *data, size_t len)
+    {
+        while (len > 0 && err_ == ESP_OK) {
+            if (len_ == size_) {
+                if (!sink_) {
+                    err_ = ESP_ERR_NO_MEM;
+                    return;
+                }
+                flush();
+                continue;
+            }
+            size_t n = size_ - len_ < len ? size_ - len_ : len;
+            memcpy(buf_ + len_, data, n);
+            len_ += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    char *buf_;
+    size_t size_;
+    size_t len_ = 0;
+    sink_t sink_;
+    void *ctx_;
+    esp_err_t err_ = ESP_OK;
+    uint32_t depth_ = 0;
+    uint32_t has_items_ = 0;
+    bool after_key_ = false;
+};
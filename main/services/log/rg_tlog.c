@@ -0,0 +1,418 @@
+// main/services/log/rg_tlog.c
+#include "rg_tlog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#define HEADER_SIZE (2 * sizeof(uint32_t) + 2 * sizeof(uintptr_t))
+
+// --- Format strings ---------------------------------------------------------
+
+typedef enum {
+    ARG_NONE,   // %%, %n
+    ARG_INT,    // 4 bytes
+    ARG_INT64,  // 8 bytes
+    ARG_FLOAT,  // 4 bytes
+    ARG_STRING, // Length byte and bytes
+    ARG_POINTER,
+} arg_kind_t;
+
+typedef struct {
+    const char *start; // The '%'
+    const char *end;   // Past the conversion character
+    int stars;         // '*' width and precision, each an int argument first
+    char length;       // 0, 'l' (also z, t), 'q' (ll, j) or 'L'
+    char conversion;
+    arg_kind_t kind;
+} spec_t;
+
+// Next conversion in @p p, or false at the end of the format
+static bool next_spec(const char *p, spec_t *spec)
+{
+    p = strchr(p, '%');
+    if (!p) {
+        return false;
+    }
+    memset(spec, 0, sizeof(*spec));
+    spec->start = p++;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    for (int part = 0; part < 2; part++) { // Width, then precision
+        if (part == 1) {
+            if (*p != '.') {
+                break;
+            }
+            p++;
+        }
+        if (*p == '*') {
+            spec->stars++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if ((p[0] == 'l' && p[1] == 'l') || (p[0] == 'h' && p[1] == 'h')) {
+        spec->length = p[0] == 'l' ? 'q' : 0;
+        p += 2;
+    } else if (*p && strchr("hlzjtL", *p)) {
+        spec->length = *p == 'j' ? 'q' : *p == 'h' ? 0 : *p == 'L' ? 'L' : 'l';
+        p++;
+    }
+    spec->conversion = *p;
+    spec->end = *p ? p + 1 : p;
+    switch (*p) {
+    case 'd': case 'i': case 'c': case 'u': case 'o': case 'x': case 'X':
+        spec->kind = spec->length == 'q' ? ARG_INT64 : ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->kind = ARG_FLOAT;
+        break;
+    case 's':
+        spec->kind = ARG_STRING;
+        break;
+    case 'p':
+        spec->kind = ARG_POINTER;
+        break;
+    default:
+        spec->kind = ARG_NONE;
+        break;
+    }
+    return true;
+}
+
+// --- Encoding ---------------------------------------------------------------
+
+// Appends the arguments of @p format to out[n..size); returns the new length
+static size_t encode_args(uint8_t *out, size_t n, size_t size, const char *format, va_list args)
+{
+    spec_t spec;
+    for (const char *p = format; next_spec(p, &spec); p = spec.end) {
+        for (int i = 0; i < spec.stars; i++) {
+            int32_t star = va_arg(args, int);
+            if (n + sizeof(star) <= size) {
+                memcpy(out + n, &star, sizeof(star));
+                n += sizeof(star);
+            }
+        }
+        // Every argument is consumed even if it no longer fits, to keep va_arg in step
+        switch (spec.kind) {
+        case ARG_INT: {
+            int32_t v = spec.length == 'l' ? (int32_t)va_arg(args, long) : (int32_t)va_arg(args, int);
+            if (n + sizeof(v) <= size) {
+                memcpy(out + n, &v, sizeof(v));
+                n += sizeof(v);
+            }
+            break;
+        }
+        case ARG_INT64: {
+            int64_t v = va_arg(args, long long);
+            if (n + sizeof(v) <= size) {
+                memcpy(out + n, &v, sizeof(v));
+                n += sizeof(v);
+            }
+            break;
+        }
+        case ARG_FLOAT: {
+            float v = spec.length == 'L' ? (float)va_arg(args, long double) : (float)va_arg(args, double);
+            if (n + sizeof(v) <= size) {
+                memcpy(out + n, &v, sizeof(v));
+                n += sizeof(v);
+            }
+            break;
+        }
+        case ARG_STRING: {
+            const char *s = va_arg(args, const char *);
+            if (!s) {
+                s = "(null)";
+            }
+            size_t len = strnlen(s, RG_TLOG_MAX_STRING);
+            if (n + 1 < size) {
+                len = len < size - n - 1 ? len : size - n - 1;
+                out[n++] = (uint8_t)len;
+                memcpy(out + n, s, len);
+                n += len;
+            }
+            break;
+        }
+        case ARG_POINTER: {
+            uintptr_t v = (uintptr_t)va_arg(args, void *);
+            if (n + sizeof(v) <= size) {
+                memcpy(out + n, &v, sizeof(v));
+                n += sizeof(v);
+            }
+            break;
+        }
+        case ARG_NONE:
+            if (spec.conversion == 'n') {
+                (void)va_arg(args, void *);
+            }
+            break;
+        }
+    }
+    return n;
+}
+
+// --- Ring -------------------------------------------------------------------
+
+esp_err_t rg_tlog_ring_init(rg_tlog_ring_t *ring, uint8_t *buf, uint32_t size)
+{
+    if (!buf || ((uintptr_t)buf & 3) || size < 2 * RG_TLOG_MAX_RECORD || (size & (size - 1))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(ring, 0, sizeof(*ring));
+    memset(buf, 0, size);
+    ring->buf = buf;
+    ring->size = size;
+    return ESP_OK;
+}
+
+bool rg_tlog_ring_vwrite(rg_tlog_ring_t *ring, esp_log_level_t level, uint32_t time_ms, const char *tag,
+                         const char *format, va_list args)
+{
+    uint32_t record[RG_TLOG_MAX_RECORD / sizeof(uint32_t)];
+    uint8_t *bytes = (uint8_t *)record;
+    const uintptr_t format_addr = (uintptr_t)format;
+    const uintptr_t tag_addr = (uintptr_t)tag;
+    memcpy(bytes + 4, &time_ms, sizeof(time_ms));
+    memcpy(bytes + 8, &format_addr, sizeof(format_addr));
+    memcpy(bytes + 8 + sizeof(uintptr_t), &tag_addr, sizeof(tag_addr));
+    const size_t n = encode_args(bytes, HEADER_SIZE, sizeof(record), format, args);
+    const uint32_t len = (uint32_t)((n + 3) & ~(size_t)3);
+    if (len > n) {
+        memset(bytes + n, 0, len - n);
+    }
+
+    // Reserve: nobody else can write there, and the reader stops at our header until we commit
+    uint32_t start = __atomic_load_n(&ring->reserved, __ATOMIC_RELAXED);
+    uint32_t used;
+    do {
+        used = start + len - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (used > ring->size) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->reserved, &start, start + len, true, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+
+    const uint32_t mask = ring->size - 1;
+    for (uint32_t i = 1; i < len / 4; i++) {
+        *(uint32_t *)(ring->buf + ((start + i * 4) & mask)) = record[i];
+    }
+    __atomic_store_n((uint32_t *)(ring->buf + (start & mask)), RG_TLOG_COMMITTED | (uint32_t)level << 24 | len,
+                     __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&ring->records, 1, __ATOMIC_RELAXED);
+    uint32_t high = __atomic_load_n(&ring->high_water, __ATOMIC_RELAXED);
+    while (used > high &&
+           !__atomic_compare_exchange_n(&ring->high_water, &high, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return true;
+}
+
+size_t rg_tlog_ring_read(rg_tlog_ring_t *ring, uint8_t *out, size_t size)
+{
+    const uint32_t mask = ring->size - 1;
+    const uint32_t tail = ring->tail;
+    uint32_t *head_word = (uint32_t *)(ring->buf + (tail & mask));
+    const uint32_t header = __atomic_load_n(head_word, __ATOMIC_ACQUIRE);
+    const uint32_t len = header & 0xffff;
+    if (!(header & RG_TLOG_COMMITTED) || len > size) {
+        return 0;
+    }
+    // Copy out, then zero, so a later lap never mistakes old bytes for a committed header
+    for (uint32_t i = 0; i < len; i += 4) {
+        uint32_t *word = (uint32_t *)(ring->buf + ((tail + i) & mask));
+        memcpy(out + i, word, 4);
+        *word = 0;
+    }
+    __atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+    return len;
+}
+
+esp_err_t rg_tlog_parse(const uint8_t *record, size_t len, rg_tlog_record_t *out)
+{
+    uint32_t header;
+    if (len < HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&header, record, sizeof(header));
+    if (!(header & RG_TLOG_COMMITTED) || (header & 0xffff) != len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uintptr_t format_addr;
+    uintptr_t tag_addr;
+    out->level = (esp_log_level_t)((header >> 24) & 0x7);
+    memcpy(&out->time_ms, record + 4, sizeof(out->time_ms));
+    memcpy(&format_addr, record + 8, sizeof(format_addr));
+    memcpy(&tag_addr, record + 8 + sizeof(uintptr_t), sizeof(tag_addr));
+    out->format = (const char *)format_addr;
+    out->tag = (const char *)tag_addr;
+    out->args = record + HEADER_SIZE;
+    out->args_len = len - HEADER_SIZE;
+    return ESP_OK;
+}
+
+// --- Formatting -------------------------------------------------------------
+
+typedef struct {
+    char *out;
+    size_t size;
+    size_t len;
+} text_t;
+
+static void append(text_t *text, const char *data, size_t n)
+{
+    if (text->len + 1 >= text->size) {
+        return;
+    }
+    n = n < text->size - 1 - text->len ? n : text->size - 1 - text->len;
+    memcpy(text->out + text->len, data, n);
+    text->len += n;
+    text->out[text->len] = '\0';
+}
+
+static void append_printed(text_t *text, int printed)
+{
+    if (printed > 0) {
+        text->len += (size_t)printed < text->size - text->len ? (size_t)printed : text->size - 1 - text->len;
+    }
+}
+
+// snprintf of one conversion, with its '*' arguments first
+#define PRINT_SPEC(text, fmt, stars, star, value)                                                           \
+    append_printed((text), (stars) == 0 ? snprintf((text)->out + (text)->len, (text)->size - (text)->len,  \
+                                                   (fmt), (value))                                          \
+                           : (stars) == 1 ? snprintf((text)->out + (text)->len, (text)->size - (text)->len, \
+                                                     (fmt), (star)[0], (value))                             \
+                                          : snprintf((text)->out + (text)->len, (text)->size - (text)->len, \
+                                                     (fmt), (star)[0], (star)[1], (value)))
+
+static bool take(const uint8_t **p, const uint8_t *end, void *out, size_t n)
+{
+    if ((size_t)(end - *p) < n) {
+        return false;
+    }
+    memcpy(out, *p, n);
+    *p += n;
+    return true;
+}
+
+size_t rg_tlog_format(const rg_tlog_record_t *record, char *out, size_t size)
+{
+    static const char letters[] = "NEWIDV";
+    text_t text = {.out = out, .size = size, .len = 0};
+    if (size == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    append_printed(&text, snprintf(out, size, "%c (%lu) %s: ", letters[record->level % 6],
+                                   (unsigned long)record->time_ms, record->tag));
+
+    const uint8_t *arg = record->args;
+    const uint8_t *end = record->args + record->args_len;
+    const char *p = record->format;
+    spec_t spec;
+    while (next_spec(p, &spec)) {
+        append(&text, p, (size_t)(spec.start - p));
+        p = spec.end;
+
+        int star[2] = {0, 0};
+        bool ok = true;
+        for (int i = 0; i < spec.stars; i++) {
+            int32_t v = 0;
+            ok = ok && take(&arg, end, &v, sizeof(v));
+            star[i] = v;
+        }
+        // The conversion again without its length modifier, which the stored size replaces
+        char fmt[24];
+        size_t f = 0;
+        for (const char *c = spec.start; c < spec.end - 1 && f < sizeof(fmt) - 4; c++) {
+            if (!strchr("hlzjtL", *c)) {
+                fmt[f++] = *c;
+            }
+        }
+        if (spec.kind == ARG_INT64) {
+            fmt[f++] = 'l';
+            fmt[f++] = 'l';
+        }
+        fmt[f++] = spec.conversion;
+        fmt[f] = '\0';
+
+        switch (spec.kind) {
+        case ARG_NONE:
+            if (spec.conversion == '%') {
+                append(&text, "%", 1);
+            }
+            break;
+        case ARG_INT: {
+            int32_t v;
+            if ((ok = ok && take(&arg, end, &v, sizeof(v)))) {
+                PRINT_SPEC(&text, fmt, spec.stars, star, (int)v);
+            }
+            break;
+        }
+        case ARG_INT64: {
+            int64_t v;
+            if ((ok = ok && take(&arg, end, &v, sizeof(v)))) {
+                PRINT_SPEC(&text, fmt, spec.stars, star, (long long)v);
+            }
+            break;
+        }
+        case ARG_FLOAT: {
+            float v;
+            if ((ok = ok && take(&arg, end, &v, sizeof(v)))) {
+                PRINT_SPEC(&text, fmt, spec.stars, star, (double)v);
+            }
+            break;
+        }
+        case ARG_STRING: {
+            uint8_t len;
+            char s[RG_TLOG_MAX_STRING + 1];
+            if ((ok = ok && take(&arg, end, &len, 1) && len <= RG_TLOG_MAX_STRING && take(&arg, end, s, len))) {
+                s[len] = '\0';
+                PRINT_SPEC(&text, fmt, spec.stars, star, s);
+            }
+            break;
+        }
+        case ARG_POINTER: {
+            uintptr_t v;
+            if ((ok = ok && take(&arg, end, &v, sizeof(v)))) {
+                PRINT_SPEC(&text, fmt, spec.stars, star, (void *)v);
+            }
+            break;
+        }
+        }
+        if (!ok) {
+            append(&text, "<?>", 3); // Cut off when the record was full
+        }
+    }
+    append(&text, p, strlen(p));
+    return text.len;
+}
+
+// --- Device ring ------------------------------------------------------------
+
+#if CONFIG_RG_TLOG
+_Static_assert((CONFIG_RG_TLOG_RING_SIZE & (CONFIG_RG_TLOG_RING_SIZE - 1)) == 0,
+               "CONFIG_RG_TLOG_RING_SIZE must be a power of two");
+
+static uint8_t s_buf[CONFIG_RG_TLOG_RING_SIZE] __attribute__((aligned(4)));
+static rg_tlog_ring_t s_ring = {.buf = s_buf, .size = CONFIG_RG_TLOG_RING_SIZE};
+
+rg_tlog_ring_t *rg_tlog_ring(void)
+{
+    return &s_ring;
+}
+
+void rg_tlog_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    rg_tlog_ring_vwrite(&s_ring, level, (uint32_t)(esp_timer_get_time() / 1000), tag, format, args);
+    va_end(args);
+}
+#endif
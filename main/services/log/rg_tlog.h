@@ -0,0 +1,130 @@
+// main/services/log/rg_tlog.h
+#ifndef RG_TLOG_H_
+#define RG_TLOG_H_
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include <sdkconfig.h>
+
+// Tokenized (deferred) logging for hot paths.
+//
+// RG_TLOGE/W/I take the same arguments as ESP_LOGE/W/I. With CONFIG_RG_TLOG
+// they do not format anything: the call copies the format string's address,
+// the tag's address and the raw arguments into a record in a lock-free RAM
+// ring and returns. A low-priority task (rg_tlog_task.c) drains the ring
+// later, either formatting the text there or sending the records in base64
+// for host/tlog_decode.py to rebuild from the firmware ELF. Without
+// CONFIG_RG_TLOG they are plain ESP_LOGx.
+//
+// Record, native endianness, 4-byte aligned:
+//
+//   uint32_t  header    RG_TLOG_COMMITTED | level << 24 | length in bytes
+//   uint32_t  time      esp_timer_get_time() at the call, ms
+//   uintptr_t format    Address of the format string (in flash rodata)
+//   uintptr_t tag       Address of the tag
+//   ...                 One field per conversion, packed: 4-byte integers,
+//                       8 for ll/j, floats for every floating conversion,
+//                       pointers at their size, strings as a length byte and
+//                       up to RG_TLOG_MAX_STRING bytes (copied, so stack
+//                       buffers are fine)
+//
+// Any number of tasks write (a CAS reserves the space, the header is stored
+// last to commit it); one task reads. A full ring drops the new record and
+// counts it. Format and tag must be string literals or otherwise live as
+// long as the firmware, which the ESP_LOG conventions already ensure.
+
+#define RG_TLOG_COMMITTED 0x80000000u
+#define RG_TLOG_MAX_RECORD 128
+#define RG_TLOG_MAX_STRING 48
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;     // Power of two
+    uint32_t reserved; // Bytes ever reserved by writers
+    uint32_t tail;     // Bytes ever consumed by the reader
+    uint32_t records;  // Written
+    uint32_t dropped;  // Did not fit
+    uint32_t high_water;
+} rg_tlog_ring_t;
+
+typedef struct {
+    esp_log_level_t level;
+    uint32_t time_ms;
+    const char *format;
+    const char *tag;
+    const uint8_t *args;
+    size_t args_len;
+} rg_tlog_record_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up a ring over @p buf; @p size must be a power of two of at least 2 * RG_TLOG_MAX_RECORD.
+ */
+esp_err_t rg_tlog_ring_init(rg_tlog_ring_t *ring, uint8_t *buf, uint32_t size);
+
+/**
+ * @brief Encodes one call into @p ring. Safe from any task.
+ *
+ * @return false if the record was dropped for lack of space.
+ */
+bool rg_tlog_ring_vwrite(rg_tlog_ring_t *ring, esp_log_level_t level, uint32_t time_ms, const char *tag,
+                         const char *format, va_list args);
+
+/**
+ * @brief Moves the oldest committed record into @p out (single reader).
+ *
+ * @return Its length, or 0 if there is none yet (or @p size is too small for it).
+ */
+size_t rg_tlog_ring_read(rg_tlog_ring_t *ring, uint8_t *out, size_t size);
+
+/**
+ * @brief Splits a record from rg_tlog_ring_read() into its fields.
+ */
+esp_err_t rg_tlog_parse(const uint8_t *record, size_t len, rg_tlog_record_t *out);
+
+/**
+ * @brief Formats a record as ESP_LOG would, "I (1234) TAG: message", without the newline.
+ *
+ * Only valid in the firmware that wrote the record, since it follows the
+ * format and tag addresses. Truncates to @p size.
+ *
+ * @return Length written, without the terminator.
+ */
+size_t rg_tlog_format(const rg_tlog_record_t *record, char *out, size_t size);
+
+/**
+ * @brief The device ring, CONFIG_RG_TLOG_RING_SIZE bytes, drained by rg_tlog_task.
+ */
+rg_tlog_ring_t *rg_tlog_ring(void);
+
+/**
+ * @brief Writes to the device ring; use the RG_TLOGx macros.
+ */
+void rg_tlog_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#if CONFIG_RG_TLOG
+#define RG_TLOGE(tag, format, ...) rg_tlog_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define RG_TLOGW(tag, format, ...) rg_tlog_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define RG_TLOGI(tag, format, ...) rg_tlog_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define RG_TLOGE(tag, format, ...) ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define RG_TLOGW(tag, format, ...) ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define RG_TLOGI(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+#endif
+
+#endif /* RG_TLOG_H_ */
@@ -0,0 +1,99 @@
+// main/services/log/rg_tlog_task.c
+#include "rg_tlog_task.h"
+
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "services/rtos/rg_static_alloc.h"
+#include <sdkconfig.h>
+
+#if CONFIG_RG_TLOG
+
+RG_TASK_STORAGE(s_task, 3072);
+static bool s_started = false;
+
+#if CONFIG_RG_TLOG_OUTPUT_BINARY
+// Base64 keeps the record intact through the console's newline translation
+static void write_record(const uint8_t *record, size_t len)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char line[4 + (RG_TLOG_MAX_RECORD + 2) / 3 * 4 + 2] = "\x1eTL";
+    size_t n = 3;
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t v = (uint32_t)record[i] << 16 | (i + 1 < len ? (uint32_t)record[i + 1] << 8 : 0) |
+                           (i + 2 < len ? record[i + 2] : 0);
+        line[n++] = digits[v >> 18];
+        line[n++] = digits[(v >> 12) & 63];
+        line[n++] = i + 1 < len ? digits[(v >> 6) & 63] : '=';
+        line[n++] = i + 2 < len ? digits[v & 63] : '=';
+    }
+    line[n++] = '\n';
+    fwrite(line, 1, n, stdout);
+}
+#else
+static void write_record(const uint8_t *record, size_t len)
+{
+    rg_tlog_record_t parsed;
+    char line[160];
+    if (rg_tlog_parse(record, len, &parsed) == ESP_OK) {
+        rg_tlog_format(&parsed, line, sizeof(line));
+        esp_log_write(parsed.level, parsed.tag, "%s\n", line);
+    }
+}
+#endif
+
+static void tlog_task(void *arg)
+{
+    (void)arg;
+    rg_tlog_ring_t *ring = rg_tlog_ring();
+    uint32_t record[RG_TLOG_MAX_RECORD / sizeof(uint32_t)];
+    while (1) {
+        size_t len;
+        while ((len = rg_tlog_ring_read(ring, (uint8_t *)record, sizeof(record))) > 0) {
+            write_record((const uint8_t *)record, len);
+        }
+        fflush(stdout);
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_RG_TLOG_FLUSH_MS));
+    }
+}
+
+esp_err_t rg_tlog_task_start(void)
+{
+    if (s_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Below everything else, so draining only ever takes idle time
+    if (RG_TASK_CREATE(s_task, tlog_task, "tlog", NULL, 1) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_started = true;
+    return ESP_OK;
+}
+
+void rg_tlog_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    const rg_tlog_ring_t *ring = rg_tlog_ring();
+    rg_metrics_write_family(writer, "rg_tlog_records_total", "counter", "Records written to the tokenized log ring.");
+    rg_metrics_write_value(writer, "rg_tlog_records_total", NULL, __atomic_load_n(&ring->records, __ATOMIC_RELAXED));
+    rg_metrics_write_family(writer, "rg_tlog_dropped_total", "counter",
+                            "Records dropped because the tokenized log ring was full.");
+    rg_metrics_write_value(writer, "rg_tlog_dropped_total", NULL, __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED));
+    rg_metrics_write_family(writer, "rg_tlog_ring_high_water_bytes", "gauge",
+                            "Most bytes ever waiting in the tokenized log ring.");
+    rg_metrics_write_value(writer, "rg_tlog_ring_high_water_bytes", NULL,
+                           __atomic_load_n(&ring->high_water, __ATOMIC_RELAXED));
+}
+
+#else // !CONFIG_RG_TLOG
+
+esp_err_t rg_tlog_task_start(void)
+{
+    return ESP_OK;
+}
+
+void rg_tlog_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    (void)writer;
+}
+
+#endif
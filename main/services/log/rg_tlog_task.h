@@ -0,0 +1,42 @@
+// main/services/log/rg_tlog_task.h
+#ifndef RG_TLOG_TASK_H_
+#define RG_TLOG_TASK_H_
+
+#pragma once
+
+#include "esp_err.h"
+#include "rg_tlog.h"
+#include "services/metrics/rg_metrics.h"
+
+// Drains the device tokenized-log ring (rg_tlog_ring()) every
+// CONFIG_RG_TLOG_FLUSH_MS from a priority 1 task, so formatting and UART
+// time land on idle time instead of the task that logged. With
+// CONFIG_RG_TLOG_OUTPUT_BINARY each record goes out as one line,
+//
+//   "\x1eTL" base64(record) "\n"
+//
+// which host/tlog_decode.py turns back into text using the ELF; other log
+// lines pass through it untouched. Records written before the task starts
+// wait in the ring.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts the drain task.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM.
+ */
+esp_err_t rg_tlog_task_start(void);
+
+/**
+ * @brief Writes the record, drop and high-water counters of the ring for /metrics.
+ */
+void rg_tlog_task_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_TLOG_TASK_H_ */
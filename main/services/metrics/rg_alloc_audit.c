@@ -0,0 +1,60 @@
+// main/services/metrics/rg_alloc_audit.c
+#include "rg_alloc_audit.h"
+
+#include <sdkconfig.h>
+
+#if CONFIG_HEAP_USE_HOOKS
+#include "esp_heap_caps.h"
+#endif
+
+static uint32_t s_allocs;
+static uint32_t s_frees;
+static uint32_t s_bytes;
+
+void rg_alloc_audit_record_alloc(size_t size)
+{
+    __atomic_fetch_add(&s_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s_bytes, (uint32_t)size, __ATOMIC_RELAXED);
+}
+
+void rg_alloc_audit_record_free(void)
+{
+    __atomic_fetch_add(&s_frees, 1, __ATOMIC_RELAXED);
+}
+
+void rg_alloc_audit_snapshot(rg_alloc_counts_t *counts)
+{
+    counts->allocs = __atomic_load_n(&s_allocs, __ATOMIC_RELAXED);
+    counts->frees = __atomic_load_n(&s_frees, __ATOMIC_RELAXED);
+    counts->bytes = __atomic_load_n(&s_bytes, __ATOMIC_RELAXED);
+}
+
+void rg_alloc_audit_write_metrics(rg_metrics_writer_t *writer)
+{
+    rg_alloc_counts_t counts;
+    rg_alloc_audit_snapshot(&counts);
+    rg_metrics_write_family(writer, "rg_heap_allocations_total", "counter", "Successful heap allocations.");
+    rg_metrics_write_value(writer, "rg_heap_allocations_total", NULL, counts.allocs);
+    rg_metrics_write_family(writer, "rg_heap_frees_total", "counter", "Heap frees.");
+    rg_metrics_write_value(writer, "rg_heap_frees_total", NULL, counts.frees);
+    rg_metrics_write_family(writer, "rg_heap_allocated_bytes_total", "counter",
+                            "Bytes requested by heap allocations (wraps at 4 GiB).");
+    rg_metrics_write_value(writer, "rg_heap_allocated_bytes_total", NULL, counts.bytes);
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+// Called by the heap component, with its lock held, after every successful
+// allocation and every free
+void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    (void)ptr;
+    (void)caps;
+    rg_alloc_audit_record_alloc(size);
+}
+
+void esp_heap_trace_free_hook(void *ptr)
+{
+    (void)ptr;
+    rg_alloc_audit_record_free();
+}
+#endif
@@ -0,0 +1,53 @@
+// main/services/metrics/rg_alloc_audit.h
+#ifndef RG_ALLOC_AUDIT_H_
+#define RG_ALLOC_AUDIT_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rg_metrics.h"
+
+// Counts heap allocations, so steady-state code can be shown not to allocate.
+//
+// On the device the counts come from the ESP-IDF heap hooks
+// (CONFIG_HEAP_USE_HOOKS, selected by CONFIG_RG_ALLOC_AUDIT) and are exported
+// in /metrics; the host build counts through a malloc wrapper. Take a
+// snapshot before and after the code under audit and compare.
+
+typedef struct {
+    uint32_t allocs; // Successful allocations, reallocations included
+    uint32_t frees;
+    uint32_t bytes;  // Bytes requested by those allocations; wraps
+} rg_alloc_counts_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Records one allocation of @p size bytes. Lock-free; safe from the heap hooks.
+ */
+void rg_alloc_audit_record_alloc(size_t size);
+
+/**
+ * @brief Records one free. Lock-free; safe from the heap hooks.
+ */
+void rg_alloc_audit_record_free(void);
+
+/**
+ * @brief Current counts.
+ */
+void rg_alloc_audit_snapshot(rg_alloc_counts_t *counts);
+
+/**
+ * @brief Writes the counts to /metrics (for a collector).
+ */
+void rg_alloc_audit_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_ALLOC_AUDIT_H_ */
@@ -0,0 +1,272 @@
+// main/services/metrics/rg_metrics.c
+#include "rg_metrics.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_COLLECTORS 4
+
+const uint32_t rg_metrics_latency_bounds_us[12] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 500000, 2000000,
+};
+
+// Registries are push-only singly linked lists; the writers never unlink
+static rg_metrics_histogram_t *s_histograms;
+static rg_metrics_counter_t *s_counters;
+static rg_metrics_collector_t s_collectors[MAX_COLLECTORS];
+
+#define PUSH_FRONT(head, node)                                                                    \
+    do {                                                                                          \
+        __typeof__(node) old_ = __atomic_load_n(&(head), __ATOMIC_ACQUIRE);                       \
+        do {                                                                                      \
+            (node)->next = old_;                                                                  \
+        } while (!__atomic_compare_exchange_n(&(head), &old_, (node), true, __ATOMIC_RELEASE,    \
+                                              __ATOMIC_ACQUIRE));                                 \
+    } while (0)
+
+void rg_metrics_register_histogram(rg_metrics_histogram_t *histogram)
+{
+    if (__atomic_exchange_n(&histogram->registered, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    if (histogram->bucket_count > RG_METRICS_MAX_BUCKETS) {
+        histogram->bucket_count = RG_METRICS_MAX_BUCKETS;
+    }
+    PUSH_FRONT(s_histograms, histogram);
+}
+
+void rg_metrics_register_counter(rg_metrics_counter_t *counter)
+{
+    if (__atomic_exchange_n(&counter->registered, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    PUSH_FRONT(s_counters, counter);
+}
+
+esp_err_t rg_metrics_register_collector(rg_metrics_collector_t collector)
+{
+    for (int i = 0; i < MAX_COLLECTORS; i++) {
+        rg_metrics_collector_t expected = NULL;
+        if (__atomic_compare_exchange_n(&s_collectors[i], &expected, collector, false, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void rg_metrics_observe(rg_metrics_histogram_t *histogram, uint32_t value_us)
+{
+    size_t i = 0;
+    while (i < histogram->bucket_count && value_us > histogram->bounds_us[i]) {
+        i++;
+    }
+    __atomic_fetch_add(&histogram->counts[i], 1, __ATOMIC_RELAXED);
+
+    // Not lock-free on the RISC-V cores: IDF implements 64-bit atomics as a short critical
+    // section, which still keeps the sum whole for a concurrent scrape
+    __atomic_fetch_add(&histogram->sum_us, value_us, __ATOMIC_RELAXED);
+}
+
+uint32_t rg_metrics_histogram_count(const rg_metrics_histogram_t *histogram)
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i <= histogram->bucket_count; i++) {
+        total += __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+uint64_t rg_metrics_histogram_sum_us(const rg_metrics_histogram_t *histogram)
+{
+    return __atomic_load_n(&histogram->sum_us, __ATOMIC_RELAXED);
+}
+
+static void writer_flush(rg_metrics_writer_t *writer)
+{
+    if (writer->len > 0 && writer->err == ESP_OK) {
+        writer->err = writer->sink(writer->ctx, writer->buf, writer->len);
+    }
+    writer->len = 0;
+}
+
+static void writer_put(rg_metrics_writer_t *writer, const char *data, size_t len)
+{
+    while (len > 0) {
+        if (writer->len == sizeof(writer->buf)) {
+            writer_flush(writer);
+        }
+        size_t n = sizeof(writer->buf) - writer->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(writer->buf + writer->len, data, n);
+        writer->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void writer_puts(rg_metrics_writer_t *writer, const char *s)
+{
+    writer_put(writer, s, strlen(s));
+}
+
+void rg_metrics_write_family(rg_metrics_writer_t *writer, const char *name, const char *type, const char *help)
+{
+    writer_puts(writer, "# HELP ");
+    writer_puts(writer, name);
+    writer_puts(writer, " ");
+    writer_puts(writer, help);
+    writer_puts(writer, "\n# TYPE ");
+    writer_puts(writer, name);
+    writer_puts(writer, " ");
+    writer_puts(writer, type);
+    writer_puts(writer, "\n");
+}
+
+// name{labels,extra} value
+static void write_line(rg_metrics_writer_t *writer, const char *name, const char *suffix, const char *labels,
+                       const char *extra, const char *value)
+{
+    writer_puts(writer, name);
+    writer_puts(writer, suffix);
+    bool has_labels = labels && *labels;
+    if (has_labels || extra) {
+        writer_puts(writer, "{");
+        if (has_labels) {
+            writer_puts(writer, labels);
+        }
+        if (extra) {
+            if (has_labels) {
+                writer_puts(writer, ",");
+            }
+            writer_puts(writer, extra);
+        }
+        writer_puts(writer, "}");
+    }
+    writer_puts(writer, " ");
+    writer_puts(writer, value);
+    writer_puts(writer, "\n");
+}
+
+void rg_metrics_write_value(rg_metrics_writer_t *writer, const char *name, const char *labels, int64_t value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%" PRId64, value);
+    write_line(writer, name, "", labels, NULL, text);
+}
+
+// Microseconds as decimal seconds without going through float: 2500 -> "0.0025"
+static void format_seconds(char *out, size_t size, uint64_t us)
+{
+    int n = snprintf(out, size, "%" PRIu64 ".%06" PRIu64, us / 1000000, us % 1000000);
+    while (n > 2 && out[n - 1] == '0' && out[n - 2] != '.') {
+        out[--n] = '\0';
+    }
+}
+
+void rg_metrics_write_seconds(rg_metrics_writer_t *writer, const char *name, const char *labels, uint64_t value_us)
+{
+    char text[24];
+    format_seconds(text, sizeof(text), value_us);
+    write_line(writer, name, "", labels, NULL, text);
+}
+
+static void write_histogram(rg_metrics_writer_t *writer, const rg_metrics_histogram_t *h)
+{
+    char le[32];
+    char value[24];
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i <= h->bucket_count; i++) {
+        cumulative += __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+        if (i < h->bucket_count) {
+            char bound[20];
+            format_seconds(bound, sizeof(bound), h->bounds_us[i]);
+            snprintf(le, sizeof(le), "le=\"%s\"", bound);
+        } else {
+            snprintf(le, sizeof(le), "le=\"+Inf\"");
+        }
+        snprintf(value, sizeof(value), "%" PRIu32, cumulative);
+        write_line(writer, h->name, "_bucket", h->labels, le, value);
+    }
+    format_seconds(value, sizeof(value), rg_metrics_histogram_sum_us(h));
+    write_line(writer, h->name, "_sum", h->labels, NULL, value);
+    snprintf(value, sizeof(value), "%" PRIu32, cumulative);
+    write_line(writer, h->name, "_count", h->labels, NULL, value);
+}
+
+esp_err_t rg_metrics_export(rg_metrics_sink_t sink, void *ctx)
+{
+    rg_metrics_writer_t writer;
+    writer.sink = sink;
+    writer.ctx = ctx;
+    writer.err = ESP_OK;
+    writer.len = 0;
+
+    // Members of a family are grouped under one HELP/TYPE header, as the format requires
+    rg_metrics_histogram_t *histograms = __atomic_load_n(&s_histograms, __ATOMIC_ACQUIRE);
+    for (rg_metrics_histogram_t *h = histograms; h; h = h->next) {
+        bool seen = false;
+        for (rg_metrics_histogram_t *p = histograms; p != h && !seen; p = p->next) {
+            seen = strcmp(p->name, h->name) == 0;
+        }
+        if (seen) {
+            continue;
+        }
+        rg_metrics_write_family(&writer, h->name, "histogram", h->help);
+        for (rg_metrics_histogram_t *m = h; m; m = m->next) {
+            if (strcmp(m->name, h->name) == 0) {
+                write_histogram(&writer, m);
+            }
+        }
+    }
+
+    rg_metrics_counter_t *counters = __atomic_load_n(&s_counters, __ATOMIC_ACQUIRE);
+    for (rg_metrics_counter_t *c = counters; c; c = c->next) {
+        bool seen = false;
+        for (rg_metrics_counter_t *p = counters; p != c && !seen; p = p->next) {
+            seen = strcmp(p->name, c->name) == 0;
+        }
+        if (seen) {
+            continue;
+        }
+        rg_metrics_write_family(&writer, c->name, "counter", c->help);
+        for (rg_metrics_counter_t *m = c; m; m = m->next) {
+            if (strcmp(m->name, c->name) == 0) {
+                rg_metrics_write_value(&writer, m->name, m->labels, __atomic_load_n(&m->value, __ATOMIC_RELAXED));
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_COLLECTORS; i++) {
+        rg_metrics_collector_t collector = __atomic_load_n(&s_collectors[i], __ATOMIC_ACQUIRE);
+        if (collector) {
+            collector(&writer);
+        }
+    }
+    writer_flush(&writer);
+    return writer.err;
+}
+
+size_t rg_metrics_escape_label(char *out, size_t size, const char *value)
+{
+    size_t n = 0;
+    if (size == 0) {
+        return 0;
+    }
+    for (; *value && n + 2 < size; value++) {
+        if (*value == '"' || *value == '\\') {
+            out[n++] = '\\';
+            out[n++] = *value;
+        } else if (*value == '\n') {
+            out[n++] = '\\';
+            out[n++] = 'n';
+        } else {
+            out[n++] = *value;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
@@ -0,0 +1,146 @@
+// main/services/metrics/rg_metrics.h
+#ifndef RG_METRICS_H_
+#define RG_METRICS_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Instrumentation exported as Prometheus text (GET /metrics).
+//
+// Histograms and counters are statically allocated by the code they measure
+// and linked into a registry once. Recording is cheap: a histogram
+// observation is a short bucket search and two relaxed atomic adds, a counter
+// increment one, so they can sit in the sensor and HTTP hot paths and be
+// called from any task. Readers take each value atomically; a scrape never
+// blocks a writer for longer than one 64-bit add.
+//
+// Gauges that are sampled at scrape time (heap, tasks, RSSI) come from
+// collectors, which write through the same rg_metrics_writer_t.
+//
+// Durations are recorded in microseconds and exported in seconds.
+
+#define RG_METRICS_MAX_BUCKETS 15
+
+typedef struct rg_metrics_histogram {
+    const char *name;          // Metric family, e.g. "rg_http_request_duration_seconds"
+    const char *help;
+    const char *labels;        // Fixed labels without braces, e.g. "route=\"/data\"", or NULL
+    const uint32_t *bounds_us; // Ascending bucket upper bounds; +Inf is implicit
+    uint8_t bucket_count;      // Entries in bounds_us, at most RG_METRICS_MAX_BUCKETS
+    uint32_t counts[RG_METRICS_MAX_BUCKETS + 1]; // Per bucket, not cumulative; last is +Inf
+    uint64_t sum_us;           // Sum of observations in us
+    bool registered;
+    struct rg_metrics_histogram *next;
+} rg_metrics_histogram_t;
+
+typedef struct rg_metrics_counter {
+    const char *name;
+    const char *help;
+    const char *labels;
+    uint32_t value;
+    bool registered;
+    struct rg_metrics_counter *next;
+} rg_metrics_counter_t;
+
+#define RG_METRICS_HISTOGRAM_INIT(name_, help_, labels_, bounds_)                                 \
+    {                                                                                             \
+        .name = (name_), .help = (help_), .labels = (labels_), .bounds_us = (bounds_),            \
+        .bucket_count = sizeof(bounds_) / sizeof((bounds_)[0]),                                   \
+    }
+
+#define RG_METRICS_COUNTER_INIT(name_, help_, labels_)                                            \
+    {                                                                                             \
+        .name = (name_), .help = (help_), .labels = (labels_),                                    \
+    }
+
+// Bucket bounds for latencies from tens of microseconds to a few seconds
+extern const uint32_t rg_metrics_latency_bounds_us[12];
+
+// Buffered Prometheus text output; flushed through the sink in chunks
+typedef esp_err_t (*rg_metrics_sink_t)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    rg_metrics_sink_t sink;
+    void *ctx;
+    esp_err_t err;
+    size_t len;
+    char buf[512];
+} rg_metrics_writer_t;
+
+typedef void (*rg_metrics_collector_t)(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Adds @p histogram to the export. Safe from any task; repeated calls are ignored.
+ */
+void rg_metrics_register_histogram(rg_metrics_histogram_t *histogram);
+
+/**
+ * @brief Adds @p counter to the export. Safe from any task; repeated calls are ignored.
+ */
+void rg_metrics_register_counter(rg_metrics_counter_t *counter);
+
+/**
+ * @brief Adds a collector run on every export, or ESP_ERR_NO_MEM if the table is full.
+ */
+esp_err_t rg_metrics_register_collector(rg_metrics_collector_t collector);
+
+/**
+ * @brief Records one observation of @p value_us. Lock-free; never blocks.
+ */
+void rg_metrics_observe(rg_metrics_histogram_t *histogram, uint32_t value_us);
+
+/**
+ * @brief Adds @p n to @p counter. Lock-free; never blocks.
+ */
+static inline void rg_metrics_add(rg_metrics_counter_t *counter, uint32_t n)
+{
+    __atomic_fetch_add(&counter->value, n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Total observations and sum in us of @p histogram.
+ */
+uint32_t rg_metrics_histogram_count(const rg_metrics_histogram_t *histogram);
+uint64_t rg_metrics_histogram_sum_us(const rg_metrics_histogram_t *histogram);
+
+/**
+ * @brief Writes all registered metrics and collector output in Prometheus text format.
+ *
+ * @return The first error returned by @p sink, ESP_OK otherwise.
+ */
+esp_err_t rg_metrics_export(rg_metrics_sink_t sink, void *ctx);
+
+/**
+ * @brief Writes "# HELP" and "# TYPE" lines for a metric family (for collectors).
+ */
+void rg_metrics_write_family(rg_metrics_writer_t *writer, const char *name, const char *type, const char *help);
+
+/**
+ * @brief Writes one sample line; @p labels is without braces and may be NULL (for collectors).
+ */
+void rg_metrics_write_value(rg_metrics_writer_t *writer, const char *name, const char *labels, int64_t value);
+
+/**
+ * @brief Writes one sample line with @p value_us formatted in seconds (for collectors).
+ */
+void rg_metrics_write_seconds(rg_metrics_writer_t *writer, const char *name, const char *labels, uint64_t value_us);
+
+/**
+ * @brief Appends @p value as a Prometheus label value, escaping quotes and backslashes.
+ */
+size_t rg_metrics_escape_label(char *out, size_t size, const char *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_METRICS_H_ */
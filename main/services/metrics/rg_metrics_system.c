@@ -0,0 +1,121 @@
+// main/services/metrics/rg_metrics_system.c
+#include "rg_metrics_system.h"
+#include "rg_metrics.h"
+#include "rg_alloc_audit.h"
+#include "services/boot/rg_boot.h"
+#include "services/bus/rg_event_bus_task.h"
+#include "services/config/rg_config_task.h"
+#include "services/log/rg_tlog_task.h"
+#include "services/rules/rg_rules_task.h"
+
+#include <stdio.h>
+
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_METRICS";
+
+static rg_metrics_counter_t s_wifi_connects =
+    RG_METRICS_COUNTER_INIT("rg_wifi_connects_total", "Times the station obtained an IP address.", NULL);
+static rg_metrics_counter_t s_wifi_disconnects =
+    RG_METRICS_COUNTER_INIT("rg_wifi_disconnects_total", "Times the station lost its access point.", NULL);
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+// Only touched by the collector, which runs in the HTTP server task
+static TaskStatus_t s_tasks[CONFIG_RG_METRICS_MAX_TASKS];
+
+static void collect_tasks(rg_metrics_writer_t *writer)
+{
+    UBaseType_t count = uxTaskGetSystemState(s_tasks, CONFIG_RG_METRICS_MAX_TASKS, NULL);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks; raise CONFIG_RG_METRICS_MAX_TASKS.", CONFIG_RG_METRICS_MAX_TASKS);
+        return;
+    }
+    char labels[CONFIG_FREERTOS_MAX_TASK_NAME_LEN * 2 + 16];
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // The run time clock is esp_timer, so counters are in microseconds
+    rg_metrics_write_family(writer, "rg_task_cpu_seconds_total", "counter", "CPU time spent in each task.");
+    for (UBaseType_t i = 0; i < count; i++) {
+        int n = snprintf(labels, sizeof(labels), "task=\"");
+        n += rg_metrics_escape_label(labels + n, sizeof(labels) - n - 1, s_tasks[i].pcTaskName);
+        snprintf(labels + n, sizeof(labels) - n, "\"");
+        rg_metrics_write_seconds(writer, "rg_task_cpu_seconds_total", labels, s_tasks[i].ulRunTimeCounter);
+    }
+#endif
+    rg_metrics_write_family(writer, "rg_task_stack_high_water_bytes", "gauge",
+                            "Stack high-water mark: the least free stack each task has had.");
+    for (UBaseType_t i = 0; i < count; i++) {
+        int n = snprintf(labels, sizeof(labels), "task=\"");
+        n += rg_metrics_escape_label(labels + n, sizeof(labels) - n - 1, s_tasks[i].pcTaskName);
+        snprintf(labels + n, sizeof(labels) - n, "\"");
+        rg_metrics_write_value(writer, "rg_task_stack_high_water_bytes", labels, s_tasks[i].usStackHighWaterMark);
+    }
+}
+#endif
+
+static void collect_system(rg_metrics_writer_t *writer)
+{
+    rg_metrics_write_family(writer, "rg_uptime_seconds", "counter", "Time since boot.");
+    rg_metrics_write_seconds(writer, "rg_uptime_seconds", NULL, (uint64_t)esp_timer_get_time());
+
+    rg_metrics_write_family(writer, "rg_heap_free_bytes", "gauge", "Free heap.");
+    rg_metrics_write_value(writer, "rg_heap_free_bytes", NULL, esp_get_free_heap_size());
+    rg_metrics_write_family(writer, "rg_heap_free_min_bytes", "gauge", "Lowest free heap since boot.");
+    rg_metrics_write_value(writer, "rg_heap_free_min_bytes", NULL, esp_get_minimum_free_heap_size());
+    rg_metrics_write_family(writer, "rg_heap_largest_free_block_bytes", "gauge",
+                            "Largest allocatable block; falls as the heap fragments.");
+    rg_metrics_write_value(writer, "rg_heap_largest_free_block_bytes", NULL,
+                           heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        rg_metrics_write_family(writer, "rg_wifi_rssi_dbm", "gauge", "Signal strength of the access point.");
+        rg_metrics_write_value(writer, "rg_wifi_rssi_dbm", NULL, ap.rssi);
+    }
+
+    rg_boot_write_metrics(writer);
+    rg_config_task_write_metrics(writer);
+    rg_event_bus_task_write_metrics(writer);
+    rg_rules_task_write_metrics(writer);
+    rg_tlog_task_write_metrics(writer);
+
+#if CONFIG_RG_ALLOC_AUDIT
+    rg_alloc_audit_write_metrics(writer);
+#endif
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    collect_tasks(writer);
+#endif
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg;
+    (void)data;
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        rg_metrics_add(&s_wifi_disconnects, 1);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        rg_metrics_add(&s_wifi_connects, 1);
+    }
+}
+
+esp_err_t rg_metrics_system_start(void)
+{
+    rg_metrics_register_counter(&s_wifi_connects);
+    rg_metrics_register_counter(&s_wifi_disconnects);
+    esp_err_t err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, wifi_event_handler, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Wi-Fi events not counted: %s", esp_err_to_name(err));
+    }
+    return rg_metrics_register_collector(collect_system);
+}
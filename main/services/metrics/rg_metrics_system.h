@@ -0,0 +1,27 @@
+// main/services/metrics/rg_metrics_system.h
+#ifndef RG_METRICS_SYSTEM_H_
+#define RG_METRICS_SYSTEM_H_
+
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Registers the device collectors with rg_metrics: per-task CPU time and
+ * stack high-water marks, heap usage, uptime, boot milestones, Wi-Fi RSSI and
+ * connection counts.
+ *
+ * Call after the default event loop exists (the Wi-Fi counters hook its events).
+ * Per-task CPU time needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ */
+esp_err_t rg_metrics_system_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_METRICS_SYSTEM_H_ */
@@ -0,0 +1,99 @@
+// main/services/ota/rg_heatshrink.c
+#include "rg_heatshrink.h"
+
+#include <string.h>
+
+enum {
+    STATE_TAG,
+    STATE_LITERAL,
+    STATE_INDEX,
+    STATE_COUNT,
+    STATE_COPY,
+};
+
+bool rg_heatshrink_init(rg_heatshrink_t *hs, uint8_t *window, uint8_t window_bits, uint8_t lookahead_bits)
+{
+    if (window_bits < RG_HEATSHRINK_MIN_WINDOW_BITS || window_bits > RG_HEATSHRINK_MAX_WINDOW_BITS ||
+        lookahead_bits < RG_HEATSHRINK_MIN_LOOKAHEAD_BITS || lookahead_bits >= window_bits) {
+        return false;
+    }
+    memset(hs, 0, sizeof(*hs));
+    hs->window = window;
+    hs->window_bits = window_bits;
+    hs->lookahead_bits = lookahead_bits;
+    hs->mask = (uint16_t)((1u << window_bits) - 1);
+    hs->state = STATE_TAG;
+    // Copies reaching back before the first byte read zeros, as in the reference decoder
+    memset(window, 0, (size_t)hs->mask + 1);
+    return true;
+}
+
+// Takes the next @p n bits (n <= 16) if enough input is at hand
+static bool take_bits(rg_heatshrink_t *hs, const uint8_t *in, size_t len, size_t *pos, uint8_t n, uint32_t *value)
+{
+    while (hs->bit_count < n) {
+        if (*pos == len) {
+            return false;
+        }
+        hs->bits = (hs->bits << 8) | in[(*pos)++];
+        hs->bit_count += 8;
+    }
+    hs->bit_count -= n;
+    *value = (hs->bits >> hs->bit_count) & ((1u << n) - 1);
+    return true;
+}
+
+static void emit(rg_heatshrink_t *hs, uint8_t c, uint8_t *out, size_t *produced)
+{
+    hs->window[hs->head & hs->mask] = c;
+    hs->head++;
+    out[(*produced)++] = c;
+}
+
+size_t rg_heatshrink_decode(rg_heatshrink_t *hs, const uint8_t *in, size_t *in_len, uint8_t *out, size_t out_size)
+{
+    const size_t len = *in_len;
+    size_t pos = 0;
+    size_t produced = 0;
+    bool more = true; // False once the input ends mid-field
+    uint32_t v;
+
+    while (more && produced < out_size) {
+        switch (hs->state) {
+        case STATE_TAG:
+            if ((more = take_bits(hs, in, len, &pos, 1, &v))) {
+                hs->state = v ? STATE_LITERAL : STATE_INDEX;
+            }
+            break;
+        case STATE_LITERAL:
+            if ((more = take_bits(hs, in, len, &pos, 8, &v))) {
+                emit(hs, (uint8_t)v, out, &produced);
+                hs->state = STATE_TAG;
+            }
+            break;
+        case STATE_INDEX:
+            if ((more = take_bits(hs, in, len, &pos, hs->window_bits, &v))) {
+                hs->copy_index = (uint16_t)(v + 1);
+                hs->state = STATE_COUNT;
+            }
+            break;
+        case STATE_COUNT:
+            if ((more = take_bits(hs, in, len, &pos, hs->lookahead_bits, &v))) {
+                hs->copy_left = (uint16_t)(v + 1);
+                hs->state = STATE_COPY;
+            }
+            break;
+        case STATE_COPY:
+            while (hs->copy_left > 0 && produced < out_size) {
+                emit(hs, hs->window[(uint16_t)(hs->head - hs->copy_index) & hs->mask], out, &produced);
+                hs->copy_left--;
+            }
+            if (hs->copy_left == 0) {
+                hs->state = STATE_TAG;
+            }
+            break;
+        }
+    }
+    *in_len = pos;
+    return produced;
+}
@@ -0,0 +1,67 @@
+// main/services/ota/rg_heatshrink.h
+#ifndef RG_HEATSHRINK_H_
+#define RG_HEATSHRINK_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming decoder for heatshrink-compressed data.
+//
+// heatshrink is LZSS with a bit-packed stream, made for small devices: the
+// decoder needs only its window (2^window_bits bytes) and a few words of
+// state, and resumes at any bit boundary, so input can arrive in chunks of
+// any size and output can be taken in chunks of any size. MSB-first fields:
+//
+//   1 + 8 bits                           literal byte
+//   0 + window_bits + lookahead_bits     copy (count + 1) bytes from (index + 1) back
+//
+// The same format as the reference heatshrink encoder for the same
+// window_bits and lookahead_bits (host/ota_pack.py writes it). The stream
+// has no end marker: the final byte is zero-padded, so the caller stops at
+// the decompressed size it knows from elsewhere.
+
+#define RG_HEATSHRINK_MIN_WINDOW_BITS 4
+#define RG_HEATSHRINK_MAX_WINDOW_BITS 15
+#define RG_HEATSHRINK_MIN_LOOKAHEAD_BITS 3
+
+typedef struct {
+    uint8_t *window;        // 2^window_bits bytes
+    uint16_t mask;          // Window size - 1
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t state;
+    uint8_t bit_count;      // Valid low bits in `bits`
+    uint32_t bits;
+    uint16_t head;          // Next window position written
+    uint16_t copy_index;    // Distance back of the copy in progress
+    uint16_t copy_left;     // Bytes of the copy still to output
+} rg_heatshrink_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Prepares a decoder using @p window (2^@p window_bits bytes).
+ *
+ * @return false if the parameters are out of range (the reference limits:
+ * window_bits 4..15, lookahead_bits 3..window_bits-1).
+ */
+bool rg_heatshrink_init(rg_heatshrink_t *hs, uint8_t *window, uint8_t window_bits, uint8_t lookahead_bits);
+
+/**
+ * @brief Decodes from @p in into @p out until the input is used up or @p out is full.
+ *
+ * @param in_len   Set to the input bytes consumed; the rest must be passed again.
+ * @return Bytes written to @p out.
+ */
+size_t rg_heatshrink_decode(rg_heatshrink_t *hs, const uint8_t *in, size_t *in_len, uint8_t *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_HEATSHRINK_H_ */
@@ -0,0 +1,188 @@
+// main/services/ota/rg_ota_stream.c
+#include "rg_ota_stream.h"
+
+#include <string.h>
+
+#define ESP_IMAGE_MAGIC 0xE9
+
+static const uint8_t s_magic[4] = {'R', 'G', 'Z', '1'};
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t rg_ota_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    // Half-byte table: 64 bytes of rodata, two lookups per byte
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+    return ~crc;
+}
+
+static esp_err_t fail(rg_ota_stream_t *s, esp_err_t err)
+{
+    s->mode = RG_OTA_STREAM_FAILED;
+    return err;
+}
+
+static esp_err_t flush_chunk(rg_ota_stream_t *s)
+{
+    if (s->chunk_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = s->sink(s->ctx, s->chunk, s->chunk_len);
+    s->chunk_len = 0;
+    return err;
+}
+
+void rg_ota_stream_init(rg_ota_stream_t *s, rg_ota_sink_t sink, void *ctx)
+{
+    s->mode = RG_OTA_STREAM_HEADER;
+    s->sink = sink;
+    s->ctx = ctx;
+    s->header_len = 0;
+    s->image_size = s->payload_size = s->image_crc = 0;
+    s->crc = 0;
+    s->bytes_in = s->bytes_out = 0;
+    s->chunk_len = 0;
+}
+
+// Decides the format from the first bytes; returns how many of @p data it used
+static size_t read_header(rg_ota_stream_t *s, const uint8_t *data, size_t len, esp_err_t *err)
+{
+    *err = ESP_OK;
+    if (s->header_len == 0 && data[0] == ESP_IMAGE_MAGIC) {
+        s->mode = RG_OTA_STREAM_RAW;
+        return 0;
+    }
+    size_t n = RG_OTA_HEADER_SIZE - s->header_len;
+    n = n < len ? n : len;
+    memcpy(s->header + s->header_len, data, n);
+    s->header_len += n;
+    size_t magic_len = s->header_len < sizeof(s_magic) ? s->header_len : sizeof(s_magic);
+    if (memcmp(s->header, s_magic, magic_len) != 0) {
+        *err = ESP_ERR_INVALID_VERSION;
+        return n;
+    }
+    if (s->header_len < RG_OTA_HEADER_SIZE) {
+        return n;
+    }
+
+    uint8_t window_bits = s->header[4];
+    s->image_size = get_u32(s->header + 8);
+    s->payload_size = get_u32(s->header + 12);
+    s->image_crc = get_u32(s->header + 16);
+    if (window_bits > RG_OTA_MAX_WINDOW_BITS || !rg_heatshrink_init(&s->hs, s->window, window_bits, s->header[5])) {
+        *err = ESP_ERR_INVALID_VERSION;
+    } else if (s->image_size == 0) {
+        *err = ESP_ERR_INVALID_SIZE;
+    }
+    s->mode = RG_OTA_STREAM_COMPRESSED;
+    return n;
+}
+
+static esp_err_t feed_raw(rg_ota_stream_t *s, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t n = RG_OTA_CHUNK_SIZE - s->chunk_len;
+        n = n < len ? n : len;
+        memcpy(s->chunk + s->chunk_len, data, n);
+        s->chunk_len += n;
+        s->bytes_out += n;
+        data += n;
+        len -= n;
+        if (s->chunk_len == RG_OTA_CHUNK_SIZE) {
+            esp_err_t err = flush_chunk(s);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t feed_compressed(rg_ota_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (s->bytes_in - RG_OTA_HEADER_SIZE > s->payload_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // Once the image is complete only the zero padding of the last byte is left
+    while (len > 0 && s->bytes_out < s->image_size) {
+        size_t room = RG_OTA_CHUNK_SIZE - s->chunk_len;
+        uint32_t left = s->image_size - s->bytes_out;
+        room = room < left ? room : left;
+        size_t used = len;
+        uint8_t *out = s->chunk + s->chunk_len;
+        size_t produced = rg_heatshrink_decode(&s->hs, data, &used, out, room);
+        s->crc = rg_ota_crc32(s->crc, out, produced);
+        s->chunk_len += produced;
+        s->bytes_out += produced;
+        data += used;
+        len -= used;
+        if (s->chunk_len == RG_OTA_CHUNK_SIZE) {
+            esp_err_t err = flush_chunk(s);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_ota_stream_feed(rg_ota_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (s->mode == RG_OTA_STREAM_FAILED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len == 0) {
+        return ESP_OK;
+    }
+    if (s->mode == RG_OTA_STREAM_HEADER) {
+        esp_err_t err;
+        size_t used = read_header(s, data, len, &err);
+        if (err != ESP_OK) {
+            return fail(s, err);
+        }
+        s->bytes_in += used;
+        data += used;
+        len -= used;
+    }
+    s->bytes_in += len;
+
+    esp_err_t err = ESP_OK;
+    if (s->mode == RG_OTA_STREAM_RAW) {
+        err = feed_raw(s, data, len);
+    } else if (s->mode == RG_OTA_STREAM_COMPRESSED) {
+        err = feed_compressed(s, data, len);
+    }
+    return err == ESP_OK ? ESP_OK : fail(s, err);
+}
+
+esp_err_t rg_ota_stream_finish(rg_ota_stream_t *s)
+{
+    if (s->mode == RG_OTA_STREAM_FAILED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s->mode == RG_OTA_STREAM_HEADER || s->bytes_out == 0) {
+        return fail(s, ESP_ERR_INVALID_SIZE);
+    }
+    if (s->mode == RG_OTA_STREAM_COMPRESSED) {
+        if (s->bytes_out != s->image_size || s->bytes_in - RG_OTA_HEADER_SIZE != s->payload_size) {
+            return fail(s, ESP_ERR_INVALID_SIZE);
+        }
+        if (s->crc != s->image_crc) {
+            return fail(s, ESP_ERR_INVALID_CRC);
+        }
+    }
+    esp_err_t err = flush_chunk(s);
+    return err == ESP_OK ? ESP_OK : fail(s, err);
+}
@@ -0,0 +1,104 @@
+// main/services/ota/rg_ota_stream.h
+#ifndef RG_OTA_STREAM_H_
+#define RG_OTA_STREAM_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "rg_heatshrink.h"
+
+// Turns a downloaded update into the bytes of the app image, chunk by chunk.
+//
+// Two inputs are accepted, told apart by their first byte:
+//  - a plain app image (.bin, starts with the ESP image magic 0xE9), passed
+//    through unchanged;
+//  - a compressed image written by host/ota_pack.py: a 20-byte header
+//    followed by the heatshrink-compressed app image.
+//
+//   0  "RGZ1"
+//   4  u8  window_bits     heatshrink parameters
+//   5  u8  lookahead_bits
+//   6  u16 reserved, 0
+//   8  u32 image_size      bytes after decompression
+//   12 u32 payload_size    compressed bytes after the header
+//   16 u32 image_crc       CRC-32 (IEEE) of the decompressed image
+//
+// Integers are little-endian. Input can be fed in pieces of any size as it
+// arrives from the network; output goes to the sink in RG_OTA_CHUNK_SIZE
+// pieces (one flash sector) and the last, shorter one from
+// rg_ota_stream_finish(). Nothing holds more than a window and one chunk,
+// whatever the image size. The decompressed size and CRC are checked at
+// the end; the image itself is validated by the OTA backend.
+//
+// Portable: the sink writes to the OTA partition on the device and to
+// memory in the host tests.
+
+#define RG_OTA_HEADER_SIZE 20
+#define RG_OTA_CHUNK_SIZE 4096
+// Largest heatshrink window accepted; sizes the window buffer
+#define RG_OTA_MAX_WINDOW_BITS 12
+
+typedef esp_err_t (*rg_ota_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+typedef enum {
+    RG_OTA_STREAM_HEADER, // Waiting for the first bytes
+    RG_OTA_STREAM_RAW,
+    RG_OTA_STREAM_COMPRESSED,
+    RG_OTA_STREAM_FAILED,
+} rg_ota_stream_mode_t;
+
+typedef struct {
+    rg_ota_stream_mode_t mode;
+    rg_ota_sink_t sink;
+    void *ctx;
+    uint8_t header[RG_OTA_HEADER_SIZE];
+    uint8_t header_len;
+    uint32_t image_size;   // 0 for a plain image: unknown up front
+    uint32_t payload_size;
+    uint32_t image_crc;
+    uint32_t crc;          // Running CRC of the output
+    uint32_t bytes_in;     // Input accepted, header included
+    uint32_t bytes_out;    // Image bytes produced
+    size_t chunk_len;
+    rg_heatshrink_t hs;
+    uint8_t window[1u << RG_OTA_MAX_WINDOW_BITS];
+    uint8_t chunk[RG_OTA_CHUNK_SIZE];
+} rg_ota_stream_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void rg_ota_stream_init(rg_ota_stream_t *s, rg_ota_sink_t sink, void *ctx);
+
+/**
+ * @brief Accepts the next @p len bytes of the download.
+ *
+ * @return ESP_ERR_INVALID_VERSION if the input is neither format,
+ * ESP_ERR_INVALID_SIZE if it runs past the size in the header, or the
+ * sink's error. After an error the stream stays failed.
+ */
+esp_err_t rg_ota_stream_feed(rg_ota_stream_t *s, const uint8_t *data, size_t len);
+
+/**
+ * @brief Writes the last chunk and checks the image is complete.
+ *
+ * @return ESP_ERR_INVALID_SIZE if the download was short,
+ * ESP_ERR_INVALID_CRC if the decompressed image does not match the header.
+ */
+esp_err_t rg_ota_stream_finish(rg_ota_stream_t *s);
+
+/**
+ * @brief CRC-32 (IEEE 802.3, as zlib) of @p len bytes, continuing from @p crc (0 to start).
+ */
+uint32_t rg_ota_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_OTA_STREAM_H_ */
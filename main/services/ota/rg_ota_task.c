@@ -0,0 +1,319 @@
+// main/services/ota/rg_ota_task.c
+#include "rg_ota_task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "rg_ota_stream.h"
+#include "services/boot/rg_boot.h"
+#include <sdkconfig.h>
+
+#if CONFIG_RG_OTA_ENABLE
+
+static const char *TAG = "RG_OTA";
+
+#define BUFFER_SIZE 2048
+#define BUFFER_COUNT 4
+#define URL_MAX 128
+// Time for a client polling GET /ota to see the result before the restart
+#define RESTART_DELAY_MS 1500
+
+#if RG_OTA_SERVER_CERT_PINNED
+// CONFIG_RG_OTA_SERVER_CERT, embedded by main/CMakeLists.txt
+extern const char s_server_cert_pem[] asm("_binary_rg_ota_server_cert_pem_start");
+#endif
+
+typedef struct {
+    uint8_t index;
+    int16_t len; // 0: end of download, < 0: download failed
+} block_t;
+
+// Everything an update needs, allocated for its duration only
+typedef struct {
+    char url[URL_MAX];
+    esp_ota_handle_t handle;
+    const esp_partition_t *partition;
+    QueueHandle_t free_blocks;
+    QueueHandle_t full_blocks;
+    SemaphoreHandle_t written; // Given by the writer when it is done
+    volatile esp_err_t write_err; // Set by the writer, polled by the download task
+    rg_ota_stream_t stream;
+    uint8_t buffers[BUFFER_COUNT][BUFFER_SIZE];
+} update_t;
+
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+static rg_ota_status_t s_status;
+static int64_t s_start_us;
+
+static void set_progress(rg_ota_state_t state, const rg_ota_stream_t *stream, esp_err_t err)
+{
+    taskENTER_CRITICAL(&s_status_lock);
+    s_status.state = state;
+    if (stream) {
+        s_status.compressed = stream->mode == RG_OTA_STREAM_COMPRESSED;
+        s_status.bytes_in = stream->bytes_in;
+        s_status.bytes_out = stream->bytes_out;
+    }
+    s_status.elapsed_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+    s_status.err = err;
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+static esp_err_t partition_sink(void *ctx, const uint8_t *data, size_t len)
+{
+    update_t *u = (update_t *)ctx;
+    if (u->stream.image_size > u->partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return esp_ota_write(u->handle, data, len);
+}
+
+// Decompresses and writes to flash while the download task fetches the next blocks
+static void writer_task(void *arg)
+{
+    update_t *u = (update_t *)arg;
+    block_t block;
+    while (xQueueReceive(u->full_blocks, &block, portMAX_DELAY) == pdTRUE && block.len > 0) {
+        if (u->write_err == ESP_OK) {
+            u->write_err = rg_ota_stream_feed(&u->stream, u->buffers[block.index], block.len);
+            set_progress(RG_OTA_RUNNING, &u->stream, ESP_OK);
+        }
+        // Keep returning buffers after an error so the download task never blocks
+        xQueueSend(u->free_blocks, &block.index, portMAX_DELAY);
+    }
+    if (u->write_err == ESP_OK) {
+        u->write_err = block.len == 0 ? rg_ota_stream_finish(&u->stream) : ESP_ERR_INVALID_RESPONSE;
+    }
+    xSemaphoreGive(u->written);
+    vTaskDelete(NULL);
+}
+
+// Always ends with a terminal block, so the writer finishes whatever happens
+static esp_err_t download(update_t *u, esp_http_client_handle_t client)
+{
+    block_t block = {.index = 0, .len = -1};
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK &&
+        (esp_http_client_fetch_headers(client) < 0 || esp_http_client_get_status_code(client) != 200)) {
+        ESP_LOGE(TAG, "Download failed with HTTP status %d.", esp_http_client_get_status_code(client));
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    if (err != ESP_OK) {
+        xQueueSend(u->full_blocks, &block, portMAX_DELAY);
+        return err;
+    }
+
+    do {
+        xQueueReceive(u->free_blocks, &block.index, portMAX_DELAY);
+        int n = u->write_err == ESP_OK ? esp_http_client_read(client, (char *)u->buffers[block.index], BUFFER_SIZE) : -1;
+        if (n == 0 && !esp_http_client_is_complete_data_received(client)) {
+            n = -1; // Connection closed early
+        }
+        block.len = (int16_t)n;
+        xQueueSend(u->full_blocks, &block, portMAX_DELAY);
+    } while (block.len > 0);
+    return block.len == 0 ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+static void ota_task(void *arg)
+{
+    update_t *u = (update_t *)arg;
+    esp_err_t err = ESP_ERR_NO_MEM;
+    bool begun = false;
+    esp_http_client_handle_t client = NULL;
+
+    u->partition = esp_ota_get_next_update_partition(NULL);
+    u->free_blocks = xQueueCreate(BUFFER_COUNT, sizeof(uint8_t));
+    u->full_blocks = xQueueCreate(BUFFER_COUNT + 1, sizeof(block_t));
+    u->written = xSemaphoreCreateBinary();
+    const esp_http_client_config_t config = {
+        .url = u->url,
+        .timeout_ms = 10000,
+        .buffer_size = BUFFER_SIZE,
+#if RG_OTA_SERVER_CERT_PINNED
+        // The only certificate https downloads accept; no CA bundle
+        .cert_pem = s_server_cert_pem,
+#endif
+    };
+    if (!u->partition) {
+        err = ESP_ERR_NOT_FOUND;
+    } else if (u->free_blocks && u->full_blocks && u->written && (client = esp_http_client_init(&config))) {
+        // Sequential writes: sectors are erased as the image reaches them, not all up front
+        err = esp_ota_begin(u->partition, OTA_WITH_SEQUENTIAL_WRITES, &u->handle);
+        begun = err == ESP_OK;
+    }
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Updating %s from %s.", u->partition->label, u->url);
+        rg_ota_stream_init(&u->stream, partition_sink, u);
+        for (uint8_t i = 0; i < BUFFER_COUNT; i++) {
+            xQueueSend(u->free_blocks, &i, 0);
+        }
+        if (xTaskCreate(writer_task, "ota_write", 3072, u, uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            err = download(u, client);
+            xSemaphoreTake(u->written, portMAX_DELAY);
+            err = u->write_err != ESP_OK ? u->write_err : err;
+        }
+    }
+    if (err == ESP_OK) {
+        begun = false;
+        // Validates the image: its SHA-256, and its signature with CONFIG_SECURE_SIGNED_ON_UPDATE
+        err = esp_ota_end(u->handle);
+    }
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(u->partition);
+    }
+    if (begun) {
+        esp_ota_abort(u->handle);
+    }
+    if (client) {
+        esp_http_client_cleanup(client);
+    }
+
+    set_progress(err == ESP_OK ? RG_OTA_DONE : RG_OTA_FAILED, &u->stream, err);
+    rg_ota_status_t status;
+    rg_ota_task_status(&status);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Update written in %lu ms: %lu bytes downloaded%s for a %lu byte image. Restarting.",
+                 (unsigned long)status.elapsed_ms, (unsigned long)status.bytes_in,
+                 status.compressed ? " (compressed)" : "", (unsigned long)status.bytes_out);
+    } else {
+        ESP_LOGE(TAG, "Update failed after %lu ms: %s", (unsigned long)status.elapsed_ms, esp_err_to_name(err));
+    }
+
+    if (u->free_blocks) {
+        vQueueDelete(u->free_blocks);
+    }
+    if (u->full_blocks) {
+        vQueueDelete(u->full_blocks);
+    }
+    if (u->written) {
+        vSemaphoreDelete(u->written);
+    }
+    free(u);
+
+    if (err == ESP_OK) {
+        vTaskDelay(pdMS_TO_TICKS(RESTART_DELAY_MS));
+        esp_restart();
+    }
+    vTaskDelete(NULL);
+}
+
+// Nothing boots unless its origin is proven: a signed app may come from
+// anywhere, an unsigned one only over TLS from the server whose certificate
+// is pinned. The SHA-256 esp_ota_end() checks only proves the copy is intact.
+static esp_err_t check_source(const char *url)
+{
+#if CONFIG_SECURE_SIGNED_ON_UPDATE
+    return strncmp(url, "https://", 8) == 0 || strncmp(url, "http://", 7) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+#elif RG_OTA_SERVER_CERT_PINNED
+    return strncmp(url, "https://", 8) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t rg_ota_task_start(const char *url)
+{
+    esp_err_t err = check_source(url);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (strlen(url) >= URL_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    taskENTER_CRITICAL(&s_status_lock);
+    bool busy = s_status.state == RG_OTA_RUNNING || s_status.state == RG_OTA_DONE;
+    if (!busy) {
+        memset(&s_status, 0, sizeof(s_status));
+        s_status.state = RG_OTA_RUNNING;
+    }
+    taskEXIT_CRITICAL(&s_status_lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_start_us = esp_timer_get_time();
+
+    // Transient, like the update itself: about 17 KiB that only exist while it runs
+    update_t *u = (update_t *)calloc(1, sizeof(update_t));
+    if (u) {
+        strcpy(u->url, url);
+    }
+    if (!u || xTaskCreate(ota_task, "ota", 4096, u, 2, NULL) != pdPASS) {
+        free(u);
+        set_progress(RG_OTA_FAILED, NULL, ESP_ERR_NO_MEM);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void rg_ota_task_status(rg_ota_status_t *status)
+{
+    taskENTER_CRITICAL(&s_status_lock);
+    *status = s_status;
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+static esp_timer_handle_t s_confirm_timer = NULL;
+
+static void confirm_timer_cb(void *arg)
+{
+    (void)arg;
+    if (rg_boot_mark_us(RG_BOOT_MARK_FIRST_SAMPLE) && rg_boot_mark_us(RG_BOOT_MARK_GOT_IP)) {
+        esp_timer_stop(s_confirm_timer);
+        esp_ota_mark_app_valid_cancel_rollback();
+        ESP_LOGI(TAG, "Updated image confirmed.");
+    } else if (esp_timer_get_time() > (int64_t)CONFIG_RG_OTA_CONFIRM_TIMEOUT_S * 1000000) {
+        ESP_LOGE(TAG, "Updated image not healthy after %d s, rolling back.", CONFIG_RG_OTA_CONFIRM_TIMEOUT_S);
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+}
+
+esp_err_t rg_ota_task_confirm(void)
+{
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Running an updated image on probation for up to %d s.", CONFIG_RG_OTA_CONFIRM_TIMEOUT_S);
+    const esp_timer_create_args_t args = {
+        .callback = confirm_timer_cb,
+        .name = "ota_confirm",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_confirm_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_confirm_timer, 500 * 1000);
+    }
+    return err;
+}
+
+#else // !CONFIG_RG_OTA_ENABLE
+
+esp_err_t rg_ota_task_start(const char *url)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void rg_ota_task_status(rg_ota_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+}
+
+esp_err_t rg_ota_task_confirm(void)
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_RG_OTA_ENABLE
@@ -0,0 +1,67 @@
+// main/services/ota/rg_ota_task.h
+#ifndef RG_OTA_TASK_H_
+#define RG_OTA_TASK_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+    RG_OTA_IDLE,
+    RG_OTA_RUNNING,
+    RG_OTA_DONE,   // Image written and selected; the node restarts in a moment
+    RG_OTA_FAILED,
+} rg_ota_state_t;
+
+typedef struct {
+    rg_ota_state_t state;
+    bool compressed;    // The download is a compressed image (see rg_ota_stream.h)
+    uint32_t bytes_in;  // Downloaded so far
+    uint32_t bytes_out; // Image bytes written to the partition
+    uint32_t elapsed_ms;
+    esp_err_t err;      // Why the last update failed
+} rg_ota_status_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Downloads the image at @p url into the inactive OTA slot and restarts into it.
+ *
+ * Runs in the background: a download task and a writer task with a few
+ * buffers between them, so the network read overlaps decompression and
+ * flash writes. Plain and compressed images are accepted.
+ *
+ * Only images whose origin can be proven are taken: with
+ * CONFIG_SECURE_SIGNED_ON_UPDATE any http:// or https:// URL (the signature
+ * is checked before the image is selected), otherwise only https:// from the
+ * server pinned with CONFIG_RG_OTA_SERVER_CERT.
+ *
+ * @return ESP_ERR_INVALID_ARG for a URL those rules refuse,
+ *         ESP_ERR_NOT_SUPPORTED if neither is configured,
+ *         ESP_ERR_INVALID_STATE if an update is already running.
+ */
+esp_err_t rg_ota_task_start(const char *url);
+
+void rg_ota_task_status(rg_ota_status_t *status);
+
+/**
+ * @brief Confirms or rolls back a freshly updated image.
+ *
+ * Does nothing unless the running image is on probation after an update.
+ * Then it is marked valid once the node has read a sample and got an IP
+ * address (the boot milestones), and rolled back to the previous image if
+ * that has not happened within CONFIG_RG_OTA_CONFIRM_TIMEOUT_S. A crash
+ * before that rolls back through the bootloader.
+ */
+esp_err_t rg_ota_task_confirm(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_OTA_TASK_H_ */
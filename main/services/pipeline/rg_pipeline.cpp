@@ -0,0 +1,98 @@
+// main/services/pipeline/rg_pipeline.cpp
+#include "rg_pipeline.h"
+
+#include <math.h>
+
+#include "services/filter/rg_filter_chains.h"
+#include "services/stats/rg_stats.h"
+
+namespace {
+
+// Per-channel filter chains chosen in Kconfig, run in fixed point
+rg_filter_temperature_guard_t s_temperature_guard;       // 0.01 degC
+rg_filter_humidity_guard_t s_humidity_guard;             // 0.01 %RH
+rg_filter_pressure_guard_t s_pressure_guard;             // Pa
+rg_filter_temperature_smoother_t s_temperature_smoother;
+rg_filter_humidity_smoother_t s_humidity_smoother;
+rg_filter_pressure_smoother_t s_pressure_smoother;
+
+rg_sampler_t s_sampler;
+rg_pipeline_port_t s_port;
+
+void publish(const rg_event_t *event)
+{
+    if (s_port.publish) {
+        s_port.publish(s_port.ctx, event);
+    }
+}
+
+} // namespace
+
+void rg_pipeline_init(const rg_sampler_config_t *config, const rg_pipeline_port_t *port)
+{
+    s_temperature_guard.reset();
+    s_humidity_guard.reset();
+    s_pressure_guard.reset();
+    s_temperature_smoother.reset();
+    s_humidity_smoother.reset();
+    s_pressure_smoother.reset();
+    rg_sampler_init(&s_sampler, config);
+    s_port = port ? *port : rg_pipeline_port_t{};
+}
+
+void rg_pipeline_reconfigure(const rg_sampler_config_t *config)
+{
+    rg_sampler_reconfigure(&s_sampler, config);
+}
+
+bool rg_pipeline_process(int64_t now_us, uint32_t timestamp, float temperature, float humidity, float pressure,
+                         rg_event_sample_t *out)
+{
+    // Drop HVAC spikes first; change detection and alarms react to what is left at once
+    const int32_t t = s_temperature_guard(lroundf(temperature * 100.0f));
+    const int32_t h = s_humidity_guard(lroundf(humidity * 100.0f));
+    const int32_t p = s_pressure_guard(lroundf(pressure * 100.0f));
+    const float values[RG_SAMPLER_CHANNEL_COUNT] = {t / 100.0f, h / 100.0f, p / 100.0f};
+
+    // Only the stored and published values are smoothed, so the smoothers' lag never delays a reaction
+    rg_event_t event = {};
+    event.time_us = now_us;
+    event.sample.temperature = s_temperature_smoother(t) / 100.0f;
+    event.sample.humidity = s_humidity_smoother(h) / 100.0f;
+    event.sample.pressure = s_pressure_smoother(p) / 100.0f;
+    event.sample.timestamp = timestamp;
+    if (out) {
+        *out = event.sample;
+    }
+
+    // Local alarms see every reading, not only the ones the sampler publishes
+    if (s_port.evaluate_rules) {
+        s_port.evaluate_rules(s_port.ctx, now_us, values[RG_SAMPLER_TEMPERATURE], values[RG_SAMPLER_HUMIDITY],
+                              values[RG_SAMPLER_PRESSURE]);
+    }
+
+    // The statistics, the history and the flash log weigh every reading alike; the
+    // sampler publishes mostly while the room changes, which would skew them
+    rg_stats_add(timestamp, event.sample.temperature, event.sample.humidity, event.sample.pressure);
+    event.type = RG_EVENT_READING;
+    publish(&event);
+
+    const float smoothed[RG_SAMPLER_CHANNEL_COUNT] = {event.sample.temperature, event.sample.humidity,
+                                                      event.sample.pressure};
+    if (!rg_sampler_update_smoothed(&s_sampler, (uint32_t)(now_us / 1000), values, smoothed)) {
+        return false;
+    }
+    event.type = RG_EVENT_SAMPLE;
+    publish(&event);
+    return true;
+}
+
+uint32_t rg_pipeline_next_interval_ms(void)
+{
+    return rg_sampler_next_interval_ms(&s_sampler);
+}
+
+const rg_sampler_t *rg_pipeline_sampler(void)
+{
+    return &s_sampler;
+}
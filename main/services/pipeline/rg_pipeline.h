@@ -0,0 +1,81 @@
+// main/services/pipeline/rg_pipeline.h
+#ifndef RG_PIPELINE_H_
+#define RG_PIPELINE_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "services/bus/rg_event_bus.h"
+#include "services/sampler/rg_sampler.h"
+
+// What happens to one sensor reading, in the order the sensor task runs it:
+//
+//   guards -> smoothers -> rules -> stats -> RG_EVENT_READING
+//          -> sampler -> RG_EVENT_SAMPLE (if published)
+//
+// The guards drop outliers; the rules and the sampler's change detection see
+// their output at once. The smoothers only shape the values that are stored
+// and published, so their lag never delays a reaction. The rolling statistics
+// and every RG_EVENT_READING carry the smoothed value of every reading; the
+// sampler decides which readings also go out as an RG_EVENT_SAMPLE.
+//
+// The filters and the sampler are static, one pipeline per node: bme280_task
+// on the device, each virtual node of the fleet simulator and the allocation
+// audit all run this same code. The rules and the event bus are reached
+// through rg_pipeline_port_t, so the host can plug in the portable engines
+// where the device uses the rules and bus tasks.
+//
+// Single writer: only the task that calls rg_pipeline_process() may use it.
+
+typedef struct {
+    // Evaluates the local rules against the guarded reading; may be NULL
+    void (*evaluate_rules)(void *ctx, int64_t now_us, float temperature, float humidity, float pressure);
+    // Hands an event to the consumers; may be NULL
+    void (*publish)(void *ctx, const rg_event_t *event);
+    void *ctx;
+} rg_pipeline_port_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Resets the filters and starts the sampler with @p config.
+ *
+ * @param port Copied; NULL runs the pipeline without rules or consumers.
+ */
+void rg_pipeline_init(const rg_sampler_config_t *config, const rg_pipeline_port_t *port);
+
+/**
+ * @brief Applies a changed sampler configuration; the filters keep their state.
+ */
+void rg_pipeline_reconfigure(const rg_sampler_config_t *config);
+
+/**
+ * @brief Runs one reading through the pipeline.
+ *
+ * @param now_us Time of the reading in us; the sampler and the rules run on it.
+ * @param timestamp Seconds on the rg_history time line, for the stats and events.
+ * @param out If not NULL, receives the smoothed reading.
+ * @return true if the sampler published the reading as an RG_EVENT_SAMPLE.
+ */
+bool rg_pipeline_process(int64_t now_us, uint32_t timestamp, float temperature, float humidity, float pressure,
+                         rg_event_sample_t *out);
+
+/**
+ * @brief Delay before the next reading, as chosen by the sampler.
+ */
+uint32_t rg_pipeline_next_interval_ms(void);
+
+/**
+ * @brief The sampler, for its configuration and counters.
+ */
+const rg_sampler_t *rg_pipeline_sampler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_PIPELINE_H_ */
@@ -1,61 +1,590 @@
 #include "esp_http_server.h"
-#include <string>
-#include <nlohmann/json.hpp>
+#include "esp_log.h"
+#include <stdlib.h>
 #include "constants.h"
+#include "services/json/rg_json_writer.h"
 #include "services/shared_data/shared_data.h"
+#include "services/shared_data/shared_data_json.h"
+#include "services/sse/rg_sse.h"
+#include "services/history/rg_history.h"
+#include "services/metrics/rg_metrics.h"
+#include "services/http/rg_http_router.h"
+#include "services/boot/rg_boot.h"
+#include "services/ota/rg_ota_task.h"
+#include "services/stats/rg_stats_json.h"
+#include "services/config/rg_config_json.h"
+#include "services/config/rg_config_task.h"
+#include "esp_timer.h"
+#include <sdkconfig.h>
+#if defined(ESP_PLATFORM)
+#include "lwip/sockets.h"
+#endif
 
-static const std::string HTEMPTAG = std::string(DEVICE_NAME) + "-" + DEVICE_VERSION + "::HttpServer";
-static const char *HTTP_TAG = HTEMPTAG.c_str();
-
-static esp_err_t my_get_handler(httpd_req_t *req){
-
-	/* our custom page sits at /helloworld in this example */
-	if(strcmp(req->uri, "/") == 0){
-
-        // Larger response buffer
-        char response[1024];
-
-        // Generate HTML response with dynamic data
-        snprintf(response, sizeof(response),
-            "<html><body>"
-            "<h1>%s-%s Sensor Data</h1>"
-            "<p id=\"ip_address\">IP Address: %s</p>"
-            "<p id=\"temperature\">Temperature: %.2f°C</p>"
-            "<p id=\"humidity\">Humidity: %.2f%%</p>"
-            "<p id=\"pressure\">Pressure: %.2f hPa</p>"
-            "<a href=\"/settings/\">Settings</a>"
-            "<script>"
-            "setInterval(() => {"
-            "    fetch('/data').then(response => response.json()).then(data => {"
-            "        document.getElementById('ip_address').innerText = 'IP Address: ' + data.ip_address;"
-            "        document.getElementById('temperature').innerText = 'Temperature: ' + data.temperature.toFixed(2) + '°C';"
-            "        document.getElementById('humidity').innerText = 'Humidity: ' + data.humidity.toFixed(2) + '%%';" // Double %% escapes the %
-            "        document.getElementById('pressure').innerText = 'Pressure: ' + data.pressure.toFixed(2) + ' hPa';"
-            "    });"
-            "}, 5000);"
-            "</script>"
-            "</body></html>",
-            DEVICE_NAME, DEVICE_VERSION, shared_data.ip_address, shared_data.temperature, shared_data.humidity, shared_data.pressure);
-        // Set response type and send response
-        httpd_resp_set_type(req, "text/html");
-        httpd_resp_send(req, response, strlen(response));
-    }
-    else if(strcmp(req->uri, "/data") == 0){
-        // Create JSON response
-        nlohmann::json json_data;
-        json_data["temperature"] = shared_data.temperature;
-        json_data["humidity"] = shared_data.humidity;
-        json_data["pressure"] = shared_data.pressure;
-        json_data["ip_address"] = shared_data.ip_address;
-
-        // Set response type and send JSON response
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, json_data.dump().c_str(), json_data.dump().length());
-    }
-	else{
-		/* send a 404 otherwise */
-		httpd_resp_send_404(req);
-	}
-
-	return ESP_OK;
+static const char *HTTP_TAG = DEVICE_NAME "-" DEVICE_VERSION "::HttpServer";
+
+// Appends `value` / 10^decimals as a decimal number, without going through float
+static int format_fixed(char *out, size_t size, int32_t value, int decimals)
+{
+    int32_t scale = decimals == 1 ? 10 : 100;
+    const char *sign = value < 0 ? "-" : "";
+    uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return snprintf(out, size, "%s%lu.%0*lu", sign, (unsigned long)(magnitude / scale), decimals,
+                    (unsigned long)(magnitude % scale));
+}
+
+// State for streaming /history records in chunks of a fixed stack buffer
+typedef struct {
+    httpd_req_t *req;
+    rg_history_tier_t tier;
+    bool first;
+    esp_err_t err;
+    size_t len;
+    char buf[1024];
+} history_stream_t;
+
+static bool history_stream_flush(history_stream_t *stream)
+{
+    if (stream->len > 0 && stream->err == ESP_OK) {
+        stream->err = httpd_resp_send_chunk(stream->req, stream->buf, stream->len);
+    }
+    stream->len = 0;
+    return stream->err == ESP_OK;
+}
+
+static bool history_stream_record(const rg_history_record_t *record, void *ctx)
+{
+    history_stream_t *stream = (history_stream_t *)ctx;
+    char row[160];
+    int n = snprintf(row, sizeof(row), "%s[%lu", stream->first ? "" : ",", (unsigned long)record->timestamp);
+
+    if (stream->tier == RG_HISTORY_TIER_RAW) {
+        n += snprintf(row + n, sizeof(row) - n, ",");
+        n += format_fixed(row + n, sizeof(row) - n, record->temperature[RG_HISTORY_MEAN], 2);
+        n += snprintf(row + n, sizeof(row) - n, ",");
+        n += format_fixed(row + n, sizeof(row) - n, record->humidity[RG_HISTORY_MEAN], 2);
+        n += snprintf(row + n, sizeof(row) - n, ",");
+        n += format_fixed(row + n, sizeof(row) - n, record->pressure[RG_HISTORY_MEAN], 1);
+    } else {
+        n += snprintf(row + n, sizeof(row) - n, ",%u", record->count);
+        for (int i = 0; i < 3; i++) {
+            n += snprintf(row + n, sizeof(row) - n, ",");
+            n += format_fixed(row + n, sizeof(row) - n, record->temperature[i], 2);
+        }
+        for (int i = 0; i < 3; i++) {
+            n += snprintf(row + n, sizeof(row) - n, ",");
+            n += format_fixed(row + n, sizeof(row) - n, record->humidity[i], 2);
+        }
+        for (int i = 0; i < 3; i++) {
+            n += snprintf(row + n, sizeof(row) - n, ",");
+            n += format_fixed(row + n, sizeof(row) - n, record->pressure[i], 1);
+        }
+    }
+    n += snprintf(row + n, sizeof(row) - n, "]");
+    stream->first = false;
+
+    if (stream->len + n > sizeof(stream->buf) && !history_stream_flush(stream)) {
+        return false;
+    }
+    memcpy(stream->buf + stream->len, row, n);
+    stream->len += n;
+    return true;
+}
+
+// GET /history?tier=raw|minute|hour&from=<s>&to=<s>
+// Timestamps are on the rg_history time line; "now" in the response is the current one.
+static esp_err_t send_history(httpd_req_t *req, const rg_http_query_t *query)
+{
+    rg_history_tier_t tier = RG_HISTORY_TIER_MINUTE;
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+
+    const char *tier_name = rg_http_query_get(query, "tier");
+    if (tier_name && !rg_history_tier_from_name(tier_name, &tier)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "tier must be raw, minute or hour");
+    }
+    if (rg_http_query_get_u32(query, "from", &from) == ESP_ERR_INVALID_ARG ||
+        rg_http_query_get_u32(query, "to", &to) == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from and to must be timestamps in seconds");
+    }
+
+    history_stream_t stream;
+    stream.req = req;
+    stream.tier = tier;
+    stream.first = true;
+    stream.err = ESP_OK;
+    stream.len = snprintf(stream.buf, sizeof(stream.buf),
+                          "{\"tier\":\"%s\",\"period\":%lu,\"now\":%lu,\"columns\":%s,\"records\":[",
+                          rg_history_tier_name(tier), (unsigned long)rg_history_period(tier),
+                          (unsigned long)rg_history_now(),
+                          tier == RG_HISTORY_TIER_RAW
+                              ? "[\"t\",\"temperature\",\"humidity\",\"pressure\"]"
+                              : "[\"t\",\"n\",\"temperature_min\",\"temperature_max\",\"temperature_mean\","
+                                "\"humidity_min\",\"humidity_max\",\"humidity_mean\","
+                                "\"pressure_min\",\"pressure_max\",\"pressure_mean\"]");
+
+    httpd_resp_set_type(req, "application/json");
+    rg_history_query(tier, from, to, history_stream_record, &stream);
+
+    if (stream.len + 2 > sizeof(stream.buf)) {
+        history_stream_flush(&stream);
+    }
+    memcpy(stream.buf + stream.len, "]}", 2);
+    stream.len += 2;
+    if (!history_stream_flush(&stream)) {
+        ESP_LOGW(HTTP_TAG, "Failed to send /history: %s", esp_err_to_name(stream.err));
+        return stream.err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Dashboard page, gzipped at build time (see main/CMakeLists.txt) and served from rodata
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+
+// GET /: the page is static; live values come from /events and /data only,
+// so browsers can cache it and revalidate with a cheap 304.
+static esp_err_t send_dashboard(httpd_req_t *req, const rg_http_query_t *query)
+{
+    // ETag is the FNV-1a hash of the embedded blob, computed on first use
+    static char etag[12];
+    if (etag[0] == '\0') {
+        uint32_t hash = 2166136261u;
+        for (const uint8_t *p = index_html_gz_start; p < index_html_gz_end; p++) {
+            hash = (hash ^ *p) * 16777619u;
+        }
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)hash);
+    }
+
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=600");
+
+    char if_none_match[sizeof(etag)];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)index_html_gz_start, index_html_gz_end - index_html_gz_start);
+}
+
+// GET /data: the latest sample as JSON
+static esp_err_t send_data(httpd_req_t *req, const rg_http_query_t *query)
+{
+    // One consistent snapshot per request; never blocks the sensor task
+    shared_data_t snapshot;
+    shared_data_read(&snapshot);
+
+    // Serialize into a stack buffer: no heap, one pass
+    char body[192];
+    rg_json_writer json(body, sizeof(body));
+    shared_data_write_json(json, snapshot);
+    if (!json.ok()) {
+        return httpd_resp_send_500(req);
+    }
+
+    // Set response type and send JSON response
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.data(), json.size());
+    if (snapshot.sequence > 0) {
+        rg_boot_mark(RG_BOOT_MARK_FIRST_SERVED, esp_timer_get_time());
+    }
+    return ESP_OK;
+}
+
+static esp_err_t metrics_sink(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+// GET /stats: rolling min/max/mean/stddev per channel, from the last published snapshot
+static esp_err_t send_stats(httpd_req_t *req, const rg_http_query_t *query)
+{
+    rg_stats_snapshot_t snapshot;
+    rg_stats_read(&snapshot);
+
+    // Up to nine windows: streamed in chunks rather than held on the stack whole
+    char buf[256];
+    rg_json_writer json(buf, sizeof(buf), metrics_sink, req);
+    httpd_resp_set_type(req, "application/json");
+    rg_stats_write_json(json, snapshot, rg_history_now());
+    if (!json.flush()) {
+        ESP_LOGW(HTTP_TAG, "Failed to send /stats: %s", esp_err_to_name(json.error()));
+        return json.error();
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /metrics: Prometheus text exposition, streamed in chunks
+static esp_err_t send_metrics(httpd_req_t *req, const rg_http_query_t *query)
+{
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    esp_err_t err = rg_metrics_export(metrics_sink, req);
+    if (err != ESP_OK) {
+        ESP_LOGW(HTTP_TAG, "Failed to send /metrics: %s", esp_err_to_name(err));
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /events: Server-Sent Events stream of new samples
+static esp_err_t send_events(httpd_req_t *req, const rg_http_query_t *query)
+{
+    return rg_sse_handle_request(req);
+}
+
+// GET /ota: progress of the running or last update
+static esp_err_t send_ota_status(httpd_req_t *req, const rg_http_query_t *query)
+{
+    static const char *const states[] = {"idle", "running", "done", "failed"};
+    rg_ota_status_t status;
+    rg_ota_task_status(&status);
+
+    char body[192];
+    rg_json_writer json(body, sizeof(body));
+    json.begin_object();
+    json.key("state");
+    json.value(states[status.state]);
+    json.key("compressed");
+    json.value(status.compressed);
+    json.key("bytes_in");
+    json.value(status.bytes_in);
+    json.key("bytes_out");
+    json.value(status.bytes_out);
+    json.key("elapsed_ms");
+    json.value(status.elapsed_ms);
+    json.key("error");
+    json.value(status.state == RG_OTA_FAILED ? esp_err_to_name(status.err) : "");
+    json.end_object();
+    if (!json.ok()) {
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json.data(), json.size());
+}
+
+// True if the request carries "Authorization: Bearer <expected>". An empty
+// token matches nothing, so a route that changes the node stays closed until
+// one is configured.
+static bool authorized(httpd_req_t *req, const char *expected)
+{
+    static const char prefix[] = "Bearer ";
+    const size_t prefix_len = sizeof(prefix) - 1;
+    const size_t len = strlen(expected);
+    char value[prefix_len + 64 + 1];
+    if (len == 0 || httpd_req_get_hdr_value_str(req, "Authorization", value, sizeof(value)) != ESP_OK ||
+        strncmp(value, prefix, prefix_len) != 0 || strlen(value + prefix_len) != len) {
+        return false;
+    }
+    // Compares every byte, so the response time does not tell how much of a guess was right
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= (uint8_t)(value[prefix_len + i] ^ expected[i]);
+    }
+    return diff == 0;
+}
+
+// POST /ota?url=<image URL> with "Authorization: Bearer <CONFIG_RG_OTA_TOKEN>":
+// starts an update in the background
+static esp_err_t start_ota(httpd_req_t *req, const rg_http_query_t *query)
+{
+    if (CONFIG_RG_OTA_TOKEN[0] == '\0') {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Updates are disabled: no CONFIG_RG_OTA_TOKEN");
+    }
+    if (!authorized(req, CONFIG_RG_OTA_TOKEN)) {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "token missing or wrong");
+    }
+    const char *url = rg_http_query_get(query, "url");
+    if (!url) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "url missing");
+    }
+    esp_err_t err = rg_ota_task_start(url);
+    if (err == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "url must be https:// (or http:// for signed images)");
+    }
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Updates need a pinned certificate or signed images");
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "An update is already running", HTTPD_RESP_USE_STRLEN);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(HTTP_TAG, "Failed to start the update: %s", esp_err_to_name(err));
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_status(req, "202 Accepted");
+    return send_ota_status(req, query);
+}
+
+static esp_err_t send_ota(httpd_req_t *req, const rg_http_query_t *query)
+{
+    return req->method == HTTP_POST ? start_ota(req, query) : send_ota_status(req, query);
+}
+
+// GET /settings: every runtime setting, secrets as null
+static esp_err_t send_settings_values(httpd_req_t *req, const rg_http_query_t *query)
+{
+    char buf[256];
+    rg_json_writer json(buf, sizeof(buf), metrics_sink, req);
+    httpd_resp_set_type(req, "application/json");
+    rg_config_write_json(json, *rg_config_task_config());
+    if (!json.flush()) {
+        ESP_LOGW(HTTP_TAG, "Failed to send /settings: %s", esp_err_to_name(json.error()));
+        return json.error();
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Longest form body POST /settings accepts: every string setting at its longest
+// with each byte percent-encoded, and every field's "&name=" with a number
+#define SETTINGS_BODY_MAX                                                                                    \
+    (3 * (RG_SETTINGS_SSID_MAX + RG_SETTINGS_PASSWORD_MAX + RG_SETTINGS_RULES_MAX) +                          \
+     RG_SETTING_COUNT * (RG_CONFIG_NAME_MAX + 2 + 11) + 1)
+
+typedef struct {
+    size_t count;
+    const char *names[RG_CONFIG_MAX_SETTINGS];
+    const char *values[RG_CONFIG_MAX_SETTINGS];
+} settings_form_t;
+
+static esp_err_t settings_field(void *ctx, const char *key, const char *value)
+{
+    settings_form_t *form = (settings_form_t *)ctx;
+    if (form->count == RG_CONFIG_MAX_SETTINGS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    form->names[form->count] = key;
+    form->values[form->count] = value;
+    form->count++;
+    return ESP_OK;
+}
+
+// POST /settings with "Authorization: Bearer <CONFIG_RG_SETTINGS_TOKEN>" and a form body of
+// name=value pairs: all of them apply at once, or none if one is rejected; answers with the new settings
+static esp_err_t change_settings(httpd_req_t *req, const rg_http_query_t *query)
+{
+    if (CONFIG_RG_SETTINGS_TOKEN[0] == '\0') {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Changes are disabled: no CONFIG_RG_SETTINGS_TOKEN");
+    }
+    if (!authorized(req, CONFIG_RG_SETTINGS_TOKEN)) {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "token missing or wrong");
+    }
+    if (req->content_len >= SETTINGS_BODY_MAX) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too large");
+    }
+    char body[SETTINGS_BODY_MAX];
+    size_t len = 0;
+    while (len < req->content_len) {
+        int n = httpd_req_recv(req, body + len, req->content_len - len);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        len += (size_t)n;
+    }
+    body[len] = '\0';
+
+    settings_form_t form;
+    form.count = 0;
+    if (rg_http_form_parse(body, settings_field, &form) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed form or too many fields");
+    }
+    size_t bad = 0;
+    esp_err_t err = rg_config_task_set(form.names, form.values, form.count, &bad);
+    if (err == ESP_ERR_NOT_FOUND || err == ESP_ERR_INVALID_ARG) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%s setting: %.*s", err == ESP_ERR_NOT_FOUND ? "Unknown" : "Invalid value for",
+                 RG_CONFIG_NAME_MAX + 1, form.names[bad]);
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(HTTP_TAG, "Failed to change settings: %s", esp_err_to_name(err));
+        return httpd_resp_send_500(req);
+    }
+    return send_settings_values(req, query);
+}
+
+static esp_err_t send_settings(httpd_req_t *req, const rg_http_query_t *query)
+{
+    return req->method == HTTP_POST ? change_settings(req, query) : send_settings_values(req, query);
+}
+
+// Latency histograms, in export order; the last one takes requests that match no route
+enum {
+    ROUTE_DASHBOARD,
+    ROUTE_DATA,
+    ROUTE_EVENTS,
+    ROUTE_HISTORY,
+    ROUTE_METRICS,
+    ROUTE_OTA,
+    ROUTE_SETTINGS,
+    ROUTE_STATS,
+    ROUTE_NOT_FOUND,
+    ROUTE_COUNT,
+};
+
+#define HTTP_ROUTE_LATENCY(route)                                                                   \
+    RG_METRICS_HISTOGRAM_INIT("rg_http_request_duration_seconds", "Time spent in the request handler.", \
+                              "route=\"" route "\"", rg_metrics_latency_bounds_us)
+
+static rg_metrics_histogram_t s_route_latency[ROUTE_COUNT] = {
+    HTTP_ROUTE_LATENCY("/"),         HTTP_ROUTE_LATENCY("/data"),    HTTP_ROUTE_LATENCY("/events"),
+    HTTP_ROUTE_LATENCY("/history"),  HTTP_ROUTE_LATENCY("/metrics"), HTTP_ROUTE_LATENCY("/ota"),
+    HTTP_ROUTE_LATENCY("/settings"), HTTP_ROUTE_LATENCY("/stats"),   HTTP_ROUTE_LATENCY("other"),
+};
+
+static constexpr rg_http_route_t s_routes[] = {
+    {"/", RG_HTTP_GET, send_dashboard, &s_route_latency[ROUTE_DASHBOARD]},
+    {"/data", RG_HTTP_GET, send_data, &s_route_latency[ROUTE_DATA]},
+    {"/events", RG_HTTP_GET, send_events, &s_route_latency[ROUTE_EVENTS]},
+    {"/history", RG_HTTP_GET, send_history, &s_route_latency[ROUTE_HISTORY]},
+    {"/metrics", RG_HTTP_GET, send_metrics, &s_route_latency[ROUTE_METRICS]},
+    {"/ota", RG_HTTP_GET | RG_HTTP_POST, send_ota, &s_route_latency[ROUTE_OTA]},
+    // The dashboard links to "/settings/"
+    {"/settings", RG_HTTP_GET | RG_HTTP_POST, send_settings, &s_route_latency[ROUTE_SETTINGS]},
+    {"/settings/", RG_HTTP_GET | RG_HTTP_POST, send_settings, &s_route_latency[ROUTE_SETTINGS]},
+    {"/stats", RG_HTTP_GET, send_stats, &s_route_latency[ROUTE_STATS]},
+};
+
+static constexpr rg_http_router<sizeof(s_routes) / sizeof(s_routes[0])> s_router(s_routes);
+static_assert(s_router.ok(), "route paths must be distinct");
+
+#if defined(ESP_PLATFORM)
+// When each socket last carried a request, to pick the idlest keep-alive connection
+static int64_t s_socket_last_use_us[CONFIG_LWIP_MAX_SOCKETS];
+
+static int64_t *socket_last_use(int fd)
+{
+    const int i = fd - LWIP_SOCKET_OFFSET;
+    return i >= 0 && i < CONFIG_LWIP_MAX_SOCKETS ? &s_socket_last_use_us[i] : NULL;
+}
+
+static void socket_touch(int fd, int64_t now_us)
+{
+    int64_t *last_use = socket_last_use(fd);
+    if (last_use) {
+        *last_use = now_us;
+    }
+}
+
+// open_fn of the server: once a new connection has taken the last slot, the
+// keep-alive connection idle the longest is closed so the next client finds
+// one. /events streams (the sessions with a context) are never chosen; when
+// only they are left, new clients are refused until one of them ends.
+static esp_err_t keep_a_socket_free(httpd_handle_t server, int new_fd)
+{
+    socket_touch(new_fd, esp_timer_get_time());
+    int fds[CONFIG_RG_HTTP_MAX_SOCKETS];
+    size_t count = CONFIG_RG_HTTP_MAX_SOCKETS;
+    if (httpd_get_client_list(server, &count, fds) != ESP_OK || count < CONFIG_RG_HTTP_MAX_SOCKETS) {
+        return ESP_OK;
+    }
+    int idlest = -1;
+    int64_t idlest_use = 0;
+    for (size_t i = 0; i < count; i++) {
+        const int64_t *last_use = socket_last_use(fds[i]);
+        if (fds[i] == new_fd || !last_use || httpd_sess_get_ctx(server, fds[i])) {
+            continue;
+        }
+        if (idlest < 0 || *last_use < idlest_use) {
+            idlest = fds[i];
+            idlest_use = *last_use;
+        }
+    }
+    if (idlest >= 0) {
+        httpd_sess_trigger_close(server, idlest);
+    }
+    return ESP_OK;
+}
+#endif
+
+// Serves every request: of rg_http_server_start()'s server, or of the Wi-Fi manager's (see rg_wifi.h)
+static esp_err_t rg_http_handle_request(httpd_req_t *req)
+{
+    // Handlers run in the HTTP server task only
+    static bool s_latency_registered = false;
+    if (!s_latency_registered) {
+        // The registry lists the newest first; register backwards to export in route order
+        for (int i = ROUTE_COUNT - 1; i >= 0; i--) {
+            rg_metrics_register_histogram(&s_route_latency[i]);
+        }
+        s_latency_registered = true;
+    }
+
+    const int64_t start = esp_timer_get_time();
+#if defined(ESP_PLATFORM)
+    socket_touch(httpd_req_to_sockfd(req), start);
+#endif
+    const rg_http_route_t *route = s_router.find(req->uri);
+    rg_metrics_histogram_t *latency = &s_route_latency[ROUTE_NOT_FOUND];
+    esp_err_t ret = ESP_OK;
+    // Errors are answered without failing the request, so the connection stays open
+    if (!route) {
+        httpd_resp_send_404(req);
+    } else if (!(route->methods & RG_HTTP_METHOD(req->method))) {
+        char allow[32];
+        rg_http::allow_header(route->methods, allow, sizeof(allow));
+        httpd_resp_set_hdr(req, "Allow", allow);
+        httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
+    } else {
+        rg_http_query_t query;
+        if (rg_http_query_parse(&query, req->uri) != ESP_OK) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed or oversized query string");
+        } else {
+            ret = route->handler(req, &query);
+            latency = route->latency;
+        }
+    }
+    if (latency) {
+        rg_metrics_observe(latency, (uint32_t)(esp_timer_get_time() - start));
+    }
+    return ret;
+}
+
+#if defined(ESP_PLATFORM)
+// Starts the node's own HTTP server with every path routed through rg_http_handle_request
+static esp_err_t rg_http_server_start(void)
+{
+    // lwIP must also cover the server's 3 internal sockets and the MQTT and OTA clients
+    static_assert(CONFIG_RG_HTTP_MAX_SOCKETS + 3 + 2 <= CONFIG_LWIP_MAX_SOCKETS,
+                  "CONFIG_LWIP_MAX_SOCKETS leaves no socket for the MQTT or OTA client");
+
+    static httpd_handle_t s_server = NULL;
+    if (s_server) {
+        return ESP_OK;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.max_open_sockets = CONFIG_RG_HTTP_MAX_SOCKETS;
+    // Not the server's LRU purge: event streams never send a request, so they would always go first
+    config.lru_purge_enable = false;
+    config.open_fn = keep_a_socket_free;
+    config.keep_alive_enable = true;
+    // The /history and /settings handlers work in stack buffers
+    config.stack_size = 6144;
+
+    esp_err_t err = httpd_start(&s_server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(HTTP_TAG, "Failed to start the HTTP server: %s", esp_err_to_name(err));
+        return err;
+    }
+    static const httpd_uri_t uris[] = {
+        {.uri = "/*", .method = HTTP_GET, .handler = rg_http_handle_request, .user_ctx = NULL},
+        {.uri = "/*", .method = HTTP_POST, .handler = rg_http_handle_request, .user_ctx = NULL},
+    };
+    for (const httpd_uri_t &uri : uris) {
+        err = httpd_register_uri_handler(s_server, &uri);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    ESP_LOGI(HTTP_TAG, "HTTP server listening on port %d, %d sockets.", config.server_port, config.max_open_sockets);
+    return ESP_OK;
 }
+#endif
@@ -0,0 +1,74 @@
+// main/services/rtos/rg_static_alloc.h
+#ifndef RG_STATIC_ALLOC_H_
+#define RG_STATIC_ALLOC_H_
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <sdkconfig.h>
+
+// Where tasks, queues and mutexes get their memory.
+//
+// With CONFIG_RG_STATIC_ALLOCATION the control blocks, stacks and queue
+// buffers are file-scope arrays sized at compile time: they show up in the
+// link map instead of the heap, and creating them cannot fail or fragment the
+// heap. Without it they come from the FreeRTOS heap as before. Modules
+// declare the storage once at file scope and create the object from it:
+//
+//   RG_TASK_STORAGE(s_writer_task, 3072);
+//   RG_QUEUE_STORAGE(s_queue, 16, sizeof(record_t));
+//   RG_MUTEX_STORAGE(s_lock);
+//   ...
+//   s_queue = RG_QUEUE_CREATE(s_queue);
+//   s_lock = RG_MUTEX_CREATE(s_lock);
+//   if (RG_TASK_CREATE(s_writer_task, writer_task, "writer", NULL, 2) != pdPASS) { ... }
+//
+// Each storage backs one object; create it once.
+
+#if CONFIG_RG_STATIC_ALLOCATION
+
+// ESP-IDF counts stack depth in bytes (StackType_t is uint8_t)
+#define RG_TASK_STORAGE(name, stack_bytes)                                                        \
+    static StackType_t name##_stack[(stack_bytes) / sizeof(StackType_t)];                        \
+    static StaticTask_t name##_tcb
+
+#define RG_TASK_CREATE(name, fn, label, arg, priority)                                            \
+    (xTaskCreateStatic((fn), (label), sizeof(name##_stack) / sizeof(StackType_t), (arg), (priority), \
+                       name##_stack, &name##_tcb) != NULL                                         \
+         ? pdPASS                                                                                 \
+         : pdFAIL)
+
+#define RG_QUEUE_STORAGE(name, length, item_size)                                                 \
+    enum { name##_length = (length), name##_item_size = (item_size) };                            \
+    static uint8_t name##_items[(length) * (item_size)];                                          \
+    static StaticQueue_t name##_queue
+
+#define RG_QUEUE_CREATE(name) xQueueCreateStatic(name##_length, name##_item_size, name##_items, &name##_queue)
+
+#define RG_MUTEX_STORAGE(name) static StaticSemaphore_t name##_mutex
+
+#define RG_MUTEX_CREATE(name) xSemaphoreCreateMutexStatic(&name##_mutex)
+
+#else // !CONFIG_RG_STATIC_ALLOCATION
+
+#define RG_TASK_STORAGE(name, stack_bytes) enum { name##_stack_bytes = (stack_bytes) }
+
+#define RG_TASK_CREATE(name, fn, label, arg, priority)                                            \
+    xTaskCreate((fn), (label), name##_stack_bytes, (arg), (priority), NULL)
+
+#define RG_QUEUE_STORAGE(name, length, item_size)                                                 \
+    enum { name##_length = (length), name##_item_size = (item_size) }
+
+#define RG_QUEUE_CREATE(name) xQueueCreate(name##_length, name##_item_size)
+
+// Nothing to reserve; declares an unused name so the line still ends in ';'
+#define RG_MUTEX_STORAGE(name) extern int name##_mutex_unused
+
+#define RG_MUTEX_CREATE(name) xSemaphoreCreateMutex()
+
+#endif // CONFIG_RG_STATIC_ALLOCATION
+
+#endif /* RG_STATIC_ALLOC_H_ */
@@ -0,0 +1,425 @@
+// main/services/rules/rg_rules.c
+#include "rg_rules.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static const char *const s_channel_names[RG_RULES_CHANNEL_COUNT] = {"temperature", "humidity", "pressure"};
+
+// Largest magnitude of a threshold, in hundredths; keeps every comparison and rate in range
+#define MAX_FIXED 10000000
+
+// --- Compiler ---------------------------------------------------------------
+
+typedef struct {
+    const char *text;
+    const char *p;
+    rg_rules_error_t *error;
+    int rule;
+} parser_t;
+
+static esp_err_t fail(parser_t *parser, const char *at, const char *message)
+{
+    if (parser->error) {
+        parser->error->rule = parser->rule;
+        parser->error->offset = (size_t)(at - parser->text);
+        parser->error->message = message;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+static void skip_spaces(parser_t *parser)
+{
+    while (*parser->p == ' ' || *parser->p == '\t' || *parser->p == '\n' || *parser->p == '\r') {
+        parser->p++;
+    }
+}
+
+// Where the next token starts, for error offsets
+static const char *mark(parser_t *parser)
+{
+    skip_spaces(parser);
+    return parser->p;
+}
+
+static bool is_word_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '-' || c == '+';
+}
+
+// Next run of word characters, at most size - 1 of them; "" if there is none
+static bool next_word(parser_t *parser, char *word, size_t size)
+{
+    skip_spaces(parser);
+    size_t n = 0;
+    // "->" is punctuation, not the start of a negative number
+    while (is_word_char(parser->p[n]) && !(parser->p[n] == '-' && parser->p[n + 1] == '>')) {
+        if (n + 1 >= size) {
+            return false;
+        }
+        word[n] = parser->p[n];
+        n++;
+    }
+    word[n] = '\0';
+    parser->p += n;
+    return true;
+}
+
+static bool next_is(parser_t *parser, const char *token)
+{
+    skip_spaces(parser);
+    const size_t n = strlen(token);
+    if (strncmp(parser->p, token, n) != 0 || (isalpha((unsigned char)token[0]) && is_word_char(parser->p[n]))) {
+        return false;
+    }
+    parser->p += n;
+    return true;
+}
+
+// Decimal number to hundredths, rounded half away from zero
+static bool parse_fixed(const char *word, int32_t *out)
+{
+    const char *p = word;
+    const bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p) && !(*p == '.' && isdigit((unsigned char)p[1]))) {
+        return false;
+    }
+    int64_t value = 0;
+    for (; isdigit((unsigned char)*p); p++) {
+        value = value * 10 + (*p - '0');
+        if (value > MAX_FIXED) {
+            return false;
+        }
+    }
+    value *= 100;
+    if (*p == '.') {
+        p++;
+        int64_t scale = 10;
+        int64_t fraction = 0;
+        for (; isdigit((unsigned char)*p); p++) {
+            if (scale >= 1) {
+                fraction += (*p - '0') * scale;
+                scale /= 10;
+            } else if (scale == 0) {
+                fraction += *p >= '5'; // Round on the third decimal
+                scale = -1;
+            }
+        }
+        value += fraction;
+    }
+    if (*p != '\0' || value > MAX_FIXED) {
+        return false;
+    }
+    *out = (int32_t)(negative ? -value : value);
+    return true;
+}
+
+// Leading digits of @p word, up to @p max; returns what follows them or NULL
+static const char *parse_uint(const char *word, uint32_t max, uint32_t *out)
+{
+    const char *p = word;
+    uint32_t value = 0;
+    if (!isdigit((unsigned char)*p)) {
+        return NULL;
+    }
+    for (; isdigit((unsigned char)*p); p++) {
+        value = value * 10 + (uint32_t)(*p - '0');
+        if (value > max) {
+            return NULL;
+        }
+    }
+    *out = value;
+    return p;
+}
+
+// "90", "90s", "2m" or "1h" to milliseconds, at most a day
+static bool parse_duration(const char *word, uint32_t *out_ms)
+{
+    uint32_t value;
+    const char *p = parse_uint(word, 86400, &value);
+    if (!p) {
+        return false;
+    }
+    uint32_t unit_s = 1;
+    if (*p == 'm') {
+        unit_s = 60;
+        p++;
+    } else if (*p == 'h') {
+        unit_s = 3600;
+        p++;
+    } else if (*p == 's') {
+        p++;
+    }
+    if (*p != '\0' || value * unit_s > 86400) {
+        return false;
+    }
+    *out_ms = value * unit_s * 1000;
+    return true;
+}
+
+static esp_err_t parse_rule(parser_t *parser, rg_rule_t *rule)
+{
+    memset(rule, 0, sizeof(*rule));
+    rule->gpio = RG_RULES_NO_GPIO;
+
+    char word[24];
+    const char *at = mark(parser);
+    if (!next_word(parser, rule->name, sizeof(rule->name)) || rule->name[0] == '\0') {
+        return fail(parser, at, "expected a rule name of up to 15 characters");
+    }
+    if (!next_is(parser, ":")) {
+        return fail(parser, parser->p, "expected ':' after the rule name");
+    }
+
+    at = mark(parser);
+    if (!next_word(parser, word, sizeof(word))) {
+        return fail(parser, at, "expected a channel");
+    }
+    int channel = 0;
+    while (channel < RG_RULES_CHANNEL_COUNT && strcmp(word, s_channel_names[channel]) != 0) {
+        channel++;
+    }
+    if (channel == RG_RULES_CHANNEL_COUNT) {
+        return fail(parser, at, "channel must be temperature, humidity or pressure");
+    }
+    rule->channel = (uint8_t)channel;
+    if (next_is(parser, "rate")) {
+        rule->flags |= RG_RULE_RATE;
+    }
+
+    if (next_is(parser, "<")) {
+        rule->flags |= RG_RULE_BELOW;
+    } else if (!next_is(parser, ">")) {
+        return fail(parser, parser->p, "expected '>' or '<'");
+    }
+    at = mark(parser);
+    if (!next_word(parser, word, sizeof(word)) || !parse_fixed(word, &rule->trip)) {
+        return fail(parser, at, "expected a threshold");
+    }
+
+    int32_t hysteresis = 0;
+    if (next_is(parser, "hyst")) {
+        at = mark(parser);
+        if (!next_word(parser, word, sizeof(word)) || !parse_fixed(word, &hysteresis) || hysteresis < 0) {
+            return fail(parser, at, "expected a hysteresis of 0 or more");
+        }
+    }
+    rule->clear = rule->flags & RG_RULE_BELOW ? rule->trip + hysteresis : rule->trip - hysteresis;
+
+    if (next_is(parser, "for")) {
+        at = mark(parser);
+        if (!next_word(parser, word, sizeof(word)) || !parse_duration(word, &rule->hold_ms)) {
+            return fail(parser, at, "expected a duration such as 90, 90s, 2m or 1h, at most a day");
+        }
+    }
+
+    if (next_is(parser, "->")) {
+        if (!next_is(parser, "gpio")) {
+            return fail(parser, parser->p, "expected 'gpio' after '->'");
+        }
+        at = mark(parser);
+        uint32_t pin;
+        const char *end;
+        if (!next_word(parser, word, sizeof(word)) || !(end = parse_uint(word, 63, &pin)) || *end != '\0') {
+            return fail(parser, at, "expected a GPIO number");
+        }
+        rule->gpio = (int8_t)pin;
+        if (next_is(parser, "low")) {
+            rule->flags |= RG_RULE_ACTIVE_LOW;
+        }
+    }
+
+    skip_spaces(parser);
+    if (*parser->p != ';' && *parser->p != '\0') {
+        return fail(parser, parser->p, "expected ';' or the end of the rules");
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_rules_compile(const char *text, rg_rule_t *rules, size_t capacity, size_t *count,
+                           rg_rules_error_t *error)
+{
+    parser_t parser = {.text = text, .p = text, .error = error, .rule = 0};
+    *count = 0;
+    if (error) {
+        memset(error, 0, sizeof(*error));
+    }
+    for (;;) {
+        skip_spaces(&parser);
+        while (*parser.p == ';') {
+            parser.p++;
+            skip_spaces(&parser);
+        }
+        if (*parser.p == '\0') {
+            return ESP_OK;
+        }
+        if (*count == capacity) {
+            fail(&parser, parser.p, "too many rules");
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const char *start = parser.p;
+        esp_err_t err = parse_rule(&parser, &rules[*count]);
+        if (err != ESP_OK) {
+            return err;
+        }
+        for (size_t i = 0; i < *count; i++) {
+            if (strcmp(rules[i].name, rules[*count].name) == 0) {
+                return fail(&parser, start, "duplicate rule name");
+            }
+        }
+        (*count)++;
+        parser.rule++;
+    }
+}
+
+// --- Evaluation -------------------------------------------------------------
+
+// The state is read by other tasks (rg_rules_state()); only the sensor task writes it
+static inline void set_pending(rg_rule_state_t *state, bool pending, uint32_t since_ms)
+{
+    __atomic_store_n(&state->since_ms, since_ms, __ATOMIC_RELAXED);
+    __atomic_store_n(&state->pending, (uint8_t)pending, __ATOMIC_RELAXED);
+}
+
+void rg_rules_init(rg_rules_t *engine, const rg_rule_t *rules, rg_rule_state_t *states, size_t count,
+                   uint32_t rate_window_ms, rg_rules_on_change_t on_change, void *ctx)
+{
+    memset(engine, 0, sizeof(*engine));
+    memset(states, 0, count * sizeof(*states));
+    engine->rules = rules;
+    engine->states = states;
+    engine->count = count;
+    engine->rate_window_ms = rate_window_ms > 0 ? rate_window_ms : 1;
+    engine->on_change = on_change;
+    engine->ctx = ctx;
+    for (size_t i = 0; i < count; i++) {
+        if (rules[i].flags & RG_RULE_RATE) {
+            engine->rate_channels |= 1u << rules[i].channel;
+        }
+    }
+}
+
+// Keeps anchors at least window / (ANCHORS - 2) apart, so the oldest one that
+// is a full window old is at most that much older than the window.
+static bool update_rate(rg_rules_rate_t *rate, uint32_t window_ms, uint32_t now_ms, int32_t value, int32_t *out)
+{
+    while (rate->len >= 2 &&
+           now_ms - rate->t_ms[(rate->head + 1) % RG_RULES_RATE_ANCHORS] >= window_ms) {
+        rate->head = (rate->head + 1) % RG_RULES_RATE_ANCHORS;
+        rate->len--;
+    }
+
+    bool valid = false;
+    if (rate->len > 0) {
+        const uint32_t age_ms = now_ms - rate->t_ms[rate->head];
+        if (age_ms >= window_ms) {
+            *out = (int32_t)((int64_t)(value - rate->value[rate->head]) * 60000 / age_ms);
+            valid = true;
+        }
+    }
+
+    const uint32_t spacing_ms = window_ms / (RG_RULES_RATE_ANCHORS - 2);
+    const int newest = (rate->head + rate->len + RG_RULES_RATE_ANCHORS - 1) % RG_RULES_RATE_ANCHORS;
+    if (rate->len == 0 || now_ms - rate->t_ms[newest] >= spacing_ms) {
+        if (rate->len == RG_RULES_RATE_ANCHORS) {
+            rate->head = (rate->head + 1) % RG_RULES_RATE_ANCHORS;
+            rate->len--;
+        }
+        const int tail = (rate->head + rate->len) % RG_RULES_RATE_ANCHORS;
+        rate->t_ms[tail] = now_ms;
+        rate->value[tail] = value;
+        rate->len++;
+    }
+    return valid;
+}
+
+int rg_rules_evaluate(rg_rules_t *engine, uint32_t now_ms, const int32_t values[RG_RULES_CHANNEL_COUNT])
+{
+    // Rates once per channel, not per rule
+    for (int c = 0; c < RG_RULES_CHANNEL_COUNT; c++) {
+        if (engine->rate_channels & (1u << c)) {
+            if (update_rate(&engine->rates[c], engine->rate_window_ms, now_ms, values[c], &engine->rate[c])) {
+                engine->rate_valid |= 1u << c;
+            } else {
+                engine->rate_valid &= ~(1u << c);
+            }
+        }
+    }
+
+    int changes = 0;
+    for (size_t i = 0; i < engine->count; i++) {
+        const rg_rule_t *rule = &engine->rules[i];
+        rg_rule_state_t *state = &engine->states[i];
+        int32_t value = values[rule->channel];
+        if (rule->flags & RG_RULE_RATE) {
+            if (!(engine->rate_valid & (1u << rule->channel))) {
+                if (state->pending) {
+                    set_pending(state, false, 0); // No rate yet: the condition does not hold
+                }
+                continue;
+            }
+            value = engine->rate[rule->channel];
+        }
+        const bool below = rule->flags & RG_RULE_BELOW;
+
+        if (state->active) {
+            // Clears only once back past the hysteresis band
+            const bool holds = below ? value < rule->clear : value > rule->clear;
+            if (!holds) {
+                __atomic_store_n(&state->active, 0, __ATOMIC_RELAXED);
+                changes++;
+                if (engine->on_change) {
+                    engine->on_change(engine->ctx, (int)i, rule, false, value);
+                }
+            }
+            continue;
+        }
+
+        const bool holds = below ? value < rule->trip : value > rule->trip;
+        if (!holds) {
+            if (state->pending) {
+                set_pending(state, false, 0);
+            }
+            continue;
+        }
+        if (!state->pending) {
+            set_pending(state, true, now_ms);
+        }
+        if (now_ms - state->since_ms >= rule->hold_ms) {
+            set_pending(state, false, 0);
+            __atomic_store_n(&state->trips, state->trips + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&state->active, 1, __ATOMIC_RELAXED);
+            changes++;
+            if (engine->on_change) {
+                engine->on_change(engine->ctx, (int)i, rule, true, value);
+            }
+        }
+    }
+    return changes;
+}
+
+bool rg_rules_rate(const rg_rules_t *engine, rg_rules_channel_t channel, int32_t *rate)
+{
+    if ((unsigned)channel >= RG_RULES_CHANNEL_COUNT || !(engine->rate_valid & (1u << channel))) {
+        return false;
+    }
+    *rate = engine->rate[channel];
+    return true;
+}
+
+void rg_rules_state(const rg_rules_t *engine, size_t index, rg_rule_state_t *out)
+{
+    const rg_rule_state_t *state = &engine->states[index];
+    out->active = __atomic_load_n(&state->active, __ATOMIC_RELAXED);
+    out->pending = __atomic_load_n(&state->pending, __ATOMIC_RELAXED);
+    out->since_ms = __atomic_load_n(&state->since_ms, __ATOMIC_RELAXED);
+    out->trips = __atomic_load_n(&state->trips, __ATOMIC_RELAXED);
+}
+
+const char *rg_rules_channel_name(rg_rules_channel_t channel)
+{
+    return (unsigned)channel < RG_RULES_CHANNEL_COUNT ? s_channel_names[channel] : "";
+}
@@ -0,0 +1,157 @@
+// main/services/rules/rg_rules.h
+#ifndef RG_RULES_H_
+#define RG_RULES_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Threshold rules evaluated on the device for every sensor reading, so an
+// alarm trips locally within one sampling interval whether or not anyone is
+// connected.
+//
+// Rules are text, one per ';', compiled once into a table of fixed-size
+// predicates:
+//
+//   <name>: <channel> [rate] <'>'|'<'> <value> [hyst <value>] [for <duration>] [-> gpio <pin> [low]]
+//
+//   damp: humidity > 70 hyst 5 for 2m -> gpio 4
+//   heating: temperature rate > 1 for 1m
+//   storm: pressure rate < -1.5 hyst 0.5
+//
+// The channel is temperature (degC), humidity (%RH) or pressure (hPa); with
+// "rate" the value is the change per minute, measured over the last
+// rate window (see rg_rules_init()). A rule trips once its condition has
+// held for the duration (seconds, or with an s, m or h suffix; 0 by default)
+// and clears as soon as the value is back past the threshold by the
+// hysteresis, so a value hovering at the threshold does not chatter. Each
+// change of state goes to the on_change hook, which the device turns into a
+// GPIO level and an event on the sample bus.
+//
+// Values are fixed point in hundredths of the unit, as in rg_stats. Pure
+// logic with the clock passed in; the sensor task owns the instance, and
+// rg_rules_state() may be read from any task.
+
+#define RG_RULES_NAME_LEN 16
+#define RG_RULES_RATE_ANCHORS 8
+#define RG_RULES_NO_GPIO (-1)
+
+typedef enum {
+    RG_RULES_TEMPERATURE,
+    RG_RULES_HUMIDITY,
+    RG_RULES_PRESSURE,
+    RG_RULES_CHANNEL_COUNT,
+} rg_rules_channel_t;
+
+// rg_rule_t flags
+#define RG_RULE_RATE (1u << 0)       // Compare the change per minute, not the value
+#define RG_RULE_BELOW (1u << 1)      // '<' rather than '>'
+#define RG_RULE_ACTIVE_LOW (1u << 2) // The GPIO is driven low while tripped
+
+// One compiled rule
+typedef struct {
+    char name[RG_RULES_NAME_LEN];
+    uint8_t channel; // rg_rules_channel_t
+    uint8_t flags;
+    int8_t gpio;     // RG_RULES_NO_GPIO for an event only
+    int32_t trip;    // Threshold, hundredths (per minute with RG_RULE_RATE)
+    int32_t clear;   // Threshold moved back by the hysteresis
+    uint32_t hold_ms;
+} rg_rule_t;
+
+typedef struct {
+    uint8_t active;    // Tripped
+    uint8_t pending;   // Condition holds, waiting out hold_ms
+    uint32_t since_ms; // When the condition started to hold
+    uint32_t trips;    // Times the rule tripped
+} rg_rule_state_t;
+
+typedef struct {
+    int rule;            // Index of the rule that failed to compile
+    size_t offset;       // Into the whole text
+    const char *message; // Static string
+} rg_rules_error_t;
+
+// Reference points for a channel's rate, spaced a sixth of the window apart
+typedef struct {
+    uint32_t t_ms[RG_RULES_RATE_ANCHORS];
+    int32_t value[RG_RULES_RATE_ANCHORS];
+    uint8_t head;
+    uint8_t len;
+} rg_rules_rate_t;
+
+typedef void (*rg_rules_on_change_t)(void *ctx, int index, const rg_rule_t *rule, bool active, int32_t value);
+
+typedef struct {
+    const rg_rule_t *rules;
+    rg_rule_state_t *states;
+    size_t count;
+    uint32_t rate_window_ms;
+    uint8_t rate_channels; // Bit per channel some rule takes the rate of
+    uint8_t rate_valid;    // Bit per channel with a rate window of history
+    rg_rules_rate_t rates[RG_RULES_CHANNEL_COUNT];
+    int32_t rate[RG_RULES_CHANNEL_COUNT]; // As of the last reading
+    rg_rules_on_change_t on_change;
+    void *ctx;
+} rg_rules_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compiles rule text into @p rules.
+ *
+ * @param count Set to the number of rules compiled.
+ * @param error Where and why compiling stopped; may be NULL.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a syntax error or a duplicate name,
+ *         or ESP_ERR_INVALID_SIZE for more than @p capacity rules.
+ */
+esp_err_t rg_rules_compile(const char *text, rg_rule_t *rules, size_t capacity, size_t *count,
+                           rg_rules_error_t *error);
+
+/**
+ * @brief Sets up an engine over compiled rules; @p states needs @p count entries.
+ *
+ * @param rate_window_ms Span the rates are measured over; until a channel has
+ *        that much history its rate rules stay clear.
+ * @param on_change Called from rg_rules_evaluate() for every rule that trips or clears; may be NULL.
+ */
+void rg_rules_init(rg_rules_t *engine, const rg_rule_t *rules, rg_rule_state_t *states, size_t count,
+                   uint32_t rate_window_ms, rg_rules_on_change_t on_change, void *ctx);
+
+/**
+ * @brief Evaluates every rule against one reading.
+ *
+ * @param now_ms Monotonic milliseconds; may wrap.
+ * @param values Temperature, humidity and pressure in hundredths.
+ * @return Number of rules that changed state.
+ */
+int rg_rules_evaluate(rg_rules_t *engine, uint32_t now_ms, const int32_t values[RG_RULES_CHANNEL_COUNT]);
+
+/**
+ * @brief Change per minute of @p channel at the last reading, in hundredths, as rate rules saw it.
+ *
+ * @return false until the channel has a rate window of history or if no rule uses its rate.
+ */
+bool rg_rules_rate(const rg_rules_t *engine, rg_rules_channel_t channel, int32_t *rate);
+
+/**
+ * @brief Copies the state of rule @p index; safe from any task.
+ */
+void rg_rules_state(const rg_rules_t *engine, size_t index, rg_rule_state_t *out);
+
+/**
+ * @brief "temperature", "humidity" or "pressure".
+ */
+const char *rg_rules_channel_name(rg_rules_channel_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_RULES_H_ */
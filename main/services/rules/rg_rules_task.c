@@ -0,0 +1,259 @@
+// main/services/rules/rg_rules_task.c
+#include "rg_rules_task.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "services/bus/rg_event_bus_task.h"
+#include "services/config/rg_config_task.h"
+#include "services/log/rg_tlog.h"
+#include <sdkconfig.h>
+
+static const char *TAG = "RG_RULES";
+
+// Two sets: a reload compiles beside the running rules and swaps them in only if it succeeds.
+// Readers on other tasks pin the active set; a retired set is only compiled into again once
+// nobody holds it, so they never see rules being rewritten.
+typedef struct {
+    rg_rule_t rules[CONFIG_RG_RULES_MAX];
+    rg_rule_state_t states[CONFIG_RG_RULES_MAX];
+    rg_rules_t engine;
+    uint32_t readers;   // Pins held by pin_active()
+    uint8_t generation; // Bumped every time rules are loaded into the set
+} rule_set_t;
+
+static rule_set_t s_sets[2];
+static rule_set_t *s_active = NULL; // NULL until started
+static bool s_reload = false;       // The rules setting changed
+static uint8_t s_generation = 0;    // Of the rules loaded last
+
+static int gpio_level(const rg_rule_t *rule, bool active)
+{
+    return active != ((rule->flags & RG_RULE_ACTIVE_LOW) != 0);
+}
+
+// Runs on the sensor task, in the middle of rg_rules_evaluate(); @p ctx is the rule set
+static void on_change(void *ctx, int index, const rg_rule_t *rule, bool active, int32_t value)
+{
+    const rule_set_t *set = (const rule_set_t *)ctx;
+    if (rule->gpio != RG_RULES_NO_GPIO) {
+        gpio_set_level((gpio_num_t)rule->gpio, gpio_level(rule, active));
+    }
+
+    rg_event_t event = {0};
+    event.type = RG_EVENT_RULE;
+    event.time_us = esp_timer_get_time();
+    event.rule.index = (uint16_t)index;
+    event.rule.active = active;
+    event.rule.value = value;
+    event.rule.generation = set->generation;
+    rg_event_bus_task_publish(&event);
+
+    const long magnitude = labs((long)value);
+    RG_TLOGW(TAG, "Rule %s %s at %s%ld.%02ld%s.", rule->name, active ? "tripped" : "cleared", value < 0 ? "-" : "",
+             magnitude / 100, magnitude % 100, rule->flags & RG_RULE_RATE ? " per minute" : "");
+}
+
+// Compiles @p text into @p set and checks its pins, touching no hardware
+static esp_err_t compile(rule_set_t *set, const char *text)
+{
+    size_t count = 0;
+    rg_rules_error_t error;
+    esp_err_t ret = rg_rules_compile(text, set->rules, CONFIG_RG_RULES_MAX, &count, &error);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Rule %d does not compile at offset %u: %s.", error.rule + 1, (unsigned)error.offset,
+                 error.message);
+        return ret;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const rg_rule_t *rule = &set->rules[i];
+        if (rule->gpio != RG_RULES_NO_GPIO && !GPIO_IS_VALID_OUTPUT_GPIO(rule->gpio)) {
+            ESP_LOGE(TAG, "Rule %s: GPIO %d cannot drive an output.", rule->name, rule->gpio);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    rg_rules_init(&set->engine, set->rules, set->states, count, CONFIG_RG_RULES_RATE_WINDOW_S * 1000, on_change,
+                  set);
+    set->generation = ++s_generation;
+    return ESP_OK;
+}
+
+// Makes the active set safe to read from any task until unpin(); NULL before the rules start.
+// The second look at s_active catches a swap that raced the pin.
+static const rule_set_t *pin_active(void)
+{
+    while (1) {
+        rule_set_t *set = __atomic_load_n(&s_active, __ATOMIC_SEQ_CST);
+        if (!set) {
+            return NULL;
+        }
+        __atomic_add_fetch(&set->readers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s_active, __ATOMIC_SEQ_CST) == set) {
+            return set;
+        }
+        __atomic_sub_fetch(&set->readers, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void unpin(const rule_set_t *set)
+{
+    __atomic_sub_fetch(&((rule_set_t *)set)->readers, 1, __ATOMIC_SEQ_CST);
+}
+
+// Sets every rule's GPIO to its cleared level, as an output
+static esp_err_t configure_outputs(const rule_set_t *set)
+{
+    for (size_t i = 0; i < set->engine.count; i++) {
+        const rg_rule_t *rule = &set->rules[i];
+        if (rule->gpio == RG_RULES_NO_GPIO) {
+            continue;
+        }
+        // Level first, so the pin never glitches to the tripped state
+        gpio_set_level((gpio_num_t)rule->gpio, gpio_level(rule, false));
+        const gpio_config_t config = {
+            .pin_bit_mask = 1ull << rule->gpio,
+            .mode = GPIO_MODE_OUTPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        esp_err_t ret = gpio_config(&config);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static void rules_changed(void *ctx, int id)
+{
+    (void)ctx;
+    (void)id;
+    __atomic_store_n(&s_reload, true, __ATOMIC_RELEASE);
+}
+
+// Swaps in the rules setting between two readings, on the sensor task
+static void reload(void)
+{
+    static char text[RG_SETTINGS_RULES_MAX + 1];
+    rg_config_get_string(rg_config_task_config(), RG_SETTING_RULES, text, sizeof(text));
+    rule_set_t *old = s_active;
+    rule_set_t *next = old == &s_sets[0] ? &s_sets[1] : &s_sets[0];
+    if (__atomic_load_n(&next->readers, __ATOMIC_SEQ_CST) != 0) {
+        // Still read from before the last swap; try again at the next reading
+        __atomic_store_n(&s_reload, true, __ATOMIC_RELEASE);
+        return;
+    }
+    if (compile(next, text) != ESP_OK) {
+        ESP_LOGE(TAG, "Keeping the %u rule(s) running.", (unsigned)old->engine.count);
+        return;
+    }
+    // Outputs of the old rules drop back to their cleared level; a new rule trips afresh
+    for (size_t i = 0; i < old->engine.count; i++) {
+        if (old->rules[i].gpio != RG_RULES_NO_GPIO) {
+            gpio_set_level((gpio_num_t)old->rules[i].gpio, gpio_level(&old->rules[i], false));
+        }
+    }
+    esp_err_t ret = configure_outputs(next);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up the rule outputs: %s", esp_err_to_name(ret));
+    }
+    __atomic_store_n(&s_active, next, __ATOMIC_SEQ_CST);
+    ESP_LOGI(TAG, "%u rule(s) loaded.", (unsigned)next->engine.count);
+}
+
+esp_err_t rg_rules_task_start(void)
+{
+    if (s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    static char text[RG_SETTINGS_RULES_MAX + 1];
+    rg_config_get_string(rg_config_task_config(), RG_SETTING_RULES, text, sizeof(text));
+    esp_err_t ret = compile(&s_sets[0], text);
+    if (ret != ESP_OK && strcmp(text, CONFIG_RG_RULES) != 0) {
+        // A stored rule set this board cannot run must not keep the node from sampling
+        ESP_LOGW(TAG, "Falling back to the built-in rules.");
+        ret = compile(&s_sets[0], CONFIG_RG_RULES);
+    }
+    if (ret == ESP_OK) {
+        ret = configure_outputs(&s_sets[0]);
+    }
+    if (ret == ESP_OK) {
+        ret = rg_config_task_subscribe(RG_CONFIG_BIT(RG_SETTING_RULES), rules_changed, NULL);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    __atomic_store_n(&s_active, &s_sets[0], __ATOMIC_SEQ_CST);
+    ESP_LOGI(TAG, "%u rule(s) loaded.", (unsigned)s_sets[0].engine.count);
+    return ESP_OK;
+}
+
+void rg_rules_task_evaluate(int64_t now_us, float temperature, float humidity, float pressure)
+{
+    if (!s_active) {
+        return;
+    }
+    if (__atomic_load_n(&s_reload, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&s_reload, false, __ATOMIC_RELAXED);
+        reload();
+    }
+    if (s_active->engine.count == 0) {
+        return;
+    }
+    const int32_t values[RG_RULES_CHANNEL_COUNT] = {
+        lroundf(temperature * 100.0f),
+        lroundf(humidity * 100.0f),
+        lroundf(pressure * 100.0f),
+    };
+    rg_rules_evaluate(&s_active->engine, (uint32_t)(now_us / 1000), values);
+}
+
+bool rg_rules_task_rule(uint8_t generation, uint16_t index, rg_rule_t *out)
+{
+    const rule_set_t *set = pin_active();
+    if (!set) {
+        return false;
+    }
+    bool found = set->generation == generation && index < set->engine.count;
+    if (found) {
+        *out = set->rules[index];
+    }
+    unpin(set);
+    return found;
+}
+
+void rg_rules_task_write_metrics(rg_metrics_writer_t *writer)
+{
+    const rule_set_t *set = pin_active();
+    if (!set) {
+        return;
+    }
+    if (set->engine.count == 0) {
+        unpin(set);
+        return;
+    }
+    rg_metrics_write_family(writer, "rg_rule_active", "gauge", "1 while a local rule is tripped.");
+    for (size_t i = 0; i < set->engine.count; i++) {
+        rg_rule_state_t state;
+        rg_rules_state(&set->engine, i, &state);
+        char labels[64];
+        snprintf(labels, sizeof(labels), "rule=\"%s\",channel=\"%s\"", set->rules[i].name,
+                 rg_rules_channel_name((rg_rules_channel_t)set->rules[i].channel));
+        rg_metrics_write_value(writer, "rg_rule_active", labels, state.active);
+    }
+    rg_metrics_write_family(writer, "rg_rule_trips_total", "counter", "Times a local rule tripped.");
+    for (size_t i = 0; i < set->engine.count; i++) {
+        rg_rule_state_t state;
+        rg_rules_state(&set->engine, i, &state);
+        char labels[32];
+        snprintf(labels, sizeof(labels), "rule=\"%s\"", set->rules[i].name);
+        rg_metrics_write_value(writer, "rg_rule_trips_total", labels, state.trips);
+    }
+    unpin(set);
+}
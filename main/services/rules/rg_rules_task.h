@@ -0,0 +1,61 @@
+// main/services/rules/rg_rules_task.h
+#ifndef RG_RULES_TASK_H_
+#define RG_RULES_TASK_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "rg_rules.h"
+#include "services/metrics/rg_metrics.h"
+
+// The device's rule engine: the rules setting (CONFIG_RG_RULES unless changed
+// at /settings) compiled at boot and evaluated by the sensor task on every
+// reading, before the sampler decides whether to publish it. A rule that
+// trips or clears drives its GPIO right there and publishes an RG_EVENT_RULE
+// on the sample bus, so the output follows the reading within the evaluation
+// time, whatever the network is doing. A changed setting is swapped in before
+// the next reading; rules that do not load leave the running ones in place.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compiles the rules setting and sets every rule's GPIO to its cleared level.
+ *
+ * Stored rules that do not load on this board fall back to CONFIG_RG_RULES.
+ * Needs the settings (rg_config_task.h).
+ *
+ * @return ESP_OK (also with no rules), ESP_ERR_INVALID_ARG for a rule that
+ *         does not compile or names a pin that cannot drive an output,
+ *         ESP_ERR_INVALID_SIZE for more than CONFIG_RG_RULES_MAX rules.
+ */
+esp_err_t rg_rules_task_start(void);
+
+/**
+ * @brief Evaluates the rules against one filtered reading (sensor task only).
+ *
+ * Loads a changed rules setting first.
+ */
+void rg_rules_task_evaluate(int64_t now_us, float temperature, float humidity, float pressure);
+
+/**
+ * @brief Copies compiled rule @p index of @p generation, e.g. for an RG_EVENT_RULE; safe from any task.
+ *
+ * @return false if there is no such rule, or the rules have been reloaded since that generation.
+ */
+bool rg_rules_task_rule(uint8_t generation, uint16_t index, rg_rule_t *out);
+
+/**
+ * @brief Writes the state and trip count of every rule for /metrics.
+ */
+void rg_rules_task_write_metrics(rg_metrics_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_RULES_TASK_H_ */
@@ -0,0 +1,104 @@
+// main/services/sampler/rg_sampler.c
+#include "rg_sampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <sdkconfig.h>
+
+void rg_sampler_default_config(rg_sampler_config_t *config)
+{
+    config->deadband[RG_SAMPLER_TEMPERATURE] = CONFIG_RG_SAMPLER_DEADBAND_TEMPERATURE / 100.0f;
+    config->deadband[RG_SAMPLER_HUMIDITY] = CONFIG_RG_SAMPLER_DEADBAND_HUMIDITY / 100.0f;
+    config->deadband[RG_SAMPLER_PRESSURE] = CONFIG_RG_SAMPLER_DEADBAND_PRESSURE / 10.0f;
+    config->min_interval_ms = CONFIG_RG_SAMPLER_MIN_INTERVAL_MS;
+    config->max_interval_ms = CONFIG_RG_SAMPLER_MAX_INTERVAL_MS;
+    config->heartbeat_ms = CONFIG_RG_SAMPLER_HEARTBEAT_S * 1000u;
+}
+
+static void set_config(rg_sampler_t *sampler, const rg_sampler_config_t *config)
+{
+    sampler->config = *config;
+    if (sampler->config.min_interval_ms == 0) {
+        sampler->config.min_interval_ms = 1;
+    }
+    if (sampler->config.max_interval_ms < sampler->config.min_interval_ms) {
+        sampler->config.max_interval_ms = sampler->config.min_interval_ms;
+    }
+}
+
+void rg_sampler_init(rg_sampler_t *sampler, const rg_sampler_config_t *config)
+{
+    memset(sampler, 0, sizeof(*sampler));
+    set_config(sampler, config);
+    for (int c = 0; c < RG_SAMPLER_CHANNEL_COUNT; c++) {
+        sampler->interval_ms[c] = sampler->config.min_interval_ms;
+    }
+}
+
+void rg_sampler_reconfigure(rg_sampler_t *sampler, const rg_sampler_config_t *config)
+{
+    set_config(sampler, config);
+    for (int c = 0; c < RG_SAMPLER_CHANNEL_COUNT; c++) {
+        if (sampler->interval_ms[c] < sampler->config.min_interval_ms) {
+            sampler->interval_ms[c] = sampler->config.min_interval_ms;
+        } else if (sampler->interval_ms[c] > sampler->config.max_interval_ms) {
+            sampler->interval_ms[c] = sampler->config.max_interval_ms;
+        }
+    }
+}
+
+uint32_t rg_sampler_update(rg_sampler_t *sampler, uint32_t now_ms, const float values[RG_SAMPLER_CHANNEL_COUNT])
+{
+    return rg_sampler_update_smoothed(sampler, now_ms, values, values);
+}
+
+uint32_t rg_sampler_update_smoothed(rg_sampler_t *sampler, uint32_t now_ms, const float values[RG_SAMPLER_CHANNEL_COUNT],
+                                    const float smoothed[RG_SAMPLER_CHANNEL_COUNT])
+{
+    const rg_sampler_config_t *cfg = &sampler->config;
+    sampler->stats.samples++;
+
+    uint32_t result = 0;
+    for (int c = 0; c < RG_SAMPLER_CHANNEL_COUNT; c++) {
+        if (!sampler->started || fabsf(values[c] - sampler->published[c]) >= cfg->deadband[c] ||
+            fabsf(smoothed[c] - sampler->smoothed[c]) >= cfg->deadband[c]) {
+            result |= RG_SAMPLER_CHANGED(c);
+        }
+
+        // Half the deadband per step means the channel is heading for a publish
+        // within the next couple of samples; watch it closely until it settles.
+        if (sampler->started && fabsf(values[c] - sampler->last[c]) >= cfg->deadband[c] * 0.5f) {
+            sampler->interval_ms[c] = cfg->min_interval_ms;
+        } else if (sampler->started) {
+            uint32_t next = sampler->interval_ms[c] * 2;
+            sampler->interval_ms[c] = next > cfg->max_interval_ms ? cfg->max_interval_ms : next;
+        }
+        sampler->last[c] = values[c];
+    }
+    sampler->started = true;
+
+    if (!result && cfg->heartbeat_ms && now_ms - sampler->last_publish_ms >= cfg->heartbeat_ms) {
+        result = RG_SAMPLER_HEARTBEAT;
+        sampler->stats.heartbeats++;
+    }
+    if (result) {
+        // Downstream always receives the whole sample, so every channel is now current
+        memcpy(sampler->published, values, sizeof(sampler->published));
+        memcpy(sampler->smoothed, smoothed, sizeof(sampler->smoothed));
+        sampler->last_publish_ms = now_ms;
+        sampler->stats.publishes++;
+    }
+    return result;
+}
+
+uint32_t rg_sampler_next_interval_ms(const rg_sampler_t *sampler)
+{
+    uint32_t interval = sampler->config.max_interval_ms;
+    for (int c = 0; c < RG_SAMPLER_CHANNEL_COUNT; c++) {
+        if (sampler->interval_ms[c] < interval) {
+            interval = sampler->interval_ms[c];
+        }
+    }
+    return interval;
+}
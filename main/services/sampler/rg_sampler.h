@@ -0,0 +1,115 @@
+// main/services/sampler/rg_sampler.h
+#ifndef RG_SAMPLER_H_
+#define RG_SAMPLER_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Change-driven sampling schedule for the sensor task.
+//
+// Every channel keeps its own sampling interval. A channel that moved by at
+// least half its deadband since the previous sample drops straight to the
+// minimum interval; a quiet channel doubles its interval up to the maximum.
+// The task sleeps for the shortest interval of all channels.
+//
+// A sample is published downstream only when some channel differs from the
+// last published value by at least its deadband, or when nothing was
+// published for the heartbeat period so consumers can tell the device is alive.
+//
+// Change detection wants values that follow a step at once, consumers want
+// smoothed ones. rg_sampler_update_smoothed() takes both: the detection runs
+// on the first, and a channel whose smoothed value has since moved by its
+// deadband is published again, so a lagging smoother still catches up.
+//
+// Pure logic with the clock passed in; it runs the same on the device and in
+// the host simulation. Not thread safe: the sensor task owns the instance.
+
+typedef enum {
+    RG_SAMPLER_TEMPERATURE = 0,
+    RG_SAMPLER_HUMIDITY,
+    RG_SAMPLER_PRESSURE,
+    RG_SAMPLER_CHANNEL_COUNT,
+} rg_sampler_channel_t;
+
+// Bits returned by rg_sampler_update()
+#define RG_SAMPLER_CHANGED(channel) (1u << (channel))
+#define RG_SAMPLER_HEARTBEAT (1u << RG_SAMPLER_CHANNEL_COUNT)
+
+typedef struct {
+    float deadband[RG_SAMPLER_CHANNEL_COUNT]; // degC, %RH, hPa
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;
+    uint32_t heartbeat_ms;                    // 0 disables the heartbeat
+} rg_sampler_config_t;
+
+typedef struct {
+    uint32_t samples;    // rg_sampler_update() calls
+    uint32_t publishes;  // Calls that returned non-zero
+    uint32_t heartbeats; // Publishes caused only by the heartbeat
+} rg_sampler_stats_t;
+
+typedef struct {
+    rg_sampler_config_t config;
+    bool started;
+    float last[RG_SAMPLER_CHANNEL_COUNT];      // Previous sample
+    float published[RG_SAMPLER_CHANNEL_COUNT]; // Detection values at the last publish
+    float smoothed[RG_SAMPLER_CHANNEL_COUNT];  // Last values sent downstream
+    uint32_t interval_ms[RG_SAMPLER_CHANNEL_COUNT];
+    uint32_t last_publish_ms;
+    rg_sampler_stats_t stats;
+} rg_sampler_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fills @p config from the Kconfig "Adaptive sampling" options.
+ */
+void rg_sampler_default_config(rg_sampler_config_t *config);
+
+/**
+ * @brief Resets @p sampler. The first update always publishes.
+ */
+void rg_sampler_init(rg_sampler_t *sampler, const rg_sampler_config_t *config);
+
+/**
+ * @brief Switches @p sampler to @p config without starting over.
+ *
+ * The published values, heartbeat clock and statistics carry on; channel
+ * intervals are clamped into the new range, and the new deadbands apply
+ * from the next update.
+ */
+void rg_sampler_reconfigure(rg_sampler_t *sampler, const rg_sampler_config_t *config);
+
+/**
+ * @brief Feeds one sample taken at @p now_ms and adapts the per-channel intervals.
+ *
+ * @param values Temperature (degC), humidity (%RH) and pressure (hPa), indexed by rg_sampler_channel_t.
+ * @return 0 if the sample need not be published, otherwise RG_SAMPLER_CHANGED() bits
+ *         for the channels that crossed their deadband, or RG_SAMPLER_HEARTBEAT.
+ */
+uint32_t rg_sampler_update(rg_sampler_t *sampler, uint32_t now_ms, const float values[RG_SAMPLER_CHANNEL_COUNT]);
+
+/**
+ * @brief Like rg_sampler_update(), for a sample whose published form is smoothed.
+ *
+ * @param values   Raw or outlier-rejected values; the intervals and deadbands apply to these.
+ * @param smoothed What gets published. A channel is also reported as changed when
+ *                 its smoothed value moved by the deadband since the last publish.
+ */
+uint32_t rg_sampler_update_smoothed(rg_sampler_t *sampler, uint32_t now_ms, const float values[RG_SAMPLER_CHANNEL_COUNT],
+                                    const float smoothed[RG_SAMPLER_CHANNEL_COUNT]);
+
+/**
+ * @brief Time until the next sample is due.
+ */
+uint32_t rg_sampler_next_interval_ms(const rg_sampler_t *sampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_SAMPLER_H_ */
@@ -0,0 +1,69 @@
+// main/services/shared_data/rg_versioned_buffer.h
+#ifndef RG_VERSIONED_BUFFER_H_
+#define RG_VERSIONED_BUFFER_H_
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Single-writer double buffer guarded by a sequence counter.
+//
+// The counter is bumped to an odd value before the inactive slot is written
+// and to the next even value once it is complete, so (seq >> 1) is the number
+// of finished publishes and slot[(seq >> 1) & 1] always holds the newest one.
+// A writer only ever touches the slot readers are NOT looking at; a reader has
+// to retry only when two publishes overlap its copy, never because a writer got
+// preempted half way. Payload words are relaxed atomics so the copy is not a
+// data race.
+template <typename T>
+class VersionedBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "payload must be trivially copyable");
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "payload must be a whole number of words");
+    static constexpr size_t kWords = sizeof(T) / sizeof(uint32_t);
+
+public:
+    void store(const T &value)
+    {
+        uint32_t words[kWords];
+        memcpy(words, &value, sizeof(T));
+
+        const uint32_t seq = seq_.load(std::memory_order_relaxed);
+        std::atomic<uint32_t> *slot = slots_[((seq >> 1) + 1) & 1];
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            slot[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns the number of completed publishes the copy corresponds to.
+    uint32_t load(T *out) const
+    {
+        uint32_t words[kWords];
+        uint32_t begin;
+        uint32_t end;
+        do {
+            begin = seq_.load(std::memory_order_acquire) & ~1u;
+            const std::atomic<uint32_t> *slot = slots_[(begin >> 1) & 1];
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = slot[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = seq_.load(std::memory_order_relaxed);
+            // The slot we copied is rewritten only once seq reaches begin + 3.
+        } while (end - begin > 2);
+        memcpy(out, words, sizeof(T));
+        return begin >> 1;
+    }
+
+private:
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint32_t> slots_[2][kWords] = {};
+};
+
+#endif /* RG_VERSIONED_BUFFER_H_ */
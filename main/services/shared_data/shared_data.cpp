@@ -1,8 +1,60 @@
 #include "shared_data.h"
+#include "rg_versioned_buffer.h"
 
-shared_data_t shared_data = {
-    .temperature = 0.0f,
-    .humidity = 0.0f,
-    .pressure = 0.0f,
-    .ip_address = {0}
-};
\ No newline at end of file
+#include <string.h>
+
+namespace {
+
+struct sample_payload_t {
+    float temperature;
+    float humidity;
+    float pressure;
+    uint32_t reserved;
+    int64_t timestamp_us;
+};
+
+struct ip_payload_t {
+    char ip_address[16];
+};
+
+VersionedBuffer<sample_payload_t> s_sample;
+VersionedBuffer<ip_payload_t> s_ip;
+
+} // namespace
+
+void shared_data_publish(float temperature, float humidity, float pressure, int64_t timestamp_us)
+{
+    sample_payload_t sample = {};
+    sample.temperature = temperature;
+    sample.humidity = humidity;
+    sample.pressure = pressure;
+    sample.timestamp_us = timestamp_us;
+    s_sample.store(sample);
+}
+
+void shared_data_set_ip_address(const char *ip_address)
+{
+    ip_payload_t ip = {};
+    if (ip_address) {
+        strncpy(ip.ip_address, ip_address, sizeof(ip.ip_address) - 1);
+    }
+    s_ip.store(ip);
+}
+
+void shared_data_read(shared_data_t *out)
+{
+    if (!out) {
+        return;
+    }
+
+    sample_payload_t sample;
+    ip_payload_t ip;
+    out->sequence = s_sample.load(&sample);
+    s_ip.load(&ip);
+
+    out->temperature = sample.temperature;
+    out->humidity = sample.humidity;
+    out->pressure = sample.pressure;
+    out->timestamp_us = sample.timestamp_us;
+    memcpy(out->ip_address, ip.ip_address, sizeof(out->ip_address));
+}
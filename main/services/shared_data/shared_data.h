@@ -1,10 +1,44 @@
 // shared_data.h
 #pragma once
+#include <stdint.h>
+
+// Consistent copy of the latest published sensor sample plus the station IP.
+// Readers get it through shared_data_read(); the backing storage is private
+// to shared_data.cpp so nobody can read a half-written sample.
 typedef struct {
     float temperature;
     float humidity;
     float pressure;
     char ip_address[16];
+    uint32_t sequence;    // Number of samples published so far, 0 before the first one
+    int64_t timestamp_us; // esp_timer_get_time() of the sample, 0 before the first one
 } shared_data_t;
 
-extern shared_data_t shared_data;
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Publishes a new sensor sample.
+ *
+ * Must only be called from one task (single writer): the "http" consumer of the
+ * sample bus. Never blocks and never waits for readers.
+ */
+void shared_data_publish(float temperature, float humidity, float pressure, int64_t timestamp_us);
+
+/**
+ * @brief Publishes the station IP address (single writer: the Wi-Fi event callback).
+ */
+void shared_data_set_ip_address(const char *ip_address);
+
+/**
+ * @brief Copies a consistent snapshot of the latest sample and IP address into @p out.
+ *
+ * Wait-free with respect to the writers: a reader never blocks the sensor task,
+ * and a writer preempted mid-publish never stalls a reader.
+ */
+void shared_data_read(shared_data_t *out);
+
+#ifdef __cplusplus
+}
+#endif
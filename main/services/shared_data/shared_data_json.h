@@ -0,0 +1,21 @@
+// shared_data_json.h
+#pragma once
+
+#include "shared_data.h"
+#include "services/json/rg_json_writer.h"
+
+// Writes a snapshot as the /data JSON object. Keys are sorted (the order
+// nlohmann::json used to emit them) so existing clients see identical bodies.
+static inline void shared_data_write_json(rg_json_writer &json, const shared_data_t &snapshot)
+{
+    json.begin_object();
+    json.key("humidity");
+    json.value(snapshot.humidity);
+    json.key("ip_address");
+    json.value(snapshot.ip_address);
+    json.key("pressure");
+    json.value(snapshot.pressure);
+    json.key("temperature");
+    json.value(snapshot.temperature);
+    json.end_object();
+}
@@ -0,0 +1,197 @@
+#include "rg_sse.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "esp_log.h"
+#include "services/json/rg_json_writer.h"
+#include "services/log/rg_tlog.h"
+#include "services/shared_data/shared_data_json.h"
+#include <sdkconfig.h>
+
+namespace {
+
+const char *TAG = "RG_SSE";
+
+struct sse_client_t {
+    bool active;
+    bool closing;    // Close requested; the slot is freed by the session's free_ctx
+    int fd;
+    size_t len;      // Bytes queued in buf but not yet accepted by the socket
+    char buf[CONFIG_RG_SSE_CLIENT_BUFFER_SIZE];
+};
+
+// Touched only from the HTTP server task (handler, queued work, session free)
+sse_client_t s_clients[CONFIG_RG_SSE_MAX_CLIENTS];
+uint32_t s_last_sequence = 0;
+
+std::atomic<httpd_handle_t> s_server{nullptr};
+std::atomic<int> s_client_count{0};
+std::atomic<bool> s_push_queued{false};
+
+const char kStreamHeaders[] = "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/event-stream\r\n"
+                              "Cache-Control: no-cache\r\n"
+                              "Connection: keep-alive\r\n"
+                              "\r\n";
+
+// Formats one "id: <seq>\ndata: {...}\n\n" event; returns 0 if it does not fit
+size_t format_event(char *out, size_t size, const shared_data_t &snapshot)
+{
+    int n = snprintf(out, size, "id: %lu\ndata: ", (unsigned long)snapshot.sequence);
+    if (n < 0 || (size_t)n + 2 >= size) {
+        return 0;
+    }
+    rg_json_writer json(out + n, size - n - 2);
+    shared_data_write_json(json, snapshot);
+    if (!json.ok()) {
+        return 0;
+    }
+    n += json.size();
+    out[n++] = '\n';
+    out[n++] = '\n';
+    return n;
+}
+
+void client_close(httpd_handle_t server, sse_client_t *client)
+{
+    if (!client->closing) {
+        client->closing = true;
+        httpd_sess_trigger_close(server, client->fd);
+    }
+}
+
+// Sends as much of the client's buffer as the socket takes without blocking.
+// Returns false if the connection is broken.
+bool client_flush(httpd_handle_t server, sse_client_t *client)
+{
+    while (client->len > 0) {
+        int sent = httpd_socket_send(server, client->fd, client->buf, client->len, MSG_DONTWAIT);
+        if (sent == HTTPD_SOCK_ERR_TIMEOUT) {
+            return true; // Socket buffer full; the rest goes out with the next push
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        memmove(client->buf, client->buf + sent, client->len - sent);
+        client->len -= sent;
+    }
+    return true;
+}
+
+// Appends an event to the client's buffer and flushes; slow or broken clients are dropped
+void client_push(httpd_handle_t server, sse_client_t *client, const char *event, size_t len)
+{
+    if (!client->active || client->closing) {
+        return;
+    }
+    if (client->len + len > sizeof(client->buf)) {
+        RG_TLOGW(TAG, "Dropping slow event client (fd %d, %u bytes backlog).", client->fd, (unsigned)client->len);
+        client_close(server, client);
+        return;
+    }
+    memcpy(client->buf + client->len, event, len);
+    client->len += len;
+    if (!client_flush(server, client)) {
+        client_close(server, client);
+    }
+}
+
+void push_work(void *arg)
+{
+    (void)arg;
+    s_push_queued.store(false);
+
+    shared_data_t snapshot;
+    shared_data_read(&snapshot);
+    if (snapshot.sequence == s_last_sequence) {
+        return;
+    }
+    s_last_sequence = snapshot.sequence;
+
+    char event[224];
+    size_t len = format_event(event, sizeof(event), snapshot);
+    if (len == 0) {
+        return;
+    }
+    httpd_handle_t server = s_server.load();
+    for (sse_client_t &client : s_clients) {
+        client_push(server, &client, event, len);
+    }
+}
+
+// free_ctx of the session: runs when the server closes the socket for any reason
+void client_session_closed(void *ctx)
+{
+    sse_client_t *client = static_cast<sse_client_t *>(ctx);
+    client->active = false;
+    client->closing = false;
+    client->len = 0;
+    s_client_count.fetch_sub(1);
+    RG_TLOGI(TAG, "Event client on fd %d closed, %d open.", client->fd, s_client_count.load());
+}
+
+} // namespace
+
+esp_err_t rg_sse_handle_request(httpd_req_t *req)
+{
+    sse_client_t *client = nullptr;
+    for (sse_client_t &c : s_clients) {
+        if (!c.active) {
+            client = &c;
+            break;
+        }
+    }
+    if (!client || req->sess_ctx) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "30");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    const int fd = httpd_req_to_sockfd(req);
+    if (httpd_socket_send(req->handle, fd, kStreamHeaders, sizeof(kStreamHeaders) - 1, 0) < 0) {
+        return ESP_FAIL;
+    }
+
+    client->active = true;
+    client->closing = false;
+    client->fd = fd;
+    client->len = 0;
+    // Tie the slot to the session so it is released whenever the socket goes away
+    req->sess_ctx = client;
+    req->free_ctx = client_session_closed;
+    s_server.store(req->handle);
+    s_client_count.fetch_add(1);
+    RG_TLOGI(TAG, "Event client on fd %d opened, %d open.", fd, s_client_count.load());
+
+    // Start the stream with the current sample so the page fills in immediately
+    shared_data_t snapshot;
+    shared_data_read(&snapshot);
+    char event[224];
+    size_t len = format_event(event, sizeof(event), snapshot);
+    if (len > 0) {
+        client_push(req->handle, client, event, len);
+    }
+    return ESP_OK;
+}
+
+void rg_sse_notify(void)
+{
+    httpd_handle_t server = s_server.load();
+    if (!server || s_client_count.load() == 0) {
+        return;
+    }
+    if (s_push_queued.exchange(true)) {
+        return; // A push is already pending and will pick up this sample
+    }
+    if (httpd_queue_work(server, push_work, NULL) != ESP_OK) {
+        s_push_queued.store(false);
+    }
+}
+
+int rg_sse_client_count(void)
+{
+    return s_client_count.load();
+}
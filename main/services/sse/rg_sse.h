@@ -0,0 +1,42 @@
+// main/services/sse/rg_sse.h
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Server-Sent Events push channel for live sensor samples.
+//
+// Browsers open GET /events once and then receive one event per published
+// sample instead of polling /data. Up to CONFIG_RG_SSE_MAX_CLIENTS streams are
+// served; each has its own fixed send buffer, and a client whose buffer
+// overflows (it stopped reading) is disconnected instead of stalling others.
+// All client state lives in the HTTP server task, so no locking is needed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handles GET /events: takes over the connection as an event stream.
+ *
+ * Replies 503 with Retry-After when all client slots are in use, which makes
+ * the dashboard fall back to polling /data.
+ */
+esp_err_t rg_sse_handle_request(httpd_req_t *req);
+
+/**
+ * @brief Schedules a push of the latest shared_data sample to all streams.
+ *
+ * Safe to call from any task; never blocks. Notifications that arrive while a
+ * push is still pending are coalesced, and unchanged samples are not resent.
+ */
+void rg_sse_notify(void);
+
+/**
+ * @brief Number of event streams currently open.
+ */
+int rg_sse_client_count(void);
+
+#ifdef __cplusplus
+}
+#endif
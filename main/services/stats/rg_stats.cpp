@@ -0,0 +1,289 @@
+// main/services/stats/rg_stats.cpp
+#include "rg_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "services/shared_data/rg_versioned_buffer.h"
+
+static_assert(RG_STATS_SLOTS >= 4 && RG_STATS_SLOTS <= 255, "slot indices are kept in uint8_t");
+
+namespace {
+
+struct channel_t {
+    int32_t ref; // First sample; sums are kept as offsets from it
+    bool has_ref;
+    uint8_t window_count;
+    rg_stats_window_t windows[RG_STATS_MAX_WINDOWS];
+};
+
+channel_t s_channels[RG_STATS_CHANNEL_COUNT];
+uint32_t s_samples = 0;
+uint32_t s_timestamp = 0;
+VersionedBuffer<rg_stats_snapshot_t> s_snapshot;
+
+const char *const s_channel_names[RG_STATS_CHANNEL_COUNT] = {"temperature", "humidity", "pressure"};
+
+inline void queue_pop_front(uint8_t *head, uint8_t *len)
+{
+    *head = (uint8_t)((*head + 1) % RG_STATS_SLOTS);
+    (*len)--;
+}
+
+inline uint8_t queue_back(const uint8_t *queue, uint8_t head, uint8_t len)
+{
+    return queue[(head + len - 1) % RG_STATS_SLOTS];
+}
+
+inline void queue_push_back(uint8_t *queue, uint8_t head, uint8_t *len, uint8_t index)
+{
+    queue[(head + *len) % RG_STATS_SLOTS] = index;
+    (*len)++;
+}
+
+// The open slot joins the window's closed slots
+void close_slot(rg_stats_window_t *w, uint8_t index)
+{
+    const rg_stats_slot_t *slot = &w->slots[index];
+    if (slot->count == 0) {
+        return;
+    }
+    w->squares += slot->squares;
+    w->sum += slot->sum;
+    w->count += slot->count;
+    // Slots behind a lower minimum (higher maximum) can never be the answer again
+    while (w->min_len && w->slots[queue_back(w->min_queue, w->min_head, w->min_len)].min >= slot->min) {
+        w->min_len--;
+    }
+    queue_push_back(w->min_queue, w->min_head, &w->min_len, index);
+    while (w->max_len && w->slots[queue_back(w->max_queue, w->max_head, w->max_len)].max <= slot->max) {
+        w->max_len--;
+    }
+    queue_push_back(w->max_queue, w->max_head, &w->max_len, index);
+}
+
+// The oldest closed slot leaves the window; its ring entry becomes the new open slot
+void expire_slot(rg_stats_window_t *w, uint8_t index)
+{
+    rg_stats_slot_t *slot = &w->slots[index];
+    if (slot->count > 0) {
+        w->squares -= slot->squares;
+        w->sum -= slot->sum;
+        w->count -= slot->count;
+        if (w->min_len && w->min_queue[w->min_head] == index) {
+            queue_pop_front(&w->min_head, &w->min_len);
+        }
+        if (w->max_len && w->max_queue[w->max_head] == index) {
+            queue_pop_front(&w->max_head, &w->max_len);
+        }
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+void reset_window(rg_stats_window_t *w, uint32_t current)
+{
+    memset(w->slots, 0, sizeof(w->slots));
+    w->squares = 0;
+    w->sum = 0;
+    w->count = 0;
+    w->min_head = w->min_len = 0;
+    w->max_head = w->max_len = 0;
+    w->current = current;
+    w->started = true;
+}
+
+void publish(void)
+{
+    rg_stats_snapshot_t snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.timestamp = s_timestamp;
+    snapshot.samples = s_samples;
+    for (int c = 0; c < RG_STATS_CHANNEL_COUNT; c++) {
+        const channel_t &channel = s_channels[c];
+        snapshot.window_count[c] = channel.window_count;
+        for (int i = 0; i < channel.window_count; i++) {
+            rg_stats_window_result(&channel.windows[i], channel.ref, &snapshot.results[c][i]);
+        }
+    }
+    s_snapshot.store(snapshot);
+}
+
+} // namespace
+
+void rg_stats_window_init(rg_stats_window_t *window, uint32_t length_s)
+{
+    memset(window, 0, sizeof(*window));
+    window->length_s = length_s;
+    window->slot_s = (length_s + RG_STATS_SLOTS - 1) / RG_STATS_SLOTS;
+    if (window->slot_s == 0) {
+        window->slot_s = 1;
+    }
+}
+
+void rg_stats_window_add(rg_stats_window_t *w, uint32_t now_s, int32_t offset)
+{
+    const uint32_t k = now_s / w->slot_s;
+    if (!w->started) {
+        reset_window(w, k);
+    } else if (k > w->current) {
+        close_slot(w, (uint8_t)(w->current % RG_STATS_SLOTS));
+        if (k - w->current >= RG_STATS_SLOTS) {
+            reset_window(w, k); // Nothing in the window any more
+        } else {
+            // Each step reuses the ring entry of the slot that falls out
+            for (uint32_t s = w->current + 1; s <= k; s++) {
+                expire_slot(w, (uint8_t)(s % RG_STATS_SLOTS));
+            }
+            w->current = k;
+        }
+    }
+
+    rg_stats_slot_t *slot = &w->slots[w->current % RG_STATS_SLOTS];
+    if (slot->count == 0) {
+        slot->min = slot->max = offset;
+    } else if (offset < slot->min) {
+        slot->min = offset;
+    } else if (offset > slot->max) {
+        slot->max = offset;
+    }
+    slot->sum += offset;
+    slot->squares += (int64_t)offset * offset;
+    slot->count++;
+}
+
+void rg_stats_window_result(const rg_stats_window_t *w, int32_t ref, rg_stats_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->length_s = w->length_s;
+    const rg_stats_slot_t *open = &w->slots[w->current % RG_STATS_SLOTS];
+    const uint32_t count = w->count + open->count;
+    if (!w->started || count == 0) {
+        return;
+    }
+
+    int32_t min = open->count ? open->min : INT32_MAX;
+    int32_t max = open->count ? open->max : INT32_MIN;
+    if (w->min_len && w->slots[w->min_queue[w->min_head]].min < min) {
+        min = w->slots[w->min_queue[w->min_head]].min;
+    }
+    if (w->max_len && w->slots[w->max_queue[w->max_head]].max > max) {
+        max = w->slots[w->max_queue[w->max_head]].max;
+    }
+
+    const int64_t sum = w->sum + open->sum;
+    const int64_t squares = w->squares + open->squares;
+    const double mean = (double)sum / count;
+    // Exact integers up to here; only the final division rounds
+    double variance = count > 1 ? ((double)squares - (double)sum * mean) / (count - 1) : 0.0;
+    if (variance < 0.0) {
+        variance = 0.0;
+    }
+
+    out->count = count;
+    out->min = ref + min;
+    out->max = ref + max;
+    out->mean = (float)(ref + mean);
+    out->stddev = (float)sqrt(variance);
+}
+
+esp_err_t rg_stats_parse_windows(const char *list, rg_stats_channel_config_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!list) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *p = list;
+    for (int n = 0;; n++) {
+        char *end;
+        unsigned long length = strtoul(p, &end, 10);
+        if (end == p || n == RG_STATS_MAX_WINDOWS || length < RG_STATS_SLOTS || length > UINT32_MAX / 2) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        out->windows_s[n] = (uint32_t)length;
+        p = end;
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p == '\0') {
+            return ESP_OK;
+        }
+        if (*p++ != ',') {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+}
+
+esp_err_t rg_stats_default_config(rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT])
+{
+    static const char *const lists[RG_STATS_CHANNEL_COUNT] = {
+        CONFIG_RG_STATS_TEMPERATURE_WINDOWS,
+        CONFIG_RG_STATS_HUMIDITY_WINDOWS,
+        CONFIG_RG_STATS_PRESSURE_WINDOWS,
+    };
+    for (int c = 0; c < RG_STATS_CHANNEL_COUNT; c++) {
+        esp_err_t err = rg_stats_parse_windows(lists[c], &config[c]);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t rg_stats_configure(const rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT])
+{
+    for (int c = 0; c < RG_STATS_CHANNEL_COUNT; c++) {
+        for (int i = 0; i < RG_STATS_MAX_WINDOWS && config[c].windows_s[i]; i++) {
+            if (config[c].windows_s[i] < RG_STATS_SLOTS) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    for (int c = 0; c < RG_STATS_CHANNEL_COUNT; c++) {
+        channel_t &channel = s_channels[c];
+        channel.has_ref = false;
+        channel.ref = 0;
+        channel.window_count = 0;
+        for (int i = 0; i < RG_STATS_MAX_WINDOWS && config[c].windows_s[i]; i++) {
+            rg_stats_window_init(&channel.windows[channel.window_count++], config[c].windows_s[i]);
+        }
+    }
+    s_samples = 0;
+    s_timestamp = 0;
+    publish();
+    return ESP_OK;
+}
+
+void rg_stats_add_fixed(uint32_t timestamp, int32_t temperature, int32_t humidity, int32_t pressure)
+{
+    const int32_t values[RG_STATS_CHANNEL_COUNT] = {temperature, humidity, pressure};
+    for (int c = 0; c < RG_STATS_CHANNEL_COUNT; c++) {
+        channel_t &channel = s_channels[c];
+        if (!channel.has_ref) {
+            channel.ref = values[c];
+            channel.has_ref = true;
+        }
+        for (int i = 0; i < channel.window_count; i++) {
+            rg_stats_window_add(&channel.windows[i], timestamp, values[c] - channel.ref);
+        }
+    }
+    s_samples++;
+    s_timestamp = timestamp;
+    publish();
+}
+
+void rg_stats_add(uint32_t timestamp, float temperature, float humidity, float pressure)
+{
+    rg_stats_add_fixed(timestamp, lroundf(temperature * 100.0f), lroundf(humidity * 100.0f),
+                       lroundf(pressure * 100.0f));
+}
+
+void rg_stats_read(rg_stats_snapshot_t *out)
+{
+    s_snapshot.load(out);
+}
+
+const char *rg_stats_channel_name(rg_stats_channel_t channel)
+{
+    return (unsigned)channel < RG_STATS_CHANNEL_COUNT ? s_channel_names[channel] : "";
+}
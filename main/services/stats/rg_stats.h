@@ -0,0 +1,156 @@
+// main/services/stats/rg_stats.h
+#ifndef RG_STATS_H_
+#define RG_STATS_H_
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include <sdkconfig.h>
+
+// Rolling min, max, mean and standard deviation per channel over sliding
+// time windows (by default the last 5 minutes, hour and day), for GET /stats.
+//
+// Each window is a ring of CONFIG_RG_STATS_SLOTS time slots. A sample only
+// touches the open slot; when time moves on to the next slot, the closed one
+// is added to the window's running totals and to two monotonic deques, and
+// the slot leaving the window is taken out again. So a sample costs the
+// same whatever the window length, and no history is scanned. The window
+// slides in steps of one slot: it covers the open slot plus the
+// CONFIG_RG_STATS_SLOTS - 1 before it, between length - length / slots and
+// length seconds.
+//
+// Values are fixed point in hundredths of the channel unit (0.01 degC,
+// 0.01 %RH, Pa). Sums are exact integers of the offset from the channel's
+// first sample, so taking a slot out of a window leaves no rounding error
+// behind; mean and variance are derived from them when results are
+// published.
+//
+// There is a single writer (the sensor task, for every reading). After
+// each sample it publishes the results of every window as one snapshot,
+// which any number of readers copy without blocking it.
+
+#define RG_STATS_SLOTS CONFIG_RG_STATS_SLOTS
+#define RG_STATS_MAX_WINDOWS 3 // Per channel
+
+typedef enum {
+    RG_STATS_TEMPERATURE,
+    RG_STATS_HUMIDITY,
+    RG_STATS_PRESSURE,
+    RG_STATS_CHANNEL_COUNT,
+} rg_stats_channel_t;
+
+// One time slot: what its samples add to the window
+typedef struct {
+    int64_t squares; // Sum of (x - ref)^2
+    int32_t sum;     // Sum of x - ref
+    int32_t min;
+    int32_t max;
+    uint32_t count;
+} rg_stats_slot_t;
+
+typedef struct {
+    uint32_t length_s;
+    uint32_t slot_s;
+    uint32_t current; // Slot number (time / slot_s) of the open slot
+    bool started;
+    rg_stats_slot_t slots[RG_STATS_SLOTS];
+    // Closed slots still in the window
+    int64_t squares;
+    int64_t sum;
+    uint32_t count;
+    // Ring indices of closed slots: minima ascending, maxima descending
+    uint8_t min_queue[RG_STATS_SLOTS];
+    uint8_t max_queue[RG_STATS_SLOTS];
+    uint8_t min_head, min_len;
+    uint8_t max_head, max_len;
+} rg_stats_window_t;
+
+typedef struct {
+    uint32_t length_s;
+    uint32_t count;   // Samples in the window; the rest is 0 without any
+    int32_t min;      // Fixed point
+    int32_t max;
+    float mean;       // Fixed point units, not rounded
+    float stddev;     // Sample standard deviation; 0 for a single sample
+} rg_stats_result_t;
+
+typedef struct {
+    uint32_t timestamp; // Of the newest sample
+    uint32_t samples;   // Added since rg_stats_configure()
+    uint8_t window_count[RG_STATS_CHANNEL_COUNT];
+    rg_stats_result_t results[RG_STATS_CHANNEL_COUNT][RG_STATS_MAX_WINDOWS];
+} rg_stats_snapshot_t;
+
+typedef struct {
+    uint32_t windows_s[RG_STATS_MAX_WINDOWS]; // Window lengths; 0 ends the list
+} rg_stats_channel_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up an empty window of @p length_s seconds (at least RG_STATS_SLOTS).
+ */
+void rg_stats_window_init(rg_stats_window_t *window, uint32_t length_s);
+
+/**
+ * @brief Adds one value, as an offset from the channel's reference, at @p now_s.
+ *
+ * A time before the open slot counts in the open slot.
+ */
+void rg_stats_window_add(rg_stats_window_t *window, uint32_t now_s, int32_t offset);
+
+/**
+ * @brief Statistics of the samples in @p window, with @p ref added back.
+ */
+void rg_stats_window_result(const rg_stats_window_t *window, int32_t ref, rg_stats_result_t *out);
+
+/**
+ * @brief Parses a comma-separated list of window lengths in seconds, e.g. "300,3600,86400".
+ *
+ * @return ESP_ERR_INVALID_ARG for anything but 1 to RG_STATS_MAX_WINDOWS
+ *         lengths of at least RG_STATS_SLOTS seconds.
+ */
+esp_err_t rg_stats_parse_windows(const char *list, rg_stats_channel_config_t *out);
+
+/**
+ * @brief Fills @p config from the CONFIG_RG_STATS_*_WINDOWS lists.
+ */
+esp_err_t rg_stats_default_config(rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT]);
+
+/**
+ * @brief Starts over with the given windows per channel. Not while samples are being added.
+ */
+esp_err_t rg_stats_configure(const rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT]);
+
+/**
+ * @brief Adds one sample to every window and publishes the results (single writer).
+ *
+ * @param timestamp Seconds on the rg_history time line.
+ */
+void rg_stats_add(uint32_t timestamp, float temperature, float humidity, float pressure);
+
+/**
+ * @brief Same as rg_stats_add() in fixed point: 0.01 degC, 0.01 %RH and Pa.
+ */
+void rg_stats_add_fixed(uint32_t timestamp, int32_t temperature, int32_t humidity, int32_t pressure);
+
+/**
+ * @brief Copies the latest published results. Wait-free with respect to the writer.
+ */
+void rg_stats_read(rg_stats_snapshot_t *out);
+
+/**
+ * @brief "temperature", "humidity" or "pressure".
+ */
+const char *rg_stats_channel_name(rg_stats_channel_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RG_STATS_H_ */
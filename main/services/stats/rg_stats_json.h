@@ -0,0 +1,52 @@
+// main/services/stats/rg_stats_json.h
+#pragma once
+
+#include <math.h>
+
+#include "rg_stats.h"
+#include "services/json/rg_json_writer.h"
+
+// One channel as an array of its windows, in configured order. Values are in
+// the units /data uses (degC, %RH, hPa); a window without samples has count 0
+// and nulls.
+static inline void rg_stats_write_json_channel(rg_json_writer &json, const rg_stats_snapshot_t &snapshot,
+                                               rg_stats_channel_t channel)
+{
+    json.begin_array();
+    for (int i = 0; i < snapshot.window_count[channel]; i++) {
+        const rg_stats_result_t &result = snapshot.results[channel][i];
+        const bool empty = result.count == 0;
+        json.begin_object();
+        json.key("count");
+        json.value(result.count);
+        json.key("max");
+        json.value(empty ? NAN : result.max / 100.0);
+        json.key("mean");
+        json.value(empty ? NAN : round(result.mean * 10.0) / 1000.0);
+        json.key("min");
+        json.value(empty ? NAN : result.min / 100.0);
+        json.key("stddev");
+        json.value(empty ? NAN : round(result.stddev * 10.0) / 1000.0);
+        json.key("window_s");
+        json.value(result.length_s);
+        json.end_object();
+    }
+    json.end_array();
+}
+
+// Writes a snapshot as the /stats JSON object; keys sorted as everywhere else
+static inline void rg_stats_write_json(rg_json_writer &json, const rg_stats_snapshot_t &snapshot, uint32_t now)
+{
+    json.begin_object();
+    json.key("humidity");
+    rg_stats_write_json_channel(json, snapshot, RG_STATS_HUMIDITY);
+    json.key("now");
+    json.value(now);
+    json.key("pressure");
+    rg_stats_write_json_channel(json, snapshot, RG_STATS_PRESSURE);
+    json.key("samples");
+    json.value(snapshot.samples);
+    json.key("temperature");
+    rg_stats_write_json_channel(json, snapshot, RG_STATS_TEMPERATURE);
+    json.end_object();
+}
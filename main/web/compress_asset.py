@@ -0,0 +1,14 @@
+#!/usr/bin/env python
+# Gzips a web asset for embedding in the firmware image.
+# mtime is pinned so identical sources give identical blobs (and ETags).
+import gzip
+import sys
+
+if len(sys.argv) != 3:
+    sys.exit('usage: compress_asset.py <input> <output.gz>')
+
+with open(sys.argv[1], 'rb') as src:
+    data = src.read()
+with open(sys.argv[2], 'wb') as dst:
+    with gzip.GzipFile(filename='', mode='wb', fileobj=dst, compresslevel=9, mtime=0) as gz:
+        gz.write(data)
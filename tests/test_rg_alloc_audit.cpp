@@ -0,0 +1,299 @@
+#include "unity.h"
+#include "communications/rg_mqtt_publisher.h"
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+#include "services/codec/rg_ts_codec.h"
+#include "services/bus/rg_event_bus.h"
+#include "services/flash_log/rg_flash_log.h"
+#include "services/history/rg_history.h"
+#include "services/metrics/rg_alloc_audit.h"
+#include "services/pipeline/rg_pipeline.h"
+#include "services/rules/rg_rules.h"
+#include "services/shared_data/shared_data.h"
+#include "services/sse/rg_sse.h"
+#include "services/stats/rg_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __has_include("rg_httpd_host.h")
+#include "rg_httpd_host.h"
+#include "services/rg_http_server.h"
+#define HAVE_HTTPD_HOST 1
+#endif
+
+// Steady state must not touch the heap: after a warm-up pass, a sampling
+// cycle and every HTTP route are run again and the allocation counters must
+// not move. Counting needs the malloc wrapper (host) or CONFIG_RG_ALLOC_AUDIT
+// (device); without either the checks are skipped.
+
+#define CYCLES 200
+
+static bool counting(void)
+{
+    rg_alloc_counts_t before, after;
+    rg_alloc_audit_snapshot(&before);
+    void *volatile p = malloc(24);
+    free(p);
+    rg_alloc_audit_snapshot(&after);
+    if (after.allocs == before.allocs) {
+        printf("rg_alloc_audit: allocations are not counted in this build, skipped\n");
+        return false;
+    }
+    return true;
+}
+
+static void assert_no_allocations(const rg_alloc_counts_t *before, const char *what)
+{
+    rg_alloc_counts_t after;
+    rg_alloc_audit_snapshot(&after);
+    if (after.allocs != before->allocs) {
+        printf("rg_alloc_audit: %s made %u allocations (%u bytes)\n", what, (unsigned)(after.allocs - before->allocs),
+               (unsigned)(after.bytes - before->bytes));
+    }
+    TEST_ASSERT_EQUAL_UINT32(before->allocs, after.allocs);
+    TEST_ASSERT_EQUAL_UINT32(before->frees, after.frees);
+}
+
+TEST_CASE("rg_alloc_audit counts allocations and frees", "[rg_alloc_audit]")
+{
+    if (!counting()) {
+        return;
+    }
+    rg_alloc_counts_t before, after;
+    rg_alloc_audit_snapshot(&before);
+    void *volatile a = malloc(100);
+    void *volatile b = calloc(4, 25);
+    a = realloc(a, 200);
+    free(a);
+    free(b);
+    rg_alloc_audit_snapshot(&after);
+    TEST_ASSERT_EQUAL_UINT32(3, after.allocs - before.allocs);
+    TEST_ASSERT_EQUAL_UINT32(2, after.frees - before.frees);
+    TEST_ASSERT_EQUAL_UINT32(400, after.bytes - before.bytes);
+}
+
+// What bme280_task does for one reading, through the same rg_pipeline, with
+// the portable rules and bus engines in place of their tasks and the
+// consumers of main.cpp polled inline
+static rg_bme280_sim_t s_sims[2];
+static rg_bme280_t s_sensors[2];
+static rg_bme280_t *const s_group[2] = {&s_sensors[0], &s_sensors[1]};
+static rg_rule_t s_rules[2];
+static rg_rule_state_t s_rule_states[2];
+static rg_rules_t s_rules_engine;
+static rg_event_slot_t s_bus_slots[16];
+static rg_event_bus_t s_bus;
+static rg_event_sub_t s_http_sub = RG_EVENT_SUB_INIT("http", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+static rg_event_sub_t s_log_sub = RG_EVENT_SUB_INIT("log", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_READING));
+static rg_event_sub_t s_mqtt_sub = RG_EVENT_SUB_INIT("mqtt", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+static uint8_t s_flash[4 * 4096];
+static rg_flash_log_t s_flash_log;
+static rg_mqtt_sample_t s_mqtt_storage[64];
+static rg_mqtt_publisher_t s_mqtt;
+static uint8_t s_payload[1024];
+static uint8_t s_block[256];
+static rg_ts_encoder_t s_encoder;
+
+static esp_err_t flash_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    memcpy(dst, s_flash + offset, len);
+    return ESP_OK;
+}
+
+static esp_err_t flash_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    memcpy(s_flash + offset, src, len);
+    return ESP_OK;
+}
+
+static esp_err_t flash_erase_sector(void *ctx, size_t offset)
+{
+    memset(s_flash + offset, 0xff, 4096);
+    return ESP_OK;
+}
+
+// rg_rules_task's on_change and evaluate, without the GPIOs
+static void rule_changed(void *ctx, int index, const rg_rule_t *rule, bool active, int32_t value)
+{
+    rg_event_t event = {};
+    event.type = RG_EVENT_RULE;
+    event.rule.index = (uint16_t)index;
+    event.rule.active = active;
+    event.rule.value = value;
+    rg_event_bus_publish(&s_bus, &event, 0);
+}
+
+static void evaluate_rules(void *ctx, int64_t now_us, float temperature, float humidity, float pressure)
+{
+    const int32_t values[RG_RULES_CHANNEL_COUNT] = {(int32_t)lroundf(temperature * 100.0f),
+                                                    (int32_t)lroundf(humidity * 100.0f),
+                                                    (int32_t)lroundf(pressure * 100.0f)};
+    rg_rules_evaluate(&s_rules_engine, (uint32_t)(now_us / 1000), values);
+}
+
+static void publish(void *ctx, const rg_event_t *event)
+{
+    rg_event_bus_publish(&s_bus, event, 0);
+}
+
+// http_sample, log_reading and mqtt_sample of main.cpp, plus the codec fed from the log
+static void consume_events(uint32_t ts)
+{
+    rg_event_t event;
+    while (rg_event_bus_poll(&s_bus, &s_http_sub, &event)) {
+        shared_data_publish(event.sample.temperature, event.sample.humidity, event.sample.pressure, event.time_us);
+        rg_sse_notify();
+    }
+#if HAVE_HTTPD_HOST
+    rg_httpd_host_poll();
+#endif
+
+    while (rg_event_bus_poll(&s_bus, &s_log_sub, &event)) {
+        const rg_event_sample_t *s = &event.sample;
+        rg_history_add(s->timestamp, s->temperature, s->humidity, s->pressure);
+        rg_flash_log_record_t record = {s->timestamp, (int16_t)lroundf(s->temperature * 100.0f),
+                                        (uint16_t)lroundf(s->humidity * 100.0f),
+                                        (uint16_t)lroundf(s->pressure * 10.0f)};
+        TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_append(&s_flash_log, &record));
+
+        rg_ts_sample_t ts_sample;
+        const rg_bme280_values_t v = {s->temperature, s->pressure, s->humidity};
+        rg_ts_sample_from_values(&ts_sample, s->timestamp, &v);
+        if (!rg_ts_encoder_append(&s_encoder, &ts_sample)) {
+            rg_ts_encoder_init(&s_encoder, s_block, sizeof(s_block));
+            rg_ts_encoder_append(&s_encoder, &ts_sample);
+        }
+    }
+
+    while (rg_event_bus_poll(&s_bus, &s_mqtt_sub, &event)) {
+        const rg_event_sample_t *s = &event.sample;
+        rg_mqtt_sample_t sample = {s->timestamp, (int16_t)lroundf(s->temperature * 100.0f),
+                                   (uint16_t)lroundf(s->humidity * 100.0f), (uint16_t)lroundf(s->pressure * 10.0f)};
+        rg_mqtt_publisher_push(&s_mqtt, &sample);
+    }
+    if (rg_mqtt_publisher_next(&s_mqtt, ts, "rg2-000000", s_payload, sizeof(s_payload)) > 0) {
+        rg_mqtt_publisher_acked(&s_mqtt);
+    }
+}
+
+static void sampling_cycle(uint32_t now_ms)
+{
+    rg_bme280_values_t readings[2];
+    esp_err_t results[2];
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_read_group(s_group, 2, readings, results));
+    rg_bme280_values_t v = {};
+    for (int i = 0; i < 2; i++) {
+        v.temperature += readings[i].temperature / 2;
+        v.humidity += readings[i].humidity / 2;
+        v.pressure += readings[i].pressure / 2;
+    }
+    const uint32_t ts = now_ms / 1000;
+    rg_pipeline_process((int64_t)now_ms * 1000, ts, v.temperature, v.humidity, v.pressure, NULL);
+    consume_events(ts);
+}
+
+TEST_CASE("rg_alloc_audit: a sampling cycle does not allocate", "[rg_alloc_audit]")
+{
+    if (!counting()) {
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        rg_bme280_sim_init(&s_sims[i], &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+        rg_bme280_bus_t bus = rg_bme280_sim_bus(&s_sims[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_init_with_bus(&s_sensors[i], &bus));
+    }
+    size_t rule_count = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_rules_compile("warm: temperature > 0; heating: temperature rate > 1 for 1m",
+                                               s_rules, 2, &rule_count, NULL));
+    rg_rules_init(&s_rules_engine, s_rules, s_rule_states, rule_count, 60000, rule_changed, NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&s_bus, s_bus_slots, 16, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&s_bus, &s_http_sub));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&s_bus, &s_log_sub));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&s_bus, &s_mqtt_sub));
+    memset(s_flash, 0xff, sizeof(s_flash));
+    const rg_flash_log_io_t io = {flash_read, flash_write, flash_erase_sector, NULL, sizeof(s_flash), 4096};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_mount(&s_flash_log, &io, NULL, NULL));
+    rg_mqtt_publisher_init(&s_mqtt, s_mqtt_storage, 64, 10, 300, RG_MQTT_FORMAT_CBOR, 24);
+    rg_mqtt_publisher_set_connected(&s_mqtt, true);
+    rg_ts_encoder_init(&s_encoder, s_block, sizeof(s_block));
+    rg_history_reset();
+    rg_stats_channel_config_t stats_config[RG_STATS_CHANNEL_COUNT];
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_default_config(stats_config));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_configure(stats_config));
+
+    // A heartbeat shorter than a cycle, so every reading is also published and takes the full path
+    rg_sampler_config_t config;
+    rg_sampler_default_config(&config);
+    config.heartbeat_ms = 1;
+    const rg_pipeline_port_t port = {evaluate_rules, publish, NULL};
+    rg_pipeline_init(&config, &port);
+#if HAVE_HTTPD_HOST
+    // An open dashboard, so the push to event streams runs too
+    int fd = rg_httpd_host_open();
+    rg_httpd_host_response_t resp;
+    rg_httpd_host_get(fd, "/events", NULL, rg_http_handle_request, &resp);
+#endif
+
+    uint32_t now_ms = 1000000;
+    sampling_cycle(now_ms); // Warm-up: lazily created state, first log lines
+    rg_alloc_counts_t before;
+    rg_alloc_audit_snapshot(&before);
+    for (int i = 0; i < CYCLES; i++) {
+        now_ms += 10000;
+        sampling_cycle(now_ms);
+    }
+    assert_no_allocations(&before, "sampling cycle");
+    TEST_ASSERT_EQUAL_UINT32(CYCLES + 1, rg_pipeline_sampler()->stats.publishes);
+    TEST_ASSERT_EQUAL_UINT32(CYCLES + 1, s_flash_log.stats.records_appended);
+    TEST_ASSERT_TRUE(s_rule_states[0].active);
+
+#if HAVE_HTTPD_HOST
+    rg_httpd_host_close(fd);
+#endif
+}
+
+#if HAVE_HTTPD_HOST
+TEST_CASE("rg_alloc_audit: HTTP routes do not allocate after warm-up", "[rg_alloc_audit]")
+{
+    if (!counting()) {
+        return;
+    }
+    static const char *const uris[] = {"/",        "/data",     "/history?tier=raw", "/history?tier=minute",
+                                       "/metrics", "/stats",    "/settings",         "/ota",
+                                       "/events",  "/missing"};
+    rg_history_reset();
+    for (uint32_t i = 0; i < 2000; i++) {
+        rg_history_add_fixed(1000000 + i * 10, (int16_t)(2100 + i % 50), (uint16_t)(4500 + i % 300), 10130);
+    }
+    shared_data_publish(21.37f, 48.52f, 1013.25f, 123456789);
+
+    // An event stream keeps its session, so each /events request opens and closes one
+    int fd = rg_httpd_host_open();
+    rg_httpd_host_response_t resp;
+    // Warm-up: the host server's body buffer grows once
+    for (const char *uri : uris) {
+        int session = strcmp(uri, "/events") == 0 ? rg_httpd_host_open() : fd;
+        rg_httpd_host_get(session, uri, NULL, rg_http_handle_request, &resp);
+        if (session != fd) {
+            rg_httpd_host_close(session);
+        }
+    }
+    for (const char *uri : uris) {
+        rg_alloc_counts_t before;
+        rg_alloc_audit_snapshot(&before);
+        for (int i = 0; i < 10; i++) {
+            int session = strcmp(uri, "/events") == 0 ? rg_httpd_host_open() : fd;
+            rg_httpd_host_get(session, uri, NULL, rg_http_handle_request, &resp);
+            TEST_ASSERT_TRUE(resp.status != 500);
+            if (session != fd) {
+                rg_httpd_host_close(session);
+            }
+        }
+        assert_no_allocations(&before, uri);
+    }
+    rg_httpd_host_close(fd);
+}
+#endif
@@ -1,5 +1,24 @@
 #include "unity.h"
-#include "rg_bme280.h"
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Expected results for rg_bme280_sim_reference_calib / rg_bme280_sim_reference_raw
+#define REF_TEMPERATURE 2508       // 25.08 degC
+#define REF_PRESSURE_Q24_8 25767233 // 100653.25 Pa
+#define REF_HUMIDITY_Q22_10 52306   // 51.08 %RH
+
+static rg_bme280_sim_t s_sim;
+static rg_bme280_bus_t s_sim_bus;
+
+static void sim_setup(rg_bme280_sim_t *sim, const rg_bme280_calib_t *calib, const rg_bme280_raw_t *adc)
+{
+    rg_bme280_sim_init(sim, calib, adc);
+    s_sim_bus = rg_bme280_sim_bus(sim);
+}
 
 TEST_CASE("rg_bme280_read_values returns invalid arg on NULL parameters", "[rg_bme280]")
 {
@@ -9,6 +28,145 @@ TEST_CASE("rg_bme280_read_values returns invalid arg on NULL parameters", "[rg_b
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, err);
 }
 
+TEST_CASE("rg_bme280 fixed point compensation matches the reference vectors", "[rg_bme280]")
+{
+    rg_bme280_fixed_t out;
+    rg_bme280_compensate(&rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw, &out);
+    TEST_ASSERT_EQUAL_INT32(REF_TEMPERATURE, out.temperature);
+    TEST_ASSERT_EQUAL_UINT32(REF_PRESSURE_Q24_8, out.pressure);
+    TEST_ASSERT_EQUAL_UINT32(REF_HUMIDITY_Q22_10, out.humidity);
+
+    // Within rounding of the datasheet's double precision formulas
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 100653.27f, out.pressure / 256.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 51.083f, out.humidity / 1024.0f);
+}
+
+TEST_CASE("rg_bme280 calibration and data registers decode like the datasheet layout", "[rg_bme280]")
+{
+    sim_setup(&s_sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_sim_latch(&s_sim);
+
+    rg_bme280_calib_t calib;
+    rg_bme280_parse_calib(&s_sim.regs[RG_BME280_REG_CALIB_TP], &s_sim.regs[RG_BME280_REG_CALIB_H], &calib);
+    TEST_ASSERT_EQUAL_UINT16(rg_bme280_sim_reference_calib.dig_T1, calib.dig_T1);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_T3, calib.dig_T3);
+    TEST_ASSERT_EQUAL_UINT16(rg_bme280_sim_reference_calib.dig_P1, calib.dig_P1);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_P6, calib.dig_P6);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_P9, calib.dig_P9);
+    TEST_ASSERT_EQUAL_UINT8(rg_bme280_sim_reference_calib.dig_H1, calib.dig_H1);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_H2, calib.dig_H2);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_H4, calib.dig_H4);
+    TEST_ASSERT_EQUAL_INT16(rg_bme280_sim_reference_calib.dig_H5, calib.dig_H5);
+    TEST_ASSERT_EQUAL_INT8(rg_bme280_sim_reference_calib.dig_H6, calib.dig_H6);
+
+    rg_bme280_raw_t raw;
+    rg_bme280_parse_raw(&s_sim.regs[RG_BME280_REG_DATA], &raw);
+    TEST_ASSERT_EQUAL_INT32(rg_bme280_sim_reference_raw.adc_T, raw.adc_T);
+    TEST_ASSERT_EQUAL_INT32(rg_bme280_sim_reference_raw.adc_P, raw.adc_P);
+    TEST_ASSERT_EQUAL_INT32(rg_bme280_sim_reference_raw.adc_H, raw.adc_H);
+}
+
+TEST_CASE("rg_bme280 negative dig_H4/H5 survive the shared nibble encoding", "[rg_bme280]")
+{
+    rg_bme280_calib_t c = rg_bme280_sim_reference_calib;
+    c.dig_H4 = -300;
+    c.dig_H5 = -7;
+    sim_setup(&s_sim, &c, &rg_bme280_sim_reference_raw);
+
+    rg_bme280_calib_t calib;
+    rg_bme280_parse_calib(&s_sim.regs[RG_BME280_REG_CALIB_TP], &s_sim.regs[RG_BME280_REG_CALIB_H], &calib);
+    TEST_ASSERT_EQUAL_INT16(-300, calib.dig_H4);
+    TEST_ASSERT_EQUAL_INT16(-7, calib.dig_H5);
+}
+
+TEST_CASE("rg_bme280 forced mode sample uses one data burst", "[rg_bme280]")
+{
+    sim_setup(&s_sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_t dev = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_init_with_bus(&dev, &s_sim_bus));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_RG_BME280_OVERSAMPLING_H, s_sim.regs[RG_BME280_REG_CTRL_HUM]);
+    TEST_ASSERT_EQUAL_UINT8(RG_BME280_MODE_SLEEP, s_sim.regs[RG_BME280_REG_CTRL_MEAS] & 0x03);
+
+    rg_bme280_sim_reset_counters(&s_sim);
+    rg_bme280_fixed_t out;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_read_fixed(&dev, &out));
+    TEST_ASSERT_EQUAL_INT32(REF_TEMPERATURE, out.temperature);
+    TEST_ASSERT_EQUAL_UINT32(REF_PRESSURE_Q24_8, out.pressure);
+    TEST_ASSERT_EQUAL_UINT32(REF_HUMIDITY_Q22_10, out.humidity);
+
+    // Trigger write, one status poll, one 8-byte burst
+    TEST_ASSERT_EQUAL_UINT32(3, s_sim.transactions);
+    TEST_ASSERT_EQUAL_UINT32(3 + (3 + 1) + (3 + RG_BME280_DATA_LEN), s_sim.bus_bytes);
+    TEST_ASSERT_EQUAL_UINT32(dev.measure_time_us, s_sim.delay_us);
+
+    rg_bme280_values_t values;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_read_values(&dev, &values));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.08f, values.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1006.53f, values.pressure);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 51.08f, values.humidity);
+}
+
+TEST_CASE("rg_bme280 times out when the conversion never completes", "[rg_bme280]")
+{
+    sim_setup(&s_sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_t dev = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_init_with_bus(&dev, &s_sim_bus));
+    s_sim.busy_polls = 1000;
+
+    rg_bme280_fixed_t out;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, rg_bme280_read_fixed(&dev, &out));
+}
+
+TEST_CASE("rg_bme280 rejects a part with the wrong chip id", "[rg_bme280]")
+{
+    sim_setup(&s_sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    s_sim.regs[RG_BME280_REG_CHIP_ID] = 0x58; // BMP280
+    rg_bme280_t dev = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rg_bme280_init_with_bus(&dev, &s_sim_bus));
+}
+
+TEST_CASE("rg_bme280 I2C cost per sample", "[rg_bme280][bench]")
+{
+    // 9 clocks per byte (8 data + ACK) at the shared bus clock
+    const double us_per_byte = 9 * 1e6 / CONFIG_RG_I2C_BUS_MAX_SCL_HZ;
+
+    sim_setup(&s_sim, &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_t dev = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_init_with_bus(&dev, &s_sim_bus));
+
+    const int samples = 1000;
+    rg_bme280_sim_reset_counters(&s_sim);
+    rg_bme280_fixed_t out;
+    for (int i = 0; i < samples; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_read_fixed(&dev, &out));
+    }
+    double bytes = (double)s_sim.bus_bytes / samples;
+    double transactions = (double)s_sim.transactions / samples;
+
+    // The bme280 component reads temperature (3 bytes), then temperature again
+    // plus humidity (2 bytes), then temperature again plus pressure (3 bytes),
+    // one transaction each.
+    const double legacy_transactions = 5;
+    const double legacy_bytes = legacy_transactions * 3 + (3 + 3 + 2 + 3 + 3);
+
+    clock_t start = clock();
+    volatile uint32_t sink = 0;
+    for (int i = 0; i < 100000; i++) {
+        rg_bme280_raw_t raw = rg_bme280_sim_reference_raw;
+        raw.adc_T += i & 0xFF;
+        rg_bme280_compensate(&rg_bme280_sim_reference_calib, &raw, &out);
+        sink += out.pressure;
+    }
+    double compensate_us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / 100000;
+
+    printf("rg_bme280: burst  %.1f transactions, %.1f bus bytes, %.0f us on the bus, %u us conversion\n",
+           transactions, bytes, bytes * us_per_byte, (unsigned)dev.measure_time_us);
+    printf("rg_bme280: legacy %.1f transactions, %.1f bus bytes, %.0f us on the bus\n", legacy_transactions,
+           legacy_bytes, legacy_bytes * us_per_byte);
+    printf("rg_bme280: fixed point compensation %.3f us per sample\n", compensate_us);
+    TEST_ASSERT_TRUE(bytes < legacy_bytes);
+}
+
 void app_main(void)
 {
     UNITY_BEGIN();
@@ -0,0 +1,121 @@
+#include "unity.h"
+#include "services/boot/rg_boot.h"
+
+#include <string.h>
+
+static esp_err_t stage_ok(void *arg)
+{
+    (void)arg;
+    return ESP_OK;
+}
+
+// Runs the graph on one worker, finishing each stage as soon as it is claimed
+static void run_in_order(rg_boot_t *boot, const esp_err_t *results, int *order, int *ran)
+{
+    *ran = 0;
+    int64_t now = 0;
+    for (int id; (id = rg_boot_take_ready(boot, now)) >= 0;) {
+        order[(*ran)++] = id;
+        now += 1000;
+        rg_boot_finish(boot, id, results[id], now);
+    }
+}
+
+TEST_CASE("rg_boot runs each stage after its dependencies", "[rg_boot]")
+{
+    rg_boot_t boot;
+    rg_boot_init(&boot);
+    int a = rg_boot_add(&boot, "a", stage_ok, NULL, 0);
+    int b = rg_boot_add(&boot, "b", stage_ok, NULL, 0);
+    int c = rg_boot_add(&boot, "c", stage_ok, NULL, RG_BOOT_DEP(a) | RG_BOOT_DEP(b));
+    int d = rg_boot_add(&boot, "d", stage_ok, NULL, RG_BOOT_DEP(a));
+    TEST_ASSERT_EQUAL_INT(3, d);
+
+    // Both roots can start at once; c waits for both, d only for a
+    TEST_ASSERT_EQUAL_INT(a, rg_boot_take_ready(&boot, 0));
+    TEST_ASSERT_EQUAL_INT(b, rg_boot_take_ready(&boot, 0));
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_take_ready(&boot, 0));
+    rg_boot_finish(&boot, a, ESP_OK, 100);
+    TEST_ASSERT_EQUAL_INT(d, rg_boot_take_ready(&boot, 100));
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_take_ready(&boot, 100));
+    rg_boot_finish(&boot, b, ESP_OK, 200);
+    TEST_ASSERT_EQUAL_INT(c, rg_boot_take_ready(&boot, 200));
+    TEST_ASSERT_FALSE(rg_boot_done(&boot));
+    rg_boot_finish(&boot, c, ESP_OK, 300);
+    rg_boot_finish(&boot, d, ESP_OK, 300);
+    TEST_ASSERT_TRUE(rg_boot_done(&boot));
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_take_ready(&boot, 300));
+    TEST_ASSERT_EQUAL_INT64(100, boot.stages[d].start_us);
+    TEST_ASSERT_EQUAL_INT64(200, boot.stages[c].start_us);
+}
+
+TEST_CASE("rg_boot skips what depends on a failed stage and nothing else", "[rg_boot]")
+{
+    rg_boot_t boot;
+    rg_boot_init(&boot);
+    int i2c = rg_boot_add(&boot, "i2c", stage_ok, NULL, 0);
+    int sensors = rg_boot_add(&boot, "sensors", stage_ok, NULL, RG_BOOT_DEP(i2c));
+    int wifi = rg_boot_add(&boot, "wifi", stage_ok, NULL, 0);
+    int sampling = rg_boot_add(&boot, "sampling", stage_ok, NULL, RG_BOOT_DEP(sensors));
+    int http = rg_boot_add(&boot, "http", stage_ok, NULL, RG_BOOT_DEP(wifi));
+
+    const esp_err_t results[] = {ESP_OK, ESP_ERR_NOT_FOUND, ESP_OK, ESP_OK, ESP_OK};
+    int order[RG_BOOT_MAX_STAGES];
+    int ran;
+    run_in_order(&boot, results, order, &ran);
+
+    TEST_ASSERT_TRUE(rg_boot_done(&boot));
+    TEST_ASSERT_EQUAL_INT(4, ran);
+    TEST_ASSERT_EQUAL(RG_BOOT_DONE, boot.stages[i2c].status);
+    TEST_ASSERT_EQUAL(RG_BOOT_FAILED, boot.stages[sensors].status);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, boot.stages[sensors].err);
+    TEST_ASSERT_EQUAL(RG_BOOT_SKIPPED, boot.stages[sampling].status);
+    TEST_ASSERT_EQUAL(RG_BOOT_DONE, boot.stages[wifi].status);
+    TEST_ASSERT_EQUAL(RG_BOOT_DONE, boot.stages[http].status);
+}
+
+TEST_CASE("rg_boot skips in cascade", "[rg_boot]")
+{
+    rg_boot_t boot;
+    rg_boot_init(&boot);
+    int a = rg_boot_add(&boot, "a", stage_ok, NULL, 0);
+    int b = rg_boot_add(&boot, "b", stage_ok, NULL, RG_BOOT_DEP(a));
+    int c = rg_boot_add(&boot, "c", stage_ok, NULL, RG_BOOT_DEP(b));
+
+    TEST_ASSERT_EQUAL_INT(a, rg_boot_take_ready(&boot, 0));
+    rg_boot_finish(&boot, a, ESP_FAIL, 10);
+    // One call settles the whole chain, so a worker sees the boot end
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_take_ready(&boot, 10));
+    TEST_ASSERT_TRUE(rg_boot_done(&boot));
+    TEST_ASSERT_EQUAL(RG_BOOT_SKIPPED, boot.stages[b].status);
+    TEST_ASSERT_EQUAL(RG_BOOT_SKIPPED, boot.stages[c].status);
+}
+
+TEST_CASE("rg_boot rejects dependencies on later stages and a full table", "[rg_boot]")
+{
+    rg_boot_t boot;
+    rg_boot_init(&boot);
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_add(&boot, "self", stage_ok, NULL, RG_BOOT_DEP(0)));
+    int a = rg_boot_add(&boot, "a", stage_ok, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_add(&boot, "forward", stage_ok, NULL, RG_BOOT_DEP(a + 1)));
+    TEST_ASSERT_EQUAL_INT(1, rg_boot_add(&boot, "b", stage_ok, NULL, RG_BOOT_DEP(a)));
+
+    for (int i = boot.count; i < RG_BOOT_MAX_STAGES; i++) {
+        TEST_ASSERT_EQUAL_INT(i, rg_boot_add(&boot, "filler", stage_ok, NULL, 0));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, rg_boot_add(&boot, "overflow", stage_ok, NULL, 0));
+}
+
+TEST_CASE("rg_boot records a milestone only the first time", "[rg_boot]")
+{
+    // Milestones are process-wide; other tests may have reached some already
+    const rg_boot_mark_t mark = RG_BOOT_MARK_GOT_IP;
+    int64_t before = rg_boot_mark_us(mark);
+    bool first = rg_boot_mark(mark, 850000);
+    TEST_ASSERT_EQUAL(before == 0, first);
+    int64_t at = rg_boot_mark_us(mark);
+    TEST_ASSERT_NOT_EQUAL(0, at);
+    TEST_ASSERT_FALSE(rg_boot_mark(mark, 990000));
+    TEST_ASSERT_EQUAL_INT64(at, rg_boot_mark_us(mark));
+    TEST_ASSERT_EQUAL_STRING("got_ip", rg_boot_mark_name(mark));
+}
@@ -0,0 +1,361 @@
+#include "unity.h"
+#include "services/config/rg_config.h"
+#include "services/config/rg_config_json.h"
+#include "services/config/rg_settings.h"
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+// NVS stand-in: what is committed, what is written but not yet committed, and the flash traffic
+struct fake_nvs {
+    std::map<std::string, std::string> stored;
+    std::map<std::string, std::string> pending;
+    int writes = 0;
+    int commits = 0;
+    bool fail_commit = false;
+};
+
+static esp_err_t fake_read_int(void *ctx, const char *name, int32_t *value)
+{
+    fake_nvs *nvs = (fake_nvs *)ctx;
+    auto it = nvs->stored.find(name);
+    if (it == nvs->stored.end()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *value = (int32_t)strtol(it->second.c_str(), NULL, 10);
+    return ESP_OK;
+}
+
+static esp_err_t fake_read_string(void *ctx, const char *name, char *out, size_t *len)
+{
+    fake_nvs *nvs = (fake_nvs *)ctx;
+    auto it = nvs->stored.find(name);
+    if (it == nvs->stored.end()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (it->second.size() + 1 > *len) {
+        return ESP_ERR_INVALID_SIZE; // As nvs_get_str() with a short buffer
+    }
+    memcpy(out, it->second.c_str(), it->second.size() + 1);
+    *len = it->second.size() + 1;
+    return ESP_OK;
+}
+
+static esp_err_t fake_write_int(void *ctx, const char *name, int32_t value)
+{
+    fake_nvs *nvs = (fake_nvs *)ctx;
+    nvs->pending[name] = std::to_string(value);
+    nvs->writes++;
+    return ESP_OK;
+}
+
+static esp_err_t fake_write_string(void *ctx, const char *name, const char *value)
+{
+    fake_nvs *nvs = (fake_nvs *)ctx;
+    nvs->pending[name] = value;
+    nvs->writes++;
+    return ESP_OK;
+}
+
+static esp_err_t fake_commit(void *ctx)
+{
+    fake_nvs *nvs = (fake_nvs *)ctx;
+    if (nvs->fail_commit) {
+        return ESP_FAIL;
+    }
+    for (auto &kv : nvs->pending) {
+        nvs->stored[kv.first] = kv.second;
+    }
+    nvs->pending.clear();
+    nvs->commits++;
+    return ESP_OK;
+}
+
+static esp_err_t no_spaces(const char *value)
+{
+    return strchr(value, ' ') ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+enum { ID_PERIOD, ID_OFFSET, ID_NAME, ID_KEY, ID_COUNT };
+
+static const rg_config_def_t s_defs[ID_COUNT] = {
+    RG_CONFIG_INT_DEF("period_ms", 0, 100, 60000, 1000),
+    RG_CONFIG_INT_DEF("offset", 2, -500, 500, 25), // 0.25
+    RG_CONFIG_STRING_DEF("name", 8, "node", 0, no_spaces),
+    RG_CONFIG_STRING_DEF("key", 16, "", RG_CONFIG_SECRET, NULL),
+};
+
+static char s_strings[32];
+
+static void init(rg_config_t *config, fake_nvs *nvs)
+{
+    const rg_config_port_t port = {
+        fake_read_int, fake_read_string, fake_write_int, fake_write_string, fake_commit, nvs,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_init(config, s_defs, ID_COUNT, s_strings, sizeof(s_strings), &port, 2000,
+                                             10000));
+}
+
+static std::string get_string(const rg_config_t *config, int id)
+{
+    char value[64];
+    rg_config_get_string(config, id, value, sizeof(value));
+    return value;
+}
+
+TEST_CASE("rg_config starts from the defaults and loads what is stored", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    TEST_ASSERT_EQUAL_INT32(1000, rg_config_get_int(&config, ID_PERIOD));
+    TEST_ASSERT_EQUAL_INT32(25, rg_config_get_int(&config, ID_OFFSET));
+    std::string name = get_string(&config, ID_NAME);
+    TEST_ASSERT_EQUAL_STRING("node", name.c_str());
+
+    // Out of range, rejected by the validator or too long: the default stays
+    nvs.stored["period_ms"] = "5000";
+    nvs.stored["offset"] = "-9999";
+    nvs.stored["name"] = "a b";
+    nvs.stored["key"] = "0123456789abcdef0";
+    rg_config_load(&config);
+    TEST_ASSERT_EQUAL_INT32(5000, rg_config_get_int(&config, ID_PERIOD));
+    TEST_ASSERT_EQUAL_INT32(25, rg_config_get_int(&config, ID_OFFSET));
+    name = get_string(&config, ID_NAME);
+    TEST_ASSERT_EQUAL_STRING("node", name.c_str());
+    std::string key = get_string(&config, ID_KEY);
+    TEST_ASSERT_EQUAL_STRING("", key.c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, config.stats.load_errors);
+    TEST_ASSERT_EQUAL_UINT32(0, config.dirty);
+
+    nvs.stored["name"] = "lab";
+    rg_config_load(&config);
+    name = get_string(&config, ID_NAME);
+    TEST_ASSERT_EQUAL_STRING("lab", name.c_str());
+
+    // The node's own table fits its defaults
+    static char strings[RG_SETTINGS_SSID_MAX + RG_SETTINGS_PASSWORD_MAX + RG_SETTINGS_RULES_MAX + 3];
+    TEST_ASSERT_EQUAL(sizeof(strings), rg_config_strings_size(rg_settings_defs, RG_SETTING_COUNT));
+    const rg_config_port_t port = {
+        fake_read_int, fake_read_string, fake_write_int, fake_write_string, fake_commit, &nvs,
+    };
+    rg_config_t settings;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_init(&settings, rg_settings_defs, RG_SETTING_COUNT, strings,
+                                             sizeof(strings), &port, 2000, 10000));
+}
+
+TEST_CASE("rg_config parses and checks values", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_set(&config, ID_OFFSET, "-1.5", 0));
+    TEST_ASSERT_EQUAL_INT32(-150, rg_config_get_int(&config, ID_OFFSET));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_set(&config, ID_OFFSET, "2.05", 0));
+    TEST_ASSERT_EQUAL_INT32(205, rg_config_get_int(&config, ID_OFFSET));
+    char text[16];
+    rg_config_format(&config, ID_OFFSET, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("2.05", text);
+    rg_config_set(&config, ID_OFFSET, "-.07", 0);
+    rg_config_format(&config, ID_OFFSET, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("-0.07", text);
+
+    const char *bad[] = {"", "-", ".", "1.234", "5.01", "1e2", "0x10", "1.2.3", "99999999999", " 1"};
+    int accepted = 0;
+    for (const char *value : bad) {
+        if (rg_config_set(&config, ID_OFFSET, value, 0) != ESP_ERR_INVALID_ARG) {
+            printf("accepted \"%s\"\n", value);
+            accepted++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, accepted);
+    TEST_ASSERT_EQUAL_INT32(-7, rg_config_get_int(&config, ID_OFFSET));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_config_set(&config, ID_PERIOD, "99", 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_config_set(&config, ID_PERIOD, "1000.0", 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_config_set_int(&config, ID_PERIOD, 60001, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rg_config_set_int(&config, ID_NAME, 1, 0));
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_set(&config, ID_NAME, "12345678", 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_config_set(&config, ID_NAME, "123456789", 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_config_set(&config, ID_NAME, "two words", 0));
+    std::string name = get_string(&config, ID_NAME);
+    TEST_ASSERT_EQUAL_STRING("12345678", name.c_str());
+    // Truncated copies still report the whole length
+    TEST_ASSERT_EQUAL(8, rg_config_get_string(&config, ID_NAME, text, 4));
+    TEST_ASSERT_EQUAL_STRING("123", text);
+
+    TEST_ASSERT_EQUAL_INT(ID_KEY, rg_config_find(&config, "key"));
+    TEST_ASSERT_EQUAL_INT(-1, rg_config_find(&config, "nope"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rg_config_check(&config, -1, "1"));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rg_config_check(&config, ID_COUNT, "1"));
+}
+
+TEST_CASE("rg_config commits a burst of changes once, after it settles", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, rg_config_flush_due_ms(&config, 0));
+
+    // A slider dragged across its range: 200 updates over 2 s, then a name typed
+    uint32_t now = 1000;
+    for (int i = 0; i < 200; i++, now += 10) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", 100 + i * 50);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_config_set(&config, ID_PERIOD, value, now));
+        TEST_ASSERT_EQUAL_UINT32(2000, rg_config_flush_due_ms(&config, now));
+    }
+    rg_config_set(&config, ID_NAME, "k", now);
+    rg_config_set(&config, ID_NAME, "ki", now);
+    rg_config_set(&config, ID_NAME, "kit", now);
+    TEST_ASSERT_EQUAL_UINT32(203, config.stats.changes);
+    TEST_ASSERT_EQUAL_INT(0, nvs.writes);
+
+    // Due 2 s after the last change; nothing touches flash before
+    TEST_ASSERT_EQUAL_UINT32(1, rg_config_flush_due_ms(&config, now + 1999));
+    TEST_ASSERT_EQUAL_UINT32(0, rg_config_flush_due_ms(&config, now + 2000));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_flush(&config, now + 2000));
+    TEST_ASSERT_EQUAL_INT(1, nvs.commits);
+    TEST_ASSERT_EQUAL_INT(2, nvs.writes);
+    TEST_ASSERT_EQUAL_STRING("10050", nvs.stored["period_ms"].c_str());
+    TEST_ASSERT_EQUAL_STRING("kit", nvs.stored["name"].c_str());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, rg_config_flush_due_ms(&config, now + 2000));
+
+    // Setting the value it already has is not a change
+    rg_config_set(&config, ID_NAME, "kit", now + 3000);
+    rg_config_set_int(&config, ID_PERIOD, 10050, now + 3000);
+    TEST_ASSERT_EQUAL_UINT32(0, config.dirty);
+    TEST_ASSERT_EQUAL_UINT32(203, config.stats.changes);
+
+    // Changes that never pause are still saved max_delay_ms after the first one
+    now = 100000;
+    for (int i = 0; i < 1000; i++, now += 100) {
+        rg_config_set_int(&config, ID_PERIOD, 100 + (i % 2), now);
+        if (rg_config_flush_due_ms(&config, now) == 0) {
+            rg_config_flush(&config, now);
+        }
+    }
+    // 100 s of changes: a commit 10 s into each run of them, the first at i = 100, then every 101 changes
+    TEST_ASSERT_EQUAL_INT(1 + 9, nvs.commits);
+    TEST_ASSERT_EQUAL_INT(2 + 9, nvs.writes);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_flush(&config, now + 2000));
+
+    // Loading back gives the last value
+    rg_config_t reloaded;
+    init(&reloaded, &nvs);
+    rg_config_load(&reloaded);
+    TEST_ASSERT_EQUAL_INT32(101, rg_config_get_int(&reloaded, ID_PERIOD));
+}
+
+TEST_CASE("rg_config keeps a failed commit dirty and retries it", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    rg_config_set(&config, ID_OFFSET, "1", 0);
+
+    nvs.fail_commit = true;
+    TEST_ASSERT_EQUAL(ESP_FAIL, rg_config_flush(&config, 2000));
+    TEST_ASSERT_EQUAL_UINT32(RG_CONFIG_BIT(ID_OFFSET), config.dirty);
+    TEST_ASSERT_EQUAL_UINT32(1, config.stats.errors);
+    TEST_ASSERT_EQUAL_UINT32(2000, rg_config_flush_due_ms(&config, 2000));
+
+    nvs.fail_commit = false;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_flush(&config, 4000));
+    TEST_ASSERT_EQUAL_UINT32(0, config.dirty);
+    TEST_ASSERT_EQUAL_STRING("100", nvs.stored["offset"].c_str());
+}
+
+struct notes {
+    int calls = 0;
+    int last_id = -1;
+    int32_t seen = 0; // The value as the subscriber read it
+    const rg_config_t *config = nullptr;
+};
+
+static void on_change(void *ctx, int id)
+{
+    notes *n = (notes *)ctx;
+    n->calls++;
+    n->last_id = id;
+    n->seen = rg_config_get_int(n->config, ID_PERIOD);
+}
+
+TEST_CASE("rg_config notifies subscribers of their settings' changes only", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    notes period;
+    notes any;
+    period.config = any.config = &config;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_subscribe(&config, RG_CONFIG_BIT(ID_PERIOD), on_change, &period));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_subscribe(&config, UINT32_MAX, on_change, &any));
+
+    rg_config_set(&config, ID_PERIOD, "250", 0);
+    TEST_ASSERT_EQUAL_INT(1, period.calls);
+    TEST_ASSERT_EQUAL_INT32(250, period.seen); // Already visible when notified
+    rg_config_set(&config, ID_PERIOD, "250", 0);
+    rg_config_set(&config, ID_PERIOD, "25", 0);
+    rg_config_set(&config, ID_NAME, "x", 0);
+    TEST_ASSERT_EQUAL_INT(1, period.calls);
+    TEST_ASSERT_EQUAL_INT(2, any.calls);
+    TEST_ASSERT_EQUAL_INT(ID_NAME, any.last_id);
+
+    // Loading is not a change
+    nvs.stored["period_ms"] = "700";
+    rg_config_load(&config);
+    TEST_ASSERT_EQUAL_INT(1, period.calls);
+
+    for (int i = 2; i < RG_CONFIG_MAX_SUBSCRIBERS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, rg_config_subscribe(&config, 0, on_change, &any));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, rg_config_subscribe(&config, 0, on_change, &any));
+}
+
+TEST_CASE("rg_config readers never see a torn string", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    static const char *const values[] = {"aaaaaaaa", "b", "cccc"};
+
+    bool done = false;
+    int torn = 0;
+    int reads = 0;
+    std::thread reader([&] {
+        while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+            std::string value = get_string(&config, ID_NAME);
+            if (value != "node" && value != values[0] && value != values[1] && value != values[2]) {
+                torn++;
+            }
+            reads++;
+        }
+    });
+    for (int i = 0; i < 200000; i++) {
+        rg_config_set(&config, ID_NAME, values[i % 3], (uint32_t)i);
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    reader.join();
+    TEST_ASSERT_EQUAL_INT(0, torn);
+    TEST_ASSERT_TRUE(reads > 0);
+}
+
+TEST_CASE("rg_config writes settings as sorted JSON without secrets", "[rg_config]")
+{
+    fake_nvs nvs;
+    rg_config_t config;
+    init(&config, &nvs);
+    rg_config_set(&config, ID_KEY, "hunter2", 0);
+
+    char buf[256];
+    rg_json_writer json(buf, sizeof(buf));
+    rg_config_write_json(json, config);
+    TEST_ASSERT_TRUE(json.ok());
+    std::string text(json.data(), json.size());
+    TEST_ASSERT_EQUAL_STRING("{\"key\":null,\"name\":\"node\",\"offset\":0.25,\"period_ms\":1000}", text.c_str());
+}
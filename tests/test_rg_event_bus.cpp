@@ -0,0 +1,419 @@
+#include "unity.h"
+#include "services/bus/rg_event_bus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define CAPACITY 16
+
+static rg_event_slot_t s_slots[CAPACITY];
+
+// Every field derives from k, so a torn copy is detectable
+static rg_event_t sample_event(uint32_t k)
+{
+    rg_event_t event = {};
+    event.type = RG_EVENT_SAMPLE;
+    event.time_us = k;
+    event.sample.temperature = (float)k;
+    event.sample.humidity = (float)(k * 2);
+    event.sample.pressure = (float)(k * 3);
+    event.sample.timestamp = k;
+    return event;
+}
+
+static bool event_is_consistent(const rg_event_t &e)
+{
+    const uint32_t k = e.sample.timestamp;
+    return e.type == RG_EVENT_SAMPLE && e.time_us == (int64_t)k && e.sample.temperature == (float)k &&
+           e.sample.humidity == (float)(k * 2) && e.sample.pressure == (float)(k * 3);
+}
+
+static void count_notify(void *ctx)
+{
+    (*(int *)ctx)++;
+}
+
+TEST_CASE("rg_event_bus delivers events in order to each subscriber", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_event_bus_init(&bus, s_slots, 12, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL));
+
+    // Published before anyone listens: nobody gets it
+    rg_event_t event = sample_event(100);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_publish(&bus, &event, 0));
+
+    int notified_a = 0;
+    int notified_b = 0;
+    rg_event_sub_t a = RG_EVENT_SUB_INIT("a", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    rg_event_sub_t b = RG_EVENT_SUB_INIT("b", RG_EVENT_BUS_DROP_OLDEST, 0); // Wants no type
+    a.notify = count_notify;
+    a.notify_ctx = &notified_a;
+    b.notify = count_notify;
+    b.notify_ctx = &notified_b;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &a));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &b));
+
+    rg_event_t out;
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &a, &out));
+    for (uint32_t k = 0; k < 5; k++) {
+        event = sample_event(k);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_publish(&bus, &event, 0));
+    }
+    TEST_ASSERT_EQUAL_INT(5, notified_a);
+    TEST_ASSERT_EQUAL_INT(0, notified_b);
+    TEST_ASSERT_EQUAL_UINT32(5, rg_event_bus_lag(&bus, &a));
+
+    for (uint32_t k = 0; k < 5; k++) {
+        TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &a, &out));
+        TEST_ASSERT_TRUE(event_is_consistent(out));
+        TEST_ASSERT_EQUAL_UINT32(k, out.sample.timestamp);
+        TEST_ASSERT_EQUAL_UINT32(k + 1, out.sequence); // The event before the subscription was 0
+    }
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &a, &out));
+    // b reads past the events it does not want
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &b, &out));
+    TEST_ASSERT_EQUAL_UINT32(0, rg_event_bus_lag(&bus, &b));
+
+    rg_event_sub_stats_t stats;
+    rg_event_bus_sub_stats(&a, &stats);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+}
+
+TEST_CASE("rg_event_bus: a slow drop-oldest subscriber loses only its oldest events", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL));
+    rg_event_sub_t slow = RG_EVENT_SUB_INIT("slow", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    rg_event_sub_t fast = RG_EVENT_SUB_INIT("fast", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &slow));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &fast));
+
+    rg_event_t out;
+    const uint32_t total = CAPACITY * 3 + 5;
+    for (uint32_t k = 0; k < total; k++) {
+        rg_event_t event = sample_event(k);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_publish(&bus, &event, 0));
+        TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &fast, &out));
+        TEST_ASSERT_EQUAL_UINT32(k, out.sample.timestamp);
+    }
+    TEST_ASSERT_EQUAL_UINT32(CAPACITY, rg_event_bus_lag(&bus, &slow));
+
+    // The last ring's worth is still there, in order
+    for (uint32_t k = total - CAPACITY; k < total; k++) {
+        TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &slow, &out));
+        TEST_ASSERT_TRUE(event_is_consistent(out));
+        TEST_ASSERT_EQUAL_UINT32(k, out.sample.timestamp);
+    }
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &slow, &out));
+
+    rg_event_sub_stats_t stats;
+    rg_event_bus_sub_stats(&slow, &stats);
+    TEST_ASSERT_EQUAL_UINT32(CAPACITY, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(total - CAPACITY, stats.dropped);
+    rg_event_bus_sub_stats(&fast, &stats);
+    TEST_ASSERT_EQUAL_UINT32(total, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+}
+
+TEST_CASE("rg_event_bus: a coalescing subscriber gets only the newest event", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL));
+    rg_event_sub_t latest = RG_EVENT_SUB_INIT("latest", RG_EVENT_BUS_COALESCE, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &latest));
+
+    rg_event_t out;
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &latest, &out));
+    for (uint32_t k = 0; k < 3; k++) {
+        rg_event_t event = sample_event(k);
+        rg_event_bus_publish(&bus, &event, 0);
+    }
+    TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &latest, &out));
+    TEST_ASSERT_EQUAL_UINT32(2, out.sample.timestamp);
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &latest, &out));
+
+    // Far more than a ring behind makes no difference
+    for (uint32_t k = 3; k < 3 + CAPACITY * 5; k++) {
+        rg_event_t event = sample_event(k);
+        rg_event_bus_publish(&bus, &event, 0);
+    }
+    TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &latest, &out));
+    TEST_ASSERT_TRUE(event_is_consistent(out));
+    TEST_ASSERT_EQUAL_UINT32(2 + CAPACITY * 5, out.sample.timestamp);
+    TEST_ASSERT_FALSE(rg_event_bus_poll(&bus, &latest, &out));
+
+    rg_event_sub_stats_t stats;
+    rg_event_bus_sub_stats(&latest, &stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(2 + CAPACITY * 5 - 1, stats.skipped);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+}
+
+TEST_CASE("rg_event_bus: a blocking subscriber that does not read times the producer out", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL)); // No wait hook
+    rg_event_sub_t stuck = RG_EVENT_SUB_INIT("stuck", RG_EVENT_BUS_BLOCK, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &stuck));
+
+    for (uint32_t k = 0; k < CAPACITY; k++) {
+        rg_event_t event = sample_event(k);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_publish(&bus, &event, 10));
+    }
+    // Full: the event still goes out, over the oldest one
+    rg_event_t event = sample_event(CAPACITY);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, rg_event_bus_publish(&bus, &event, 10));
+
+    rg_event_t out;
+    TEST_ASSERT_TRUE(rg_event_bus_poll(&bus, &stuck, &out));
+    TEST_ASSERT_EQUAL_UINT32(1, out.sample.timestamp);
+    rg_event_sub_stats_t stats;
+    rg_event_bus_sub_stats(&stuck, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.blocked);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.timeouts);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.dropped);
+
+    // Room again after one read
+    event = sample_event(CAPACITY + 1);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_publish(&bus, &event, 10));
+}
+
+TEST_CASE("rg_event_bus rejects subscribers beyond the table", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL));
+    static rg_event_sub_t subs[RG_EVENT_BUS_MAX_SUBSCRIBERS + 1];
+    for (int i = 0; i < RG_EVENT_BUS_MAX_SUBSCRIBERS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &subs[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, rg_event_bus_subscribe(&bus, &subs[RG_EVENT_BUS_MAX_SUBSCRIBERS]));
+}
+
+// Wait hooks as FreeRTOS would provide them, on a condition variable
+struct space_signal_t {
+    std::mutex lock;
+    std::condition_variable cv;
+    bool given = false;
+};
+
+static bool host_wait_space(void *ctx, uint32_t timeout_ms)
+{
+    space_signal_t *s = (space_signal_t *)ctx;
+    std::unique_lock<std::mutex> lock(s->lock);
+    bool ok = s->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [s] { return s->given; });
+    s->given = false;
+    return ok;
+}
+
+static void host_space_available(void *ctx)
+{
+    space_signal_t *s = (space_signal_t *)ctx;
+    {
+        std::lock_guard<std::mutex> lock(s->lock);
+        s->given = true;
+    }
+    s->cv.notify_one();
+}
+
+// One thread per subscriber, woken like rg_event_bus_task_consume() is
+struct consumer_t {
+    rg_event_sub_t sub;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool pending = false;
+    uint32_t delay_every = 0; // Sleep after every n-th event, to fall behind
+    std::vector<uint32_t> received;
+    std::vector<int64_t> latency_ns;
+    uint32_t torn = 0;
+};
+
+static void consumer_notify(void *ctx)
+{
+    consumer_t *c = (consumer_t *)ctx;
+    {
+        std::lock_guard<std::mutex> lock(c->lock);
+        c->pending = true;
+    }
+    c->cv.notify_one();
+}
+
+static int64_t now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void consume(rg_event_bus_t *bus, consumer_t *c, const std::atomic<bool> *done)
+{
+    rg_event_t event;
+    for (;;) {
+        while (rg_event_bus_poll(bus, &c->sub, &event)) {
+            c->latency_ns.push_back(now_ns() - event.time_us);
+            // time_us carries the publish time here, so check the rest of the payload
+            const uint32_t k = event.sample.timestamp;
+            if (event.sample.temperature != (float)k || event.sample.humidity != (float)(k * 2) ||
+                event.sample.pressure != (float)(k * 3)) {
+                c->torn++;
+            }
+            c->received.push_back(k);
+            if (c->delay_every && c->received.size() % c->delay_every == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        std::unique_lock<std::mutex> lock(c->lock);
+        if (done->load() && !c->pending) {
+            return;
+        }
+        c->cv.wait_for(lock, std::chrono::milliseconds(5), [c] { return c->pending; });
+        c->pending = false;
+    }
+}
+
+static double percentile_us(std::vector<int64_t> v, double p)
+{
+    if (v.empty()) {
+        return 0.0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(v.size() * p))] / 1000.0;
+}
+
+TEST_CASE("rg_event_bus throughput, latency and backpressure with concurrent subscribers", "[rg_event_bus]")
+{
+    constexpr uint32_t kEvents = 100000;
+    static rg_event_slot_t slots[64];
+    static space_signal_t space;
+    const rg_event_bus_port_t port = {host_wait_space, host_space_available, &space};
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, slots, 64, &port));
+
+    // A fast reader, a slow lossy one, a slow coalescing one and a slow one that must see everything
+    static consumer_t consumers[4];
+    const struct {
+        const char *name;
+        rg_event_bus_policy_t policy;
+        uint32_t delay_every;
+    } setup[4] = {
+        {"fast", RG_EVENT_BUS_DROP_OLDEST, 0},
+        {"lossy", RG_EVENT_BUS_DROP_OLDEST, 64},
+        {"latest", RG_EVENT_BUS_COALESCE, 1},
+        {"complete", RG_EVENT_BUS_BLOCK, 256},
+    };
+    for (int i = 0; i < 4; i++) {
+        consumer_t &c = consumers[i];
+        c.sub = RG_EVENT_SUB_INIT(setup[i].name, setup[i].policy, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+        c.sub.notify = consumer_notify;
+        c.sub.notify_ctx = &c;
+        c.delay_every = setup[i].delay_every;
+        c.received.clear();
+        c.received.reserve(kEvents);
+        c.latency_ns.clear();
+        c.latency_ns.reserve(kEvents);
+        c.torn = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &c.sub));
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back(consume, &bus, &consumers[i], &done);
+    }
+
+    uint32_t timeouts = 0;
+    const int64_t start = now_ns();
+    for (uint32_t k = 0; k < kEvents; k++) {
+        rg_event_t event = sample_event(k);
+        event.time_us = now_ns(); // Publish time, for the latency
+        timeouts += rg_event_bus_publish(&bus, &event, 1000) != ESP_OK;
+    }
+    const int64_t publish_ns = now_ns() - start;
+    done.store(true);
+    for (int i = 0; i < 4; i++) {
+        consumer_notify(&consumers[i]);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    printf("rg_event_bus: %u events, %.1f ns per publish with 4 subscribers\n", (unsigned)kEvents,
+           (double)publish_ns / kEvents);
+    rg_event_sub_stats_t stats[4];
+    for (int i = 0; i < 4; i++) {
+        consumer_t &c = consumers[i];
+        rg_event_bus_sub_stats(&c.sub, &stats[i]);
+        printf("rg_event_bus: %-8s delivered %6u dropped %6u skipped %6u blocked %5u, latency p50 %.1f us p99 %.1f us\n",
+               c.sub.name, (unsigned)stats[i].delivered, (unsigned)stats[i].dropped, (unsigned)stats[i].skipped,
+               (unsigned)stats[i].blocked, percentile_us(c.latency_ns, 0.5), percentile_us(c.latency_ns, 0.99));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, timeouts);
+    for (int i = 0; i < 4; i++) {
+        consumer_t &c = consumers[i];
+        TEST_ASSERT_EQUAL_UINT32(0, c.torn);
+        TEST_ASSERT_EQUAL_UINT32(c.received.size(), stats[i].delivered);
+        // Whatever the policy, events arrive in publish order, and the newest always arrives
+        TEST_ASSERT_TRUE(std::is_sorted(c.received.begin(), c.received.end()));
+        TEST_ASSERT_TRUE(std::adjacent_find(c.received.begin(), c.received.end()) == c.received.end());
+        TEST_ASSERT_EQUAL_UINT32(kEvents - 1, c.received.back());
+        // Every event is accounted for
+        TEST_ASSERT_EQUAL_UINT32(kEvents, stats[i].delivered + stats[i].dropped + stats[i].skipped);
+    }
+    // The blocking subscriber held the producer back instead of losing anything
+    TEST_ASSERT_EQUAL_UINT32(kEvents, stats[3].delivered);
+    TEST_ASSERT_GREATER_THAN(0, stats[3].blocked);
+    TEST_ASSERT_EQUAL_UINT32(0, stats[3].timeouts);
+    // Sleeping after every event, the coalescing one only kept up with a fraction
+    TEST_ASSERT_GREATER_THAN(0, stats[2].skipped);
+}
+
+struct capture_t {
+    char text[2048];
+    size_t len;
+};
+
+static esp_err_t capture_sink(void *ctx, const char *data, size_t len)
+{
+    capture_t *capture = (capture_t *)ctx;
+    if (capture->len + len < sizeof(capture->text)) {
+        memcpy(capture->text + capture->len, data, len);
+        capture->len += len;
+        capture->text[capture->len] = '\0';
+    }
+    return ESP_OK;
+}
+
+TEST_CASE("rg_event_bus exports per-subscriber counters and lag", "[rg_event_bus]")
+{
+    rg_event_bus_t bus;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_init(&bus, s_slots, CAPACITY, NULL));
+    rg_event_sub_t log = RG_EVENT_SUB_INIT("log", RG_EVENT_BUS_DROP_OLDEST, RG_EVENT_MASK(RG_EVENT_SAMPLE));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_event_bus_subscribe(&bus, &log));
+    for (uint32_t k = 0; k < CAPACITY + 4; k++) {
+        rg_event_t event = sample_event(k);
+        rg_event_bus_publish(&bus, &event, 0);
+    }
+    rg_event_t out;
+    rg_event_bus_poll(&bus, &log, &out);
+
+    static capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    rg_metrics_writer_t writer = {.sink = capture_sink, .ctx = &capture};
+    rg_event_bus_write_metrics(&bus, &writer);
+    writer.sink(writer.ctx, writer.buf, writer.len); // Flush the tail
+
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_event_bus_published_total 20\n"));
+    TEST_ASSERT_NOT_NULL(
+        strstr(capture.text, "rg_event_bus_events_total{subscriber=\"log\",policy=\"drop_oldest\",outcome=\"delivered\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(
+        strstr(capture.text, "rg_event_bus_events_total{subscriber=\"log\",policy=\"drop_oldest\",outcome=\"dropped\"} 4\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_event_bus_lag{subscriber=\"log\"} 15\n"));
+}
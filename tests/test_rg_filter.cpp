@@ -0,0 +1,282 @@
+#include "unity.h"
+#include "services/filter/rg_filter.h"
+#include "services/filter/rg_filter_chains.h"
+#include "services/sampler/rg_sampler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <type_traits>
+#include <vector>
+
+using namespace rg_filter;
+
+static_assert(!std::is_polymorphic<rg_filter_temperature_t>::value, "chains must not use virtual dispatch");
+
+// Noisy room trace in one channel's fixed-point unit: the true value and what
+// the sensor reported. Deterministic, so the accuracy bounds are exact.
+struct trace_t {
+    std::vector<int32_t> truth;
+    std::vector<int32_t> raw;
+};
+
+static uint32_t s_rng;
+
+static double next_uniform()
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (s_rng >> 8) / 16777216.0;
+}
+
+// Approximately normal with unit variance (sum of 12 uniforms)
+static double next_gaussian()
+{
+    double sum = 0;
+    for (int i = 0; i < 12; i++) {
+        sum += next_uniform();
+    }
+    return sum - 6.0;
+}
+
+// HVAC cycling: a triangle wave of `swing` around `base` every `period`
+// samples, Gaussian sensor noise and single-sample spikes of `spike` when a
+// vent blows on the sensor
+static trace_t make_trace(int samples, double base, double swing, int period, double noise, double spike,
+                          uint32_t seed)
+{
+    trace_t trace;
+    s_rng = seed;
+    for (int i = 0; i < samples; i++) {
+        double phase = (double)(i % period) / period;
+        double wave = phase < 0.5 ? phase * 4 - 1 : 3 - phase * 4;
+        double truth = base + swing * wave;
+        double raw = truth + noise * next_gaussian();
+        if (next_uniform() < 0.02) {
+            raw += next_uniform() < 0.5 ? spike : -spike;
+        }
+        trace.truth.push_back((int32_t)lround(truth));
+        trace.raw.push_back((int32_t)lround(raw));
+    }
+    return trace;
+}
+
+struct error_t {
+    double rms;
+    int32_t max;
+};
+
+// Errors against the truth, after `skip` samples of warm-up
+template <typename Filter>
+static error_t filter_error(Filter &filter, const trace_t &trace, int skip = 10)
+{
+    double sum_sq = 0;
+    int32_t max = 0;
+    int n = 0;
+    for (size_t i = 0; i < trace.raw.size(); i++) {
+        int32_t err = filter(trace.raw[i]) - trace.truth[i];
+        if ((int)i >= skip) {
+            sum_sq += (double)err * err;
+            max = err > max ? err : (-err > max ? -err : max);
+            n++;
+        }
+    }
+    error_t e = {sqrt(sum_sq / n), max};
+    return e;
+}
+
+TEST_CASE("rg_filter median removes a single-sample spike", "[rg_filter]")
+{
+    median<3> m;
+    TEST_ASSERT_EQUAL_INT32(100, m(100)); // Window not full: median of what is there
+    TEST_ASSERT_EQUAL_INT32(102, m(102));
+    TEST_ASSERT_EQUAL_INT32(102, m(5000));
+    TEST_ASSERT_EQUAL_INT32(104, m(104));
+    TEST_ASSERT_EQUAL_INT32(106, m(106));
+    m.reset();
+    TEST_ASSERT_EQUAL_INT32(-7, m(-7));
+}
+
+TEST_CASE("rg_filter outlier rejection holds spikes but follows real steps", "[rg_filter]")
+{
+    outlier<50, 3> o;
+    TEST_ASSERT_EQUAL_INT32(2000, o(2000));
+    TEST_ASSERT_EQUAL_INT32(2000, o(2600)); // Spike
+    TEST_ASSERT_EQUAL_INT32(2010, o(2010));
+    // A step that persists is accepted on the third sample
+    TEST_ASSERT_EQUAL_INT32(2010, o(2500));
+    TEST_ASSERT_EQUAL_INT32(2010, o(2505));
+    TEST_ASSERT_EQUAL_INT32(2502, o(2502));
+    TEST_ASSERT_EQUAL_INT32(2520, o(2520));
+}
+
+TEST_CASE("rg_filter EMA and Kalman settle on a constant without rounding bias", "[rg_filter]")
+{
+    ema<3> e;
+    kalman<1, 12> k;
+    e(0);
+    k(0);
+    int32_t ye = 0, yk = 0;
+    for (int i = 0; i < 200; i++) {
+        ye = e(-2157);
+        yk = k(-2157);
+    }
+    TEST_ASSERT_EQUAL_INT32(-2157, ye);
+    TEST_ASSERT_EQUAL_INT32(-2157, yk);
+
+    // Pressure-sized values stay in range
+    kalman<1, 12> p;
+    int32_t y = 0;
+    for (int i = 0; i < 50; i++) {
+        y = p(110000);
+    }
+    TEST_ASSERT_EQUAL_INT32(110000, y);
+}
+
+TEST_CASE("rg_filter chains run their stages in order", "[rg_filter]")
+{
+    chain<outlier<50>, median<3>, ema<1>> c;
+    TEST_ASSERT_EQUAL_INT32(1000, c(1000));
+    // The outlier stage holds 5000 before the median and EMA see it
+    TEST_ASSERT_EQUAL_INT32(1000, c(5000));
+    TEST_ASSERT_EQUAL_INT32(1000, c(1020)); // Median of 1000, 1000, 1020
+    TEST_ASSERT_EQUAL_INT32(1010, c(1040)); // Halfway from 1000 to the median 1020
+    c.reset();
+    TEST_ASSERT_EQUAL_INT32(3000, c(3000));
+
+    chain<pass, optional<false, median<5>>> nothing;
+    TEST_ASSERT_EQUAL_INT32(1234, nothing(1234));
+    TEST_ASSERT_TRUE(sizeof(nothing) < sizeof(median<5>));
+}
+
+TEST_CASE("rg_filter default chains cut noise and spikes on room traces", "[rg_filter]")
+{
+    // Temperature in 0.01 degC: 22 degC, +-0.5 degC HVAC cycle over 300 samples,
+    // 0.03 degC noise, 2 degC vent spikes
+    trace_t t = make_trace(3000, 2200, 50, 300, 3, 200, 1);
+    rg_filter_temperature_t tf;
+    pass none;
+    error_t t_raw = filter_error(none, t);
+    error_t t_filtered = filter_error(tf, t);
+    printf("rg_filter: temperature RMS error %.2f -> %.2f, max %ld -> %ld (0.01 degC)\n", t_raw.rms,
+           t_filtered.rms, (long)t_raw.max, (long)t_filtered.max);
+    TEST_ASSERT_TRUE(t_filtered.rms < t_raw.rms / 3);
+    TEST_ASSERT_TRUE(t_filtered.max < 15); // No spike gets through
+
+    // Humidity in 0.01 %RH: 45 %RH +-3 %RH, 0.1 %RH noise, 8 %RH spikes
+    trace_t h = make_trace(3000, 4500, 300, 300, 10, 800, 2);
+    rg_filter_humidity_t hf;
+    error_t h_raw = filter_error(none, h);
+    error_t h_filtered = filter_error(hf, h);
+    printf("rg_filter: humidity RMS error %.2f -> %.2f, max %ld -> %ld (0.01 %%RH)\n", h_raw.rms, h_filtered.rms,
+           (long)h_raw.max, (long)h_filtered.max);
+    TEST_ASSERT_TRUE(h_filtered.rms < h_raw.rms / 2);
+    TEST_ASSERT_TRUE(h_filtered.max < 60);
+
+    // Pressure in Pa: 1013.25 hPa drifting 20 Pa over 3000 samples, 3 Pa noise, 200 Pa door slams
+    trace_t p = make_trace(3000, 101325, 10, 3000, 3, 200, 3);
+    rg_filter_pressure_t pf;
+    error_t p_raw = filter_error(none, p);
+    error_t p_filtered = filter_error(pf, p, 50);
+    printf("rg_filter: pressure RMS error %.2f -> %.2f, max %ld -> %ld (Pa)\n", p_raw.rms, p_filtered.rms,
+           (long)p_raw.max, (long)p_filtered.max);
+    TEST_ASSERT_TRUE(p_filtered.rms < p_raw.rms / 3);
+    TEST_ASSERT_TRUE(p_filtered.max < 10);
+}
+
+// Steady 22.00 degC, then a step to @p step_to, through the default temperature
+// chain and the sampler as the sensor task wires them. @p first_after gets the
+// number of samples after the step until the first publish, @p settled_after
+// the number until the published value is within the deadband of the new level.
+static void step_response(int32_t step_to, bool split, int *first_after, int *settled_after)
+{
+    rg_sampler_config_t config = {};
+    config.deadband[RG_SAMPLER_TEMPERATURE] = 0.1f;
+    config.deadband[RG_SAMPLER_HUMIDITY] = 0.5f;
+    config.deadband[RG_SAMPLER_PRESSURE] = 0.2f;
+    config.min_interval_ms = 2000;
+    config.max_interval_ms = 10000;
+    static rg_sampler_t sampler;
+    rg_sampler_init(&sampler, &config);
+    rg_filter_temperature_guard_t guard;
+    rg_filter_temperature_smoother_t smoother;
+    rg_filter_temperature_t chain;
+
+    uint32_t now_ms = 0;
+    *first_after = -1;
+    *settled_after = -1;
+    float published = 0;
+    for (int i = -20; i < 40; i++) {
+        const int32_t raw = i < 0 ? 2200 : step_to;
+        uint32_t result;
+        if (split) {
+            const int32_t guarded = guard(raw);
+            const float values[RG_SAMPLER_CHANNEL_COUNT] = {guarded / 100.0f, 45.0f, 1013.0f};
+            const float smoothed[RG_SAMPLER_CHANNEL_COUNT] = {smoother(guarded) / 100.0f, 45.0f, 1013.0f};
+            result = rg_sampler_update_smoothed(&sampler, now_ms, values, smoothed);
+            if (result) {
+                published = smoothed[RG_SAMPLER_TEMPERATURE];
+            }
+        } else {
+            const float values[RG_SAMPLER_CHANNEL_COUNT] = {chain(raw) / 100.0f, 45.0f, 1013.0f};
+            result = rg_sampler_update(&sampler, now_ms, values);
+            if (result) {
+                published = values[RG_SAMPLER_TEMPERATURE];
+            }
+        }
+        if (i < 0) {
+            // The quiet channel has backed off to the slowest interval
+            TEST_ASSERT_TRUE(i == -20 || !(result & RG_SAMPLER_CHANGED(RG_SAMPLER_TEMPERATURE)));
+        } else {
+            if (*first_after < 0 && result) {
+                *first_after = i;
+                // The step is seen, so the next samples come at the fastest interval
+                TEST_ASSERT_EQUAL_UINT32(config.min_interval_ms, rg_sampler_next_interval_ms(&sampler));
+            }
+            if (*settled_after < 0 && fabsf(published - step_to / 100.0f) < config.deadband[RG_SAMPLER_TEMPERATURE]) {
+                *settled_after = i;
+            }
+        }
+        now_ms += rg_sampler_next_interval_ms(&sampler);
+    }
+}
+
+TEST_CASE("rg_filter smoothing does not delay the sampler's reaction to a step", "[rg_filter][rg_sampler]")
+{
+    int first, settled;
+    // Half a degree: the first sample after the step is published and the
+    // smoothed value is published again until it has caught up
+    step_response(2250, true, &first, &settled);
+    printf("rg_filter: 0.5 degC step published at once, settled after %d samples\n", settled);
+    TEST_ASSERT_EQUAL_INT(0, first);
+    TEST_ASSERT_TRUE(settled > 0 && settled <= 8);
+
+    // Two degrees is beyond the outlier step: it passes once three samples agree
+    step_response(2400, true, &first, &settled);
+    printf("rg_filter: 2 degC step published after %d samples, settled after %d\n", first, settled);
+    TEST_ASSERT_EQUAL_INT(2, first);
+    TEST_ASSERT_TRUE(settled > 2 && settled <= 16);
+
+    // Change detection on the smoothed values sees the step late
+    step_response(2250, false, &first, &settled);
+    TEST_ASSERT_TRUE(first > 0);
+}
+
+TEST_CASE("rg_filter cost per sample", "[rg_filter][bench]")
+{
+    trace_t t = make_trace(4096, 2200, 50, 300, 3, 200, 4);
+    rg_filter_temperature_t tf;
+    const int rounds = 250;
+    volatile int32_t sink = 0;
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) {
+        for (int32_t x : t.raw) {
+            sink = tf(x);
+        }
+    }
+    double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / (rounds * t.raw.size());
+    printf("rg_filter: %.1f ns per sample, %u/%u/%u bytes per temperature/humidity/pressure chain\n", ns,
+           (unsigned)sizeof(rg_filter_temperature_t), (unsigned)sizeof(rg_filter_humidity_t),
+           (unsigned)sizeof(rg_filter_pressure_t));
+    (void)sink;
+}
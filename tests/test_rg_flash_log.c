@@ -0,0 +1,238 @@
+#include "unity.h"
+#include "services/flash_log/rg_flash_log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// NOR flash emulator: programming can only clear bits, erase sets a sector to 0xFF.
+#define EMU_SECTOR_SIZE 4096
+#define EMU_SECTORS 26 // Same geometry as the rglog partition
+
+typedef struct {
+    uint8_t mem[EMU_SECTOR_SIZE * EMU_SECTORS];
+    uint32_t read_bytes;
+    uint32_t erases;
+} flash_emu_t;
+
+static flash_emu_t s_emu;
+
+static esp_err_t emu_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    flash_emu_t *emu = (flash_emu_t *)ctx;
+    if (offset + len > sizeof(emu->mem)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, emu->mem + offset, len);
+    emu->read_bytes += len;
+    return ESP_OK;
+}
+
+static esp_err_t emu_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    flash_emu_t *emu = (flash_emu_t *)ctx;
+    if (offset + len > sizeof(emu->mem)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const uint8_t *p = (const uint8_t *)src;
+    for (size_t i = 0; i < len; i++) {
+        emu->mem[offset + i] &= p[i];
+    }
+    return ESP_OK;
+}
+
+static esp_err_t emu_erase_sector(void *ctx, size_t offset)
+{
+    flash_emu_t *emu = (flash_emu_t *)ctx;
+    memset(emu->mem + offset, 0xFF, EMU_SECTOR_SIZE);
+    emu->erases++;
+    return ESP_OK;
+}
+
+static rg_flash_log_io_t emu_io(void)
+{
+    rg_flash_log_io_t io = {
+        .read = emu_read,
+        .write = emu_write,
+        .erase_sector = emu_erase_sector,
+        .ctx = &s_emu,
+        .size = sizeof(s_emu.mem),
+        .sector_size = EMU_SECTOR_SIZE,
+    };
+    return io;
+}
+
+static void emu_blank(void)
+{
+    memset(&s_emu, 0, sizeof(s_emu));
+    memset(s_emu.mem, 0xFF, sizeof(s_emu.mem));
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t first_ts;
+    uint32_t last_ts;
+    bool ordered;
+    bool values_match;
+} replay_check_t;
+
+static rg_flash_log_record_t make_record(uint32_t i)
+{
+    rg_flash_log_record_t r = {
+        .timestamp = i * 10,
+        .temperature = (int16_t)(2000 + (i % 500) - 250),
+        .humidity = (uint16_t)(4000 + i % 1000),
+        .pressure = (uint16_t)(10130 + i % 50),
+    };
+    return r;
+}
+
+static void check_replay(const rg_flash_log_record_t *record, void *ctx)
+{
+    replay_check_t *check = (replay_check_t *)ctx;
+    if (check->count == 0) {
+        check->first_ts = record->timestamp;
+    } else if (record->timestamp <= check->last_ts) {
+        check->ordered = false;
+    }
+    rg_flash_log_record_t expected = make_record(record->timestamp / 10);
+    if (memcmp(&expected, record, sizeof(expected)) != 0) {
+        check->values_match = false;
+    }
+    check->last_ts = record->timestamp;
+    check->count++;
+}
+
+static rg_flash_log_t s_log;
+
+TEST_CASE("rg_flash_log replays appended records after a remount", "[rg_flash_log]")
+{
+    emu_blank();
+    rg_flash_log_io_t io = emu_io();
+    TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_mount(&s_log, &io, NULL, NULL));
+
+    for (uint32_t i = 0; i < 100; i++) {
+        rg_flash_log_record_t r = make_record(i);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_append(&s_log, &r));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_flush(&s_log));
+
+    replay_check_t check = {.ordered = true, .values_match = true};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_mount(&s_log, &io, check_replay, &check));
+    TEST_ASSERT_EQUAL(100, check.count);
+    TEST_ASSERT_EQUAL(0, check.first_ts);
+    TEST_ASSERT_EQUAL(990, check.last_ts);
+    TEST_ASSERT_TRUE(check.ordered);
+    TEST_ASSERT_TRUE(check.values_match);
+
+    // Appending after the remount continues where the log left off
+    rg_flash_log_record_t r = make_record(100);
+    rg_flash_log_append(&s_log, &r);
+    rg_flash_log_flush(&s_log);
+    memset(&check, 0, sizeof(check));
+    check.ordered = check.values_match = true;
+    rg_flash_log_mount(&s_log, &io, check_replay, &check);
+    TEST_ASSERT_EQUAL(101, check.count);
+    TEST_ASSERT_TRUE(check.ordered);
+}
+
+TEST_CASE("rg_flash_log wraps around and keeps the newest records", "[rg_flash_log]")
+{
+    emu_blank();
+    rg_flash_log_io_t io = emu_io();
+    rg_flash_log_mount(&s_log, &io, NULL, NULL);
+    const uint32_t capacity = rg_flash_log_capacity(&s_log);
+    const uint32_t total = capacity * 2 + 7;
+
+    for (uint32_t i = 0; i < total; i++) {
+        rg_flash_log_record_t r = make_record(i);
+        TEST_ASSERT_EQUAL(ESP_OK, rg_flash_log_append(&s_log, &r));
+    }
+    rg_flash_log_flush(&s_log);
+
+    replay_check_t check = {.ordered = true, .values_match = true};
+    rg_flash_log_mount(&s_log, &io, check_replay, &check);
+    TEST_ASSERT_GREATER_OR_EQUAL(capacity, check.count);
+    TEST_ASSERT_EQUAL((total - 1) * 10, check.last_ts);
+    TEST_ASSERT_EQUAL((total - check.count) * 10, check.first_ts);
+    TEST_ASSERT_TRUE(check.ordered);
+    TEST_ASSERT_TRUE(check.values_match);
+}
+
+TEST_CASE("rg_flash_log skips a torn record and keeps appending after it", "[rg_flash_log]")
+{
+    emu_blank();
+    rg_flash_log_io_t io = emu_io();
+    rg_flash_log_mount(&s_log, &io, NULL, NULL);
+    for (uint32_t i = 0; i < 10; i++) {
+        rg_flash_log_record_t r = make_record(i);
+        rg_flash_log_append(&s_log, &r);
+    }
+    rg_flash_log_flush(&s_log);
+
+    // Simulate power loss half way through programming the next record
+    const size_t torn = RG_FLASH_LOG_HEADER_SIZE + 10 * RG_FLASH_LOG_RECORD_SIZE;
+    s_emu.mem[torn] = 0x00;
+    s_emu.mem[torn + 1] = 0x12;
+
+    replay_check_t check = {.ordered = true, .values_match = true};
+    rg_flash_log_mount(&s_log, &io, check_replay, &check);
+    TEST_ASSERT_EQUAL(10, check.count);
+    TEST_ASSERT_EQUAL(1, s_log.stats.records_corrupt);
+
+    rg_flash_log_record_t r = make_record(11);
+    rg_flash_log_append(&s_log, &r);
+    rg_flash_log_flush(&s_log);
+    memset(&check, 0, sizeof(check));
+    check.ordered = check.values_match = true;
+    rg_flash_log_mount(&s_log, &io, check_replay, &check);
+    TEST_ASSERT_EQUAL(11, check.count);
+    TEST_ASSERT_EQUAL(110, check.last_ts);
+}
+
+TEST_CASE("rg_flash_log write amplification and replay cost", "[rg_flash_log][bench]")
+{
+    emu_blank();
+    rg_flash_log_io_t io = emu_io();
+    rg_flash_log_mount(&s_log, &io, NULL, NULL);
+    const uint32_t total = rg_flash_log_capacity(&s_log) * 3;
+
+    // Page-batched, as done by the writer task while samples keep arriving
+    for (uint32_t i = 0; i < total; i++) {
+        rg_flash_log_record_t r = make_record(i);
+        rg_flash_log_append(&s_log, &r);
+    }
+    rg_flash_log_flush(&s_log);
+    rg_flash_log_stats_t batched = s_log.stats;
+
+    // Worst case: a flush after every record (samples slower than the flush interval)
+    emu_blank();
+    rg_flash_log_mount(&s_log, &io, NULL, NULL);
+    for (uint32_t i = 0; i < total; i++) {
+        rg_flash_log_record_t r = make_record(i);
+        rg_flash_log_append(&s_log, &r);
+        rg_flash_log_flush(&s_log);
+    }
+    rg_flash_log_stats_t unbatched = s_log.stats;
+
+    printf("rg_flash_log: %lu records, capacity %lu\n", (unsigned long)total,
+           (unsigned long)rg_flash_log_capacity(&s_log));
+    printf("rg_flash_log: batched   WA %.3f, %lu program ops, %.1f records/erase\n",
+           (double)batched.bytes_programmed / (batched.records_written * RG_FLASH_LOG_RECORD_SIZE),
+           (unsigned long)batched.program_ops, (double)batched.records_written / batched.sector_erases);
+    printf("rg_flash_log: unbatched WA %.3f, %lu program ops, %.1f records/erase\n",
+           (double)unbatched.bytes_programmed / (unbatched.records_written * RG_FLASH_LOG_RECORD_SIZE),
+           (unsigned long)unbatched.program_ops, (double)unbatched.records_written / unbatched.sector_erases);
+    TEST_ASSERT_LESS_THAN(unbatched.program_ops / 10, batched.program_ops);
+    TEST_ASSERT_EQUAL(batched.sector_erases, unbatched.sector_erases);
+
+    // Replay of a full partition
+    s_emu.read_bytes = 0;
+    replay_check_t check = {.ordered = true, .values_match = true};
+    clock_t start = clock();
+    rg_flash_log_mount(&s_log, &io, check_replay, &check);
+    double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC;
+    printf("rg_flash_log: replayed %lu records, %lu bytes read, %.0f us\n", (unsigned long)check.count,
+           (unsigned long)s_emu.read_bytes, us);
+    TEST_ASSERT_TRUE(check.ordered);
+}
@@ -0,0 +1,91 @@
+#include "unity.h"
+#include "services/history/rg_history.h"
+
+#include <sdkconfig.h>
+
+#include <vector>
+
+static bool collect(const rg_history_record_t *record, void *ctx)
+{
+    static_cast<std::vector<rg_history_record_t> *>(ctx)->push_back(*record);
+    return true;
+}
+
+static std::vector<rg_history_record_t> query(rg_history_tier_t tier, uint32_t from = 0, uint32_t to = UINT32_MAX)
+{
+    std::vector<rg_history_record_t> out;
+    rg_history_query(tier, from, to, collect, &out);
+    return out;
+}
+
+TEST_CASE("rg_history stores raw samples in fixed point", "[rg_history]")
+{
+    rg_history_reset();
+    rg_history_add(10, 21.456f, 45.5f, 1013.25f);
+    rg_history_add(20, -3.5f, 120.0f, 990.04f);
+
+    std::vector<rg_history_record_t> raw = query(RG_HISTORY_TIER_RAW);
+    TEST_ASSERT_EQUAL(2, raw.size());
+    TEST_ASSERT_EQUAL(10, raw[0].timestamp);
+    TEST_ASSERT_EQUAL(2146, raw[0].temperature[RG_HISTORY_MEAN]);
+    TEST_ASSERT_EQUAL(4550, raw[0].humidity[RG_HISTORY_MEAN]);
+    TEST_ASSERT_EQUAL(10133, raw[0].pressure[RG_HISTORY_MEAN]);
+    TEST_ASSERT_EQUAL(-350, raw[1].temperature[RG_HISTORY_MIN]);
+    TEST_ASSERT_EQUAL(10000, raw[1].humidity[RG_HISTORY_MAX]); // Clamped to 100 %RH
+}
+
+TEST_CASE("rg_history rolls samples up into minute and hour tiers", "[rg_history]")
+{
+    rg_history_reset();
+    // Two hours of 10 s samples; temperature ramps 0.01 degC per sample
+    for (uint32_t i = 0; i < 720; i++) {
+        rg_history_add(i * 10, 20.0f + i * 0.01f, 50.0f, 1000.0f);
+    }
+
+    // The bucket still being accumulated is not visible yet
+    std::vector<rg_history_record_t> minute = query(RG_HISTORY_TIER_MINUTE);
+    TEST_ASSERT_EQUAL(119, minute.size());
+    TEST_ASSERT_EQUAL(60, minute[1].timestamp);
+    TEST_ASSERT_EQUAL(6, minute[1].count);
+    TEST_ASSERT_EQUAL(2006, minute[1].temperature[RG_HISTORY_MIN]);
+    TEST_ASSERT_EQUAL(2011, minute[1].temperature[RG_HISTORY_MAX]);
+    TEST_ASSERT_EQUAL(2009, minute[1].temperature[RG_HISTORY_MEAN]); // 20.085 rounds half up
+
+    std::vector<rg_history_record_t> hour = query(RG_HISTORY_TIER_HOUR);
+    TEST_ASSERT_EQUAL(1, hour.size());
+    TEST_ASSERT_EQUAL(0, hour[0].timestamp);
+    TEST_ASSERT_EQUAL(360, hour[0].count);
+    TEST_ASSERT_EQUAL(2000, hour[0].temperature[RG_HISTORY_MIN]);
+    TEST_ASSERT_EQUAL(2359, hour[0].temperature[RG_HISTORY_MAX]);
+    TEST_ASSERT_EQUAL(5000, hour[0].humidity[RG_HISTORY_MEAN]);
+
+    // from/to select by timestamp, inclusive
+    TEST_ASSERT_EQUAL(3, query(RG_HISTORY_TIER_MINUTE, 120, 240).size());
+}
+
+TEST_CASE("rg_history keeps only the newest records once a tier wraps", "[rg_history]")
+{
+    rg_history_reset();
+    const size_t capacity = rg_history_capacity(RG_HISTORY_TIER_RAW);
+    for (uint32_t i = 0; i < capacity + 5; i++) {
+        rg_history_add(i, 20.0f, 50.0f, 1000.0f);
+    }
+
+    std::vector<rg_history_record_t> raw = query(RG_HISTORY_TIER_RAW);
+    TEST_ASSERT_EQUAL(capacity, raw.size());
+    TEST_ASSERT_EQUAL(5, raw.front().timestamp);
+    TEST_ASSERT_EQUAL(capacity + 4, raw.back().timestamp);
+}
+
+TEST_CASE("rg_history tiers fit the configured RAM budget", "[rg_history]")
+{
+    const size_t bytes = rg_history_capacity(RG_HISTORY_TIER_RAW) * 12 +
+                         (rg_history_capacity(RG_HISTORY_TIER_MINUTE) + rg_history_capacity(RG_HISTORY_TIER_HOUR)) * 24;
+    printf("rg_history: raw=%u minute=%u hour=%u records, %u of %u bytes\n",
+           (unsigned)rg_history_capacity(RG_HISTORY_TIER_RAW), (unsigned)rg_history_capacity(RG_HISTORY_TIER_MINUTE),
+           (unsigned)rg_history_capacity(RG_HISTORY_TIER_HOUR), (unsigned)bytes,
+           (unsigned)(CONFIG_RG_HISTORY_RAM_BUDGET_KB * 1024));
+    TEST_ASSERT_LESS_OR_EQUAL(CONFIG_RG_HISTORY_RAM_BUDGET_KB * 1024, bytes);
+    // A full day must fit in the hour tier so dashboards get it in one request
+    TEST_ASSERT_GREATER_OR_EQUAL(24, rg_history_capacity(RG_HISTORY_TIER_HOUR));
+}
@@ -0,0 +1,252 @@
+#include "unity.h"
+#include "services/http/rg_http_query.h"
+#include "services/http/rg_http_router.h"
+
+#include <string.h>
+#include <string>
+
+#if __has_include("rg_httpd_host.h")
+#include "rg_httpd_host.h"
+#include "services/rg_http_server.h"
+#define HAVE_HTTPD_HOST 1
+#endif
+
+static int s_called;
+
+static esp_err_t handler_a(httpd_req_t *req, const rg_http_query_t *query)
+{
+    s_called = 1;
+    return ESP_OK;
+}
+
+static esp_err_t handler_b(httpd_req_t *req, const rg_http_query_t *query)
+{
+    s_called = 2;
+    return ESP_OK;
+}
+
+static constexpr rg_http_route_t s_test_routes[] = {
+    {"/", RG_HTTP_GET, handler_a, nullptr},
+    {"/data", RG_HTTP_GET, handler_b, nullptr},
+    {"/dat", RG_HTTP_GET, handler_a, nullptr},
+    {"/history", RG_HTTP_GET, handler_b, nullptr},
+    {"/settings/", RG_HTTP_GET | RG_HTTP_POST, handler_a, nullptr},
+    {"/metrics", RG_HTTP_GET, handler_b, nullptr},
+};
+static constexpr rg_http_router<6> s_test_router(s_test_routes);
+static_assert(s_test_router.ok(), "test routes must be placed");
+
+TEST_CASE("rg_http_router finds every route and nothing else", "[rg_http_router]")
+{
+    for (size_t i = 0; i < s_test_router.size(); i++) {
+        TEST_ASSERT_TRUE(s_test_router.find(s_test_routes[i].path) == &s_test_routes[i]);
+    }
+    TEST_ASSERT_TRUE(s_test_router.find("/data?x=1") == &s_test_routes[1]);
+    TEST_ASSERT_TRUE(s_test_router.find("/?") == &s_test_routes[0]);
+    TEST_ASSERT_NULL(s_test_router.find("/da"));
+    TEST_ASSERT_NULL(s_test_router.find("/data/"));
+    TEST_ASSERT_NULL(s_test_router.find("/datas"));
+    TEST_ASSERT_NULL(s_test_router.find("/settings"));
+    TEST_ASSERT_NULL(s_test_router.find(""));
+    TEST_ASSERT_NULL(s_test_router.find("/missing?/data"));
+}
+
+TEST_CASE("rg_http_router lists allowed methods for a 405", "[rg_http_router]")
+{
+    char allow[32];
+    rg_http::allow_header(RG_HTTP_GET | RG_HTTP_POST, allow, sizeof(allow));
+    TEST_ASSERT_EQUAL_STRING("GET, POST", allow);
+    rg_http::allow_header(RG_HTTP_POST, allow, sizeof(allow));
+    TEST_ASSERT_EQUAL_STRING("POST", allow);
+}
+
+TEST_CASE("rg_http_query decodes parameters in place", "[rg_http_router]")
+{
+    rg_http_query_t query;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_parse(&query, "/x?tier=raw&name=Living+room%21&&flag&from=12"));
+    TEST_ASSERT_EQUAL_INT(4, query.count);
+    TEST_ASSERT_EQUAL_STRING("raw", rg_http_query_get(&query, "tier"));
+    TEST_ASSERT_EQUAL_STRING("Living room!", rg_http_query_get(&query, "name"));
+    TEST_ASSERT_EQUAL_STRING("", rg_http_query_get(&query, "flag"));
+    TEST_ASSERT_NULL(rg_http_query_get(&query, "missing"));
+
+    uint32_t v = 7;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_get_u32(&query, "from", &v));
+    TEST_ASSERT_EQUAL_UINT32(12, v);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rg_http_query_get_u32(&query, "to", &v));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_query_get_u32(&query, "tier", &v));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_query_get_u32(&query, "flag", &v));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_parse(&query, "/x?n=4294967295&m=4294967296"));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_get_u32(&query, "n", &v));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, v);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_query_get_u32(&query, "m", &v));
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_parse(&query, "/x"));
+    TEST_ASSERT_EQUAL_INT(0, query.count);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_query_parse(&query, "/x?"));
+    TEST_ASSERT_EQUAL_INT(0, query.count);
+}
+
+TEST_CASE("rg_http_query rejects bad escapes and oversized queries", "[rg_http_router]")
+{
+    rg_http_query_t query;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_query_parse(&query, "/x?a=%2"));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_query_parse(&query, "/x?a=%zz&b=1"));
+    TEST_ASSERT_EQUAL_INT(0, query.count);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rg_http_query_parse(&query, "/x?a&b&c&d&e&f&g&h&i"));
+    TEST_ASSERT_EQUAL_INT(0, query.count);
+
+    char uri[RG_HTTP_QUERY_MAX_LEN + 8] = "/x?a=";
+    memset(uri + 5, 'x', RG_HTTP_QUERY_MAX_LEN);
+    uri[sizeof(uri) - 1] = '\0';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rg_http_query_parse(&query, uri));
+}
+
+struct form_fields {
+    int count = 0;
+    char text[128] = "";
+};
+
+static esp_err_t collect_field(void *ctx, const char *key, const char *value)
+{
+    form_fields *fields = (form_fields *)ctx;
+    size_t len = strlen(fields->text);
+    snprintf(fields->text + len, sizeof(fields->text) - len, "[%s=%s]", key, value);
+    return ++fields->count == 3 ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+TEST_CASE("rg_http_form_parse decodes a form body in place", "[rg_http_router]")
+{
+    char body[] = "wifi_ssid=Caf%C3%A9+Wi-Fi&&rules=a%3A+temperature+%3E+30";
+    form_fields fields;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_http_form_parse(body, collect_field, &fields));
+    TEST_ASSERT_EQUAL_INT(2, fields.count);
+    TEST_ASSERT_EQUAL_STRING("[wifi_ssid=Caf\xc3\xa9 Wi-Fi][rules=a: temperature > 30]", fields.text);
+
+    // The callback's error stops the parse; a bad escape fails it
+    char three[] = "a=1&b&c=3&d=4";
+    form_fields stopped;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rg_http_form_parse(three, collect_field, &stopped));
+    TEST_ASSERT_EQUAL_STRING("[a=1][b=][c=3]", stopped.text);
+    char bad[] = "a=%G1";
+    form_fields none;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_http_form_parse(bad, collect_field, &none));
+    TEST_ASSERT_EQUAL_INT(0, none.count);
+}
+
+#if HAVE_HTTPD_HOST
+TEST_CASE("rg_http_handle_request answers unknown paths, wrong methods and bad queries", "[rg_http_router]")
+{
+    int fd = rg_httpd_host_open();
+    rg_httpd_host_response_t resp;
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_httpd_host_get(fd, "/nowhere", NULL, rg_http_handle_request, &resp));
+    TEST_ASSERT_EQUAL_INT(404, resp.status);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_httpd_host_request(fd, HTTP_POST, "/data", NULL, rg_http_handle_request, &resp));
+    TEST_ASSERT_EQUAL_INT(405, resp.status);
+    TEST_ASSERT_NOT_NULL(strstr(resp.headers, "Allow: GET\r\n"));
+
+    rg_httpd_host_get(fd, "/history?tier=raw&from=yesterday", NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+    rg_httpd_host_get(fd, "/history?tier=weekly", NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_httpd_host_get(fd, "/data?%", NULL, rg_http_handle_request, &resp));
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+
+    rg_httpd_host_get(fd, "/history?tier=hour&from=0&to=4294967295", NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(200, resp.status);
+    TEST_ASSERT_EQUAL_MEMORY("{\"tier\":\"hour\"", resp.body, 14);
+    rg_httpd_host_get(fd, "/data", NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(200, resp.status);
+    rg_httpd_host_close(fd);
+}
+
+TEST_CASE("rg_http_handle_request starts updates only for the token and a trusted source", "[rg_http_router]")
+{
+    int fd = rg_httpd_host_open();
+    rg_httpd_host_response_t resp;
+    const char *uri = "/ota?url=https%3A%2F%2Fupdates.example%2Frg2.bin";
+
+    rg_httpd_host_request(fd, HTTP_POST, uri, NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(403, resp.status);
+    rg_httpd_host_request(fd, HTTP_POST, uri, "Authorization: Bearer host-ota-tokeN\r\n", rg_http_handle_request,
+                          &resp);
+    TEST_ASSERT_EQUAL_INT(403, resp.status);
+    // The token goes in the header; one in the query string does not count
+    rg_httpd_host_request(fd, HTTP_POST, "/ota?url=https%3A%2F%2Fupdates.example%2Frg2.bin&token=host-ota-token",
+                          NULL, rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(403, resp.status);
+
+    // Unsigned images only over https from the pinned server
+    rg_httpd_host_request(fd, HTTP_POST, "/ota?url=http%3A%2F%2Fupdates.example%2Frg2.bin",
+                          "Authorization: Bearer host-ota-token\r\n", rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+    rg_httpd_host_request(fd, HTTP_POST, uri, "Authorization: Bearer host-ota-token\r\n", rg_http_handle_request,
+                          &resp);
+    TEST_ASSERT_EQUAL_INT(202, resp.status);
+    rg_httpd_host_close(fd);
+}
+
+TEST_CASE("rg_http_handle_request serves and changes /settings", "[rg_http_router]")
+{
+    static const char AUTH[] = "Authorization: Bearer host-settings-token\r\n";
+    int fd = rg_httpd_host_open();
+    rg_httpd_host_response_t resp;
+    const rg_config_t *config = rg_config_task_config();
+    const char *const names[] = {"deadband_t", "heartbeat_s", "wifi_password"};
+    char saved[3][RG_SETTINGS_PASSWORD_MAX + 1];
+    for (int i = 0; i < 3; i++) {
+        rg_config_format(config, rg_config_find(config, names[i]), saved[i], sizeof(saved[i]));
+    }
+
+    // The dashboard's link
+    TEST_ASSERT_EQUAL(ESP_OK, rg_httpd_host_get(fd, "/settings/", NULL, rg_http_handle_request, &resp));
+    TEST_ASSERT_EQUAL_INT(200, resp.status);
+    std::string body(resp.body, resp.body_len);
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"wifi_password\":null"));
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"sample_min_ms\":"));
+
+    // Changes need the token, in the header
+    const int32_t deadband_t = rg_config_get_int(config, RG_SETTING_DEADBAND_T);
+    rg_httpd_host_request_body(fd, HTTP_POST, "/settings", NULL, "deadband_t=0.25", rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(403, resp.status);
+    rg_httpd_host_request_body(fd, HTTP_POST, "/settings?token=host-settings-token", NULL, "deadband_t=0.25",
+                               rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(403, resp.status);
+    TEST_ASSERT_EQUAL_INT32(deadband_t, rg_config_get_int(config, RG_SETTING_DEADBAND_T));
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_httpd_host_request_body(fd, HTTP_POST, "/settings", AUTH,
+                                                         "deadband_t=0.25&heartbeat_s=600&wifi_password=s3cret%21",
+                                                         rg_http_handle_request, &resp));
+    TEST_ASSERT_EQUAL_INT(200, resp.status);
+    body.assign(resp.body, resp.body_len);
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"deadband_t\":0.25,"));
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"heartbeat_s\":600,"));
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"wifi_password\":null"));
+
+    // One bad field rejects the whole request and names the field
+    rg_httpd_host_request_body(fd, HTTP_POST, "/settings", AUTH, "deadband_t=0.5&sample_min_ms=1",
+                               rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+    body.assign(resp.body, resp.body_len);
+    TEST_ASSERT_EQUAL_STRING("Invalid value for setting: sample_min_ms", body.c_str());
+    rg_httpd_host_request_body(fd, HTTP_POST, "/settings", AUTH, "color=red", rg_http_handle_request, &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+    body.assign(resp.body, resp.body_len);
+    TEST_ASSERT_EQUAL_STRING("Unknown setting: color", body.c_str());
+    rg_httpd_host_request_body(fd, HTTP_POST, "/settings", AUTH, "rules=damp%3A+humidity+%3E", rg_http_handle_request,
+                               &resp);
+    TEST_ASSERT_EQUAL_INT(400, resp.status);
+
+    TEST_ASSERT_EQUAL_INT32(25, rg_config_get_int(config, RG_SETTING_DEADBAND_T));
+    char password[RG_SETTINGS_PASSWORD_MAX + 1];
+    rg_config_get_string(config, RG_SETTING_WIFI_PASSWORD, password, sizeof(password));
+    TEST_ASSERT_EQUAL_STRING("s3cret!", password);
+
+    // Put the settings back for the other tests
+    const char *const restore[] = {saved[0], saved[1], saved[2]};
+    TEST_ASSERT_EQUAL(ESP_OK, rg_config_task_set(names, restore, 3, NULL));
+    rg_httpd_host_close(fd);
+}
+#endif
@@ -0,0 +1,313 @@
+#include "unity.h"
+#include "sensor_modules/rg_i2c_bus.h"
+#include "sensor_modules/rg_bme280.h"
+#include "sensor_modules/rg_bme280_sim.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+// Simulated controller: one BME280 model per address, attach/detach recorded
+typedef struct {
+    rg_bme280_sim_t sims[2];
+    uint32_t scl_hz[0x80]; // Clock each address is attached at; 0 when detached
+    int attaches;
+    int detaches;
+} fake_controller_t;
+
+static fake_controller_t s_ctrl;
+static rg_i2c_bus_t s_bus;
+
+static rg_bme280_sim_t *sim_at(uint8_t addr)
+{
+    return &s_ctrl.sims[addr == RG_BME280_I2C_ADDR_SEC];
+}
+
+static esp_err_t fake_attach(void *ctx, uint8_t addr, uint32_t scl_hz, void **handle)
+{
+    fake_controller_t *ctrl = (fake_controller_t *)ctx;
+    ctrl->scl_hz[addr] = scl_hz;
+    ctrl->attaches++;
+    *handle = (void *)(uintptr_t)addr;
+    return ESP_OK;
+}
+
+static void fake_detach(void *ctx, void *handle)
+{
+    fake_controller_t *ctrl = (fake_controller_t *)ctx;
+    ctrl->scl_hz[(uintptr_t)handle] = 0;
+    ctrl->detaches++;
+}
+
+static esp_err_t fake_transfer(void *ctx, void *handle, const uint8_t *write, size_t write_len, uint8_t *read,
+                               size_t read_len)
+{
+    uint8_t addr = (uint8_t)(uintptr_t)handle;
+    if (addr != RG_BME280_I2C_ADDR_PRIM && addr != RG_BME280_I2C_ADDR_SEC) {
+        return ESP_FAIL; // NACK
+    }
+    return rg_bme280_sim_transfer(sim_at(addr), write, write_len, read, read_len);
+}
+
+static void bus_setup(uint32_t max_scl_hz)
+{
+    memset(&s_ctrl, 0, sizeof(s_ctrl));
+    rg_bme280_sim_init(&s_ctrl.sims[0], &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_bme280_sim_init(&s_ctrl.sims[1], &rg_bme280_sim_reference_calib, &rg_bme280_sim_reference_raw);
+    rg_i2c_bus_driver_t driver = {
+        .attach = fake_attach,
+        .detach = fake_detach,
+        .transfer = fake_transfer,
+        .ctx = &s_ctrl,
+    };
+    rg_i2c_bus_init(&s_bus, &driver, max_scl_hz);
+}
+
+typedef struct {
+    int calls;
+    int order[8];
+    esp_err_t errs[8];
+} completions_t;
+
+static completions_t s_done;
+
+static void record_done(rg_i2c_txn_t *txn, esp_err_t err)
+{
+    s_done.order[s_done.calls] = (int)(intptr_t)txn->ctx;
+    s_done.errs[s_done.calls] = err;
+    s_done.calls++;
+}
+
+TEST_CASE("rg_i2c_bus runs at the fastest clock every device supports", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    uint8_t fast, slow, capped;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "fast", 0x76, 1000000, &fast));
+    TEST_ASSERT_EQUAL_UINT32(400000, s_bus.scl_hz); // Capped by the board
+    TEST_ASSERT_EQUAL_UINT32(400000, s_ctrl.scl_hz[0x76]);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "slow", 0x40, 100000, &slow));
+    TEST_ASSERT_EQUAL_UINT32(100000, s_bus.scl_hz);
+    TEST_ASSERT_EQUAL_UINT32(100000, s_ctrl.scl_hz[0x76]); // Re-attached at the lower clock
+    TEST_ASSERT_EQUAL_UINT32(100000, s_ctrl.scl_hz[0x40]);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "capped", 0x77, 400000, &capped));
+    TEST_ASSERT_EQUAL_UINT32(100000, s_ctrl.scl_hz[0x77]);
+
+    rg_i2c_bus_remove_device(&s_bus, slow);
+    TEST_ASSERT_EQUAL_UINT32(400000, s_bus.scl_hz);
+    TEST_ASSERT_EQUAL_UINT32(0, s_ctrl.scl_hz[0x40]);
+    TEST_ASSERT_EQUAL_UINT32(400000, s_ctrl.scl_hz[0x76]);
+    TEST_ASSERT_EQUAL_UINT32(400000, s_ctrl.scl_hz[0x77]);
+
+    rg_i2c_bus_remove_device(&s_bus, fast);
+    rg_i2c_bus_remove_device(&s_bus, capped);
+    TEST_ASSERT_EQUAL_UINT32(0, s_bus.scl_hz);
+    TEST_ASSERT_EQUAL_INT(s_ctrl.attaches, s_ctrl.detaches);
+}
+
+TEST_CASE("rg_i2c_bus rejects duplicate addresses and a full table", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    uint8_t device;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_i2c_bus_add_device(&s_bus, "bad", 0x80, 100000, &device));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "a", 0x10, 100000, &device));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, rg_i2c_bus_add_device(&s_bus, "b", 0x10, 100000, &device));
+    for (int i = 1; i < RG_I2C_BUS_MAX_DEVICES; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "n", (uint8_t)(0x10 + i), 100000, &device));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, rg_i2c_bus_add_device(&s_bus, "full", 0x20, 100000, &device));
+
+    // A freed slot is reused
+    rg_i2c_bus_remove_device(&s_bus, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "again", 0x20, 100000, &device));
+    TEST_ASSERT_EQUAL_UINT8(3, device);
+}
+
+TEST_CASE("rg_i2c_bus runs a batch in order and accounts every device", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    uint8_t prim, sec;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "bme280@0x76", 0x76, RG_BME280_MAX_SCL_HZ, &prim));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "bme280@0x77", 0x77, RG_BME280_MAX_SCL_HZ, &sec));
+
+    uint8_t id_prim = 0, id_sec = 0;
+    rg_i2c_txn_t txns[] = {
+        {.device = prim, .write_len = 2, .write = {RG_BME280_REG_CTRL_HUM, 0x01}, .done = record_done,
+         .ctx = (void *)0},
+        {.device = sec, .write_len = 1, .write = {RG_BME280_REG_CHIP_ID}, .read = &id_sec, .read_len = 1,
+         .done = record_done, .ctx = (void *)1},
+        {.device = prim, .write_len = 1, .write = {RG_BME280_REG_CHIP_ID}, .read = &id_prim, .read_len = 1,
+         .done = record_done, .ctx = (void *)2},
+        {.device = 7, .write_len = 1, .write = {0}, .done = record_done, .ctx = (void *)3}, // Free slot
+    };
+    rg_i2c_txn_t *batch[] = {&txns[0], &txns[1], &txns[2], &txns[3]};
+    txns[1].submitted_us = esp_timer_get_time() - 1000;
+
+    memset(&s_done, 0, sizeof(s_done));
+    rg_i2c_bus_run(&s_bus, batch, 4);
+
+    TEST_ASSERT_EQUAL_INT(4, s_done.calls);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(i, s_done.order[i]);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, s_done.errs[0]);
+    TEST_ASSERT_EQUAL(ESP_OK, s_done.errs[2]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, s_done.errs[3]);
+    TEST_ASSERT_EQUAL_HEX8(RG_BME280_CHIP_ID, id_prim);
+    TEST_ASSERT_EQUAL_HEX8(RG_BME280_CHIP_ID, id_sec);
+    TEST_ASSERT_EQUAL_HEX8(0x01, s_ctrl.sims[0].regs[RG_BME280_REG_CTRL_HUM]);
+
+    const rg_i2c_device_stats_t *p = &s_bus.devices[prim].stats;
+    const rg_i2c_device_stats_t *s = &s_bus.devices[sec].stats;
+    TEST_ASSERT_EQUAL_UINT32(2, p->transactions);
+    TEST_ASSERT_EQUAL_UINT32(3 + 4, p->bytes); // Same wire size as the sim counts
+    TEST_ASSERT_EQUAL_UINT32(s_ctrl.sims[0].bus_bytes, p->bytes);
+    TEST_ASSERT_EQUAL_UINT32(1, s->transactions);
+    TEST_ASSERT_TRUE(s->wait_us >= 1000);
+    TEST_ASSERT_TRUE(p->wait_us == 0); // Not stamped
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.batches);
+    TEST_ASSERT_EQUAL_UINT32(4, s_bus.max_batch);
+    TEST_ASSERT_EQUAL_UINT32(2, s_bus.contended); // The unknown device never reached the bus
+}
+
+TEST_CASE("rg_i2c_bus counts failed transfers per device", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    uint8_t absent;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "absent", 0x44, 400000, &absent));
+    uint8_t value = 0;
+    rg_i2c_txn_t txn = {.device = absent, .write_len = 1, .read = &value, .read_len = 1, .done = record_done};
+    rg_i2c_txn_t *batch[] = {&txn};
+    memset(&s_done, 0, sizeof(s_done));
+    rg_i2c_bus_run(&s_bus, batch, 1);
+    TEST_ASSERT_EQUAL(ESP_FAIL, s_done.errs[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.devices[absent].stats.errors);
+    TEST_ASSERT_EQUAL_UINT32(0, s_bus.contended);
+}
+
+typedef struct {
+    char text[4096];
+    size_t len;
+} capture_t;
+
+static esp_err_t capture_sink(void *ctx, const char *data, size_t len)
+{
+    capture_t *capture = (capture_t *)ctx;
+    if (capture->len + len < sizeof(capture->text)) {
+        memcpy(capture->text + capture->len, data, len);
+        capture->len += len;
+        capture->text[capture->len] = '\0';
+    }
+    return ESP_OK;
+}
+
+TEST_CASE("rg_i2c_bus exports clock, contention and per-device time", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    uint8_t prim;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "bme280@0x76", 0x76, RG_BME280_MAX_SCL_HZ, &prim));
+    s_bus.devices[prim].stats.transactions = 12;
+    s_bus.devices[prim].stats.busy_us = 2500;
+    s_bus.contended = 3;
+
+    static capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    rg_metrics_writer_t writer = {.sink = capture_sink, .ctx = &capture};
+    rg_i2c_bus_write_metrics(&s_bus, &writer);
+    writer.sink(writer.ctx, writer.buf, writer.len); // Flush the tail
+
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_i2c_bus_clock_hz 400000\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_i2c_bus_contended_total 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_i2c_device_transactions_total{device=\"bme280@0x76\"} 12\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "rg_i2c_device_busy_seconds_total{device=\"bme280@0x76\"} 0.0025\n"));
+}
+
+// rg_bme280_bus_t through the engine, one transfer per batch as the bus task would run it
+static esp_err_t engine_read(void *ctx, uint8_t reg, uint8_t *data, size_t len)
+{
+    rg_i2c_txn_t txn = {.device = (uint8_t)(uintptr_t)ctx, .write_len = 1, .write = {reg}, .read = data,
+                        .read_len = len, .done = record_done};
+    rg_i2c_txn_t *batch[] = {&txn};
+    s_done.calls = 0;
+    rg_i2c_bus_run(&s_bus, batch, 1);
+    return s_done.errs[0];
+}
+
+static esp_err_t engine_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    rg_i2c_txn_t txn = {.device = (uint8_t)(uintptr_t)ctx, .write_len = 2, .write = {reg, value},
+                        .done = record_done};
+    rg_i2c_txn_t *batch[] = {&txn};
+    s_done.calls = 0;
+    rg_i2c_bus_run(&s_bus, batch, 1);
+    return s_done.errs[0];
+}
+
+// What the bus task does with a chain from rg_bme280_i2c.c: all accesses in one batch
+static void engine_batch(rg_bme280_access_t *accesses, size_t count)
+{
+    rg_i2c_txn_t txns[2 * RG_BME280_GROUP_MAX];
+    rg_i2c_txn_t *batch[2 * RG_BME280_GROUP_MAX];
+    TEST_ASSERT_TRUE(count <= 2 * RG_BME280_GROUP_MAX);
+    for (size_t i = 0; i < count; i++) {
+        const rg_bme280_access_t *a = &accesses[i];
+        txns[i] = (rg_i2c_txn_t){.device = (uint8_t)(uintptr_t)a->bus->ctx, .write_len = a->data ? 1 : 2,
+                                 .write = {a->reg, a->value}, .read = a->data, .read_len = a->data ? a->len : 0,
+                                 .done = record_done};
+        batch[i] = &txns[i];
+    }
+    s_done.calls = 0;
+    rg_i2c_bus_run(&s_bus, batch, count);
+    for (size_t i = 0; i < count; i++) {
+        accesses[i].result = s_done.errs[i];
+    }
+}
+
+static void engine_delay_us(void *ctx, uint32_t us)
+{
+    sim_at(RG_BME280_I2C_ADDR_PRIM)->delay_us += us;
+}
+
+TEST_CASE("rg_i2c_bus carries two BME280s sampled as a group", "[rg_i2c_bus]")
+{
+    bus_setup(400000);
+    rg_bme280_t sensors[2];
+    const uint8_t addrs[2] = {RG_BME280_I2C_ADDR_PRIM, RG_BME280_I2C_ADDR_SEC};
+    for (int i = 0; i < 2; i++) {
+        uint8_t device;
+        TEST_ASSERT_EQUAL(ESP_OK, rg_i2c_bus_add_device(&s_bus, "bme280", addrs[i], RG_BME280_MAX_SCL_HZ, &device));
+        rg_bme280_bus_t bus = {
+            .read = engine_read,
+            .write = engine_write,
+            .delay_us = engine_delay_us,
+            .batch = engine_batch,
+            .ctx = (void *)(uintptr_t)device,
+        };
+        memset(&sensors[i], 0, sizeof(sensors[i]));
+        TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_init_with_bus(&sensors[i], &bus));
+    }
+    s_ctrl.sims[1].adc.adc_T += 1000; // A little warmer
+
+    rg_bme280_sim_reset_counters(&s_ctrl.sims[0]);
+    memset(&s_bus.devices[0].stats, 0, sizeof(s_bus.devices[0].stats));
+    memset(&s_bus.devices[1].stats, 0, sizeof(s_bus.devices[1].stats));
+    rg_bme280_t *group[2] = {&sensors[0], &sensors[1]};
+    rg_bme280_values_t values[2];
+    esp_err_t results[2];
+    const uint32_t batches = s_bus.batches;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_bme280_read_group(group, 2, values, results));
+    TEST_ASSERT_EQUAL(ESP_OK, results[0]);
+    TEST_ASSERT_EQUAL(ESP_OK, results[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.08f, values[0].temperature);
+    TEST_ASSERT_TRUE(values[1].temperature > values[0].temperature);
+
+    // One conversion wait for both sensors; each costs a trigger, a status poll and the burst
+    TEST_ASSERT_EQUAL_UINT32(sensors[0].measure_time_us, (uint32_t)s_ctrl.sims[0].delay_us);
+    TEST_ASSERT_EQUAL_UINT32(3, s_bus.devices[0].stats.transactions);
+    TEST_ASSERT_EQUAL_UINT32(3, s_bus.devices[1].stats.transactions);
+    // Both triggers in one batch, then both status polls and bursts in another
+    TEST_ASSERT_EQUAL_UINT32(2, s_bus.batches - batches);
+    TEST_ASSERT_EQUAL_UINT32(4, s_bus.max_batch);
+}
@@ -0,0 +1,195 @@
+#include "unity.h"
+#include "services/json/rg_json_writer.h"
+#include "services/shared_data/shared_data_json.h"
+
+#include <chrono>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Counts global heap allocations while s_counting is set
+static bool s_counting = false;
+static size_t s_allocs = 0;
+static size_t s_alloc_bytes = 0;
+
+void *operator new(size_t size)
+{
+    if (s_counting) {
+        s_allocs++;
+        s_alloc_bytes += size;
+    }
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+typedef struct {
+    float temperature;
+    float humidity;
+    float pressure;
+    const char *ip_address;
+} data_sample_t;
+
+// The /data body exactly as the handler built it with nlohmann
+static std::string data_nlohmann(const data_sample_t &s)
+{
+    nlohmann::json json_data;
+    json_data["temperature"] = s.temperature;
+    json_data["humidity"] = s.humidity;
+    json_data["pressure"] = s.pressure;
+    json_data["ip_address"] = s.ip_address;
+    return json_data.dump();
+}
+
+// The /data body as the handler builds it now
+static size_t data_writer(const data_sample_t &s, char *body, size_t size)
+{
+    shared_data_t snapshot = {};
+    snapshot.temperature = s.temperature;
+    snapshot.humidity = s.humidity;
+    snapshot.pressure = s.pressure;
+    strncpy(snapshot.ip_address, s.ip_address, sizeof(snapshot.ip_address) - 1);
+
+    rg_json_writer json(body, size);
+    shared_data_write_json(json, snapshot);
+    return json.ok() ? json.size() : 0;
+}
+
+TEST_CASE("rg_json_writer output is byte-identical to nlohmann dump", "[rg_json_writer]")
+{
+    const data_sample_t fixed[] = {
+        {21.5f, 45.25f, 1013.25f, "192.168.1.42"},
+        {0.0f, 0.0f, 0.0f, ""},
+        {-0.0f, 100.0f, 300.0f, "10.0.0.1"},
+        {-12.34f, 33.333f, 1099.99f, "255.255.255.255"},
+        {NAN, INFINITY, 1e-7f, "a\"b\\c\n\x01"},
+        {1e20f, -3.4e38f, 123456789.0f, "/slash"},
+    };
+    char body[192];
+    for (const data_sample_t &s : fixed) {
+        std::string expected = data_nlohmann(s);
+        size_t len = data_writer(s, body, sizeof(body));
+        TEST_ASSERT_EQUAL(expected.size(), len);
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), body, len);
+    }
+
+    // Plus a sweep over realistic sensor ranges
+    srand(1234);
+    for (int i = 0; i < 20000; i++) {
+        data_sample_t s = {
+            -40.0f + 125.0f * rand() / (float)RAND_MAX,
+            100.0f * rand() / (float)RAND_MAX,
+            300.0f + 800.0f * rand() / (float)RAND_MAX,
+            "192.168.100.200",
+        };
+        std::string expected = data_nlohmann(s);
+        size_t len = data_writer(s, body, sizeof(body));
+        TEST_ASSERT_EQUAL(expected.size(), len);
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), body, len);
+    }
+}
+
+TEST_CASE("rg_json_writer streams through a sink in fixed chunks", "[rg_json_writer]")
+{
+    struct sink_state_t {
+        std::string out;
+        size_t calls;
+    } state = {std::string(), 0};
+
+    auto sink = [](void *ctx, const char *data, size_t len) -> esp_err_t {
+        sink_state_t *st = static_cast<sink_state_t *>(ctx);
+        st->out.append(data, len);
+        st->calls++;
+        return ESP_OK;
+    };
+
+    char buf[16];
+    rg_json_writer json(buf, sizeof(buf), sink, &state);
+    json.begin_object();
+    json.key("values");
+    json.begin_array();
+    for (int32_t i = 0; i < 10; i++) {
+        json.value(i);
+    }
+    json.end_array();
+    json.key("ok");
+    json.value(true);
+    json.key("nested");
+    json.begin_object();
+    json.end_object();
+    json.end_object();
+    TEST_ASSERT_TRUE(json.flush());
+
+    TEST_ASSERT_EQUAL_STRING("{\"values\":[0,1,2,3,4,5,6,7,8,9],\"ok\":true,\"nested\":{}}", state.out.c_str());
+    TEST_ASSERT_GREATER_THAN(2, state.calls);
+}
+
+TEST_CASE("rg_json_writer reports overflow without a sink", "[rg_json_writer]")
+{
+    char buf[8];
+    rg_json_writer json(buf, sizeof(buf));
+    json.begin_object();
+    json.key("temperature");
+    json.end_object();
+    TEST_ASSERT_FALSE(json.ok());
+}
+
+TEST_CASE("rg_json_writer vs nlohmann /data cost per request", "[rg_json_writer][bench]")
+{
+    using clock = std::chrono::steady_clock;
+    constexpr int kRequests = 5000;
+    const data_sample_t s = {23.456f, 41.87f, 1009.72f, "192.168.1.42"};
+    char body[192];
+    size_t sink = 0;
+
+    // Old handler: build the object, then dump() once for the pointer and once for the length
+    s_allocs = s_alloc_bytes = 0;
+    s_counting = true;
+    auto start = clock::now();
+    for (int i = 0; i < kRequests; i++) {
+        nlohmann::json json_data;
+        json_data["temperature"] = s.temperature;
+        json_data["humidity"] = s.humidity;
+        json_data["pressure"] = s.pressure;
+        json_data["ip_address"] = s.ip_address;
+        sink += strlen(json_data.dump().c_str()) + json_data.dump().length();
+    }
+    double nlohmann_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / kRequests;
+    s_counting = false;
+    const double nlohmann_allocs = (double)s_allocs / kRequests;
+    const double nlohmann_bytes = (double)s_alloc_bytes / kRequests;
+    const size_t body_len = data_nlohmann(s).size();
+
+    s_allocs = s_alloc_bytes = 0;
+    s_counting = true;
+    start = clock::now();
+    for (int i = 0; i < kRequests; i++) {
+        sink += data_writer(s, body, sizeof(body));
+    }
+    double writer_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / kRequests;
+    s_counting = false;
+
+    // Bytes copied: nlohmann serializes the body twice into fresh strings; the writer once into the buffer
+    printf("/data nlohmann: %.1f allocs, %.0f heap bytes, %u bytes serialized, %.2f us per request\n",
+           nlohmann_allocs, nlohmann_bytes, (unsigned)(2 * body_len), nlohmann_us);
+    printf("/data writer:   %.1f allocs, %.0f heap bytes, %u bytes serialized, %.2f us per request\n",
+           (double)s_allocs / kRequests, (double)s_alloc_bytes / kRequests, (unsigned)body_len, writer_us);
+    TEST_ASSERT_EQUAL(0, s_allocs);
+    TEST_ASSERT_NOT_EQUAL(0, sink);
+}
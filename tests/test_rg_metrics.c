@@ -0,0 +1,158 @@
+#include "unity.h"
+#include "services/metrics/rg_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const uint32_t s_bounds[] = {100, 1000, 10000};
+
+typedef struct {
+    char text[32768]; // Room for the metrics other tests in the same run registered
+    size_t len;
+    int chunks;
+    int fail_after; // Sink fails from this chunk on; 0 never fails
+} capture_t;
+
+static esp_err_t capture_sink(void *ctx, const char *data, size_t len)
+{
+    capture_t *capture = (capture_t *)ctx;
+    capture->chunks++;
+    if (capture->fail_after && capture->chunks >= capture->fail_after) {
+        return ESP_FAIL;
+    }
+    if (capture->len + len < sizeof(capture->text)) {
+        memcpy(capture->text + capture->len, data, len);
+        capture->len += len;
+        capture->text[capture->len] = '\0';
+    }
+    return ESP_OK;
+}
+
+static int count_occurrences(const char *text, const char *needle)
+{
+    int n = 0;
+    for (const char *p = strstr(text, needle); p; p = strstr(p + 1, needle)) {
+        n++;
+    }
+    return n;
+}
+
+TEST_CASE("rg_metrics places observations in the first bucket that holds them", "[rg_metrics]")
+{
+    static rg_metrics_histogram_t h = RG_METRICS_HISTOGRAM_INIT("test_buckets_seconds", "Test.", NULL, s_bounds);
+    TEST_ASSERT_EQUAL_UINT8(3, h.bucket_count);
+
+    rg_metrics_observe(&h, 0);
+    rg_metrics_observe(&h, 100); // Bounds are inclusive, as Prometheus' "le"
+    rg_metrics_observe(&h, 101);
+    rg_metrics_observe(&h, 10000);
+    rg_metrics_observe(&h, 10001);
+    rg_metrics_observe(&h, UINT32_MAX);
+
+    TEST_ASSERT_EQUAL_UINT32(2, h.counts[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, h.counts[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, h.counts[2]);
+    TEST_ASSERT_EQUAL_UINT32(2, h.counts[3]);
+    TEST_ASSERT_EQUAL_UINT32(6, rg_metrics_histogram_count(&h));
+}
+
+TEST_CASE("rg_metrics histogram sum carries past 32 bits", "[rg_metrics]")
+{
+    static rg_metrics_histogram_t h = RG_METRICS_HISTOGRAM_INIT("test_sum_seconds", "Test.", NULL, s_bounds);
+    uint64_t expected = 0;
+    for (int i = 0; i < 5; i++) {
+        rg_metrics_observe(&h, 4000000000u);
+        expected += 4000000000u;
+    }
+    rg_metrics_observe(&h, 7);
+    expected += 7;
+    TEST_ASSERT_TRUE(rg_metrics_histogram_sum_us(&h) == expected);
+}
+
+TEST_CASE("rg_metrics exports histograms and counters in Prometheus text format", "[rg_metrics]")
+{
+    static rg_metrics_histogram_t a =
+        RG_METRICS_HISTOGRAM_INIT("test_export_seconds", "Export test.", "route=\"/a\"", s_bounds);
+    static rg_metrics_histogram_t b =
+        RG_METRICS_HISTOGRAM_INIT("test_export_seconds", "Export test.", "route=\"/b\"", s_bounds);
+    static rg_metrics_counter_t c = RG_METRICS_COUNTER_INIT("test_export_total", "Export counter.", NULL);
+    rg_metrics_register_histogram(&a);
+    rg_metrics_register_histogram(&b);
+    rg_metrics_register_histogram(&a); // Ignored
+    rg_metrics_register_counter(&c);
+    rg_metrics_register_counter(&c);
+
+    rg_metrics_observe(&a, 50);
+    rg_metrics_observe(&a, 2500);
+    rg_metrics_observe(&a, 20000);
+    rg_metrics_add(&c, 3);
+
+    static capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_metrics_export(capture_sink, &capture));
+
+    TEST_ASSERT_EQUAL_INT(1, count_occurrences(capture.text, "# HELP test_export_seconds Export test.\n"));
+    TEST_ASSERT_EQUAL_INT(1, count_occurrences(capture.text, "# TYPE test_export_seconds histogram\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_bucket{route=\"/a\",le=\"0.0001\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_bucket{route=\"/a\",le=\"0.001\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_bucket{route=\"/a\",le=\"0.01\"} 2\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_bucket{route=\"/a\",le=\"+Inf\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_sum{route=\"/a\"} 0.02255\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_count{route=\"/a\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_export_seconds_count{route=\"/b\"} 0\n"));
+    TEST_ASSERT_EQUAL_INT(1, count_occurrences(capture.text, "test_export_seconds_count{route=\"/a\"}"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "# TYPE test_export_total counter\ntest_export_total 3\n"));
+}
+
+static void test_collector(rg_metrics_writer_t *writer)
+{
+    rg_metrics_write_family(writer, "test_collector_bytes", "gauge", "Collector test.");
+    rg_metrics_write_value(writer, "test_collector_bytes", "task=\"main\"", -42);
+    rg_metrics_write_seconds(writer, "test_collector_seconds", NULL, 1500000);
+}
+
+TEST_CASE("rg_metrics runs collectors and streams in bounded chunks", "[rg_metrics]")
+{
+    static bool registered = false;
+    if (!registered) {
+        TEST_ASSERT_EQUAL(ESP_OK, rg_metrics_register_collector(test_collector));
+        registered = true;
+    }
+    static capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_metrics_export(capture_sink, &capture));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_collector_bytes{task=\"main\"} -42\n"));
+    TEST_ASSERT_NOT_NULL(strstr(capture.text, "test_collector_seconds 1.5\n"));
+    TEST_ASSERT_TRUE(capture.len <= (size_t)capture.chunks * sizeof(((rg_metrics_writer_t *)0)->buf));
+
+    // The first sink error is returned and nothing more is sent
+    memset(&capture, 0, sizeof(capture));
+    capture.fail_after = 1;
+    TEST_ASSERT_EQUAL(ESP_FAIL, rg_metrics_export(capture_sink, &capture));
+    TEST_ASSERT_EQUAL_INT(1, capture.chunks);
+}
+
+TEST_CASE("rg_metrics escapes label values", "[rg_metrics]")
+{
+    char out[32];
+    rg_metrics_escape_label(out, sizeof(out), "a\"b\\c\nd");
+    TEST_ASSERT_EQUAL_STRING("a\\\"b\\\\c\\nd", out);
+
+    rg_metrics_escape_label(out, 6, "abcdefgh");
+    TEST_ASSERT_EQUAL_STRING("abcd", out);
+}
+
+TEST_CASE("rg_metrics observation cost", "[rg_metrics][bench]")
+{
+    static rg_metrics_histogram_t h =
+        RG_METRICS_HISTOGRAM_INIT("test_cost_seconds", "Test.", NULL, rg_metrics_latency_bounds_us);
+    const int n = 1000000;
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) {
+        rg_metrics_observe(&h, (uint32_t)(i & 0xFFFF) * 8);
+    }
+    double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+    printf("rg_metrics: %.1f ns per histogram observation\n", ns);
+    TEST_ASSERT_EQUAL_UINT32(n, rg_metrics_histogram_count(&h));
+}
@@ -0,0 +1,169 @@
+#include "unity.h"
+#include "communications/rg_mqtt_publisher.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CAPACITY 32
+#define TOPIC_LEN 22 // "rg2/rg2-a1b2c3/samples"
+
+static rg_mqtt_sample_t s_storage[CAPACITY];
+
+static void push(rg_mqtt_publisher_t *pub, uint32_t ts, int16_t t, uint16_t h, uint16_t p)
+{
+    rg_mqtt_sample_t sample = {.timestamp = ts, .temperature = t, .humidity = h, .pressure = p};
+    rg_mqtt_publisher_push(pub, &sample);
+}
+
+TEST_CASE("rg_mqtt encodes batches as CBOR", "[rg_mqtt]")
+{
+    rg_mqtt_publisher_t pub;
+    rg_mqtt_publisher_init(&pub, s_storage, CAPACITY, 2, 60, RG_MQTT_FORMAT_CBOR, TOPIC_LEN);
+    push(&pub, 90, 2137, 4852, 10132);
+    push(&pub, 100, -5, 0, 9);
+
+    static const uint8_t expected[] = {
+        0xA4,                                      // map(4)
+        0x61, 'n', 0x61, 'a',                      // "n": "a"
+        0x63, 'n', 'o', 'w', 0x18, 100,            // "now": 100
+        0x62, 't', '0', 0x18, 90,                  // "t0": 90
+        0x61, 's', 0x82,                           // "s": array(2)
+        0x84, 0x00, 0x19, 0x08, 0x59, 0x19, 0x12, 0xF4, 0x19, 0x27, 0x94, // [0, 2137, 4852, 10132]
+        0x84, 0x0A, 0x24, 0x00, 0x09,              // [10, -5, 0, 9]
+    };
+    uint8_t buf[64];
+    size_t len = rg_mqtt_encode(&pub, 2, 100, "a", buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, sizeof(expected));
+
+    // Too small a buffer is refused, not truncated
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_encode(&pub, 2, 100, "a", buf, sizeof(expected) - 1));
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_encode(&pub, 3, 100, "a", buf, sizeof(buf)));
+}
+
+TEST_CASE("rg_mqtt encodes batches as JSON", "[rg_mqtt]")
+{
+    rg_mqtt_publisher_t pub;
+    rg_mqtt_publisher_init(&pub, s_storage, CAPACITY, 2, 60, RG_MQTT_FORMAT_JSON, TOPIC_LEN);
+    push(&pub, 86340, 2137, 4852, 10132);
+    push(&pub, 86370, -1250, 4850, 10132);
+
+    const char *expected = "{\"n\":\"rg2-a1b2c3\",\"now\":86412,\"t0\":86340,\"s\":[[0,2137,4852,10132],"
+                           "[30,-1250,4850,10132]]}";
+    char buf[128];
+    size_t len = rg_mqtt_encode(&pub, 2, 86412, "rg2-a1b2c3", (uint8_t *)buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT32(strlen(expected), len);
+    buf[len] = '\0';
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+
+    // Exactly the payload plus a terminator is enough
+    TEST_ASSERT_EQUAL_UINT32(len, rg_mqtt_encode(&pub, 2, 86412, "rg2-a1b2c3", (uint8_t *)buf, len + 1));
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_encode(&pub, 2, 86412, "rg2-a1b2c3", (uint8_t *)buf, len));
+}
+
+TEST_CASE("rg_mqtt publishes a batch when it is full or old enough", "[rg_mqtt]")
+{
+    rg_mqtt_publisher_t pub;
+    rg_mqtt_publisher_init(&pub, s_storage, CAPACITY, 3, 60, RG_MQTT_FORMAT_CBOR, TOPIC_LEN);
+    uint8_t buf[256];
+
+    push(&pub, 1000, 2100, 4500, 10130);
+    push(&pub, 1010, 2100, 4500, 10130);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_publisher_next(&pub, 1010, "a", buf, sizeof(buf))); // Offline
+    rg_mqtt_publisher_set_connected(&pub, true);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_publisher_next(&pub, 1010, "a", buf, sizeof(buf))); // Not full yet
+
+    push(&pub, 1020, 2100, 4500, 10130);
+    TEST_ASSERT_TRUE(rg_mqtt_publisher_next(&pub, 1020, "a", buf, sizeof(buf)) > 0);
+    TEST_ASSERT_EQUAL_UINT32(3, pub.in_flight);
+    // One batch in flight at a time
+    push(&pub, 1030, 2100, 4500, 10130);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_publisher_next(&pub, 1200, "a", buf, sizeof(buf)));
+    rg_mqtt_publisher_acked(&pub);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.count);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(3, pub.stats.samples);
+
+    // A lone sample goes out once it is max_age_s old
+    TEST_ASSERT_EQUAL_UINT32(0, rg_mqtt_publisher_next(&pub, 1089, "a", buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(rg_mqtt_publisher_next(&pub, 1090, "a", buf, sizeof(buf)) > 0);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.in_flight);
+}
+
+TEST_CASE("rg_mqtt offline queue keeps the newest samples and drains in order", "[rg_mqtt]")
+{
+    rg_mqtt_publisher_t pub;
+    rg_mqtt_publisher_init(&pub, s_storage, CAPACITY, 4, 60, RG_MQTT_FORMAT_JSON, TOPIC_LEN);
+    for (uint32_t i = 0; i < CAPACITY + 8; i++) {
+        push(&pub, 1000 + i * 10, (int16_t)(2000 + i), 4500, 10130);
+    }
+    TEST_ASSERT_EQUAL_UINT32(CAPACITY, pub.count);
+    TEST_ASSERT_EQUAL_UINT32(8, pub.stats.dropped);
+
+    rg_mqtt_publisher_set_connected(&pub, true);
+    uint8_t buf[200];
+    char json[201];
+    int16_t expected_t = 2008; // The oldest 8 were dropped
+    int batches = 0;
+    size_t len;
+    while ((len = rg_mqtt_publisher_next(&pub, 2000, "a", buf, sizeof(buf))) > 0) {
+        TEST_ASSERT_TRUE(len <= sizeof(buf));
+        memcpy(json, buf, len);
+        json[len] = '\0';
+        // Every batch starts where the previous one ended
+        char first[16];
+        snprintf(first, sizeof(first), "[0,%d,", expected_t);
+        TEST_ASSERT_NOT_NULL(strstr(json, first));
+        TEST_ASSERT_EQUAL_STRING("]}", json + len - 2);
+        expected_t += (int16_t)pub.in_flight;
+        rg_mqtt_publisher_acked(&pub);
+        batches++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, pub.count);
+    TEST_ASSERT_EQUAL_INT(2008 + CAPACITY, expected_t);
+    TEST_ASSERT_EQUAL_UINT32(CAPACITY, pub.stats.samples);
+    // The backlog goes out in payload-sized batches, more than batch_size each
+    TEST_ASSERT_TRUE(batches < CAPACITY / 4);
+    printf("rg_mqtt: %d samples drained in %d batches of up to %u bytes\n", CAPACITY, batches,
+           (unsigned)sizeof(buf));
+}
+
+TEST_CASE("rg_mqtt resends the batch in flight after a disconnect", "[rg_mqtt]")
+{
+    rg_mqtt_publisher_t pub;
+    rg_mqtt_publisher_init(&pub, s_storage, CAPACITY, 2, 60, RG_MQTT_FORMAT_CBOR, TOPIC_LEN);
+    rg_mqtt_publisher_set_connected(&pub, true);
+    push(&pub, 1000, 2100, 4500, 10130);
+    push(&pub, 1010, 2110, 4500, 10130);
+
+    uint8_t first[64];
+    uint8_t again[64];
+    size_t len = rg_mqtt_publisher_next(&pub, 1010, "a", first, sizeof(first));
+    TEST_ASSERT_TRUE(len > 0);
+    rg_mqtt_publisher_set_connected(&pub, false);
+    TEST_ASSERT_EQUAL_UINT32(0, pub.in_flight);
+    TEST_ASSERT_EQUAL_UINT32(2, pub.count);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.stats.resent);
+
+    rg_mqtt_publisher_set_connected(&pub, true);
+    TEST_ASSERT_EQUAL_UINT32(len, rg_mqtt_publisher_next(&pub, 1010, "a", again, sizeof(again)));
+    TEST_ASSERT_EQUAL_MEMORY(first, again, len);
+
+    // A publish the client refused is built again too
+    rg_mqtt_publisher_failed(&pub);
+    TEST_ASSERT_EQUAL_UINT32(len, rg_mqtt_publisher_next(&pub, 1010, "a", again, sizeof(again)));
+    rg_mqtt_publisher_acked(&pub);
+    TEST_ASSERT_EQUAL_UINT32(0, pub.count);
+    TEST_ASSERT_EQUAL_UINT32(1, pub.stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(len, pub.stats.payload_bytes);
+    TEST_ASSERT_EQUAL_UINT32(rg_mqtt_publish_wire_bytes(TOPIC_LEN, len, 1), pub.stats.wire_bytes);
+}
+
+TEST_CASE("rg_mqtt counts PUBLISH and PUBACK bytes", "[rg_mqtt]")
+{
+    // Fixed header, one length byte, topic length, topic, packet id, payload; PUBACK is 4
+    TEST_ASSERT_EQUAL_UINT32(1 + 1 + 2 + 22 + 2 + 50 + 4, rg_mqtt_publish_wire_bytes(22, 50, 1));
+    TEST_ASSERT_EQUAL_UINT32(1 + 1 + 2 + 22 + 50, rg_mqtt_publish_wire_bytes(22, 50, 0));
+    // The remaining length takes a second byte from 128 on
+    TEST_ASSERT_EQUAL_UINT32(1 + 2 + 2 + 22 + 2 + 200 + 4, rg_mqtt_publish_wire_bytes(22, 200, 1));
+}
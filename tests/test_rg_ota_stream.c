@@ -0,0 +1,262 @@
+#include "unity.h"
+#include "services/ota/rg_heatshrink.h"
+#include "services/ota/rg_ota_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A small app image and the same image packed by host/ota_pack.py (window 8, lookahead 4)
+static const uint8_t s_fixture_image[] = {
+    0xe9, 0x52, 0x6f, 0x6f, 0x6d, 0x47, 0x75, 0x61, 0x72, 0x64, 0x69, 0x61,
+    0x6e, 0x20, 0x6f, 0x74, 0x61, 0x20, 0x66, 0x69, 0x78, 0x74, 0x75, 0x72,
+    0x65, 0x3a, 0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14,
+    0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61,
+    0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x65, 0x6e, 0x64,
+};
+
+static const uint8_t s_fixture_packed[] = {
+    0x52, 0x47, 0x5a, 0x31, 0x08, 0x04, 0x00, 0x00, 0xae, 0x00, 0x00, 0x00,
+    0x58, 0x00, 0x00, 0x00, 0x44, 0xd0, 0x95, 0x29, 0xf4, 0xd4, 0xad, 0xf6,
+    0xfb, 0x6d, 0x1e, 0xeb, 0x61, 0xb9, 0x59, 0x2d, 0x36, 0x1b, 0x74, 0x82,
+    0xdf, 0x74, 0xb0, 0xc8, 0x2c, 0xd6, 0x9b, 0xc5, 0xd2, 0xeb, 0x72, 0xb2,
+    0xce, 0xa4, 0x10, 0x08, 0x0c, 0x0a, 0x07, 0x04, 0x82, 0xc1, 0xa0, 0xf0,
+    0x88, 0x4c, 0x2a, 0x17, 0x0c, 0x86, 0xc3, 0xa1, 0xf1, 0x08, 0x8c, 0x4a,
+    0x27, 0x14, 0x8a, 0xc5, 0xa2, 0xf1, 0x88, 0xcc, 0x6a, 0x37, 0x1c, 0x8e,
+    0xc7, 0xa3, 0xf6, 0x1b, 0x15, 0x8c, 0x05, 0xe0, 0x2f, 0x01, 0x78, 0x0b,
+    0xc0, 0x49, 0x00, 0x00, 0x78, 0x03, 0xc0, 0x0d, 0x65, 0xb7, 0x59, 0x00,
+};
+
+// What the sink received, as the OTA partition would
+#define IMAGE_MAX 40000
+static uint8_t s_written[IMAGE_MAX];
+static size_t s_written_len;
+static size_t s_chunks;
+static size_t s_largest_chunk;
+static esp_err_t s_sink_result;
+
+static esp_err_t capture_sink(void *ctx, const uint8_t *data, size_t len)
+{
+    (void)ctx;
+    if (s_sink_result != ESP_OK) {
+        return s_sink_result;
+    }
+    if (s_written_len + len > IMAGE_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(s_written + s_written_len, data, len);
+    s_written_len += len;
+    s_chunks++;
+    s_largest_chunk = len > s_largest_chunk ? len : s_largest_chunk;
+    return ESP_OK;
+}
+
+static rg_ota_stream_t s_stream;
+
+static void reset_sink(void)
+{
+    s_written_len = s_chunks = s_largest_chunk = 0;
+    s_sink_result = ESP_OK;
+    rg_ota_stream_init(&s_stream, capture_sink, NULL);
+}
+
+// Feeds @p data in pieces of @p piece bytes, as network reads would deliver it
+static esp_err_t feed_all(const uint8_t *data, size_t len, size_t piece)
+{
+    for (size_t pos = 0; pos < len; pos += piece) {
+        size_t n = len - pos < piece ? len - pos : piece;
+        esp_err_t err = rg_ota_stream_feed(&s_stream, data + pos, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return rg_ota_stream_finish(&s_stream);
+}
+
+// Greedy LZSS in the heatshrink format, to round-trip images of any size; 0 if @p out is too small
+static size_t pack(const uint8_t *in, size_t len, uint8_t window_bits, uint8_t lookahead_bits, uint8_t *out,
+                   size_t size)
+{
+    const size_t window = (size_t)1 << window_bits;
+    const size_t max_len = (size_t)1 << lookahead_bits;
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t n = RG_OTA_HEADER_SIZE;
+
+#define PUT(value, count)                                                                                    \
+    do {                                                                                                     \
+        acc = (acc << (count)) | (uint32_t)(value);                                                          \
+        bits += (count);                                                                                     \
+        while (bits >= 8) {                                                                                  \
+            bits -= 8;                                                                                       \
+            if (n == size) {                                                                                 \
+                return 0;                                                                                    \
+            }                                                                                                \
+            out[n++] = (uint8_t)(acc >> bits);                                                               \
+        }                                                                                                    \
+    } while (0)
+
+    for (size_t i = 0; i < len;) {
+        size_t best_len = 0, best_dist = 0;
+        for (size_t dist = 1; dist <= window && dist <= i; dist++) {
+            size_t l = 0;
+            while (l < max_len && i + l < len && in[i - dist + l] == in[i + l]) {
+                l++;
+            }
+            if (l > best_len) {
+                best_len = l;
+                best_dist = dist;
+            }
+        }
+        if (best_len >= 3) {
+            PUT(0, 1);
+            PUT(best_dist - 1, window_bits);
+            PUT(best_len - 1, lookahead_bits);
+            i += best_len;
+        } else {
+            PUT(0x100 | in[i], 9);
+            i++;
+        }
+    }
+    if (bits > 0) {
+        if (n == size) {
+            return 0;
+        }
+        out[n++] = (uint8_t)(acc << (8 - bits));
+    }
+#undef PUT
+
+    const uint32_t payload = (uint32_t)(n - RG_OTA_HEADER_SIZE);
+    const uint32_t crc = rg_ota_crc32(0, in, len);
+    const uint8_t header[RG_OTA_HEADER_SIZE] = {
+        'R', 'G', 'Z', '1', window_bits, lookahead_bits, 0, 0,
+        (uint8_t)len, (uint8_t)(len >> 8), (uint8_t)(len >> 16), (uint8_t)(len >> 24),
+        (uint8_t)payload, (uint8_t)(payload >> 8), (uint8_t)(payload >> 16), (uint8_t)(payload >> 24),
+        (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24),
+    };
+    memcpy(out, header, sizeof(header));
+    return n;
+}
+
+// Looks like firmware: code-like runs, tables, strings and padding
+static void make_image(uint8_t *image, size_t len)
+{
+    uint32_t x = 12345;
+    for (size_t i = 0; i < len; i++) {
+        x = x * 1103515245u + 12345u;
+        size_t region = (i / 1024) % 4;
+        image[i] = region == 0   ? (uint8_t)(x >> 24)
+                   : region == 1 ? (uint8_t)("sensor_task started; temperature=%.2f "[i % 38])
+                   : region == 2 ? (uint8_t)((i % 16) < 4 ? 0x13 : (x >> 28))
+                                 : 0xFF;
+    }
+    image[0] = 0xE9;
+}
+
+TEST_CASE("rg_ota_crc32 matches the IEEE check value", "[rg_ota]")
+{
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926, rg_ota_crc32(0, (const uint8_t *)"123456789", 9));
+    // Continuing from a previous value is the same as one pass
+    uint32_t crc = rg_ota_crc32(0, (const uint8_t *)"1234", 4);
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926, rg_ota_crc32(crc, (const uint8_t *)"56789", 5));
+}
+
+TEST_CASE("rg_ota_stream unpacks an image from ota_pack.py in pieces of any size", "[rg_ota]")
+{
+    static const size_t pieces[] = {1, 7, 64, sizeof(s_fixture_packed)};
+    for (size_t p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++) {
+        reset_sink();
+        TEST_ASSERT_EQUAL(ESP_OK, feed_all(s_fixture_packed, sizeof(s_fixture_packed), pieces[p]));
+        TEST_ASSERT_EQUAL(RG_OTA_STREAM_COMPRESSED, s_stream.mode);
+        TEST_ASSERT_EQUAL_UINT32(sizeof(s_fixture_image), s_written_len);
+        TEST_ASSERT_EQUAL_MEMORY(s_fixture_image, s_written, sizeof(s_fixture_image));
+        TEST_ASSERT_EQUAL_UINT32(sizeof(s_fixture_packed), s_stream.bytes_in);
+    }
+}
+
+TEST_CASE("rg_ota_stream round-trips large images in sector chunks", "[rg_ota]")
+{
+    static uint8_t image[IMAGE_MAX - 1000];
+    static uint8_t packed[IMAGE_MAX];
+    make_image(image, sizeof(image));
+    static const uint8_t params[][2] = {{8, 4}, {11, 4}, {12, 5}};
+    for (size_t p = 0; p < sizeof(params) / sizeof(params[0]); p++) {
+        size_t packed_len = pack(image, sizeof(image), params[p][0], params[p][1], packed, sizeof(packed));
+        TEST_ASSERT_NOT_EQUAL(0, packed_len);
+        reset_sink();
+        TEST_ASSERT_EQUAL(ESP_OK, feed_all(packed, packed_len, 1460));
+        TEST_ASSERT_EQUAL_UINT32(sizeof(image), s_written_len);
+        TEST_ASSERT_EQUAL_MEMORY(image, s_written, sizeof(image));
+        // Flash-sized writes only, the last one excepted
+        TEST_ASSERT_EQUAL_UINT32(RG_OTA_CHUNK_SIZE, s_largest_chunk);
+        TEST_ASSERT_EQUAL_UINT32((sizeof(image) + RG_OTA_CHUNK_SIZE - 1) / RG_OTA_CHUNK_SIZE, s_chunks);
+        printf("rg_ota: window %u lookahead %u: %u -> %u bytes\n", params[p][0], params[p][1],
+               (unsigned)sizeof(image), (unsigned)packed_len);
+        TEST_ASSERT_TRUE(packed_len < sizeof(image) * 3 / 4);
+    }
+}
+
+TEST_CASE("rg_ota_stream passes a plain app image through", "[rg_ota]")
+{
+    static uint8_t image[10000];
+    make_image(image, sizeof(image));
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_OK, feed_all(image, sizeof(image), 999));
+    TEST_ASSERT_EQUAL(RG_OTA_STREAM_RAW, s_stream.mode);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(image), s_written_len);
+    TEST_ASSERT_EQUAL_MEMORY(image, s_written, sizeof(image));
+    TEST_ASSERT_EQUAL_UINT32(3, s_chunks);
+}
+
+TEST_CASE("rg_ota_stream rejects corrupt, short, long and foreign downloads", "[rg_ota]")
+{
+    uint8_t buf[sizeof(s_fixture_packed) + 4];
+
+    // A flipped bit in the payload decodes to a different image
+    memcpy(buf, s_fixture_packed, sizeof(s_fixture_packed));
+    buf[40] ^= 0x10;
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, feed_all(buf, sizeof(s_fixture_packed), 16));
+
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, feed_all(s_fixture_packed, sizeof(s_fixture_packed) - 10, 16));
+
+    memcpy(buf + sizeof(s_fixture_packed), "junk", 4);
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, feed_all(buf, sizeof(buf), 16));
+
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, feed_all((const uint8_t *)"<html>404</html>", 16, 16));
+    // A failed stream stays failed
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, rg_ota_stream_feed(&s_stream, s_fixture_packed, 4));
+
+    // A window larger than the node's buffer
+    memcpy(buf, s_fixture_packed, sizeof(s_fixture_packed));
+    buf[4] = RG_OTA_MAX_WINDOW_BITS + 1;
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, feed_all(buf, sizeof(s_fixture_packed), 64));
+
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rg_ota_stream_finish(&s_stream));
+}
+
+TEST_CASE("rg_ota_stream stops at the first flash write error", "[rg_ota]")
+{
+    static uint8_t image[3 * RG_OTA_CHUNK_SIZE];
+    make_image(image, sizeof(image));
+    reset_sink();
+    TEST_ASSERT_EQUAL(ESP_OK, rg_ota_stream_feed(&s_stream, image, RG_OTA_CHUNK_SIZE + 100));
+    s_sink_result = ESP_FAIL;
+    TEST_ASSERT_EQUAL(ESP_FAIL, rg_ota_stream_feed(&s_stream, image + RG_OTA_CHUNK_SIZE + 100, RG_OTA_CHUNK_SIZE));
+    TEST_ASSERT_EQUAL(RG_OTA_STREAM_FAILED, s_stream.mode);
+    TEST_ASSERT_EQUAL_UINT32(1, s_chunks);
+}
@@ -0,0 +1,237 @@
+#include "unity.h"
+#include "services/rules/rg_rules.h"
+
+#include <string.h>
+
+#define MAX_RULES 8
+
+typedef struct {
+    int changes;
+    int index;
+    bool active;
+    int32_t value;
+} change_log_t;
+
+static void log_change(void *ctx, int index, const rg_rule_t *rule, bool active, int32_t value)
+{
+    (void)rule;
+    change_log_t *log = (change_log_t *)ctx;
+    log->changes++;
+    log->index = index;
+    log->active = active;
+    log->value = value;
+}
+
+static rg_rule_t s_rules[MAX_RULES];
+static rg_rule_state_t s_states[MAX_RULES];
+
+static void load(rg_rules_t *engine, const char *text, change_log_t *log)
+{
+    size_t count = 0;
+    rg_rules_error_t error;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_rules_compile(text, s_rules, MAX_RULES, &count, &error));
+    memset(log, 0, sizeof(*log));
+    rg_rules_init(engine, s_rules, s_states, count, 60000, log_change, log);
+}
+
+static int evaluate(rg_rules_t *engine, uint32_t now_ms, int32_t temperature, int32_t humidity)
+{
+    const int32_t values[RG_RULES_CHANNEL_COUNT] = {temperature, humidity, 101325};
+    return rg_rules_evaluate(engine, now_ms, values);
+}
+
+TEST_CASE("rg_rules compiles rule text into the predicate table", "[rg_rules]")
+{
+    size_t count = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_rules_compile("", s_rules, MAX_RULES, &count, NULL));
+    TEST_ASSERT_EQUAL(0, (int)count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_rules_compile(" damp: humidity > 70 hyst 5 for 2m -> gpio 4 ;"
+                                               "heating:temperature rate>1.25 for 90;"
+                                               "storm: pressure rate < -1.5 hyst 0.5 -> gpio 12 low",
+                                               s_rules, MAX_RULES, &count, NULL));
+    TEST_ASSERT_EQUAL(3, (int)count);
+
+    TEST_ASSERT_EQUAL_STRING("damp", s_rules[0].name);
+    TEST_ASSERT_EQUAL(RG_RULES_HUMIDITY, s_rules[0].channel);
+    TEST_ASSERT_EQUAL(0, s_rules[0].flags);
+    TEST_ASSERT_EQUAL_INT32(7000, s_rules[0].trip);
+    TEST_ASSERT_EQUAL_INT32(6500, s_rules[0].clear);
+    TEST_ASSERT_EQUAL_UINT32(120000, s_rules[0].hold_ms);
+    TEST_ASSERT_EQUAL(4, s_rules[0].gpio);
+
+    TEST_ASSERT_EQUAL(RG_RULES_TEMPERATURE, s_rules[1].channel);
+    TEST_ASSERT_EQUAL(RG_RULE_RATE, s_rules[1].flags);
+    TEST_ASSERT_EQUAL_INT32(125, s_rules[1].trip);
+    TEST_ASSERT_EQUAL_INT32(125, s_rules[1].clear);
+    TEST_ASSERT_EQUAL_UINT32(90000, s_rules[1].hold_ms);
+    TEST_ASSERT_EQUAL(RG_RULES_NO_GPIO, s_rules[1].gpio);
+
+    TEST_ASSERT_EQUAL(RG_RULE_RATE | RG_RULE_BELOW | RG_RULE_ACTIVE_LOW, s_rules[2].flags);
+    TEST_ASSERT_EQUAL_INT32(-150, s_rules[2].trip);
+    TEST_ASSERT_EQUAL_INT32(-100, s_rules[2].clear);
+    TEST_ASSERT_EQUAL(12, s_rules[2].gpio);
+}
+
+TEST_CASE("rg_rules reports where a rule fails to compile", "[rg_rules]")
+{
+    static const struct {
+        const char *text;
+        int rule;
+        size_t offset;
+    } cases[] = {
+        {"hot temperature > 30", 0, 4},                       // Missing ':'
+        {"hot: dew > 30", 0, 5},                              // Unknown channel
+        {"hot: temperature = 30", 0, 17},                     // Operator
+        {"hot: temperature > warm", 0, 19},                   // Threshold
+        {"hot: temperature > 30 hyst -1", 0, 27},             // Negative hysteresis
+        {"hot: temperature > 30 for 2d", 0, 26},              // Duration unit
+        {"hot: temperature > 30 for 25h", 0, 26},             // Longer than a day
+        {"ok: humidity > 1; hot: temperature > 30 -> led 4", 1, 43}, // Action
+        {"hot: temperature > 30 -> gpio 64", 0, 30},          // Pin
+        {"hot: temperature > 30 now", 0, 22},                 // Trailing words
+        {"hot: temperature > 30; hot: humidity > 70", 1, 23}, // Duplicate name
+        {"a_name_far_too_long: temperature > 30", 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t count = 0;
+        rg_rules_error_t error;
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_rules_compile(cases[i].text, s_rules, MAX_RULES, &count, &error));
+        TEST_ASSERT_EQUAL(cases[i].rule, error.rule);
+        TEST_ASSERT_EQUAL((int)cases[i].offset, (int)error.offset);
+        TEST_ASSERT_NOT_NULL(error.message);
+    }
+
+    size_t count = 0;
+    rg_rules_error_t error;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rg_rules_compile("a: humidity > 1; b: humidity > 2", s_rules, 1, &count, &error));
+    TEST_ASSERT_EQUAL(1, error.rule);
+}
+
+TEST_CASE("rg_rules trips only after the condition held for the duration", "[rg_rules]")
+{
+    rg_rules_t engine;
+    change_log_t log;
+    load(&engine, "damp: humidity > 70 hyst 5 for 2m", &log);
+
+    // Above the threshold, but interrupted before two minutes: the hold restarts
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 0, 2000, 7100));
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 100000, 2000, 7100));
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 110000, 2000, 7000)); // At the threshold is not above it
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 120000, 2000, 7100));
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 239999, 2000, 7200));
+    rg_rule_state_t state;
+    rg_rules_state(&engine, 0, &state);
+    TEST_ASSERT_EQUAL(1, state.pending);
+    TEST_ASSERT_EQUAL(0, state.active);
+
+    // Exactly two minutes after it started to hold
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, 240000, 2000, 7150));
+    TEST_ASSERT_EQUAL(1, log.changes);
+    TEST_ASSERT_TRUE(log.active);
+    TEST_ASSERT_EQUAL_INT32(7150, log.value);
+    rg_rules_state(&engine, 0, &state);
+    TEST_ASSERT_EQUAL(1, state.active);
+    TEST_ASSERT_EQUAL(0, state.pending);
+    TEST_ASSERT_EQUAL_UINT32(1, state.trips);
+
+    // Inside the hysteresis band it stays tripped; below 65 it clears at once
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 250000, 2000, 6600));
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 260000, 2000, 7500));
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, 270000, 2000, 6500));
+    TEST_ASSERT_EQUAL(2, log.changes);
+    TEST_ASSERT_FALSE(log.active);
+
+    // Tripping again takes another full hold
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 280000, 2000, 7100));
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 399000, 2000, 7100));
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, 400000, 2000, 7100));
+    rg_rules_state(&engine, 0, &state);
+    TEST_ASSERT_EQUAL_UINT32(2, state.trips);
+}
+
+TEST_CASE("rg_rules trips without a duration on the first reading past the threshold", "[rg_rules]")
+{
+    rg_rules_t engine;
+    change_log_t log;
+    load(&engine, "ok: humidity > 90; cold: temperature < 15 hyst 0.5", &log);
+
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 0, 1500, 5000));
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, 1000, 1499, 5000));
+    TEST_ASSERT_EQUAL(1, log.index);
+    TEST_ASSERT_TRUE(log.active);
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, 2000, 1549, 5000));
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, 3000, 1550, 5000));
+    TEST_ASSERT_FALSE(log.active);
+}
+
+TEST_CASE("rg_rules measures rates over the rate window", "[rg_rules]")
+{
+    rg_rules_t engine;
+    change_log_t log;
+    load(&engine, "heating: temperature rate > 1 hyst 0.5 for 30s", &log);
+
+    // 1.2 degC per minute, one reading every 5 s
+    uint32_t t = 0;
+    int32_t rate;
+    for (; t < 60000; t += 5000) {
+        TEST_ASSERT_EQUAL(0, evaluate(&engine, t, 2000 + (int32_t)(t / 500), 5000));
+        TEST_ASSERT_FALSE(rg_rules_rate(&engine, RG_RULES_TEMPERATURE, &rate)); // Less than a window of history
+    }
+    TEST_ASSERT_EQUAL(0, evaluate(&engine, t, 2000 + (int32_t)(t / 500), 5000));
+    TEST_ASSERT_TRUE(rg_rules_rate(&engine, RG_RULES_TEMPERATURE, &rate));
+    TEST_ASSERT_EQUAL_INT32(120, rate);
+    TEST_ASSERT_FALSE(rg_rules_rate(&engine, RG_RULES_HUMIDITY, &rate)); // No rule needs it
+
+    // Holds from t = 60 s, so trips at 90 s
+    for (t += 5000; t < 90000; t += 5000) {
+        TEST_ASSERT_EQUAL(0, evaluate(&engine, t, 2000 + (int32_t)(t / 500), 5000));
+    }
+    TEST_ASSERT_EQUAL(1, evaluate(&engine, t, 2000 + (int32_t)(t / 500), 5000));
+    TEST_ASSERT_TRUE(log.active);
+    TEST_ASSERT_EQUAL_INT32(120, log.value);
+
+    // Levels off: the rate decays over the next window and clears below 0.5 per minute
+    const int32_t plateau = 2000 + (int32_t)(t / 500);
+    uint32_t cleared_at = 0;
+    for (t += 5000; t <= 200000 && !cleared_at; t += 5000) {
+        if (evaluate(&engine, t, plateau, 5000)) {
+            cleared_at = t;
+        }
+    }
+    TEST_ASSERT_FALSE(log.active);
+    TEST_ASSERT_TRUE(log.value <= 50);
+    // The rate window looks back 60 to 70 s, so it has to clear within that
+    TEST_ASSERT_TRUE(cleared_at > 90000 && cleared_at <= 90000 + 70000);
+}
+
+TEST_CASE("rg_rules rate anchors survive gaps and clock wrap", "[rg_rules]")
+{
+    rg_rules_t engine;
+    change_log_t log;
+    load(&engine, "falling: pressure rate < -1", &log);
+
+    // Start just before the millisecond clock wraps
+    uint32_t t = UINT32_MAX - 30000;
+    int32_t pressure = 101325;
+    const int32_t values0[RG_RULES_CHANNEL_COUNT] = {2000, 5000, pressure};
+    TEST_ASSERT_EQUAL(0, rg_rules_evaluate(&engine, t, values0));
+    for (int i = 0; i < 30; i++) {
+        t += 10000;
+        pressure -= 50; // -3 hPa per minute
+        const int32_t values[RG_RULES_CHANNEL_COUNT] = {2000, 5000, pressure};
+        rg_rules_evaluate(&engine, t, values);
+    }
+    TEST_ASSERT_TRUE(log.active);
+    int32_t rate;
+    TEST_ASSERT_TRUE(rg_rules_rate(&engine, RG_RULES_PRESSURE, &rate));
+    TEST_ASSERT_EQUAL_INT32(-300, rate);
+
+    // Ten minutes without a reading, then flat: the rate spans the gap and clears
+    t += 600000;
+    const int32_t values[RG_RULES_CHANNEL_COUNT] = {2000, 5000, pressure};
+    rg_rules_evaluate(&engine, t, values);
+    TEST_ASSERT_TRUE(rg_rules_rate(&engine, RG_RULES_PRESSURE, &rate));
+    TEST_ASSERT_TRUE(rate > -100);
+    TEST_ASSERT_FALSE(log.active);
+}
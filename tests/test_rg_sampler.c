@@ -0,0 +1,269 @@
+#include "unity.h"
+#include "services/sampler/rg_sampler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static rg_sampler_config_t test_config(void)
+{
+    rg_sampler_config_t config = {
+        .deadband = {0.1f, 0.5f, 0.2f},
+        .min_interval_ms = 2000,
+        .max_interval_ms = 30000,
+        .heartbeat_ms = 300000,
+    };
+    return config;
+}
+
+TEST_CASE("rg_sampler publishes the first sample and then only changes", "[rg_sampler]")
+{
+    rg_sampler_config_t config = test_config();
+    rg_sampler_t s;
+    rg_sampler_init(&s, &config);
+
+    float v[RG_SAMPLER_CHANNEL_COUNT] = {21.0f, 45.0f, 1013.0f};
+    TEST_ASSERT_EQUAL_UINT32(RG_SAMPLER_CHANGED(0) | RG_SAMPLER_CHANGED(1) | RG_SAMPLER_CHANGED(2),
+                             rg_sampler_update(&s, 0, v));
+
+    v[RG_SAMPLER_TEMPERATURE] = 21.05f;
+    TEST_ASSERT_EQUAL_UINT32(0, rg_sampler_update(&s, 2000, v));
+    v[RG_SAMPLER_TEMPERATURE] = 21.12f;
+    TEST_ASSERT_EQUAL_UINT32(RG_SAMPLER_CHANGED(RG_SAMPLER_TEMPERATURE), rg_sampler_update(&s, 4000, v));
+    // Deadband is measured from the last published value, not the last sample
+    v[RG_SAMPLER_TEMPERATURE] = 21.17f;
+    TEST_ASSERT_EQUAL_UINT32(0, rg_sampler_update(&s, 6000, v));
+}
+
+TEST_CASE("rg_sampler backs off while stable and snaps back on movement", "[rg_sampler]")
+{
+    rg_sampler_config_t config = test_config();
+    rg_sampler_t s;
+    rg_sampler_init(&s, &config);
+
+    float v[RG_SAMPLER_CHANNEL_COUNT] = {21.0f, 45.0f, 1013.0f};
+    uint32_t now = 0;
+    rg_sampler_update(&s, now, v);
+    TEST_ASSERT_EQUAL_UINT32(2000, rg_sampler_next_interval_ms(&s));
+
+    const uint32_t expected[] = {4000, 8000, 16000, 30000, 30000};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        now += rg_sampler_next_interval_ms(&s);
+        rg_sampler_update(&s, now, v);
+        TEST_ASSERT_EQUAL_UINT32(expected[i], rg_sampler_next_interval_ms(&s));
+    }
+
+    // A step of half the deadband on one channel is enough to speed up
+    v[RG_SAMPLER_HUMIDITY] += 0.3f;
+    now += rg_sampler_next_interval_ms(&s);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_sampler_update(&s, now, v));
+    TEST_ASSERT_EQUAL_UINT32(2000, rg_sampler_next_interval_ms(&s));
+}
+
+TEST_CASE("rg_sampler heartbeat publishes an unchanged sample", "[rg_sampler]")
+{
+    rg_sampler_config_t config = test_config();
+    rg_sampler_t s;
+    rg_sampler_init(&s, &config);
+
+    float v[RG_SAMPLER_CHANNEL_COUNT] = {21.0f, 45.0f, 1013.0f};
+    rg_sampler_update(&s, 1000, v);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_sampler_update(&s, 1000 + 299999, v));
+    TEST_ASSERT_EQUAL_UINT32(RG_SAMPLER_HEARTBEAT, rg_sampler_update(&s, 1000 + 300000, v));
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats.heartbeats);
+    TEST_ASSERT_EQUAL_UINT32(2, s.stats.publishes);
+}
+
+TEST_CASE("rg_sampler reconfigure keeps the published state and clamps intervals", "[rg_sampler]")
+{
+    rg_sampler_config_t config = test_config();
+    rg_sampler_t s;
+    rg_sampler_init(&s, &config);
+
+    float v[RG_SAMPLER_CHANNEL_COUNT] = {21.0f, 45.0f, 1013.0f};
+    uint32_t now = 0;
+    rg_sampler_update(&s, now, v);
+    for (int i = 0; i < 5; i++) {
+        now += rg_sampler_next_interval_ms(&s);
+        rg_sampler_update(&s, now, v);
+    }
+    TEST_ASSERT_EQUAL_UINT32(30000, rg_sampler_next_interval_ms(&s));
+
+    // A shorter maximum takes effect at once; nothing is published again
+    config.max_interval_ms = 10000;
+    config.deadband[RG_SAMPLER_TEMPERATURE] = 0.02f;
+    rg_sampler_reconfigure(&s, &config);
+    TEST_ASSERT_EQUAL_UINT32(10000, rg_sampler_next_interval_ms(&s));
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats.publishes);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_sampler_update(&s, now += 10000, v));
+
+    // The tighter deadband is measured from the value published before the change
+    v[RG_SAMPLER_TEMPERATURE] = 21.03f;
+    TEST_ASSERT_EQUAL_UINT32(RG_SAMPLER_CHANGED(RG_SAMPLER_TEMPERATURE), rg_sampler_update(&s, now += 10000, v));
+
+    // A longer minimum raises the intervals below it
+    config.min_interval_ms = 5000;
+    rg_sampler_reconfigure(&s, &config);
+    TEST_ASSERT_EQUAL_UINT32(5000, rg_sampler_next_interval_ms(&s));
+}
+
+// --- Trace-driven simulation ---
+//
+// The traces replay typical room recordings at 1 s resolution: a quiet night,
+// a window opened for half an hour and a shower next door. Sensor noise is
+// added with a fixed-seed generator so every run sees the same samples.
+
+#define SIM_DURATION_S (4 * 3600)
+
+typedef enum {
+    TRACE_STEADY = 0,
+    TRACE_WINDOW,
+    TRACE_SHOWER,
+    TRACE_COUNT,
+} trace_t;
+
+static const char *const s_trace_names[TRACE_COUNT] = {"steady", "window", "shower"};
+
+// Onset of the event in each trace and the channel it shows up on
+static const uint32_t s_event_s[TRACE_COUNT] = {0, 3600, 7200};
+static const rg_sampler_channel_t s_event_channel[TRACE_COUNT] = {
+    RG_SAMPLER_TEMPERATURE, RG_SAMPLER_TEMPERATURE, RG_SAMPLER_HUMIDITY};
+
+static uint32_t s_noise_state;
+
+// Roughly uniform noise in [-amplitude, amplitude]
+static float noise(float amplitude)
+{
+    s_noise_state = s_noise_state * 1664525u + 1013904223u;
+    return amplitude * ((float)(s_noise_state >> 8) / (float)(1u << 23) - 1.0f);
+}
+
+static float approach(float from, float to, float elapsed_s, float tau_s)
+{
+    return to + (from - to) * expf(-elapsed_s / tau_s);
+}
+
+static void trace_truth(trace_t trace, uint32_t t, float out[RG_SAMPLER_CHANNEL_COUNT])
+{
+    // Slow overnight drift shared by all traces
+    out[RG_SAMPLER_TEMPERATURE] = 21.0f - 0.3f * t / SIM_DURATION_S;
+    out[RG_SAMPLER_HUMIDITY] = 45.0f + 1.0f * t / SIM_DURATION_S;
+    out[RG_SAMPLER_PRESSURE] = 1013.0f - 0.8f * t / SIM_DURATION_S;
+
+    uint32_t t0 = s_event_s[trace];
+    if (trace == TRACE_WINDOW && t >= t0) {
+        // Open for 30 minutes, then the room slowly warms up again
+        const uint32_t open_s = 1800;
+        float dt = t < t0 + open_s ? approach(0.0f, -3.0f, t - t0, 300.0f)
+                                   : approach(approach(0.0f, -3.0f, open_s, 300.0f), 0.0f, t - t0 - open_s, 900.0f);
+        out[RG_SAMPLER_TEMPERATURE] += dt;
+        out[RG_SAMPLER_HUMIDITY] += dt * 3.0f;
+    } else if (trace == TRACE_SHOWER && t >= t0) {
+        // Humidity jumps within a minute and decays over ~15 minutes
+        float rise = 1.0f - expf(-(float)(t - t0) / 60.0f);
+        out[RG_SAMPLER_HUMIDITY] += 25.0f * rise * expf(-(float)(t - t0) / 900.0f);
+        out[RG_SAMPLER_TEMPERATURE] += 0.8f * rise * expf(-(float)(t - t0) / 1200.0f);
+    }
+}
+
+typedef struct {
+    uint32_t samples;
+    uint32_t publishes;
+    uint32_t detect_latency_s; // Event onset to first publish that shows it
+    float max_error;           // Worst |published - truth| on the event channel once detected
+} sim_result_t;
+
+// fixed_interval_ms == 0 runs the adaptive sampler; otherwise every sample is
+// published at a fixed rate like the original task did.
+static sim_result_t simulate(trace_t trace, const rg_sampler_config_t *config, uint32_t fixed_interval_ms)
+{
+    sim_result_t r = {0};
+    r.detect_latency_s = UINT32_MAX;
+    s_noise_state = 12345u + trace;
+
+    rg_sampler_t s;
+    rg_sampler_init(&s, config);
+
+    const rg_sampler_channel_t ch = s_event_channel[trace];
+    const uint32_t t0 = s_event_s[trace];
+    float baseline[RG_SAMPLER_CHANNEL_COUNT];
+    trace_truth(trace, t0, baseline);
+
+    float published = 0;
+    uint64_t next_ms = 0;
+    for (uint32_t t = 0; t < SIM_DURATION_S; t++) {
+        float truth[RG_SAMPLER_CHANNEL_COUNT];
+        trace_truth(trace, t, truth);
+
+        if ((uint64_t)t * 1000 >= next_ms) {
+            float sample[RG_SAMPLER_CHANNEL_COUNT];
+            sample[RG_SAMPLER_TEMPERATURE] = truth[RG_SAMPLER_TEMPERATURE] + noise(0.02f);
+            sample[RG_SAMPLER_HUMIDITY] = truth[RG_SAMPLER_HUMIDITY] + noise(0.1f);
+            sample[RG_SAMPLER_PRESSURE] = truth[RG_SAMPLER_PRESSURE] + noise(0.03f);
+            r.samples++;
+
+            bool publish;
+            if (fixed_interval_ms) {
+                publish = true;
+                next_ms += fixed_interval_ms;
+            } else {
+                publish = rg_sampler_update(&s, t * 1000, sample) != 0;
+                next_ms += rg_sampler_next_interval_ms(&s);
+            }
+            if (publish) {
+                r.publishes++;
+                published = sample[ch];
+                if (trace != TRACE_STEADY && t >= t0 && r.detect_latency_s == UINT32_MAX &&
+                    fabsf(published - baseline[ch]) >= config->deadband[ch]) {
+                    r.detect_latency_s = t - t0;
+                }
+            }
+        }
+        if (r.detect_latency_s != UINT32_MAX && fabsf(published - truth[ch]) > r.max_error) {
+            r.max_error = fabsf(published - truth[ch]);
+        }
+    }
+    return r;
+}
+
+static void print_result(const char *label, trace_t trace, const sim_result_t *r)
+{
+    printf("rg_sampler: %-6s %-8s %5lu samples %5lu publishes", s_trace_names[trace], label,
+           (unsigned long)r->samples, (unsigned long)r->publishes);
+    if (trace != TRACE_STEADY) {
+        printf(" latency %3lu s tracking error %.2f", (unsigned long)r->detect_latency_s, r->max_error);
+    }
+    printf("\n");
+}
+
+TEST_CASE("rg_sampler trace simulation against the fixed 10 s schedule", "[rg_sampler][bench]")
+{
+    // The Kconfig defaults, and a tighter profile whose slowest interval matches the old fixed period
+    rg_sampler_config_t configs[2] = {test_config(), test_config()};
+    configs[1].min_interval_ms = 1000;
+    configs[1].max_interval_ms = 10000;
+    const char *const labels[2] = {"adaptive", "tight"};
+
+    for (int trace = 0; trace < TRACE_COUNT; trace++) {
+        sim_result_t fixed = simulate((trace_t)trace, &configs[0], 10000);
+        print_result("fixed", (trace_t)trace, &fixed);
+
+        for (int c = 0; c < 2; c++) {
+            sim_result_t adaptive = simulate((trace_t)trace, &configs[c], 0);
+            print_result(labels[c], (trace_t)trace, &adaptive);
+
+            TEST_ASSERT_TRUE(adaptive.publishes * 4 < fixed.publishes);
+            if (trace == TRACE_STEADY) {
+                // The tight profile only saves publishes; the default one also saves reads
+                TEST_ASSERT_TRUE(c == 1 || adaptive.samples * 2 < fixed.samples);
+            } else {
+                // A change is noticed at the next sample, at most one slow interval
+                // after it crosses the deadband. From then on the sampler runs at its
+                // fastest rate, so the published value stays within the deadband of
+                // what a fixed schedule publishing every sample would show.
+                TEST_ASSERT_TRUE(adaptive.detect_latency_s <= fixed.detect_latency_s + configs[c].max_interval_ms / 1000);
+                TEST_ASSERT_TRUE(adaptive.max_error < fixed.max_error + configs[c].deadband[s_event_channel[trace]]);
+            }
+        }
+    }
+}
@@ -0,0 +1,209 @@
+#include "unity.h"
+#include "services/stats/rg_stats.h"
+#include "services/stats/rg_stats_json.h"
+
+#include <math.h>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+struct sample_t {
+    uint32_t t;
+    int32_t x;
+};
+
+// The window by definition: every sample whose slot is one of the last
+// RG_STATS_SLOTS up to and including the newest sample's slot
+static void brute_force(const std::vector<sample_t> &samples, uint32_t slot_s, rg_stats_result_t *out)
+{
+    const uint32_t current = samples.back().t / slot_s;
+    uint32_t count = 0;
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+    double sum = 0;
+    for (const sample_t &s : samples) {
+        if (s.t / slot_s + RG_STATS_SLOTS > current) {
+            count++;
+            min = s.x < min ? s.x : min;
+            max = s.x > max ? s.x : max;
+            sum += s.x;
+        }
+    }
+    const double mean = sum / count;
+    double squares = 0;
+    for (const sample_t &s : samples) {
+        if (s.t / slot_s + RG_STATS_SLOTS > current) {
+            squares += (s.x - mean) * (s.x - mean);
+        }
+    }
+    out->count = count;
+    out->min = min;
+    out->max = max;
+    out->mean = (float)mean;
+    out->stddev = count > 1 ? (float)sqrt(squares / (count - 1)) : 0.0f;
+}
+
+static void check_against_brute_force(uint32_t length_s, uint32_t max_step_s, int32_t ref, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> step(0, max_step_s);
+    std::uniform_int_distribution<int32_t> value(-4000, 4000);
+
+    rg_stats_window_t window;
+    rg_stats_window_init(&window, length_s);
+    std::vector<sample_t> samples;
+    uint32_t t = 1000;
+    for (int i = 0; i < 3000; i++) {
+        t += step(rng);
+        // A slowly drifting signal with noise, like a room over a day
+        const int32_t x = ref + (int32_t)(2000 * sin(i / 300.0)) + value(rng) / 4;
+        samples.push_back({t, x});
+        rg_stats_window_add(&window, t, x - ref);
+
+        rg_stats_result_t expected;
+        rg_stats_result_t actual;
+        brute_force(samples, window.slot_s, &expected);
+        rg_stats_window_result(&window, ref, &actual);
+        TEST_ASSERT_EQUAL_UINT32(length_s, actual.length_s);
+        TEST_ASSERT_EQUAL_UINT32(expected.count, actual.count);
+        TEST_ASSERT_EQUAL_INT32(expected.min, actual.min);
+        TEST_ASSERT_EQUAL_INT32(expected.max, actual.max);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, expected.mean, actual.mean);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f + expected.stddev * 1e-5f, expected.stddev, actual.stddev);
+    }
+}
+
+TEST_CASE("rg_stats window matches a brute-force scan", "[rg_stats]")
+{
+    // Several samples per slot, about one per slot, and gaps of several slots
+    check_against_brute_force(300, 3, 0, 1);
+    check_against_brute_force(300, 12, 2150, 2);
+    check_against_brute_force(3600, 40, -1200, 3);
+    check_against_brute_force(86400, 4000, 101325, 4);
+}
+
+TEST_CASE("rg_stats window empties after a gap longer than itself", "[rg_stats]")
+{
+    rg_stats_window_t window;
+    rg_stats_window_init(&window, 300);
+    TEST_ASSERT_EQUAL_UINT32(5, window.slot_s);
+
+    rg_stats_result_t result;
+    rg_stats_window_result(&window, 0, &result);
+    TEST_ASSERT_EQUAL_UINT32(0, result.count);
+
+    for (uint32_t t = 0; t < 300; t++) {
+        rg_stats_window_add(&window, t, (int32_t)t);
+    }
+    rg_stats_window_result(&window, 0, &result);
+    TEST_ASSERT_EQUAL_UINT32(300, result.count);
+    TEST_ASSERT_EQUAL_INT32(0, result.min);
+    TEST_ASSERT_EQUAL_INT32(299, result.max);
+
+    // One slot on: the oldest slot (t 0..4) has left
+    rg_stats_window_add(&window, 300, 7);
+    rg_stats_window_result(&window, 0, &result);
+    TEST_ASSERT_EQUAL_UINT32(296, result.count);
+    TEST_ASSERT_EQUAL_INT32(5, result.min);
+
+    // Much later: only the new sample is left, whatever the ring held
+    rg_stats_window_add(&window, 5000, -3);
+    rg_stats_window_result(&window, 100, &result);
+    TEST_ASSERT_EQUAL_UINT32(1, result.count);
+    TEST_ASSERT_EQUAL_INT32(97, result.min);
+    TEST_ASSERT_EQUAL_INT32(97, result.max);
+    TEST_ASSERT_EQUAL_FLOAT(97.0f, result.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, result.stddev);
+}
+
+TEST_CASE("rg_stats parses window lists", "[rg_stats]")
+{
+    rg_stats_channel_config_t config;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_parse_windows("300,3600,86400", &config));
+    TEST_ASSERT_EQUAL_UINT32(300, config.windows_s[0]);
+    TEST_ASSERT_EQUAL_UINT32(3600, config.windows_s[1]);
+    TEST_ASSERT_EQUAL_UINT32(86400, config.windows_s[2]);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_parse_windows("600, 7200", &config));
+    TEST_ASSERT_EQUAL_UINT32(600, config.windows_s[0]);
+    TEST_ASSERT_EQUAL_UINT32(7200, config.windows_s[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, config.windows_s[2]);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("", &config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("300,", &config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("300;600", &config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("300,600,900,1200", &config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("1", &config)); // Shorter than the slots
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_stats_parse_windows("5m", &config));
+}
+
+static esp_err_t append_sink(void *ctx, const char *data, size_t len)
+{
+    ((std::string *)ctx)->append(data, len);
+    return ESP_OK;
+}
+
+TEST_CASE("rg_stats publishes every channel and writes /stats JSON", "[rg_stats]")
+{
+    rg_stats_channel_config_t config[RG_STATS_CHANNEL_COUNT];
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_default_config(config));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_parse_windows("3600", &config[RG_STATS_PRESSURE]));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_configure(config));
+
+    rg_stats_snapshot_t snapshot;
+    rg_stats_read(&snapshot);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.samples);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.results[RG_STATS_TEMPERATURE][0].count);
+
+    // Old enough to have left the 5 minute and hour windows, not the day
+    rg_stats_add(10000, 30.0f, 60.0f, 1000.0f);
+    for (uint32_t t = 20000; t < 20010; t++) {
+        rg_stats_add(t, 21.0f + (t % 2) * 0.5f, 40.0f, 1013.25f);
+    }
+    rg_stats_read(&snapshot);
+    TEST_ASSERT_EQUAL_UINT32(11, snapshot.samples);
+    TEST_ASSERT_EQUAL_UINT32(20009, snapshot.timestamp);
+    TEST_ASSERT_EQUAL_UINT8(3, snapshot.window_count[RG_STATS_TEMPERATURE]);
+    TEST_ASSERT_EQUAL_UINT8(1, snapshot.window_count[RG_STATS_PRESSURE]);
+
+    const rg_stats_result_t &five_min = snapshot.results[RG_STATS_TEMPERATURE][0];
+    TEST_ASSERT_EQUAL_UINT32(10, five_min.count);
+    TEST_ASSERT_EQUAL_INT32(2100, five_min.min);
+    TEST_ASSERT_EQUAL_INT32(2150, five_min.max);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2125.0f, five_min.mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 26.352f, five_min.stddev);
+    const rg_stats_result_t &day = snapshot.results[RG_STATS_TEMPERATURE][2];
+    TEST_ASSERT_EQUAL_UINT32(11, day.count);
+    TEST_ASSERT_EQUAL_INT32(3000, day.max);
+    TEST_ASSERT_EQUAL_INT32(101325, snapshot.results[RG_STATS_PRESSURE][0].max);
+
+    char buf[64]; // Smaller than the document: exercises the sink
+    std::string body;
+    rg_json_writer json(buf, sizeof(buf), append_sink, &body);
+    rg_stats_write_json(json, snapshot, 20010);
+    TEST_ASSERT_TRUE(json.flush());
+
+    const nlohmann::json doc = nlohmann::json::parse(body);
+    const std::string dumped = doc.dump();
+    TEST_ASSERT_EQUAL_STRING(dumped.c_str(), body.c_str()); // Sorted keys, nlohmann formatting
+    TEST_ASSERT_EQUAL(20010, doc["now"].get<int>());
+    TEST_ASSERT_EQUAL(11, doc["samples"].get<int>());
+    TEST_ASSERT_EQUAL(3, (int)doc["temperature"].size());
+    TEST_ASSERT_EQUAL(1, (int)doc["pressure"].size());
+    const nlohmann::json &t0 = doc["temperature"][0];
+    TEST_ASSERT_EQUAL(300, t0["window_s"].get<int>());
+    TEST_ASSERT_EQUAL_FLOAT(21.25f, t0["mean"].get<float>());
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, t0["max"].get<float>());
+    TEST_ASSERT_EQUAL_FLOAT(0.264f, t0["stddev"].get<float>());
+    TEST_ASSERT_EQUAL_FLOAT(1013.25f, doc["pressure"][0]["min"].get<float>());
+
+    // A window that has seen nothing yet
+    TEST_ASSERT_EQUAL(ESP_OK, rg_stats_configure(config));
+    rg_stats_read(&snapshot);
+    body.clear();
+    rg_json_writer empty(buf, sizeof(buf), append_sink, &body);
+    rg_stats_write_json(empty, snapshot, 0);
+    TEST_ASSERT_TRUE(empty.flush());
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "{\"count\":0,\"max\":null,\"mean\":null"));
+}
@@ -0,0 +1,184 @@
+#include "unity.h"
+#include "services/log/rg_tlog.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char *TAG = "TEST";
+
+static uint32_t s_buf[256 / sizeof(uint32_t)];
+
+static bool __attribute__((format(printf, 3, 4)))
+ring_write(rg_tlog_ring_t *ring, uint32_t time_ms, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    bool ok = rg_tlog_ring_vwrite(ring, ESP_LOG_INFO, time_ms, TAG, format, args);
+    va_end(args);
+    return ok;
+}
+
+// Oldest record in @p ring as text, or "" if there is none
+static std::string read_text(rg_tlog_ring_t *ring)
+{
+    uint32_t record[RG_TLOG_MAX_RECORD / sizeof(uint32_t)];
+    size_t len = rg_tlog_ring_read(ring, (uint8_t *)record, sizeof(record));
+    if (len == 0) {
+        return "";
+    }
+    rg_tlog_record_t parsed;
+    if (rg_tlog_parse((const uint8_t *)record, len, &parsed) != ESP_OK) {
+        return "<unparsable>";
+    }
+    char line[256];
+    rg_tlog_format(&parsed, line, sizeof(line));
+    return line;
+}
+
+TEST_CASE("rg_tlog rebuilds the text printf would have written", "[rg_tlog]")
+{
+    rg_tlog_ring_t ring;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_tlog_ring_init(&ring, (uint8_t *)s_buf, sizeof(s_buf)));
+
+    const float temperature = 23.25f;
+    const char name[] = {'d', 'a', 'm', 'p', '\0'}; // On the stack: copied, not referenced
+    int local = 0;
+    TEST_ASSERT_TRUE(ring_write(&ring, 1234, "T=%.2f C, %s %d/%u 0x%04x %ld %lld%%", temperature, name, -42, 42u,
+                                0xbeefu, -70000L, -5000000000LL));
+    TEST_ASSERT_TRUE(ring_write(&ring, 1235, "[%*d] [%-6s] [%.*s] %p %c", 5, 7, "ab", 3, "abcdef", (void *)&local,
+                                'x'));
+    TEST_ASSERT_TRUE(ring_write(&ring, 1236, "no arguments"));
+
+    char expected[200];
+    snprintf(expected, sizeof(expected), "I (1234) TEST: T=%.2f C, %s %d/%u 0x%04x %ld %lld%%", temperature, name,
+             -42, 42u, 0xbeefu, -70000L, -5000000000LL);
+    std::string text = read_text(&ring);
+    TEST_ASSERT_EQUAL_STRING(expected, text.c_str());
+    snprintf(expected, sizeof(expected), "I (1235) TEST: [%*d] [%-6s] [%.*s] %p %c", 5, 7, "ab", 3, "abcdef",
+             (void *)&local, 'x');
+    text = read_text(&ring);
+    TEST_ASSERT_EQUAL_STRING(expected, text.c_str());
+    text = read_text(&ring);
+    TEST_ASSERT_EQUAL_STRING("I (1236) TEST: no arguments", text.c_str());
+    text = read_text(&ring);
+    TEST_ASSERT_EQUAL_STRING("", text.c_str());
+}
+
+TEST_CASE("rg_tlog truncates long strings and marks arguments that did not fit", "[rg_tlog]")
+{
+    rg_tlog_ring_t ring;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_tlog_ring_init(&ring, (uint8_t *)s_buf, sizeof(s_buf)));
+
+    char text[100];
+    memset(text, 'a', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    TEST_ASSERT_TRUE(ring_write(&ring, 1, "%s|%s|%s|%s|%d", text, text, text, text, 5));
+
+    std::string expected = "I (1) TEST: " + std::string(RG_TLOG_MAX_STRING, 'a') + "|" +
+                           std::string(RG_TLOG_MAX_STRING, 'a') + "|";
+    std::string line = read_text(&ring);
+    TEST_ASSERT_TRUE(line.size() > expected.size());
+    const std::string head = line.substr(0, expected.size());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), head.c_str());
+    // The third string gets what is left of the record; the rest are gone
+    const std::string tail = line.substr(line.size() - 8);
+    TEST_ASSERT_EQUAL_STRING("|<?>|<?>", tail.c_str());
+}
+
+TEST_CASE("rg_tlog drops and counts records when the ring is full, and wraps around", "[rg_tlog]")
+{
+    rg_tlog_ring_t ring;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_tlog_ring_init(&ring, (uint8_t *)s_buf, 192));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rg_tlog_ring_init(&ring, (uint8_t *)s_buf + 1, 128));
+    TEST_ASSERT_EQUAL(ESP_OK, rg_tlog_ring_init(&ring, (uint8_t *)s_buf, sizeof(s_buf)));
+
+    // One int: a header and 4 bytes, 20 or 28 bytes depending on pointer size
+    int written = 0;
+    while (ring_write(&ring, 0, "n=%d", written)) {
+        written++;
+    }
+    TEST_ASSERT_TRUE(written > 0);
+    TEST_ASSERT_EQUAL(1, ring.dropped);
+    TEST_ASSERT_EQUAL(written, ring.records);
+    TEST_ASSERT_TRUE(ring.high_water <= sizeof(s_buf));
+    TEST_ASSERT_TRUE(ring.high_water > sizeof(s_buf) - 32);
+
+    // Keep the ring half full for many laps; records come out whole and in order
+    int next = 0;
+    char expected[32];
+    for (int i = 0; i < written / 2; i++) {
+        snprintf(expected, sizeof(expected), "I (0) TEST: n=%d", next++);
+        std::string line = read_text(&ring);
+        TEST_ASSERT_EQUAL_STRING(expected, line.c_str());
+    }
+    for (int lap = 0; lap < 50 * written; lap++) {
+        TEST_ASSERT_TRUE(ring_write(&ring, 0, "n=%d", written++));
+        snprintf(expected, sizeof(expected), "I (0) TEST: n=%d", next++);
+        std::string line = read_text(&ring);
+        TEST_ASSERT_EQUAL_STRING(expected, line.c_str());
+    }
+    while (next < written) {
+        snprintf(expected, sizeof(expected), "I (0) TEST: n=%d", next++);
+        std::string line = read_text(&ring);
+        TEST_ASSERT_EQUAL_STRING(expected, line.c_str());
+    }
+    std::string line = read_text(&ring);
+    TEST_ASSERT_EQUAL_STRING("", line.c_str());
+    TEST_ASSERT_EQUAL(1, ring.dropped);
+}
+
+TEST_CASE("rg_tlog keeps records whole with concurrent writers", "[rg_tlog]")
+{
+    enum { WRITERS = 4, PER_WRITER = 20000 };
+    static uint32_t buf[1024 / sizeof(uint32_t)];
+    rg_tlog_ring_t ring;
+    TEST_ASSERT_EQUAL(ESP_OK, rg_tlog_ring_init(&ring, (uint8_t *)buf, sizeof(buf)));
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&ring, w] {
+            for (int i = 0; i < PER_WRITER; i++) {
+                ring_write(&ring, 0, "%d %d %d", w, i, w * PER_WRITER + i);
+            }
+        });
+    }
+
+    // Each writer's records arrive in its own order, every one self-consistent
+    int last[WRITERS] = {-1, -1, -1, -1};
+    uint32_t read = 0;
+    int bad = 0;
+    bool done = false;
+    while (true) {
+        std::string line = read_text(&ring);
+        if (line.empty()) {
+            if (done) {
+                break;
+            }
+            if (read + __atomic_load_n(&ring.dropped, __ATOMIC_RELAXED) == WRITERS * PER_WRITER) {
+                done = true; // One more pass for anything committed since
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        int w = -1;
+        int i = -1;
+        int k = -1;
+        if (sscanf(line.c_str(), "I (0) TEST: %d %d %d", &w, &i, &k) != 3 || w < 0 || w >= WRITERS ||
+            k != w * PER_WRITER + i || i <= last[w]) {
+            bad++;
+        } else {
+            last[w] = i;
+        }
+        read++;
+    }
+    for (auto &t : writers) {
+        t.join();
+    }
+    TEST_ASSERT_EQUAL(0, bad);
+    TEST_ASSERT_EQUAL(WRITERS * PER_WRITER, read + ring.dropped);
+    TEST_ASSERT_EQUAL(read, ring.records);
+}
@@ -0,0 +1,151 @@
+#include "unity.h"
+#include "services/codec/rg_ts_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t s_rng;
+
+static uint32_t next_random(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return s_rng;
+}
+
+static void assert_sample_equal(const rg_ts_sample_t *expected, const rg_ts_sample_t *actual)
+{
+    TEST_ASSERT_EQUAL_UINT32(expected->timestamp, actual->timestamp);
+    for (int c = 0; c < RG_TS_CHANNELS; c++) {
+        TEST_ASSERT_EQUAL_INT32(expected->values[c], actual->values[c]);
+    }
+}
+
+// Encodes @p samples into one block of *len bytes and checks they decode unchanged
+static void round_trip(const rg_ts_sample_t *samples, size_t count, uint8_t *buf, size_t size, size_t *len)
+{
+    rg_ts_encoder_t enc;
+    TEST_ASSERT_TRUE(rg_ts_encoder_init(&enc, buf, size));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(rg_ts_encoder_append(&enc, &samples[i]));
+    }
+    *len = rg_ts_encoder_size(&enc);
+
+    rg_ts_decoder_t dec;
+    rg_ts_sample_t out;
+    TEST_ASSERT_TRUE(rg_ts_decoder_init(&dec, buf, *len));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(rg_ts_decoder_next(&dec, &out));
+        assert_sample_equal(&samples[i], &out);
+    }
+    TEST_ASSERT_FALSE(rg_ts_decoder_next(&dec, &out));
+}
+
+TEST_CASE("rg_ts_codec round-trips every bucket and wrap-around", "[rg_ts_codec]")
+{
+    static rg_ts_sample_t samples[400];
+    static uint8_t buf[8192];
+    // Deltas from each bucket, including int32 extremes and a timestamp wrap
+    static const int32_t steps[] = {0, 1, -1, 7, -8, 8, -9, 127, -128, 128, -129, 32767, -32768, 32768, -32769,
+                                    INT32_MAX, INT32_MIN};
+    const size_t nsteps = sizeof(steps) / sizeof(steps[0]);
+    s_rng = 42;
+    uint32_t ts = 0xFFFFFF00u;
+    int32_t v[RG_TS_CHANNELS] = {2137, -4852, INT32_MAX};
+    for (size_t i = 0; i < 400; i++) {
+        ts += i % 50 == 0 ? next_random() : 10 + (next_random() % 3 == 0 ? steps[next_random() % 9] : 0);
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            v[c] = (int32_t)((uint32_t)v[c] + (uint32_t)steps[next_random() % nsteps]);
+        }
+        samples[i].timestamp = ts;
+        memcpy(samples[i].values, v, sizeof(v));
+    }
+    size_t len;
+    round_trip(samples, 400, buf, sizeof(buf), &len);
+    printf("rg_ts_codec: 400 mixed samples in %u bytes\n", (unsigned)len);
+}
+
+TEST_CASE("rg_ts_codec stores a steady unchanged stream in 4 bits per sample", "[rg_ts_codec]")
+{
+    static rg_ts_sample_t samples[101];
+    uint8_t buf[128];
+    for (uint32_t i = 0; i < 101; i++) {
+        samples[i].timestamp = 1000 + i * 10;
+        samples[i].values[0] = 2150;
+        samples[i].values[1] = 4500;
+        samples[i].values[2] = 101325;
+    }
+    size_t len;
+    round_trip(samples, 101, buf, sizeof(buf), &len);
+    // Header, first sample in full, the first interval (9 bits) and 4 bits per sample
+    TEST_ASSERT_EQUAL_UINT32(RG_TS_BLOCK_HEADER + 16 + (9 + 3 + 99 * 4 + 7) / 8, len);
+}
+
+TEST_CASE("rg_ts_codec refuses a sample that does not fit and keeps the block intact", "[rg_ts_codec]")
+{
+    uint8_t buf[40];
+    rg_ts_encoder_t enc;
+    TEST_ASSERT_FALSE(rg_ts_encoder_init(&enc, buf, 1));
+    TEST_ASSERT_TRUE(rg_ts_encoder_init(&enc, buf, sizeof(buf)));
+
+    rg_ts_sample_t sample = {.timestamp = 500, .values = {2000, 4000, 100000}};
+    size_t appended = 0;
+    s_rng = 7;
+    while (rg_ts_encoder_append(&enc, &sample)) {
+        appended++;
+        sample.timestamp += 10 + next_random() % 5;
+        for (int c = 0; c < RG_TS_CHANNELS; c++) {
+            sample.values[c] += (int32_t)(next_random() % 41) - 20;
+        }
+    }
+    TEST_ASSERT_TRUE(appended > 2);
+    TEST_ASSERT_TRUE(rg_ts_encoder_size(&enc) <= sizeof(buf));
+    TEST_ASSERT_FALSE(rg_ts_encoder_append(&enc, &sample)); // Still full, still unchanged
+
+    rg_ts_decoder_t dec;
+    rg_ts_sample_t out;
+    TEST_ASSERT_TRUE(rg_ts_decoder_init(&dec, buf, rg_ts_encoder_size(&enc)));
+    size_t decoded = 0;
+    while (rg_ts_decoder_next(&dec, &out)) {
+        decoded++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(appended, decoded);
+}
+
+TEST_CASE("rg_ts_codec stops at a truncated block", "[rg_ts_codec]")
+{
+    uint8_t buf[64];
+    rg_ts_encoder_t enc;
+    rg_ts_encoder_init(&enc, buf, sizeof(buf));
+    rg_ts_sample_t sample = {.timestamp = 100, .values = {1, 2, 3}};
+    for (int i = 0; i < 5; i++) {
+        rg_ts_encoder_append(&enc, &sample);
+        sample.timestamp += 10;
+        sample.values[0] += 1000; // 20 bits per sample after the first
+    }
+
+    rg_ts_decoder_t dec;
+    rg_ts_sample_t out;
+    TEST_ASSERT_FALSE(rg_ts_decoder_init(&dec, buf, 1));
+    // Header plus the first sample and part of the second
+    TEST_ASSERT_TRUE(rg_ts_decoder_init(&dec, buf, RG_TS_BLOCK_HEADER + 17));
+    TEST_ASSERT_TRUE(rg_ts_decoder_next(&dec, &out));
+    TEST_ASSERT_EQUAL_UINT32(100, out.timestamp);
+    TEST_ASSERT_FALSE(rg_ts_decoder_next(&dec, &out));
+}
+
+TEST_CASE("rg_ts_codec quantizes BME280 readings to the sensor resolution", "[rg_ts_codec]")
+{
+    rg_bme280_values_t in = {.temperature = -3.456f, .pressure = 1013.2549f, .humidity = 48.524f};
+    rg_ts_sample_t sample;
+    rg_ts_sample_from_values(&sample, 1234, &in);
+    TEST_ASSERT_EQUAL_UINT32(1234, sample.timestamp);
+    TEST_ASSERT_EQUAL_INT32(-346, sample.values[0]);
+    TEST_ASSERT_EQUAL_INT32(4852, sample.values[1]);
+    TEST_ASSERT_EQUAL_INT32(101325, sample.values[2]);
+
+    rg_bme280_values_t out;
+    rg_ts_sample_to_values(&sample, &out);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.temperature, out.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.humidity, out.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.pressure, out.pressure);
+}
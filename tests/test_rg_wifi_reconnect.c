@@ -0,0 +1,113 @@
+#include "unity.h"
+#include "communications/rg_wifi_reconnect.h"
+
+#include <string.h>
+
+static const rg_wifi_ap_t s_home = {{0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56}, 6};
+
+TEST_CASE("rg_wifi_reconnect scans when nothing is cached", "[rg_wifi_reconnect]")
+{
+    rg_wifi_reconnect_t r;
+    rg_wifi_reconnect_init(&r, NULL, 250, 30000);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_start(&r));
+
+    // The first connect fills the cache, to be persisted
+    TEST_ASSERT_TRUE(rg_wifi_reconnect_on_connected(&r, &s_home));
+    TEST_ASSERT_EQUAL_MEMORY(&s_home, &r.cache, sizeof(s_home));
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.cached_connects);
+}
+
+TEST_CASE("rg_wifi_reconnect tries the cached AP, then a scan, then backs off", "[rg_wifi_reconnect]")
+{
+    rg_wifi_reconnect_t r;
+    rg_wifi_reconnect_init(&r, &s_home, 250, 2000);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_start(&r));
+
+    uint32_t wait_ms = 0;
+    const uint32_t expected[] = {250, 500, 1000, 2000, 2000};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        // A failed cached attempt falls back to a full scan at once
+        TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+        // A failed scan waits, doubling up to the maximum
+        TEST_ASSERT_EQUAL(RG_WIFI_ACTION_WAIT, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+        TEST_ASSERT_EQUAL_UINT32(expected[i], wait_ms);
+        // A stray disconnect while waiting does not start another attempt
+        TEST_ASSERT_EQUAL(RG_WIFI_ACTION_NONE, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+        TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_on_timer(&r));
+    }
+    TEST_ASSERT_EQUAL_UINT32(6, r.stats.cached_attempts);
+    TEST_ASSERT_EQUAL_UINT32(5, r.stats.scan_attempts);
+    TEST_ASSERT_EQUAL_UINT32(10, r.stats.failures);
+
+    // The AP is back: same BSSID and channel, nothing to persist, and the backoff starts over
+    TEST_ASSERT_FALSE(rg_wifi_reconnect_on_connected(&r, &s_home));
+    TEST_ASSERT_EQUAL_UINT32(1, r.stats.cached_connects);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_WAIT, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(250, wait_ms);
+}
+
+TEST_CASE("rg_wifi_reconnect retries the cache at once after a link drop", "[rg_wifi_reconnect]")
+{
+    rg_wifi_reconnect_t r;
+    rg_wifi_reconnect_init(&r, &s_home, 250, 30000);
+    rg_wifi_reconnect_start(&r);
+    rg_wifi_reconnect_on_connected(&r, &s_home);
+
+    uint32_t wait_ms = 0;
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(0, wait_ms);
+    TEST_ASSERT_FALSE(rg_wifi_reconnect_on_connected(&r, &s_home));
+    TEST_ASSERT_EQUAL_UINT32(2, r.stats.cached_connects);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.failures);
+}
+
+TEST_CASE("rg_wifi_reconnect follows an AP that moved channel", "[rg_wifi_reconnect]")
+{
+    rg_wifi_reconnect_t r;
+    rg_wifi_reconnect_init(&r, &s_home, 250, 30000);
+    uint32_t wait_ms = 0;
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_start(&r));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+
+    rg_wifi_ap_t moved = s_home;
+    moved.channel = 11;
+    TEST_ASSERT_TRUE(rg_wifi_reconnect_on_connected(&r, &moved));
+    TEST_ASSERT_EQUAL_UINT8(11, r.cache.channel);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.cached_connects);
+    // The next drop goes straight to the new channel
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_CACHED, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+}
+
+TEST_CASE("rg_wifi_reconnect forgets the cached AP when the network changes", "[rg_wifi_reconnect]")
+{
+    rg_wifi_reconnect_t r;
+    rg_wifi_reconnect_init(&r, &s_home, 250, 30000);
+    uint32_t wait_ms = 0;
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_NONE, rg_wifi_reconnect_forget(&r));
+
+    // Connected: drop the link, and its disconnect scans at once without counting a failure
+    rg_wifi_reconnect_init(&r, &s_home, 250, 30000);
+    rg_wifi_reconnect_start(&r);
+    rg_wifi_reconnect_on_connected(&r, &s_home);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_DISCONNECT, rg_wifi_reconnect_forget(&r));
+    TEST_ASSERT_EQUAL_UINT8(0, r.cache.channel);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.failures);
+
+    // Mid-attempt with the old credentials: the same
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_DISCONNECT, rg_wifi_reconnect_forget(&r));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.failures);
+
+    // Backing off after failed rounds: scan now, and the next backoff starts from the minimum
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_WAIT, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    rg_wifi_reconnect_on_timer(&r);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_WAIT, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(500, wait_ms);
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_CONNECT_SCAN, rg_wifi_reconnect_forget(&r));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_NONE, rg_wifi_reconnect_on_timer(&r));
+    TEST_ASSERT_EQUAL(RG_WIFI_ACTION_WAIT, rg_wifi_reconnect_on_disconnected(&r, &wait_ms));
+    TEST_ASSERT_EQUAL_UINT32(250, wait_ms);
+}
@@ -0,0 +1,175 @@
+#include "unity.h"
+#include "communications/rg_zb_reporting.h"
+
+#include <stdio.h>
+
+static const rg_zb_report_config_t s_config = {
+    .min_interval_ms = 10000,
+    .max_interval_ms = 600000,
+    .reportable_change = 10,
+};
+
+static void setup(rg_zb_report_t *engine, size_t attrs, uint32_t batch_window_ms)
+{
+    rg_zb_report_init(engine, batch_window_ms);
+    for (size_t i = 0; i < attrs; i++) {
+        TEST_ASSERT_EQUAL_INT((int)i, rg_zb_report_add(engine, &s_config));
+    }
+}
+
+TEST_CASE("rg_zb_report sends the first value immediately", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 1, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 0));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, rg_zb_report_next_ms(&engine, 0));
+
+    rg_zb_report_set(&engine, 0, 2100);
+    TEST_ASSERT_EQUAL_UINT32(0x1, rg_zb_report_due(&engine, 5));
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_next_ms(&engine, 5));
+    rg_zb_report_sent(&engine, 0x1, 5);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 5));
+    TEST_ASSERT_EQUAL_UINT32(600000, rg_zb_report_next_ms(&engine, 5));
+}
+
+TEST_CASE("rg_zb_report ignores changes below the reportable change", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 1, 0);
+    rg_zb_report_set(&engine, 0, 2100);
+    rg_zb_report_sent(&engine, rg_zb_report_due(&engine, 0), 0);
+
+    rg_zb_report_set(&engine, 0, 2109);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 20000));
+    rg_zb_report_set(&engine, 0, 2091);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 20000));
+    rg_zb_report_set(&engine, 0, 2090);
+    TEST_ASSERT_EQUAL_UINT32(0x1, rg_zb_report_due(&engine, 20000));
+}
+
+TEST_CASE("rg_zb_report holds a change until the minimum interval", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 1, 0);
+    rg_zb_report_set(&engine, 0, 2100);
+    rg_zb_report_sent(&engine, rg_zb_report_due(&engine, 1000), 1000);
+
+    rg_zb_report_set(&engine, 0, 2300);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 4000));
+    TEST_ASSERT_EQUAL_UINT32(7000, rg_zb_report_next_ms(&engine, 4000));
+    TEST_ASSERT_EQUAL_UINT32(0x1, rg_zb_report_due(&engine, 11000));
+
+    // The report carries the latest value, not the one that triggered it
+    rg_zb_report_set(&engine, 0, 2350);
+    rg_zb_report_sent(&engine, 0x1, 11000);
+    TEST_ASSERT_EQUAL_INT32(2350, engine.attrs[0].reported);
+}
+
+TEST_CASE("rg_zb_report repeats an unchanged value at the maximum interval", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 1, 0);
+    rg_zb_report_set(&engine, 0, 2100);
+    rg_zb_report_sent(&engine, rg_zb_report_due(&engine, 0), 0);
+
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 599999));
+    TEST_ASSERT_EQUAL_UINT32(0x1, rg_zb_report_due(&engine, 600000));
+
+    // With no maximum interval nothing is pending
+    rg_zb_report_config_t config = s_config;
+    config.max_interval_ms = 0;
+    rg_zb_report_init(&engine, 0);
+    rg_zb_report_add(&engine, &config);
+    rg_zb_report_set(&engine, 0, 2100);
+    rg_zb_report_sent(&engine, rg_zb_report_due(&engine, 0), 0);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, rg_zb_report_next_ms(&engine, 0));
+}
+
+TEST_CASE("rg_zb_report batches attributes due within the window", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 3, 2000);
+    for (int i = 0; i < 3; i++) {
+        rg_zb_report_set(&engine, i, 1000);
+    }
+    rg_zb_report_sent(&engine, 0x1, 0);
+    rg_zb_report_sent(&engine, 0x2, 1500);
+    rg_zb_report_sent(&engine, 0x4, 5000);
+
+    // Attribute 0 is due at 600000, attribute 1 at 601500 (in the window) and
+    // attribute 2 at 605000 (outside it)
+    TEST_ASSERT_EQUAL_UINT32(0x3, rg_zb_report_due(&engine, 600000));
+
+    // A pending change still inside its minimum interval is never pulled forward
+    rg_zb_report_sent(&engine, 0x1, 599000);
+    rg_zb_report_set(&engine, 0, 1500);
+    rg_zb_report_set(&engine, 1, 1500);
+    TEST_ASSERT_EQUAL_UINT32(0x2, rg_zb_report_due(&engine, 601500));
+}
+
+TEST_CASE("rg_zb_report survives the millisecond clock wrapping", "[rg_zb_report]")
+{
+    rg_zb_report_t engine;
+    setup(&engine, 1, 0);
+    rg_zb_report_set(&engine, 0, 2100);
+    rg_zb_report_sent(&engine, rg_zb_report_due(&engine, UINT32_MAX - 1000), UINT32_MAX - 1000);
+
+    rg_zb_report_set(&engine, 0, 2500);
+    TEST_ASSERT_EQUAL_UINT32(0, rg_zb_report_due(&engine, 5000));
+    TEST_ASSERT_EQUAL_UINT32(0x1, rg_zb_report_due(&engine, 9000));
+}
+
+// Runs one engine over a day of 10 s samples; reports are sent from sample
+// updates and from the alarm armed for rg_zb_report_next_ms(), as in rg_zigbee.cpp.
+static uint32_t simulate_day(rg_zb_report_t *engine, uint32_t *samples)
+{
+    uint32_t wakeups = 0;
+    uint32_t state = 1;
+    uint32_t next_sample = 0;
+    uint32_t alarm = UINT32_MAX;
+    const uint32_t end = 24u * 3600 * 1000;
+    *samples = 0;
+    while (next_sample < end) {
+        uint32_t t = alarm < next_sample ? alarm : next_sample;
+        if (t == next_sample) {
+            // Temperature swings slowly, humidity wanders, pressure barely moves
+            state = state * 1664525u + 1013904223u;
+            int32_t noise = (int32_t)(state >> 29) - 4;
+            uint32_t minute = t / 60000;
+            rg_zb_report_set(engine, 0, 2100 + (int32_t)(minute % 240) - 120 + noise);
+            rg_zb_report_set(engine, 1, 4500 + (int32_t)((minute / 7) % 300) + noise * 3);
+            rg_zb_report_set(engine, 2, 1013 + (int32_t)((minute / 180) % 3));
+            next_sample += 10000;
+            (*samples)++;
+        }
+        uint32_t due = rg_zb_report_due(engine, t);
+        if (due) {
+            wakeups++;
+            rg_zb_report_sent(engine, due, t);
+        }
+        uint32_t next = rg_zb_report_next_ms(engine, t);
+        alarm = next == UINT32_MAX ? UINT32_MAX : t + (next ? next : 1);
+    }
+    return wakeups;
+}
+
+TEST_CASE("rg_zb_report airtime over a day of 10 s samples", "[rg_zb_report][bench]")
+{
+    rg_zb_report_t batched;
+    rg_zb_report_t unbatched;
+    setup(&batched, 3, 10000);
+    setup(&unbatched, 3, 0);
+
+    uint32_t samples;
+    uint32_t wakeups_batched = simulate_day(&batched, &samples);
+    uint32_t wakeups_unbatched = simulate_day(&unbatched, &samples);
+
+    printf("rg_zb_report: %lu samples, %lu attribute reports if every sample were reported\n",
+           (unsigned long)samples, (unsigned long)samples * 3);
+    printf("rg_zb_report: batched   %lu reports in %lu sending wakeups\n", (unsigned long)batched.stats.reports,
+           (unsigned long)wakeups_batched);
+    printf("rg_zb_report: unbatched %lu reports in %lu sending wakeups\n", (unsigned long)unbatched.stats.reports,
+           (unsigned long)wakeups_unbatched);
+    TEST_ASSERT_TRUE(batched.stats.reports * 5 < samples * 3);
+    TEST_ASSERT_TRUE(wakeups_batched <= wakeups_unbatched);
+}
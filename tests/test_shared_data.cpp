@@ -0,0 +1,91 @@
+#include "unity.h"
+#include "services/shared_data/shared_data.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// The writer derives every field from one counter, so any mix of two samples is detectable.
+static bool sample_is_consistent(const shared_data_t &s)
+{
+    const int64_t k = s.timestamp_us;
+    return s.temperature == (float)k && s.humidity == (float)(k * 2) && s.pressure == (float)(k * 3) &&
+           (uint32_t)k == s.sequence - 1;
+}
+
+TEST_CASE("shared_data snapshot is never torn under concurrent writer and readers", "[shared_data]")
+{
+    using clock = std::chrono::steady_clock;
+    constexpr int kWrites = 200000;
+    constexpr int kReaders = 3;
+
+    // Start from a known state: the test expects sequence == k + 1 for sample k
+    shared_data_t base;
+    shared_data_read(&base);
+    const uint32_t base_seq = base.sequence;
+
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> read_ns{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; r++) {
+        readers.emplace_back([&]() {
+            uint64_t local_reads = 0;
+            uint32_t last_seq = 0;
+            const auto start = clock::now();
+            while (!done.load(std::memory_order_relaxed)) {
+                shared_data_t s;
+                shared_data_read(&s);
+                if (s.sequence > base_seq) {
+                    s.sequence -= base_seq;
+                    if (!sample_is_consistent(s) || s.sequence < last_seq) {
+                        torn.fetch_add(1);
+                    }
+                    last_seq = s.sequence;
+                }
+                local_reads++;
+            }
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            reads.fetch_add(local_reads);
+            read_ns.fetch_add((uint64_t)ns);
+        });
+    }
+
+    const auto start = clock::now();
+    for (int k = 0; k < kWrites; k++) {
+        shared_data_publish((float)k, (float)(k * 2), (float)(k * 3), k);
+    }
+    const auto write_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+
+    done.store(true);
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    printf("shared_data: %d writes, %llu reads, %u torn\n", kWrites, (unsigned long long)reads.load(), torn.load());
+    printf("shared_data: writer %.1f ns/op, reader %.1f ns/op\n", (double)write_ns / kWrites,
+           reads.load() ? (double)read_ns.load() / (double)reads.load() : 0.0);
+
+    TEST_ASSERT_EQUAL(0, torn.load());
+
+    shared_data_t last;
+    shared_data_read(&last);
+    TEST_ASSERT_EQUAL(base_seq + kWrites, last.sequence);
+    TEST_ASSERT_EQUAL(kWrites - 1, last.timestamp_us);
+}
+
+TEST_CASE("shared_data keeps the IP address independent of samples", "[shared_data]")
+{
+    shared_data_set_ip_address("192.168.1.42");
+    shared_data_publish(21.5f, 40.0f, 1013.25f, 1234);
+
+    shared_data_t s;
+    shared_data_read(&s);
+    TEST_ASSERT_EQUAL_STRING("192.168.1.42", s.ip_address);
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, s.temperature);
+    TEST_ASSERT_EQUAL(1234, s.timestamp_us);
+}